@@ -7,6 +7,7 @@
 #include "SystemCallWrapper.h"
 #include "TrayControlWindow.h"
 #include "ui_DlgCreatePeer.h"
+#include "VagrantMetadata.h"
 #include "VagrantProvider.h"
 #include "Environment.h"
 #include "updater/HubComponentsUpdater.h"
@@ -419,11 +420,8 @@ int DlgCreatePeer::reserve_new_port() {
 
   system_call_res_t rs = CPeerController::Instance()->get_global_status();
   if (rs.res == SCWE_SUCCESS && rs.exit_code == 0 && !rs.out.isEmpty()) {
-    QStringList cr = CPeerController::Instance()->get_global_status().out;
-    for (QString dir: cr) {
-      QString cur_port_str = CSystemCallWrapper::vagrant_port(dir);
-      cur_port_str.remove(QRegularExpression("[^0-9]"));
-      int cur_port = cur_port_str.toInt();
+    for (const QString& dir: rs.out) {
+      int cur_port = CVagrantMetadataCache::Instance().read(dir).console_port;
       if (cur_port < 9999) {
         continue;
       }
@@ -25,6 +25,15 @@ SOURCES += \
     commons/src/InternalCriticalSection.cpp \
     commons/src/Commons.cpp \
     hub/src/RestWorker.cpp \
+    hub/src/RestPipeline.cpp \
+    hub/src/RestCoalescer.cpp \
+    hub/src/RestResponseCache.cpp \
+    hub/src/RestJsonParser.cpp \
+    hub/src/RestRetryPolicy.cpp \
+    hub/src/RestRetrier.cpp \
+    commons/src/JsonStreamReader.cpp \
+    commons/src/RollingChecksum.cpp \
+    commons/src/RollingCrc.cpp \
     hub/src/DlgLogin.cpp \
     hub/src/SettingsManager.cpp \
     hub/src/DlgSettings.cpp \
@@ -41,6 +50,12 @@ SOURCES += \
     hub/src/updater/UpdaterComponentTray.cpp \
     hub/src/updater/IUpdaterComponent.cpp \
     libssh2/src/LibsshController.cpp \
+    libssh2/src/SshSession.cpp \
+    libssh2/src/SftpTransfer.cpp \
+    libssh2/src/ChunkedTransfer.cpp \
+    libssh2/src/SftpBrowser.cpp \
+    libssh2/src/DeltaUpload.cpp \
+    libssh2/src/SshSessionPool.cpp \
     commons/src/OsBranchConsts.cpp \
     hub/src/SsdpController.cpp \
     hub/src/RhController.cpp \
@@ -83,6 +98,20 @@ SOURCES += \
     hub/src/updater/UpdaterComponentKvm.cpp \
     hub/src/updater/UpdaterComponentParallels.cpp \
     hub/src/SshKeyController.cpp \
+    hub/src/SshKeyChecker.cpp \
+    hub/src/BoundedTaskRunner.cpp \
+    hub/src/ProcessRunner.cpp \
+    hub/src/PathResolver.cpp \
+    hub/src/P2PStateTracker.cpp \
+    hub/src/VagrantStatusCache.cpp \
+    commons/src/VagrantMetadata.cpp \
+    hub/src/PeerStatusPipeline.cpp \
+    hub/src/PeerCommandWatcher.cpp \
+    hub/src/PeerCommandExecutor.cpp \
+    hub/src/SwarmReconciler.cpp \
+    hub/src/ReachabilityChecker.cpp \
+    hub/src/InterfaceIdAllocator.cpp \
+    hub/src/TransferScheduler.cpp \
     hub/src/echoclient.cpp
 
 
@@ -90,6 +119,15 @@ SOURCES += \
 
 HEADERS  += \
     hub/include/RestWorker.h \
+    hub/include/RestPipeline.h \
+    hub/include/RestCoalescer.h \
+    hub/include/RestResponseCache.h \
+    hub/include/RestJsonParser.h \
+    hub/include/RestRetryPolicy.h \
+    hub/include/RestRetrier.h \
+    commons/include/JsonStreamReader.h \
+    commons/include/RollingChecksum.h \
+    commons/include/RollingCrc.h \
     hub/include/DlgLogin.h \
     hub/include/SettingsManager.h \
     hub/include/DlgSettings.h \
@@ -110,6 +148,12 @@ HEADERS  += \
     commons/include/Locker.h \
     commons/include/Commons.h \
     libssh2/include/LibsshController.h \
+    libssh2/include/SshSession.h \
+    libssh2/include/SftpTransfer.h \
+    libssh2/include/ChunkedTransfer.h \
+    libssh2/include/SftpBrowser.h \
+    libssh2/include/DeltaUpload.h \
+    libssh2/include/SshSessionPool.h \
     commons/include/OsBranchConsts.h \
     hub/include/SsdpController.h \
     hub/include/RhController.h \
@@ -152,6 +196,20 @@ HEADERS  += \
     hub/include/updater/UpdaterComponentKvm.h \
     hub/include/updater/UpdaterComponentParallels.h \
     hub/include/SshKeyController.h \
+    hub/include/SshKeyChecker.h \
+    hub/include/BoundedTaskRunner.h \
+    hub/include/ProcessRunner.h \
+    hub/include/PathResolver.h \
+    hub/include/P2PStateTracker.h \
+    hub/include/VagrantStatusCache.h \
+    commons/include/VagrantMetadata.h \
+    hub/include/PeerStatusPipeline.h \
+    hub/include/PeerCommandWatcher.h \
+    hub/include/PeerCommandExecutor.h \
+    hub/include/SwarmReconciler.h \
+    hub/include/ReachabilityChecker.h \
+    hub/include/InterfaceIdAllocator.h \
+    hub/include/TransferScheduler.h \
     hub/include/echoclient.h
 
 TRANSLATIONS = SubutaiControlCenter_en_US.ts \
@@ -280,7 +338,35 @@ tests {
         tests/RhControllerTest.h \
         tests/HubControlllerTest.h \
         tests/DownloadFileManagerTest.h \
-        tests/RestWorkerTest.h
+        tests/RestWorkerTest.h \
+        tests/RestPipelineTest.h \
+        tests/RestResponseCacheTest.h \
+        tests/RestCoalescerTest.h \
+        tests/RestContainersTest.h \
+        tests/RestJsonParserTest.h \
+        tests/RestRetrierTest.h \
+        tests/SshKeyCheckerTest.h \
+        tests/BoundedTaskRunnerTest.h \
+        tests/ProcessRunnerTest.h \
+        tests/PathResolverTest.h \
+        tests/P2PStateTrackerTest.h \
+        tests/VagrantStatusCacheTest.h \
+        tests/VagrantMetadataTest.h \
+        tests/PeerStatusPipelineTest.h \
+        tests/PeerCommandWatcherTest.h \
+        tests/PeerCommandExecutorTest.h \
+        tests/SwarmReconcilerTest.h \
+        tests/ReachabilityCheckerTest.h \
+        tests/InterfaceIdAllocatorTest.h \
+        tests/SftpTransferTest.h \
+        tests/LocalSshServer.h \
+        tests/ChunkedTransferTest.h \
+        tests/RollingChecksumTest.h \
+        tests/TransferSchedulerTest.h \
+        tests/SftpBrowserTest.h \
+        tests/DeltaUploadTest.h \
+        tests/SshSessionPoolTest.h \
+        tests/FakeHubServer.h
 
     SOURCES += tests/main.cpp \
         tests/CCommonsTest.cpp \
@@ -298,7 +384,35 @@ tests {
         tests/RhControllerTest.cpp \
         tests/HubControlllerTest.cpp \
         tests/DownloadFileManagerTest.cpp \
-        tests/RestWorkerTest.cpp
+        tests/RestWorkerTest.cpp \
+        tests/RestPipelineTest.cpp \
+        tests/RestResponseCacheTest.cpp \
+        tests/RestCoalescerTest.cpp \
+        tests/RestContainersTest.cpp \
+        tests/RestJsonParserTest.cpp \
+        tests/RestRetrierTest.cpp \
+        tests/SshKeyCheckerTest.cpp \
+        tests/BoundedTaskRunnerTest.cpp \
+        tests/ProcessRunnerTest.cpp \
+        tests/PathResolverTest.cpp \
+        tests/P2PStateTrackerTest.cpp \
+        tests/VagrantStatusCacheTest.cpp \
+        tests/VagrantMetadataTest.cpp \
+        tests/PeerStatusPipelineTest.cpp \
+        tests/PeerCommandWatcherTest.cpp \
+        tests/PeerCommandExecutorTest.cpp \
+        tests/SwarmReconcilerTest.cpp \
+        tests/ReachabilityCheckerTest.cpp \
+        tests/InterfaceIdAllocatorTest.cpp \
+        tests/SftpTransferTest.cpp \
+        tests/LocalSshServer.cpp \
+        tests/ChunkedTransferTest.cpp \
+        tests/RollingChecksumTest.cpp \
+        tests/TransferSchedulerTest.cpp \
+        tests/SftpBrowserTest.cpp \
+        tests/DeltaUploadTest.cpp \
+        tests/SshSessionPoolTest.cpp \
+        tests/FakeHubServer.cpp
 } else {
     message(Normal build)
 }
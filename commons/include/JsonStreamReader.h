@@ -0,0 +1,91 @@
+#ifndef JSONSTREAMREADER_H
+#define JSONSTREAMREADER_H
+
+#include <vector>
+#include <QByteArray>
+#include <QString>
+
+/**
+ * @brief The CJsonStreamReader class is pull-style JSON tokenizer.
+ * Data is added by chunks as it comes, next() returns JT_NEED_MORE when
+ * current token isn't complete yet. Syntax is validated, so after finish()
+ * document is either read up to JT_END or JT_ERROR is returned.
+ * @code {.cpp}
+ * reader.add_data(chunk);
+ * for (auto t = reader.next(); t != JT_NEED_MORE; t = reader.next()) {...}
+ * @endcode
+ */
+class CJsonStreamReader {
+public:
+  enum token_t {
+    JT_BEGIN_OBJECT = 0,
+    JT_END_OBJECT,
+    JT_BEGIN_ARRAY,
+    JT_END_ARRAY,
+    JT_KEY,
+    JT_STRING,
+    JT_NUMBER,
+    JT_BOOL,
+    JT_NULL,
+    JT_NEED_MORE,
+    JT_END,
+    JT_ERROR
+  };
+
+  static const int MAX_DEPTH = 512;
+
+  CJsonStreamReader();
+
+  void add_data(const QByteArray& chunk);
+  /**
+   * @brief no more data will be added
+   */
+  void finish();
+  token_t next();
+
+  /* value of last JT_KEY or JT_STRING */
+  const QString& string_value() const {return m_string;}
+  double number_value() const {return m_number;}
+  bool bool_value() const {return m_bool;}
+  const QString& error_string() const {return m_error;}
+  /* count of opened objects and arrays */
+  int depth() const {return (int)m_stack.size();}
+
+private:
+  enum state_t {
+    ST_VALUE = 0,
+    ST_FIRST_VALUE_OR_END,
+    ST_FIRST_KEY_OR_END,
+    ST_KEY,
+    ST_COLON,
+    ST_COMMA_OR_END,
+    ST_DONE,
+    ST_FAILED
+  };
+
+  enum read_res_t {
+    RR_OK = 0,
+    RR_NEED_MORE,
+    RR_ERROR
+  };
+
+  QByteArray m_buff;
+  int m_pos;
+  bool m_finished;
+  state_t m_state;
+  std::vector<char> m_stack;
+
+  QString m_string;
+  double m_number;
+  bool m_bool;
+  QString m_error;
+
+  token_t fail(const QString& err);
+  token_t end_of_container(char c);
+  void after_value();
+  read_res_t read_string(int &pos);
+  read_res_t read_number(int &pos);
+  read_res_t read_literal(int &pos, const char* literal);
+};
+
+#endif // JSONSTREAMREADER_H
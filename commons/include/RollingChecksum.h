@@ -0,0 +1,36 @@
+#ifndef ROLLINGCHECKSUM_H
+#define ROLLINGCHECKSUM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief The CRollingChecksum class is weak 32 bit checksum of rsync
+ * (two adler-like 16 bit sums). Checksum of window moved by one byte is
+ * computed from previous one by roll() in constant time, so it's cheap to
+ * check every offset of file against set of known blocks. Collisions are
+ * possible, strong hash is needed to confirm match.
+ */
+class CRollingChecksum {
+public:
+  CRollingChecksum() : m_a(0), m_b(0), m_len(0) {}
+
+  void reset() {m_a = m_b = 0; m_len = 0;}
+  /* appends data to window */
+  void update(const char* data, size_t len);
+  /* removes out from the beginning of window and appends in to its end */
+  void roll(unsigned char out, unsigned char in);
+
+  uint32_t digest() const {return (m_b << 16) | (m_a & 0xffff);}
+  size_t length() const {return m_len;}
+
+  static uint32_t checksum(const char* data, size_t len);
+
+private:
+  // sums are kept mod 2^32, only low 16 bits of each go to digest
+  uint32_t m_a;
+  uint32_t m_b;
+  size_t m_len;
+};
+
+#endif // ROLLINGCHECKSUM_H
@@ -0,0 +1,45 @@
+#ifndef ROLLINGCRC_H
+#define ROLLINGCRC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief The CRollingCrc class is CRC-32 of POSIX cksum (what `cksum`
+ * prints for data) over window of fixed size. CRC is linear, so byte which
+ * leaves window is taken out by xor with precomputed value and window is
+ * moved by one byte in constant time, like CRollingChecksum does.
+ * It's used where checksums of blocks come from container, which has
+ * cksum in coreutils but nothing to compute rsync sums.
+ */
+class CRollingCrc {
+public:
+  explicit CRollingCrc(size_t window);
+
+  void reset() {m_crc = 0; m_len = 0;}
+  /* appends data to window */
+  void update(const char* data, size_t len);
+  /* removes out from the beginning of full window and appends in to its end */
+  void roll(unsigned char out, unsigned char in);
+
+  /* cksum of length() bytes of window */
+  uint32_t digest() const;
+  size_t length() const {return m_len;}
+  size_t window() const {return m_window;}
+
+  static uint32_t cksum(const char* data, size_t len);
+
+private:
+  size_t m_window;
+  uint32_t m_crc;
+  size_t m_len;
+  // crc of byte followed by window zeros, taken out when byte leaves window
+  uint32_t m_out[256];
+
+  static const uint32_t* table();
+  static uint32_t step(uint32_t crc, unsigned char byte) {
+    return (crc << 8) ^ table()[((crc >> 24) ^ byte) & 0xff];
+  }
+};
+
+#endif // ROLLINGCRC_H
@@ -0,0 +1,86 @@
+#ifndef VAGRANTMETADATA_H
+#define VAGRANTMETADATA_H
+
+#include <map>
+#include <QByteArray>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+
+/**
+ * @brief The CYamlSubsetReader class reads flat YAML mappings, the only kind
+ * of YAML written for peers (.vagrant/generated.yml, vagrant-subutai.yml):
+ * `KEY: value` and `KEY : value` lines, `---`/`...` markers, comments, plain,
+ * single and double quoted scalars. Nested blocks and list items are skipped,
+ * flow collections are kept as raw text. Malformed lines are skipped too,
+ * so any input is accepted. Input is scanned in place, only keys and values
+ * which are kept get allocated. Last value of repeated key wins.
+ */
+class CYamlSubsetReader {
+public:
+  /* @return count of pairs read */
+  static int parse(const char* data, int size, QHash<QString, QString>& out);
+  static QHash<QString, QString> parse(const QByteArray& data);
+  static bool parse_file(const QString& path, QHash<QString, QString>& out);
+};
+////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief What is known about local peer from files of vagrant and
+ * vagrant-subutai plugin. Numbers are -1 and strings are empty when unknown.
+ */
+struct vagrant_peer_meta_t {
+  bool generated_found;             // .vagrant/generated.yml was read
+  int console_port;                 // _CONSOLE_PORT
+  QString ip_peer;                  // _IP_PEER
+  QString bridge;                   // _BRIDGE
+  QString machine_name;             // .vagrant/machines/<machine_name>
+  QString provider;                 // .vagrant/machines/<machine_name>/<provider>
+  QString machine_id;               // content of <provider>/id
+  QHash<QString, QString> values;   // every key of generated.yml
+
+  vagrant_peer_meta_t() :
+    generated_found(false),
+    console_port(-1) {}
+};
+////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief The CVagrantMetadataCache class keeps parsed metadata of peers by
+ * peer directory. Entry is valid while size and mtime of generated.yml and
+ * mtimes of machine directories are the same, so repeated lookups cost a few
+ * stat() calls instead of reading and parsing files. Not more than MAX_ENTRIES
+ * are kept, the oldest one is dropped first. Thread safe.
+ */
+class CVagrantMetadataCache {
+public:
+  static const int MAX_ENTRIES = 1024;
+
+  CVagrantMetadataCache();
+  static CVagrantMetadataCache& Instance();
+
+  vagrant_peer_meta_t read(const QString& peer_dir);
+  void clear();
+  /* count of real reads of files, i.e. cache misses */
+  quint64 reads_count() const;
+
+  static vagrant_peer_meta_t read_uncached(const QString& peer_dir);
+
+private:
+  struct entry_t {
+    QString stamp;
+    vagrant_peer_meta_t meta;
+    quint64 stored;  // order of insertion, the least one is evicted
+  };
+
+  mutable QMutex m_mutex;
+  std::map<QString, entry_t> m_cache;
+  quint64 m_reads_count;
+  quint64 m_store_counter;
+
+  void evict_oldest();
+
+  static QString stamp_of(const QString& peer_dir, const vagrant_peer_meta_t& meta);
+};
+
+#endif // VAGRANTMETADATA_H
@@ -0,0 +1,295 @@
+#include <string.h>
+#include "JsonStreamReader.h"
+
+const int CJsonStreamReader::MAX_DEPTH;
+
+// consumed data is dropped from buffer when it's bigger than this
+static const int COMPACT_THRESHOLD = 64 * 1024;
+
+static bool is_ws(char c) {
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+static int hex_value(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+CJsonStreamReader::CJsonStreamReader() :
+  m_pos(0),
+  m_finished(false),
+  m_state(ST_VALUE),
+  m_number(0),
+  m_bool(false) {
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CJsonStreamReader::add_data(const QByteArray &chunk) {
+  if (m_pos > COMPACT_THRESHOLD) {
+    m_buff.remove(0, m_pos);
+    m_pos = 0;
+  }
+  m_buff.append(chunk);
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CJsonStreamReader::finish() {
+  m_finished = true;
+}
+////////////////////////////////////////////////////////////////////////////
+
+CJsonStreamReader::token_t
+CJsonStreamReader::next() {
+  while (true) {
+    if (m_state == ST_FAILED) return JT_ERROR;
+
+    while (m_pos < m_buff.size() && is_ws(m_buff[m_pos]))
+      ++m_pos;
+
+    if (m_pos >= m_buff.size()) {
+      if (!m_finished) return JT_NEED_MORE;
+      if (m_state == ST_DONE) return JT_END;
+      return fail("unexpected end of document");
+    }
+
+    char c = m_buff[m_pos];
+    switch (m_state) {
+      case ST_DONE:
+        return fail("garbage after document");
+
+      case ST_COLON:
+        if (c != ':') return fail("colon expected");
+        ++m_pos;
+        m_state = ST_VALUE;
+        continue;
+
+      case ST_FIRST_KEY_OR_END:
+        if (c == '}') return end_of_container(c);
+        // fall through
+      case ST_KEY: {
+        if (c != '"') return fail("key expected");
+        int pos = m_pos;
+        read_res_t rr = read_string(pos);
+        if (rr == RR_NEED_MORE) return JT_NEED_MORE;
+        if (rr == RR_ERROR) return JT_ERROR;
+        m_pos = pos;
+        m_state = ST_COLON;
+        return JT_KEY;
+      }
+
+      case ST_FIRST_VALUE_OR_END:
+        if (c == ']') return end_of_container(c);
+        m_state = ST_VALUE;
+        continue;
+
+      case ST_COMMA_OR_END:
+        if (c == ',') {
+          ++m_pos;
+          m_state = m_stack.back() == '{' ? ST_KEY : ST_VALUE;
+          continue;
+        }
+        return end_of_container(c);
+
+      case ST_VALUE:
+        break;
+
+      default:
+        return fail("invalid reader state");
+    }
+
+    // ST_VALUE
+    if (c == '{' || c == '[') {
+      if ((int)m_stack.size() >= MAX_DEPTH)
+        return fail("document is too deep");
+      ++m_pos;
+      m_stack.push_back(c);
+      m_state = c == '{' ? ST_FIRST_KEY_OR_END : ST_FIRST_VALUE_OR_END;
+      return c == '{' ? JT_BEGIN_OBJECT : JT_BEGIN_ARRAY;
+    }
+
+    int pos = m_pos;
+    read_res_t rr;
+    token_t res;
+    if (c == '"') {
+      rr = read_string(pos);
+      res = JT_STRING;
+    } else if (c == '-' || (c >= '0' && c <= '9')) {
+      rr = read_number(pos);
+      res = JT_NUMBER;
+    } else if (c == 't' || c == 'f') {
+      rr = read_literal(pos, c == 't' ? "true" : "false");
+      m_bool = c == 't';
+      res = JT_BOOL;
+    } else if (c == 'n') {
+      rr = read_literal(pos, "null");
+      res = JT_NULL;
+    } else {
+      return fail(QString("unexpected character '%1'").arg(c));
+    }
+
+    if (rr == RR_NEED_MORE) return JT_NEED_MORE;
+    if (rr == RR_ERROR) return JT_ERROR;
+    m_pos = pos;
+    after_value();
+    return res;
+  }
+}
+////////////////////////////////////////////////////////////////////////////
+
+CJsonStreamReader::token_t
+CJsonStreamReader::fail(const QString &err) {
+  m_state = ST_FAILED;
+  m_error = QString("%1 at offset %2").arg(err).arg(m_pos);
+  return JT_ERROR;
+}
+////////////////////////////////////////////////////////////////////////////
+
+CJsonStreamReader::token_t
+CJsonStreamReader::end_of_container(char c) {
+  char expected = m_stack.back() == '{' ? '}' : ']';
+  if (c != expected) return fail(QString("'%1' expected").arg(expected));
+  ++m_pos;
+  m_stack.pop_back();
+  after_value();
+  return c == '}' ? JT_END_OBJECT : JT_END_ARRAY;
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CJsonStreamReader::after_value() {
+  m_state = m_stack.empty() ? ST_DONE : ST_COMMA_OR_END;
+}
+////////////////////////////////////////////////////////////////////////////
+
+CJsonStreamReader::read_res_t
+CJsonStreamReader::read_string(int &pos) {
+  const char* data = m_buff.constData();
+  int size = m_buff.size();
+  QString res;
+  int seg_start = ++pos; // skip quote
+
+  while (true) {
+    if (pos >= size) {
+      if (m_finished) {
+        fail("unterminated string");
+        return RR_ERROR;
+      }
+      return RR_NEED_MORE;
+    }
+
+    unsigned char c = (unsigned char)data[pos];
+    if (c == '"') {
+      res.append(QString::fromUtf8(data + seg_start, pos - seg_start));
+      ++pos;
+      m_string = res;
+      return RR_OK;
+    }
+
+    if (c < 0x20) {
+      fail("control character in string");
+      return RR_ERROR;
+    }
+
+    if (c != '\\') {
+      ++pos;
+      continue;
+    }
+
+    // escape sequence. segments are split only on ASCII, so utf-8 isn't broken
+    res.append(QString::fromUtf8(data + seg_start, pos - seg_start));
+    if (pos + 1 >= size) {
+      if (m_finished) {
+        fail("unterminated string");
+        return RR_ERROR;
+      }
+      return RR_NEED_MORE;
+    }
+
+    char e = data[pos + 1];
+    switch (e) {
+      case '"': res.append(QChar('"')); break;
+      case '\\': res.append(QChar('\\')); break;
+      case '/': res.append(QChar('/')); break;
+      case 'b': res.append(QChar('\b')); break;
+      case 'f': res.append(QChar('\f')); break;
+      case 'n': res.append(QChar('\n')); break;
+      case 'r': res.append(QChar('\r')); break;
+      case 't': res.append(QChar('\t')); break;
+      case 'u': {
+        if (pos + 6 > size) {
+          if (m_finished) {
+            fail("unterminated string");
+            return RR_ERROR;
+          }
+          return RR_NEED_MORE;
+        }
+        ushort code = 0;
+        for (int i = 2; i < 6; ++i) {
+          int h = hex_value(data[pos + i]);
+          if (h < 0) {
+            fail("invalid unicode escape");
+            return RR_ERROR;
+          }
+          code = (ushort)((code << 4) | h);
+        }
+        // surrogate pairs come as two escapes and form valid utf-16 pair
+        res.append(QChar(code));
+        pos += 4;
+        break;
+      }
+      default:
+        fail("invalid escape sequence");
+        return RR_ERROR;
+    }
+    pos += 2;
+    seg_start = pos;
+  }
+}
+////////////////////////////////////////////////////////////////////////////
+
+CJsonStreamReader::read_res_t
+CJsonStreamReader::read_number(int &pos) {
+  static const char* number_chars = "+-0123456789.eE";
+  int start = pos;
+  while (pos < m_buff.size() && m_buff[pos] != '\0' &&
+         strchr(number_chars, m_buff[pos]) != nullptr)
+    ++pos;
+
+  // number may continue in next chunk
+  if (pos >= m_buff.size() && !m_finished)
+    return RR_NEED_MORE;
+
+  QByteArray str = m_buff.mid(start, pos - start);
+  bool ok = false;
+  m_number = str.toDouble(&ok);
+  if (!ok || str.startsWith('+')) {
+    fail(QString("invalid number %1").arg(QString(str)));
+    return RR_ERROR;
+  }
+  return RR_OK;
+}
+////////////////////////////////////////////////////////////////////////////
+
+CJsonStreamReader::read_res_t
+CJsonStreamReader::read_literal(int &pos,
+                               const char *literal) {
+  int len = (int)strlen(literal);
+  int available = m_buff.size() - pos;
+  int cmp_len = available < len ? available : len;
+  if (strncmp(m_buff.constData() + pos, literal, cmp_len) != 0) {
+    fail(QString("%1 expected").arg(literal));
+    return RR_ERROR;
+  }
+  if (available < len) {
+    if (!m_finished) return RR_NEED_MORE;
+    fail(QString("%1 expected").arg(literal));
+    return RR_ERROR;
+  }
+  pos += len;
+  return RR_OK;
+}
+////////////////////////////////////////////////////////////////////////////
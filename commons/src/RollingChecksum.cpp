@@ -0,0 +1,30 @@
+#include "RollingChecksum.h"
+
+void
+CRollingChecksum::update(const char *data,
+                         size_t len) {
+  const unsigned char* p = (const unsigned char*)data;
+  for (size_t i = 0; i < len; ++i) {
+    m_a += p[i];
+    m_b += m_a;
+  }
+  m_len += len;
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CRollingChecksum::roll(unsigned char out,
+                       unsigned char in) {
+  m_a += (uint32_t)in - (uint32_t)out;
+  m_b += m_a - (uint32_t)m_len * out;
+}
+////////////////////////////////////////////////////////////////////////////
+
+uint32_t
+CRollingChecksum::checksum(const char *data,
+                           size_t len) {
+  CRollingChecksum sum;
+  sum.update(data, len);
+  return sum.digest();
+}
+////////////////////////////////////////////////////////////////////////////
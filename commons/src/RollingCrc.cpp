@@ -0,0 +1,72 @@
+#include "RollingCrc.h"
+
+struct crc_table_t {
+  uint32_t values[256];
+  crc_table_t() {
+    for (uint32_t i = 0; i < 256; ++i) {
+      uint32_t c = i << 24;
+      for (int bit = 0; bit < 8; ++bit)
+        c = (c & 0x80000000) ? (c << 1) ^ 0x04C11DB7 : (c << 1);
+      values[i] = c;
+    }
+  }
+};
+
+const uint32_t*
+CRollingCrc::table() {
+  static const crc_table_t crc_table;
+  return crc_table.values;
+}
+////////////////////////////////////////////////////////////////////////////
+
+CRollingCrc::CRollingCrc(size_t window) :
+  m_window(window),
+  m_crc(0),
+  m_len(0) {
+  // crc is linear, value of byte is xor of values of its bits
+  m_out[0] = 0;
+  for (int bit = 0; bit < 8; ++bit) {
+    uint32_t c = step(0, (unsigned char)(1 << bit));
+    for (size_t i = 0; i < m_window; ++i)
+      c = step(c, 0);
+    for (int b = 0; b < (1 << bit); ++b)
+      m_out[b | (1 << bit)] = m_out[b] ^ c;
+  }
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CRollingCrc::update(const char *data,
+                    size_t len) {
+  const unsigned char* p = (const unsigned char*)data;
+  for (size_t i = 0; i < len; ++i)
+    m_crc = step(m_crc, p[i]);
+  m_len += len;
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CRollingCrc::roll(unsigned char out,
+                  unsigned char in) {
+  m_crc = step(m_crc, in) ^ m_out[out];
+}
+////////////////////////////////////////////////////////////////////////////
+
+uint32_t
+CRollingCrc::digest() const {
+  // length goes after data, least significant byte first
+  uint32_t c = m_crc;
+  for (size_t n = m_len; n; n >>= 8)
+    c = step(c, (unsigned char)(n & 0xff));
+  return ~c;
+}
+////////////////////////////////////////////////////////////////////////////
+
+uint32_t
+CRollingCrc::cksum(const char *data,
+                   size_t len) {
+  CRollingCrc crc(0);
+  crc.update(data, len);
+  return crc.digest();
+}
+////////////////////////////////////////////////////////////////////////////
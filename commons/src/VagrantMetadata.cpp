@@ -0,0 +1,273 @@
+#include <cstring>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+
+#include "VagrantMetadata.h"
+
+const int CVagrantMetadataCache::MAX_ENTRIES;
+
+static bool is_blank(char c) {
+  return c == ' ' || c == '\t' || c == '\r';
+}
+
+static QString str_of(const char* begin, const char* end) {
+  return QString::fromUtf8(begin, (int)(end - begin));
+}
+
+/* trims blanks on both sides of [begin, end) */
+static void trim(const char*& begin, const char*& end) {
+  while (begin < end && is_blank(*begin)) ++begin;
+  while (end > begin && is_blank(*(end - 1))) --end;
+}
+
+/* scalar starting at begin, quotes are removed. Unterminated quote takes rest of line */
+static QString read_scalar(const char* begin, const char* end) {
+  trim(begin, end);
+  if (begin == end) return QString();
+
+  if (*begin == '"') {
+    QByteArray res;
+    for (const char* p = begin + 1; p < end; ++p) {
+      if (*p == '"') break;
+      if (*p == '\\' && p + 1 < end) {
+        ++p;
+        switch (*p) {
+          case 'n': res += '\n'; break;
+          case 't': res += '\t'; break;
+          case 'r': res += '\r'; break;
+          case '0': res += '\0'; break;
+          default: res += *p; break;
+        }
+        continue;
+      }
+      res += *p;
+    }
+    return QString::fromUtf8(res);
+  }
+
+  if (*begin == '\'') {
+    QByteArray res;
+    for (const char* p = begin + 1; p < end; ++p) {
+      if (*p == '\'') {
+        // '' is escaped quote
+        if (p + 1 < end && *(p + 1) == '\'') {
+          res += '\'';
+          ++p;
+          continue;
+        }
+        break;
+      }
+      res += *p;
+    }
+    return QString::fromUtf8(res);
+  }
+
+  // plain scalar ends at comment
+  for (const char* p = begin + 1; p < end; ++p) {
+    if (*p == '#' && is_blank(*(p - 1))) {
+      end = p;
+      break;
+    }
+  }
+  trim(begin, end);
+  return str_of(begin, end);
+}
+////////////////////////////////////////////////////////////////////////////
+
+int
+CYamlSubsetReader::parse(const char *data,
+                         int size,
+                         QHash<QString, QString> &out) {
+  if (data == nullptr || size <= 0) return 0;
+  int count = 0;
+  const char* const data_end = data + size;
+
+  for (const char* line = data; line < data_end; ) {
+    const char* line_end = (const char*)memchr(line, '\n', data_end - line);
+    if (line_end == nullptr) line_end = data_end;
+    const char* begin = line;
+    const char* end = line_end;
+    line = line_end + 1;
+
+    // indented lines belong to nested blocks, list items aren't mappings
+    if (begin == end || is_blank(*begin) || *begin == '#' || *begin == '-' ||
+        *begin == '.' || *begin == '\0')
+      continue;
+    while (end > begin && is_blank(*(end - 1))) --end;
+
+    // key ends at ':' followed by blank or end of line, quoted key may contain ':'
+    const char* colon = nullptr;
+    const char* p = begin;
+    if (*p == '"' || *p == '\'') {
+      const char* close = (const char*)memchr(p + 1, *p, end - p - 1);
+      if (close == nullptr) continue;
+      p = close + 1;
+    }
+    for (; p < end; ++p) {
+      if (*p == ':' && (p + 1 == end || is_blank(*(p + 1)))) {
+        colon = p;
+        break;
+      }
+    }
+    if (colon == nullptr) continue;
+
+    QString key = read_scalar(begin, colon);
+    if (key.isEmpty()) continue;
+    out.insert(key, read_scalar(colon + 1, end));
+    ++count;
+  }
+  return count;
+}
+////////////////////////////////////////////////////////////////////////////
+
+QHash<QString, QString>
+CYamlSubsetReader::parse(const QByteArray &data) {
+  QHash<QString, QString> res;
+  parse(data.constData(), data.size(), res);
+  return res;
+}
+////////////////////////////////////////////////////////////////////////////
+
+bool
+CYamlSubsetReader::parse_file(const QString &path,
+                              QHash<QString, QString> &out) {
+  QFile file(path);
+  if (!file.open(QIODevice::ReadOnly)) return false;
+  QByteArray data = file.readAll();
+  file.close();
+  parse(data.constData(), data.size(), out);
+  return true;
+}
+////////////////////////////////////////////////////////////////////////////
+
+CVagrantMetadataCache::CVagrantMetadataCache() :
+  m_reads_count(0),
+  m_store_counter(0) {
+}
+////////////////////////////////////////////////////////////////////////////
+
+CVagrantMetadataCache&
+CVagrantMetadataCache::Instance() {
+  static CVagrantMetadataCache inst;
+  return inst;
+}
+////////////////////////////////////////////////////////////////////////////
+
+vagrant_peer_meta_t
+CVagrantMetadataCache::read(const QString &peer_dir) {
+  QString key = QDir::cleanPath(QFileInfo(peer_dir).absoluteFilePath());
+  {
+    QMutexLocker locker(&m_mutex);
+    auto i = m_cache.find(key);
+    if (i != m_cache.end() && i->second.stamp == stamp_of(key, i->second.meta))
+      return i->second.meta;
+  }
+
+  // files may be changed while they are read, such result isn't cached
+  QString before = stamp_of(key, vagrant_peer_meta_t());
+  vagrant_peer_meta_t meta = read_uncached(key);
+  bool stable = before == stamp_of(key, vagrant_peer_meta_t());
+  QString stamp = stamp_of(key, meta);
+
+  QMutexLocker locker(&m_mutex);
+  ++m_reads_count;
+  if (!stable) return meta;
+  if (m_cache.find(key) == m_cache.end() &&
+      (int)m_cache.size() >= MAX_ENTRIES)
+    evict_oldest();
+  entry_t& et = m_cache[key];
+  et.stamp = stamp;
+  et.meta = meta;
+  et.stored = ++m_store_counter;
+  return meta;
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CVagrantMetadataCache::evict_oldest() {
+  auto oldest = m_cache.begin();
+  for (auto i = m_cache.begin(); i != m_cache.end(); ++i) {
+    if (i->second.stored < oldest->second.stored) oldest = i;
+  }
+  if (oldest != m_cache.end()) m_cache.erase(oldest);
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CVagrantMetadataCache::clear() {
+  QMutexLocker locker(&m_mutex);
+  m_cache.clear();
+}
+////////////////////////////////////////////////////////////////////////////
+
+quint64
+CVagrantMetadataCache::reads_count() const {
+  QMutexLocker locker(&m_mutex);
+  return m_reads_count;
+}
+////////////////////////////////////////////////////////////////////////////
+
+vagrant_peer_meta_t
+CVagrantMetadataCache::read_uncached(const QString &peer_dir) {
+  vagrant_peer_meta_t meta;
+  QDir vagrant_dir(peer_dir + "/.vagrant");
+
+  meta.generated_found =
+      CYamlSubsetReader::parse_file(vagrant_dir.absoluteFilePath("generated.yml"), meta.values);
+  if (meta.generated_found) {
+    bool ok = false;
+    int port = meta.values.value("_CONSOLE_PORT").toInt(&ok);
+    meta.console_port = ok ? port : -1;
+    meta.ip_peer = meta.values.value("_IP_PEER");
+    meta.bridge = meta.values.value("_BRIDGE");
+  }
+
+  // vagrant-subutai creates one machine, it is called "default"
+  QDir machines_dir(vagrant_dir.absoluteFilePath("machines"));
+  QStringList machines = machines_dir.entryList(QDir::Dirs | QDir::NoDotAndDotDot, QDir::Name);
+  if (machines.isEmpty()) return meta;
+  meta.machine_name = machines.contains("default") ? QString("default") : machines.first();
+
+  // directory of provider which has created VM contains id of VM
+  QDir machine_dir(machines_dir.absoluteFilePath(meta.machine_name));
+  QStringList providers = machine_dir.entryList(QDir::Dirs | QDir::NoDotAndDotDot, QDir::Name);
+  for (auto i = providers.begin(); i != providers.end(); ++i) {
+    QFile id_file(machine_dir.absoluteFilePath(*i + "/id"));
+    if (!id_file.open(QIODevice::ReadOnly)) continue;
+    meta.provider = *i;
+    meta.machine_id = QString::fromUtf8(id_file.readAll()).trimmed();
+    break;
+  }
+  if (meta.provider.isEmpty() && !providers.isEmpty())
+    meta.provider = providers.first();
+  return meta;
+}
+////////////////////////////////////////////////////////////////////////////
+
+QString
+CVagrantMetadataCache::stamp_of(const QString &peer_dir,
+                                const vagrant_peer_meta_t &meta) {
+  QString res;
+  QFileInfo generated(peer_dir + "/.vagrant/generated.yml");
+  res += generated.exists() ?
+        QString("%1|%2").arg(generated.size()).arg(generated.lastModified().toMSecsSinceEpoch()) :
+        QString("-");
+
+  QStringList dirs;
+  dirs << peer_dir + "/.vagrant/machines";
+  if (!meta.machine_name.isEmpty()) {
+    dirs << dirs.first() + "/" + meta.machine_name;
+    if (!meta.provider.isEmpty())
+      dirs << dirs.last() + "/" + meta.provider;
+  }
+  for (auto i = dirs.begin(); i != dirs.end(); ++i) {
+    QFileInfo fi(*i);
+    res += fi.exists() ? QString("|%1").arg(fi.lastModified().toMSecsSinceEpoch()) :
+                         QString("|-");
+  }
+  return res;
+}
+////////////////////////////////////////////////////////////////////////////
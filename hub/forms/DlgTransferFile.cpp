@@ -3,6 +3,9 @@
 #include "QFileDialog"
 #include "NotificationObserver.h"
 #include "DlgCreateFolder.h"
+#include "SftpTransfer.h"
+#include "LibsshController.h"
+#include "SettingsManager.h"
 #include <QDateTime>
 #include <QFuture>
 #include <QtConcurrent/QtConcurrent>
@@ -16,8 +19,11 @@
 
 DlgTransferFile::DlgTransferFile(QWidget *parent) :
   QDialog(parent),
-  ui(new Ui::DlgTransferFile) {
+  ui(new Ui::DlgTransferFile),
+  m_scheduler(CTransferScheduler::Instance()),
+  m_listing(std::make_shared<remote_listing_t>()) {
   qInfo () <<"Open new upload dialog";
+  m_scheduler->set_max_workers((int)CSettingsManager::Instance().transfer_parallel_count());
   ui->setupUi(this);
   Init();
 }
@@ -143,6 +149,15 @@ void DlgTransferFile::Init() {
   connect(ui->remote_file_system, &FileSystemTableWidget::something_is_dropped,
           this, &DlgTransferFile::remote_file_system_drop);
 
+  connect(m_scheduler, &CTransferScheduler::job_started,
+          this, &DlgTransferFile::job_started);
+
+  connect(m_scheduler, &CTransferScheduler::job_progress,
+          this, &DlgTransferFile::job_progress);
+
+  connect(m_scheduler, &CTransferScheduler::job_finished,
+          this, &DlgTransferFile::job_finished);
+
 
   QStringList file_system_header {
     "Name", "Size", "Modified", "File Path"
@@ -258,11 +273,13 @@ void DlgTransferFile::transfer_finished(int tw_row, system_call_wrapper_error_t
 
   bool remote_changed = false;
   bool local_changed = false;
+  QString throughput = file_to_transfer.throughput() == 0 ? QString() :
+      QString(" (%1/s)").arg(size_to_str(file_to_transfer.throughput()));
 
   if (file_to_transfer.currentFileStatus() == FILE_TO_UPLOAD || file_to_transfer.currentFileStatus() == FIlE_FAILED_TO_UPLOAD) {
     if (res == SCWE_SUCCESS) {
       file_to_transfer.setTransferFileStatus(FILE_FINISHED_UPLOAD);
-      twi_operation_status->setText("Uploaded successfully");
+      twi_operation_status->setText("Uploaded successfully" + throughput);
       twi_operation_status->setIcon(transfer_finished_icon);
       twi_operation_status->setToolTip("");
       remote_changed = true;
@@ -283,7 +300,7 @@ void DlgTransferFile::transfer_finished(int tw_row, system_call_wrapper_error_t
   } else if(file_to_transfer.currentFileStatus() == FILE_TO_DOWNLOAD || file_to_transfer.currentFileStatus() == FILE_FAILED_TO_DOWNLOAD){
     if (res == SCWE_SUCCESS) {
       file_to_transfer.setTransferFileStatus(FILE_FINISHED_DOWNLOAD);
-      twi_operation_status->setText("Downloaded successfully");
+      twi_operation_status->setText("Downloaded successfully" + throughput);
       twi_operation_status->setIcon(transfer_finished_icon);
       twi_operation_status->setToolTip("");
       local_changed = true;
@@ -354,93 +371,155 @@ void DlgTransferFile::transfer_finished(int tw_row, system_call_wrapper_error_t
   }
 }
 
-void DlgTransferFile::transfer_file(int tw_row) {
+void DlgTransferFile::transfer_progress(int tw_row, quint64 done, quint64 total, quint64 bytes_per_sec) {
+  if (tw_row < 0 || tw_row >= (int)files_to_transfer.size())
+    return;
+  QTableWidgetItem *twi_operation_status = ui->tw_transfer_file->item(tw_row, 4);
+  if (twi_operation_status == nullptr)
+    return;
+
+  FileToTransfer &file_to_transfer = files_to_transfer[tw_row];
+  file_to_transfer.setProgress(done, bytes_per_sec);
+  bool upload = file_to_transfer.currentFileStatus() == FILE_TO_UPLOAD ||
+                file_to_transfer.currentFileStatus() == FIlE_FAILED_TO_UPLOAD;
+  int percent = total == 0 ? 100 : (int)(done * 100 / total);
+  twi_operation_status->setText(QString("%1 %2% (%3/s)")
+                                .arg(upload ? "Uploading" : "Downloading")
+                                .arg(percent)
+                                .arg(size_to_str(bytes_per_sec)));
+}
+
+QString DlgTransferFile::size_to_str(quint64 bytes) {
+  static const char* units[] = {"B", "KB", "MB", "GB", "TB"};
+  double size = (double)bytes;
+  size_t unit = 0;
+  while (size >= 1024.0 && unit + 1 < sizeof(units) / sizeof(units[0])) {
+    size /= 1024.0;
+    ++unit;
+  }
+  return QString("%1 %2").arg(size, 0, 'f', unit == 0 ? 0 : 1).arg(units[unit]);
+}
+
+void DlgTransferFile::transfer_file(int tw_row, int priority) {
   if (tw_row < 0 || tw_row >= (int)files_to_transfer.size())
     return;
 
-  FileToTransfer file_to_transfer = files_to_transfer[tw_row];
+  FileToTransfer &file_to_transfer = files_to_transfer[tw_row];
   QTableWidgetItem *twi_operation_status = ui->tw_transfer_file->item(tw_row, 4);
 
+  // queued file only moves forward
+  if (file_to_transfer.jobId() != 0) {
+    m_scheduler->set_priority(file_to_transfer.jobId(), priority);
+    return;
+  }
+
   static QIcon waiting_icon(":/hub/uploading.png");
 
   QString remote_user = ui->remote_user->text();
   QString remote_ip = ui->remote_ip->text();
   QString remote_port = ui->remote_port->text();
-  QString transfer_file_path = file_to_transfer.fileInfo().filePath();
+  // upload and download get real paths, scp fallback fixes drive letters itself
+  QString source_file_path = file_to_transfer.fileInfo().filePath();
+  QString transfer_file_path = source_file_path;
   QString destination_file_path = file_to_transfer.destinationPath();
   QString key = ui->remote_ssh_key_path->text();
+  QString container = remote_ip + ":" + remote_port;
 
   if(transfer_file_path[1] == ":"){ //correct me for windows :D
     transfer_file_path.remove(0,2);
     transfer_file_path.insert(0,QString("\\."));
   }
-  if(destination_file_path[1] == ":"){ //correct me for windows :D
-      destination_file_path.remove(0,2);
-      destination_file_path.insert(0,QString("\\."));
-  }
 
   twi_operation_status->setIcon(waiting_icon);
+  twi_operation_status->setText("Queued");
+  file_to_transfer.setProgress(0, 0);
 
+  CTransferScheduler::job_id_t job_id = 0;
   if (file_to_transfer.currentFileStatus() == FILE_TO_UPLOAD ||
       file_to_transfer.currentFileStatus() == FIlE_FAILED_TO_UPLOAD) {
-    twi_operation_status->setText("Uploading");
-  } else if (file_to_transfer.currentFileStatus() == FILE_TO_DOWNLOAD ||
-             file_to_transfer.currentFileStatus() == FILE_FAILED_TO_DOWNLOAD) {
-    twi_operation_status->setText("Downloading");
-  } else {
-    twi_operation_status->setText("Removing");
-  }
-  QFutureWatcher<system_call_wrapper_error_t> *watcher = new QFutureWatcher<system_call_wrapper_error_t>(this);
-  QFuture<system_call_wrapper_error_t> res;
-  watcher->setFuture(res);
-
-  if (file_to_transfer.currentFileStatus() == FILE_TO_UPLOAD ||
-      file_to_transfer.currentFileStatus() == FIlE_FAILED_TO_UPLOAD) {
-    FileThreadUploader *file_thread_uploader =
-        new FileThreadUploader(this);
-    file_thread_uploader->init(remote_user, remote_ip, remote_port, transfer_file_path,
-                               destination_file_path, key);
-    file_thread_uploader->startWork();
-    connect(file_thread_uploader, &FileThreadUploader::outputReceived,
-            [tw_row, this](system_call_wrapper_error_t res, QStringList output){
-      this->transfer_finished(tw_row, res, output);
+    quint64 size = file_to_transfer.fileInfo().fileType() == FILE_TYPE_DIRECTORY ?
+          CTransferScheduler::MAX_BATCH_SIZE : file_to_transfer.fileInfo().fileSize();
+    job_id = m_scheduler->enqueue(container, size, priority,
+      [remote_user, remote_ip, remote_port, key, source_file_path, destination_file_path]
+      (CTransferScheduler::progress_t progress, const QAtomicInt* cancel) {
+      return CSystemCallWrapper::upload_file(
+            remote_user, remote_ip, std::make_pair(remote_port, key),
+            destination_file_path, source_file_path, progress, cancel);
     });
   } else if (file_to_transfer.currentFileStatus() == FILE_TO_DOWNLOAD ||
              file_to_transfer.currentFileStatus() == FILE_FAILED_TO_DOWNLOAD) {
-    FileThreadDownloader *file_thread_uploader =
-        new FileThreadDownloader(this);
-    file_thread_uploader->init(remote_user, remote_ip, remote_port,
-                               transfer_file_path,
-                               destination_file_path, key);
-    file_thread_uploader->startWork();
-    connect(file_thread_uploader, &FileThreadDownloader::outputReceived,
-            [tw_row, this](system_call_wrapper_error_t res, QStringList output){
-      this->transfer_finished(tw_row, res, output);
+    quint64 size = file_to_transfer.fileInfo().fileType() == FILE_TYPE_DIRECTORY ?
+          CTransferScheduler::MAX_BATCH_SIZE : file_to_transfer.fileInfo().fileSize();
+    job_id = m_scheduler->enqueue(container, size, priority,
+      [remote_user, remote_ip, remote_port, key, source_file_path, destination_file_path]
+      (CTransferScheduler::progress_t progress, const QAtomicInt* cancel) {
+      return CSystemCallWrapper::download_file(
+            remote_user, remote_ip, std::make_pair(remote_port, key),
+            destination_file_path, source_file_path, progress, cancel);
     });
   } else if (file_to_transfer.currentFileStatus() == FILE_TO_REMOVE_REMOTE ||
              file_to_transfer.currentFileStatus() == FILE_FAILED_TO_REMOVE_REMOTE) {
-    RemoteCommandExecutor *remote_command_executor =
-        new RemoteCommandExecutor(this);
-
     QString command = "rm -rf '" + transfer_file_path + "'";
-
-    remote_command_executor->init(remote_user, remote_ip, remote_port, command, key);
-    connect(remote_command_executor, &RemoteCommandExecutor::outputReceived,
-            [tw_row, this] (system_call_wrapper_error_t res, QStringList output) {
-      this->transfer_finished(tw_row, res, output);
+    job_id = m_scheduler->enqueue(container, 0, priority,
+      [remote_user, remote_ip, remote_port, command, key]
+      (CTransferScheduler::progress_t, const QAtomicInt*) {
+      return CSystemCallWrapper::send_command(remote_user, remote_ip, remote_port, command, key);
     });
-    remote_command_executor->startWork();
   } else if (file_to_transfer.currentFileStatus() == FILE_TO_REMOVE_LOCAL ||
              file_to_transfer.currentFileStatus() == FILE_FAILED_TO_REMOVE_LOCAL) {
-    LocalFileRemover *local_file_remover =
-        new LocalFileRemover(this);
-    local_file_remover->init(transfer_file_path);
-    connect(local_file_remover, &LocalFileRemover::outputReceived,
-            [tw_row, this] (system_call_wrapper_error_t res, QStringList output) {
-      this->transfer_finished(tw_row, res, output);
+    job_id = m_scheduler->enqueue("local", 0, priority,
+      [transfer_file_path](CTransferScheduler::progress_t, const QAtomicInt*) {
+      return CSystemCallWrapper::remove_file(transfer_file_path);
     });
-    local_file_remover->startWork();
   }
+  // signals of scheduler come through event loop, so row has id before them
+  file_to_transfer.setJobId(job_id);
+}
+
+int DlgTransferFile::row_of_job(quint64 job_id) const {
+  for (int row = 0 ; row < (int)files_to_transfer.size() ; row ++) {
+    if (files_to_transfer[row].jobId() == job_id)
+      return row;
+  }
+  return -1;
+}
+
+void DlgTransferFile::job_started(quint64 job_id) {
+  int tw_row = row_of_job(job_id);
+  if (tw_row < 0)
+    return;
+  QTableWidgetItem *twi_operation_status = ui->tw_transfer_file->item(tw_row, 4);
+  if (twi_operation_status == nullptr)
+    return;
+
+  TRANSFER_FILE_STATUS status = files_to_transfer[tw_row].currentFileStatus();
+  if (status == FILE_TO_UPLOAD || status == FIlE_FAILED_TO_UPLOAD) {
+    twi_operation_status->setText("Uploading");
+  } else if (status == FILE_TO_DOWNLOAD || status == FILE_FAILED_TO_DOWNLOAD) {
+    twi_operation_status->setText("Downloading");
+  } else {
+    twi_operation_status->setText("Removing");
+  }
+}
+
+void DlgTransferFile::job_progress(quint64 job_id, quint64 done, quint64 total, quint64 bytes_per_sec) {
+  int tw_row = row_of_job(job_id);
+  if (tw_row >= 0)
+    transfer_progress(tw_row, done, total, bytes_per_sec);
+}
+
+void DlgTransferFile::job_finished(quint64 job_id, int res, QStringList output) {
+  int tw_row = row_of_job(job_id);
+  if (tw_row < 0)
+    return;
+  files_to_transfer[tw_row].setJobId(0);
+  if (res == SCWE_CANCELLED) {
+    QTableWidgetItem *twi_operation_status = ui->tw_transfer_file->item(tw_row, 4);
+    if (twi_operation_status != nullptr)
+      twi_operation_status->setText("Cancelled");
+    return;
+  }
+  transfer_finished(tw_row, (system_call_wrapper_error_t)res, output);
 }
 
 void DlgTransferFile::start_transfer_files() {
@@ -455,8 +534,9 @@ void DlgTransferFile::start_transfer_files() {
     }
   }
   else {
+    // selected files go before others
     for (QTableWidgetSelectionRange table_range : ui->tw_transfer_file->selectedRanges()) {
-      for (int row = table_range.bottomRow() ; row >= table_range.topRow() ; row --) {
+      for (int row = table_range.topRow() ; row <= table_range.bottomRow() ; row ++) {
         if (files_to_transfer[row].currentFileStatus() == FILE_FINISHED_DOWNLOAD ||
             files_to_transfer[row].currentFileStatus() == FILE_FINISHED_UPLOAD ||
             files_to_transfer[row].currentFileStatus() == FILE_FINISHED_REMOVE)
@@ -469,7 +549,7 @@ void DlgTransferFile::start_transfer_files() {
           files_to_transfer[row].setTransferFileStatus(FILE_FAILED_TO_REMOVE_LOCAL);
         if (files_to_transfer[row].currentFileStatus() == FILE_FAILED_TO_REMOVE_REMOTE)
           files_to_transfer[row].setTransferFileStatus(FILE_FAILED_TO_REMOVE_REMOTE);
-        transfer_file(row);
+        transfer_file(row, CTransferScheduler::TP_HIGH);
       }
     }
   }
@@ -480,12 +560,15 @@ void DlgTransferFile::clear_files() {
   set_buttons_enabled(false);
   if (ui->tw_transfer_file->selectedRanges().isEmpty())
   {
+    cancel_jobs();
     ui->tw_transfer_file->setRowCount(0);
     files_to_transfer.clear();
   }
   else{
     for (QTableWidgetSelectionRange table_range : ui->tw_transfer_file->selectedRanges()) {
       for (int row = table_range.bottomRow() ; row >= table_range.topRow() ; row --) {
+        if (files_to_transfer[row].jobId() != 0)
+          m_scheduler->cancel(files_to_transfer[row].jobId());
         ui->tw_transfer_file->removeRow(row);
         files_to_transfer.erase(files_to_transfer.begin() + row);
       }
@@ -494,6 +577,14 @@ void DlgTransferFile::clear_files() {
   set_buttons_enabled(true);
 }
 
+void DlgTransferFile::cancel_jobs() {
+  // scheduler is shared, jobs of other dialogs go on
+  for (const FileToTransfer &file : files_to_transfer) {
+    if (file.jobId() != 0)
+      m_scheduler->cancel(file.jobId());
+  }
+}
+
 QString DlgTransferFile::parseDate(const QString &month, const QString &day, const QString &year_or_time) {
   QString result;
 
@@ -809,6 +900,23 @@ void DlgTransferFile::add_file_remote(const QString &file_info) {
   remote_files.push_back(remote_file);
 }
 
+void DlgTransferFile::add_file_remote(const sftp_entry_t &entry) {
+  // directories end with '/', like ls -F shows them
+  QString file_name = entry.dir ? entry.name + "/" : entry.name;
+  OneFile remote_file(file_name,
+                      current_remote_dir + file_name,
+                      QDateTime::fromTime_t((uint)entry.mtime),
+                      entry.size,
+                      entry.dir ? FILE_TYPE_DIRECTORY : FILE_TYPE_SIMPLE);
+
+  add_file_to_file_system_tw(
+           ui->remote_file_system,
+           ui->remote_file_system->rowCount(),
+           remote_file);
+
+  remote_files.push_back(remote_file);
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 
 void DlgTransferFile::remove_selected_local() {
@@ -914,7 +1022,7 @@ void DlgTransferFile::create_folder_remote() {
           CNotificationObserver::Info(
                 tr("Successfully created new folder with name \"%1\" in \"%2\", remote system.")
                 .arg(name, current_remote_dir), DlgNotification::N_NO_ACTION);
-          this->refresh_remote_file_system();
+          this->refresh_remote_file_system(true);
         } else {
           CNotificationObserver::Error(
                 tr("Failed to create new folder with name \"%1\" in \"%2\", remote system.\n"
@@ -942,7 +1050,7 @@ void DlgTransferFile::refresh_button_local() {
 }
 
 void DlgTransferFile::refresh_button_remote() {
-  refresh_remote_file_system();
+  refresh_remote_file_system(true);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -962,21 +1070,112 @@ void DlgTransferFile::refresh_local_file_system() {
   ui->lbl_local_files->setText("Local");
 }
 
-void DlgTransferFile::refresh_remote_file_system() {
-  static QMutex mutex;
-  QMutexLocker lock(&mutex);
+ssh_endpoint_t DlgTransferFile::remote_endpoint() const {
+  ssh_endpoint_t endpoint;
+  endpoint.host = ui->remote_ip->text();
+  endpoint.port = ui->remote_port->text().isEmpty() ? 22 : ui->remote_port->text().toUShort();
+  endpoint.user = ui->remote_user->text();
+  endpoint.private_key = ui->remote_ssh_key_path->text();
+  return endpoint;
+}
 
+void DlgTransferFile::refresh_remote_file_system(bool force) {
   qDebug()
           << "Refresh remote file system"
           << current_remote_dir;
 
   ui->lbl_remote_files->setMovie(remote_movie);
-  refresh_queries++;
   remote_movie->start();
   set_buttons_enabled(false);
 
   ui->le_remote->setText(current_remote_dir);
+  ui->remote_file_system->setRowCount(0);
+  remote_files.clear();
+
+  ssh_endpoint_t endpoint = remote_endpoint();
+  QString remote_dir = current_remote_dir;
+  if (force)
+    CSftpBrowser::invalidate(endpoint, remote_dir);
 
+  std::shared_ptr<remote_listing_t> listing = m_listing;
+  int listing_id;
+  {
+    // pages of previous directory aren't shown anymore
+    QMutexLocker locker(&listing->mutex);
+    listing_id = ++listing->id;
+    listing->page.clear();
+  }
+
+  // listing stops when user goes to other directory or dialog is closed.
+  // Dialog is touched only while it isn't closed, under mutex of listing
+  QtConcurrent::run([this, listing, endpoint, remote_dir, listing_id]() {
+    int rc = CSftpBrowser::list(endpoint, remote_dir,
+                                [this, listing, listing_id](const std::vector<sftp_entry_t>& page) {
+      QMutexLocker locker(&listing->mutex);
+      if (listing->closed || listing->id != listing_id)
+        return false;
+      listing->page.insert(listing->page.end(), page.begin(), page.end());
+      QMetaObject::invokeMethod(this, "remote_page_received", Qt::QueuedConnection,
+                                Q_ARG(int, listing_id));
+      return true;
+    }, CSftpBrowser::PAGE_SIZE, [listing, listing_id]() {
+      QMutexLocker locker(&listing->mutex);
+      return listing->closed || listing->id != listing_id;
+    });
+    QMutexLocker locker(&listing->mutex);
+    if (!listing->closed)
+      QMetaObject::invokeMethod(this, "remote_listing_finished", Qt::QueuedConnection,
+                                Q_ARG(int, listing_id), Q_ARG(int, rc));
+  });
+}
+
+void DlgTransferFile::remote_page_received(int listing_id) {
+  std::vector<sftp_entry_t> page;
+  {
+    QMutexLocker locker(&m_listing->mutex);
+    if (m_listing->id != listing_id)
+      return;
+    page.swap(m_listing->page);
+  }
+  if (page.empty())
+    return;
+
+  ui->remote_file_system->setUpdatesEnabled(false);
+  for (const sftp_entry_t &entry : page)
+    add_file_remote(entry);
+  ui->remote_file_system->setUpdatesEnabled(true);
+}
+
+void DlgTransferFile::remote_listing_finished(int listing_id, int rc) {
+  {
+    QMutexLocker locker(&m_listing->mutex);
+    if (m_listing->id != listing_id)
+      return;
+  }
+  // only this listing falls back, next one tries sftp again
+  if (CSftpBrowser::is_connection_error(rc)) {
+    qInfo() << "sftp can't be used to list" << current_remote_dir << ", trying ls";
+    refresh_remote_file_system_ls();
+    return;
+  }
+
+  remote_movie->stop();
+  set_buttons_enabled(true);
+  if (rc == RLE_SUCCESS) {
+    ui->lbl_remote_files->setStyleSheet("");
+    ui->lbl_remote_files->setText("Remote");
+  }
+  else {
+    ui->lbl_remote_files->setStyleSheet(" QLabel {color : red;} ");
+    ui->lbl_remote_files->setText("Failed to refresh remote directory.");
+  }
+}
+
+void DlgTransferFile::refresh_remote_file_system_ls() {
+  static QMutex mutex;
+  QMutexLocker lock(&mutex);
+
+  refresh_queries++;
   QString remote_user = ui->remote_user->text();
   QString remote_port = ui->remote_port->text();
   QString remote_ip = ui->remote_ip->text();
@@ -1057,5 +1256,14 @@ void DlgTransferFile::parse_remote_file(const QString &file_info, QStringList &s
 
 DlgTransferFile::~DlgTransferFile()
 {
+  {
+    // listing task stops on its own, it isn't waited for
+    QMutexLocker locker(&m_listing->mutex);
+    m_listing->closed = true;
+  }
+  // running transfers are cancelled and return in pool of scheduler
+  cancel_jobs();
+  CSftpTransfer::close_sessions(ui->remote_ip->text());
+  CSftpBrowser::close_sessions(ui->remote_ip->text());
   delete ui;
 }
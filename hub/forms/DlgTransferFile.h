@@ -13,129 +13,17 @@
 #include <QFileSystemModel>
 #include <QTableWidget>
 #include <deque>
+#include <memory>
 #include <QMovie>
 #include <QMutex>
+#include "TransferScheduler.h"
+#include "SftpBrowser.h"
 
 
 namespace Ui {
   class DlgTransferFile;
 }
 
-class FileThreadDownloader : public QObject{
-  Q_OBJECT
-  QString remote_user, remote_ip, remote_port, key;
-  QString file_path, file_desination;
-
-public:
-  FileThreadDownloader(QObject *parent = nullptr) : QObject (parent)
-  {
-
-  }
-  void init (const QString &remote_user,
-             const QString &remote_ip,
-             const QString &remote_port,
-             const QString &file_path,
-             const QString &file_destination,
-             const QString &key) {
-    this->remote_user = remote_user;
-    this->remote_ip = remote_ip;
-    this->remote_port = remote_port;
-    this->file_path = file_path;
-    this->file_desination = file_destination;
-    this->key = key;
-  }
-
-  void startWork() {
-    QThread* thread = new QThread();
-    connect(thread, &QThread::started,
-            this, &FileThreadDownloader::execute_remote_command);
-    connect(this, &FileThreadDownloader::outputReceived,
-            thread, &QThread::quit);
-    connect(thread, &QThread::finished,
-            this, &FileThreadDownloader::deleteLater);
-    connect(thread, &QThread::finished,
-            thread, &QThread::deleteLater);
-    this->moveToThread(thread);
-    thread->start();
-  }
-
-
-  void execute_remote_command() {
-    //QStringList output;
-    QFutureWatcher< std::pair<system_call_wrapper_error_t, QStringList> > *watcher
-        = new QFutureWatcher<std::pair<system_call_wrapper_error_t, QStringList>>(this);
-
-    QFuture< std::pair<system_call_wrapper_error_t, QStringList> >  res =
-        QtConcurrent::run(CSystemCallWrapper::download_file,
-                          remote_user, remote_ip, std::make_pair(remote_port, key), file_desination, file_path);
-    watcher->setFuture(res);
-    connect(watcher, &QFutureWatcher<std::pair<system_call_wrapper_error_t, QStringList> >::finished, [this, res](){
-      emit this->outputReceived(res.result().first, res.result().second);
-    });
-  }
-
-signals:
-  void outputReceived(system_call_wrapper_error_t res, QStringList output);
-};
-
-
-class FileThreadUploader : public QObject{
-  Q_OBJECT
-  QString remote_user, remote_ip, remote_port, key;
-  QString file_path, file_desination;
-
-public:
-  FileThreadUploader(QObject *parent = nullptr) : QObject (parent)
-  {
-
-  }
-  void init (const QString &remote_user,
-             const QString &remote_ip,
-             const QString &remote_port,
-             const QString &file_path,
-             const QString &file_destination,
-             const QString &key) {
-    this->remote_user = remote_user;
-    this->remote_ip = remote_ip;
-    this->remote_port = remote_port;
-    this->file_path = file_path;
-    this->file_desination = file_destination;
-    this->key = key;
-  }
-
-  void startWork() {
-    QThread* thread = new QThread();
-    connect(thread, &QThread::started,
-            this, &FileThreadUploader::execute_remote_command);
-    connect(this, &FileThreadUploader::outputReceived,
-            thread, &QThread::quit);
-    connect(thread, &QThread::finished,
-            this, &FileThreadUploader::deleteLater);
-    connect(thread, &QThread::finished,
-            thread, &QThread::deleteLater);
-    this->moveToThread(thread);
-    thread->start();
-  }
-
-
-  void execute_remote_command() {
-    //QStringList output;
-    QFutureWatcher<std::pair<system_call_wrapper_error_t, QStringList> > *watcher
-        = new QFutureWatcher<std::pair<system_call_wrapper_error_t, QStringList> >(this);
-
-    QFuture<std::pair<system_call_wrapper_error_t, QStringList> >  res =
-        QtConcurrent::run(CSystemCallWrapper::upload_file,
-                          remote_user, remote_ip, std::make_pair(remote_port, key), file_desination, file_path);
-    watcher->setFuture(res);
-    connect(watcher, &QFutureWatcher<system_call_wrapper_error_t>::finished, [this, res](){
-      emit this->outputReceived(res.result().first, res.result().second);
-    });
-  }
-
-signals:
-  void outputReceived(system_call_wrapper_error_t res, QStringList output);
-};
-
 /////////////////////////////////////////////////////////////////////////////////////////////////////
 
 class RemoteCommandExecutor : public QObject{
@@ -193,48 +81,6 @@ signals:
   void outputReceived(system_call_wrapper_error_t res, const QStringList &output);
 };
 
-class LocalFileRemover : public QObject{
-  Q_OBJECT
-  QString file_path;
-
-public:
-  LocalFileRemover(QObject *parent = nullptr) : QObject (parent) {}
-  void init (const QString &file_path) {
-    this->file_path = file_path;
-  }
-
-  void startWork() {
-    QThread* thread = new QThread();
-    connect(thread, &QThread::started,
-            this, &LocalFileRemover::execute_local_remove);
-    connect(this, &LocalFileRemover::outputReceived,
-            thread, &QThread::quit);
-    connect(thread, &QThread::finished,
-            this, &RemoteCommandExecutor::deleteLater);
-    connect(thread, &QThread::finished,
-            thread, &QThread::deleteLater);
-    this->moveToThread(thread);
-    thread->start();
-  }
-
-
-  void execute_local_remove() {
-    //QStringList output;
-    QFutureWatcher<std::pair<system_call_wrapper_error_t, QStringList>> *watcher
-        = new QFutureWatcher<std::pair<system_call_wrapper_error_t,QStringList> >(this);
-
-    QFuture<std::pair<system_call_wrapper_error_t, QStringList> >  res =
-        QtConcurrent::run(CSystemCallWrapper::remove_file, file_path);
-    watcher->setFuture(res);
-    connect(watcher, &QFutureWatcher<std::pair<system_call_wrapper_error_t, QStringList>>::finished, [this, res](){
-      emit this->outputReceived(res.result().first, res.result().second);
-    });
-  }
-
-signals:
-  void outputReceived(system_call_wrapper_error_t res, const QStringList &output);
-};
-
 enum FILE_TYPE {
   FILE_TYPE_SIMPLE = 0,
   FILE_TYPE_DIRECTORY,
@@ -318,8 +164,19 @@ private:
   QString m_destinationPath;
   MACHINE_TYPE m_sourceMachineType;
   TRANSFER_FILE_STATUS m_fileStatus;
+  quint64 m_transferred;
+  quint64 m_throughput;
+  quint64 m_jobId;
 
 public:
+  FileToTransfer() :
+    m_sourceMachineType(MACHINE_UNKNOWN),
+    m_fileStatus(FILE_WITHOUT_OPERATION),
+    m_transferred(0),
+    m_throughput(0),
+    m_jobId(0) {
+  }
+
   const OneFile &fileInfo () const {
     return m_fileInfo;
   }
@@ -348,6 +205,26 @@ public:
     m_fileStatus = fileStatus;
   }
 
+  quint64 transferred() const {
+    return m_transferred;
+  }
+  /* average bytes per second of last transfer */
+  quint64 throughput() const {
+    return m_throughput;
+  }
+  void setProgress(quint64 transferred, quint64 throughput) {
+    m_transferred = transferred;
+    m_throughput = throughput;
+  }
+
+  /* job of transfer scheduler, 0 if file isn't queued or transferred now */
+  quint64 jobId() const {
+    return m_jobId;
+  }
+  void setJobId(quint64 jobId) {
+    m_jobId = jobId;
+  }
+
 };
 
 #include "NotificationObserver.h"
@@ -434,6 +311,17 @@ private:
   std::deque <FileToTransfer> files_to_transfer;
   QDir current_local_dir;
   QString current_remote_dir;
+  // shared by all dialogs, jobs of this one are ids in files_to_transfer
+  CTransferScheduler *m_scheduler;
+  /* state of remote listing shared with its task, task may outlive dialog */
+  struct remote_listing_t {
+    QMutex mutex;
+    int id;        // only this listing gives pages, other ones stop
+    bool closed;   // dialog is destroyed, nobody is notified
+    std::vector<sftp_entry_t> page;
+    remote_listing_t() : id(0), closed(false) {}
+  };
+  std::shared_ptr<remote_listing_t> m_listing;
 
   Ui::DlgTransferFile *ui;
 
@@ -445,9 +333,14 @@ private:
 
   void add_file_local(const QFileInfo &fi);
   void add_file_remote(const QString &file_info);
+  void add_file_remote(const sftp_entry_t &entry);
 
+  ssh_endpoint_t remote_endpoint() const;
   void refresh_local_file_system();
-  void refresh_remote_file_system();
+  /* force - don't take listing from cache */
+  void refresh_remote_file_system(bool force = false);
+  /* for keys libssh2 can't read */
+  void refresh_remote_file_system_ls();
 
   void file_to_upload();
   void file_to_download();
@@ -473,9 +366,16 @@ private:
   void set_buttons_enabled(bool enabled);
   void set_remote_button_enabled(bool enabled);
   void transfer_finished(int tw_row, system_call_wrapper_error_t res, QStringList output);
-  void transfer_file(int tw_row);
+  void transfer_progress(int tw_row, quint64 done, quint64 total, quint64 bytes_per_sec);
+  static QString size_to_str(quint64 bytes);
+  void transfer_file(int tw_row, int priority = CTransferScheduler::TP_NORMAL);
+  int row_of_job(quint64 job_id) const;
+  void job_started(quint64 job_id);
+  void job_progress(quint64 job_id, quint64 done, quint64 total, quint64 bytes_per_sec);
+  void job_finished(quint64 job_id, int res, QStringList output);
   void start_transfer_files();
   void clear_files();
+  void cancel_jobs();
   void design_table_widget(QTableWidget *tw, const QStringList &headers);
   void add_file_to_file_system_tw(QTableWidget *file_system_tw, int row, const OneFile &file);
   void file_transfer_field_add_file(const FileToTransfer &file, bool instant_transfer);
@@ -490,6 +390,10 @@ private:
   void remote_cell_pressed(int row, int column);
   void local_file_system_drop();
   void remote_file_system_drop();
+
+private slots:
+  void remote_page_received(int listing_id);
+  void remote_listing_finished(int listing_id, int rc);
 };
 
 #endif // DLGTRANSFERFILE_H
@@ -0,0 +1,55 @@
+#ifndef BOUNDEDTASKRUNNER_H
+#define BOUNDEDTASKRUNNER_H
+
+#include <functional>
+#include <vector>
+#include <QAtomicInt>
+#include <QThreadPool>
+
+/**
+ * @brief The CBoundedTaskRunner class runs independent blocking tasks
+ * (version probes, metadata downloads, update checks) on own thread pool,
+ * not more than max_workers at once. Task reports its result itself
+ * (usually with signal, which is queued to receiver's thread), so results
+ * are streamed as soon as every task is done and not after the slowest one.
+ * @code {.cpp}
+ * runner.add([this]() { emit got_version(probe_version()); });
+ * runner.run(); // blocks until all added tasks are done
+ * @endcode
+ * Pool of runner belongs to thread which creates runner, so runner is
+ * created, run and destroyed in one thread, only abort() may be called
+ * from others.
+ */
+class CBoundedTaskRunner {
+public:
+  static const int DEFAULT_MAX_WORKERS = 4;
+
+  typedef std::function<void()> task_t;
+
+  explicit CBoundedTaskRunner(int max_workers = DEFAULT_MAX_WORKERS);
+  /* waits for running tasks */
+  ~CBoundedTaskRunner();
+
+  void add(task_t task);
+  /**
+   * @brief runs all added tasks and blocks until they are finished.
+   * Exceptions thrown by task are logged and don't affect other tasks.
+   * List of tasks and abort flag are cleared, so runner may be reused.
+   * @return false if run was aborted
+   */
+  bool run();
+  /* tasks of current run (or of next one, if none is running) which
+   * aren't started yet are skipped. Thread safe */
+  void abort();
+  bool aborted() const {return m_aborted.load() != 0;}
+
+  int max_workers() const {return m_pool.maxThreadCount();}
+  int count() const {return (int)m_tasks.size();}
+
+private:
+  QThreadPool m_pool;
+  std::vector<task_t> m_tasks;
+  QAtomicInt m_aborted;
+};
+
+#endif // BOUNDEDTASKRUNNER_H
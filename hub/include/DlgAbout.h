@@ -9,18 +9,38 @@
 #include <QCheckBox>
 #include <QLabel>
 #include <QThread>
+#include <QAtomicInt>
+#include <QMutex>
+
+#include "BoundedTaskRunner.h"
+
+class CRestWorker;
 
 namespace Ui {
   class DlgAbout;
 }
 
+/*!
+ * \brief Collects versions of components and checks their updates.
+ * Probes are independent and slow (every one runs external process or
+ * downloads metadata), so they are run in parallel by CBoundedTaskRunner
+ * and every result is emitted as soon as it's known.
+ */
 class DlgAboutInitializer : public QObject {
   Q_OBJECT
 public:
-    DlgAboutInitializer(QObject *parent = nullptr) :  QObject(parent){}
+    DlgAboutInitializer(QObject *parent = nullptr) :
+      QObject(parent),
+      m_runner(nullptr),
+      m_progress(0),
+      m_aborted(0) {}
   static const int COMPONENTS_COUNT = 24;
+  /* external processes are heavy, so don't run too many of them at once */
+  static const int MAX_PARALLEL_PROBES = 4;
 public:
+  /* finished is emitted at the end, aborted or not */
   void do_initialization();
+  /* skips probes which aren't started yet. Thread safe */
   void abort();
   void startWork() {
         QThread* th = new QThread();
@@ -35,6 +55,19 @@ public:
         this->moveToThread(th);
         th->start();
   }
+private:
+  // created and destroyed by do_initialization in worker thread
+  QMutex m_runner_mutex;
+  CBoundedTaskRunner* m_runner;
+  QAtomicInt m_progress;
+  QAtomicInt m_aborted;
+
+  void add_meta_download(const QString& file_name,
+                         void (CRestWorker::*set_next_version)(const QString&));
+  void add_version_probe(QString (*probe)(),
+                         void (DlgAboutInitializer::*got_version)(QString));
+  void add_update_check(const QString& component_id);
+  void component_done();
 signals:
   void init_progress(int part, int total);
   void finished();
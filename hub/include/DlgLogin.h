@@ -2,6 +2,7 @@
 #define DLGLOGIN_H
 
 #include <QDialog>
+#include <QPointer>
 
 namespace Ui {
   class DlgLogin;
@@ -17,8 +18,14 @@ private:
   Ui::DlgLogin *ui;
   QAction *m_show_password_action;
   int m_login_count;
+  QPointer<QSplashScreen> m_splash;
 
-  bool login();
+  /* login and user info requests are asynchronous, login_finished and
+   * user_info_received continue in GUI thread when responses come */
+  void login();
+  void login_finished(int http_code, int err_code, int network_err);
+  void user_info_received();
+  void hide_splash();
 
 public:
   explicit DlgLogin(QWidget *parent = 0);
@@ -26,6 +33,7 @@ public:
 
   /*!
    * \brief Run dialog in different modes. When "Remember me" flag checked - it tries to login without dialog.
+   * Doesn't block, login_success is emitted or dialog is shown when login is finished.
    */
   void run_dialog(QSplashScreen *sc);
   void solve_libssl();
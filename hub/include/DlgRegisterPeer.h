@@ -2,6 +2,7 @@
 #define DLGREGISTERPEER_H
 
 #include <QDialog>
+#include <functional>
 namespace Ui {
 class DlgRegisterPeer;
 }
@@ -35,6 +36,25 @@ private:
                       const int &network_error,
                       const QString& body);
 
+    /* result of blocking peer REST call made in worker thread */
+    struct peer_request_result_t {
+        int err_code;
+        int http_code;
+        int network_error;
+        QString token;
+        QString body;
+        peer_request_result_t() : err_code(0), http_code(0), network_error(0) {}
+    };
+    typedef std::function<peer_request_result_t()> peer_request_t;
+    typedef std::function<void(const peer_request_result_t&)> peer_request_finished_t;
+
+    /* runs request out of GUI thread, finished is called in GUI thread
+     * unless dialog was destroyed */
+    void run_peer_request(peer_request_t request,
+                          peer_request_finished_t finished);
+    void registration_finished();
+    void unregistration_finished();
+
 private slots:
     void registerPeer();
     void unregisterPeer();
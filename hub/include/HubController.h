@@ -190,6 +190,11 @@ signals:
       const CHubContainer &cont,
       int result);
 
+  /* fine grained changes of environments list. Emitted on refresh
+   * before environments_updated() and only for environments which were changed */
+  void environment_added(const CEnvironment& env);
+  void environment_changed(const CEnvironment& prev, const CEnvironment& env);
+  void environment_removed(const CEnvironment& env);
   void environments_updated(int);
   void my_peers_updated();
   void balance_updated();
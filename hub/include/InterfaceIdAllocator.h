@@ -0,0 +1,50 @@
+#ifndef INTERFACEIDALLOCATOR_H
+#define INTERFACEIDALLOCATOR_H
+
+#include <vector>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+
+/**
+ * @brief The CInterfaceIdAllocator class gives ids of p2p interfaces
+ * (device is base_interface_name() + id) to swarms. Used ids in [0, capacity)
+ * are kept in bitmap, so lowest free id is found by scanning words and not
+ * by probing every candidate. Ids reported by daemon are bound with bind(),
+ * they may be out of capacity, such ids are remembered but don't take place in bitmap.
+ * All methods are thread safe, so concurrent joins never get the same id.
+ */
+class CInterfaceIdAllocator {
+public:
+  static const int DEFAULT_CAPACITY = 1024;
+
+  explicit CInterfaceIdAllocator(int capacity = DEFAULT_CAPACITY);
+
+  /* id of swarm if it has one, otherwise lowest free id. -1 if all ids are used */
+  int reserve(const QString& hash);
+  /* id reported by daemon for swarm, other swarm holding this id loses it */
+  void bind(const QString& hash, int id);
+  void release(const QString& hash);
+  void clear();
+
+  int id_of(const QString& hash) const;
+  bool is_used(int id) const;
+  int used_count() const;
+  int capacity() const {return m_capacity;}
+
+  /* id is number at the end of interface name, -1 if there is no number */
+  static int parse_id(const QString& interface);
+
+private:
+  mutable QMutex m_mutex;
+  int m_capacity;
+  std::vector<quint64> m_bits;
+  int m_first_free_word;   // words before this one have no free bits
+  QHash<QString, int> m_id_of;
+  QHash<int, QString> m_owner;
+
+  void release_locked(const QString& hash);
+  void set_bit(int id, bool used);
+};
+
+#endif // INTERFACEIDALLOCATOR_H
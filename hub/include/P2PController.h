@@ -10,6 +10,7 @@
 #include "InternalCriticalSection.h"
 #include "Locker.h"
 #include "RestContainers.h"
+#include "SwarmReconciler.h"
 
 using namespace update_system;
 class StatusChecker : public QObject {
@@ -28,31 +29,6 @@ signals:
 Q_DECLARE_INTERFACE(StatusChecker, "StatusChecker")
 
 
-class RHStatusChecker : public StatusChecker
-{
-  Q_OBJECT
-
-public:
-  CEnvironment env;
-  CHubContainer cont;
-  RHStatusChecker(const CEnvironment &_env, const CHubContainer &_cont) : StatusChecker(), env(_env), cont(_cont) {}
-
-private:
-  void run_checker(QThreadPool *pool) {
-
-    QFuture<system_call_wrapper_error_t> res =
-        QtConcurrent::run(pool, CSystemCallWrapper::check_container_state, env.hash(), cont.rh_ip());
-
-    QFutureWatcher<system_call_wrapper_error_t> *watcher
-            = new QFutureWatcher<system_call_wrapper_error_t>(this);
-    connect(watcher, &QFutureWatcher<system_call_wrapper_error_t>::finished,[this, res](){
-        emit this->connection_finished(res.result());
-    });
-    connect(watcher, SIGNAL(finished()), watcher, SLOT(deleteLater()));
-    watcher->setFuture(res);
-  }
-};
-
 class SwarmConnector : public StatusChecker
 {
   Q_OBJECT
@@ -116,22 +92,15 @@ public:
  static SynchroPrimitives::CriticalSection m_env_critical;
 
 public slots:
+ /* starts to follow state of p2p daemon */
+ void start();
  void update_status();
 
 private:
  QThreadPool *m_pool;
  std::set< std::pair<QString, QString> > connected_conts; // Connected container. Pair of environment id and container id.
  std::set< QString > connected_envs; // Joined to swarm environment. Id of env is stored
- std::map<int, QString> interface_ids; // Pair of interface id and swarm hash
-
- int get_unselected_interface_id() {
-   for(int id = 0 ; id < 30 ; ++id) { // differents ids for 30 environments
-     if (interface_ids.find(id) == interface_ids.end()) {
-       return id;
-     }
-   }
-   return -1;
- }
+ CSwarmReconciler m_reconciler;
 
  void join_swarm(const CEnvironment& env);
  void leave_swarm(const QString &hash);
@@ -233,6 +202,9 @@ public:
 private:
   P2P_STATUS m_status;
 
+private slots:
+  void state_updated_sl();
+
 signals:
   void p2p_status(P2P_STATUS);
 
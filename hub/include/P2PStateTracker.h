@@ -0,0 +1,138 @@
+#ifndef P2PSTATETRACKER_H
+#define P2PSTATETRACKER_H
+
+#include <functional>
+#include <memory>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QMutex>
+#include <QObject>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QTimer>
+
+class CProcessRunner;
+class CRestPipeline;
+
+/**
+ * @brief Snapshot of p2p daemon state. swarms and interfaces are indexed
+ * by swarm hash. peers are known only when daemon answered on its REST
+ * endpoint (peers_known), key is swarm hash + '\n' + peer ip, value is peer state.
+ */
+struct p2p_state_t {
+  bool installed;
+  bool running;
+  bool peers_known;
+  QSet<QString> swarms;
+  QHash<QString, QString> interfaces;
+  QHash<QString, QString> peers;
+
+  p2p_state_t() :
+    installed(false),
+    running(false),
+    peers_known(false) {}
+};
+////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief The CP2PStateTracker class is the only place where state of p2p
+ * daemon is queried periodically. Once per interval it asks daemon's REST
+ * endpoint for instances and peers and runs `p2p show --interfaces --bind`,
+ * `p2p show` is used only when REST endpoint isn't available.
+ * Result is kept in memory, so lookups don't spawn processes and take O(1).
+ * Refresh is driven by timer of tracker's thread, lookups are thread safe.
+ */
+class CP2PStateTracker : public QObject {
+  Q_OBJECT
+public:
+  static const int RUNNING_INTERVAL_MS = 15000;
+  static const int DOWN_INTERVAL_MS = 5000;
+  static const int SHOW_TIMEOUT_MS = 5000;
+  static const int REST_TIMEOUT_MS = 3000;
+  /* snapshot older than this isn't used for lookups */
+  static const int STALE_MS = 2 * RUNNING_INTERVAL_MS;
+
+  enum container_state_t {
+    CS_UNKNOWN = 0,
+    CS_CONNECTED,
+    CS_NOT_CONNECTED
+  };
+
+  typedef std::function<QString()> path_getter_t;
+
+  /**
+   * @param pipeline - may be null, then only p2p cli is used
+   * @param status_url - url of daemon's REST status, may be empty
+   */
+  CP2PStateTracker(CProcessRunner* runner,
+                   CRestPipeline* pipeline,
+                   path_getter_t p2p_path,
+                   const QString& status_url,
+                   QObject* parent = nullptr);
+
+  static CP2PStateTracker* Instance();
+
+  /* starts periodic refresh, does nothing if already started */
+  void start();
+  void stop();
+  /* refresh out of schedule, may be called from any thread */
+  void refresh();
+
+  /* false if there is no snapshot yet or it is stale */
+  bool has_state() const;
+  /* copies snapshot to st, false and st isn't touched if has_state() is false */
+  bool state(p2p_state_t& st) const;
+  /* lookups below answer "no" for stale snapshot */
+  bool daemon_running() const;
+  bool is_in_swarm(const QString& hash) const;
+  QString swarm_interface(const QString& hash) const;
+  container_state_t container_state(const QString& hash,
+                                    const QString& ip) const;
+
+  /* results of `p2p start` and `p2p stop` known before next refresh */
+  void swarm_joined(const QString& hash);
+  void swarm_left(const QString& hash);
+
+  /* count of finished refreshes */
+  quint64 refresh_count() const;
+
+  static QSet<QString> parse_swarms(const QStringList& show_out);
+  static QHash<QString, QString> parse_interfaces(const QStringList& show_out);
+  static QString peer_key(const QString& hash, const QString& ip) {
+    return hash + "\n" + ip;
+  }
+
+private:
+  typedef std::shared_ptr<p2p_state_t> state_ptr_t;
+
+  CProcessRunner* m_runner;
+  CRestPipeline* m_pipeline;
+  path_getter_t m_p2p_path;
+  QString m_status_url;
+  QTimer m_timer;
+  bool m_started;
+  bool m_refreshing;   // touched only in tracker's thread
+  bool m_refresh_again;
+
+  mutable QMutex m_mutex;   // guards members below
+  p2p_state_t m_state;
+  bool m_has_state;
+  QElapsedTimer m_state_age;
+  quint64 m_refresh_count;
+
+  void query_rest(const QString& p2p, state_ptr_t st);
+  void query_show(const QString& p2p, state_ptr_t st);
+  void query_interfaces(const QString& p2p, state_ptr_t st);
+  void publish(state_ptr_t st);
+  bool valid_locked() const;
+
+private slots:
+  void refresh_sl();
+  void refresh_finished_sl();
+
+signals:
+  void state_updated();
+};
+
+#endif // P2PSTATETRACKER_H
@@ -0,0 +1,65 @@
+#ifndef PATHRESOLVER_H
+#define PATHRESOLVER_H
+
+#include <map>
+#include <vector>
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+
+/**
+ * @brief The CPathResolver class finds executables in PATH like `which`/`where`
+ * do, but in process. Results (negative ones too) are cached per program name
+ * and PATH value (and PATHEXT on Windows). Not more than MAX_ENTRIES are kept,
+ * the oldest one is dropped first. Entry is valid while modification times of directories
+ * which were scanned for it are the same, so new or removed binary is noticed
+ * without new scan of PATH. Names with directory part (paths from settings)
+ * are only checked for being executable. All methods are thread safe.
+ */
+class CPathResolver {
+public:
+  static const int MAX_ENTRIES = 256;
+
+  CPathResolver();
+  static CPathResolver& Instance();
+
+  /**
+   * @brief full path of executable or empty string. Current PATH is used.
+   */
+  QString resolve(const QString& prog);
+  QString resolve(const QString& prog, const QString& path_env);
+
+  void clear();
+  /* count of real directory scans, i.e. cache misses */
+  quint64 scans_count() const;
+
+  static QStringList search_dirs(const QString& path_env);
+
+private:
+  struct dir_stamp_t {
+    QString dir;
+    qint64 mtime;  // -1 if directory doesn't exist
+  };
+
+  struct entry_t {
+    QString path;
+    std::vector<dir_stamp_t> scanned;
+    quint64 stored;  // order of insertion, the least one is evicted
+  };
+
+  mutable QMutex m_mutex;
+  std::map<QString, entry_t> m_cache;
+  quint64 m_scans_count;
+  quint64 m_store_counter;
+
+  void evict_oldest();
+
+  static QString path_ext();
+  static qint64 dir_mtime(const QString& dir);
+  static bool is_executable(const QString& path);
+  static QStringList candidates(const QString& dir, const QString& prog);
+  static bool is_valid(const entry_t& et);
+  static entry_t scan(const QString& prog, const QStringList& dirs);
+};
+
+#endif // PATHRESOLVER_H
@@ -0,0 +1,105 @@
+#ifndef PEERCOMMANDEXECUTOR_H
+#define PEERCOMMANDEXECUTOR_H
+
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <QAtomicInt>
+#include <QMutex>
+#include <QObject>
+#include <QPointer>
+#include <QString>
+#include <QThreadPool>
+#include "SystemCallWrapper.h"
+
+/**
+ * @brief The CPeerCommandExecutor class runs lifecycle commands of peers
+ * (vagrant up, halt, reload, destroy, update of peer os). Commands run on
+ * own pool of not more than max_workers threads, so stopping or destroying
+ * many peers at once doesn't start a thread and a vagrant per peer.
+ * Commands of one peer run one after another in order they were added,
+ * because vagrant can't run two commands on the same machine.
+ * Command which hasn't started yet can be cancelled, it finishes with SCWE_CANCELLED.
+ * Callbacks and signals are delivered in the thread of executor.
+ */
+class CPeerCommandExecutor : public QObject {
+  Q_OBJECT
+public:
+  typedef quint64 command_id_t;
+  static const int DEFAULT_MAX_WORKERS = 4;
+
+  /* blocking, runs in thread of pool */
+  typedef std::function<system_call_wrapper_error_t()> job_t;
+  typedef std::function<void(system_call_wrapper_error_t res)> finished_callback_t;
+
+  explicit CPeerCommandExecutor(int max_workers = DEFAULT_MAX_WORKERS,
+                                QObject* parent = nullptr);
+  /* cancels commands which haven't started, waits for running ones */
+  ~CPeerCommandExecutor();
+
+  static CPeerCommandExecutor* Instance();
+
+  /**
+   * @param peer - commands with the same peer are serialized, usually peer directory
+   * @param context - if not null and destroyed, callback isn't called
+   * Thread safe.
+   */
+  command_id_t enqueue(const QString& peer,
+                       const QString& command,
+                       job_t job,
+                       QObject* context,
+                       finished_callback_t callback);
+
+  /* @return false if command has started or finished already. Thread safe */
+  bool cancel(command_id_t id);
+  /* @return count of cancelled commands */
+  int cancel_peer(const QString& peer);
+  int cancel_all();
+
+  int max_workers() const {return m_pool.maxThreadCount();}
+  bool is_busy(const QString& peer) const;
+  int pending_count() const;
+
+private:
+  enum command_state_t {
+    CMD_QUEUED = 0,
+    CMD_RUNNING,
+    CMD_CANCELLED
+  };
+
+  struct command_t {
+    command_id_t id;
+    QString peer;
+    QString command;
+    job_t job;
+    QPointer<QObject> context;
+    bool has_context;
+    finished_callback_t callback;
+    std::shared_ptr<QAtomicInt> state;
+  };
+
+  QThreadPool m_pool;
+  mutable QMutex m_mutex;   // guards members below
+  // commands of peer, front one is given to pool
+  std::map<QString, std::deque<command_t> > m_queues;
+  command_id_t m_last_id;
+  int m_total;       // commands added since executor was idle last time
+  int m_finished;
+
+  void submit(const command_t& cmd);
+  int cancel_if(std::function<bool(const command_t&)> pred);
+
+private slots:
+  void command_started_sl(quint64 id, QString peer, QString command);
+  void command_finished_sl(quint64 id, QString peer, int res);
+
+signals:
+  void command_queued(quint64 id, QString peer, QString command);
+  void command_started(quint64 id, QString peer, QString command);
+  void command_finished(quint64 id, QString peer, QString command, int res);
+  /* finished and added commands since executor was idle last time */
+  void progress(int finished, int total);
+};
+
+#endif // PEERCOMMANDEXECUTOR_H
@@ -0,0 +1,73 @@
+#ifndef PEERCOMMANDWATCHER_H
+#define PEERCOMMANDWATCHER_H
+
+#include <functional>
+#include <map>
+#include <QByteArray>
+#include <QFileSystemWatcher>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+
+/**
+ * @brief The CPeerCommandWatcher class tells when vagrant command started
+ * in terminal for a peer (up, halt, reload, destroy etc.) has finished.
+ * Terminal script writes stderr of command to `<peer name>_<command>` log and
+ * creates `<command>_finished` marker in peer directory when it's done.
+ * Base directory of peers and every peer directory are watched by
+ * QFileSystemWatcher, so nothing is read while peers are idle. Logs are
+ * followed while command runs and only appended bytes are read.
+ * When marker appears, command_finished() is emitted with messages of log
+ * and both files are removed.
+ */
+class CPeerCommandWatcher : public QObject {
+  Q_OBJECT
+public:
+  /* name of peer by name of its directory, empty if directory isn't peer */
+  typedef std::function<QString(const QString& dir_name)> name_parser_t;
+
+  explicit CPeerCommandWatcher(name_parser_t parse_name,
+                               QObject* parent = nullptr);
+
+  /**
+   * @brief starts watching peers in dir. Markers which are there already
+   * are reported right away. Does nothing if dir is watched already.
+   */
+  void set_base_dir(const QString& dir);
+  const QString& base_dir() const {return m_base_dir;}
+  QStringList peer_dirs() const;
+
+  /* what is read from log of running command so far */
+  QString log_so_far(const QString& peer_dir, const QString& command) const;
+
+  /* removes terminal colors */
+  static QString clean_messages(const QByteArray& log);
+
+private:
+  struct log_t {
+    qint64 offset;
+    QByteArray data;
+
+    log_t() : offset(0) {}
+  };
+
+  name_parser_t m_parse_name;
+  QFileSystemWatcher m_watcher;
+  QString m_base_dir;
+  std::map<QString, QString> m_peers;   // peer dir -> peer name
+  std::map<QString, log_t> m_logs;      // log path -> what is read
+
+  void sync_peers();
+  void scan_peer(const QString& dir);
+  void read_tail(const QString& path, log_t& log);
+
+private slots:
+  void directory_changed_sl(const QString& path);
+  void file_changed_sl(const QString& path);
+
+signals:
+  void command_finished(QString peer_name, QString peer_dir,
+                        QString command, QString messages);
+};
+
+#endif // PEERCOMMANDWATCHER_H
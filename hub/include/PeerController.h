@@ -6,7 +6,11 @@
 #include <QTimer>
 #include <QtConcurrent/QtConcurrent>
 #include <map>
-#include <set>
+#include <utility>
+#include <vector>
+#include "PeerCommandExecutor.h"
+#include "PeerCommandWatcher.h"
+#include "PeerStatusPipeline.h"
 #include "RestContainers.h"
 #include "SystemCallWrapper.h"
 
@@ -80,23 +84,22 @@ class CPeerController : public QObject {
   virtual ~CPeerController();
   bool m_stop_thread;
 
-  QTimer m_logs_timer;
-  QThreadPool *m_pool;
-  // Saves peer checking status by peer directory
-  // Vagrant locks peer state while checking status
-  // Vagrant can perform one command per machine
-  std::set<QString> checking_statutes;
-  std::set<QString> running_commands; // vagrant reload, up, halt, destroy
+  QThreadPool *m_pool;   // vagrant global-status
+  // status, port and REST stages of peers, keeps state of every peer,
+  // including vagrant commands (reload, up, halt, destroy) holding it
+  CPeerStatusPipeline *m_pipeline;
+
+  // tells when vagrant commands run in terminal have finished
+  CPeerCommandWatcher *m_command_watcher;
 
   void search_local();
-  void check_logs();
-  QString get_error_messages(QDir peer_dir, QString command);
-  void get_peer_info(const QFileInfo &fi, QDir dir);
+  void get_peer_info(const QFileInfo &fi, QDir dir,
+                     std::vector<std::pair<QString, QString> > &peers);
   QString parse_name(const QString &name);
+  static QString management_url(const QString &port);   // port or ip of peer
 
   QStringList bridged_interfaces;  // list of current bridged interfaces
   system_call_res_t vagrant_global_status;  // list of current VMs directory(Only Subutai peers)
-  int number_threads;                       // to emit signal when all finished
   QString get_pr_step_fi(QFile &p_file); // get provision step from file
   bool is_provision_running(QDir peer_dir);
 
@@ -118,16 +121,8 @@ class CPeerController : public QObject {
   void init();
   void refresh();
   void force_refresh(); // force updates peer list and bridge interfaces
-  void parse_peer_info(peer_info_t type, const QString &name,
-                       const QString &dir, const QString &output);
-
-  int get_number_threads() { return number_threads; }
-
-  void dec_number_threads() {
-    if (number_threads > 0) number_threads--;
-  }
-
-  void finish_current_update() { number_threads = 0; }
+  // results of peers being refreshed are dropped, refresh may start again
+  void finish_current_update() { m_pipeline->abandon(); }
 
   QStringList get_bridgedifs() { return bridged_interfaces; }
   system_call_res_t get_global_status() { return vagrant_global_status; }
@@ -136,123 +131,40 @@ class CPeerController : public QObject {
   const QString &provision_step_description(const int &step);
   int getProvisionStep(const QString &dir);
 
+  // may be called from any thread
   void insert_running_command(QString dir) {
     qInfo() << "Vagrant command Locked peer state: "
              << dir;
-    running_commands.emplace(dir);
+    m_pipeline->set_command_running(dir, true);
   }
 
   void remove_running_command(QString dir) {
-    std::set<QString>::iterator ite;
-    ite = running_commands.find(dir);
-    if (ite != running_commands.end()) {
-      running_commands.erase(ite);
-      qInfo() << "Vagrant command Unlocked peer state: "
-               << dir;
-    }
-  }
-
-  bool is_running_command(QString dir) {
-    bool found = running_commands.find(dir) != running_commands.end();
-
-    if  (found)
-      return true;
-
-    return false;
-  }
-
-  void insert_checking_status(QString dir) {
-    qInfo() << "Vagrant status Locked peer state: "
+    if (!m_pipeline->is_command_running(dir)) return;
+    m_pipeline->set_command_running(dir, false);
+    qInfo() << "Vagrant command Unlocked peer state: "
              << dir;
-    checking_statutes.emplace(dir);
   }
 
-  void remove_checking_status(QString dir) {
-    std::set<QString>::iterator ite;
-    ite = checking_statutes.find(dir);
-    if (ite != checking_statutes.end()) {
-      checking_statutes.erase(ite);
-      qInfo() << "Vagrant status Unlocked peer state: "
-               << dir;
-    }
+  bool is_running_command(QString dir) {
+    return m_pipeline->is_command_running(dir);
   }
 
+  // Vagrant locks peer state while checking status
   bool is_checking_status(QString dir) {
-    bool found = checking_statutes.find(dir) != checking_statutes.end();
-
-    if (found)
-      return true;
-
-    return false;
+    return m_pipeline->is_checking_status(dir);
   }
 
  private slots:
   void refresh_timer_timeout();
+  void stage_finished_sl(int stage, QString name, QString dir, QString output);
+  void pipeline_idle_sl();
+  void command_finished_sl(QString peer_name, QString peer_dir,
+                           QString command, QString messages);
  signals:
   void got_peer_info(peer_info_t type, QString name, QString dir,
                      QString output);
 };
 
-class GetPeerInfo : public QObject {
-  Q_OBJECT
-  QString arg;
-  CPeerController::peer_info_t action;
-
- public:
-  GetPeerInfo(QObject *parent = nullptr) : QObject(parent) {}
-
-  void init(const QString &arg, const CPeerController::peer_info_t &action) {
-    this->arg = arg;
-    this->action = action;
-  }
-
-  void startWork(QThreadPool *pool) {
-    if (CPeerController::Instance()->get_stop_thread()) {
-      qDebug() << "STOP THREAD";
-      return;
-    }
-
-    execute_remote_command(pool);
-  }
-
-  void execute_remote_command(QThreadPool *pool) {
-    qDebug() << "GETPEERINFO"
-             << CPeerController::Instance()->get_stop_thread();
-    if (CPeerController::Instance()->get_stop_thread()) {
-      qDebug() << "QUIT APPLICATION STOP THREAD";
-      return;
-    }
-
-    QFutureWatcher<QString> *watcher = new QFutureWatcher<QString>(this);
-    QFuture<QString> res;
-    switch (action) {
-      case 0:
-        CPeerController::Instance()->insert_checking_status(QDir::toNativeSeparators(arg));
-        res = QtConcurrent::run(pool, CSystemCallWrapper::vagrant_status, arg);
-      break;
-      case 1:
-        res = QtConcurrent::run(pool, CSystemCallWrapper::vagrant_port, arg);
-        break;
-      default:
-        break;
-    }
-
-    CPeerController::peer_info_t lala = action;
-    connect(watcher, &QFutureWatcher<QString>::finished, [this, res, lala]() {
-      if (CPeerController::Instance()->get_stop_thread()) {
-        qDebug() << "QUIT APPLICATION STOP THREAD";
-        return;
-      }
-
-      emit this->outputReceived(lala, res.result());
-    });
-    connect(watcher, SIGNAL(finished()), watcher, SLOT(deleteLater()));
-    watcher->setFuture(res);
-  }
- signals:
-  void outputReceived(CPeerController::peer_info_t action, QString res);
-};
-
 class StopPeer : public QObject {
   Q_OBJECT
   QString directory;
@@ -262,26 +174,16 @@ class StopPeer : public QObject {
 
   void init(const QString &directory) { this->directory = directory; }
 
+  // object is deleted when command finishes
   void startWork() {
-    QThread *thread = new QThread();
-    connect(thread, &QThread::started, this, &StopPeer::execute_remote_command);
-    connect(this, &StopPeer::outputReceived, thread, &QThread::quit);
-    connect(thread, &QThread::finished, this, &StopPeer::deleteLater);
-    connect(thread, &QThread::finished, thread, &QThread::deleteLater);
-    this->moveToThread(thread);
-    thread->start();
-  }
-
-  void execute_remote_command() {
-    QFutureWatcher<system_call_wrapper_error_t> *watcher =
-        new QFutureWatcher<system_call_wrapper_error_t>(this);
-    QFuture<system_call_wrapper_error_t> res =
-        QtConcurrent::run(CSystemCallWrapper::vagrant_halt, directory);
-    connect(watcher, &QFutureWatcher<system_call_wrapper_error_t>::finished,
-            [this, res]() { emit this->outputReceived(res); });
-    connect(watcher, SIGNAL(finished()),
-            watcher, SLOT(deleteLater()));
-    watcher->setFuture(res);
+    QString dir = directory;
+    CPeerCommandExecutor::Instance()->enqueue(
+        CPeerStatusPipeline::key_of(dir), "halt",
+        [dir]() { return CSystemCallWrapper::vagrant_halt(dir); },
+        this, [this](system_call_wrapper_error_t res) {
+          emit this->outputReceived(res);
+          this->deleteLater();
+        });
   }
  signals:
   void outputReceived(system_call_wrapper_error_t res);
@@ -302,29 +204,18 @@ class CommandPeerTerminal : public QObject {
     this->name = name;
   }
 
+  // object is deleted when command finishes
   void startWork() {
-    QThread *thread = new QThread();
-    connect(thread, &QThread::started, this,
-            &CommandPeerTerminal::execute_remote_command);
-    connect(this, &CommandPeerTerminal::outputReceived, thread, &QThread::quit);
-    connect(thread, &QThread::finished, this,
-            &CommandPeerTerminal::deleteLater);
-    connect(thread, &QThread::finished, thread, &QThread::deleteLater);
-    this->moveToThread(thread);
-    thread->start();
-  }
-
-  void execute_remote_command() {
-    QFutureWatcher<system_call_wrapper_error_t> *watcher =
-        new QFutureWatcher<system_call_wrapper_error_t>(this);
-    QFuture<system_call_wrapper_error_t> res = QtConcurrent::run(
-        CSystemCallWrapper::vagrant_command_terminal, directory, command, QString("\"%1\"").arg(name));
-    connect(watcher, &QFutureWatcher<system_call_wrapper_error_t>::finished, [this, res]() {
-      emit this->outputReceived(res);
-    });
-    connect(watcher, SIGNAL(finished()),
-        watcher, SLOT(deleteLater()));
-    watcher->setFuture(res);
+    QString dir = directory, cmd = command, peer_name = name;
+    CPeerCommandExecutor::Instance()->enqueue(
+        CPeerStatusPipeline::key_of(dir), cmd, [dir, cmd, peer_name]() {
+          return CSystemCallWrapper::vagrant_command_terminal(
+              dir, cmd, QString("\"%1\"").arg(peer_name));
+        },
+        this, [this](system_call_wrapper_error_t res) {
+          emit this->outputReceived(res);
+          this->deleteLater();
+        });
   }
  signals:
   void outputReceived(system_call_wrapper_error_t res);
@@ -339,27 +230,16 @@ class DestroyPeer : public QObject {
 
   void init(const QString &directory) { this->directory = directory; }
 
+  // object is deleted when command finishes
   void startWork() {
-    QThread *thread = new QThread();
-    connect(thread, &QThread::started, this,
-            &DestroyPeer::execute_remote_command);
-    connect(this, &DestroyPeer::outputReceived, thread, &QThread::quit);
-    connect(thread, &QThread::finished, this, &DestroyPeer::deleteLater);
-    connect(thread, &QThread::finished, thread, &QThread::deleteLater);
-    this->moveToThread(thread);
-    thread->start();
-  }
-
-  void execute_remote_command() {
-    QFutureWatcher<system_call_wrapper_error_t> *watcher =
-        new QFutureWatcher<system_call_wrapper_error_t>(this);
-    QFuture<system_call_wrapper_error_t> res =
-        QtConcurrent::run(CSystemCallWrapper::vagrant_destroy, directory);
-    connect(watcher, &QFutureWatcher<system_call_wrapper_error_t>::finished,
-            [this, res]() { emit this->outputReceived(res); });
-    connect(watcher, SIGNAL(finished()),
-        watcher, SLOT(deleteLater()));
-    watcher->setFuture(res);
+    QString dir = directory;
+    CPeerCommandExecutor::Instance()->enqueue(
+        CPeerStatusPipeline::key_of(dir), "destroy",
+        [dir]() { return CSystemCallWrapper::vagrant_destroy(dir); },
+        this, [this](system_call_wrapper_error_t res) {
+          emit this->outputReceived(res);
+          this->deleteLater();
+        });
   }
  signals:
   void outputReceived(system_call_wrapper_error_t res);
@@ -374,27 +254,16 @@ class ReloadPeer : public QObject {
 
   void init(const QString &directory) { this->directory = directory; }
 
+  // object is deleted when command finishes
   void startWork() {
-    QThread *thread = new QThread();
-    connect(thread, &QThread::started, this,
-            &ReloadPeer::execute_remote_command);
-    connect(this, &ReloadPeer::outputReceived, thread, &QThread::quit);
-    connect(thread, &QThread::finished, this, &ReloadPeer::deleteLater);
-    connect(thread, &QThread::finished, thread, &QThread::deleteLater);
-    this->moveToThread(thread);
-    thread->start();
-  }
-
-  void execute_remote_command() {
-    QFutureWatcher<system_call_wrapper_error_t> *watcher =
-        new QFutureWatcher<system_call_wrapper_error_t>(this);
-    QFuture<system_call_wrapper_error_t> res =
-        QtConcurrent::run(CSystemCallWrapper::vagrant_reload, directory);
-    connect(watcher, &QFutureWatcher<system_call_wrapper_error_t>::finished,
-            [this, res]() { emit this->outputReceived(res); });
-    connect(watcher, SIGNAL(finished()),
-        watcher, SLOT(deleteLater()));
-    watcher->setFuture(res);
+    QString dir = directory;
+    CPeerCommandExecutor::Instance()->enqueue(
+        CPeerStatusPipeline::key_of(dir), "reload",
+        [dir]() { return CSystemCallWrapper::vagrant_reload(dir); },
+        this, [this](system_call_wrapper_error_t res) {
+          emit this->outputReceived(res);
+          this->deleteLater();
+        });
   }
  signals:
   void outputReceived(system_call_wrapper_error_t res);
@@ -455,38 +324,29 @@ class UpdatePeerOS : public QObject {
   Q_OBJECT
 public:
   UpdatePeerOS(QObject *parent = nullptr) : QObject(parent) {}
+  // object is deleted when command finishes
   void startWork() {
-    QThread* thread = new QThread();
-    connect(thread, &QThread::started,
-            this, &UpdatePeerOS::execute_remote_command);
-    connect(this, &UpdatePeerOS::outputReceived,
-            thread, &QThread::quit);
-    connect(thread, &QThread::finished,
-            this, &UpdatePeerOS::deleteLater);
-    connect(thread, &QThread::finished,
-            thread, &QThread::deleteLater);
-    this->moveToThread(thread);
-    thread->start();
+    QString name = m_peer_name, port = m_peer_port;
+    CPeerCommandExecutor::Instance()->enqueue(
+        CPeerStatusPipeline::key_of(m_peer_dir), "update peeros", [name, port]() {
+          return CSystemCallWrapper::vagrant_update_peeros(port, name);
+        },
+        this, [this](system_call_wrapper_error_t res) {
+          emit this->outputReceived(res);
+          this->deleteLater();
+        });
   }
-  void init(const QString name, const QString port) {
+  // dir is the key of peer in command queue, like in other peer commands
+  void init(const QString name, const QString port, const QString dir) {
     m_peer_name = name;
     m_peer_port = port;
-  }
-  void execute_remote_command() {
-    QFutureWatcher<system_call_wrapper_error_t> *watcher =
-        new QFutureWatcher<system_call_wrapper_error_t>(this);
-    QFuture<system_call_wrapper_error_t> res = QtConcurrent::run(
-        CSystemCallWrapper::vagrant_update_peeros, m_peer_port, m_peer_name);
-    connect(watcher, &QFutureWatcher<system_call_wrapper_error_t>::finished,
-            [this, res]() { emit this->outputReceived(res); });
-    connect(watcher, SIGNAL(finished()),
-            watcher, SLOT(deleteLater()));
-    watcher->setFuture(res);
+    m_peer_dir = dir;
   }
 
  private:
   QString m_peer_name;
   QString m_peer_port;
+  QString m_peer_dir;
  signals:
   void outputReceived(system_call_wrapper_error_t res);
 };
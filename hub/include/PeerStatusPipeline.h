@@ -0,0 +1,140 @@
+#ifndef PEERSTATUSPIPELINE_H
+#define PEERSTATUSPIPELINE_H
+
+#include <functional>
+#include <map>
+#include <utility>
+#include <vector>
+#include <QMutex>
+#include <QObject>
+#include <QString>
+#include <QThreadPool>
+
+/**
+ * @brief State of local peer as known by CPeerStatusPipeline.
+ * Values are empty until stage is finished.
+ */
+struct peer_state_t {
+  QString name;
+  QString dir;
+  QString status;
+  QString port;     // port or ip, see CSystemCallWrapper::vagrant_port
+  QString finger;
+  QString update;
+  int stage;                // stage which runs now or has finished last
+  bool in_flight;           // peer is being refreshed
+  bool command_running;     // vagrant up, halt, reload etc. holds the peer
+
+  peer_state_t() :
+    stage(-1),
+    in_flight(false),
+    command_running(false) {}
+};
+////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief The CPeerStatusPipeline class refreshes local peers in parallel.
+ * Every peer goes through its stages on its own: `vagrant status`, then
+ * port of running peer, then fingerprint and update requests to its management.
+ * Blocking stages run on own thread pool, not more than max_parallel at once,
+ * so refresh takes about as long as the slowest peer and not sum of all peers.
+ * REST stages are asynchronous and bounded by CRestPipeline.
+ * Peer being refreshed or held by vagrant command isn't started again.
+ * State of peers is kept in store which may be read from any thread.
+ * Stage results are delivered with stage_finished() in pipeline's thread.
+ */
+class CPeerStatusPipeline : public QObject {
+  Q_OBJECT
+public:
+  /* same values as CPeerController::peer_info_t */
+  enum stage_t {
+    ST_STATUS = 0,
+    ST_PORT,
+    ST_FINGER,
+    ST_UPDATE
+  };
+
+  static const int DEFAULT_MAX_PARALLEL = 4;
+
+  /* blocking, runs in thread of pool */
+  typedef std::function<QString(const QString& dir)> probe_t;
+  typedef std::function<void(const QString& output)> reply_t;
+  /* asynchronous, reply must be called once, from any thread */
+  typedef std::function<void(const QString& name, const QString& dir,
+                             const QString& port, reply_t reply)> rest_probe_t;
+
+  CPeerStatusPipeline(probe_t status_probe,
+                      probe_t port_probe,
+                      rest_probe_t finger_probe,
+                      rest_probe_t update_probe,
+                      int max_parallel = DEFAULT_MAX_PARALLEL,
+                      QObject* parent = nullptr);
+  /* waits for running probes, their results are dropped */
+  ~CPeerStatusPipeline();
+
+  int max_parallel() const {return m_pool.maxThreadCount();}
+  void set_max_parallel(int max_parallel);
+
+  /**
+   * @brief starts refresh of peers, list of pairs (name, dir).
+   * @return count of started peers, peers which are in flight or
+   * held by vagrant command are skipped
+   */
+  int submit(const std::vector<std::pair<QString, QString> >& peers);
+  /**
+   * @brief results of peers in flight are dropped and they may be submitted
+   * again. Used when state of peers is changed by user.
+   */
+  void abandon();
+
+  int in_flight_count() const;
+  bool is_in_flight(const QString& dir) const;
+  bool is_checking_status(const QString& dir) const;
+
+  void set_command_running(const QString& dir, bool running);
+  bool is_command_running(const QString& dir) const;
+
+  bool has_peer(const QString& dir) const;
+  peer_state_t peer(const QString& dir) const;
+  std::vector<peer_state_t> peers() const;
+
+  static QString key_of(const QString& dir);
+
+private:
+  struct entry_t {
+    peer_state_t state;
+    int pending;              // REST stages which haven't replied yet
+    quint64 generation;       // of abandon() when peer was submitted
+
+    entry_t() : pending(0), generation(0) {}
+  };
+
+  probe_t m_status_probe;
+  probe_t m_port_probe;
+  rest_probe_t m_finger_probe;
+  rest_probe_t m_update_probe;
+  QThreadPool m_pool;
+
+  mutable QMutex m_mutex;   // guards members below
+  std::map<QString, entry_t> m_peers;
+  int m_in_flight;
+  quint64 m_generation;
+  bool m_destroying;
+
+  void run_probe(int stage, const QString& key, quint64 generation);
+  void run_rest(const QString& key, quint64 generation,
+                const QString& name, const QString& dir, const QString& port);
+  void finish_peer_locked(entry_t& et);
+  void post_result(int stage, const QString& key, quint64 generation, const QString& output);
+
+private slots:
+  void stage_finished_sl(int stage, QString key, quint64 generation, QString output);
+
+signals:
+  void stage_finished(int stage, QString name, QString dir, QString output);
+  void peer_finished(QString name, QString dir);
+  /* last peer in flight has finished */
+  void idle();
+};
+
+#endif // PEERSTATUSPIPELINE_H
@@ -0,0 +1,172 @@
+#ifndef PROCESSRUNNER_H
+#define PROCESSRUNNER_H
+
+#include <deque>
+#include <functional>
+#include <map>
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QObject>
+#include <QPointer>
+#include <QProcess>
+#include <QProcessEnvironment>
+#include <QString>
+#include <QStringList>
+#include <QTimer>
+#include "SystemCallWrapper.h"
+
+/**
+ * @brief How process is started by CProcessRunner.
+ * timeout_msec is applied to start of process and then once more to its run
+ * (like waitForStarted + waitForFinished), 0 means no deadline.
+ * Stdout lines are collected into system_call_res_t::out only with
+ * collect_output, otherwise they are just passed to line callback.
+ * long_running processes (vagrant up and so on) have their own limit of running
+ * processes, so they don't hold slots of short commands.
+ */
+struct process_options_t {
+  QString working_dir;
+  QProcessEnvironment env;   // empty means environment of tray
+  unsigned long timeout_msec;
+  bool collect_output;
+  bool log;
+  bool long_running;
+
+  process_options_t() :
+    timeout_msec(0),
+    collect_output(true),
+    log(true),
+    long_running(false) {}
+};
+
+/**
+ * @brief Events of one process. Every callback may be empty.
+ * finished is called exactly once (even if process couldn't be started),
+ * unless context was destroyed.
+ */
+struct process_callbacks_t {
+  std::function<void()> started;
+  /* line without '\n', is_stderr tells which channel it came from */
+  std::function<void(const QString& line, bool is_stderr)> line;
+  std::function<void(const system_call_res_t& res)> finished;
+};
+////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief The CProcessRunner class runs external processes without blocking
+ * any thread while they work. Output is read as it comes and passed by lines,
+ * so it isn't buffered as a whole. Every process has its own deadline,
+ * can be cancelled and waits in queue while count of running processes is at limit.
+ * Processes may be started from any thread, callbacks are called in the thread of runner.
+ * Instance() lives in its own thread, so callbacks mustn't touch widgets directly.
+ */
+class CProcessRunner : public QObject {
+  Q_OBJECT
+public:
+  typedef quint64 process_id_t;
+  static const int DEFAULT_MAX_RUNNING = 16;
+  static const int DEFAULT_MAX_LONG_RUNNING = 8;
+  /* after deadline process is asked to terminate and killed if it's still alive */
+  static const int KILL_GRACE_MS = 3000;
+  /* execute() of process without deadline doesn't wait longer than this */
+  static const int MAX_EXECUTE_WAIT_MS = 24 * 3600 * 1000;
+
+  explicit CProcessRunner(QObject* parent = nullptr);
+  ~CProcessRunner();
+
+  static CProcessRunner* Instance();
+
+  /**
+   * @param context - if not null and destroyed, callbacks aren't called anymore
+   * @return id which can be used for cancel()
+   */
+  process_id_t start(const QString& cmd,
+                     const QStringList& args,
+                     const process_options_t& opts,
+                     QObject* context,
+                     process_callbacks_t callbacks);
+
+  /**
+   * @brief blocking wrapper over start() for foreign threads, calling thread
+   * is parked until process is finished, but not longer than its deadlines
+   * (or MAX_EXECUTE_WAIT_MS) plus KILL_GRACE_MS. Process which is still running
+   * then is cancelled. In runner's own thread process isn't started and
+   * SCWE_CANCELLED is returned at once, code of that thread uses start().
+   */
+  system_call_res_t execute(const QString& cmd,
+                            const QStringList& args,
+                            const process_options_t& opts);
+
+  /* cancelled process is killed and finished with SCWE_CANCELLED */
+  void cancel(process_id_t id);
+  void cancel_all();
+
+  void set_max_running(int val);
+  int max_running() const {return m_max_running;}
+  void set_max_long_running(int val);
+  int max_long_running() const {return m_max_long_running;}
+  int running_count() const {return (int)m_running.size();}
+
+private:
+  struct process_t {
+    process_id_t id;
+    QString cmd;
+    QStringList args;
+    process_options_t opts;
+    bool has_context;
+    QPointer<QObject> context;
+    process_callbacks_t callbacks;
+    QProcess* proc;
+    qint64 deadline;   // -1 means no deadline
+    bool started;
+    QByteArray out_tail, err_tail;   // incomplete last lines
+    QStringList out;
+    bool timed_out;
+    bool cancelled;
+    int handler_hash;   // registration in CProcessHandler
+  };
+
+  int m_max_running;
+  int m_max_long_running;
+  process_id_t m_last_id;
+  QElapsedTimer m_clock;
+
+  QMutex m_incoming_mutex;   // guards members below up to m_pending
+  std::deque<process_t> m_incoming;
+  std::deque<process_id_t> m_cancelled_incoming;
+  bool m_closed;
+  bool m_cancel_all_requested;
+
+  std::deque<process_t> m_pending;
+  std::map<process_id_t, process_t> m_running;
+  std::map<QProcess*, process_id_t> m_proc_to_id;
+  QTimer m_deadline_timer;
+
+  void start_process(process_t& pt);
+  void finish_process(process_t& pt, system_call_res_t& res);
+  void fail_pending(process_t& pt);
+  void stop_process(QProcess* proc);
+  void finish_running_cancelled();
+  void read_channel(process_t& pt, bool is_stderr, bool flush);
+  void schedule_deadline_timer();
+  process_t* running_by_sender();
+  bool alive(const process_t& pt) const {
+    return !pt.has_context || !pt.context.isNull();
+  }
+
+private slots:
+  void dispatch_sl();
+  void proc_started_sl();
+  void proc_ready_read_stdout_sl();
+  void proc_ready_read_stderr_sl();
+  void proc_finished_sl(int exit_code, QProcess::ExitStatus exit_status);
+  void proc_error_sl(QProcess::ProcessError error);
+  void deadline_timer_timeout_sl();
+  void about_to_quit_sl();
+
+signals:
+  void dispatch_requested();
+};
+
+#endif // PROCESSRUNNER_H
@@ -0,0 +1,122 @@
+#ifndef REACHABILITYCHECKER_H
+#define REACHABILITYCHECKER_H
+
+#include <functional>
+#include <vector>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QObject>
+#include <QPointer>
+#include <QString>
+#include <QThreadPool>
+
+/**
+ * @brief The CReachabilityChecker class runs reachability probes of containers
+ * and resource hosts on own pool of not more than max_parallel threads, so
+ * unreachable host doesn't stall probes of other ones and sweep over many
+ * containers takes about one timeout instead of sum of them.
+ * Timeout of probe is adaptive per host. Probe of Instance() is a run of p2p CLI
+ * process, so its run time is mostly spawn of process and only partly network,
+ * that's why timeout is counted in seconds and min bound is not small.
+ * Timeout is computed from run times of successful probes (smoothed + 4 * variation)
+ * and kept in [min, max] bounds. Timed out probe isn't a sample, it doubles timeout
+ * of host up to max, first successful probe resets this backoff.
+ * Result is cached by target, confirmed result isn't probed again for confirmed_ttl,
+ * failed one for failed_ttl. Concurrent checks of the same target share one probe.
+ * Not thread safe, check() is called and callbacks are delivered in thread of checker.
+ */
+class CReachabilityChecker : public QObject {
+  Q_OBJECT
+public:
+  static const int DEFAULT_MAX_PARALLEL = 8;
+  static const int DEFAULT_MIN_TIMEOUT_MS = 2000;
+  static const int DEFAULT_INITIAL_TIMEOUT_MS = 5000;
+  static const int DEFAULT_MAX_TIMEOUT_MS = 15000;
+  static const int DEFAULT_CONFIRMED_TTL_MS = 30000;
+  static const int DEFAULT_FAILED_TTL_MS = 5000;
+
+  /* blocking, runs in thread of pool, must return in about timeout_ms */
+  typedef std::function<bool(const QString& target, int timeout_ms)> probe_t;
+  typedef std::function<void(bool reachable)> callback_t;
+
+  explicit CReachabilityChecker(probe_t probe,
+                                int max_parallel = DEFAULT_MAX_PARALLEL,
+                                QObject* parent = nullptr);
+  /* waits for running probes, their callbacks aren't called */
+  ~CReachabilityChecker();
+
+  static CReachabilityChecker* Instance();
+
+  /**
+   * @param host - probes of the same host share run time statistics
+   * @param target - passed to probe, results are cached by target
+   * @param context - if not null and destroyed, callback isn't called
+   * Callback is called immediately if result of target was confirmed recently.
+   */
+  void check(const QString& host,
+             const QString& target,
+             QObject* context,
+             callback_t callback);
+
+  void set_max_parallel(int max_parallel);
+  int max_parallel() const {return m_pool.maxThreadCount();}
+  void set_timeout_bounds(int min_ms, int initial_ms, int max_ms);
+  void set_ttl(int confirmed_ms, int failed_ms);
+
+  /* timeout which next probe of host gets */
+  int timeout_for(const QString& host) const;
+  bool is_cached(const QString& target) const;
+  void invalidate(const QString& target);
+  /* forgets results and statistics, running probes are finished */
+  void clear();
+
+  int in_flight_count() const {return m_waiting.size();}
+  quint64 probes_count() const {return m_probes_count;}
+
+private:
+  /* run time of probe by host. backoff_ms isn't 0 after timed out probe */
+  struct run_time_t {
+    bool has_samples;
+    double smoothed;
+    double variation;
+    int backoff_ms;
+  };
+
+  struct result_t {
+    bool reachable;
+    QElapsedTimer age;
+  };
+
+  struct waiter_t {
+    QPointer<QObject> context;
+    bool has_context;
+    callback_t callback;
+  };
+
+  probe_t m_probe;
+  QThreadPool m_pool;
+  int m_min_timeout_ms;
+  int m_initial_timeout_ms;
+  int m_max_timeout_ms;
+  int m_confirmed_ttl_ms;
+  int m_failed_ttl_ms;
+
+  QHash<QString, run_time_t> m_run_time; // by host
+  QHash<QString, result_t> m_results;    // by target
+  QHash<QString, std::vector<waiter_t> > m_waiting;   // probes in flight by target
+  quint64 m_probes_count;
+
+  static void call(const waiter_t& waiter, bool reachable);
+
+private slots:
+  void probe_finished_sl(QString host,
+                         QString target,
+                         bool reachable,
+                         qint64 elapsed_ms,
+                         int timeout_ms);
+
+signals:
+  void checked(QString target, bool reachable);
+};
+
+#endif // REACHABILITYCHECKER_H
@@ -0,0 +1,100 @@
+#ifndef RESTCOALESCER_H
+#define RESTCOALESCER_H
+
+#include <functional>
+#include <map>
+#include <vector>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QPointer>
+#include <QString>
+#include "RestPipeline.h"
+
+/**
+ * @brief The CRestCoalescer class sits in front of CRestPipeline and joins identical
+ * idempotent GET requests. While request with some key is in flight, all other
+ * requests with the same key wait for its response instead of going to network.
+ * Successful response is reused for freshness_ms after it was received.
+ * Key has to describe request completely (url, auth scope), see CRestResponseCache::make_key.
+ * All methods are thread safe, callbacks are called in thread of pipeline.
+ */
+class CRestCoalescer {
+public:
+  static const uint DEFAULT_FRESHNESS_MS = 2000;
+
+  /* sends upstream request of group, returns its id in pipeline or 0 */
+  typedef std::function<CRestPipeline::request_id_t(rest_callback_t)> start_fn_t;
+
+  explicit CRestCoalescer(CRestPipeline* pipeline);
+
+  /**
+   * @brief joins requests with the same key like enqueue_get(), but upstream
+   * request is sent by start, f.e. through CRestRetrier. start is called only
+   * for the first request of group, so retries and circuit breaker see one
+   * request and its final result is given to every waiter.
+   * Callback of start must be called exactly once.
+   */
+  CRestPipeline::request_id_t enqueue(const QString& key,
+                                      QObject* context,
+                                      start_fn_t start,
+                                      rest_callback_t callback);
+
+  /**
+   * @brief the same as CRestPipeline::enqueue() for GET request, but may not
+   * produce network request at all.
+   * parser is used only when request goes to network, joined waiters get
+   * response with parser of upstream request (or without it if it was restored from cache).
+   * @return id of upstream request. Note that cancelling it cancels request for
+   * all waiters with the same key.
+   */
+  CRestPipeline::request_id_t enqueue_get(const QString& key,
+                                          const QNetworkRequest& req,
+                                          uint timeout_ms,
+                                          QObject* context,
+                                          rest_callback_t callback,
+                                          rest_body_parser_t parser = rest_body_parser_t());
+
+  rest_response_t execute_get(const QString& key,
+                              const QNetworkRequest& req,
+                              uint timeout_ms,
+                              rest_body_parser_t parser = rest_body_parser_t());
+
+  void set_freshness_ms(uint ms);
+  uint freshness_ms() const {return m_freshness_ms;}
+
+  /**
+   * @brief drops reusable response, next request will go to network.
+   */
+  void invalidate(const QString& key);
+  void invalidate_all();
+
+private:
+  struct waiter_t {
+    bool has_context;
+    QPointer<QObject> context;
+    rest_callback_t callback;
+  };
+
+  struct group_t {
+    CRestPipeline::request_id_t id;
+    std::vector<waiter_t> waiters;
+  };
+
+  struct fresh_t {
+    rest_response_t resp;
+    qint64 received;
+  };
+
+  CRestPipeline* m_pipeline;
+  QMutex m_mutex;
+  QElapsedTimer m_clock;
+  uint m_freshness_ms;
+  std::map<QString, group_t> m_groups;
+  std::map<QString, fresh_t> m_fresh;
+
+  void complete(const QString& key,
+                const rest_response_t& resp);
+  void remove_expired();
+};
+
+#endif // RESTCOALESCER_H
@@ -2,6 +2,9 @@
 #define RESTCONTAINERS_H
 
 #include <stdint.h>
+#include <utility>
+#include <vector>
+#include <QHash>
 #include <QString>
 #include <QHostAddress>
 #include <QJsonArray>
@@ -79,26 +82,74 @@ public:
 };
 ////////////////////////////////////////////////////////////////////////////
 
+/**
+ * @brief Result of KeyedDiff(). Elements of lists are matched by id(),
+ * removed holds indices in old list, added holds indices in new one,
+ * changed holds pairs of indices (old, new).
+ */
+struct keyed_diff_t {
+  std::vector<size_t> added;
+  std::vector<size_t> removed;
+  std::vector<std::pair<size_t, size_t> > changed;
+
+  bool empty() const {
+    return added.empty() && removed.empty() && changed.empty();
+  }
+};
+
+/**
+ * @brief compares lists of elements with id() in linear time. Order of elements
+ * doesn't matter. Elements with the same id are matched in order of appearance.
+ */
 template<class T>
-bool VectorEq(const std::vector<T>& arg1,
-              const std::vector<T>& arg2) {
-  if (arg1.size() != arg2.size())
-    return false;
+keyed_diff_t KeyedDiff(const std::vector<T>& old_lst,
+                       const std::vector<T>& new_lst) {
+  static const size_t npos = (size_t)-1;
+  keyed_diff_t res;
+
+  // first unmatched element with id and chain of next elements with the same id
+  QHash<QString, size_t> head;
+  std::vector<size_t> next(old_lst.size(), npos);
+  head.reserve((int)old_lst.size());
+  for (size_t i = old_lst.size(); i-- > 0; ) {
+    auto found = head.find(old_lst[i].id());
+    if (found == head.end()) {
+      head.insert(old_lst[i].id(), i);
+    } else {
+      next[i] = found.value();
+      found.value() = i;
+    }
+  }
 
-  for (size_t i = 0; i < arg1.size(); ++i) {
-    bool found = false;
-    for (size_t j = 0; j < arg2.size(); ++j) {
-      if (arg1[i] != arg2[j]) continue;
-      found = true;
-      break;
+  std::vector<bool> matched(old_lst.size(), false);
+  for (size_t i = 0; i < new_lst.size(); ++i) {
+    auto found = head.find(new_lst[i].id());
+    if (found == head.end() || found.value() == npos) {
+      res.added.push_back(i);
+      continue;
     }
+    size_t old_i = found.value();
+    found.value() = next[old_i];
+    matched[old_i] = true;
+    if (old_lst[old_i] != new_lst[i])
+      res.changed.push_back(std::make_pair(old_i, i));
+  }
 
-    if (!found)
-      return false;
+  for (size_t i = 0; i < old_lst.size(); ++i) {
+    if (!matched[i]) res.removed.push_back(i);
   }
-  return true;
+  return res;
 }
 
+template<class T>
+bool KeyedEq(const std::vector<T>& arg1,
+             const std::vector<T>& arg2) {
+  if (arg1.size() != arg2.size())
+    return false;
+  return KeyedDiff<T>(arg1, arg2).empty();
+}
+////////////////////////////////////////////////////////////////////////////
+
 class CEnvironment {
 private:
   QString m_name;
@@ -143,7 +194,7 @@ public:
         m_ttl == arg.m_ttl &&
         m_status == arg.m_status &&
         m_status_descr == arg.m_status_descr &&
-        VectorEq<CHubContainer>(m_lst_containers, arg.m_lst_containers);
+        KeyedEq<CHubContainer>(m_lst_containers, arg.m_lst_containers);
     return res;
   }
 
@@ -158,6 +209,12 @@ public:
   const int& hub_id() const {return m_hub_id;}
   const QString& ttl() const {return m_ttl;}
   const std::vector<CHubContainer>& containers() const {return m_lst_containers;}
+  /**
+   * @brief containers added, removed or changed since prev version of environment
+   */
+  keyed_diff_t containers_diff(const CEnvironment& prev) const {
+    return KeyedDiff<CHubContainer>(prev.m_lst_containers, m_lst_containers);
+  }
   const QString& status() const {return m_status;}
   const QString& status_description() const {return m_status_descr;}
   const int& base_interface_id() const {return m_base_interface_id;}
@@ -0,0 +1,81 @@
+#ifndef RESTJSONPARSER_H
+#define RESTJSONPARSER_H
+
+#include <vector>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QJsonValue>
+#include <QString>
+#include "JsonStreamReader.h"
+#include "RestPipeline.h"
+
+/**
+ * @brief The CRestJsonArrayParser class parses JSON array of objects while
+ * body is being received. Only one element is kept as QJsonObject at a time,
+ * on_element() is called for each object element of array, other elements are skipped.
+ * Array is either the document itself (empty array_key) or member of top-level
+ * object with name array_key. Scalar members of top-level object are kept in root().
+ */
+class CRestJsonArrayParser : public IRestBodyParser {
+public:
+  explicit CRestJsonArrayParser(const QString& array_key = QString());
+  virtual ~CRestJsonArrayParser() {}
+
+  virtual void feed(const QByteArray& chunk);
+  virtual void finish();
+
+  bool failed() const {return m_failed;}
+  const QString& error_string() const {return m_error;}
+  const QJsonObject& root() const {return m_root;}
+
+protected:
+  virtual void on_element(const QJsonObject& obj) = 0;
+
+private:
+  /* object or array of current element which isn't completed yet */
+  struct frame_t {
+    bool is_object;
+    QJsonObject obj;
+    QJsonArray arr;
+    QString key; // key of next value in obj
+  };
+
+  CJsonStreamReader m_reader;
+  QString m_array_key;
+  QString m_root_key;
+  QJsonObject m_root;
+  bool m_root_is_object;
+  bool m_in_array;
+  std::vector<frame_t> m_frames;
+  bool m_failed;
+  QString m_error;
+
+  void process();
+  void handle_outside(CJsonStreamReader::token_t token, const QJsonValue& val);
+  void handle_element(CJsonStreamReader::token_t token, const QJsonValue& val);
+  void add_to_frame(const QJsonValue& val);
+};
+////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Collects elements of array as T constructed from QJsonObject
+ * (CEnvironment, CMyPeerInfo, CP2PInstance etc.)
+ */
+template<class T>
+class CJsonItemsParser : public CRestJsonArrayParser {
+public:
+  explicit CJsonItemsParser(const QString& array_key = QString()) :
+    CRestJsonArrayParser(array_key) {}
+
+  const std::vector<T>& items() const {return m_items;}
+
+protected:
+  virtual void on_element(const QJsonObject& obj) {
+    m_items.push_back(T(obj));
+  }
+
+private:
+  std::vector<T> m_items;
+};
+
+#endif // RESTJSONPARSER_H
@@ -0,0 +1,203 @@
+#ifndef RESTPIPELINE_H
+#define RESTPIPELINE_H
+
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <vector>
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QList>
+#include <QMutex>
+#include <QObject>
+#include <QPointer>
+#include <QTimer>
+#include <QtNetwork/QNetworkAccessManager>
+#include <QtNetwork/QNetworkReply>
+#include <QtNetwork/QNetworkRequest>
+
+typedef enum rest_operation {
+  RO_POST = 0,
+  RO_GET = 1,
+  RO_DELETE = 3
+} rest_operation_t;
+////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Consumer of response body which gets data while it's being received,
+ * so parsing doesn't wait for whole body. feed() and finish() are called
+ * in thread of CRestPipeline.
+ */
+class IRestBodyParser {
+public:
+  virtual ~IRestBodyParser() {}
+  virtual void feed(const QByteArray& chunk) = 0;
+  virtual void finish() = 0;
+};
+typedef std::shared_ptr<IRestBodyParser> rest_body_parser_t;
+////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Result of one request passed through CRestPipeline.
+ * network_error is QNetworkReply::NetworkError, http_code is -1 when server
+ * didn't answer at all. not_modified is set by CRestResponseCache when body
+ * was taken from cache or is the same as cached one. parser is the one
+ * passed to enqueue(), it has already consumed whole body. Body isn't kept
+ * next to parser (body_dropped is set) unless request has KEEP_BODY_ATTRIBUTE
+ * and response is 200 with ETag or Last-Modified, i.e. it will be cached.
+ * circuit_open is set by CRestRetrier when request wasn't sent because
+ * endpoint is failing.
+ */
+struct rest_response_t {
+  int http_code;
+  int network_error;
+  bool timed_out;
+  bool cancelled;
+  bool not_modified;
+  bool circuit_open;
+  bool body_dropped;
+  QString error_string;
+  QByteArray body;
+  QList<QNetworkReply::RawHeaderPair> headers;
+  rest_body_parser_t parser;
+
+  rest_response_t() :
+    http_code(-1),
+    network_error(0),
+    timed_out(false),
+    cancelled(false),
+    not_modified(false),
+    circuit_open(false),
+    body_dropped(false) {}
+};
+
+typedef std::function<void(const rest_response_t&)> rest_callback_t;
+////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief The CRestPipeline class executes REST requests on one QNetworkAccessManager
+ * without nested event loops. Every request has its own deadline (counted from enqueue),
+ * can be cancelled and waits in queue while count of requests in flight is at its limit.
+ * Requests may be enqueued from any thread, they are always started and completed
+ * in the thread of pipeline, callbacks are called there as well.
+ */
+class CRestPipeline : public QObject {
+  Q_OBJECT
+public:
+  typedef quint64 request_id_t;
+  static const uint DEFAULT_TIMEOUT_MS = 30000;
+  static const int DEFAULT_MAX_IN_FLIGHT = 16;
+  /* set by CRestResponseCache::prepare_request, body of validated response is kept */
+  static const QNetworkRequest::Attribute KEEP_BODY_ATTRIBUTE = QNetworkRequest::User;
+
+  explicit CRestPipeline(QNetworkAccessManager* nam,
+                         QObject* parent = nullptr);
+  ~CRestPipeline();
+
+  /**
+   * @brief enqueue request. Callback is called exactly once, unless context was destroyed.
+   * @param timeout_ms - deadline of request, 0 means DEFAULT_TIMEOUT_MS
+   * @param context - if not null and destroyed before completion, callback isn't called
+   * @param parser - if not null, is fed with body as it comes
+   * @return id which can be used for cancel()
+   */
+  request_id_t enqueue(const QNetworkRequest& req,
+                       rest_operation_t op,
+                       const QByteArray& data,
+                       uint timeout_ms,
+                       QObject* context,
+                       rest_callback_t callback,
+                       rest_body_parser_t parser = rest_body_parser_t());
+
+  /**
+   * @brief blocking wrapper over enqueue() for foreign threads, it parks
+   * calling thread until response. In pipeline's own thread request isn't
+   * sent and cancelled response is returned at once: nested event loop
+   * isn't used, code of that thread uses enqueue() with callback.
+   */
+  rest_response_t execute(const QNetworkRequest& req,
+                          rest_operation_t op,
+                          const QByteArray& data,
+                          uint timeout_ms);
+
+  /**
+   * @brief blocks like execute() until callback given to start is called.
+   * For layers over pipeline which have their own enqueue.
+   * @param start - enqueues request with passed callback and returns its id
+   */
+  rest_response_t wait(std::function<request_id_t(rest_callback_t)> start,
+                       uint timeout_ms);
+
+  /**
+   * @brief calls callback with ready response in pipeline's thread
+   * as if it was received from network.
+   */
+  request_id_t deliver(const rest_response_t& resp,
+                       QObject* context,
+                       rest_callback_t callback);
+
+  void cancel(request_id_t id);
+  void cancel_all();
+
+  void set_max_in_flight(int val);
+  int max_in_flight() const {return m_max_in_flight;}
+  int in_flight_count() const {return (int)m_in_flight.size();}
+
+private:
+  struct request_t {
+    request_id_t id;
+    QNetworkRequest req;
+    rest_operation_t op;
+    QByteArray data;
+    qint64 deadline;
+    bool has_context;
+    QPointer<QObject> context;
+    rest_callback_t callback;
+    rest_body_parser_t parser;
+    QByteArray body; // received part of body, used only with parser and keep_body()
+    QNetworkReply* reply;
+    bool timed_out;
+    bool cancelled;
+  };
+
+  QNetworkAccessManager* m_nam;
+  int m_max_in_flight;
+  request_id_t m_last_id;
+  QElapsedTimer m_clock;
+
+  QMutex m_incoming_mutex;   // guards members below up to m_pending
+  std::deque<request_t> m_incoming;
+  std::deque<request_id_t> m_cancelled_incoming;
+  std::deque<std::pair<request_t, rest_response_t> > m_ready;
+  bool m_closed;
+  bool m_cancel_all_requested;
+
+  std::deque<request_t> m_pending;
+  std::map<request_id_t, request_t> m_in_flight;
+  std::map<QNetworkReply*, request_id_t> m_reply_to_id;
+  QTimer m_deadline_timer;
+
+  void start_request(request_t& rt);
+  void finish_request(request_t& rt, rest_response_t& resp);
+  void schedule_deadline_timer();
+  void fail_pending(request_t& rt, bool timed_out);
+  static bool keep_body(const request_t& rt, QNetworkReply* reply);
+
+  static QNetworkReply* create_reply(QNetworkAccessManager* nam,
+                                     QNetworkRequest& req,
+                                     rest_operation_t op,
+                                     const QByteArray& data);
+
+private slots:
+  void dispatch_sl();
+  void reply_finished_sl();
+  void reply_ready_read_sl();
+  void deadline_timer_timeout_sl();
+  void about_to_quit_sl();
+
+signals:
+  void dispatch_requested();
+};
+
+#endif // RESTPIPELINE_H
@@ -0,0 +1,96 @@
+#ifndef RESTRESPONSECACHE_H
+#define RESTRESPONSECACHE_H
+
+#include <map>
+#include <QByteArray>
+#include <QMutex>
+#include <QString>
+#include <QUrl>
+#include <QtNetwork/QNetworkRequest>
+#include "RestPipeline.h"
+
+/**
+ * @brief The CRestResponseCache class keeps last bodies of idempotent GET
+ * requests with their validators (ETag, Last-Modified) in memory and on disk.
+ * Requests are sent as conditional ones, 304 response is replaced with cached body.
+ * Entry is keyed by url and auth scope, so bodies of different users aren't mixed.
+ * Not more than MAX_MEMORY_ENTRIES are kept in memory, least recently used one
+ * is dropped first and loaded from disk again on demand.
+ * All methods are thread safe.
+ */
+class CRestResponseCache {
+public:
+  static const int MAX_MEMORY_ENTRIES = 64;
+
+  /**
+   * @brief cached body and validators which conditional request was sent with.
+   * 304 is resolved with it even if entry was evicted or replaced meanwhile.
+   */
+  struct snapshot_t {
+    QByteArray etag;
+    QByteArray last_modified;
+    QByteArray body;
+    bool has_body;
+    snapshot_t() : has_body(false) {}
+  };
+
+  /**
+   * @param dir - directory for persisted entries. Empty means memory only.
+   */
+  explicit CRestResponseCache(const QString& dir);
+
+  static QString make_key(const QUrl& url, const QString& scope);
+  static QString default_dir();
+
+  /**
+   * @brief adds If-None-Match/If-Modified-Since headers if there is valid entry for key
+   * and asks pipeline to keep streamed body of validated response for cache
+   * @return snapshot which has to be passed to resolve_response()
+   */
+  snapshot_t prepare_request(const QString& key, QNetworkRequest& req);
+
+  /**
+   * @brief restores body of 304 response and remembers body and validators of 200 one.
+   * resp.not_modified is set when body is the same as cached one.
+   * @param snapshot - result of prepare_request() for this request
+   * @return true if body is the same as one marked with mark_delivered()
+   */
+  bool resolve_response(const QString& key,
+                        const snapshot_t& snapshot,
+                        rest_response_t& resp);
+
+  /**
+   * @brief says that body of key was successfully handled by consumer,
+   * so the same body may be skipped next time.
+   */
+  void mark_delivered(const QString& key);
+
+  /**
+   * @brief forget about delivered bodies. Validators are kept.
+   */
+  void reset_delivered();
+  void clear();
+
+private:
+  struct entry_t {
+    QByteArray etag;
+    QByteArray last_modified;
+    QByteArray body;
+    bool has_body;
+    bool delivered;
+    quint64 last_used;
+    entry_t() : has_body(false), delivered(false), last_used(0) {}
+  };
+
+  QString m_dir;
+  QMutex m_mutex;
+  std::map<QString, entry_t> m_entries;
+  quint64 m_use_counter;
+
+  entry_t& entry(const QString& key);
+  QString file_path(const QString& key) const;
+  bool load(const QString& key, entry_t& et) const;
+  void store(const QString& key, const entry_t& et) const;
+};
+
+#endif // RESTRESPONSECACHE_H
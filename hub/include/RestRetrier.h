@@ -0,0 +1,76 @@
+#ifndef RESTRETRIER_H
+#define RESTRETRIER_H
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QPointer>
+#include <QString>
+#include <QUrl>
+#include "RestPipeline.h"
+#include "RestRetryPolicy.h"
+
+/**
+ * @brief The CRestRetrier class repeats requests which failed with transient
+ * error according to CRestRetryPolicy and keeps CRestCircuitBreaker per endpoint.
+ * When breaker of endpoint is open, request isn't sent at all and callback gets
+ * response with circuit_open and TemporaryNetworkFailure error.
+ * Retries are scheduled in thread of pipeline, callback is called there once
+ * with result of last attempt. All methods are thread safe.
+ */
+class CRestRetrier {
+public:
+  /* sends one attempt, returns id of request in pipeline */
+  typedef std::function<CRestPipeline::request_id_t(rest_callback_t)> start_fn_t;
+
+  explicit CRestRetrier(CRestPipeline* pipeline,
+                        const CRestRetryPolicy& policy = CRestRetryPolicy());
+
+  /**
+   * @param endpoint - key of circuit breaker, see endpoint_of()
+   * @param context - if not null and destroyed, retries are stopped and callback isn't called
+   */
+  void enqueue(const QString& endpoint,
+               QObject* context,
+               start_fn_t start,
+               rest_callback_t callback);
+
+  /* scheme, host, port and path of url */
+  static QString endpoint_of(const QUrl& url);
+
+  void set_policy(const CRestRetryPolicy& policy);
+  void set_breaker_params(uint failure_threshold,
+                          uint open_ms,
+                          uint max_open_ms);
+  CRestCircuitBreaker::state_t breaker_state(const QString& endpoint);
+  /* closes all breakers, f.e. after network configuration was changed */
+  void reset();
+
+private:
+  struct call_t {
+    QString endpoint;
+    bool has_context;
+    QPointer<QObject> context;
+    start_fn_t start;
+    rest_callback_t callback;
+    uint attempts;
+  };
+  typedef std::shared_ptr<call_t> call_ptr_t;
+
+  CRestPipeline* m_pipeline;
+  CRestRetryPolicy m_policy;
+  uint m_failure_threshold;
+  uint m_open_ms;
+  uint m_max_open_ms;
+  QMutex m_mutex;
+  QElapsedTimer m_clock;
+  std::map<QString, CRestCircuitBreaker> m_breakers;
+
+  CRestCircuitBreaker& breaker(const QString& endpoint);
+  void attempt(call_ptr_t call);
+  void attempt_finished(call_ptr_t call, const rest_response_t& resp);
+};
+
+#endif // RESTRETRIER_H
@@ -0,0 +1,92 @@
+#ifndef RESTRETRYPOLICY_H
+#define RESTRETRYPOLICY_H
+
+#include <QtGlobal>
+#include "RestPipeline.h"
+
+/**
+ * @brief The CRestRetryPolicy class decides whether failed request should be
+ * repeated and how long to wait before it. Only transient failures (timeouts,
+ * connection errors, 408/429/5xx) are retried. Delay grows exponentially
+ * with random jitter, so clients don't come back to recovering server at once.
+ */
+class CRestRetryPolicy {
+public:
+  static const uint DEFAULT_MAX_ATTEMPTS = 3;
+  static const uint DEFAULT_BASE_DELAY_MS = 1000;
+  static const uint DEFAULT_MAX_DELAY_MS = 30000;
+
+  CRestRetryPolicy(uint max_attempts = DEFAULT_MAX_ATTEMPTS,
+                   uint base_delay_ms = DEFAULT_BASE_DELAY_MS,
+                   uint max_delay_ms = DEFAULT_MAX_DELAY_MS);
+
+  static bool is_transient(const rest_response_t& resp);
+  /* value of Retry-After header in ms, 0 if there is no one */
+  static uint retry_after_ms(const rest_response_t& resp);
+
+  /**
+   * @param attempts - count of already done attempts including this one
+   */
+  bool should_retry(const rest_response_t& resp, uint attempts) const;
+  /**
+   * @brief delay before next attempt : half of exponential delay plus random part
+   * up to another half. Server's Retry-After is respected, but capped by max_delay_ms.
+   */
+  uint delay_ms(uint attempts, uint retry_after_ms = 0) const;
+
+  uint max_attempts() const {return m_max_attempts;}
+
+private:
+  uint m_max_attempts;
+  uint m_base_delay_ms;
+  uint m_max_delay_ms;
+};
+////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief The CRestCircuitBreaker class stops requests to endpoint which fails
+ * constantly. After failure_threshold consecutive failures it's opened and rejects
+ * requests for open period. Then one probe request is allowed (half-open state) :
+ * its success closes breaker, failure opens it again for twice longer period.
+ * Class isn't thread safe, time is passed by caller.
+ */
+class CRestCircuitBreaker {
+public:
+  enum state_t {
+    CB_CLOSED = 0,
+    CB_OPEN,
+    CB_HALF_OPEN
+  };
+
+  static const uint DEFAULT_FAILURE_THRESHOLD = 5;
+  static const uint DEFAULT_OPEN_MS = 15000;
+  static const uint DEFAULT_MAX_OPEN_MS = 300000;
+
+  CRestCircuitBreaker(uint failure_threshold = DEFAULT_FAILURE_THRESHOLD,
+                      uint open_ms = DEFAULT_OPEN_MS,
+                      uint max_open_ms = DEFAULT_MAX_OPEN_MS);
+
+  /* true if request may be sent. In half-open state only one probe is allowed */
+  bool allow_request(qint64 now_ms);
+  void on_success();
+  void on_failure(qint64 now_ms);
+  /* request finished without result (cancelled), probe may be sent again */
+  void on_abandoned();
+
+  state_t state() const {return m_state;}
+  qint64 retry_after_ms(qint64 now_ms) const;
+
+private:
+  uint m_failure_threshold;
+  uint m_base_open_ms;
+  uint m_max_open_ms;
+  state_t m_state;
+  uint m_failures;
+  uint m_open_ms;
+  qint64 m_opened_at;
+  bool m_probe_in_flight;
+
+  void open(qint64 now_ms);
+};
+
+#endif // RESTRETRYPOLICY_H
@@ -5,6 +5,7 @@
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QJsonArray>
+#include <QMutex>
 #include <QObject>
 #include <QtNetwork/QNetworkAccessManager>
 #include <QtNetwork/QNetworkReply>
@@ -14,8 +15,13 @@
 #include <QUrl>
 #include <QUrlQuery>
 #include <QString>
+#include <functional>
 #include <vector>
 #include "RestContainers.h"
+#include "RestCoalescer.h"
+#include "RestPipeline.h"
+#include "RestResponseCache.h"
+#include "RestRetrier.h"
 #include "PeerController.h"
 
 typedef enum rest_error {
@@ -36,6 +42,11 @@ class CRestWorker : public QObject {
 
 private:
   QNetworkAccessManager *m_network_manager;
+  CRestPipeline *m_pipeline;
+  CRestCoalescer *m_coalescer;
+  CRestRetrier *m_retrier;
+  CRestResponseCache m_cache;
+  QString m_auth_scope; // login of current user, hub responses are cached per user
 
   static QNetworkAccessManager* create_network_manager();
   static int free_network_manager(QNetworkAccessManager*nam);
@@ -45,6 +56,12 @@ private:
                                int &err_code,
                                int &network_error);
 
+  static void pre_handle_response(const rest_response_t& resp,
+                                  int &http_code,
+                                  int &err_code,
+                                  int &network_error,
+                                  bool show_network_err_msg);
+
   static QJsonDocument qjson_doc_from_arr(const QByteArray& arr,
                                           int &err_code);
 
@@ -55,11 +72,7 @@ private:
                                    const QByteArray &data,
                                    QNetworkRequest &req);
 
-  static QNetworkReply* delete_reply(QNetworkAccessManager* nam,
-                                    QNetworkRequest &req);
-
-  QByteArray send_request(QNetworkAccessManager *nam,
-      QNetworkRequest &req,
+  QByteArray send_request(QNetworkRequest &req,
       int get,
       int& http_status_code,
       int& err_code,
@@ -68,18 +81,88 @@ private:
       bool show_network_err_msg,
       uint timeout_time = 0);
 
+  /* request builders and response parsers shared by blocking and async calls */
+  static QNetworkRequest login_request(const QString& login,
+                                       const QString& password,
+                                       QByteArray& data);
+  static void parse_login(const rest_response_t& resp,
+                          int &http_code,
+                          int &err_code,
+                          int &network_error);
+
+  static QNetworkRequest user_info_request();
+  static bool parse_user_info(const QString& user_info_type,
+                              const QByteArray& arr,
+                              QString& user_info_str);
+
+  static QNetworkRequest gorjun_file_info_request(const QString& file_name,
+                                                  QString link);
+  static std::vector<CGorjunFileInfo> parse_gorjun_file_info(const QString& file_name,
+                                                             const QByteArray& arr);
+
+  static QNetworkRequest remote_file_meta_request(const CGorjunFileInfo& fi);
+  static std::vector<CComponentMetaFile> parse_remote_file_meta(const QString& file_name,
+                                                                const QByteArray& arr);
+
+  static QNetworkRequest sshkeys_in_environment_request(const QStringList& keys,
+                                                        const QString& env,
+                                                        QByteArray& data);
+  static std::vector<uint8_t> parse_sshkeys_in_environment(const QByteArray& arr);
+
+  static QNetworkRequest sshkey_environments_request(const QString& endpoint,
+                                                     const QString& key_name,
+                                                     const QString& key,
+                                                     const QStringList& lst_environments,
+                                                     QByteArray& data);
+  static void notify_add_sshkey_result(const QString& key_name,
+                                       int http_status_code,
+                                       int err_code,
+                                       int network_error);
+
+  /* conditional GET through m_cache, identical requests in flight are joined
+   * by m_coalescer. unchanged means that body is the same
+   * as one already handled by consumer, so it may skip parsing.
+   * parser (if any) gets body while it's being received */
+  typedef std::function<void(const rest_response_t& resp, bool unchanged)> cached_callback_t;
+  rest_response_t execute_cached_get(const QString& key,
+                                     QNetworkRequest& req,
+                                     uint timeout_ms);
+  CRestPipeline::request_id_t enqueue_cached_get(const QString& key,
+                                                 QNetworkRequest& req,
+                                                 uint timeout_ms,
+                                                 QObject* context,
+                                                 cached_callback_t callback,
+                                                 rest_body_parser_t parser = rest_body_parser_t());
+
+  /* new parser for every attempt, previous one may have seen broken body */
+  typedef std::function<rest_body_parser_t()> parser_factory_t;
+  typedef void (CRestWorker::*hub_data_handler_t)(const QString& cache_key,
+                                                  const rest_response_t& resp,
+                                                  bool unchanged);
+  void update_hub_data(const QString& endpoint,
+                       hub_data_handler_t handler,
+                       parser_factory_t parser_factory);
+  void get_my_peers_finished(const QString& cache_key,
+                             const rest_response_t& resp,
+                             bool unchanged);
+  void get_environments_finished(const QString& cache_key,
+                                 const rest_response_t& resp,
+                                 bool unchanged);
+  void get_balance_finished(const QString& cache_key,
+                            const rest_response_t& resp,
+                            bool unchanged);
+  void get_p2p_status_finished(const rest_response_t& resp);
+  void set_auth_scope(const QString& login);
+
   CRestWorker();
   ~CRestWorker(void);
 
 private slots:
-  void get_my_peers_finished_sl();
-  void get_environments_finished_sl();
-  void get_balance_finished_sl();
   void check_if_ss_console_is_ready_finished_sl();
-  void get_p2p_status_finished_sl();
 
 signals:
-
+  /* update_my_peers(), update_environments() and update_balance() report
+   * RE_NO_UPDATES with empty data when hub returned the same data as last time */
   void on_get_my_peers_finished(std::vector<CMyPeerInfo>,
                                 int http_code,
                                 int err_code,
@@ -142,10 +225,12 @@ public:
                   int &http_code,
                   int &network_error);
 
+  /* called in thread of CRestWorker with fingerprint or info value, "undefined" on error */
+  typedef std::function<void(const QString& output)> peer_info_callback_t;
+
   void peer_finger(const QString& port,
-                   CPeerController::peer_info_t type,
                    QString name,
-                   QString dir);
+                   peer_info_callback_t callback);
 
   void peer_set_pass(const QString& port,
                      const QString& username,
@@ -154,9 +239,8 @@ public:
 
   void peer_get_info(const QString& port,
                      QString peer_info_type,
-                     CPeerController::peer_info_t type,
                      QString name,
-                     QString dir);
+                     peer_info_callback_t callback);
 
   void peer_login(const QString& port,
                   const QString& username,
@@ -191,6 +275,54 @@ public:
 
   static const QString& rest_err_to_str(rest_error_t err);
 
+  /* Non-blocking versions of calls above. Callbacks are called in thread of
+   * CRestWorker (GUI thread) and aren't called if context was destroyed. */
+  typedef std::function<void(int http_code, int err_code, int network_error)> login_callback_t;
+  typedef std::function<void(bool ok, const QString& user_info_str)> user_info_callback_t;
+  typedef std::function<void(std::vector<CGorjunFileInfo>)> gorjun_file_info_callback_t;
+  typedef std::function<void(std::vector<CComponentMetaFile>)> remote_file_meta_callback_t;
+  typedef std::function<void(std::vector<uint8_t>)> sshkeys_in_environment_callback_t;
+  typedef std::function<void()> done_callback_t;
+
+  CRestPipeline::request_id_t login_async(const QString& login,
+                                          const QString& password,
+                                          QObject* context,
+                                          login_callback_t callback);
+
+  CRestPipeline::request_id_t get_user_info_async(const QString& user_info_type,
+                                                  QObject* context,
+                                                  user_info_callback_t callback);
+
+  CRestPipeline::request_id_t get_gorjun_file_info_async(const QString& file_name,
+                                                         QObject* context,
+                                                         gorjun_file_info_callback_t callback,
+                                                         QString link = "");
+
+  void download_remote_file_meta_async(const QString& file_name,
+                                       QObject* context,
+                                       remote_file_meta_callback_t callback);
+
+  CRestPipeline::request_id_t is_sshkeys_in_environment_async(const QStringList& keys,
+                                                              const QString& env,
+                                                              QObject* context,
+                                                              sshkeys_in_environment_callback_t callback);
+
+  CRestPipeline::request_id_t add_sshkey_to_environments_async(const QString& key_name,
+                                                               const QString& key,
+                                                               const QStringList& lst_environments,
+                                                               QObject* context,
+                                                               done_callback_t callback);
+
+  CRestPipeline::request_id_t remove_sshkey_from_environments_async(const QString& key_name,
+                                                                    const QString& key,
+                                                                    const QStringList& lst_environments,
+                                                                    QObject* context,
+                                                                    done_callback_t callback);
+
+  void cancel_request(CRestPipeline::request_id_t id);
+  CRestPipeline* pipeline() const {return m_pipeline;}
+  CRestCoalescer* coalescer() const {return m_coalescer;}
+
   std::vector<uint8_t> is_sshkeys_in_environment(const QStringList &keys,
                                               const QString& env);
 
@@ -202,13 +334,15 @@ public:
                                        const QString &key,
                                        const QStringList &lst_environments);
 public:
+  /* next versions are set by update check threads, so they are guarded */
   void set_next_cc_version(const QString& version);
   void set_next_p2p_version(const QString& version);
   void set_next_vagrant_version(const QString& version);
-  const QString& get_next_cc_version() const;
-  const QString& get_next_p2p_version() const;
-  const QString& get_next_vagrant_version() const;
+  QString get_next_cc_version() const;
+  QString get_next_p2p_version() const;
+  QString get_next_vagrant_version() const;
 private:
+  mutable QMutex m_next_versions_mutex;
   QString next_cc_version;
   QString next_p2p_version;
   QString next_vagrant_version;
@@ -21,6 +21,7 @@ class CSettingsManager : public QObject {
   static const QString SM_P2P_PATH;
   static const QString SM_X2GOCLIENT_PATH;
   static const QString SM_NOTIFICATION_DELAY_SEC;
+  static const QString SM_TRANSFER_PARALLEL_COUNT;
   static const QString SM_PLUGIN_PORT;
   static const QString SM_SSH_PATH;
   static const QString SM_SCP_PATH;
@@ -105,6 +106,7 @@ class CSettingsManager : public QObject {
   QString m_default_firefox_profile;
 
   uint32_t m_notification_delay_sec;
+  uint32_t m_transfer_parallel_count;
 
   uint16_t m_plugin_port;
   QString m_ssh_path;
@@ -176,6 +178,8 @@ class CSettingsManager : public QObject {
  public:
   static const int NOTIFICATION_DELAY_MIN = 3;
   static const int NOTIFICATION_DELAY_MAX = 300;
+  static const int TRANSFER_PARALLEL_COUNT_MIN = 1;
+  static const int TRANSFER_PARALLEL_COUNT_MAX = 16;
 
   enum update_freq_t {
     UF_MIN1 = 0,
@@ -219,6 +223,8 @@ class CSettingsManager : public QObject {
   uint32_t locale() const { return m_locale; }
   const QString& p2p_path() const { return m_p2p_path; }
   uint32_t notification_delay_sec() const { return m_notification_delay_sec; }
+  /* files copied at once by transfer dialog */
+  uint32_t transfer_parallel_count() const { return m_transfer_parallel_count; }
   uint16_t plugin_port() const { return m_plugin_port; }
   const QString& ssh_path() const { return m_ssh_path; }
   const QString& scp_path() const { return m_scp_path; }
@@ -301,6 +307,15 @@ class CSettingsManager : public QObject {
       m_notification_delay_sec = NOTIFICATION_DELAY_MIN;
     m_settings.setValue(SM_NOTIFICATION_DELAY_SEC, m_notification_delay_sec);
   }
+
+  void set_transfer_parallel_count(uint32_t count) {
+    m_transfer_parallel_count = count;
+    if (count > TRANSFER_PARALLEL_COUNT_MAX)
+      m_transfer_parallel_count = TRANSFER_PARALLEL_COUNT_MAX;
+    if (count < TRANSFER_PARALLEL_COUNT_MIN)
+      m_transfer_parallel_count = TRANSFER_PARALLEL_COUNT_MIN;
+    m_settings.setValue(SM_TRANSFER_PARALLEL_COUNT, m_transfer_parallel_count);
+  }
   /**********************/
 
   void set_logs_level(int logs_level);
@@ -0,0 +1,89 @@
+#ifndef SSHKEYCHECKER_H
+#define SSHKEYCHECKER_H
+
+#include <functional>
+#include <map>
+#include <vector>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+#include "RestContainers.h"
+
+/**
+ * @brief The CSshKeyChecker class answers which ssh keys are present in which
+ * environments. Results are cached per key fingerprint and environment revision,
+ * so bazaar is asked only about new keys and changed environments. Keys may be
+ * added or removed on bazaar side without change of environment, so result
+ * older than ttl is checked again.
+ * Missing pairs are requested with one request per environment, requests for
+ * different environments are sent in parallel, but not more than max_parallel at once.
+ */
+class CSshKeyChecker {
+public:
+  static const int DEFAULT_MAX_PARALLEL = 4;
+  static const uint DEFAULT_TIMEOUT_MS = 60000;
+  static const int DEFAULT_TTL_MS = 5 * 60 * 1000;
+
+  /* one flag per key, in the same order as keys. Any other size means failure */
+  typedef std::function<void(const std::vector<uint8_t>&)> result_callback_t;
+  /* asynchronous check of keys in environment, result_callback_t may be called in any thread */
+  typedef std::function<void(const QStringList& keys,
+                             const QString& env_id,
+                             result_callback_t callback)> check_fn_t;
+
+  struct env_t {
+    QString id;
+    QString revision;
+  };
+
+  explicit CSshKeyChecker(check_fn_t check_fn,
+                          int max_parallel = DEFAULT_MAX_PARALLEL);
+
+  static QString fingerprint(const QString& key_content);
+  /* changes when environment is changed on bazaar side */
+  static QString revision(const CEnvironment& env);
+
+  /**
+   * @brief blocks until all missing pairs are checked or timeout is over.
+   * Mustn't be called from thread where callbacks of check_fn are called.
+   * @return flags aligned with keys for every environment with known result.
+   * Environments which couldn't be checked aren't in result.
+   */
+  std::map<QString, std::vector<uint8_t> > check(const QStringList& keys,
+                                                 const std::vector<env_t>& envs,
+                                                 uint timeout_ms = DEFAULT_TIMEOUT_MS);
+
+  /* keys of environment were changed by us (uploaded or removed) */
+  void invalidate_environment(const QString& env_id);
+  void invalidate_key(const QString& key_content);
+  /* drops environments which aren't in list */
+  void retain_environments(const std::vector<env_t>& envs);
+  void clear();
+
+  int ttl() const;
+  void set_ttl(int ttl_ms);
+
+private:
+  struct key_state_t {
+    bool present;
+    qint64 checked_ms;
+  };
+
+  struct env_entry_t {
+    QString revision;
+    std::map<QString, key_state_t> keys; // fingerprint -> state
+  };
+
+  check_fn_t m_check_fn;
+  int m_max_parallel;
+  QElapsedTimer m_clock;
+  mutable QMutex m_mutex;  // guards members below
+  int m_ttl_ms;
+  std::map<QString, env_entry_t> m_cache;
+
+  /* called with locked mutex */
+  bool is_fresh(const env_entry_t& entry, const QString& fp) const;
+};
+
+#endif // SSHKEYCHECKER_H
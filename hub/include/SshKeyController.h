@@ -10,6 +10,7 @@
 #include <QMutexLocker>
 #include <map>
 #include "RestWorker.h"
+#include "SshKeyChecker.h"
 #include "DlgGenerateSshKey.h"
 
 struct SshKey {
@@ -121,6 +122,10 @@ private:
 
   // key: env id, value: env name.
   std::map<QString, QString> m_lst_healthy_environments;
+  // key: env id, value: revision of environment, see CSshKeyChecker::revision
+  std::map<QString, QString> m_healthy_env_revisions;
+  // cached results of checks with bazaar
+  CSshKeyChecker m_checker;
   QMutex m_mutex; // mutex for check ssh keys with bazaar
   QMutex m_timer_mutex;
   QMutex m_upload_remove;
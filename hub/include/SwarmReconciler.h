@@ -0,0 +1,121 @@
+#ifndef SWARMRECONCILER_H
+#define SWARMRECONCILER_H
+
+#include <map>
+#include <vector>
+#include <QDateTime>
+#include <QHash>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include "InterfaceIdAllocator.h"
+#include "P2PStateTracker.h"
+#include "RestContainers.h"
+
+/**
+ * @brief Actions which bring p2p daemon to state wanted by hub.
+ * Environments in join have base_interface_id set.
+ * connected and disconnected are environments whose swarm appeared or
+ * disappeared since previous reconcile(). rh_local is changed part of
+ * table "resource host (peer id) has container on this machine".
+ */
+struct swarm_actions_t {
+  std::vector<CEnvironment> join;
+  QStringList leave;
+  std::vector<CEnvironment> check;
+  QStringList connected;
+  QStringList disconnected;
+  std::map<QString, bool> rh_local;
+
+  bool empty() const {
+    return join.empty() && leave.empty() && check.empty() &&
+        connected.empty() && disconnected.empty() && rh_local.empty();
+  }
+};
+////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief The CSwarmReconciler class keeps desired state (environments of hub)
+ * and actual state (swarms, interfaces and peers of p2p daemon, containers in lxc)
+ * indexed by swarm hash and computes actions from what has changed between calls.
+ * Only environments whose inputs changed are evaluated again: environment itself,
+ * presence of its swarm, its interface or states of its peers.
+ * Join is not repeated while previous one is running, failed join is repeated
+ * on next reconcile(). Containers whose peers aren't reported by p2p REST
+ * are checked by `p2p show`, so their environments are checked on every reconcile().
+ * Not thread safe, used from thread of P2PConnector.
+ */
+class CSwarmReconciler {
+public:
+  explicit CSwarmReconciler(int interface_ids = CInterfaceIdAllocator::DEFAULT_CAPACITY);
+
+  void set_environments(const std::vector<CEnvironment>& envs);
+  /* swarm actions aren't computed while daemon isn't running */
+  void set_p2p_state(const p2p_state_t& state);
+  /* host names of containers on this machine */
+  void set_local_containers(const QStringList& hostnames);
+
+  swarm_actions_t reconcile();
+
+  void join_finished(const QString& hash, bool success);
+  void leave_finished(const QString& hash);
+
+  /**
+   * @brief reads rootfs/etc/hostname of containers in lxc_path,
+   * file is read again only when its modification time or size changes
+   */
+  QStringList read_local_containers(const QString& lxc_path);
+
+  int dirty_count() const {return m_dirty.size();}
+  int interface_id(const QString& hash) const {return m_interface_ids.id_of(hash);}
+  /* count of environments evaluated by last reconcile() */
+  int evaluated_count() const {return m_evaluated;}
+
+private:
+  struct env_record_t {
+    CEnvironment env;
+    bool joined;
+    bool reported;        // joined was published in connected/disconnected
+    bool join_running;
+    QSet<QString> local_peers;   // peer ids with containers on this machine
+  };
+
+  QHash<QString, env_record_t> m_envs;   // desired, by swarm hash
+  QSet<QString> m_dirty;
+
+  bool m_running;
+  bool m_peers_known;
+  QSet<QString> m_swarms;                // actual
+  QHash<QString, QString> m_interfaces;
+  QHash<QString, QString> m_peers;
+  QHash<QString, uint> m_peers_stamp;    // by swarm hash
+  QSet<QString> m_leaving;
+  QSet<QString> m_recheck;               // joined, state of some containers isn't in m_peers
+
+  CInterfaceIdAllocator m_interface_ids;
+
+  QSet<QString> m_local;
+  bool m_local_changed;
+  QHash<QString, bool> m_local_match;    // container name -> on this machine
+  QHash<QString, QSet<QString> > m_envs_of_peer;  // peer id -> swarm hashes
+  QSet<QString> m_local_dirty_envs;
+  QSet<QString> m_local_dirty_peers;
+  QHash<QString, bool> m_rh_local;
+
+  struct hostname_t {
+    QDateTime modified;
+    qint64 size;
+    QString name;
+  };
+  QHash<QString, hostname_t> m_hostnames;  // by path of hostname file
+  int m_evaluated;
+
+  void evaluate(const QString& hash, swarm_actions_t& res);
+  void evaluate_local(env_record_t& rec);
+  void add_env_peers(const CEnvironment& env);
+  void remove_env_peers(const CEnvironment& env);
+  void mark_all_dirty();
+  bool is_local(const QString& cont_name);
+};
+
+#endif // SWARMRECONCILER_H
@@ -2,6 +2,7 @@
 #define SYSTEMCALLWRAPPER_H
 
 #include <stdint.h>
+#include <functional>
 #include <QObject>
 #include <QString>
 #include <string>
@@ -11,6 +12,8 @@
 #include <QMutexLocker>
 #include "VagrantProvider.h"
 
+class QAtomicInt;
+
 //give type for restart p2p
 enum restart_p2p_type{
     UPDATED_P2P=0, //when p2p updated, stop and start
@@ -49,7 +52,8 @@ enum system_call_wrapper_error_t {
   SCWE_DIR_DOESNT_EXIST,
   SCWE_DIR_EXISTS,
   SCWE_COMMAND_FAILED,
-  SCWE_WRONG_TEMP_PATH
+  SCWE_WRONG_TEMP_PATH,
+  SCWE_CANCELLED
 };
 ////////////////////////////////////////////////////////////////////////////
 
@@ -69,7 +73,6 @@ enum restart_service_error_t { RSE_SUCCESS, RSE_MANUAL };
 ////////////////////////////////////////////////////////////////////////////
 
 static QMutex installer_is_busy;
-static QMutex vagrant_is_busy;
 static QMutex p2p_is_busy;
 
 ////////////////////////////////////////////////////////////////////////////
@@ -146,13 +149,17 @@ class CSystemCallWrapper {
                                                   const QString &key,
                                                   const QString &commands);
 
+  /* sftp on session kept for container, scp if sftp session can't be opened.
+   * progress gets bytes done and total, sftp copy stops when cancel is set */
   static std::pair<system_call_wrapper_error_t, QStringList>
                                                  upload_file (
                                                  const QString &remote_user,
                                                  const QString &ip,
                                                  std::pair <QString, QString> ssh_info,
                                                  const QString &destination,
-                                                 const QString &file_path
+                                                 const QString &file_path,
+                                                 std::function<void(quint64, quint64)> progress = nullptr,
+                                                 const QAtomicInt *cancel = nullptr
                                                  );
 
   static std::pair<system_call_wrapper_error_t, QStringList>
@@ -161,7 +168,9 @@ class CSystemCallWrapper {
                                                     const QString &ip,
                                                     std::pair <QString, QString> ssh_info,
                                                     const QString &local_destination,
-                                                    const QString &remote_file_path
+                                                    const QString &remote_file_path,
+                                                    std::function<void(quint64, quint64)> progress = nullptr,
+                                                    const QAtomicInt *cancel = nullptr
                                                     );
 
   static system_call_wrapper_error_t join_to_p2p_swarm(const QString &hash,
@@ -173,7 +182,8 @@ class CSystemCallWrapper {
   static system_call_wrapper_error_t restart_p2p_service(int *res_code, restart_p2p_type type);
 
   static system_call_wrapper_error_t check_container_state(const QString &hash,
-                                                           const QString &ip);
+                                                           const QString &ip,
+                                                           unsigned long timeout_msec = ULONG_MAX);
 
   static system_call_wrapper_error_t run_sshkey_in_terminal(const QString &user,
                                                          const QString &ip,
@@ -187,7 +197,10 @@ class CSystemCallWrapper {
   static system_call_wrapper_error_t vagrant_init(const QString &dir, const QString &box);
   static system_call_wrapper_error_t vagrant_box_update(const QString &box, const QString &provider);
   static system_call_wrapper_install_t vagrant_box_remove(const QString &box, const QString &provider);
+  /* cached, see CVagrantStatusCache */
   static QString vagrant_status(const QString &dir);
+  /* ok is false when vagrant failed, such result isn't cached */
+  static QString vagrant_status_uncached(const QString &dir, bool *ok = nullptr);
   static QString vagrant_ip(const QString &dir);
   static QString vagrant_port(const QString &dir);
   static system_call_wrapper_error_t vagrant_update_peeros(const QString &port, const QString &peer_name);
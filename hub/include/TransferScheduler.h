@@ -0,0 +1,150 @@
+#ifndef TRANSFERSCHEDULER_H
+#define TRANSFERSCHEDULER_H
+
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <utility>
+#include <vector>
+#include <QAtomicInt>
+#include <QMutex>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QThreadPool>
+#include "SystemCallWrapper.h"
+
+/**
+ * @brief The CTransferScheduler class runs file transfers (and removals) on
+ * own pool of not more than max_workers threads instead of thread per file,
+ * so selecting hundreds of files doesn't start hundreds of copies fighting for
+ * the link. All transfer dialogs share Instance(), so the limit and turns of
+ * containers hold for the whole tray.
+ * Next job is chosen so:
+ *  - job with higher priority goes first;
+ *  - containers (groups) with jobs of the same priority take turns, one
+ *    container with many files doesn't hold back others;
+ *  - not more than max_per_group jobs of one container run at once;
+ *  - small files of one container are batched, batch runs in one worker
+ *    one file after another and reuses its connection.
+ * Queued job can be cancelled or get other priority. Running job gets cancel flag
+ * from cancel() or cancel_all() and should return soon with SCWE_CANCELLED.
+ * Signals may come from threads of pool, job_finished comes in thread of scheduler.
+ */
+class CTransferScheduler : public QObject {
+  Q_OBJECT
+public:
+  typedef quint64 job_id_t;
+  typedef std::pair<system_call_wrapper_error_t, QStringList> result_t;
+  typedef std::function<void(quint64 done, quint64 total)> progress_t;
+  /* blocking, runs in thread of pool, checks cancel between chunks of work */
+  typedef std::function<result_t(progress_t progress, const QAtomicInt* cancel)> job_t;
+
+  enum priority_t {
+    TP_LOW = -1,
+    TP_NORMAL = 0,
+    TP_HIGH = 1
+  };
+
+  static const int DEFAULT_MAX_WORKERS = 4;
+  /* CSftpTransfer keeps several sessions per container, so a few files of
+   * one container go in parallel */
+  static const int DEFAULT_MAX_PER_GROUP = 2;
+  static const quint64 SMALL_FILE_SIZE = 256 * 1024;
+  static const int MAX_BATCH_COUNT = 32;
+  static const quint64 MAX_BATCH_SIZE = 4 * 1024 * 1024;
+  static const int PROGRESS_INTERVAL_MS = 200;
+
+  explicit CTransferScheduler(int max_workers = DEFAULT_MAX_WORKERS,
+                              int max_per_group = DEFAULT_MAX_PER_GROUP,
+                              QObject* parent = nullptr);
+  /* cancels all jobs, waits for running ones */
+  ~CTransferScheduler();
+  /* shared by transfer dialogs, lives in main thread */
+  static CTransferScheduler* Instance();
+
+  /**
+   * @param group - usually host and port of container
+   * @param size - bytes to copy, small jobs are batched
+   * Thread safe.
+   */
+  job_id_t enqueue(const QString& group, quint64 size, int priority, job_t job);
+
+  /* running job gets cancel flag.
+   * @return false if job has started or finished already. Thread safe */
+  bool cancel(job_id_t id);
+  /* cancel() of every job.
+   * @return count of cancelled queued jobs. Thread safe */
+  int cancel_all();
+  /**
+   * @brief for owner which is being destroyed: cancels all jobs and deletes
+   * scheduler in its thread when running jobs return, so owner doesn't wait
+   * for them. Scheduler loses parent, signals aren't emitted after it.
+   */
+  void close();
+  /* @return false if job isn't queued */
+  bool set_priority(job_id_t id, int priority);
+
+  /* running jobs aren't stopped if limit decreases */
+  void set_max_workers(int max_workers);
+  int max_workers() const;
+  int max_per_group() const {return m_max_per_group;}
+  int queued_count() const;
+  /* jobs taken by workers (batched ones too) and not finished yet */
+  int running_count() const;
+
+private:
+  enum job_state_t {
+    JS_QUEUED = 0,
+    JS_RUNNING,
+    JS_CANCELLED
+  };
+
+  struct job_rec_t {
+    job_id_t id;
+    QString group;
+    quint64 size;
+    int priority;
+    job_t job;
+    QAtomicInt state;
+    QAtomicInt cancel;
+  };
+  typedef std::shared_ptr<job_rec_t> job_ptr_t;
+  /* higher priority first, then older */
+  typedef std::pair<int, job_id_t> queue_key_t;
+  typedef std::map<queue_key_t, job_ptr_t> group_queue_t;
+
+  QThreadPool m_pool;
+  int m_max_per_group;
+  mutable QMutex m_mutex;   // guards members below
+  int m_max_workers;
+  std::map<QString, group_queue_t> m_queues;
+  // groups with queued jobs in order of their turn
+  std::deque<QString> m_turns;
+  std::map<QString, int> m_running_groups;
+  std::map<job_id_t, job_ptr_t> m_jobs;
+  int m_busy_workers;
+  job_id_t m_last_id;
+  bool m_closed;
+
+  static queue_key_t queue_key(const job_rec_t& job) {
+    return std::make_pair(-job.priority, job.id);
+  }
+  void dispatch();
+  void run_batch(const std::vector<job_ptr_t>& batch);
+  /* functions below are called with locked mutex */
+  int queued_count_locked() const;
+  int running_in_group(const QString& group) const;
+  std::vector<job_ptr_t> take_next();
+
+private slots:
+  void job_finished_sl(quint64 id, int res, QStringList output, bool last_in_batch);
+
+signals:
+  void job_started(quint64 id);
+  void job_progress(quint64 id, quint64 done, quint64 total, quint64 bytes_per_sec);
+  void job_finished(quint64 id, int res, QStringList output);
+};
+
+#endif // TRANSFERSCHEDULER_H
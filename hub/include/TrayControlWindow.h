@@ -90,9 +90,14 @@ public:
   bool is_p2p_avaibale();
 private:
   Ui::TrayControlWindow *ui;
+  std::vector<QString> m_lst_checked_unhealthy_env;
+  // environments which became unhealthy during current refresh, by status
+  std::map<QString, std::vector<QString> > m_tbl_unhealthy_envs;
+  std::map<QString, std::vector<int> > m_tbl_unhealthy_env_ids;
   void save_current_pid();
   static QDialog *last_generated_env_dlg(QWidget *p);
   void generate_env_dlg(const CEnvironment *env);
+  void update_environment_action(const CEnvironment& env);
   static QDialog *m_last_generated_env_dlg;
 
   static QDialog *last_generated_transferfile_dlg(QWidget *p);
@@ -187,6 +192,9 @@ private slots:
   void login_success();
 
   /*hub slots*/
+  void environment_added_sl(const CEnvironment& env);
+  void environment_changed_sl(const CEnvironment& prev, const CEnvironment& env);
+  void environment_removed_sl(const CEnvironment& env);
   void environments_updated_sl(int rr);
   void balance_updated_sl();
   void user_name_updated_sl();
@@ -0,0 +1,108 @@
+#ifndef VAGRANTSTATUSCACHE_H
+#define VAGRANTSTATUSCACHE_H
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <QElapsedTimer>
+#include <QFileSystemWatcher>
+#include <QMutex>
+#include <QObject>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include "SystemCallWrapper.h"
+
+/**
+ * @brief The CVagrantStatusCache class keeps results of `vagrant status` per
+ * peer directory and result of `vagrant global-status`. Entry of peer is dropped
+ * when something changes in its .vagrant/machines/* state directories, its
+ * provision_step or its `*_finished`, `*_up` etc. markers, global-status is dropped
+ * when vagrant's machine index changes. Changes are found by QFileSystemWatcher
+ * and confirmed by comparing stamp of watched files (names, sizes, mtimes, lock files
+ * are ignored), so vagrant touching its own files doesn't drop entries and
+ * vagrant is run again only for peers whose state on disk has changed.
+ * VM can also be stopped behind vagrant's back (VirtualBox GUI, crash),
+ * so entries expire after MAX_AGE_MS anyway.
+ * Vagrant runs one command per machine, so commands are serialized
+ * per peer directory only, see dir_lock().
+ * status() and global_status() are thread safe and may block while vagrant runs.
+ */
+class CVagrantStatusCache : public QObject {
+  Q_OBJECT
+public:
+  static const int MAX_AGE_MS = 5 * 60 * 1000;
+
+  /* returns false if status is unknown because vagrant failed, it isn't cached then */
+  typedef std::function<bool(const QString& dir, QString& status)> status_probe_t;
+  typedef std::function<system_call_res_t()> global_probe_t;
+
+  /**
+   * @param machine_index_dir - directory of vagrant's machine index,
+   * empty means global-status isn't cached
+   */
+  CVagrantStatusCache(status_probe_t status_probe,
+                      global_probe_t global_probe,
+                      const QString& machine_index_dir,
+                      QObject* parent = nullptr);
+
+  static CVagrantStatusCache* Instance();
+
+  QString status(const QString& dir);
+  system_call_res_t global_status();
+
+  bool is_cached(const QString& dir) const;
+  void invalidate(const QString& dir);
+  void clear();
+
+  /* lock of vagrant commands in dir, shared by all users of that dir */
+  std::shared_ptr<QMutex> dir_lock(const QString& dir);
+
+  /* count of vagrant runs, i.e. cache misses */
+  quint64 probes_count() const;
+
+  /* value of `state` from output of `vagrant status --machine-readable` */
+  static QString parse_machine_readable_state(const QStringList& out);
+  /* $VAGRANT_HOME/data/machine-index */
+  static QString default_machine_index_dir();
+
+private:
+  struct entry_t {
+    QString status;
+    QString stamp;   // of watched paths, taken after probe
+    bool valid;
+    quint64 generation;   // is increased on every invalidation
+    QElapsedTimer age;
+
+    entry_t() : valid(false), generation(0) {}
+  };
+
+  status_probe_t m_status_probe;
+  global_probe_t m_global_probe;
+  QString m_machine_index_dir;
+  QFileSystemWatcher m_watcher;
+
+  mutable QMutex m_mutex;   // guards members below
+  std::map<QString, entry_t> m_entries;
+  std::map<QString, std::shared_ptr<QMutex> > m_dir_locks;
+  std::map<QString, QSet<QString> > m_path_to_dirs;   // watched path -> peer dirs
+  entry_t m_global;
+  system_call_res_t m_global_res;
+  quint64 m_probes_count;
+
+  QMutex m_global_probe_mutex;
+
+  static QString key_of(const QString& dir);
+  static QStringList paths_to_watch(const QString& dir);
+  static QString stamp_of(const QStringList& paths);
+  bool fresh_locked(const entry_t& et) const;
+  void request_watch(const QString& key);
+  void invalidate_locked(entry_t& et);
+
+private slots:
+  void watch_sl(const QString& key);
+  void watch_global_sl();
+  void path_changed_sl(const QString& path);
+};
+
+#endif // VAGRANTSTATUSCACHE_H
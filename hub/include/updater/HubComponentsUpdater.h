@@ -101,6 +101,8 @@ namespace update_system {
     void set_update_freq(const QString& component_id, CSettingsManager::update_freq_t freq);
     void set_component_autoupdate(const QString& component_id,
                                   bool autoupdate);
+    void update_component_check_finished(const QString& component_id,
+                                         bool update_available);
 
   public:
 
@@ -0,0 +1,57 @@
+#include <exception>
+#include <QDebug>
+#include <QtConcurrent/QtConcurrent>
+
+#include "BoundedTaskRunner.h"
+
+const int CBoundedTaskRunner::DEFAULT_MAX_WORKERS;
+
+CBoundedTaskRunner::CBoundedTaskRunner(int max_workers) :
+  m_aborted(0) {
+  m_pool.setMaxThreadCount(max_workers > 0 ? max_workers : 1);
+}
+
+CBoundedTaskRunner::~CBoundedTaskRunner() {
+  abort();
+  m_pool.waitForDone();
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CBoundedTaskRunner::add(task_t task) {
+  if (task) m_tasks.push_back(task);
+}
+////////////////////////////////////////////////////////////////////////////
+
+bool
+CBoundedTaskRunner::run() {
+  std::vector<task_t> tasks;
+  tasks.swap(m_tasks);
+
+  QAtomicInt* aborted = &m_aborted;
+  for (auto i = tasks.begin(); i != tasks.end(); ++i) {
+    task_t task = *i;
+    QtConcurrent::run(&m_pool, [task, aborted]() {
+      if (aborted->load() != 0) return;
+      try {
+        task();
+      } catch (std::exception& ex) {
+        qCritical() << "Task of bounded runner failed:" << ex.what();
+      } catch (...) {
+        qCritical() << "Task of bounded runner failed with unknown exception";
+      }
+    });
+  }
+
+  // not QFuture::waitForFinished(), it may run queued task in this thread
+  // and exceed the limit of workers.
+  m_pool.waitForDone();
+  return m_aborted.fetchAndStoreOrdered(0) == 0;
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CBoundedTaskRunner::abort() {
+  m_aborted.store(1);
+}
+////////////////////////////////////////////////////////////////////////////
@@ -664,25 +664,6 @@ DlgAbout::~DlgAbout() { delete ui; }
 void DlgAbout::check_for_versions_and_updates() {
   // There are 2 steps of initialization: version checking and update checking
   // see DlgAboutInitializer::do_initialization() for more details
-    std::vector<CComponentMetaFile> cc_meta = CRestWorker::Instance()->download_remote_file_meta(tray_kurjun_file_name());
-    if (!cc_meta.empty())
-    {
-        std::vector<CComponentMetaFile>::iterator cc_it = cc_meta.begin();
-        CRestWorker::Instance()->set_next_cc_version(cc_it->version());
-    }
-    std::vector<CComponentMetaFile> p2p_meta = CRestWorker::Instance()->download_remote_file_meta(p2p_kurjun_file_name());
-    if (!p2p_meta.empty())
-    {
-        std::vector<CComponentMetaFile>::iterator p2p_it = p2p_meta.begin();
-        CRestWorker::Instance()->set_next_p2p_version(p2p_it->version());
-    }
-    std::vector<CComponentMetaFile> vagrant_meta = CRestWorker::Instance()->download_remote_file_meta(vagrant_kurjun_package_name());
-    if (!vagrant_meta.empty())
-    {
-        std::vector<CComponentMetaFile>::iterator vagrant_it = vagrant_meta.begin();
-        CRestWorker::Instance()->set_next_vagrant_version(vagrant_it->version());
-    }
-    
   int cur_components_count = DlgAboutInitializer::COMPONENTS_COUNT - 1; // -1 for CC version check
   QString current_hypervisor = VagrantProvider::Instance()->CurrentVal();
   QString current_browser = CSettingsManager::Instance().default_browser();
@@ -710,6 +691,7 @@ void DlgAbout::check_for_versions_and_updates() {
   cur_components_count -= 2;
 #endif
   ui->pb_initialization_progress->setMaximum(cur_components_count);
+  ui->pb_initialization_progress->setValue(0);
 
   ui->btn_recheck->setEnabled(false);
   ui->pb_initialization_progress->setEnabled(true);
@@ -1213,7 +1195,9 @@ void DlgAbout::initialization_finished() {
 
 void DlgAbout::init_progress_sl(int part, int total) {
   UNUSED_ARG(total);
-  ui->pb_initialization_progress->setValue(part);
+  // probes are finished in parallel, so progress may come out of order
+  if (part > ui->pb_initialization_progress->value())
+    ui->pb_initialization_progress->setValue(part);
 }
 ////////////////////////////////////////////////////////////////////////////
 
@@ -1569,119 +1553,122 @@ void DlgAbout::update_available_sl(const QString& component_id,
 }
 ////////////////////////////////////////////////////////////////////////////
 
-void DlgAboutInitializer::do_initialization() {
-  try {
-    int initialized_component_count = 0;
-    VagrantProvider::PROVIDERS provider = VagrantProvider::Instance()->CurrentProvider();
-
-    QString p2p_version = get_p2p_version();
-    emit got_p2p_version(p2p_version);
-    emit init_progress(++initialized_component_count, COMPONENTS_COUNT);
+void DlgAboutInitializer::component_done() {
+  emit init_progress(m_progress.fetchAndAddOrdered(1) + 1, COMPONENTS_COUNT);
+}
+////////////////////////////////////////////////////////////////////////////
 
-    if (CSettingsManager::Instance().default_browser() == "Chrome") {
-      QString chrome_version;
-      CSystemCallWrapper::chrome_version(chrome_version);
-      emit got_chrome_version(chrome_version);
-      emit init_progress(++initialized_component_count, COMPONENTS_COUNT);
-    }
+void DlgAboutInitializer::add_meta_download(
+    const QString& file_name,
+    void (CRestWorker::*set_next_version)(const QString&)) {
+  m_runner->add([file_name, set_next_version]() {
+    std::vector<CComponentMetaFile> meta =
+        CRestWorker::Instance()->download_remote_file_meta(file_name);
+    if (!meta.empty())
+      (CRestWorker::Instance()->*set_next_version)(meta.begin()->version());
+  });
+}
+////////////////////////////////////////////////////////////////////////////
 
-    if (CSettingsManager::Instance().default_browser() == "Firefox") {
-      QString firefox_version;
-      CSystemCallWrapper::firefox_version(firefox_version);
-      emit got_firefox_version(firefox_version);
-      emit init_progress(++initialized_component_count, COMPONENTS_COUNT);
-    }
+void DlgAboutInitializer::add_version_probe(
+    QString (*probe)(),
+    void (DlgAboutInitializer::*got_version)(QString)) {
+  m_runner->add([this, probe, got_version]() {
+    QString version = probe();
+    emit (this->*got_version)(version);
+    component_done();
+  });
+}
+////////////////////////////////////////////////////////////////////////////
 
-    if (CSettingsManager::Instance().default_browser() == "Edge") {
-      QString edge_version;
-      CSystemCallWrapper::edge_version(edge_version);
-      emit got_edge_version(edge_version);
-      emit init_progress(++initialized_component_count, COMPONENTS_COUNT);
-    }
+void DlgAboutInitializer::add_update_check(const QString& component_id) {
+  m_runner->add([this, component_id]() {
+    bool available =
+        CHubComponentsUpdater::Instance()->is_update_available(component_id);
+    emit update_available(component_id, available);
+    component_done();
+  });
+}
+////////////////////////////////////////////////////////////////////////////
 
-    if (CSettingsManager::Instance().default_browser() == "Safari") {
-      QString safari_version;
-      CSystemCallWrapper::safari_version(safari_version);
-      emit got_safari_version(safari_version);
-      emit init_progress(++initialized_component_count, COMPONENTS_COUNT);
-    }
+void DlgAboutInitializer::do_initialization() {
+  // There are 2 stages. First one downloads metadata of tray, p2p and vagrant
+  // and gets versions of installed components. Second one checks updates,
+  // it needs metadata and must report after versions (see update_available_sl).
+  // Probes of every stage are run in parallel.
+  {
+    QMutexLocker locker(&m_runner_mutex);
+    m_runner = new CBoundedTaskRunner(MAX_PARALLEL_PROBES);
+    if (m_aborted.load()) m_runner->abort();
+  }
 
-    QString x2go_version = get_x2go_version();
-    emit got_x2go_version(x2go_version);
-    emit init_progress(++initialized_component_count, COMPONENTS_COUNT);
+  try {
+    m_progress.store(0);
+    VagrantProvider::PROVIDERS provider = VagrantProvider::Instance()->CurrentProvider();
+    QString browser = CSettingsManager::Instance().default_browser();
 
-    QString vagrant_version = get_vagrant_version();
-    emit got_vagrant_version(vagrant_version);
-    emit init_progress(++initialized_component_count, COMPONENTS_COUNT);
+    add_meta_download(tray_kurjun_file_name(), &CRestWorker::set_next_cc_version);
+    add_meta_download(p2p_kurjun_file_name(), &CRestWorker::set_next_p2p_version);
+    add_meta_download(vagrant_kurjun_package_name(), &CRestWorker::set_next_vagrant_version);
 
-    if (provider == VagrantProvider::VIRTUALBOX) {
-      QString oracle_virtualbox_version = get_oracle_virtualbox_version();
-      emit got_oracle_virtualbox_version(oracle_virtualbox_version);
-      emit init_progress(++initialized_component_count, COMPONENTS_COUNT);
+    add_version_probe(get_p2p_version, &DlgAboutInitializer::got_p2p_version);
 
-      QString vbguest_plugin_version = get_vagrant_vbguest_version();
-      emit got_vbguest_plugin_version(vbguest_plugin_version);
-      emit init_progress(++initialized_component_count, COMPONENTS_COUNT);
-    }
+    if (browser == "Chrome")
+      add_version_probe(get_chrome_version, &DlgAboutInitializer::got_chrome_version);
+    if (browser == "Firefox")
+      add_version_probe(get_firefox_version, &DlgAboutInitializer::got_firefox_version);
+    if (browser == "Edge")
+      add_version_probe(get_edge_version, &DlgAboutInitializer::got_edge_version);
+    if (browser == "Safari")
+      add_version_probe(get_safari_version, &DlgAboutInitializer::got_safari_version);
 
-    QString subutai_e2e_version = get_e2e_version();
-    emit got_e2e_version(subutai_e2e_version);
-    emit init_progress(++initialized_component_count, COMPONENTS_COUNT);
+    add_version_probe(get_x2go_version, &DlgAboutInitializer::got_x2go_version);
+    add_version_probe(get_vagrant_version, &DlgAboutInitializer::got_vagrant_version);
 
-    QString subutai_plugin_versin = get_vagrant_subutai_version();
-    emit got_subutai_plugin_version(subutai_plugin_versin);
-    emit init_progress(++initialized_component_count, COMPONENTS_COUNT);
+    if (provider == VagrantProvider::VIRTUALBOX) {
+      add_version_probe(get_oracle_virtualbox_version,
+                        &DlgAboutInitializer::got_oracle_virtualbox_version);
+      add_version_probe(get_vagrant_vbguest_version,
+                        &DlgAboutInitializer::got_vbguest_plugin_version);
+    }
 
-    QString subutai_box_version = get_subutai_box_version();
-    emit got_subutai_box_version(subutai_box_version);
-    emit init_progress(++initialized_component_count, COMPONENTS_COUNT);
+    add_version_probe(get_e2e_version, &DlgAboutInitializer::got_e2e_version);
+    add_version_probe(get_vagrant_subutai_version,
+                      &DlgAboutInitializer::got_subutai_plugin_version);
+    add_version_probe(get_subutai_box_version,
+                      &DlgAboutInitializer::got_subutai_box_version);
 
     if (provider == VagrantProvider::VMWARE_DESKTOP) {
-      QString vagrant_provider_version = get_vagrant_provider_version();
-      emit got_provider_version(vagrant_provider_version);
-      emit init_progress(++initialized_component_count, COMPONENTS_COUNT);
-
-      QString hypervisor_vmware_version = get_hypervisor_vmware_version();
-      emit got_hypervisor_version(hypervisor_vmware_version);
-      emit init_progress(++initialized_component_count, COMPONENTS_COUNT);
-
-      QString vagrant_vmware_utility_version = get_vagrant_vmware_utility_version();
-      emit got_vagrant_vmware_utility_version(vagrant_vmware_utility_version);
-      emit init_progress(++initialized_component_count, COMPONENTS_COUNT);
-    }
-
-    if (provider == VagrantProvider::HYPERV) {
-      QString hyperv_ver = get_hyperv_version();
-      emit got_hypervisor_version(hyperv_ver);
-      emit init_progress(++initialized_component_count, COMPONENTS_COUNT);
+      add_version_probe(get_vagrant_provider_version,
+                        &DlgAboutInitializer::got_provider_version);
+      add_version_probe(get_hypervisor_vmware_version,
+                        &DlgAboutInitializer::got_hypervisor_version);
+      add_version_probe(get_vagrant_vmware_utility_version,
+                        &DlgAboutInitializer::got_vagrant_vmware_utility_version);
     }
 
-    if (VagrantProvider::Instance()->CurrentProvider() == VagrantProvider::LIBVIRT) {
-      QString vagrant_libvirt = get_vagrant_provider_version();
-      emit got_provider_version(vagrant_libvirt);
-      emit init_progress(++initialized_component_count, COMPONENTS_COUNT);
+    if (provider == VagrantProvider::HYPERV)
+      add_version_probe(get_hyperv_version, &DlgAboutInitializer::got_hypervisor_version);
 
-      QString kvm = get_kvm_version();
-      emit got_hypervisor_version(kvm);
-      emit init_progress(++initialized_component_count, COMPONENTS_COUNT);
+    if (provider == VagrantProvider::LIBVIRT) {
+      add_version_probe(get_vagrant_provider_version,
+                        &DlgAboutInitializer::got_provider_version);
+      add_version_probe(get_kvm_version, &DlgAboutInitializer::got_hypervisor_version);
     }
 
-#ifdef RT_OS_DARWIN 
+#ifdef RT_OS_DARWIN
     if (provider == VagrantProvider::PARALLELS) {
-      QString provider_parallels = get_vagrant_provider_version();
-      emit got_provider_version(provider_parallels);
-      emit init_progress(++initialized_component_count, COMPONENTS_COUNT);
-
-      QString parallels = get_parallels_version();
-      emit got_hypervisor_version(parallels);
-      emit init_progress(++initialized_component_count, COMPONENTS_COUNT);
+      add_version_probe(get_vagrant_provider_version,
+                        &DlgAboutInitializer::got_provider_version);
+      add_version_probe(get_parallels_version,
+                        &DlgAboutInitializer::got_hypervisor_version);
     }
 
-    QString xquartz_version = get_xquartz_version();
-    emit got_xquartz_version(xquartz_version);
-    emit init_progress(++initialized_component_count, COMPONENTS_COUNT);
+    add_version_probe(get_xquartz_version, &DlgAboutInitializer::got_xquartz_version);
 #endif
 
+    bool completed = m_runner->run() && !m_aborted.load();
+
     std::vector<QString> uas = {IUpdaterComponent::P2P,
                      IUpdaterComponent::TRAY,
                      IUpdaterComponent::X2GO,
@@ -1691,16 +1678,16 @@ void DlgAboutInitializer::do_initialization() {
                      IUpdaterComponent::XQUARTZ
                      };
 
-    if (CSettingsManager::Instance().default_browser() == "Chrome") {
+    if (browser == "Chrome") {
       uas.push_back(IUpdaterComponent::CHROME);
-    } else if (CSettingsManager::Instance().default_browser() == "Firefox") {
+    } else if (browser == "Firefox") {
       uas.push_back(IUpdaterComponent::FIREFOX);
     }
-    if (CSettingsManager::Instance().default_browser() != "Edge") {
+    if (browser != "Edge") {
       uas.push_back(IUpdaterComponent::E2E);
     }
 
-    switch(VagrantProvider::Instance()->CurrentProvider()) {
+    switch(provider) {
     case VagrantProvider::VIRTUALBOX:
       uas.push_back(IUpdaterComponent::ORACLE_VIRTUALBOX);
       uas.push_back(IUpdaterComponent::VAGRANT_VBGUEST);
@@ -1727,24 +1714,22 @@ void DlgAboutInitializer::do_initialization() {
       break;
     }
 
-    std::vector<bool> ua;
-    for (int i = 0; i < int(uas.size()); ++i) {
-      ua.push_back(
-          CHubComponentsUpdater::Instance()->
-            is_update_available(uas.at(std::vector<QString>::size_type(i))));
-      emit init_progress(++initialized_component_count, COMPONENTS_COUNT);
-    }
-
-    for (int i = 0; i < int(uas.size()); i++) {
-        emit update_available(
-            uas[std::vector<QString>::size_type(i)],
-             ua[std::vector<bool>::size_type(i)]);
+    // update checks aren't started after abort
+    if (completed) {
+      for (auto i = uas.begin(); i != uas.end(); ++i)
+        add_update_check(*i);
+      m_runner->run();
     }
   } catch (std::exception& ex) {
     qCritical("Err in DlgAboutInitializer::do_initialization() . %s",
               ex.what());
   }
 
+  {
+    QMutexLocker locker(&m_runner_mutex);
+    delete m_runner;
+    m_runner = nullptr;
+  }
   emit finished();
 }
 ////////////////////////////////////////////////////////////////////////////
@@ -1807,5 +1792,9 @@ void DlgAbout::uninstall_finished(const QString& component_id, bool success, con
 }
 
 ////////////////////////////////////////////////////////////////////////////
-void DlgAboutInitializer::abort() { emit finished(); }
+void DlgAboutInitializer::abort() {
+  m_aborted.store(1);
+  QMutexLocker locker(&m_runner_mutex);
+  if (m_runner) m_runner->abort();
+}
 ////////////////////////////////////////////////////////////////////////////
@@ -53,7 +53,7 @@ DlgLogin::~DlgLogin()
 }
 ////////////////////////////////////////////////////////////////////////////
 
-bool
+void
 DlgLogin::login() {
   CSettingsManager::Instance().set_login(ui->le_login->text());
   CSettingsManager::Instance().set_password(ui->le_password->text());
@@ -61,32 +61,41 @@ DlgLogin::login() {
   qDebug() << "Username " << ui->le_login->text();
   qDebug() << "Remember Me " << ui->cb_save_credentials->text();
 
-  int http_code, err_code, network_err;
   CHubController::Instance().set_current_user(ui->le_login->text());
   CHubController::Instance().set_current_pass(ui->le_password->text());
 
-  CRestWorker::Instance()->login(CHubController::Instance().current_user(),
-                                 CHubController::Instance().current_pass(),
-                                 http_code,
-                                 err_code,
-                                 network_err);
+  ui->btn_ok->setEnabled(false);
+  CRestWorker::Instance()->login_async(CHubController::Instance().current_user(),
+                                       CHubController::Instance().current_pass(),
+                                       this,
+                                       [this](int http_code, int err_code, int network_err) {
+    login_finished(http_code, err_code, network_err);
+  });
+}
+////////////////////////////////////////////////////////////////////////////
 
-  QString id = "";
-  QString email = "";
+void
+DlgLogin::login_finished(int http_code,
+                         int err_code,
+                         int network_err) {
   switch (err_code) {
     case RE_SUCCESS:
-      if (CRestWorker::Instance()->get_user_info("id", id))
-        CHubController::Instance().set_current_user_id(id);
-
-      if (CRestWorker::Instance()->get_user_info("email", email))
-          CHubController::Instance().set_current_email(email);
-
       ui->lbl_status->setText("");
       ui->lbl_status->setVisible(false);
       if (CSettingsManager::Instance().remember_me())
         CSettingsManager::Instance().save_all();
-      QDialog::accept();
-      return true;
+      CRestWorker::Instance()->get_user_info_async("id", this,
+                                                   [this](bool ok, const QString& id) {
+        if (ok)
+          CHubController::Instance().set_current_user_id(id);
+        CRestWorker::Instance()->get_user_info_async("email", this,
+                                                     [this](bool ok, const QString& email) {
+          if (ok)
+            CHubController::Instance().set_current_email(email);
+          user_info_received();
+        });
+      });
+      return;
     case RE_LOGIN_OR_EMAIL:
       ui->lbl_status->setVisible(true);
       ui->lbl_status->setText(QString("<font color='red'>%1</font>").
@@ -122,33 +131,47 @@ DlgLogin::login() {
                               arg(err_code));
       break;
   }
-  return false;
+
+  ui->btn_ok->setEnabled(true);
+  // automatic login failed, user has to enter credentials.
+  if (!isVisible()) {
+    hide_splash();
+    show();
+  }
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+DlgLogin::user_info_received() {
+  ui->btn_ok->setEnabled(true);
+  hide_splash();
+  QDialog::accept();
+  emit login_success();
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+DlgLogin::hide_splash() {
+  if (m_splash) m_splash->hide();
+  m_splash = nullptr;
 }
 ////////////////////////////////////////////////////////////////////////////
 
 void
 DlgLogin::run_dialog(QSplashScreen* sc) {
+  m_splash = sc;
   if (!CSettingsManager::Instance().remember_me()) {
-    if(sc) sc->hide();
-    exec();
-    return;
-  }
-
-  if (!login()) {
-    if(sc) sc->hide();
-    exec();
+    hide_splash();
+    show();
     return;
   }
-
-  emit login_success();
-  if(sc) sc->hide();
+  login();
 }
 ////////////////////////////////////////////////////////////////////////////
 
 void
 DlgLogin::btn_ok_released() {
-  if (login())
-    emit login_success();
+  login();
 }
 ////////////////////////////////////////////////////////////////////////////
 
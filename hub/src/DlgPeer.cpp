@@ -13,6 +13,7 @@
 #include <QLineEdit>
 #include "OsBranchConsts.h"
 #include "RhController.h"
+#include "VagrantMetadata.h"
 
 #include "LibsshController.h"
 
@@ -256,40 +257,13 @@ void DlgPeer::addMachinePeer(CLocalPeer peer) {
 // format of configuration file -> KEY : VALUE
 void DlgPeer::parse_yml() {
   if (ui->change_configure->isChecked()) return;
-  QString filename = QString("%1/vagrant-subutai.yml").arg(rh_dir);
-  QFile file(filename);
-  if (QFileInfo(filename).exists() && file.open(QIODevice::ReadWrite)) {
-    QTextStream stream(&file);
-    QString output = QString(stream.readAll());
-    QStringList vagrant_info = output.split("\n", QString::SkipEmptyParts);
-    QString flag, value;
-    bool reading_value;
-    for (auto s : vagrant_info) {
-      s = s.trimmed();
-      flag = value = "";
-      reading_value = false;
-      for (int i = 0; i < s.size(); i++) {
-        if (reading_value) {
-          value += s[i];
-          continue;
-        }
-        if (s[i] == ':') {
-          flag = value;
-          value = "";
-          continue;
-        }
-        if (s[i] != ' ') {
-          if (value == "" && !flag.isEmpty()) reading_value = true;
-          value += s[i];
-        }
-      }
-      if (flag == "SUBUTAI_RAM") rh_ram = value;
-      if (flag == "SUBUTAI_CPU") rh_cpu = value;
-      if (flag == "DISK_SIZE") rh_disk = value;
-      if (flag == "BRIDGE") rh_bridge = value;
-    }
-  }
-  file.close();
+  QHash<QString, QString> values;
+  if (!CYamlSubsetReader::parse_file(QString("%1/vagrant-subutai.yml").arg(rh_dir), values))
+    return;
+  if (values.contains("SUBUTAI_RAM")) rh_ram = values["SUBUTAI_RAM"];
+  if (values.contains("SUBUTAI_CPU")) rh_cpu = values["SUBUTAI_CPU"];
+  if (values.contains("DISK_SIZE")) rh_disk = values["DISK_SIZE"];
+  if (values.contains("BRIDGE")) rh_bridge = values["BRIDGE"];
 }
 
 void DlgPeer::addPeer(CMyPeerInfo *hub_peer,
@@ -4,6 +4,8 @@
 #include <QMovie>
 #include <QLineEdit>
 #include <QObject>
+#include <QFutureWatcher>
+#include <QtConcurrent/QtConcurrent>
 
 #include "SystemCallWrapper.h"
 #include "TrayControlWindow.h"
@@ -75,36 +77,54 @@ void DlgRegisterPeer::registerPeer() {
     ui->lne_username->setEnabled(false);
     ui->cmb_peer_scope->setEnabled(false);
 
+    const QString url_management = m_url_management;
     const QString login = ui->lne_username->text();
     const QString password = ui->lne_password->text();
-    QString token, body;
-    static int err_code, http_code, network_error;
-    CRestWorker::Instance()->peer_token(m_url_management, login, password,
-                                        token, err_code, http_code, network_error);
     const QString peer_name = ui->lne_peername->text();
     const QString peer_scope = ui->cmb_peer_scope->currentText();
-
-    qDebug()
-            << "Register peer: Get token errors: "
-            << "Http code " << http_code
-            << "Error code " << err_code
-            << "Network Error " << network_error;
-    if(!dialog_used[m_ip_addr.toInt() - 9999]) return;
-    bool kill_me = check_errors(err_code, http_code, network_error, QString(""));
-    if(kill_me){
-        CRestWorker::Instance()->peer_register(m_url_management, token,
-                                               CHubController::Instance().current_email(), CHubController::Instance().current_pass(),
-                                               peer_name, peer_scope,
-                                               err_code, http_code, network_error, body);
+    run_peer_request([url_management, login, password]() {
+        peer_request_result_t res;
+        CRestWorker::Instance()->peer_token(url_management, login, password,
+                                            res.token, res.err_code, res.http_code, res.network_error);
+        return res;
+    }, [this, url_management, peer_name, peer_scope](const peer_request_result_t& token_res) {
+        qDebug()
+                << "Register peer: Get token errors: "
+                << "Http code " << token_res.http_code
+                << "Error code " << token_res.err_code
+                << "Network Error " << token_res.network_error;
         if(!dialog_used[m_ip_addr.toInt() - 9999]) return;
-        bool kill_me = check_errors(err_code, http_code, network_error, body);
-        if (kill_me){
-            CHubController::Instance().force_refresh();
-            emit register_finished();
-            dialog_running[m_ip_addr.toInt() - 9999] = 0;
-            this->close();
+        if(!check_errors(token_res.err_code, token_res.http_code,
+                         token_res.network_error, QString(""))) {
+            registration_finished();
+            return;
         }
-    }
+
+        const QString token = token_res.token;
+        const QString email = CHubController::Instance().current_email();
+        const QString pass = CHubController::Instance().current_pass();
+        run_peer_request([url_management, token, email, pass, peer_name, peer_scope]() {
+            peer_request_result_t res;
+            CRestWorker::Instance()->peer_register(url_management, token,
+                                                   email, pass,
+                                                   peer_name, peer_scope,
+                                                   res.err_code, res.http_code, res.network_error, res.body);
+            return res;
+        }, [this](const peer_request_result_t& res) {
+            if(!dialog_used[m_ip_addr.toInt() - 9999]) return;
+            bool kill_me = check_errors(res.err_code, res.http_code, res.network_error, res.body);
+            if (kill_me){
+                CHubController::Instance().force_refresh();
+                emit register_finished();
+                dialog_running[m_ip_addr.toInt() - 9999] = 0;
+                this->close();
+            }
+            registration_finished();
+        });
+    });
+}
+
+void DlgRegisterPeer::registration_finished(){
     dialog_running[m_ip_addr.toInt() - 9999] = 0;
     ui->btn_cancel->setEnabled(true);
     ui->btn_register->setEnabled(true);
@@ -120,38 +140,55 @@ void DlgRegisterPeer::unregisterPeer(){
             << "Unregister button pressed: "
             << m_ip_addr;
 
+    const QString url_management = m_url_management;
     const QString login=ui->lne_username->text();
     const QString password=ui->lne_password->text();
-    QString token;
-    static int err_code, http_code, network_error;
-    QString body;
 
     ui->btn_cancel->setEnabled(false);
     ui->btn_unregister->setEnabled(false);
     ui->lne_password->setEnabled(false);
     ui->lne_username->setEnabled(false);
 
-    CRestWorker::Instance()->peer_token(m_url_management, login, password,
-                                            token, err_code, http_code, network_error);
-    qDebug()
-            << "Unregister peer: Get token errors: "
-            << "Http code " << http_code
-            << "Error code " << err_code
-            << "Network Error " << network_error;
-
-    if(!dialog_used[m_ip_addr.toInt() - 9999]) return;
-    bool kill_me = check_errors(err_code, http_code, network_error, body);
-    if(kill_me){
-        CRestWorker::Instance()->peer_unregister(m_url_management, token, err_code, http_code, network_error, body);
+    run_peer_request([url_management, login, password]() {
+        peer_request_result_t res;
+        CRestWorker::Instance()->peer_token(url_management, login, password,
+                                            res.token, res.err_code, res.http_code, res.network_error);
+        return res;
+    }, [this, url_management](const peer_request_result_t& token_res) {
+        qDebug()
+                << "Unregister peer: Get token errors: "
+                << "Http code " << token_res.http_code
+                << "Error code " << token_res.err_code
+                << "Network Error " << token_res.network_error;
+
         if(!dialog_used[m_ip_addr.toInt() - 9999]) return;
-        kill_me = check_errors(err_code, http_code, network_error, body);
-        if (kill_me){
-            dialog_running[m_ip_addr.toInt() - 9999] = 0;
-            CHubController::Instance().force_refresh();
-            emit register_finished();
-            this->close();
+        if(!check_errors(token_res.err_code, token_res.http_code,
+                         token_res.network_error, token_res.body)) {
+            unregistration_finished();
+            return;
         }
-    }
+
+        const QString token = token_res.token;
+        run_peer_request([url_management, token]() {
+            peer_request_result_t res;
+            CRestWorker::Instance()->peer_unregister(url_management, token,
+                                                     res.err_code, res.http_code, res.network_error, res.body);
+            return res;
+        }, [this](const peer_request_result_t& res) {
+            if(!dialog_used[m_ip_addr.toInt() - 9999]) return;
+            bool kill_me = check_errors(res.err_code, res.http_code, res.network_error, res.body);
+            if (kill_me){
+                dialog_running[m_ip_addr.toInt() - 9999] = 0;
+                CHubController::Instance().force_refresh();
+                emit register_finished();
+                this->close();
+            }
+            unregistration_finished();
+        });
+    });
+}
+
+void DlgRegisterPeer::unregistration_finished(){
     dialog_running[m_ip_addr.toInt() - 9999] = 0;
     ui->btn_cancel->setEnabled(true);
     ui->btn_unregister->setEnabled(true);
@@ -159,6 +196,19 @@ void DlgRegisterPeer::unregisterPeer(){
     ui->lne_username->setEnabled(true);
 }
 
+void DlgRegisterPeer::run_peer_request(peer_request_t request,
+                                       peer_request_finished_t finished){
+    // REST calls of console block, so they don't run in GUI thread.
+    QFutureWatcher<peer_request_result_t>* watcher =
+            new QFutureWatcher<peer_request_result_t>(this);
+    connect(watcher, &QFutureWatcher<peer_request_result_t>::finished,
+            [watcher, finished]() {
+        finished(watcher->result());
+        watcher->deleteLater();
+    });
+    watcher->setFuture(QtConcurrent::run(request));
+}
+
 void DlgRegisterPeer::setUnregistrationMode(){
     qInfo()
         << "Unregister peer dialog created: "
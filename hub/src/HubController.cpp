@@ -114,22 +114,25 @@ void CHubController::on_balance_updated_sl(CHubBalance balance, int http_code,
     qCritical(
         "Failed to refresh balance. Received not json. Trying to "
         "re-login");
-    int lhttp, lerr, lnet;
-    CRestWorker::Instance()->login(m_current_user, m_current_pass, lhttp, lerr,
-                                   lnet);
-    if (lerr == RE_SUCCESS) {
-      qDebug() << "Updating one more time";
-
-      if (++UPDATE_BALANCE_ATTEMPT_COUNT <= UPDATE_ATTEMPT_MAX) {
-        CRestWorker::Instance()->update_balance();
+    CRestWorker::Instance()->login_async(m_current_user, m_current_pass, this,
+                                         [](int lhttp, int lerr, int lnet) {
+      if (lerr == RE_SUCCESS) {
+        qDebug() << "Updating one more time";
+
+        if (++UPDATE_BALANCE_ATTEMPT_COUNT <= UPDATE_ATTEMPT_MAX) {
+          CRestWorker::Instance()->update_balance();
+        } else {
+          UPDATE_BALANCE_ATTEMPT_COUNT = 0;
+        }
       } else {
-        UPDATE_BALANCE_ATTEMPT_COUNT = 0;
+        qInfo("Failed to re-login. %d - %d - %d",
+                                             lhttp, lerr, lnet);
       }
-    } else {
-      qInfo("Failed to re-login. %d - %d - %d",
-                                           lhttp, lerr, lnet);
-    }
+    });
   }
+  // same balance as last time, nothing to update
+  if (err_code == RE_NO_UPDATES) return;
+
   m_balance = err_code != RE_SUCCESS
                   ? undefined_balance
                   : tr("Balance: %1").arg(balance.value());
@@ -158,21 +161,28 @@ CHubController::on_environments_updated_sl(std::vector<CEnvironment> lst_environ
     qCritical(
         "Failed to refresh environments. Received not json. Trying to "
         "re-login");
-    int lhttp, lerr, lnet;
-    CRestWorker::Instance()->login(m_current_user, m_current_pass, lhttp, lerr,
-                                   lnet);
-    if (lerr == RE_SUCCESS) {
-      qDebug() << "Updating one more time";
-      if (++UPDATE_ENVIRONMENTS_ATTEMTP_COUNT <= UPDATE_ATTEMPT_MAX) {
-        CRestWorker::Instance()->update_environments();
+    // re-login doesn't block refresh, environments are requested again when it's done
+    CRestWorker::Instance()->login_async(m_current_user, m_current_pass, this,
+                                         [](int lhttp, int lerr, int lnet) {
+      if (lerr == RE_SUCCESS) {
+        qDebug() << "Updating one more time";
+        if (++UPDATE_ENVIRONMENTS_ATTEMTP_COUNT <= UPDATE_ATTEMPT_MAX) {
+          CRestWorker::Instance()->update_environments();
+        } else {
+          UPDATE_ENVIRONMENTS_ATTEMTP_COUNT = 0;
+        }
       } else {
-        UPDATE_ENVIRONMENTS_ATTEMTP_COUNT = 0;
+        qInfo("Failed to re-login. %d - %d - %d",
+                                             lhttp, lerr, lnet);
       }
-    } else {
-      qInfo("Failed to re-login. %d - %d - %d",
-                                           lhttp, lerr, lnet);
-      return;
-    }
+    });
+    return;
+  }
+
+  if (err_code == RE_NO_UPDATES) {
+    rer_res = m_lst_environments_internal.empty() ? RER_EMPTY : RER_NO_DIFF;
+    emit environments_updated(rer_res);
+    return;
   }
 
   if (err_code || network_error) {
@@ -198,24 +208,25 @@ CHubController::on_environments_updated_sl(std::vector<CEnvironment> lst_environ
     return;
   }
 
-  if (lst_environments == m_lst_environments_internal) {
+  keyed_diff_t diff =
+      KeyedDiff<CEnvironment>(m_lst_environments_internal, lst_environments);
+  if (diff.empty()) {
     rer_res = m_lst_environments_internal.empty() ? RER_EMPTY : RER_NO_DIFF;
     emit environments_updated(rer_res);
     return;
   }
 
+  std::vector<CEnvironment> lst_removed, lst_prev;
+  for (size_t i : diff.removed)
+    lst_removed.push_back(m_lst_environments_internal[i]);
+  for (auto i : diff.changed)
+    lst_prev.push_back(m_lst_environments_internal[i.first]);
+
   {
     SynchroPrimitives::Locker lock(&m_refresh_cs);
 
     m_lst_environments_internal = std::move(lst_environments);
-    m_lst_environments.erase(m_lst_environments.begin(),
-                             m_lst_environments.end());
-
-    for (auto env = m_lst_environments_internal.cbegin();
-         env != m_lst_environments_internal.cend(); ++env) {
-      m_lst_environments.push_back(
-          CEnvironment(*env));  // todo check do we need this extra copy?
-    }
+    m_lst_environments = m_lst_environments_internal;
 
     m_lst_healthy_environments.erase(m_lst_healthy_environments.begin(),
                                      m_lst_healthy_environments.end());
@@ -224,6 +235,13 @@ CHubController::on_environments_updated_sl(std::vector<CEnvironment> lst_environ
                  std::back_inserter(m_lst_healthy_environments),
                  [](const CEnvironment &env) { return env.healthy(); });
   }
+
+  for (auto env = lst_removed.cbegin(); env != lst_removed.cend(); ++env)
+    emit environment_removed(*env);
+  for (size_t i : diff.added)
+    emit environment_added(m_lst_environments[i]);
+  for (size_t i = 0; i < diff.changed.size(); ++i)
+    emit environment_changed(lst_prev[i], m_lst_environments[diff.changed[i].second]);
   emit environments_updated(rer_res);
 }
 
@@ -231,8 +249,8 @@ void CHubController::on_my_peers_updated_sl(std::vector<CMyPeerInfo> lst_peers,
                                             int http_code, int err_code,
                                             int network_error) {
   UNUSED_ARG(http_code);
-  UNUSED_ARG(err_code);
   UNUSED_ARG(network_error);
+  if (err_code == RE_NO_UPDATES) return;
   m_lst_my_peers = lst_peers;
   emit my_peers_updated();
 }
@@ -241,10 +259,13 @@ void CHubController::on_my_peers_updated_sl(std::vector<CMyPeerInfo> lst_peers,
 void CHubController::logout() {
   m_refresh_timer.stop();
   m_report_timer.stop();
-  m_lst_environments.clear();
+  std::vector<CEnvironment> lst_removed;
+  lst_removed.swap(m_lst_environments);
   m_lst_environments_internal.clear();
   m_lst_healthy_environments.clear();
   m_balance = undefined_balance;
+  for (auto env = lst_removed.cbegin(); env != lst_removed.cend(); ++env)
+    emit environment_removed(*env);
   emit environments_updated(RER_SUCCESS);
   emit balance_updated();
   emit user_name_updated();
@@ -0,0 +1,127 @@
+#include <algorithm>
+#include <QMutexLocker>
+#include <QtAlgorithms>
+
+#include "InterfaceIdAllocator.h"
+
+const int CInterfaceIdAllocator::DEFAULT_CAPACITY;
+
+CInterfaceIdAllocator::CInterfaceIdAllocator(int capacity) :
+  m_capacity(capacity > 0 ? capacity : 1),
+  m_bits((m_capacity + 63) / 64, 0),
+  m_first_free_word(0) {
+}
+////////////////////////////////////////////////////////////////////////////
+
+int
+CInterfaceIdAllocator::reserve(const QString &hash) {
+  QMutexLocker locker(&m_mutex);
+  auto known = m_id_of.find(hash);
+  if (known != m_id_of.end()) return known.value();
+
+  for (int w = m_first_free_word; w < (int)m_bits.size(); ++w) {
+    quint64 free_bits = ~m_bits[w];
+    if (free_bits == 0) continue;
+    m_first_free_word = w;
+    int id = w * 64 + (int)qCountTrailingZeroBits(free_bits);
+    if (id >= m_capacity) break;
+    set_bit(id, true);
+    m_id_of[hash] = id;
+    m_owner[id] = hash;
+    return id;
+  }
+  m_first_free_word = (int)m_bits.size();
+  return -1;
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CInterfaceIdAllocator::bind(const QString &hash,
+                            int id) {
+  QMutexLocker locker(&m_mutex);
+  auto known = m_id_of.find(hash);
+  if (known != m_id_of.end() && known.value() == id) return;
+  release_locked(hash);
+  if (id < 0) return;
+
+  auto owner = m_owner.find(id);
+  if (owner != m_owner.end()) m_id_of.remove(owner.value());
+  m_owner[id] = hash;
+  m_id_of[hash] = id;
+  if (id < m_capacity) set_bit(id, true);
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CInterfaceIdAllocator::release(const QString &hash) {
+  QMutexLocker locker(&m_mutex);
+  release_locked(hash);
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CInterfaceIdAllocator::clear() {
+  QMutexLocker locker(&m_mutex);
+  std::fill(m_bits.begin(), m_bits.end(), 0);
+  m_first_free_word = 0;
+  m_id_of.clear();
+  m_owner.clear();
+}
+////////////////////////////////////////////////////////////////////////////
+
+int
+CInterfaceIdAllocator::id_of(const QString &hash) const {
+  QMutexLocker locker(&m_mutex);
+  return m_id_of.value(hash, -1);
+}
+////////////////////////////////////////////////////////////////////////////
+
+bool
+CInterfaceIdAllocator::is_used(int id) const {
+  QMutexLocker locker(&m_mutex);
+  return m_owner.contains(id);
+}
+////////////////////////////////////////////////////////////////////////////
+
+int
+CInterfaceIdAllocator::used_count() const {
+  QMutexLocker locker(&m_mutex);
+  return m_owner.size();
+}
+////////////////////////////////////////////////////////////////////////////
+
+int
+CInterfaceIdAllocator::parse_id(const QString &interface) {
+  int begin = interface.size();
+  while (begin > 0 && interface[begin - 1].isDigit()) --begin;
+  if (begin == interface.size()) return -1;
+  bool ok = false;
+  int id = interface.mid(begin).toInt(&ok);
+  return ok ? id : -1;
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CInterfaceIdAllocator::release_locked(const QString &hash) {
+  auto known = m_id_of.find(hash);
+  if (known == m_id_of.end()) return;
+  int id = known.value();
+  m_id_of.erase(known);
+  m_owner.remove(id);
+  if (id < m_capacity) set_bit(id, false);
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CInterfaceIdAllocator::set_bit(int id,
+                               bool used) {
+  int w = id / 64;
+  quint64 bit = (quint64)1 << (id % 64);
+  if (used) {
+    m_bits[w] |= bit;
+  } else {
+    m_bits[w] &= ~bit;
+    m_first_free_word = std::min(m_first_free_word, w);
+  }
+}
+////////////////////////////////////////////////////////////////////////////
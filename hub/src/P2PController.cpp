@@ -6,6 +6,8 @@
 #include "Locker.h"
 #include <QDebug>
 #include <QtConcurrent/QtConcurrent>
+#include "P2PStateTracker.h"
+#include "ReachabilityChecker.h"
 #include "RestWorker.h"
 #include "RhController.h"
 
@@ -37,6 +39,7 @@ void P2PConnector::join_swarm(const CEnvironment &env) {
                     .arg(CSystemCallWrapper::scwe_error_to_str(res));
     }
 
+    m_reconciler.join_finished(env.hash(), res == SCWE_SUCCESS);
     SynchroPrimitives::Locker lock(&P2PConnector::m_env_critical);
     if (res == SCWE_SUCCESS)
       this->connected_envs.insert(env.hash());
@@ -67,6 +70,7 @@ void P2PConnector::leave_swarm(const QString &hash) {
                     .arg(CSystemCallWrapper::scwe_error_to_str(res));
     }
 
+    m_reconciler.leave_finished(hash);
     SynchroPrimitives::Locker lock(&P2PConnector::m_env_critical);
     this->connected_envs.erase(hash);
 
@@ -88,9 +92,7 @@ void P2PConnector::check_rh(const CEnvironment &env, const CHubContainer &cont)
              .arg(env.id())
              .arg(env.hash());
 
-  RHStatusChecker *rh_checker = new RHStatusChecker(env, cont);
-
-  connect(rh_checker, &RHStatusChecker::connection_finished, [this, env, cont, rh_checker](system_call_wrapper_error_t res) {
+  auto finished = [this, env, cont](system_call_wrapper_error_t res) {
     if (res == SCWE_SUCCESS) {
       qInfo() << QString("Successfully handshaked with container [cont_name: %1, cont_id: %2] and env: [env_name: %3, env_id: %4, swarm_hash: %5]")
                  .arg(cont.name())
@@ -113,11 +115,26 @@ void P2PConnector::check_rh(const CEnvironment &env, const CHubContainer &cont)
       this->connected_conts.insert(std::make_pair(env.hash(), cont.id()));
     else
       this->connected_conts.erase(std::make_pair(env.hash(), cont.id()));
+  };
 
-    delete rh_checker;
-  });
+  // state reported by daemon doesn't need probe
+  switch (CP2PStateTracker::Instance()->container_state(env.hash(), cont.rh_ip())) {
+    case CP2PStateTracker::CS_CONNECTED:
+      finished(SCWE_SUCCESS);
+      return;
+    case CP2PStateTracker::CS_NOT_CONNECTED:
+      finished(SCWE_CONTAINER_IS_NOT_READY);
+      return;
+    default:
+      break;
+  }
 
-  rh_checker->startWork(m_pool);
+  // probes of many containers run in parallel, so unreachable one doesn't stall others
+  CReachabilityChecker::Instance()->check(
+        cont.rh_ip(), CP2PStateTracker::peer_key(env.hash(), cont.rh_ip()), this,
+        [finished](bool reachable) {
+    finished(reachable ? SCWE_SUCCESS : SCWE_CONTAINER_IS_NOT_READY);
+  });
 }
 
 
@@ -135,202 +152,84 @@ void P2PConnector::check_status(const CEnvironment &env) {
 //////////////////////////////////////////////////////////////////////////////////////////////////
 
 void P2PConnector::update_status() {
+  // only environments and containers changed since previous update are evaluated
+  m_reconciler.set_environments(CHubController::Instance().lst_environments());
+
   // find if container is on your machine
-  std::vector<CEnvironment> hub_environments = CHubController::Instance().lst_environments();
-  QStringList local_containers;
   if (CSystemCallWrapper::is_desktop_peer()) {
-    // clear
-    local_containers.clear();
-
     static QString lxc_path("/var/lib/lxc");
-    QDir directory(lxc_path);
-    QString tmp, hostfile_path;
-
-    // check container directory
-    if (directory.exists()) {
-      for (QFileInfo info : directory.entryInfoList()) {
-        if (info.fileName() == "." || info.fileName() == "..")
-          continue;
-
-        tmp = info.fileName().trimmed();
-        hostfile_path = lxc_path + QDir::separator() + tmp + QDir::separator() + "rootfs/etc/hostname";
-
-        if (QFileInfo::exists(hostfile_path)) {
-          QFile file(hostfile_path);
-
-          if(!file.open(QIODevice::ReadOnly)) {
-              qDebug() << "error opening file: " << file.error() << hostfile_path;
-              break;
-          }
-
-          QTextStream instream(&file);
-          QString line = instream.readLine();
-
-          qDebug() << "local container hotname found: " << line;
-          local_containers << line;
-          file.close();
-        } else {
-          qInfo() << "not exist container hostname file: "
-                  << hostfile_path;
-        }
-      }
-
-      if (!local_containers.empty()) {
-        for (CEnvironment env : hub_environments) {
-          for (CHubContainer cont : env.containers()) {
-            bool found = false;
-            QString peer_id = cont.peer_id();
-            QString bazaar_cont = cont.name();
-
-            for (QString local_cont : local_containers) {
-              if (local_cont.contains(bazaar_cont)) {
-                qInfo() << "matched container "
-                        << "bazaar: "
-                        << bazaar_cont
-                        << "local: "
-                        << local_cont;
-                found = true;
-                break;
-              }
-            }
-            P2PController::Instance().rh_local_tbl[peer_id] = found;
-          }
-        }
-      } else {
+    if (QDir(lxc_path).exists()) {
+      QStringList local_containers = m_reconciler.read_local_containers(lxc_path);
+      if (local_containers.empty())
         qInfo() << "empty local containers from lxc directory";
-      }
+      m_reconciler.set_local_containers(local_containers);
     } else {
       qCritical() << "container directory not exist: "
                   << lxc_path;
     }
   }
 
-  if (!CCommons::IsApplicationLaunchable(CSettingsManager::Instance().p2p_path())
-      || !CSystemCallWrapper::p2p_daemon_check()) {
+  // state of daemon is refreshed by tracker, this slot is called on every refresh
+  p2p_state_t p2p_state;
+  if (!CP2PStateTracker::Instance()->state(p2p_state)) {
+    qInfo() << "p2p state is stale, waiting for next refresh";
+    return;
+  }
+  m_reconciler.set_p2p_state(p2p_state);
+  swarm_actions_t actions = m_reconciler.reconcile();
+
+  for (auto i = actions.rh_local.begin(); i != actions.rh_local.end(); ++i)
+    P2PController::Instance().rh_local_tbl[i->first] = i->second;
+
+  if (!p2p_state.installed || !p2p_state.running) {
     qDebug()<<"p2p path is:"<<CSettingsManager::Instance().p2p_path();
     qCritical() << "P2P is not launchable or p2p daemon is not running.";
+    CReachabilityChecker::Instance()->clear();
+    SynchroPrimitives::Locker lock_cont(&P2PConnector::m_cont_critical);
+    SynchroPrimitives::Locker lock_env(&P2PConnector::m_env_critical);
     connected_conts.clear();
     connected_envs.clear();
-    QTimer::singleShot(30000, this, &P2PConnector::update_status); // wait more, when p2p is not operational
     return;
   }
 
   qInfo() << "Starting to update connection status";
 
-
-  QFuture<std::vector<QString>> res_swarm = QtConcurrent::run(CSystemCallWrapper::p2p_show);
-  res_swarm.waitForFinished();
-
-  QFuture<std::vector<std::pair<QString, QString>>>  res_interfaces = QtConcurrent::run(CSystemCallWrapper::p2p_show_interfaces);
-  res_interfaces.waitForFinished();
-
-  std::vector<QString> joined_swarms = res_swarm.result(); // swarms + interfaces
-  std::vector<std::pair<QString, QString>> swarm_interfaces = res_interfaces.result(); // swarms + interfaces
-
-
-
-  QStringList already_joined;
-  QStringList hub_swarms;
-  QStringList lst_interfaces;
-
-  for (auto tt : swarm_interfaces) {
-    lst_interfaces << tt.first << " -- " << tt.second << "\n";
-  }
-  for (auto swarm : joined_swarms){
-    already_joined << swarm;
-  }
-  for (auto env : hub_environments){
-    hub_swarms << env.hash();
-  }
-
   qDebug()
-      << "Joined swarm: " << already_joined;
-
-  qDebug()
-      << "Swarms from hub: " << hub_swarms;
-
-  qDebug()
-      << "Swarm Interfaces: " << lst_interfaces;
-
-  // need to clear it everytime
-  interface_ids.clear();
-
-  // Setting the interfaces to swarm
-  // if an interface found with command `p2p show --interfaces --bind`, then we use that interface
-  for (CEnvironment &env : hub_environments) {
-    if (!env.healthy())
-      continue;
-    std::vector<std::pair<QString, QString>>::iterator found_swarm_interface =
-        std::find_if(swarm_interfaces.begin(), swarm_interfaces.end(), [&env](const std::pair<QString, QString>& swarm_interface) {
-        return env.hash() == swarm_interface.first;
-    });
-
-    if (found_swarm_interface != swarm_interfaces.end()
-        && env.base_interface_id() == -1) {
-      QString interface = found_swarm_interface->second;
-      QRegExp regExp("(-?\\d+(?:[\\.,]\\d+(?:e\\d+)?)?)");
-      regExp.indexIn(interface);
-      int id = regExp.capturedTexts().first().toInt();
-      env.set_base_interface_id(id);
-      interface_ids[id] = env.hash();
-    }
-  }
-
-  // if an interface was not found with command, then we will  give the unselected interfaces
-  for (CEnvironment &env : hub_environments) {
-    if (!env.healthy())
-      continue;
-    std::vector<std::pair<QString, QString>>::iterator found_swarm_interface =
-        std::find_if(swarm_interfaces.begin(), swarm_interfaces.end(), [&env](const std::pair<QString, QString>& swarm_interface) {
-        return env.hash() == swarm_interface.first;
-    });
-    if (found_swarm_interface == swarm_interfaces.end()
-        && env.base_interface_id() == -1) {
-      int id = get_unselected_interface_id();
-      env.set_base_interface_id(id);
-      interface_ids[id] = env.hash();
-    }
-  }
+      << "Swarm actions. Evaluated environments:" << m_reconciler.evaluated_count()
+      << "join:" << actions.join.size()
+      << "leave:" << actions.leave.size()
+      << "check:" << actions.check.size();
 
   {
     // WARNING: critical section
     SynchroPrimitives::Locker lock(&P2PConnector::m_env_critical);
-    for (CEnvironment env : hub_environments) {
-      if (std::find(joined_swarms.begin(), joined_swarms.end(), env.hash()) == joined_swarms.end()) { // environment not found in joined swarm hashes, we need to try to join it
-        connected_envs.erase(env.hash());
-      }
-      else {
-        connected_envs.insert(env.hash());
-      }
-    }
+    for (const QString& hash : actions.connected)
+      connected_envs.insert(hash);
+    for (const QString& hash : actions.disconnected)
+      connected_envs.erase(hash);
   }
 
   // joining the swarm
-  for (CEnvironment env : hub_environments) {
-    if (std::find(joined_swarms.begin(), joined_swarms.end(), env.hash()) == joined_swarms.end()) { // environment not found in joined swarm hashes, we need to try to join it
-      if (env.healthy()) {
-        join_swarm(env);
-      }
-    }
-  }
+  for (const CEnvironment& env : actions.join)
+    join_swarm(env);
 
   // checking the status of containers, handshaking
-  for (CEnvironment env : hub_environments) {
-    if (std::find(joined_swarms.begin(), joined_swarms.end(), env.hash()) != joined_swarms.end()) { // environment not found in joined swarm hashes, we need to try to join it
-      check_status(env);
-    }
-  }
+  for (const CEnvironment& env : actions.check)
+    check_status(env);
 
   // checking deleted environments
-  for (QString hash : joined_swarms) {
-    auto found_env = std::find_if(hub_environments.begin(), hub_environments.end(), [&hash](const CEnvironment& env) {
-      return env.hash() == hash;
-    });
-    if (found_env == hub_environments.end()) {
-      leave_swarm(hash);
-    }
-  }
-  QTimer::singleShot(15000, this, &P2PConnector::update_status);
+  for (const QString& hash : actions.leave)
+    leave_swarm(hash);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+void P2PConnector::start() {
+  CP2PStateTracker* tracker = CP2PStateTracker::Instance();
+  connect(tracker, &CP2PStateTracker::state_updated,
+          this, &P2PConnector::update_status, Qt::UniqueConnection);
+  tracker->start();
+  if (tracker->has_state()) update_status();
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////////
@@ -343,7 +242,7 @@ P2PController::P2PController() {
    connector = new P2PConnector;
    connector->set_pool(m_pool);
 
-   QTimer::singleShot(5000, connector, SLOT(update_status()));
+   QTimer::singleShot(5000, connector, SLOT(start()));
 }
 
 
@@ -407,18 +306,24 @@ ssh_desktop_launch_error_t P2PController::is_ready_sdle(const CEnvironment& env,
 
 //p2p status updater
 void P2PStatus_checker::update_status(){
+    CP2PStateTracker* tracker = CP2PStateTracker::Instance();
+    connect(tracker, &CP2PStateTracker::state_updated,
+            this, &P2PStatus_checker::state_updated_sl, Qt::UniqueConnection);
+    tracker->start();
+    if (tracker->has_state()) state_updated_sl();
+}
+
+void P2PStatus_checker::state_updated_sl(){
     qDebug()
             <<"updating p2p status";
-    if(!CCommons::IsApplicationLaunchable(CSettingsManager::Instance().p2p_path())) {
+    p2p_state_t state;
+    if (!CP2PStateTracker::Instance()->state(state))
+      return;
+    if(!state.installed) {
       emit p2p_status(P2P_FAIL);
-      QTimer::singleShot(5*1000, this, &P2PStatus_checker::update_status);
+    } else if (!state.running) {
+      emit p2p_status(P2P_READY);
     } else {
-      if (!CSystemCallWrapper::p2p_daemon_check()) {
-        emit p2p_status(P2P_READY);
-        QTimer::singleShot(5*1000, this, &P2PStatus_checker::update_status);
-      } else {
-        emit p2p_status(P2P_RUNNING);
-        QTimer::singleShot(30*1000, this, &P2PStatus_checker::update_status);
-      }
+      emit p2p_status(P2P_RUNNING);
     }
 }
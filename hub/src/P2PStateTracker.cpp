@@ -0,0 +1,329 @@
+#include <QCoreApplication>
+#include <QDebug>
+#include <QMutexLocker>
+#include <QNetworkRequest>
+#include <QUrl>
+
+#include "Commons.h"
+#include "OsBranchConsts.h"
+#include "P2PStateTracker.h"
+#include "ProcessRunner.h"
+#include "RestJsonParser.h"
+#include "RestContainers.h"
+#include "RestPipeline.h"
+#include "RestWorker.h"
+#include "SettingsManager.h"
+#include "SystemCallWrapper.h"
+
+const int CP2PStateTracker::RUNNING_INTERVAL_MS;
+const int CP2PStateTracker::DOWN_INTERVAL_MS;
+const int CP2PStateTracker::SHOW_TIMEOUT_MS;
+const int CP2PStateTracker::REST_TIMEOUT_MS;
+const int CP2PStateTracker::STALE_MS;
+
+CP2PStateTracker::CP2PStateTracker(CProcessRunner *runner,
+                                   CRestPipeline *pipeline,
+                                   path_getter_t p2p_path,
+                                   const QString &status_url,
+                                   QObject *parent) :
+  QObject(parent),
+  m_runner(runner),
+  m_pipeline(pipeline),
+  m_p2p_path(p2p_path),
+  m_status_url(status_url),
+  m_timer(this),
+  m_started(false),
+  m_refreshing(false),
+  m_refresh_again(false),
+  m_has_state(false),
+  m_refresh_count(0) {
+  m_timer.setSingleShot(true);
+  connect(&m_timer, &QTimer::timeout, this, &CP2PStateTracker::refresh_sl);
+}
+////////////////////////////////////////////////////////////////////////////
+
+CP2PStateTracker*
+CP2PStateTracker::Instance() {
+  static CP2PStateTracker* inst = []() {
+    CP2PStateTracker* tracker = new CP2PStateTracker(
+          CProcessRunner::Instance(),
+          CRestWorker::Instance()->pipeline(),
+          []() {return CSettingsManager::Instance().p2p_path();},
+          p2p_rest_url().arg("status"));
+    // lookups may come from pool threads first, timer must live in main thread
+    if (QCoreApplication::instance() != nullptr)
+      tracker->moveToThread(QCoreApplication::instance()->thread());
+    return tracker;
+  }();
+  return inst;
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CP2PStateTracker::start() {
+  {
+    QMutexLocker locker(&m_mutex);
+    if (m_started) return;
+    m_started = true;
+  }
+  refresh();
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CP2PStateTracker::stop() {
+  {
+    QMutexLocker locker(&m_mutex);
+    m_started = false;
+  }
+  QMetaObject::invokeMethod(&m_timer, "stop", Qt::QueuedConnection);
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CP2PStateTracker::refresh() {
+  QMetaObject::invokeMethod(this, "refresh_sl", Qt::QueuedConnection);
+}
+////////////////////////////////////////////////////////////////////////////
+
+bool
+CP2PStateTracker::has_state() const {
+  QMutexLocker locker(&m_mutex);
+  return valid_locked();
+}
+////////////////////////////////////////////////////////////////////////////
+
+bool
+CP2PStateTracker::state(p2p_state_t &st) const {
+  QMutexLocker locker(&m_mutex);
+  if (!valid_locked()) return false;
+  st = m_state;
+  return true;
+}
+////////////////////////////////////////////////////////////////////////////
+
+bool
+CP2PStateTracker::daemon_running() const {
+  QMutexLocker locker(&m_mutex);
+  return valid_locked() && m_state.running;
+}
+////////////////////////////////////////////////////////////////////////////
+
+bool
+CP2PStateTracker::is_in_swarm(const QString &hash) const {
+  QMutexLocker locker(&m_mutex);
+  return valid_locked() && m_state.swarms.contains(hash);
+}
+////////////////////////////////////////////////////////////////////////////
+
+QString
+CP2PStateTracker::swarm_interface(const QString &hash) const {
+  QMutexLocker locker(&m_mutex);
+  return valid_locked() ? m_state.interfaces.value(hash) : QString();
+}
+////////////////////////////////////////////////////////////////////////////
+
+CP2PStateTracker::container_state_t
+CP2PStateTracker::container_state(const QString &hash,
+                                  const QString &ip) const {
+  QMutexLocker locker(&m_mutex);
+  if (!valid_locked() || !m_state.peers_known) return CS_UNKNOWN;
+  if (!m_state.running || !m_state.swarms.contains(hash))
+    return CS_NOT_CONNECTED;
+  auto i = m_state.peers.find(peer_key(hash, ip));
+  // peer may be reported by other ip, only `p2p show -check` can tell then
+  if (i == m_state.peers.end()) return CS_UNKNOWN;
+  return i.value().compare("connected", Qt::CaseInsensitive) == 0 ?
+        CS_CONNECTED : CS_NOT_CONNECTED;
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CP2PStateTracker::swarm_joined(const QString &hash) {
+  {
+    QMutexLocker locker(&m_mutex);
+    m_state.swarms.insert(hash);
+  }
+  refresh();
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CP2PStateTracker::swarm_left(const QString &hash) {
+  {
+    QMutexLocker locker(&m_mutex);
+    m_state.swarms.remove(hash);
+    m_state.interfaces.remove(hash);
+  }
+  refresh();
+}
+////////////////////////////////////////////////////////////////////////////
+
+quint64
+CP2PStateTracker::refresh_count() const {
+  QMutexLocker locker(&m_mutex);
+  return m_refresh_count;
+}
+////////////////////////////////////////////////////////////////////////////
+
+QSet<QString>
+CP2PStateTracker::parse_swarms(const QStringList &show_out) {
+  QSet<QString> res;
+  for (auto i = show_out.begin(); i != show_out.end(); ++i) {
+    int pos = i->indexOf("swarm");
+    if (pos == -1) continue;
+    QString hash = i->mid(pos).trimmed();
+    if (!hash.isEmpty()) res.insert(hash);
+  }
+  return res;
+}
+////////////////////////////////////////////////////////////////////////////
+
+QHash<QString, QString>
+CP2PStateTracker::parse_interfaces(const QStringList &show_out) {
+  QHash<QString, QString> res;
+  for (auto i = show_out.begin(); i != show_out.end(); ++i) {
+    if (i->indexOf("swarm") == -1) continue;
+    QStringList lst = i->split("|", QString::SkipEmptyParts);
+    if (lst.size() != 2) continue;
+    res.insert(lst[0].trimmed(), lst[1].trimmed());
+  }
+  return res;
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CP2PStateTracker::refresh_sl() {
+  if (m_refreshing) {
+    m_refresh_again = true;
+    return;
+  }
+  m_timer.stop();
+  m_refreshing = true;
+  m_refresh_again = false;
+
+  state_ptr_t st = std::make_shared<p2p_state_t>();
+  QString p2p = m_p2p_path ? m_p2p_path() : QString();
+  if (!CCommons::IsApplicationLaunchable(p2p)) {
+    publish(st);
+    return;
+  }
+  st->installed = true;
+
+  if (m_pipeline != nullptr && !m_status_url.isEmpty())
+    query_rest(p2p, st);
+  else
+    query_show(p2p, st);
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CP2PStateTracker::query_rest(const QString &p2p,
+                             state_ptr_t st) {
+  QNetworkRequest req(QUrl(m_status_url));
+  req.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
+  std::shared_ptr<CJsonItemsParser<CP2PInstance> > parser =
+      std::make_shared<CJsonItemsParser<CP2PInstance> >("instances");
+
+  m_pipeline->enqueue(req, RO_GET, QByteArray(), REST_TIMEOUT_MS, this,
+                      [this, p2p, st, parser](const rest_response_t& resp) {
+    if (resp.http_code != 200 || resp.network_error != 0 ||
+        parser->failed() || parser->root()["code"].toInt() != 0) {
+      // old daemon without REST or daemon is down, cli will tell
+      query_show(p2p, st);
+      return;
+    }
+
+    st->running = true;
+    st->peers_known = true;
+    const std::vector<CP2PInstance>& instances = parser->items();
+    for (auto i = instances.begin(); i != instances.end(); ++i) {
+      if (i->id().isEmpty()) continue;
+      st->swarms.insert(i->id());
+      for (auto j = i->peers().begin(); j != i->peers().end(); ++j)
+        st->peers.insert(peer_key(i->id(), j->ip()), j->state());
+    }
+    query_interfaces(p2p, st);
+  }, parser);
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CP2PStateTracker::query_show(const QString &p2p,
+                             state_ptr_t st) {
+  process_options_t opts;
+  opts.timeout_msec = SHOW_TIMEOUT_MS;
+  opts.log = false;
+  process_callbacks_t cbs;
+  cbs.finished = [this, p2p, st](const system_call_res_t& res) {
+    st->running = res.res == SCWE_SUCCESS && res.exit_code == 0;
+    if (!st->running) {
+      publish(st);
+      return;
+    }
+    st->swarms = parse_swarms(res.out);
+    query_interfaces(p2p, st);
+  };
+  m_runner->start(p2p, QStringList() << "show", opts, this, cbs);
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CP2PStateTracker::query_interfaces(const QString &p2p,
+                                   state_ptr_t st) {
+  process_options_t opts;
+  opts.timeout_msec = SHOW_TIMEOUT_MS;
+  opts.log = false;
+  process_callbacks_t cbs;
+  cbs.finished = [this, st](const system_call_res_t& res) {
+    if (res.res == SCWE_SUCCESS && (res.exit_code == 0 || res.exit_code == 1))
+      st->interfaces = parse_interfaces(res.out);
+    else
+      qCritical() << "Can't get p2p interfaces:"
+                  << CSystemCallWrapper::scwe_error_to_str(res.res);
+    publish(st);
+  };
+  m_runner->start(p2p, QStringList() << "show" << "--interfaces" << "--bind",
+                  opts, this, cbs);
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CP2PStateTracker::publish(state_ptr_t st) {
+  // may be called in thread of runner or pipeline
+  {
+    QMutexLocker locker(&m_mutex);
+    m_state = *st;
+    m_has_state = true;
+    m_state_age.start();
+    ++m_refresh_count;
+  }
+  QMetaObject::invokeMethod(this, "refresh_finished_sl", Qt::QueuedConnection);
+}
+////////////////////////////////////////////////////////////////////////////
+
+bool
+CP2PStateTracker::valid_locked() const {
+  return m_has_state && m_state_age.elapsed() <= STALE_MS;
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CP2PStateTracker::refresh_finished_sl() {
+  m_refreshing = false;
+  bool started, running;
+  {
+    QMutexLocker locker(&m_mutex);
+    started = m_started;
+    running = m_state.running;
+  }
+  emit state_updated();
+
+  if (m_refresh_again) {
+    refresh_sl();
+    return;
+  }
+  if (started)
+    m_timer.start(running ? RUNNING_INTERVAL_MS : DOWN_INTERVAL_MS);
+}
+////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,190 @@
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QMutexLocker>
+
+#include "PathResolver.h"
+
+const int CPathResolver::MAX_ENTRIES;
+
+CPathResolver::CPathResolver() :
+  m_scans_count(0),
+  m_store_counter(0) {
+}
+////////////////////////////////////////////////////////////////////////////
+
+CPathResolver&
+CPathResolver::Instance() {
+  static CPathResolver inst;
+  return inst;
+}
+////////////////////////////////////////////////////////////////////////////
+
+QString
+CPathResolver::resolve(const QString &prog) {
+  return resolve(prog, QString::fromLocal8Bit(qgetenv("PATH")));
+}
+////////////////////////////////////////////////////////////////////////////
+
+QString
+CPathResolver::resolve(const QString &prog,
+                       const QString &path_env) {
+  if (prog.isEmpty()) return QString();
+
+  // `which /usr/bin/ssh` just checks given file
+  if (prog.contains('/') || prog.contains(QDir::separator())) {
+    QStringList lst = candidates(QString(), prog);
+    for (auto i = lst.begin(); i != lst.end(); ++i) {
+      if (is_executable(*i)) return *i;
+    }
+    return QString();
+  }
+
+  QString key = prog + "\n" + path_env;
+#ifdef RT_OS_WINDOWS
+  // the same name gives other result with other extensions or current dir
+  key += "\n" + path_ext() + "\n" + QDir::currentPath();
+#endif
+  {
+    QMutexLocker locker(&m_mutex);
+    auto i = m_cache.find(key);
+    if (i != m_cache.end() && is_valid(i->second))
+      return i->second.path;
+  }
+
+  // scan without lock, concurrent scans of the same name give the same result
+  entry_t et = scan(prog, search_dirs(path_env));
+
+  QMutexLocker locker(&m_mutex);
+  ++m_scans_count;
+  if (m_cache.find(key) == m_cache.end() &&
+      (int)m_cache.size() >= MAX_ENTRIES)
+    evict_oldest();
+  et.stored = ++m_store_counter;
+  m_cache[key] = et;
+  return et.path;
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CPathResolver::evict_oldest() {
+  auto oldest = m_cache.begin();
+  for (auto i = m_cache.begin(); i != m_cache.end(); ++i) {
+    if (i->second.stored < oldest->second.stored) oldest = i;
+  }
+  if (oldest != m_cache.end()) m_cache.erase(oldest);
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CPathResolver::clear() {
+  QMutexLocker locker(&m_mutex);
+  m_cache.clear();
+}
+////////////////////////////////////////////////////////////////////////////
+
+quint64
+CPathResolver::scans_count() const {
+  QMutexLocker locker(&m_mutex);
+  return m_scans_count;
+}
+////////////////////////////////////////////////////////////////////////////
+
+QStringList
+CPathResolver::search_dirs(const QString &path_env) {
+  QStringList res;
+#ifdef RT_OS_WINDOWS
+  // `where` looks into current directory first
+  res << QDir::currentPath();
+  QStringList parts = path_env.split(';', QString::SkipEmptyParts);
+#else
+  QStringList parts = path_env.split(':', QString::SkipEmptyParts);
+#endif
+  for (auto i = parts.begin(); i != parts.end(); ++i) {
+    QString dir = i->trimmed();
+#ifdef RT_OS_WINDOWS
+    if (dir.startsWith('"') && dir.endsWith('"') && dir.size() > 1)
+      dir = dir.mid(1, dir.size() - 2);
+#endif
+    if (!dir.isEmpty() && !res.contains(dir)) res << dir;
+  }
+#ifdef RT_OS_DARWIN
+  // CSystemCallWrapper::which used to look there when `which` failed
+  if (!res.contains("/usr/local/bin")) res << "/usr/local/bin";
+#endif
+  return res;
+}
+////////////////////////////////////////////////////////////////////////////
+
+QString
+CPathResolver::path_ext() {
+  QString pathext = QString::fromLocal8Bit(qgetenv("PATHEXT"));
+  return pathext.isEmpty() ? QString(".COM;.EXE;.BAT;.CMD") : pathext;
+}
+////////////////////////////////////////////////////////////////////////////
+
+qint64
+CPathResolver::dir_mtime(const QString &dir) {
+  QFileInfo fi(dir);
+  if (!fi.exists() || !fi.isDir()) return -1;
+  return fi.lastModified().toMSecsSinceEpoch();
+}
+////////////////////////////////////////////////////////////////////////////
+
+bool
+CPathResolver::is_executable(const QString &path) {
+  QFileInfo fi(path);
+  return fi.exists() && fi.isFile() && fi.isExecutable();
+}
+////////////////////////////////////////////////////////////////////////////
+
+QStringList
+CPathResolver::candidates(const QString &dir,
+                          const QString &prog) {
+  QString base = dir.isEmpty() ? prog : QDir(dir).filePath(prog);
+  QStringList res;
+  res << base;
+#ifdef RT_OS_WINDOWS
+  // `where cmd` finds cmd.exe
+  if (QFileInfo(prog).suffix().isEmpty()) {
+    QStringList exts = path_ext().split(';', QString::SkipEmptyParts);
+    for (auto i = exts.begin(); i != exts.end(); ++i)
+      res << base + i->toLower();
+  }
+#endif
+  return res;
+}
+////////////////////////////////////////////////////////////////////////////
+
+bool
+CPathResolver::is_valid(const entry_t &et) {
+  for (auto i = et.scanned.begin(); i != et.scanned.end(); ++i) {
+    if (dir_mtime(i->dir) != i->mtime) return false;
+  }
+  // binary may be replaced by something else without directory change
+  return et.path.isEmpty() || is_executable(et.path);
+}
+////////////////////////////////////////////////////////////////////////////
+
+CPathResolver::entry_t
+CPathResolver::scan(const QString &prog,
+                    const QStringList &dirs) {
+  entry_t et;
+  for (auto i = dirs.begin(); i != dirs.end(); ++i) {
+    // stamp is taken before lookup, so change during lookup invalidates entry
+    dir_stamp_t ds;
+    ds.dir = *i;
+    ds.mtime = dir_mtime(*i);
+    et.scanned.push_back(ds);
+    if (ds.mtime == -1) continue;
+
+    QStringList lst = candidates(*i, prog);
+    for (auto j = lst.begin(); j != lst.end(); ++j) {
+      if (!is_executable(*j)) continue;
+      et.path = QDir::toNativeSeparators(*j);
+      return et;
+    }
+  }
+  return et;
+}
+////////////////////////////////////////////////////////////////////////////
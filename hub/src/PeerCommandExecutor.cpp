@@ -0,0 +1,185 @@
+#include <QCoreApplication>
+#include <QDebug>
+#include <QMutexLocker>
+#include <QtConcurrent/QtConcurrentRun>
+
+#include "PeerCommandExecutor.h"
+
+const int CPeerCommandExecutor::DEFAULT_MAX_WORKERS;
+
+CPeerCommandExecutor::CPeerCommandExecutor(int max_workers,
+                                           QObject *parent) :
+  QObject(parent),
+  m_last_id(0),
+  m_total(0),
+  m_finished(0) {
+  m_pool.setMaxThreadCount(max_workers > 0 ? max_workers : 1);
+}
+
+CPeerCommandExecutor::~CPeerCommandExecutor() {
+  cancel_all();
+  m_pool.waitForDone();
+}
+////////////////////////////////////////////////////////////////////////////
+
+CPeerCommandExecutor*
+CPeerCommandExecutor::Instance() {
+  static CPeerCommandExecutor* inst = []() {
+    CPeerCommandExecutor* executor = new CPeerCommandExecutor;
+    // callbacks update widgets, so they are called in main thread
+    if (QCoreApplication::instance() != nullptr)
+      executor->moveToThread(QCoreApplication::instance()->thread());
+    return executor;
+  }();
+  return inst;
+}
+////////////////////////////////////////////////////////////////////////////
+
+CPeerCommandExecutor::command_id_t
+CPeerCommandExecutor::enqueue(const QString &peer,
+                              const QString &command,
+                              job_t job,
+                              QObject *context,
+                              finished_callback_t callback) {
+  command_t cmd;
+  cmd.peer = peer;
+  cmd.command = command;
+  cmd.job = job;
+  cmd.context = context;
+  cmd.has_context = context != nullptr;
+  cmd.callback = callback;
+  cmd.state = std::make_shared<QAtomicInt>(CMD_QUEUED);
+
+  bool first;
+  {
+    QMutexLocker locker(&m_mutex);
+    cmd.id = ++m_last_id;
+    std::deque<command_t>& queue = m_queues[peer];
+    queue.push_back(cmd);
+    first = queue.size() == 1;
+    ++m_total;
+  }
+
+  qInfo() << "Peer command queued:" << peer << command;
+  emit command_queued(cmd.id, peer, command);
+  if (first) submit(cmd);
+  return cmd.id;
+}
+////////////////////////////////////////////////////////////////////////////
+
+bool
+CPeerCommandExecutor::cancel(command_id_t id) {
+  return cancel_if([id](const command_t& cmd) {return cmd.id == id;}) > 0;
+}
+////////////////////////////////////////////////////////////////////////////
+
+int
+CPeerCommandExecutor::cancel_peer(const QString &peer) {
+  return cancel_if([peer](const command_t& cmd) {return cmd.peer == peer;});
+}
+////////////////////////////////////////////////////////////////////////////
+
+int
+CPeerCommandExecutor::cancel_all() {
+  return cancel_if([](const command_t&) {return true;});
+}
+////////////////////////////////////////////////////////////////////////////
+
+bool
+CPeerCommandExecutor::is_busy(const QString &peer) const {
+  QMutexLocker locker(&m_mutex);
+  return m_queues.find(peer) != m_queues.end();
+}
+////////////////////////////////////////////////////////////////////////////
+
+int
+CPeerCommandExecutor::pending_count() const {
+  QMutexLocker locker(&m_mutex);
+  return m_total - m_finished;
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CPeerCommandExecutor::submit(const command_t &cmd) {
+  command_id_t id = cmd.id;
+  QString peer = cmd.peer, command = cmd.command;
+  job_t job = cmd.job;
+  std::shared_ptr<QAtomicInt> state = cmd.state;
+
+  QtConcurrent::run(&m_pool, [this, id, peer, command, job, state]() {
+    system_call_wrapper_error_t res = SCWE_CANCELLED;
+    if (state->testAndSetOrdered(CMD_QUEUED, CMD_RUNNING)) {
+      QMetaObject::invokeMethod(this, "command_started_sl", Qt::QueuedConnection,
+                                Q_ARG(quint64, id), Q_ARG(QString, peer),
+                                Q_ARG(QString, command));
+      res = job ? job() : SCWE_SUCCESS;
+    }
+    QMetaObject::invokeMethod(this, "command_finished_sl", Qt::QueuedConnection,
+                              Q_ARG(quint64, id), Q_ARG(QString, peer),
+                              Q_ARG(int, (int)res));
+  });
+}
+////////////////////////////////////////////////////////////////////////////
+
+int
+CPeerCommandExecutor::cancel_if(std::function<bool(const command_t &)> pred) {
+  QMutexLocker locker(&m_mutex);
+  int count = 0;
+  for (auto i = m_queues.begin(); i != m_queues.end(); ++i) {
+    for (auto j = i->second.begin(); j != i->second.end(); ++j) {
+      if (pred(*j) && j->state->testAndSetOrdered(CMD_QUEUED, CMD_CANCELLED))
+        ++count;
+    }
+  }
+  return count;
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CPeerCommandExecutor::command_started_sl(quint64 id,
+                                         QString peer,
+                                         QString command) {
+  qInfo() << "Peer command started:" << peer << command;
+  emit command_started(id, peer, command);
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CPeerCommandExecutor::command_finished_sl(quint64 id,
+                                          QString peer,
+                                          int res) {
+  command_t cmd;
+  bool has_next = false;
+  command_t next;
+  int finished, total;
+  {
+    QMutexLocker locker(&m_mutex);
+    auto queue = m_queues.find(peer);
+    if (queue == m_queues.end() || queue->second.empty() ||
+        queue->second.front().id != id)
+      return;
+    cmd = queue->second.front();
+    queue->second.pop_front();
+    if (queue->second.empty()) {
+      m_queues.erase(queue);
+    } else {
+      next = queue->second.front();
+      has_next = true;
+    }
+
+    finished = ++m_finished;
+    total = m_total;
+    if (m_finished == m_total) m_finished = m_total = 0;
+  }
+
+  qInfo() << "Peer command finished:" << peer << cmd.command
+          << CSystemCallWrapper::scwe_error_to_str((system_call_wrapper_error_t)res);
+  // next command of peer doesn't wait for callbacks
+  if (has_next) submit(next);
+
+  if (cmd.callback && (!cmd.has_context || cmd.context))
+    cmd.callback((system_call_wrapper_error_t)res);
+  emit command_finished(id, peer, cmd.command, res);
+  emit progress(finished, total);
+}
+////////////////////////////////////////////////////////////////////////////
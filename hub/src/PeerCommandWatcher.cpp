@@ -0,0 +1,190 @@
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QRegExp>
+#include <vector>
+
+#include "PeerCommandWatcher.h"
+
+CPeerCommandWatcher::CPeerCommandWatcher(name_parser_t parse_name,
+                                         QObject *parent) :
+  QObject(parent),
+  m_parse_name(parse_name),
+  m_watcher(this) {
+  connect(&m_watcher, &QFileSystemWatcher::directoryChanged,
+          this, &CPeerCommandWatcher::directory_changed_sl);
+  connect(&m_watcher, &QFileSystemWatcher::fileChanged,
+          this, &CPeerCommandWatcher::file_changed_sl);
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CPeerCommandWatcher::set_base_dir(const QString &dir) {
+  QString clean = QDir::cleanPath(QDir(dir).absolutePath());
+  if (clean == m_base_dir && m_watcher.directories().contains(clean))
+    return;
+
+  QStringList watched = m_watcher.directories() + m_watcher.files();
+  if (!watched.isEmpty()) m_watcher.removePaths(watched);
+  m_peers.clear();
+  m_logs.clear();
+
+  m_base_dir = clean;
+  // base directory may be created later, next call will try again
+  if (!QFileInfo(clean).isDir()) return;
+  m_watcher.addPath(clean);
+  sync_peers();
+}
+////////////////////////////////////////////////////////////////////////////
+
+QStringList
+CPeerCommandWatcher::peer_dirs() const {
+  QStringList res;
+  for (auto i = m_peers.begin(); i != m_peers.end(); ++i)
+    res << i->first;
+  return res;
+}
+////////////////////////////////////////////////////////////////////////////
+
+QString
+CPeerCommandWatcher::log_so_far(const QString &peer_dir,
+                                const QString &command) const {
+  QString prefix = QDir::cleanPath(QDir(peer_dir).absolutePath()) + "/";
+  QString suffix = "_" + command;
+  for (auto i = m_logs.begin(); i != m_logs.end(); ++i) {
+    if (i->first.startsWith(prefix) && i->first.endsWith(suffix))
+      return QString::fromUtf8(i->second.data);
+  }
+  return QString();
+}
+////////////////////////////////////////////////////////////////////////////
+
+QString
+CPeerCommandWatcher::clean_messages(const QByteArray &log) {
+  QString res = QString::fromUtf8(log);
+  res.remove(QRegExp("\x1b[^m]*m"));
+  return res;
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CPeerCommandWatcher::sync_peers() {
+  std::map<QString, QString> actual;
+  QDir base(m_base_dir);
+  QFileInfoList entries = base.entryInfoList(QDir::Dirs | QDir::NoDotAndDotDot);
+  for (auto i = entries.begin(); i != entries.end(); ++i) {
+    QString name = m_parse_name ? m_parse_name(i->fileName()) : i->fileName();
+    if (name.isEmpty()) continue;
+    actual[QDir::cleanPath(i->absoluteFilePath())] = name;
+  }
+
+  for (auto i = m_peers.begin(); i != m_peers.end(); ) {
+    if (actual.find(i->first) != actual.end()) {
+      ++i;
+      continue;
+    }
+    // watcher forgets removed directories itself
+    if (m_watcher.directories().contains(i->first))
+      m_watcher.removePath(i->first);
+    QString prefix = i->first + "/";
+    for (auto j = m_logs.begin(); j != m_logs.end(); ) {
+      if (j->first.startsWith(prefix)) j = m_logs.erase(j);
+      else ++j;
+    }
+    i = m_peers.erase(i);
+  }
+
+  std::vector<QString> added;
+  for (auto i = actual.begin(); i != actual.end(); ++i) {
+    if (m_peers.find(i->first) != m_peers.end()) continue;
+    m_peers[i->first] = i->second;
+    m_watcher.addPath(i->first);
+    added.push_back(i->first);
+  }
+  for (auto i = added.begin(); i != added.end(); ++i)
+    scan_peer(*i);
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CPeerCommandWatcher::scan_peer(const QString &dir) {
+  auto peer = m_peers.find(dir);
+  if (peer == m_peers.end()) return;
+  QString peer_name = peer->second;
+
+  QStringList finished;
+  std::map<QString, QString> logs;   // command -> log path
+  QFileInfoList entries = QDir(dir).entryInfoList(QDir::Files);
+  for (auto i = entries.begin(); i != entries.end(); ++i) {
+    QStringList parts = i->fileName().split('_');
+    if (parts.size() != 2) continue;
+    if (parts[1] == "finished")
+      finished << parts[0];
+    else
+      logs[parts[1]] = QDir::cleanPath(i->absoluteFilePath());
+  }
+
+  for (auto i = logs.begin(); i != logs.end(); ++i) {
+    if (m_logs.find(i->second) == m_logs.end())
+      m_watcher.addPath(i->second);
+    read_tail(i->second, m_logs[i->second]);
+  }
+
+  // signal handlers may remove peer, so events are emitted after files are handled
+  std::vector<std::pair<QString, QString> > events;   // command, messages
+  for (auto i = finished.begin(); i != finished.end(); ++i) {
+    QByteArray data;
+    auto log = logs.find(*i);
+    if (log != logs.end()) {
+      data = m_logs[log->second].data;
+      m_logs.erase(log->second);
+      m_watcher.removePath(log->second);
+      QFile::remove(log->second);
+    }
+    QFile::remove(dir + "/" + *i + "_finished");
+    events.push_back(std::make_pair(*i, clean_messages(data)));
+  }
+
+  for (auto i = events.begin(); i != events.end(); ++i)
+    emit command_finished(peer_name, dir, i->first, i->second);
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CPeerCommandWatcher::read_tail(const QString &path,
+                               log_t &log) {
+  QFile file(path);
+  if (!file.open(QIODevice::ReadOnly)) return;
+  // log is truncated when command is run again
+  if (file.size() < log.offset) {
+    log.offset = 0;
+    log.data.clear();
+  }
+  if (!file.seek(log.offset)) return;
+  log.data += file.readAll();
+  log.offset = file.pos();
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CPeerCommandWatcher::directory_changed_sl(const QString &path) {
+  QString clean = QDir::cleanPath(path);
+  if (clean == m_base_dir) {
+    sync_peers();
+    return;
+  }
+  if (m_peers.find(clean) == m_peers.end()) return;
+  if (QFileInfo(clean).isDir())
+    scan_peer(clean);
+  else
+    sync_peers();
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CPeerCommandWatcher::file_changed_sl(const QString &path) {
+  auto i = m_logs.find(QDir::cleanPath(path));
+  if (i == m_logs.end()) return;
+  read_tail(i->first, i->second);
+}
+////////////////////////////////////////////////////////////////////////////
@@ -1,6 +1,7 @@
 #include "PeerController.h"
 #include <QMessageBox>
 #include <QPushButton>
+#include "Commons.h"
 #include "NotificationObserver.h"
 #include "TrayControlWindow.h"
 #include "QStandardPaths"
@@ -10,7 +11,11 @@
 #include "SystemCallWrapper.h"
 
 
-CPeerController::CPeerController(QObject *parent) : QObject(parent) {}
+CPeerController::CPeerController(QObject *parent) :
+  QObject(parent),
+  m_pool(nullptr),
+  m_pipeline(nullptr),
+  m_command_watcher(nullptr) {}
 
 CPeerController::~CPeerController() {
   //m_pool->waitForDone();
@@ -22,20 +27,49 @@ void CPeerController::init() {
   m_pool = new QThreadPool(this);
   m_pool->setMaxThreadCount(1);
   m_stop_thread = false;
-  m_logs_timer.setInterval(7 * 1000);     // 7 seconds check peer logs
-  number_threads = 0;
+
+  // vagrant serializes commands of one peer only, so peers are checked in parallel
+  m_pipeline = new CPeerStatusPipeline(
+    [](const QString &dir) {
+      if (CPeerController::Instance()->get_stop_thread()) return QString();
+      return CSystemCallWrapper::vagrant_status(dir);
+    },
+    [](const QString &dir) {
+      if (CPeerController::Instance()->get_stop_thread()) return QString();
+      return CSystemCallWrapper::vagrant_port(dir);
+    },
+    [](const QString &name, const QString &dir, const QString &port,
+       CPeerStatusPipeline::reply_t reply) {
+      UNUSED_ARG(dir);
+      CRestWorker::Instance()->peer_finger(management_url(port), name, reply);
+    },
+    [](const QString &name, const QString &dir, const QString &port,
+       CPeerStatusPipeline::reply_t reply) {
+      UNUSED_ARG(dir);
+      CRestWorker::Instance()->peer_get_info(management_url(port), "isUpdatesAvailable",
+                                             name, reply);
+    },
+    CPeerStatusPipeline::DEFAULT_MAX_PARALLEL, this);
+  connect(m_pipeline, &CPeerStatusPipeline::stage_finished,
+          this, &CPeerController::stage_finished_sl);
+  connect(m_pipeline, &CPeerStatusPipeline::idle,
+          this, &CPeerController::pipeline_idle_sl);
+
+  m_command_watcher = new CPeerCommandWatcher(
+    [this](const QString &dir_name) { return parse_name(dir_name); }, this);
+  connect(m_command_watcher, &CPeerCommandWatcher::command_finished,
+          this, &CPeerController::command_finished_sl);
+  m_command_watcher->set_base_dir(VagrantProvider::Instance()->BasePeerDir().absolutePath());
+
   QTimer::singleShot(2000, this, &CPeerController::refresh_timer_timeout);
-  connect(&m_logs_timer, &QTimer::timeout, this, &CPeerController::check_logs);
   connect(QCoreApplication::instance(), &QCoreApplication::aboutToQuit, [this](){
     this->m_stop_thread = true;
     qDebug() << "APPLICATION STOP THREAD SET";
   });
-
-  m_logs_timer.start();
 }
 
 void CPeerController::refresh() {
-  if (number_threads != 0) return;
+  if (m_pipeline->in_flight_count() != 0) return;
   UpdateVMInformation *update_thread = new UpdateVMInformation(this);
   update_thread->startWork(m_pool);
   connect(update_thread, &UpdateVMInformation::outputReceived,
@@ -48,7 +82,7 @@ void CPeerController::refresh() {
 }
 
 void CPeerController::force_refresh() {
-  if (number_threads != 0) return;
+  if (m_pipeline->in_flight_count() != 0) return;
   UpdateVMInformation *update_thread = new UpdateVMInformation(this);
   update_thread->set_force_update(true);
   update_thread->startWork(m_pool);
@@ -156,15 +190,16 @@ const QString &CPeerController::provision_step_description(const int &step) {
 }
 
 void CPeerController::refresh_timer_timeout() {
+  // provider and so directory of peers may be changed in settings
+  m_command_watcher->set_base_dir(VagrantProvider::Instance()->BasePeerDir().absolutePath());
   refresh();
   QTimer::singleShot(13000, this, &CPeerController::refresh_timer_timeout);
 }
 
 void CPeerController::search_local() {
+  std::vector<std::pair<QString, QString> > peers;
   if (this->vagrant_global_status.out.empty()) {
     QDir peers_dir = VagrantProvider::Instance()->BasePeerDir();
-    QStringList stdDirList;
-    QStringList::iterator stdDir;
 
     // start looking each subfolder
     for (QFileInfo fi : peers_dir.entryInfoList()) {
@@ -174,10 +209,7 @@ void CPeerController::search_local() {
       QFileInfo peer_provider_file(peer_provider_file_path);
 
       if (peer_provider_file.exists())
-        get_peer_info(fi, peers_dir);
-    }
-    if (number_threads == 0) {
-      emit got_peer_info(P_STATUS, "update", "peer", "menu");
+        get_peer_info(fi, peers_dir, peers);
     }
   } else {
     for (QString s : this->vagrant_global_status.out) {
@@ -185,70 +217,41 @@ void CPeerController::search_local() {
       QDir dir(s);
       qDebug() << "Get peer info "
                << fi.fileName();
-      get_peer_info(fi, dir);
+      get_peer_info(fi, dir, peers);
     }
+  }
 
-    if (number_threads == 0) {
-      emit got_peer_info(P_STATUS, "update", "peer", "menu");
-    }
+  // peers held by vagrant commands are skipped
+  if (m_pipeline->submit(peers) == 0) {
+    emit got_peer_info(P_STATUS, "update", "peer", "menu");
   }
 }
-// the most tricky part
-void CPeerController::check_logs() {
-  // get correct path;
-  QDir peers_dir = VagrantProvider::Instance()->BasePeerDir();
-
-  // start looking each subfolder
-  QStringList file_name;
-  QDir peer_dir;
-  QString peer_name;
-  //   / QString error_code;
-  bool deleted_flag = false;
-  for (QFileInfo fi : peers_dir.entryInfoList()) {
-    if (fi.isDir()) {
-      if (fi.fileName() == "." || fi.fileName() == "..") continue;
-      peer_dir = peers_dir;
-      peer_name = parse_name(fi.fileName());
-      if (peer_name.isEmpty()) continue;
-      deleted_flag = false;
-      peer_dir.cd(fi.fileName());
-      // show error messages
-      for (QFileInfo logs : peer_dir.entryInfoList()) {
-        if (logs.isDir()) continue;
-        file_name = logs.fileName().split('_');
-        if (file_name.size() == 2 && file_name[1] == "finished") {
-          QFile log(logs.absoluteFilePath());
-          QString error_message = get_error_messages(peer_dir, file_name[0]);
-          if (error_message.isEmpty()) {
-            if (file_name[0] == "destroy") {
-              deleted_flag = true;
-            }
-            if (file_name[0] != "ssh") // do not show ssh message
-              CNotificationObserver::Info(
-                  tr("Peer %1 has finished to \"%2\" successfully.")
-                      .arg(peer_name, file_name[0]),
-                  DlgNotification::N_NO_ACTION);
-          } else if (file_name[0] != "ssh") // do not show ssh message
-            CNotificationObserver::Info(
-                tr("Peer %1 has finished to \"%2\" with following messages:\n "
-                   "%3")
-                    .arg(peer_name, file_name[0], error_message),
-                DlgNotification::N_NO_ACTION);
-          log.remove();
-        }
-      }
-      if (deleted_flag) {
-        if (!peer_dir.removeRecursively())
-          CNotificationObserver::Error(
-              tr("Failed to completely clear the peer's path while destroying "
-                 "the peer. "
-                 "You may manually delete the folder that contains the peer "
-                 "data."),
-              DlgNotification::N_NO_ACTION);
-        finish_current_update();
-        refresh();
-      }
-    }
+void CPeerController::command_finished_sl(QString peer_name, QString peer_dir,
+                                          QString command, QString messages) {
+  if (messages.isEmpty()) {
+    if (command != "ssh") // do not show ssh message
+      CNotificationObserver::Info(
+          tr("Peer %1 has finished to \"%2\" successfully.")
+              .arg(peer_name, command),
+          DlgNotification::N_NO_ACTION);
+  } else if (command != "ssh") { // do not show ssh message
+    CNotificationObserver::Info(
+        tr("Peer %1 has finished to \"%2\" with following messages:\n "
+           "%3")
+            .arg(peer_name, command, messages),
+        DlgNotification::N_NO_ACTION);
+  }
+
+  if (command == "destroy" && messages.isEmpty()) {
+    if (!QDir(peer_dir).removeRecursively())
+      CNotificationObserver::Error(
+          tr("Failed to completely clear the peer's path while destroying "
+             "the peer. "
+             "You may manually delete the folder that contains the peer "
+             "data."),
+          DlgNotification::N_NO_ACTION);
+    finish_current_update();
+    refresh();
   }
 }
 
@@ -289,59 +292,19 @@ bool CPeerController::is_provision_running(QDir peer_dir) {
   return false;
 }
 
-QString CPeerController::get_error_messages(QDir peer_dir, QString command) {
-  qDebug() << "Get error messages of" << peer_dir << command;
-  QString error_message;
-  for (QFileInfo logs : peer_dir.entryInfoList()) {
-    if (logs.isDir()) continue;
-    QStringList file_name = logs.fileName().split('_');
-    if (file_name.size() == 2 && file_name[1] == command) {
-      QFile log(logs.absoluteFilePath());
-      if (log.open(QIODevice::ReadWrite)) {
-        QTextStream stream(&log);
-        error_message = QString(stream.readAll());
-        log.close();
-      }
-      log.remove();
-      break;
-    }
-  }
-  error_message.remove(QRegExp("\x1b[^m]*m"));
-  return error_message;
-}
-
-void CPeerController::get_peer_info(const QFileInfo &fi, QDir dir) {
+void CPeerController::get_peer_info(const QFileInfo &fi, QDir dir,
+                                    std::vector<std::pair<QString, QString> > &peers) {
   if (fi.fileName() == "." || fi.fileName() == "..") return;
   if (!fi.isDir()) return;
   QString peer_name = parse_name(fi.fileName());
-  static peer_info_t status_type = P_STATUS;
   if (peer_name == "") return;
 
   if (this->vagrant_global_status.out.empty())
     dir.cd(fi.fileName());
 
-  // stop get_peer_info (return) if vagrant is executig vagrant commands like reload, up, halt, destroy
-  if (status_type == peer_info_t::P_STATUS && is_running_command(QDir::toNativeSeparators(dir.absolutePath()))) {
-    return;
-  }
-
-  // get status of peer
   qDebug() << "GETTING PEER INFO"
            << peer_name;
-
-  GetPeerInfo *thread_for_status = new GetPeerInfo(this);
-  number_threads++;
-  thread_for_status->init(dir.absolutePath(), status_type);
-  thread_for_status->startWork(m_pool);
-  connect(thread_for_status, &GetPeerInfo::outputReceived,
-          [dir, peer_name, this, thread_for_status](peer_info_t type, QString res) {
-            if (type == CPeerController::P_STATUS)
-              CPeerController::Instance()->remove_checking_status(QDir::toNativeSeparators(dir.absolutePath()));
-
-            this->parse_peer_info(type, peer_name, dir.absolutePath(), res);
-            delete thread_for_status;
-          });
-  return;
+  peers.push_back(std::make_pair(peer_name, dir.absolutePath()));
 }
 
 QString CPeerController::parse_name(const QString &name) {
@@ -365,52 +328,37 @@ QString CPeerController::parse_name(const QString &name) {
   return peer_name;
 }
 
-void CPeerController::parse_peer_info(peer_info_t type, const QString &name,
-                                      const QString &dir,
-                                      const QString &output) {
-  if (number_threads == 0) return;
-  // get ip of peer
-  if (type == P_STATUS) {
-    qDebug() << "Got status of " << name << "status:" << output;
-
-    if (output != "running") {
-      qCritical() << "not working peer" << name;
-    } else {
-      GetPeerInfo *thread_for_ip = new GetPeerInfo(this);
-      peer_info_t ip_type = P_PORT;
-      thread_for_ip->init(dir, ip_type);
-      number_threads++;
-      thread_for_ip->startWork(m_pool);
-      connect(thread_for_ip, &GetPeerInfo::outputReceived,
-              [dir, name, this, thread_for_ip](peer_info_t type, QString res) {
-                this->parse_peer_info(type, name, dir, res);
-                delete thread_for_ip;
-              });
-    }
-  } else if (type == P_PORT) {
-    qDebug() << "Got ip of " << name << "ip:" << output;
-    if (!output.isEmpty() && output != "undefined") {
-      QString url_management = "localhost:" + output;
-
-      if (VagrantProvider::Instance()->UseIp())
-        url_management = output + ":8443";
-
-      // get finger
-      CRestWorker::Instance()->peer_finger(url_management, P_FINGER, name, dir);
-      number_threads++;
-      CRestWorker::Instance()->peer_get_info(url_management, "isUpdatesAvailable",
-                                             P_UPDATE, name, dir);
-      number_threads++;
-    }
-  } else if (type == P_FINGER) {
-    qDebug() << "Got finger of " << name << "finger:" << output;
-  } else if (type == P_UPDATE) {
-    qDebug() << "Got update of " << name << "update:" << output;
+QString CPeerController::management_url(const QString &port) {
+  if (VagrantProvider::Instance()->UseIp())
+    return port + ":8443";
+  return "localhost:" + port;
+}
+
+void CPeerController::stage_finished_sl(int stage, QString name, QString dir,
+                                        QString output) {
+  if (m_stop_thread) return;
+  switch (stage) {
+    case P_STATUS:
+      qDebug() << "Got status of " << name << "status:" << output;
+      if (output != "running")
+        qCritical() << "not working peer" << name;
+      break;
+    case P_PORT:
+      qDebug() << "Got ip of " << name << "ip:" << output;
+      break;
+    case P_FINGER:
+      qDebug() << "Got finger of " << name << "finger:" << output;
+      break;
+    case P_UPDATE:
+      qDebug() << "Got update of " << name << "update:" << output;
+      break;
+    default:
+      break;
   }
-  static QString undefined_string = "undefined";
-  if (output.isEmpty())
-    emit got_peer_info(type, name, dir, undefined_string);
-  else
-    emit got_peer_info(type, name, dir, output);
-  return;
+  emit got_peer_info((peer_info_t)stage, name, dir, output);
+}
+
+void CPeerController::pipeline_idle_sl() {
+  if (m_stop_thread) return;
+  emit got_peer_info(P_STATUS, "update", "peer", "menu");
 }
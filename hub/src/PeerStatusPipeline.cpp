@@ -0,0 +1,287 @@
+#include <QDir>
+#include <QMutexLocker>
+#include <QPointer>
+#include <QtConcurrent/QtConcurrentRun>
+
+#include "PeerStatusPipeline.h"
+
+const int CPeerStatusPipeline::DEFAULT_MAX_PARALLEL;
+
+CPeerStatusPipeline::CPeerStatusPipeline(probe_t status_probe,
+                                         probe_t port_probe,
+                                         rest_probe_t finger_probe,
+                                         rest_probe_t update_probe,
+                                         int max_parallel,
+                                         QObject *parent) :
+  QObject(parent),
+  m_status_probe(status_probe),
+  m_port_probe(port_probe),
+  m_finger_probe(finger_probe),
+  m_update_probe(update_probe),
+  m_in_flight(0),
+  m_generation(0),
+  m_destroying(false) {
+  set_max_parallel(max_parallel);
+}
+
+CPeerStatusPipeline::~CPeerStatusPipeline() {
+  {
+    QMutexLocker locker(&m_mutex);
+    m_destroying = true;
+  }
+  m_pool.waitForDone();
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CPeerStatusPipeline::set_max_parallel(int max_parallel) {
+  m_pool.setMaxThreadCount(max_parallel < 1 ? 1 : max_parallel);
+}
+////////////////////////////////////////////////////////////////////////////
+
+int
+CPeerStatusPipeline::submit(const std::vector<std::pair<QString, QString> > &peers) {
+  std::vector<QString> started;
+  quint64 generation;
+  {
+    QMutexLocker locker(&m_mutex);
+    generation = m_generation;
+    for (auto i = peers.begin(); i != peers.end(); ++i) {
+      QString key = key_of(i->second);
+      entry_t& et = m_peers[key];
+      if (et.state.in_flight || et.state.command_running) continue;
+      et.state.name = i->first;
+      et.state.dir = i->second;
+      et.state.stage = ST_STATUS;
+      et.state.in_flight = true;
+      et.pending = 0;
+      et.generation = generation;
+      ++m_in_flight;
+      started.push_back(key);
+    }
+  }
+
+  for (auto i = started.begin(); i != started.end(); ++i)
+    run_probe(ST_STATUS, *i, generation);
+  return (int)started.size();
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CPeerStatusPipeline::abandon() {
+  QMutexLocker locker(&m_mutex);
+  ++m_generation;
+  for (auto i = m_peers.begin(); i != m_peers.end(); ++i) {
+    i->second.state.in_flight = false;
+    i->second.pending = 0;
+  }
+  m_in_flight = 0;
+}
+////////////////////////////////////////////////////////////////////////////
+
+int
+CPeerStatusPipeline::in_flight_count() const {
+  QMutexLocker locker(&m_mutex);
+  return m_in_flight;
+}
+////////////////////////////////////////////////////////////////////////////
+
+bool
+CPeerStatusPipeline::is_in_flight(const QString &dir) const {
+  QMutexLocker locker(&m_mutex);
+  auto i = m_peers.find(key_of(dir));
+  return i != m_peers.end() && i->second.state.in_flight;
+}
+////////////////////////////////////////////////////////////////////////////
+
+bool
+CPeerStatusPipeline::is_checking_status(const QString &dir) const {
+  QMutexLocker locker(&m_mutex);
+  auto i = m_peers.find(key_of(dir));
+  return i != m_peers.end() && i->second.state.in_flight &&
+      i->second.state.stage == ST_STATUS;
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CPeerStatusPipeline::set_command_running(const QString &dir,
+                                         bool running) {
+  QMutexLocker locker(&m_mutex);
+  entry_t& et = m_peers[key_of(dir)];
+  if (et.state.dir.isEmpty()) et.state.dir = dir;
+  et.state.command_running = running;
+}
+////////////////////////////////////////////////////////////////////////////
+
+bool
+CPeerStatusPipeline::is_command_running(const QString &dir) const {
+  QMutexLocker locker(&m_mutex);
+  auto i = m_peers.find(key_of(dir));
+  return i != m_peers.end() && i->second.state.command_running;
+}
+////////////////////////////////////////////////////////////////////////////
+
+bool
+CPeerStatusPipeline::has_peer(const QString &dir) const {
+  QMutexLocker locker(&m_mutex);
+  return m_peers.find(key_of(dir)) != m_peers.end();
+}
+////////////////////////////////////////////////////////////////////////////
+
+peer_state_t
+CPeerStatusPipeline::peer(const QString &dir) const {
+  QMutexLocker locker(&m_mutex);
+  auto i = m_peers.find(key_of(dir));
+  return i == m_peers.end() ? peer_state_t() : i->second.state;
+}
+////////////////////////////////////////////////////////////////////////////
+
+std::vector<peer_state_t>
+CPeerStatusPipeline::peers() const {
+  QMutexLocker locker(&m_mutex);
+  std::vector<peer_state_t> res;
+  res.reserve(m_peers.size());
+  for (auto i = m_peers.begin(); i != m_peers.end(); ++i)
+    res.push_back(i->second.state);
+  return res;
+}
+////////////////////////////////////////////////////////////////////////////
+
+QString
+CPeerStatusPipeline::key_of(const QString &dir) {
+  return QDir::cleanPath(QDir::fromNativeSeparators(dir));
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CPeerStatusPipeline::run_probe(int stage,
+                               const QString &key,
+                               quint64 generation) {
+  QString dir;
+  {
+    QMutexLocker locker(&m_mutex);
+    auto i = m_peers.find(key);
+    if (i == m_peers.end()) return;
+    dir = i->second.state.dir;
+  }
+  probe_t probe = stage == ST_STATUS ? m_status_probe : m_port_probe;
+  QtConcurrent::run(&m_pool, [this, probe, stage, key, dir, generation]() {
+    {
+      QMutexLocker locker(&m_mutex);
+      // peer may be abandoned while it waited for free thread
+      if (m_destroying || generation != m_generation) return;
+    }
+    post_result(stage, key, generation, probe ? probe(dir) : QString());
+  });
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CPeerStatusPipeline::run_rest(const QString &key,
+                              quint64 generation,
+                              const QString &name,
+                              const QString &dir,
+                              const QString &port) {
+  QPointer<CPeerStatusPipeline> self(this);
+  auto reply_of = [self, key, generation](int stage) -> reply_t {
+    return [self, key, generation, stage](const QString& output) {
+      if (self) self->post_result(stage, key, generation, output);
+    };
+  };
+
+  if (m_finger_probe)
+    m_finger_probe(name, dir, port, reply_of(ST_FINGER));
+  else
+    post_result(ST_FINGER, key, generation, QString());
+
+  if (m_update_probe)
+    m_update_probe(name, dir, port, reply_of(ST_UPDATE));
+  else
+    post_result(ST_UPDATE, key, generation, QString());
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CPeerStatusPipeline::finish_peer_locked(entry_t &et) {
+  et.state.in_flight = false;
+  et.pending = 0;
+  if (m_in_flight > 0) --m_in_flight;
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CPeerStatusPipeline::post_result(int stage,
+                                 const QString &key,
+                                 quint64 generation,
+                                 const QString &output) {
+  QMetaObject::invokeMethod(this, "stage_finished_sl", Qt::QueuedConnection,
+                            Q_ARG(int, stage), Q_ARG(QString, key),
+                            Q_ARG(quint64, generation), Q_ARG(QString, output));
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CPeerStatusPipeline::stage_finished_sl(int stage,
+                                       QString key,
+                                       quint64 generation,
+                                       QString output) {
+  static const QString undefined_string = "undefined";
+  const QString& shown = output.isEmpty() ? undefined_string : output;
+  QString name, dir, port;
+  int next = -1;
+  bool finished = false, became_idle = false;
+  {
+    QMutexLocker locker(&m_mutex);
+    auto i = m_peers.find(key);
+    if (i == m_peers.end() || !i->second.state.in_flight ||
+        i->second.generation != generation)
+      return;
+    entry_t& et = i->second;
+    name = et.state.name;
+    dir = et.state.dir;
+
+    switch (stage) {
+      case ST_STATUS:
+        et.state.status = shown;
+        if (output == "running") next = ST_PORT;
+        else finished = true;
+        break;
+      case ST_PORT:
+        et.state.port = shown;
+        if (!output.isEmpty() && output != undefined_string) {
+          next = ST_FINGER;
+          et.pending = 2;
+          port = output;
+        } else {
+          finished = true;
+        }
+        break;
+      case ST_FINGER:
+        et.state.finger = shown;
+        finished = --et.pending <= 0;
+        break;
+      case ST_UPDATE:
+        et.state.update = shown;
+        finished = --et.pending <= 0;
+        break;
+      default:
+        return;
+    }
+
+    if (next != -1) et.state.stage = next;
+    if (finished) {
+      finish_peer_locked(et);
+      became_idle = m_in_flight == 0;
+    }
+  }
+
+  emit stage_finished(stage, name, dir, shown);
+  if (next == ST_PORT)
+    run_probe(ST_PORT, key, generation);
+  else if (next == ST_FINGER)
+    run_rest(key, generation, name, dir, port);
+
+  if (finished) emit peer_finished(name, dir);
+  if (became_idle) emit idle();
+}
+////////////////////////////////////////////////////////////////////////////
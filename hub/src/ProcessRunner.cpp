@@ -0,0 +1,505 @@
+#include <algorithm>
+#include <memory>
+#include <QCoreApplication>
+#include <QDebug>
+#include <QMutexLocker>
+#include <QThread>
+#include <QWaitCondition>
+
+#include "ProcessRunner.h"
+
+const int CProcessRunner::DEFAULT_MAX_RUNNING;
+const int CProcessRunner::DEFAULT_MAX_LONG_RUNNING;
+const int CProcessRunner::KILL_GRACE_MS;
+const int CProcessRunner::MAX_EXECUTE_WAIT_MS;
+
+CProcessRunner::CProcessRunner(QObject *parent) :
+  QObject(parent),
+  m_max_running(DEFAULT_MAX_RUNNING),
+  m_max_long_running(DEFAULT_MAX_LONG_RUNNING),
+  m_last_id(0),
+  m_closed(false),
+  m_cancel_all_requested(false),
+  m_deadline_timer(this) {
+  m_clock.start();
+  m_deadline_timer.setSingleShot(true);
+  connect(&m_deadline_timer, &QTimer::timeout,
+          this, &CProcessRunner::deadline_timer_timeout_sl);
+  // always queued, so callbacks which start new processes don't reenter dispatch_sl
+  connect(this, &CProcessRunner::dispatch_requested,
+          this, &CProcessRunner::dispatch_sl, Qt::QueuedConnection);
+  if (QCoreApplication::instance() != nullptr) {
+    connect(QCoreApplication::instance(), &QCoreApplication::aboutToQuit,
+            this, &CProcessRunner::about_to_quit_sl);
+  }
+}
+
+CProcessRunner::~CProcessRunner() {
+  about_to_quit_sl();
+}
+////////////////////////////////////////////////////////////////////////////
+
+CProcessRunner*
+CProcessRunner::Instance() {
+  static CProcessRunner* inst = []() {
+    QThread* th = new QThread;
+    th->setObjectName("process_runner");
+    CProcessRunner* runner = new CProcessRunner;
+    runner->moveToThread(th);
+    th->start();
+    if (QCoreApplication::instance() != nullptr) {
+      QObject::connect(QCoreApplication::instance(), &QCoreApplication::aboutToQuit,
+                       [runner, th]() {
+        // every process is finished and its waiter woken up before thread stops
+        QMetaObject::invokeMethod(runner, "about_to_quit_sl",
+                                  Qt::BlockingQueuedConnection);
+        th->quit();
+        th->wait();
+      });
+    }
+    return runner;
+  }();
+  return inst;
+}
+////////////////////////////////////////////////////////////////////////////
+
+CProcessRunner::process_id_t
+CProcessRunner::start(const QString &cmd,
+                      const QStringList &args,
+                      const process_options_t &opts,
+                      QObject *context,
+                      process_callbacks_t callbacks) {
+  process_t pt;
+  pt.cmd = cmd;
+  pt.args = args;
+  pt.opts = opts;
+  pt.has_context = context != nullptr;
+  pt.context = context;
+  pt.callbacks = callbacks;
+  pt.proc = nullptr;
+  pt.deadline = -1;
+  pt.started = false;
+  pt.timed_out = false;
+  pt.cancelled = false;
+  pt.handler_hash = -1;
+
+  {
+    QMutexLocker locker(&m_incoming_mutex);
+    pt.id = ++m_last_id;
+    if (!m_closed) {
+      m_incoming.push_back(pt);
+      locker.unlock();
+      emit dispatch_requested();
+      return pt.id;
+    }
+  }
+
+  // application is quitting, nobody will start this process.
+  system_call_res_t res = {SCWE_CANCELLED, QStringList(), 0};
+  if (pt.callbacks.finished) pt.callbacks.finished(res);
+  return pt.id;
+}
+////////////////////////////////////////////////////////////////////////////
+
+system_call_res_t
+CProcessRunner::execute(const QString &cmd,
+                        const QStringList &args,
+                        const process_options_t &opts) {
+  if (QThread::currentThread() == thread()) {
+    // runner's thread would wait for itself, callers there use start()
+    qCritical() << "Blocking execution of" << cmd << "in thread of process runner";
+    system_call_res_t res = {SCWE_CANCELLED, QStringList(), 0};
+    return res;
+  }
+
+  struct sync_state_t {
+    QMutex mutex;
+    QWaitCondition cond;
+    bool done;
+    system_call_res_t res;
+    sync_state_t() : done(false) {}
+  };
+  std::shared_ptr<sync_state_t> st(new sync_state_t);
+
+  process_callbacks_t callbacks;
+  callbacks.finished = [st](const system_call_res_t& r) {
+    QMutexLocker locker(&st->mutex);
+    st->res = r;
+    st->done = true;
+    st->cond.wakeAll();
+  };
+  process_id_t id = start(cmd, args, opts, nullptr, callbacks);
+
+  // deadlines are handled by runner, waiting is bounded anyway in case
+  // process has no deadline or runner's thread is blocked.
+  unsigned long wait_ms = opts.timeout_msec ?
+                            2 * opts.timeout_msec + 2 * KILL_GRACE_MS :
+                            (unsigned long)MAX_EXECUTE_WAIT_MS;
+  QMutexLocker locker(&st->mutex);
+  while (!st->done) {
+    if (!st->cond.wait(&st->mutex, wait_ms)) break;
+  }
+  if (st->done) return st->res;
+
+  locker.unlock();
+  qCritical() << "Process" << cmd << args << "isn't finished in time, cancelling it";
+  cancel(id);
+  locker.relock();
+  while (!st->done) {
+    if (!st->cond.wait(&st->mutex, 2 * KILL_GRACE_MS)) break;
+  }
+  if (st->done) return st->res;
+  system_call_res_t res = {SCWE_TIMEOUT, QStringList(), 0};
+  return res;
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CProcessRunner::cancel(process_id_t id) {
+  {
+    QMutexLocker locker(&m_incoming_mutex);
+    m_cancelled_incoming.push_back(id);
+  }
+  emit dispatch_requested();
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CProcessRunner::cancel_all() {
+  {
+    QMutexLocker locker(&m_incoming_mutex);
+    m_cancel_all_requested = true;
+  }
+  emit dispatch_requested();
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CProcessRunner::set_max_running(int val) {
+  m_max_running = val < 1 ? 1 : val;
+  emit dispatch_requested();
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CProcessRunner::set_max_long_running(int val) {
+  m_max_long_running = val < 1 ? 1 : val;
+  emit dispatch_requested();
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CProcessRunner::dispatch_sl() {
+  std::deque<process_t> incoming;
+  std::deque<process_id_t> cancelled;
+  bool cancel_all_requested;
+  {
+    QMutexLocker locker(&m_incoming_mutex);
+    incoming.swap(m_incoming);
+    cancelled.swap(m_cancelled_incoming);
+    cancel_all_requested = m_cancel_all_requested;
+    m_cancel_all_requested = false;
+  }
+
+  for (auto i = incoming.begin(); i != incoming.end(); ++i)
+    m_pending.push_back(*i);
+
+  if (cancel_all_requested) {
+    for (auto i = m_pending.begin(); i != m_pending.end(); ++i)
+      cancelled.push_back(i->id);
+    for (auto i = m_running.begin(); i != m_running.end(); ++i)
+      cancelled.push_back(i->first);
+  }
+
+  for (auto id : cancelled) {
+    auto pi = std::find_if(m_pending.begin(), m_pending.end(),
+                           [id](const process_t& pt) { return pt.id == id; });
+    if (pi != m_pending.end()) {
+      process_t pt = *pi;
+      m_pending.erase(pi);
+      fail_pending(pt);
+      continue;
+    }
+
+    auto ri = m_running.find(id);
+    if (ri == m_running.end() || ri->second.cancelled) continue;
+    ri->second.cancelled = true;
+    // proc_finished_sl does the rest
+    ri->second.proc->kill();
+  }
+
+  // short and long running processes are started in their own lanes
+  int running[2] = {0, 0};
+  const int limit[2] = {m_max_running, m_max_long_running};
+  for (auto i = m_running.begin(); i != m_running.end(); ++i)
+    ++running[i->second.opts.long_running ? 1 : 0];
+
+  for (auto i = m_pending.begin(); i != m_pending.end();) {
+    if (running[0] >= limit[0] && running[1] >= limit[1]) break;
+    if (!alive(*i)) {
+      i = m_pending.erase(i);
+      continue;
+    }
+    int lane = i->opts.long_running ? 1 : 0;
+    if (running[lane] >= limit[lane]) {
+      ++i;
+      continue;
+    }
+    process_t pt = *i;
+    i = m_pending.erase(i);
+    ++running[lane];
+    start_process(pt);
+  }
+
+  schedule_deadline_timer();
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CProcessRunner::start_process(process_t &pt) {
+  QProcess* proc = new QProcess(this);
+  if (!pt.opts.working_dir.isEmpty())
+    proc->setWorkingDirectory(pt.opts.working_dir);
+  if (!pt.opts.env.isEmpty())
+    proc->setProcessEnvironment(pt.opts.env);
+
+  pt.proc = proc;
+  pt.deadline = pt.opts.timeout_msec ?
+                  m_clock.elapsed() + (qint64)pt.opts.timeout_msec : -1;
+  pt.handler_hash = CProcessHandler::Instance()->start_proc(*proc);
+  m_proc_to_id[proc] = pt.id;
+  m_running[pt.id] = pt;
+
+  connect(proc, &QProcess::started,
+          this, &CProcessRunner::proc_started_sl);
+  connect(proc, &QProcess::readyReadStandardOutput,
+          this, &CProcessRunner::proc_ready_read_stdout_sl);
+  connect(proc, &QProcess::readyReadStandardError,
+          this, &CProcessRunner::proc_ready_read_stderr_sl);
+  connect(proc, static_cast<void (QProcess::*)(int, QProcess::ExitStatus)>(&QProcess::finished),
+          this, &CProcessRunner::proc_finished_sl);
+  connect(proc, &QProcess::errorOccurred,
+          this, &CProcessRunner::proc_error_sl);
+
+  if (pt.opts.log)
+    qDebug() << "Starting process" << pt.cmd << pt.args;
+  proc->start(pt.cmd, pt.args);
+}
+////////////////////////////////////////////////////////////////////////////
+
+CProcessRunner::process_t*
+CProcessRunner::running_by_sender() {
+  QProcess* proc = qobject_cast<QProcess*>(sender());
+  if (proc == nullptr) return nullptr;
+  auto pi = m_proc_to_id.find(proc);
+  if (pi == m_proc_to_id.end()) return nullptr;
+  auto ri = m_running.find(pi->second);
+  return ri == m_running.end() ? nullptr : &ri->second;
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CProcessRunner::proc_started_sl() {
+  process_t* pt = running_by_sender();
+  if (pt == nullptr) return;
+  pt->started = true;
+  // timeout is applied to start and to run separately
+  if (pt->deadline != -1 && !pt->timed_out) {
+    pt->deadline = m_clock.elapsed() + (qint64)pt->opts.timeout_msec;
+    schedule_deadline_timer();
+  }
+  if (!alive(*pt)) return;
+  if (pt->callbacks.started) pt->callbacks.started();
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CProcessRunner::proc_ready_read_stdout_sl() {
+  process_t* pt = running_by_sender();
+  if (pt != nullptr) read_channel(*pt, false, false);
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CProcessRunner::proc_ready_read_stderr_sl() {
+  process_t* pt = running_by_sender();
+  if (pt != nullptr) read_channel(*pt, true, false);
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CProcessRunner::read_channel(process_t &pt,
+                             bool is_stderr,
+                             bool flush) {
+  QByteArray& tail = is_stderr ? pt.err_tail : pt.out_tail;
+  tail.append(is_stderr ? pt.proc->readAllStandardError() :
+                          pt.proc->readAllStandardOutput());
+
+  QStringList lines;
+  int start = 0;
+  for (int nl = tail.indexOf('\n'); nl != -1; nl = tail.indexOf('\n', start)) {
+    // lines are split on '\n' only, so utf-8 sequences aren't broken
+    lines << QString::fromUtf8(tail.constData() + start, nl - start);
+    start = nl + 1;
+  }
+  tail.remove(0, start);
+  if (flush && !tail.isEmpty()) {
+    lines << QString::fromUtf8(tail);
+    tail.clear();
+  }
+
+  for (auto i = lines.begin(); i != lines.end(); ++i) {
+    // the same as split with QString::SkipEmptyParts
+    if (i->isEmpty()) continue;
+    if (!is_stderr && pt.opts.collect_output) pt.out << *i;
+    if (pt.callbacks.line && alive(pt)) pt.callbacks.line(*i, is_stderr);
+  }
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CProcessRunner::proc_finished_sl(int exit_code,
+                                 QProcess::ExitStatus exit_status) {
+  process_t* ppt = running_by_sender();
+  if (ppt == nullptr) return;
+  read_channel(*ppt, false, true);
+  read_channel(*ppt, true, true);
+
+  process_t pt = *ppt;
+  m_running.erase(pt.id);
+  m_proc_to_id.erase(pt.proc);
+  CProcessHandler::Instance()->end_proc(pt.handler_hash);
+  pt.proc->deleteLater();
+
+  system_call_res_t res = {SCWE_SUCCESS, pt.out, exit_code};
+  if (pt.timed_out) {
+    res.res = SCWE_TIMEOUT;
+  } else if (pt.cancelled) {
+    res.res = SCWE_CANCELLED;
+  } else if (exit_status != QProcess::NormalExit) {
+    res.res = SCWE_PROCESS_CRASHED;
+  }
+  if (res.res != SCWE_SUCCESS && pt.opts.log) {
+    qCritical() << "Process" << pt.cmd << pt.args << "finished with"
+                << CSystemCallWrapper::scwe_error_to_str(res.res);
+  }
+
+  finish_process(pt, res);
+  // some slot is free now
+  dispatch_sl();
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CProcessRunner::proc_error_sl(QProcess::ProcessError error) {
+  // other errors are followed by finished signal
+  if (error != QProcess::FailedToStart) return;
+  process_t* ppt = running_by_sender();
+  if (ppt == nullptr) return;
+
+  process_t pt = *ppt;
+  m_running.erase(pt.id);
+  m_proc_to_id.erase(pt.proc);
+  CProcessHandler::Instance()->end_proc(pt.handler_hash);
+  if (pt.opts.log) {
+    qCritical() << "Failed to start process" << pt.cmd
+                << pt.proc->errorString();
+  }
+  pt.proc->deleteLater();
+
+  system_call_res_t res = {SCWE_CREATE_PROCESS, QStringList(), 0};
+  finish_process(pt, res);
+  // start_process() may be still on the stack, so don't dispatch right here
+  emit dispatch_requested();
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CProcessRunner::finish_process(process_t &pt,
+                               system_call_res_t &res) {
+  if (!alive(pt)) return;
+  if (pt.callbacks.finished) pt.callbacks.finished(res);
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CProcessRunner::fail_pending(process_t &pt) {
+  system_call_res_t res = {SCWE_CANCELLED, QStringList(), 0};
+  finish_process(pt, res);
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CProcessRunner::stop_process(QProcess *proc) {
+  proc->terminate();
+  // terminate() is only a request, console applications on windows ignore it
+  QTimer::singleShot(KILL_GRACE_MS, proc, [proc]() { proc->kill(); });
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CProcessRunner::schedule_deadline_timer() {
+  qint64 nearest = -1;
+  for (auto i = m_running.begin(); i != m_running.end(); ++i) {
+    if (i->second.deadline == -1 || i->second.timed_out) continue;
+    if (nearest == -1 || i->second.deadline < nearest) nearest = i->second.deadline;
+  }
+
+  if (nearest == -1) {
+    m_deadline_timer.stop();
+    return;
+  }
+  qint64 left = nearest - m_clock.elapsed();
+  m_deadline_timer.start(left > 0 ? (int)left : 0);
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CProcessRunner::deadline_timer_timeout_sl() {
+  qint64 now = m_clock.elapsed();
+  for (auto i = m_running.begin(); i != m_running.end(); ++i) {
+    process_t& pt = i->second;
+    if (pt.deadline == -1 || pt.deadline > now || pt.timed_out) continue;
+    pt.timed_out = true;
+    if (pt.opts.log)
+      qWarning() << "Process" << pt.cmd << pt.args << "is out of time, stopping it";
+    stop_process(pt.proc);
+  }
+  schedule_deadline_timer();
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CProcessRunner::finish_running_cancelled() {
+  // finished signals won't be delivered anymore, so processes are killed
+  // and finished right here
+  std::map<process_id_t, process_t> running;
+  running.swap(m_running);
+  m_proc_to_id.clear();
+  for (auto i = running.begin(); i != running.end(); ++i) {
+    QProcess* proc = i->second.proc;
+    disconnect(proc, nullptr, this, nullptr);
+    proc->kill();
+    proc->waitForFinished(KILL_GRACE_MS);
+    CProcessHandler::Instance()->end_proc(i->second.handler_hash);
+    system_call_res_t res = {SCWE_CANCELLED, i->second.out, proc->exitCode()};
+    finish_process(i->second, res);
+    delete proc;
+  }
+  m_deadline_timer.stop();
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CProcessRunner::about_to_quit_sl() {
+  {
+    QMutexLocker locker(&m_incoming_mutex);
+    if (m_closed) return;
+    m_closed = true;
+    m_cancel_all_requested = true;
+  }
+  // pending processes are finished by dispatch, running ones here
+  dispatch_sl();
+  finish_running_cancelled();
+}
+////////////////////////////////////////////////////////////////////////////
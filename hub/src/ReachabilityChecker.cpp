@@ -0,0 +1,213 @@
+#include <algorithm>
+#include <cmath>
+#include <QCoreApplication>
+#include <QDebug>
+#include <QtConcurrent/QtConcurrentRun>
+
+#include "ReachabilityChecker.h"
+#include "SystemCallWrapper.h"
+
+const int CReachabilityChecker::DEFAULT_MAX_PARALLEL;
+const int CReachabilityChecker::DEFAULT_MIN_TIMEOUT_MS;
+const int CReachabilityChecker::DEFAULT_INITIAL_TIMEOUT_MS;
+const int CReachabilityChecker::DEFAULT_MAX_TIMEOUT_MS;
+const int CReachabilityChecker::DEFAULT_CONFIRMED_TTL_MS;
+const int CReachabilityChecker::DEFAULT_FAILED_TTL_MS;
+
+CReachabilityChecker::CReachabilityChecker(probe_t probe,
+                                           int max_parallel,
+                                           QObject *parent) :
+  QObject(parent),
+  m_probe(probe),
+  m_min_timeout_ms(DEFAULT_MIN_TIMEOUT_MS),
+  m_initial_timeout_ms(DEFAULT_INITIAL_TIMEOUT_MS),
+  m_max_timeout_ms(DEFAULT_MAX_TIMEOUT_MS),
+  m_confirmed_ttl_ms(DEFAULT_CONFIRMED_TTL_MS),
+  m_failed_ttl_ms(DEFAULT_FAILED_TTL_MS),
+  m_probes_count(0) {
+  set_max_parallel(max_parallel);
+}
+
+CReachabilityChecker::~CReachabilityChecker() {
+  m_pool.waitForDone();
+}
+////////////////////////////////////////////////////////////////////////////
+
+CReachabilityChecker*
+CReachabilityChecker::Instance() {
+  static CReachabilityChecker* inst = []() {
+    // target is key of container in p2p state: swarm hash and ip of resource host
+    CReachabilityChecker* checker = new CReachabilityChecker(
+          [](const QString& target, int timeout_ms) {
+      int sep = target.indexOf('\n');
+      return CSystemCallWrapper::check_container_state(
+            target.left(sep), target.mid(sep + 1), (unsigned long)timeout_ms) == SCWE_SUCCESS;
+    });
+    // used by P2PConnector, callbacks are called in main thread
+    if (QCoreApplication::instance() != nullptr)
+      checker->moveToThread(QCoreApplication::instance()->thread());
+    return checker;
+  }();
+  return inst;
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CReachabilityChecker::check(const QString &host,
+                            const QString &target,
+                            QObject *context,
+                            callback_t callback) {
+  waiter_t waiter;
+  waiter.context = context;
+  waiter.has_context = context != nullptr;
+  waiter.callback = callback;
+
+  auto cached = m_results.find(target);
+  if (cached != m_results.end()) {
+    int ttl = cached->reachable ? m_confirmed_ttl_ms : m_failed_ttl_ms;
+    if (cached->age.elapsed() < ttl) {
+      call(waiter, cached->reachable);
+      return;
+    }
+    m_results.erase(cached);
+  }
+
+  auto waiting = m_waiting.find(target);
+  if (waiting != m_waiting.end()) {
+    waiting->push_back(waiter);
+    return;
+  }
+  m_waiting[target].push_back(waiter);
+
+  ++m_probes_count;
+  int timeout_ms = timeout_for(host);
+  probe_t probe = m_probe;
+  QtConcurrent::run(&m_pool, [this, probe, host, target, timeout_ms]() {
+    QElapsedTimer timer;
+    timer.start();
+    bool reachable = probe ? probe(target, timeout_ms) : false;
+    QMetaObject::invokeMethod(this, "probe_finished_sl", Qt::QueuedConnection,
+                              Q_ARG(QString, host), Q_ARG(QString, target),
+                              Q_ARG(bool, reachable), Q_ARG(qint64, timer.elapsed()),
+                              Q_ARG(int, timeout_ms));
+  });
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CReachabilityChecker::set_max_parallel(int max_parallel) {
+  m_pool.setMaxThreadCount(max_parallel > 0 ? max_parallel : 1);
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CReachabilityChecker::set_timeout_bounds(int min_ms,
+                                         int initial_ms,
+                                         int max_ms) {
+  m_min_timeout_ms = min_ms;
+  m_max_timeout_ms = std::max(min_ms, max_ms);
+  m_initial_timeout_ms = std::min(std::max(initial_ms, m_min_timeout_ms), m_max_timeout_ms);
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CReachabilityChecker::set_ttl(int confirmed_ms,
+                              int failed_ms) {
+  m_confirmed_ttl_ms = confirmed_ms;
+  m_failed_ttl_ms = failed_ms;
+}
+////////////////////////////////////////////////////////////////////////////
+
+int
+CReachabilityChecker::timeout_for(const QString &host) const {
+  auto rt = m_run_time.find(host);
+  if (rt == m_run_time.end()) return m_initial_timeout_ms;
+  if (rt->backoff_ms > 0) return rt->backoff_ms;
+  if (!rt->has_samples) return m_initial_timeout_ms;
+  int timeout = (int)std::ceil(rt->smoothed + 4 * rt->variation);
+  return std::min(std::max(timeout, m_min_timeout_ms), m_max_timeout_ms);
+}
+////////////////////////////////////////////////////////////////////////////
+
+bool
+CReachabilityChecker::is_cached(const QString &target) const {
+  auto cached = m_results.find(target);
+  if (cached == m_results.end()) return false;
+  int ttl = cached->reachable ? m_confirmed_ttl_ms : m_failed_ttl_ms;
+  return cached->age.elapsed() < ttl;
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CReachabilityChecker::invalidate(const QString &target) {
+  m_results.remove(target);
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CReachabilityChecker::clear() {
+  m_results.clear();
+  m_run_time.clear();
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CReachabilityChecker::call(const waiter_t &waiter,
+                           bool reachable) {
+  if (waiter.callback && (!waiter.has_context || waiter.context))
+    waiter.callback(reachable);
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CReachabilityChecker::probe_finished_sl(QString host,
+                                        QString target,
+                                        bool reachable,
+                                        qint64 elapsed_ms,
+                                        int timeout_ms) {
+  // only successful probes are samples, time of failed ones is ambiguous
+  if (reachable) {
+    double sample = (double)elapsed_ms;
+    auto rt = m_run_time.find(host);
+    if (rt == m_run_time.end() || !rt->has_samples) {
+      run_time_t nrt;
+      nrt.has_samples = true;
+      nrt.smoothed = sample;
+      nrt.variation = sample / 2;
+      nrt.backoff_ms = 0;
+      m_run_time.insert(host, nrt);
+    } else {
+      rt->variation = 0.75 * rt->variation + 0.25 * std::fabs(rt->smoothed - sample);
+      rt->smoothed = 0.875 * rt->smoothed + 0.125 * sample;
+      rt->backoff_ms = 0;
+    }
+  } else if (elapsed_ms >= timeout_ms) {
+    auto rt = m_run_time.find(host);
+    if (rt == m_run_time.end()) {
+      run_time_t nrt;
+      nrt.has_samples = false;
+      nrt.smoothed = nrt.variation = 0;
+      nrt.backoff_ms = 0;
+      rt = m_run_time.insert(host, nrt);
+    }
+    rt->backoff_ms = std::min(std::max(timeout_ms, m_min_timeout_ms) * 2, m_max_timeout_ms);
+    qInfo() << "Reachability probe timed out:" << host << "timeout:" << timeout_ms
+            << "next timeout:" << rt->backoff_ms;
+  }
+
+  result_t res;
+  res.reachable = reachable;
+  res.age.start();
+  m_results[target] = res;
+
+  std::vector<waiter_t> waiters;
+  auto waiting = m_waiting.find(target);
+  if (waiting != m_waiting.end()) {
+    waiters.swap(waiting.value());
+    m_waiting.erase(waiting);
+  }
+  for (auto i = waiters.begin(); i != waiters.end(); ++i)
+    call(*i, reachable);
+  emit checked(target, reachable);
+}
+////////////////////////////////////////////////////////////////////////////
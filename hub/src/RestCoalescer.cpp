@@ -0,0 +1,146 @@
+#include <QMutexLocker>
+
+#include "RestCoalescer.h"
+
+const uint CRestCoalescer::DEFAULT_FRESHNESS_MS;
+
+CRestCoalescer::CRestCoalescer(CRestPipeline *pipeline) :
+  m_pipeline(pipeline),
+  m_freshness_ms(DEFAULT_FRESHNESS_MS) {
+  m_clock.start();
+}
+////////////////////////////////////////////////////////////////////////////
+
+CRestPipeline::request_id_t
+CRestCoalescer::enqueue_get(const QString &key,
+                            const QNetworkRequest &req,
+                            uint timeout_ms,
+                            QObject *context,
+                            rest_callback_t callback,
+                            rest_body_parser_t parser) {
+  CRestPipeline* pipeline = m_pipeline;
+  return enqueue(key, context,
+                 [pipeline, req, timeout_ms, parser](rest_callback_t upstream_callback) {
+    return pipeline->enqueue(req, RO_GET, QByteArray(), timeout_ms, nullptr,
+                             upstream_callback, parser);
+  }, callback);
+}
+////////////////////////////////////////////////////////////////////////////
+
+CRestPipeline::request_id_t
+CRestCoalescer::enqueue(const QString &key,
+                        QObject *context,
+                        start_fn_t start,
+                        rest_callback_t callback) {
+  waiter_t waiter;
+  waiter.has_context = context != nullptr;
+  waiter.context = context;
+  waiter.callback = callback;
+
+  QMutexLocker locker(&m_mutex);
+  remove_expired();
+
+  auto fi = m_fresh.find(key);
+  if (fi != m_fresh.end()) {
+    rest_response_t resp = fi->second.resp;
+    locker.unlock();
+    return m_pipeline->deliver(resp, context, callback);
+  }
+
+  auto gi = m_groups.find(key);
+  if (gi != m_groups.end()) {
+    gi->second.waiters.push_back(waiter);
+    return gi->second.id;
+  }
+
+  // group is registered before enqueue, because response may come
+  // to pipeline's thread before enqueue returns.
+  group_t& group = m_groups[key];
+  group.id = 0;
+  group.waiters.push_back(waiter);
+  locker.unlock();
+
+  CRestPipeline::request_id_t id = start([this, key](const rest_response_t& resp) {
+    complete(key, resp);
+  });
+
+  locker.relock();
+  gi = m_groups.find(key);
+  if (gi != m_groups.end() && gi->second.id == 0)
+    gi->second.id = id;
+  return id;
+}
+////////////////////////////////////////////////////////////////////////////
+
+rest_response_t
+CRestCoalescer::execute_get(const QString &key,
+                            const QNetworkRequest &req,
+                            uint timeout_ms,
+                            rest_body_parser_t parser) {
+  return m_pipeline->wait([this, &key, &req, timeout_ms, parser](rest_callback_t callback) {
+    return enqueue_get(key, req, timeout_ms, nullptr, callback, parser);
+  }, timeout_ms);
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CRestCoalescer::set_freshness_ms(uint ms) {
+  QMutexLocker locker(&m_mutex);
+  m_freshness_ms = ms;
+  if (ms == 0) m_fresh.clear();
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CRestCoalescer::invalidate(const QString &key) {
+  QMutexLocker locker(&m_mutex);
+  m_fresh.erase(key);
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CRestCoalescer::invalidate_all() {
+  QMutexLocker locker(&m_mutex);
+  m_fresh.clear();
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CRestCoalescer::complete(const QString &key,
+                         const rest_response_t &resp) {
+  std::vector<waiter_t> waiters;
+  {
+    QMutexLocker locker(&m_mutex);
+    auto gi = m_groups.find(key);
+    if (gi == m_groups.end()) return;
+    waiters.swap(gi->second.waiters);
+    m_groups.erase(gi);
+
+    bool reusable = !resp.timed_out && !resp.cancelled &&
+                    resp.network_error == QNetworkReply::NoError &&
+                    (resp.http_code == 200 || resp.http_code == 304);
+    if (reusable && m_freshness_ms) {
+      fresh_t& fr = m_fresh[key];
+      fr.resp = resp;
+      fr.received = m_clock.elapsed();
+    }
+  }
+
+  for (auto i = waiters.begin(); i != waiters.end(); ++i) {
+    if (i->has_context && i->context.isNull()) continue;
+    if (i->callback) i->callback(resp);
+  }
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CRestCoalescer::remove_expired() {
+  qint64 now = m_clock.elapsed();
+  for (auto i = m_fresh.begin(); i != m_fresh.end(); ) {
+    if (now - i->second.received > (qint64)m_freshness_ms)
+      i = m_fresh.erase(i);
+    else
+      ++i;
+  }
+}
+////////////////////////////////////////////////////////////////////////////
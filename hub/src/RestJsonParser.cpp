@@ -0,0 +1,140 @@
+#include "RestJsonParser.h"
+
+CRestJsonArrayParser::CRestJsonArrayParser(const QString &array_key) :
+  m_array_key(array_key),
+  m_root_is_object(false),
+  m_in_array(false),
+  m_failed(false) {
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CRestJsonArrayParser::feed(const QByteArray &chunk) {
+  if (m_failed || chunk.isEmpty()) return;
+  m_reader.add_data(chunk);
+  process();
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CRestJsonArrayParser::finish() {
+  if (m_failed) return;
+  m_reader.finish();
+  process();
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CRestJsonArrayParser::process() {
+  while (true) {
+    CJsonStreamReader::token_t token = m_reader.next();
+    QJsonValue val;
+    switch (token) {
+      case CJsonStreamReader::JT_NEED_MORE:
+      case CJsonStreamReader::JT_END:
+        return;
+      case CJsonStreamReader::JT_ERROR:
+        m_failed = true;
+        m_error = m_reader.error_string();
+        return;
+      case CJsonStreamReader::JT_STRING:
+        val = QJsonValue(m_reader.string_value());
+        break;
+      case CJsonStreamReader::JT_NUMBER:
+        val = QJsonValue(m_reader.number_value());
+        break;
+      case CJsonStreamReader::JT_BOOL:
+        val = QJsonValue(m_reader.bool_value());
+        break;
+      default:
+        break; // JT_NULL and structure tokens
+    }
+
+    if (m_frames.empty() && !m_in_array)
+      handle_outside(token, val);
+    else
+      handle_element(token, val);
+  }
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CRestJsonArrayParser::handle_outside(CJsonStreamReader::token_t token,
+                                     const QJsonValue &val) {
+  // depth is already changed by begin/end tokens
+  int depth = m_reader.depth();
+  switch (token) {
+    case CJsonStreamReader::JT_BEGIN_OBJECT:
+      if (depth == 1) m_root_is_object = true;
+      return;
+    case CJsonStreamReader::JT_BEGIN_ARRAY:
+      if (m_array_key.isEmpty())
+        m_in_array = depth == 1;
+      else
+        m_in_array = depth == 2 && m_root_is_object && m_root_key == m_array_key;
+      return;
+    case CJsonStreamReader::JT_KEY:
+      if (depth == 1) m_root_key = m_reader.string_value();
+      return;
+    case CJsonStreamReader::JT_STRING:
+    case CJsonStreamReader::JT_NUMBER:
+    case CJsonStreamReader::JT_BOOL:
+    case CJsonStreamReader::JT_NULL:
+      if (depth == 1 && m_root_is_object) m_root.insert(m_root_key, val);
+      return;
+    default:
+      return;
+  }
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CRestJsonArrayParser::handle_element(CJsonStreamReader::token_t token,
+                                     const QJsonValue &val) {
+  switch (token) {
+    case CJsonStreamReader::JT_BEGIN_OBJECT:
+    case CJsonStreamReader::JT_BEGIN_ARRAY: {
+      frame_t fr;
+      fr.is_object = token == CJsonStreamReader::JT_BEGIN_OBJECT;
+      m_frames.push_back(fr);
+      return;
+    }
+
+    case CJsonStreamReader::JT_END_OBJECT:
+    case CJsonStreamReader::JT_END_ARRAY: {
+      if (m_frames.empty()) {
+        // end of target array itself
+        m_in_array = false;
+        return;
+      }
+      frame_t fr = m_frames.back();
+      m_frames.pop_back();
+      if (!m_frames.empty()) {
+        add_to_frame(fr.is_object ? QJsonValue(fr.obj) : QJsonValue(fr.arr));
+        return;
+      }
+      if (fr.is_object) on_element(fr.obj);
+      return;
+    }
+
+    case CJsonStreamReader::JT_KEY:
+      if (!m_frames.empty()) m_frames.back().key = m_reader.string_value();
+      return;
+
+    default:
+      // scalars which are elements of target array are skipped
+      if (!m_frames.empty()) add_to_frame(val);
+      return;
+  }
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CRestJsonArrayParser::add_to_frame(const QJsonValue &val) {
+  frame_t& fr = m_frames.back();
+  if (fr.is_object)
+    fr.obj.insert(fr.key, val);
+  else
+    fr.arr.append(val);
+}
+////////////////////////////////////////////////////////////////////////////
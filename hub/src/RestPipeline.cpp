@@ -0,0 +1,449 @@
+#include <algorithm>
+#include <memory>
+#include <QCoreApplication>
+#include <QMutexLocker>
+#include <QThread>
+#include <QWaitCondition>
+
+#include "RestPipeline.h"
+
+const uint CRestPipeline::DEFAULT_TIMEOUT_MS;
+const int CRestPipeline::DEFAULT_MAX_IN_FLIGHT;
+const QNetworkRequest::Attribute CRestPipeline::KEEP_BODY_ATTRIBUTE;
+
+CRestPipeline::CRestPipeline(QNetworkAccessManager *nam,
+                             QObject *parent) :
+  QObject(parent),
+  m_nam(nam),
+  m_max_in_flight(DEFAULT_MAX_IN_FLIGHT),
+  m_last_id(0),
+  m_closed(false),
+  m_cancel_all_requested(false) {
+  m_clock.start();
+  m_deadline_timer.setSingleShot(true);
+  connect(&m_deadline_timer, &QTimer::timeout,
+          this, &CRestPipeline::deadline_timer_timeout_sl);
+  // AutoConnection : direct call from own thread, queued from others.
+  connect(this, &CRestPipeline::dispatch_requested,
+          this, &CRestPipeline::dispatch_sl);
+  if (QCoreApplication::instance() != nullptr) {
+    connect(QCoreApplication::instance(), &QCoreApplication::aboutToQuit,
+            this, &CRestPipeline::about_to_quit_sl);
+  }
+}
+
+CRestPipeline::~CRestPipeline() {
+  about_to_quit_sl();
+}
+////////////////////////////////////////////////////////////////////////////
+
+CRestPipeline::request_id_t
+CRestPipeline::enqueue(const QNetworkRequest &req,
+                       rest_operation_t op,
+                       const QByteArray &data,
+                       uint timeout_ms,
+                       QObject *context,
+                       rest_callback_t callback,
+                       rest_body_parser_t parser) {
+  request_t rt;
+  rt.req = req;
+  rt.op = op;
+  rt.data = data;
+  rt.deadline = m_clock.elapsed() + (timeout_ms ? timeout_ms : DEFAULT_TIMEOUT_MS);
+  rt.has_context = context != nullptr;
+  rt.context = context;
+  rt.callback = callback;
+  rt.parser = parser;
+  rt.reply = nullptr;
+  rt.timed_out = false;
+  rt.cancelled = false;
+
+  {
+    QMutexLocker locker(&m_incoming_mutex);
+    rt.id = ++m_last_id;
+    if (!m_closed) {
+      m_incoming.push_back(rt);
+      locker.unlock();
+      emit dispatch_requested();
+      return rt.id;
+    }
+  }
+
+  // application is quitting, nobody will process this request.
+  rest_response_t resp;
+  resp.cancelled = true;
+  resp.network_error = QNetworkReply::OperationCanceledError;
+  if (rt.callback) rt.callback(resp);
+  return rt.id;
+}
+////////////////////////////////////////////////////////////////////////////
+
+rest_response_t
+CRestPipeline::execute(const QNetworkRequest &req,
+                       rest_operation_t op,
+                       const QByteArray &data,
+                       uint timeout_ms) {
+  return wait([this, &req, op, &data, timeout_ms](rest_callback_t callback) {
+    return enqueue(req, op, data, timeout_ms, nullptr, callback);
+  }, timeout_ms);
+}
+////////////////////////////////////////////////////////////////////////////
+
+rest_response_t
+CRestPipeline::wait(std::function<request_id_t(rest_callback_t)> start,
+                    uint timeout_ms) {
+  if (QThread::currentThread() == thread()) {
+    // pipeline's thread would wait for itself, callers there use enqueue()
+    qCritical("Blocking REST request in thread of pipeline, it isn't sent");
+    rest_response_t res;
+    res.cancelled = true;
+    res.network_error = QNetworkReply::OperationCanceledError;
+    res.error_string = "Blocking request in thread of pipeline";
+    return res;
+  }
+
+  struct sync_state_t {
+    QMutex mutex;
+    QWaitCondition cond;
+    bool done;
+    rest_response_t res;
+    sync_state_t() : done(false) {}
+  };
+  std::shared_ptr<sync_state_t> st(new sync_state_t);
+
+  request_id_t id = start([st](const rest_response_t& resp) {
+    QMutexLocker locker(&st->mutex);
+    st->res = resp;
+    st->done = true;
+    st->cond.wakeAll();
+  });
+
+  // deadline is handled by pipeline's thread. If that thread is blocked
+  // we don't want to wait forever, so give it some grace time and give up.
+  static const unsigned long GRACE_MS = 5000;
+  unsigned long wait_ms = (timeout_ms ? timeout_ms : DEFAULT_TIMEOUT_MS) + GRACE_MS;
+  QMutexLocker locker(&st->mutex);
+  while (!st->done) {
+    if (!st->cond.wait(&st->mutex, wait_ms)) break;
+  }
+
+  if (!st->done) {
+    locker.unlock();
+    cancel(id);
+    rest_response_t res;
+    res.timed_out = true;
+    return res;
+  }
+  return st->res;
+}
+////////////////////////////////////////////////////////////////////////////
+
+CRestPipeline::request_id_t
+CRestPipeline::deliver(const rest_response_t &resp,
+                       QObject *context,
+                       rest_callback_t callback) {
+  request_t rt;
+  rt.has_context = context != nullptr;
+  rt.context = context;
+  rt.callback = callback;
+  rt.reply = nullptr;
+  rt.timed_out = false;
+  rt.cancelled = false;
+
+  {
+    QMutexLocker locker(&m_incoming_mutex);
+    rt.id = ++m_last_id;
+    if (!m_closed) {
+      m_ready.push_back(std::make_pair(rt, resp));
+      locker.unlock();
+      emit dispatch_requested();
+      return rt.id;
+    }
+  }
+
+  if (rt.callback) rt.callback(resp);
+  return rt.id;
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CRestPipeline::cancel(request_id_t id) {
+  {
+    QMutexLocker locker(&m_incoming_mutex);
+    m_cancelled_incoming.push_back(id);
+  }
+  emit dispatch_requested();
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CRestPipeline::cancel_all() {
+  {
+    QMutexLocker locker(&m_incoming_mutex);
+    m_cancel_all_requested = true;
+  }
+  emit dispatch_requested();
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CRestPipeline::set_max_in_flight(int val) {
+  m_max_in_flight = val < 1 ? 1 : val;
+  emit dispatch_requested();
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CRestPipeline::dispatch_sl() {
+  std::deque<request_t> incoming;
+  std::deque<request_id_t> cancelled;
+  std::deque<std::pair<request_t, rest_response_t> > ready;
+  bool cancel_all_requested;
+  {
+    QMutexLocker locker(&m_incoming_mutex);
+    incoming.swap(m_incoming);
+    cancelled.swap(m_cancelled_incoming);
+    ready.swap(m_ready);
+    cancel_all_requested = m_cancel_all_requested;
+    m_cancel_all_requested = false;
+  }
+
+  for (auto i = ready.begin(); i != ready.end(); ++i)
+    finish_request(i->first, i->second);
+
+  for (auto i = incoming.begin(); i != incoming.end(); ++i)
+    m_pending.push_back(*i);
+
+  if (cancel_all_requested) {
+    for (auto i = m_pending.begin(); i != m_pending.end(); ++i)
+      cancelled.push_back(i->id);
+    for (auto i = m_in_flight.begin(); i != m_in_flight.end(); ++i)
+      cancelled.push_back(i->first);
+  }
+
+  for (auto id : cancelled) {
+    auto pi = std::find_if(m_pending.begin(), m_pending.end(),
+                           [id](const request_t& rt) { return rt.id == id; });
+    if (pi != m_pending.end()) {
+      request_t rt = *pi;
+      m_pending.erase(pi);
+      fail_pending(rt, false);
+      continue;
+    }
+
+    auto fi = m_in_flight.find(id);
+    if (fi == m_in_flight.end()) continue;
+    fi->second.cancelled = true;
+    // abort() emits finished synchronously, reply_finished_sl does the rest.
+    fi->second.reply->abort();
+  }
+
+  qint64 now = m_clock.elapsed();
+  while ((int)m_in_flight.size() < m_max_in_flight && !m_pending.empty()) {
+    request_t rt = m_pending.front();
+    m_pending.pop_front();
+    if (rt.has_context && rt.context.isNull())
+      continue;
+    if (rt.deadline <= now) {
+      fail_pending(rt, true);
+      continue;
+    }
+    start_request(rt);
+  }
+
+  schedule_deadline_timer();
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CRestPipeline::start_request(request_t &rt) {
+  if (m_nam->networkAccessible() != QNetworkAccessManager::Accessible) {
+    qCritical("Network isn't accessible : %d", (int)m_nam->networkAccessible());
+    m_nam->setNetworkAccessible(QNetworkAccessManager::Accessible);
+  }
+  rt.reply = create_reply(m_nam, rt.req, rt.op, rt.data);
+  rt.reply->ignoreSslErrors();
+  m_reply_to_id[rt.reply] = rt.id;
+  m_in_flight[rt.id] = rt;
+  connect(rt.reply, &QNetworkReply::finished,
+          this, &CRestPipeline::reply_finished_sl);
+  if (rt.parser) {
+    connect(rt.reply, &QNetworkReply::readyRead,
+            this, &CRestPipeline::reply_ready_read_sl);
+  }
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CRestPipeline::reply_ready_read_sl() {
+  QNetworkReply* reply = qobject_cast<QNetworkReply*>(sender());
+  if (reply == nullptr) return;
+
+  auto ri = m_reply_to_id.find(reply);
+  if (ri == m_reply_to_id.end()) return;
+  auto fi = m_in_flight.find(ri->second);
+  if (fi == m_in_flight.end() || !fi->second.parser) return;
+
+  QByteArray chunk = reply->readAll();
+  if (keep_body(fi->second, reply)) fi->second.body.append(chunk);
+  fi->second.parser->feed(chunk);
+}
+////////////////////////////////////////////////////////////////////////////
+
+bool
+CRestPipeline::keep_body(const request_t &rt,
+                         QNetworkReply *reply) {
+  // headers come before body, so answer is the same for every chunk
+  return rt.req.attribute(KEEP_BODY_ATTRIBUTE).toBool() &&
+      reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() == 200 &&
+      (reply->hasRawHeader("ETag") || reply->hasRawHeader("Last-Modified"));
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CRestPipeline::reply_finished_sl() {
+  QNetworkReply* reply = qobject_cast<QNetworkReply*>(sender());
+  if (reply == nullptr) return;
+
+  auto ri = m_reply_to_id.find(reply);
+  if (ri == m_reply_to_id.end()) return;
+  auto fi = m_in_flight.find(ri->second);
+  m_reply_to_id.erase(ri);
+  if (fi == m_in_flight.end()) return;
+
+  request_t rt = fi->second;
+  m_in_flight.erase(fi);
+
+  rest_response_t resp;
+  bool parsed = false;
+  int http_code = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt(&parsed);
+  resp.http_code = parsed ? http_code : -1;
+  resp.network_error = reply->error();
+  resp.timed_out = rt.timed_out;
+  resp.cancelled = rt.cancelled;
+  if (reply->error() != QNetworkReply::NoError)
+    resp.error_string = reply->errorString();
+  QByteArray rest = reply->readAll();
+  if (rt.parser) {
+    rt.parser->feed(rest);
+    rt.parser->finish();
+    resp.parser = rt.parser;
+    if (keep_body(rt, reply)) {
+      rt.body.append(rest);
+      resp.body.swap(rt.body);
+    } else {
+      resp.body_dropped = true;
+    }
+  } else {
+    resp.body = rest;
+  }
+  resp.headers = reply->rawHeaderPairs();
+  reply->deleteLater();
+
+  finish_request(rt, resp);
+  // some slot is free now
+  dispatch_sl();
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CRestPipeline::finish_request(request_t &rt,
+                              rest_response_t &resp) {
+  if (rt.has_context && rt.context.isNull()) return;
+  if (rt.callback) rt.callback(resp);
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CRestPipeline::fail_pending(request_t &rt,
+                            bool timed_out) {
+  rest_response_t resp;
+  resp.timed_out = timed_out;
+  resp.cancelled = !timed_out;
+  resp.network_error = QNetworkReply::OperationCanceledError;
+  finish_request(rt, resp);
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CRestPipeline::schedule_deadline_timer() {
+  qint64 nearest = -1;
+  for (auto i = m_pending.begin(); i != m_pending.end(); ++i) {
+    if (nearest == -1 || i->deadline < nearest) nearest = i->deadline;
+  }
+  for (auto i = m_in_flight.begin(); i != m_in_flight.end(); ++i) {
+    if (nearest == -1 || i->second.deadline < nearest) nearest = i->second.deadline;
+  }
+
+  if (nearest == -1) {
+    m_deadline_timer.stop();
+    return;
+  }
+  qint64 left = nearest - m_clock.elapsed();
+  m_deadline_timer.start(left > 0 ? (int)left : 0);
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CRestPipeline::deadline_timer_timeout_sl() {
+  qint64 now = m_clock.elapsed();
+
+  std::deque<request_t> expired_pending;
+  for (auto i = m_pending.begin(); i != m_pending.end(); ) {
+    if (i->deadline > now) {
+      ++i;
+      continue;
+    }
+    expired_pending.push_back(*i);
+    i = m_pending.erase(i);
+  }
+
+  std::vector<QPointer<QNetworkReply> > expired_replies;
+  for (auto i = m_in_flight.begin(); i != m_in_flight.end(); ++i) {
+    if (i->second.deadline > now) continue;
+    i->second.timed_out = true;
+    expired_replies.push_back(i->second.reply);
+  }
+
+  for (auto i = expired_pending.begin(); i != expired_pending.end(); ++i)
+    fail_pending(*i, true);
+  for (auto reply : expired_replies) {
+    if (reply.isNull() || m_reply_to_id.find(reply.data()) == m_reply_to_id.end())
+      continue;
+    reply->abort();
+  }
+
+  dispatch_sl();
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CRestPipeline::about_to_quit_sl() {
+  {
+    QMutexLocker locker(&m_incoming_mutex);
+    if (m_closed) return;
+    m_closed = true;
+    m_cancel_all_requested = true;
+  }
+  dispatch_sl();
+}
+////////////////////////////////////////////////////////////////////////////
+
+QNetworkReply*
+CRestPipeline::create_reply(QNetworkAccessManager *nam,
+                            QNetworkRequest &req,
+                            rest_operation_t op,
+                            const QByteArray &data) {
+  req.setAttribute(QNetworkRequest::CacheLoadControlAttribute,
+                   QNetworkRequest::AlwaysNetwork);
+  switch (op) {
+    case RO_POST:
+      return nam->post(req, data);
+    case RO_DELETE:
+      return nam->deleteResource(req);
+    case RO_GET:
+    default:
+      return nam->get(req);
+  }
+}
+////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,245 @@
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+#include "RestResponseCache.h"
+
+const int CRestResponseCache::MAX_MEMORY_ENTRIES;
+static const quint32 CACHE_FILE_VERSION = 1;
+
+CRestResponseCache::CRestResponseCache(const QString &dir) :
+  m_dir(dir),
+  m_use_counter(0) {
+  if (m_dir.isEmpty()) return;
+  if (!QDir().mkpath(m_dir)) {
+    qCritical() << "Can't create rest cache directory" << m_dir;
+    m_dir.clear();
+    return;
+  }
+  QFile::setPermissions(m_dir, QFileDevice::ReadOwner | QFileDevice::WriteOwner |
+                        QFileDevice::ExeOwner);
+}
+////////////////////////////////////////////////////////////////////////////
+
+QString
+CRestResponseCache::make_key(const QUrl &url,
+                             const QString &scope) {
+  return scope + "|" + url.toString(QUrl::FullyEncoded);
+}
+////////////////////////////////////////////////////////////////////////////
+
+QString
+CRestResponseCache::default_dir() {
+  QString base = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+  if (base.isEmpty()) return QString();
+  return base + QDir::separator() + "rest_cache";
+}
+////////////////////////////////////////////////////////////////////////////
+
+CRestResponseCache::snapshot_t
+CRestResponseCache::prepare_request(const QString &key,
+                                    QNetworkRequest &req) {
+  // streamed body is kept only for cache
+  req.setAttribute(CRestPipeline::KEEP_BODY_ATTRIBUTE, true);
+  QMutexLocker locker(&m_mutex);
+  entry_t& et = entry(key);
+  snapshot_t res;
+  // without body 304 is useless
+  if (!et.has_body) return res;
+  if (!et.etag.isEmpty())
+    req.setRawHeader("If-None-Match", et.etag);
+  if (!et.last_modified.isEmpty())
+    req.setRawHeader("If-Modified-Since", et.last_modified);
+  res.etag = et.etag;
+  res.last_modified = et.last_modified;
+  res.body = et.body;
+  res.has_body = true;
+  return res;
+}
+////////////////////////////////////////////////////////////////////////////
+
+bool
+CRestResponseCache::resolve_response(const QString &key,
+                                     const snapshot_t &snapshot,
+                                     rest_response_t &resp) {
+  if (resp.timed_out || resp.cancelled) return false;
+
+  QMutexLocker locker(&m_mutex);
+  entry_t& et = entry(key);
+
+  if (resp.http_code == 304) {
+    // request wasn't conditional, there is nothing to restore
+    if (!snapshot.has_body) return false;
+    resp.http_code = 200;
+    resp.body = snapshot.body;
+    resp.not_modified = true;
+    // parser has seen empty body of 304, consumer has to parse cached one
+    resp.parser.reset();
+    if (et.has_body)
+      return et.delivered && et.etag == snapshot.etag &&
+          et.last_modified == snapshot.last_modified;
+    // entry was evicted or cleared after prepare_request, body is still valid
+    et.etag = snapshot.etag;
+    et.last_modified = snapshot.last_modified;
+    et.body = snapshot.body;
+    et.has_body = true;
+    et.delivered = false;
+    store(key, et);
+    return false;
+  }
+
+  if (resp.http_code != 200 ||
+      resp.network_error != QNetworkReply::NoError) {
+    return false;
+  }
+
+  QByteArray etag, last_modified;
+  for (auto i = resp.headers.begin(); i != resp.headers.end(); ++i) {
+    if (qstricmp(i->first.constData(), "ETag") == 0)
+      etag = i->second;
+    else if (qstricmp(i->first.constData(), "Last-Modified") == 0)
+      last_modified = i->second;
+  }
+
+  if (resp.body_dropped) {
+    // parser took body which isn't cacheable, there is nothing to compare
+    et = entry_t();
+    et.last_used = ++m_use_counter;
+    store(key, et);
+    return false;
+  }
+
+  resp.not_modified = et.has_body && et.body == resp.body;
+  bool validators_changed = et.etag != etag || et.last_modified != last_modified;
+  if (resp.not_modified && !validators_changed) return et.delivered;
+
+  if (!resp.not_modified) {
+    et.body = resp.body;
+    et.has_body = true;
+    et.delivered = false;
+  }
+  et.etag = etag;
+  et.last_modified = last_modified;
+  store(key, et);
+  return et.delivered;
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CRestResponseCache::mark_delivered(const QString &key) {
+  QMutexLocker locker(&m_mutex);
+  auto i = m_entries.find(key);
+  if (i == m_entries.end() || !i->second.has_body) return;
+  i->second.delivered = true;
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CRestResponseCache::reset_delivered() {
+  QMutexLocker locker(&m_mutex);
+  for (auto i = m_entries.begin(); i != m_entries.end(); ++i)
+    i->second.delivered = false;
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CRestResponseCache::clear() {
+  QMutexLocker locker(&m_mutex);
+  m_entries.clear();
+  if (m_dir.isEmpty()) return;
+  QDir dir(m_dir);
+  QStringList files = dir.entryList(QStringList() << "*.entry", QDir::Files);
+  for (auto i = files.begin(); i != files.end(); ++i)
+    dir.remove(*i);
+}
+////////////////////////////////////////////////////////////////////////////
+
+CRestResponseCache::entry_t&
+CRestResponseCache::entry(const QString &key) {
+  auto i = m_entries.find(key);
+  if (i != m_entries.end()) {
+    i->second.last_used = ++m_use_counter;
+    return i->second;
+  }
+
+  if ((int)m_entries.size() >= MAX_MEMORY_ENTRIES) {
+    // persisted entry will be loaded again on demand
+    auto lru = m_entries.begin();
+    for (auto j = m_entries.begin(); j != m_entries.end(); ++j)
+      if (j->second.last_used < lru->second.last_used) lru = j;
+    m_entries.erase(lru);
+  }
+
+  entry_t et;
+  load(key, et);
+  et.last_used = ++m_use_counter;
+  return m_entries[key] = et;
+}
+////////////////////////////////////////////////////////////////////////////
+
+QString
+CRestResponseCache::file_path(const QString &key) const {
+  QByteArray hash = QCryptographicHash::hash(key.toUtf8(),
+                                             QCryptographicHash::Sha1);
+  return m_dir + QDir::separator() + QString(hash.toHex()) + ".entry";
+}
+////////////////////////////////////////////////////////////////////////////
+
+bool
+CRestResponseCache::load(const QString &key,
+                         entry_t &et) const {
+  if (m_dir.isEmpty()) return false;
+  QFile file(file_path(key));
+  if (!file.exists() || !file.open(QIODevice::ReadOnly)) return false;
+
+  QDataStream stream(&file);
+  quint32 version = 0;
+  QString stored_key;
+  entry_t res;
+  stream >> version;
+  if (version != CACHE_FILE_VERSION) return false;
+  stream >> stored_key >> res.etag >> res.last_modified >> res.body;
+  if (stream.status() != QDataStream::Ok || stored_key != key) {
+    qWarning() << "Rest cache entry is broken" << file.fileName();
+    return false;
+  }
+  res.has_body = true;
+  et = res;
+  return true;
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CRestResponseCache::store(const QString &key,
+                          const entry_t &et) const {
+  if (m_dir.isEmpty()) return;
+  QString path = file_path(key);
+  // there is nothing to revalidate without validators
+  if (et.etag.isEmpty() && et.last_modified.isEmpty()) {
+    QFile::remove(path);
+    return;
+  }
+
+  QSaveFile file(path);
+  if (!file.open(QIODevice::WriteOnly)) {
+    qCritical() << "Can't write rest cache entry" << path << file.errorString();
+    return;
+  }
+  // responses may contain user's data, so temporary file is closed to
+  // others before anything is written and keeps it after commit
+  if (!file.setPermissions(QFileDevice::ReadOwner | QFileDevice::WriteOwner)) {
+    qCritical() << "Can't restrict rest cache entry" << path << file.errorString();
+    file.cancelWriting();
+    return;
+  }
+  QDataStream stream(&file);
+  stream << CACHE_FILE_VERSION << key << et.etag << et.last_modified << et.body;
+  if (!file.commit())
+    qCritical() << "Can't commit rest cache entry" << path << file.errorString();
+}
+////////////////////////////////////////////////////////////////////////////
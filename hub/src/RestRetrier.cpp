@@ -0,0 +1,147 @@
+#include <QDebug>
+#include <QMutexLocker>
+#include <QTimer>
+
+#include "RestRetrier.h"
+
+CRestRetrier::CRestRetrier(CRestPipeline *pipeline,
+                           const CRestRetryPolicy &policy) :
+  m_pipeline(pipeline),
+  m_policy(policy),
+  m_failure_threshold(CRestCircuitBreaker::DEFAULT_FAILURE_THRESHOLD),
+  m_open_ms(CRestCircuitBreaker::DEFAULT_OPEN_MS),
+  m_max_open_ms(CRestCircuitBreaker::DEFAULT_MAX_OPEN_MS) {
+  m_clock.start();
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CRestRetrier::enqueue(const QString &endpoint,
+                      QObject *context,
+                      start_fn_t start,
+                      rest_callback_t callback) {
+  call_ptr_t call = std::make_shared<call_t>();
+  call->endpoint = endpoint;
+  call->has_context = context != nullptr;
+  call->context = context;
+  call->start = start;
+  call->callback = callback;
+  call->attempts = 0;
+  attempt(call);
+}
+////////////////////////////////////////////////////////////////////////////
+
+QString
+CRestRetrier::endpoint_of(const QUrl &url) {
+  return url.toString(QUrl::RemoveUserInfo | QUrl::RemoveQuery | QUrl::RemoveFragment);
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CRestRetrier::set_policy(const CRestRetryPolicy &policy) {
+  QMutexLocker locker(&m_mutex);
+  m_policy = policy;
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CRestRetrier::set_breaker_params(uint failure_threshold,
+                                 uint open_ms,
+                                 uint max_open_ms) {
+  QMutexLocker locker(&m_mutex);
+  m_failure_threshold = failure_threshold;
+  m_open_ms = open_ms;
+  m_max_open_ms = max_open_ms;
+  m_breakers.clear();
+}
+////////////////////////////////////////////////////////////////////////////
+
+CRestCircuitBreaker::state_t
+CRestRetrier::breaker_state(const QString &endpoint) {
+  QMutexLocker locker(&m_mutex);
+  return breaker(endpoint).state();
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CRestRetrier::reset() {
+  QMutexLocker locker(&m_mutex);
+  m_breakers.clear();
+}
+////////////////////////////////////////////////////////////////////////////
+
+CRestCircuitBreaker&
+CRestRetrier::breaker(const QString &endpoint) {
+  auto i = m_breakers.find(endpoint);
+  if (i != m_breakers.end()) return i->second;
+  return m_breakers.insert(std::make_pair(endpoint,
+      CRestCircuitBreaker(m_failure_threshold, m_open_ms, m_max_open_ms))).first->second;
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CRestRetrier::attempt(call_ptr_t call) {
+  if (call->has_context && call->context.isNull()) return;
+
+  qint64 retry_after = 0;
+  bool allowed;
+  {
+    QMutexLocker locker(&m_mutex);
+    CRestCircuitBreaker& br = breaker(call->endpoint);
+    allowed = br.allow_request(m_clock.elapsed());
+    if (!allowed) retry_after = br.retry_after_ms(m_clock.elapsed());
+  }
+
+  if (!allowed) {
+    qDebug() << "Circuit of" << call->endpoint << "is open, request is rejected";
+    rest_response_t resp;
+    resp.circuit_open = true;
+    resp.network_error = QNetworkReply::TemporaryNetworkFailure;
+    resp.error_string = QString("%1 is temporarily unavailable, next try in %2 sec")
+                        .arg(call->endpoint).arg((retry_after + 999) / 1000);
+    m_pipeline->deliver(resp, call->context, call->callback);
+    return;
+  }
+
+  ++call->attempts;
+  call->start([this, call](const rest_response_t& resp) {
+    attempt_finished(call, resp);
+  });
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CRestRetrier::attempt_finished(call_ptr_t call,
+                               const rest_response_t &resp) {
+  bool retry;
+  uint delay = 0;
+  {
+    QMutexLocker locker(&m_mutex);
+    CRestCircuitBreaker& br = breaker(call->endpoint);
+    if (resp.cancelled)
+      br.on_abandoned();
+    else if (CRestRetryPolicy::is_transient(resp))
+      br.on_failure(m_clock.elapsed());
+    else
+      br.on_success();
+
+    retry = m_policy.should_retry(resp, call->attempts) &&
+            br.state() == CRestCircuitBreaker::CB_CLOSED;
+    if (retry)
+      delay = m_policy.delay_ms(call->attempts, CRestRetryPolicy::retry_after_ms(resp));
+  }
+
+  if (call->has_context && call->context.isNull()) return;
+  if (!retry) {
+    if (call->callback) call->callback(resp);
+    return;
+  }
+
+  qDebug() << "Request to" << call->endpoint << "failed, attempt"
+           << call->attempts << "retry in" << delay << "ms";
+  // pipeline is the owner of timer, so retries die with it
+  QTimer::singleShot(delay, m_pipeline, [this, call]() {
+    attempt(call);
+  });
+}
+////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,174 @@
+#include <random>
+#include <QMutex>
+#include <QMutexLocker>
+
+#include "RestRetryPolicy.h"
+
+const uint CRestRetryPolicy::DEFAULT_MAX_ATTEMPTS;
+const uint CRestRetryPolicy::DEFAULT_BASE_DELAY_MS;
+const uint CRestRetryPolicy::DEFAULT_MAX_DELAY_MS;
+const uint CRestCircuitBreaker::DEFAULT_FAILURE_THRESHOLD;
+const uint CRestCircuitBreaker::DEFAULT_OPEN_MS;
+const uint CRestCircuitBreaker::DEFAULT_MAX_OPEN_MS;
+
+// random part of delay, generator is seeded per process so instances differ
+static uint random_ms(uint max) {
+  static QMutex mutex;
+  static std::mt19937 generator((std::random_device())());
+  if (max == 0) return 0;
+  QMutexLocker locker(&mutex);
+  std::uniform_int_distribution<uint> dist(0, max);
+  return dist(generator);
+}
+////////////////////////////////////////////////////////////////////////////
+
+CRestRetryPolicy::CRestRetryPolicy(uint max_attempts,
+                                   uint base_delay_ms,
+                                   uint max_delay_ms) :
+  m_max_attempts(max_attempts),
+  m_base_delay_ms(base_delay_ms),
+  m_max_delay_ms(max_delay_ms) {
+}
+////////////////////////////////////////////////////////////////////////////
+
+bool
+CRestRetryPolicy::is_transient(const rest_response_t &resp) {
+  if (resp.cancelled || resp.circuit_open) return false;
+  if (resp.timed_out) return true;
+
+  switch (resp.http_code) {
+    case 408: // request timeout
+    case 429: // too many requests
+    case 500:
+    case 502:
+    case 503:
+    case 504:
+      return true;
+    default:
+      break;
+  }
+
+  // server didn't answer : connection refused, reset, host not found etc.
+  // ssl handshake failure is configuration problem, repeating won't help
+  return resp.http_code == -1 &&
+      resp.network_error != QNetworkReply::NoError &&
+      resp.network_error != QNetworkReply::OperationCanceledError &&
+      resp.network_error != QNetworkReply::SslHandshakeFailedError &&
+      resp.network_error < QNetworkReply::ProxyConnectionRefusedError;
+}
+////////////////////////////////////////////////////////////////////////////
+
+uint
+CRestRetryPolicy::retry_after_ms(const rest_response_t &resp) {
+  for (auto i = resp.headers.begin(); i != resp.headers.end(); ++i) {
+    if (qstricmp(i->first.constData(), "Retry-After") != 0) continue;
+    bool ok = false;
+    uint sec = i->second.trimmed().toUInt(&ok);
+    // http-date form isn't used by hub
+    return ok ? sec * 1000 : 0;
+  }
+  return 0;
+}
+////////////////////////////////////////////////////////////////////////////
+
+bool
+CRestRetryPolicy::should_retry(const rest_response_t &resp,
+                               uint attempts) const {
+  return attempts < m_max_attempts && is_transient(resp);
+}
+////////////////////////////////////////////////////////////////////////////
+
+uint
+CRestRetryPolicy::delay_ms(uint attempts,
+                           uint retry_after_ms) const {
+  quint64 delay = m_base_delay_ms;
+  for (uint i = 1; i < attempts && delay < m_max_delay_ms; ++i)
+    delay *= 2;
+  if (delay > m_max_delay_ms) delay = m_max_delay_ms;
+
+  uint res = (uint)(delay / 2) + random_ms((uint)(delay / 2));
+  if (retry_after_ms > res) res = retry_after_ms;
+  return res > m_max_delay_ms ? m_max_delay_ms : res;
+}
+////////////////////////////////////////////////////////////////////////////
+
+CRestCircuitBreaker::CRestCircuitBreaker(uint failure_threshold,
+                                         uint open_ms,
+                                         uint max_open_ms) :
+  m_failure_threshold(failure_threshold ? failure_threshold : 1),
+  m_base_open_ms(open_ms),
+  m_max_open_ms(max_open_ms),
+  m_state(CB_CLOSED),
+  m_failures(0),
+  m_open_ms(open_ms),
+  m_opened_at(0),
+  m_probe_in_flight(false) {
+}
+////////////////////////////////////////////////////////////////////////////
+
+bool
+CRestCircuitBreaker::allow_request(qint64 now_ms) {
+  switch (m_state) {
+    case CB_CLOSED:
+      return true;
+    case CB_OPEN:
+      if (now_ms - m_opened_at < (qint64)m_open_ms) return false;
+      m_state = CB_HALF_OPEN;
+      m_probe_in_flight = true;
+      return true;
+    case CB_HALF_OPEN:
+      if (m_probe_in_flight) return false;
+      m_probe_in_flight = true;
+      return true;
+  }
+  return false;
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CRestCircuitBreaker::on_success() {
+  m_state = CB_CLOSED;
+  m_failures = 0;
+  m_open_ms = m_base_open_ms;
+  m_probe_in_flight = false;
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CRestCircuitBreaker::on_failure(qint64 now_ms) {
+  switch (m_state) {
+    case CB_CLOSED:
+      if (++m_failures >= m_failure_threshold) open(now_ms);
+      return;
+    case CB_HALF_OPEN:
+      m_open_ms = m_open_ms * 2 > m_max_open_ms ? m_max_open_ms : m_open_ms * 2;
+      open(now_ms);
+      return;
+    case CB_OPEN:
+      // request was sent before breaker was opened
+      return;
+  }
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CRestCircuitBreaker::on_abandoned() {
+  m_probe_in_flight = false;
+}
+////////////////////////////////////////////////////////////////////////////
+
+qint64
+CRestCircuitBreaker::retry_after_ms(qint64 now_ms) const {
+  if (m_state != CB_OPEN) return 0;
+  qint64 left = m_opened_at + m_open_ms - now_ms;
+  return left > 0 ? left : 0;
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CRestCircuitBreaker::open(qint64 now_ms) {
+  m_state = CB_OPEN;
+  m_opened_at = now_ms;
+  m_probe_in_flight = false;
+}
+////////////////////////////////////////////////////////////////////////////
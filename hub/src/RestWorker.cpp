@@ -1,5 +1,5 @@
 #include <QApplication>
-#include <QEventLoop>
+#include <QMutexLocker>
 #include <QNetworkProxy>
 #include <QTimer>
 
@@ -8,43 +8,63 @@
 #include "Locker.h"
 #include "NotificationObserver.h"
 #include "OsBranchConsts.h"
+#include "RestJsonParser.h"
 #include "RestWorker.h"
 
-CRestWorker::CRestWorker() {
+CRestWorker::CRestWorker() :
+    m_cache(CRestResponseCache::default_dir()) {
     m_network_manager = create_network_manager();
     m_network_manager->setProxy(QNetworkProxy::NoProxy);
+    m_pipeline = new CRestPipeline(m_network_manager);
+    m_coalescer = new CRestCoalescer(m_pipeline);
+    m_retrier = new CRestRetrier(m_pipeline);
 
     next_cc_version = UNKNOWN_VERSION;
     next_p2p_version = UNKNOWN_VERSION;
 }
 
-CRestWorker::~CRestWorker() { free_network_manager(m_network_manager); }
+CRestWorker::~CRestWorker() {
+    // pipeline completes pending requests of coalescer when destroyed
+    delete m_pipeline;
+    delete m_coalescer;
+    delete m_retrier;
+    free_network_manager(m_network_manager);
+}
 ////////////////////////////////////////////////////////////////////////////
 
-void CRestWorker::get_p2p_status_finished_sl() {
-    QNetworkReply* reply = qobject_cast<QNetworkReply*>(sender());
-    if (reply == nullptr) {
-        return;
+/* items of response parsed while it was received. parser is absent when
+ * body was restored from cache, then it's parsed here */
+template<class T>
+static std::vector<T> parsed_items(const rest_response_t& resp,
+        const QString& array_key, int& err_code, QJsonObject* root = nullptr) {
+    std::shared_ptr<CJsonItemsParser<T> > parser =
+        std::dynamic_pointer_cast<CJsonItemsParser<T> >(resp.parser);
+    if (!parser) {
+        parser = std::make_shared<CJsonItemsParser<T> >(array_key);
+        parser->feed(resp.body);
+        parser->finish();
     }
-    int http_code, err_code, network_error;
-    pre_handle_reply(reply, http_code, err_code, network_error);
-
-    QByteArray reply_arr = reply->readAll();
-
-    QJsonDocument doc = qjson_doc_from_arr(reply_arr, err_code);
-    qDebug() << "Json: " << doc;
-
-    std::vector<CP2PInstance> lst_res;
-    QJsonObject obj = doc.object();
+    if (parser->failed()) {
+        qCritical() << QString("Failed to convert json document. Error message: %1")
+            .arg(parser->error_string());
+        err_code = RE_NOT_JSON_DOC;
+        return std::vector<T>();
+    }
+    if (root) *root = parser->root();
+    return parser->items();
+}
+////////////////////////////////////////////////////////////////////////////
 
-    if (obj["code"].toInt() == 0) {
-        QJsonArray doc_arr = obj["instances"].toArray();
-        for (auto i : doc_arr) {
-            if (i.isNull() || !i.isObject()) continue;
-            lst_res.push_back(CP2PInstance(i.toObject()));
-        }
-    } else {
-        err_code = obj["code"].toInt();
+void CRestWorker::get_p2p_status_finished(const rest_response_t& resp) {
+    int http_code, err_code, network_error;
+    pre_handle_response(resp, http_code, err_code, network_error, false);
+
+    QJsonObject root;
+    std::vector<CP2PInstance> lst_res =
+        parsed_items<CP2PInstance>(resp, "instances", err_code, &root);
+    if (root["code"].toInt() != 0) {
+        err_code = root["code"].toInt();
+        lst_res.clear();
     }
 
     emit on_get_p2p_status_finished(lst_res, http_code, err_code, network_error);
@@ -52,66 +72,57 @@ void CRestWorker::get_p2p_status_finished_sl() {
 
 ////////////////////////////////////////////////////////////////////////////
 
-void CRestWorker::get_my_peers_finished_sl() {
-    QNetworkReply* reply = qobject_cast<QNetworkReply*>(sender());
-    if (reply == nullptr) {
-        return;
-    }
+void CRestWorker::get_my_peers_finished(const QString& cache_key,
+        const rest_response_t& resp, bool unchanged) {
     int http_code, err_code, network_error;
-    pre_handle_reply(reply, http_code, err_code, network_error);
-
-    QByteArray reply_arr = reply->readAll();
-    QJsonDocument doc = qjson_doc_from_arr(reply_arr, err_code);
-    QJsonArray doc_arr = doc.array();
+    pre_handle_response(resp, http_code, err_code, network_error, false);
 
     std::vector<CMyPeerInfo> lst_res;
-    for (auto i : doc_arr) {
-        if (i.isNull() || !i.isObject()) continue;
-        lst_res.push_back(CMyPeerInfo(i.toObject()));
+    if (err_code == RE_SUCCESS && unchanged) {
+        emit on_get_my_peers_finished(lst_res, http_code, RE_NO_UPDATES, network_error);
+        return;
     }
 
+    lst_res = parsed_items<CMyPeerInfo>(resp, QString(), err_code);
+
+    if (err_code == RE_SUCCESS) m_cache.mark_delivered(cache_key);
     emit on_get_my_peers_finished(lst_res, http_code, err_code, network_error);
 }
 ////////////////////////////////////////////////////////////////////////////
 
-void CRestWorker::get_environments_finished_sl() {
-    QNetworkReply* reply = qobject_cast<QNetworkReply*>(sender());
-    qDebug() << "Is reply null " << (reply == nullptr);
-
-    if (reply == nullptr) {
-        return;
-    }
-
+void CRestWorker::get_environments_finished(const QString& cache_key,
+        const rest_response_t& resp, bool unchanged) {
     int http_code, err_code, network_error;
-    pre_handle_reply(reply, http_code, err_code, network_error);
-
-    QByteArray reply_arr = reply->readAll();
-    QJsonDocument doc = qjson_doc_from_arr(reply_arr, err_code);
-    QJsonArray doc_arr = doc.array();
+    pre_handle_response(resp, http_code, err_code, network_error, false);
 
     std::vector<CEnvironment> lst_res;
-    for (auto i = doc_arr.begin(); i != doc_arr.end(); ++i) {
-        if (i->isNull() || !i->isObject()) continue;
-        lst_res.push_back(CEnvironment(i->toObject()));
+    if (err_code == RE_SUCCESS && unchanged) {
+        qDebug() << "Environments weren't changed since last update";
+        emit on_get_environments_finished(lst_res, http_code, RE_NO_UPDATES,
+                network_error);
+        return;
     }
 
+    lst_res = parsed_items<CEnvironment>(resp, QString(), err_code);
+
+    if (err_code == RE_SUCCESS) m_cache.mark_delivered(cache_key);
     emit on_get_environments_finished(lst_res, http_code, err_code,
             network_error);
 }
 
 ////////////////////////////////////////////////////////////////////////////
 
-void CRestWorker::get_balance_finished_sl() {
-    QNetworkReply* reply = qobject_cast<QNetworkReply*>(sender());
-    qDebug() << "Is reply null " << (reply == nullptr);
-    if (reply == nullptr) {
-        return;
-    }
+void CRestWorker::get_balance_finished(const QString& cache_key,
+        const rest_response_t& resp, bool unchanged) {
     int http_code, err_code, network_error;
-    pre_handle_reply(reply, http_code, err_code, network_error);
-    QByteArray reply_arr = reply->readAll();
-    QJsonDocument doc = qjson_doc_from_arr(reply_arr, err_code);
+    pre_handle_response(resp, http_code, err_code, network_error, false);
     CHubBalance res_balance;
+    if (err_code == RE_SUCCESS && unchanged) {
+        emit on_get_balance_finished(res_balance, http_code, RE_NO_UPDATES, network_error);
+        return;
+    }
+
+    QJsonDocument doc = qjson_doc_from_arr(resp.body, err_code);
     do {
         if (err_code != 0) break;
         if (!doc.isObject()) {
@@ -121,6 +132,8 @@ void CRestWorker::get_balance_finished_sl() {
         QJsonObject balance = doc.object();
         res_balance = CHubBalance(balance["currentBalance"].toString());
     } while (0);
+
+    if (err_code == RE_SUCCESS) m_cache.mark_delivered(cache_key);
     emit on_get_balance_finished(res_balance, http_code, err_code, network_error);
 }
 ////////////////////////////////////////////////////////////////////////////
@@ -164,8 +177,8 @@ void CRestWorker::check_if_ss_console_is_ready_finished_sl() {
 }
 ////////////////////////////////////////////////////////////////////////////
 
-void CRestWorker::login(const QString& login, const QString& password,
-        int& http_code, int& err_code, int& network_error) {
+QNetworkRequest CRestWorker::login_request(const QString& login,
+        const QString& password, QByteArray& data) {
     static const QString str_url(hub_post_url().arg("login"));
     QUrl url_login(str_url);
     QUrlQuery query_login;
@@ -175,9 +188,13 @@ void CRestWorker::login(const QString& login, const QString& password,
     QNetworkRequest request(url_login);
     request.setHeader(QNetworkRequest::ContentTypeHeader,
             "application/x-www-form-urlencoded");
-    QByteArray arr = send_request(
-            m_network_manager, request, false, http_code, err_code, network_error,
-            query_login.toString(QUrl::FullyEncoded).toUtf8(), false);
+    data = query_login.toString(QUrl::FullyEncoded).toUtf8();
+    return request;
+}
+
+void CRestWorker::parse_login(const rest_response_t& resp,
+        int& http_code, int& err_code, int& network_error) {
+    pre_handle_response(resp, http_code, err_code, network_error, false);
     qDebug() << "Http code " << http_code << "Error code " << err_code
         << "Network Error " << network_error;
 
@@ -188,12 +205,41 @@ void CRestWorker::login(const QString& login, const QString& password,
         return;
     }
 
-    if (QString(arr) != str_ok) {
+    if (QString(resp.body) != str_ok) {
         err_code = RE_LOGIN_OR_EMAIL;
         return;
     }
 }
 
+void CRestWorker::login(const QString& login, const QString& password,
+        int& http_code, int& err_code, int& network_error) {
+    QByteArray data;
+    QNetworkRequest request = login_request(login, password, data);
+    rest_response_t resp = m_pipeline->execute(request, RO_POST, data, 0);
+    parse_login(resp, http_code, err_code, network_error);
+    if (err_code == RE_SUCCESS) set_auth_scope(login);
+}
+
+CRestPipeline::request_id_t CRestWorker::login_async(const QString& login,
+        const QString& password, QObject* context, login_callback_t callback) {
+    QByteArray data;
+    QNetworkRequest request = login_request(login, password, data);
+    return m_pipeline->enqueue(request, RO_POST, data, 0, context,
+            [this, login, callback](const rest_response_t& resp) {
+            int http_code, err_code, network_error;
+            parse_login(resp, http_code, err_code, network_error);
+            if (err_code == RE_SUCCESS) set_auth_scope(login);
+            if (callback) callback(http_code, err_code, network_error);
+    });
+}
+
+void CRestWorker::set_auth_scope(const QString& login) {
+    m_auth_scope = login;
+    // new session, consumers have to get full data again.
+    m_cache.reset_delivered();
+    m_coalescer->invalidate_all();
+}
+
 ////////////////////////////////////////////////////////////////////////////
 ///////////////////////* console rest API */////////////////////////////////
 void CRestWorker::peer_token(const QString& url_management, const QString& login,
@@ -215,7 +261,7 @@ void CRestWorker::peer_token(const QString& url_management, const QString& login
     request.setHeader(QNetworkRequest::ContentTypeHeader,
             "application/x-www-form-urlencoded");
     QByteArray arr = send_request(
-            m_network_manager, request, false, http_code, err_code, network_error,
+            request, false, http_code, err_code, network_error,
             query_login.toString(QUrl::FullyEncoded).toUtf8(), false, 60000);
 
     qDebug() << "Http code " << http_code << "Error code " << err_code
@@ -252,7 +298,7 @@ bool CRestWorker::peer_update_management(const QString &port){
 
     int http_code, err_code, network_error;
 
-    send_request(m_network_manager, request, false,
+    send_request(request, false,
             http_code, err_code, network_error,
             QByteArray(), true, 24 * 3600000); // 24 hours for update
 
@@ -284,7 +330,7 @@ void CRestWorker::peer_unregister(const QString& url_management, const QString&
     request.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
 
     QByteArray arr =
-        send_request(m_network_manager, request, 3, http_code, err_code,
+        send_request(request, 3, http_code, err_code,
                 network_error, QByteArray(), false, 60000);
     body = QString(arr);
     qDebug() << "peer unregister body " << body
@@ -314,7 +360,7 @@ void CRestWorker::peer_register(const QString& url_management, const QString& to
     request.setHeader(QNetworkRequest::ContentTypeHeader,
             "application/x-www-form-urlencoded");
     QByteArray arr = send_request(
-            m_network_manager, request, false, http_code, err_code, network_error,
+            request, false, http_code, err_code, network_error,
             query.toString(QUrl::FullyEncoded).toUtf8(), false, 60000);
     body = QString(arr);
 
@@ -326,9 +372,8 @@ void CRestWorker::peer_register(const QString& url_management, const QString& to
 }
 
 void CRestWorker::peer_finger(const QString& url_management,
-        CPeerController::peer_info_t type,
         QString name,
-        QString dir) {
+        peer_info_callback_t callback) {
     qInfo() << tr("Getting finger from %1").arg(url_management);
 
     const QString str_url(QString("https://%1/rest/v1/security/keyman/"
@@ -337,46 +382,24 @@ void CRestWorker::peer_finger(const QString& url_management,
     QUrl url_finger(str_url);
     QNetworkRequest req(url_finger);
     req.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
-    QNetworkReply* reply = get_reply(m_network_manager, req);
-    reply->ignoreSslErrors();
-
-    QTimer* timer = new QTimer(this);
-    timer->setInterval(10000);
-    timer->setSingleShot(true);
-    timer->start();
 
-    connect(timer, &QTimer::timeout, [reply]() {
-            if (reply) reply->close();
-            });
-    connect(reply, &QNetworkReply::finished, timer, &QTimer::stop);
-    connect(reply, &QNetworkReply::finished, timer, &QTimer::deleteLater);
-    connect(QCoreApplication::instance(), &QCoreApplication::aboutToQuit,
-            reply, &QNetworkReply::close);
-    connect(reply, &QNetworkReply::finished,
-            reply, &QNetworkReply::deleteLater);
-
-    connect(reply, &QNetworkReply::finished, [reply, type, name, dir, url_management](){
-            qDebug() << "Is reply null " << (reply == nullptr);
-            if (reply == nullptr) {
-            return;
-            }
+    m_retrier->enqueue(CRestRetrier::endpoint_of(url_finger), this,
+            [this, req](rest_callback_t callback) {
+            return m_pipeline->enqueue(req, RO_GET, QByteArray(), 10000, this, callback);
+    },
+            [callback, name, url_management](const rest_response_t& resp) {
             int http_code, err_code, network_error;
-            pre_handle_reply(reply, http_code, err_code, network_error);
-            QString finger = "undefined";
-            QByteArray arr = reply->readAll();
-            try {
-            finger = QString(arr);
-            } catch (...) {
-            finger = "undefined";
-            }
+            pre_handle_response(resp, http_code, err_code, network_error, false);
+            QString finger = QString(resp.body);
             qDebug() << "Response getting fingerprint "
+            << name
             << url_management
             << "code: "
             << http_code;
             if (http_code != 200) // if Status ok (200)
             finger = "undefined";
 
-            CPeerController::Instance()->parse_peer_info(type, name, dir, finger);
+            callback(finger);
     });
 }
 
@@ -413,39 +436,22 @@ void CRestWorker::peer_set_pass(const QString& url_mangement, const QString& use
 }
 
 void CRestWorker::peer_get_info(const QString& url_management, QString peer_info_type,
-        CPeerController::peer_info_t type,
         QString name,
-        QString dir) {
+        peer_info_callback_t callback) {
     // create request
     const QString str_url(QString("https://%1/rest/v1/system/management_updates").arg(url_management));
     QUrl url_login(str_url);
     QNetworkRequest request(url_login);
     request.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
-    QNetworkReply* reply = get_reply(m_network_manager, request);
-    reply->ignoreSslErrors();
-
-    QTimer* timer = new QTimer(this);
-    timer->setInterval(10000);
-    timer->setSingleShot(true);
-    timer->start();
-
-    connect(timer, &QTimer::timeout, [reply]() {
-            if (reply) reply->close();
-            });
-    connect(reply, &QNetworkReply::finished, timer, &QTimer::stop);
-    connect(reply, &QNetworkReply::finished, timer, &QTimer::deleteLater);
-    connect(reply, &QNetworkReply::finished, reply, &QNetworkReply::deleteLater);
-    connect(QCoreApplication::instance(), &QCoreApplication::aboutToQuit,
-            reply, &QNetworkReply::close);
 
-    connect(reply, &QNetworkReply::finished, [reply, url_management, type, name, dir, peer_info_type]() {
-            qDebug() << "Is reply null " << (reply == nullptr);
-            if (reply == nullptr) {
-            return;
-            }
+    m_retrier->enqueue(CRestRetrier::endpoint_of(url_login), this,
+            [this, request](rest_callback_t callback) {
+            return m_pipeline->enqueue(request, RO_GET, QByteArray(), 10000, this, callback);
+    },
+            [url_management, name, peer_info_type, callback](const rest_response_t& resp) {
             int http_code, err_code, network_error;
-            pre_handle_reply(reply, http_code, err_code, network_error);
-            QByteArray arr = reply->readAll();
+            pre_handle_response(resp, http_code, err_code, network_error, false);
+            const QByteArray& arr = resp.body;
             // get json file
             QJsonDocument doc = QJsonDocument::fromJson(arr);
             QString res = "false";
@@ -471,7 +477,7 @@ void CRestWorker::peer_get_info(const QString& url_management, QString peer_info
                     }
                 }
             }
-            CPeerController::Instance()->parse_peer_info(type, name, dir, res);
+            callback(res);
     });
 }
 
@@ -506,23 +512,22 @@ void CRestWorker::peer_login(const QString &url_management,
 
 ////////////////////////////////////////////////////////////////////////////
 
-bool CRestWorker::get_user_info(QString user_info_type,
-        QString& user_info_str) {
-    int http_code, err_code, network_error;
-    user_info_str = "";
-    static const QString str_url(hub_get_url().arg("user-info"));
-    QUrl url_login(str_url);
+QNetworkRequest CRestWorker::user_info_request() {
+    QUrl url_login(hub_get_url().arg("user-info"));
     QNetworkRequest request(url_login);
     request.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
-    QByteArray arr = send_request(m_network_manager, request, true, http_code,
-            err_code, network_error, QByteArray(), true);
+    return request;
+}
 
+bool CRestWorker::parse_user_info(const QString& user_info_type,
+        const QByteArray& arr, QString& user_info_str) {
+    user_info_str = "";
     QJsonDocument doc = QJsonDocument::fromJson(arr);
     qDebug() << "Json file: " << doc;
     if (doc.isNull() || doc.isEmpty() || !doc.isObject()) {
         qCritical("Get user %s failed. URL : %s",
                 user_info_type.toStdString().c_str(),
-                str_url.toStdString().c_str());
+                hub_get_url().arg("user-info").toStdString().c_str());
         return false;
     }
 
@@ -535,109 +540,103 @@ bool CRestWorker::get_user_info(QString user_info_type,
     }
     return true;
 }
+
+bool CRestWorker::get_user_info(QString user_info_type,
+        QString& user_info_str) {
+    int http_code, err_code, network_error;
+    QNetworkRequest request = user_info_request();
+    QByteArray arr = send_request(request, true, http_code,
+            err_code, network_error, QByteArray(), true);
+    return parse_user_info(user_info_type, arr, user_info_str);
+}
+
+CRestPipeline::request_id_t CRestWorker::get_user_info_async(
+        const QString& user_info_type, QObject* context,
+        user_info_callback_t callback) {
+    QNetworkRequest request = user_info_request();
+    return m_pipeline->enqueue(request, RO_GET, QByteArray(), 30000, context,
+            [user_info_type, callback](const rest_response_t& resp) {
+            int http_code, err_code, network_error;
+            pre_handle_response(resp, http_code, err_code, network_error, true);
+            QString user_info_str;
+            bool ok = parse_user_info(user_info_type, resp.body, user_info_str);
+            if (callback) callback(ok, user_info_str);
+    });
+}
 ////////////////////////////////////////////////////////////////////////////
 
-void CRestWorker::update_my_peers() {
-    QUrl url_env(hub_get_url().arg("my-peers"));
+void CRestWorker::update_hub_data(const QString& endpoint,
+        hub_data_handler_t handler, parser_factory_t parser_factory) {
+    QUrl url_env(hub_get_url().arg(endpoint));
     QNetworkRequest req(url_env);
     req.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
-    QNetworkReply* reply = get_reply(m_network_manager, req);
-    reply->ignoreSslErrors();
-    QTimer* timer = new QTimer(this);
-    timer->setInterval(60000);
-    timer->setSingleShot(true);
-
-    connect(timer, &QTimer::timeout, [reply]() {
-            CNotificationObserver::Instance()->Info(
-                    "Connection timeout, can't connect to bazaar",
-                    DlgNotification::N_NO_ACTION);
-            if (reply) reply->close();
-            });
-
-    timer->start();
+    QString key = CRestResponseCache::make_key(url_env, m_auth_scope);
+    CRestResponseCache::snapshot_t snapshot = m_cache.prepare_request(key, req);
+    // joined requests share retries of the first one, so breaker counts
+    // failure once. Cache resolves only final response.
+    m_coalescer->enqueue(key, this,
+            [this, url_env, req, parser_factory](rest_callback_t callback) {
+            m_retrier->enqueue(CRestRetrier::endpoint_of(url_env), nullptr,
+                    [this, req, parser_factory](rest_callback_t attempt_callback) {
+                    return m_pipeline->enqueue(req, RO_GET, QByteArray(), 60000, nullptr,
+                            attempt_callback, parser_factory());
+            }, callback);
+            return CRestPipeline::request_id_t(0);
+    },
+            [this, key, snapshot, handler](const rest_response_t& resp) {
+            rest_response_t res = resp;
+            bool unchanged = m_cache.resolve_response(key, snapshot, res);
+            if (res.timed_out) {
+                CNotificationObserver::Instance()->Info(
+                        "Connection timeout, can't connect to bazaar",
+                        DlgNotification::N_NO_ACTION);
+            }
+            (this->*handler)(key, res, unchanged);
+    });
+}
+////////////////////////////////////////////////////////////////////////////
 
-    connect(reply, &QNetworkReply::finished, timer, &QTimer::stop);
-    connect(reply, &QNetworkReply::finished, timer, &QTimer::deleteLater);
-    connect(reply, &QNetworkReply::finished, this,
-            &CRestWorker::get_my_peers_finished_sl);
-    connect(reply, &QNetworkReply::finished, reply, &QNetworkReply::deleteLater);
+void CRestWorker::update_my_peers() {
+    update_hub_data("my-peers", &CRestWorker::get_my_peers_finished, []() {
+            return std::make_shared<CJsonItemsParser<CMyPeerInfo> >();
+    });
 }
 
 void CRestWorker::update_p2p_status() {
     QUrl url_env(p2p_rest_url().arg("status"));
     QNetworkRequest req(url_env);
     req.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
-    QNetworkReply* reply = get_reply(m_network_manager, req);
-    reply->ignoreSslErrors();
-    connect(reply, &QNetworkReply::finished, this,
-            &CRestWorker::get_p2p_status_finished_sl);
-    connect(reply, &QNetworkReply::finished, reply, &QNetworkReply::deleteLater);
+    m_retrier->enqueue(CRestRetrier::endpoint_of(url_env), this,
+            [this, req](rest_callback_t callback) {
+            return m_pipeline->enqueue(req, RO_GET, QByteArray(), 0, this, callback,
+                    std::make_shared<CJsonItemsParser<CP2PInstance> >("instances"));
+    },
+            [this](const rest_response_t& resp) {
+            get_p2p_status_finished(resp);
+    });
 }
 
 ////////////////////////////////////////////////////////////////////////////
 
 void CRestWorker::update_environments() {
     qDebug() << "Getting the environments data from hub";
-    QUrl url_env(hub_get_url().arg("environments"));
-    QNetworkRequest req(url_env);
-    req.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
-    QNetworkReply* reply = get_reply(m_network_manager, req);
-    reply->ignoreSslErrors();
-
-    QTimer* timer = new QTimer(this);
-    timer->setInterval(60000);
-    timer->setSingleShot(true);
-
-    connect(timer, &QTimer::timeout, [reply]() {
-            CNotificationObserver::Instance()->Info(
-                    "Connection timeout, can't connect to bazaar",
-                    DlgNotification::N_NO_ACTION);
-            if (reply) reply->close();
-            });
-
-    timer->start();
-
-    connect(reply, &QNetworkReply::finished, timer, &QTimer::stop);
-    connect(reply, &QNetworkReply::finished, timer, &QTimer::deleteLater);
-    connect(reply, &QNetworkReply::finished, this,
-            &CRestWorker::get_environments_finished_sl);
-    connect(reply, &QNetworkReply::finished, reply, &QNetworkReply::deleteLater);
+    update_hub_data("environments", &CRestWorker::get_environments_finished, []() {
+            return std::make_shared<CJsonItemsParser<CEnvironment> >();
+    });
 }
 ////////////////////////////////////////////////////////////////////////////
 
 void CRestWorker::update_balance() {
     qDebug() << "Getting the balance data from hub";
-    QUrl url_env(hub_get_url().arg("balance"));
-    QNetworkRequest req(url_env);
-    req.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
-    QNetworkReply* reply = get_reply(m_network_manager, req);
-    reply->ignoreSslErrors();
-
-    QTimer* timer = new QTimer(this);
-    timer->setInterval(60000);
-    timer->setSingleShot(true);
-
-    connect(timer, &QTimer::timeout, [reply]() {
-            CNotificationObserver::Instance()->Info(
-                    "Connection timeout, can't connect to bazaar",
-                    DlgNotification::N_NO_ACTION);
-            if (reply) reply->close();
-            });
-
-    timer->start();
-
-    connect(reply, &QNetworkReply::finished, timer, &QTimer::stop);
-    connect(reply, &QNetworkReply::finished, timer, &QTimer::deleteLater);
-    connect(reply, &QNetworkReply::finished, this,
-            &CRestWorker::get_balance_finished_sl);
-    connect(reply, &QNetworkReply::finished, reply, &QNetworkReply::deleteLater);
+    update_hub_data("balance", &CRestWorker::get_balance_finished, []() {
+            return rest_body_parser_t();
+    });
 }
 
 ////////////////////////////////////////////////////////////////////////////
 
-std::vector<CGorjunFileInfo> CRestWorker::get_gorjun_file_info(
-        const QString& file_name, QString link) {
-    int http_code, err_code, network_error;
+QNetworkRequest CRestWorker::gorjun_file_info_request(const QString& file_name,
+        QString link) {
     if (link.isEmpty()) {
         link = hub_gorjun_url();
     }
@@ -645,14 +644,40 @@ std::vector<CGorjunFileInfo> CRestWorker::get_gorjun_file_info(
     QUrl url_gorjun_fi(link);
     QNetworkRequest request(url_gorjun_fi);
     request.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
-    QByteArray arr = send_request(m_network_manager, request, true, http_code,
-            err_code, network_error, QByteArray(), true);
+    return request;
+}
+
+std::vector<CGorjunFileInfo> CRestWorker::get_gorjun_file_info(
+        const QString& file_name, QString link) {
+    int http_code, err_code, network_error;
+    QNetworkRequest request = gorjun_file_info_request(file_name, link);
+    rest_response_t resp = execute_cached_get(
+            CRestResponseCache::make_key(request.url(), QString()), request, 0);
+    pre_handle_response(resp, http_code, err_code, network_error, true);
+    return parse_gorjun_file_info(file_name, resp.body);
+}
+
+CRestPipeline::request_id_t CRestWorker::get_gorjun_file_info_async(
+        const QString& file_name, QObject* context,
+        gorjun_file_info_callback_t callback, QString link) {
+    QNetworkRequest request = gorjun_file_info_request(file_name, link);
+    return enqueue_cached_get(CRestResponseCache::make_key(request.url(), QString()),
+            request, 0, context,
+            [file_name, callback](const rest_response_t& resp, bool) {
+            int http_code, err_code, network_error;
+            pre_handle_response(resp, http_code, err_code, network_error, true);
+            std::vector<CGorjunFileInfo> lst_res = parse_gorjun_file_info(file_name, resp.body);
+            if (callback) callback(lst_res);
+    });
+}
+
+std::vector<CGorjunFileInfo> CRestWorker::parse_gorjun_file_info(
+        const QString& file_name, const QByteArray& arr) {
     QJsonDocument doc = QJsonDocument::fromJson(arr);
     qDebug() << "Requested filename: " << file_name << "Json file: " << doc;
 
     std::vector<CGorjunFileInfo> lst_res;
     if (doc.isNull()) {
-        err_code = RE_NOT_JSON_DOC;
         return lst_res;
     }
 
@@ -679,6 +704,14 @@ std::vector<CGorjunFileInfo> CRestWorker::get_gorjun_file_info(
 }
 ////////////////////////////////////////////////////////////////////////////
 
+QNetworkRequest CRestWorker::remote_file_meta_request(const CGorjunFileInfo& fi) {
+    QString link = ipfs_download_url().arg(fi.id(), fi.name());
+    QUrl url_gorjun_fi(link);
+    QNetworkRequest request(url_gorjun_fi);
+    request.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
+    return request;
+}
+
 std::vector<CComponentMetaFile> CRestWorker::download_remote_file_meta(const QString& file_name) {
     QString meta_file = file_name + components_meta_extension();
     auto fi = get_gorjun_file_info(meta_file);
@@ -687,16 +720,40 @@ std::vector<CComponentMetaFile> CRestWorker::download_remote_file_meta(const QSt
         return lst_res;
     }
 
-    std::vector<CGorjunFileInfo>::iterator item = fi.begin();
-
     // Download and parse metafile
     int http_code, err_code, network_error;
-    QString link = ipfs_download_url().arg(item->id(), item->name());
-    QUrl url_gorjun_fi(link);
-    QNetworkRequest request(url_gorjun_fi);
-    request.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
-    QByteArray arr = send_request(m_network_manager, request, true, http_code,
-            err_code, network_error, QByteArray(), true);
+    QNetworkRequest request = remote_file_meta_request(*fi.begin());
+    rest_response_t resp = execute_cached_get(
+            CRestResponseCache::make_key(request.url(), QString()), request, 0);
+    pre_handle_response(resp, http_code, err_code, network_error, true);
+    return parse_remote_file_meta(file_name, resp.body);
+}
+
+void CRestWorker::download_remote_file_meta_async(const QString& file_name,
+        QObject* context, remote_file_meta_callback_t callback) {
+    QString meta_file = file_name + components_meta_extension();
+    get_gorjun_file_info_async(meta_file, context,
+            [this, file_name, context, callback](std::vector<CGorjunFileInfo> fi) {
+            if (fi.empty()) {
+                if (callback) callback(std::vector<CComponentMetaFile>());
+                return;
+            }
+            QNetworkRequest request = remote_file_meta_request(*fi.begin());
+            enqueue_cached_get(CRestResponseCache::make_key(request.url(), QString()),
+                    request, 0, context,
+                    [file_name, callback](const rest_response_t& resp, bool) {
+                    int http_code, err_code, network_error;
+                    pre_handle_response(resp, http_code, err_code, network_error, true);
+                    std::vector<CComponentMetaFile> lst_res =
+                        parse_remote_file_meta(file_name, resp.body);
+                    if (callback) callback(lst_res);
+            });
+    });
+}
+
+std::vector<CComponentMetaFile> CRestWorker::parse_remote_file_meta(
+        const QString& file_name, const QByteArray& arr) {
+    std::vector<CComponentMetaFile> lst_res;
     QJsonDocument doc = QJsonDocument::fromJson(arr);
     qDebug() << "Requested filename: " << file_name << "Json file: " << doc;
 
@@ -735,7 +792,7 @@ QString CRestWorker::get_vagrant_plugin_cloud_version(
             QString("https://rubygems.org/api/v1/versions/%1/latest.json")
             .arg(plugin_name));
     QNetworkRequest request(url_gorjun_fi);
-    QByteArray arr = send_request(m_network_manager, request, true, http_code,
+    QByteArray arr = send_request(request, true, http_code,
             err_code, network_error, QByteArray(), false);
     QJsonDocument doc = QJsonDocument::fromJson(arr);
 
@@ -766,7 +823,7 @@ QString CRestWorker::get_vagrant_box_cloud_version(
     QUrl url_gorjun_fi(QString("https://app.vagrantup.com/api/v1/box/%1/%2")
             .arg(parsed_name[0], parsed_name[1]));
     QNetworkRequest request(url_gorjun_fi);
-    QByteArray arr = send_request(m_network_manager, request, true, http_code,
+    QByteArray arr = send_request(request, true, http_code,
             err_code, network_error, QByteArray(), false);
     QJsonDocument doc = QJsonDocument::fromJson(arr);
 
@@ -816,23 +873,17 @@ void CRestWorker::send_health_request(const QString& p2p_version,
     QUrl url(hub_health_url());
     QNetworkRequest req(url);
     req.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
-    QNetworkReply* reply = post_reply(m_network_manager, doc.toJson(), req);
-    connect(reply, &QNetworkReply::finished, [this]() {
-            QNetworkReply* reply = qobject_cast<QNetworkReply*>(sender());
-            if (reply == nullptr) {
-            return;
-            }
-
+    m_pipeline->enqueue(req, RO_POST, doc.toJson(), 0, this,
+            [](const rest_response_t& resp) {
             int http_code, err_code, network_error;
-            pre_handle_reply(reply, http_code, err_code, network_error);
+            pre_handle_response(resp, http_code, err_code, network_error, false);
             if (err_code != RE_SUCCESS) {
             qCritical(
                     "send_health_request failed. http_code : %d, err_code : %d, "
                     "network_err : %d",
                     http_code, err_code, network_error);
             }
-            reply->deleteLater();
-            });
+    });
 }
 ////////////////////////////////////////////////////////////////////////////
 
@@ -862,7 +913,7 @@ const QString& CRestWorker::rest_err_to_str(rest_error_t err) {
     static QString login_err_str[] = {
         "SUCCESS",       "HTTP_ERROR",         "LOGIN_OR_EMAIL_ERROR",
         "TIMEOUT_ERROR", "NOT_JSON_DOC_ERROR", "NOT_JSON_OBJECT_ERROR",
-        "NETWORK_ERROR"};
+        "NETWORK_ERROR", "FAILED_ERROR",       "NO_UPDATES"};
     return login_err_str[err];
 }
 ////////////////////////////////////////////////////////////////////////////
@@ -875,8 +926,33 @@ std::vector<uint8_t> CRestWorker::is_sshkeys_in_environment(
         return empty;
     }
     qDebug() << "checking keys in " << env;
+    QByteArray doc_serialized;
+    QNetworkRequest req = sshkeys_in_environment_request(keys, env, doc_serialized);
+    int http_code, err_code, network_err;
+    QByteArray res_arr =
+        send_request(req, false, http_code, err_code,
+                network_err, doc_serialized, false);
+
+    std::vector<uint8_t> lst_res = parse_sshkeys_in_environment(res_arr);
+    qDebug() << "checking keys in" << env << "finished";
+    return lst_res;
+}
+
+CRestPipeline::request_id_t CRestWorker::is_sshkeys_in_environment_async(
+        const QStringList& keys, const QString& env,
+        QObject* context, sshkeys_in_environment_callback_t callback) {
+    QByteArray doc_serialized;
+    QNetworkRequest req = sshkeys_in_environment_request(keys, env, doc_serialized);
+    return m_pipeline->enqueue(req, RO_POST, doc_serialized, 0, context,
+            [callback](const rest_response_t& resp) {
+            std::vector<uint8_t> lst_res = parse_sshkeys_in_environment(resp.body);
+            if (callback) callback(lst_res);
+    });
+}
+
+QNetworkRequest CRestWorker::sshkeys_in_environment_request(
+        const QStringList& keys, const QString& env, QByteArray& data) {
     static const QString str_url(hub_post_url().arg("environments/check-key"));
-    std::vector<uint8_t> lst_res;
     QJsonObject obj;
     QJsonArray json_keys;
     for (auto i = keys.begin(); i != keys.end(); ++i)
@@ -886,31 +962,29 @@ std::vector<uint8_t> CRestWorker::is_sshkeys_in_environment(
     obj["envId"] = QJsonValue(env);
 
     QJsonDocument doc(obj);
-    QByteArray doc_serialized = doc.toJson();
+    data = doc.toJson();
     QUrl url(str_url);
     QNetworkRequest req(url);
     req.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
-    int http_code, err_code, network_err;
-    QByteArray res_arr =
-        send_request(m_network_manager, req, false, http_code, err_code,
-                network_err, doc_serialized, false);
+    return req;
+}
 
-    QJsonDocument res_doc = QJsonDocument::fromJson(res_arr);
+std::vector<uint8_t> CRestWorker::parse_sshkeys_in_environment(const QByteArray& arr) {
+    std::vector<uint8_t> lst_res;
+    QJsonDocument res_doc = QJsonDocument::fromJson(arr);
     if (res_doc.isEmpty()) return lst_res;
     if (!res_doc.isArray()) return lst_res;
     QJsonArray json_arr = res_doc.array();
     for (auto i = json_arr.begin(); i != json_arr.end(); ++i)
         lst_res.push_back(i->toBool() ? 1 : 0);
-    qDebug() << "checking keys in" << env << "finished";
     return lst_res;
 }
 ////////////////////////////////////////////////////////////////////////////
 
-void CRestWorker::add_sshkey_to_environments(
-        const QString& key_name, const QString& key,
-        const QStringList& lst_environments) {
+QNetworkRequest CRestWorker::sshkey_environments_request(
+        const QString& endpoint, const QString& key_name, const QString& key,
+        const QStringList& lst_environments, QByteArray& data) {
     QString ssh_key_md5 = CCommons::FileMd5(CSettingsManager::Instance().ssh_keys_storage() + QDir::separator() + key_name);
-    static const QString str_url(hub_post_url().arg("environments/ssh-keys"));
     QJsonObject obj;
     QJsonArray arr_environments;
     for (auto i = lst_environments.begin(); i != lst_environments.end(); ++i)
@@ -921,16 +995,47 @@ void CRestWorker::add_sshkey_to_environments(
     obj["environments"] = arr_environments;
 
     QJsonDocument doc(obj);
-    QByteArray doc_serialized = doc.toJson();
-    QUrl url(str_url);
+    data = doc.toJson();
+    QUrl url(hub_post_url().arg(endpoint));
     QNetworkRequest req(url);
     req.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
+    return req;
+}
+////////////////////////////////////////////////////////////////////////////
+
+void CRestWorker::add_sshkey_to_environments(
+        const QString& key_name, const QString& key,
+        const QStringList& lst_environments) {
+    QByteArray doc_serialized;
+    QNetworkRequest req = sshkey_environments_request("environments/ssh-keys",
+            key_name, key, lst_environments, doc_serialized);
 
     int http_status_code, err_code, network_error;
-    send_request(m_network_manager, req, false,
+    send_request(req, false,
             http_status_code, err_code, network_error, doc_serialized, true);
+    notify_add_sshkey_result(key_name, http_status_code, err_code, network_error);
+}
+
+CRestPipeline::request_id_t CRestWorker::add_sshkey_to_environments_async(
+        const QString& key_name, const QString& key,
+        const QStringList& lst_environments,
+        QObject* context, done_callback_t callback) {
+    QByteArray doc_serialized;
+    QNetworkRequest req = sshkey_environments_request("environments/ssh-keys",
+            key_name, key, lst_environments, doc_serialized);
+    return m_pipeline->enqueue(req, RO_POST, doc_serialized, 0, context,
+            [key_name, callback](const rest_response_t& resp) {
+            int http_status_code, err_code, network_error;
+            pre_handle_response(resp, http_status_code, err_code, network_error, true);
+            notify_add_sshkey_result(key_name, http_status_code, err_code, network_error);
+            if (callback) callback();
+    });
+}
+
+void CRestWorker::notify_add_sshkey_result(const QString& key_name,
+        int http_status_code, int err_code, int network_error) {
     qDebug() << "finished to add ssh keys"
-        << "json doc: " << doc
+        << "key name: " << key_name
         << "http code" << http_status_code
         << "network code" << network_error
         << "error code" << err_code;
@@ -952,28 +1057,56 @@ void CRestWorker::add_sshkey_to_environments(
 void CRestWorker::remove_sshkey_from_environments(
         const QString& key_name, const QString& key,
         const QStringList& lst_environments) {
-    QString ssh_key_md5 = CCommons::FileMd5(CSettingsManager::Instance().ssh_keys_storage() + QDir::separator() + key_name);
-    static const QString str_url(hub_post_url().arg("environments/remove-keys"));
-    QJsonObject obj;
-    QJsonArray arr_environments;
-    for (auto i = lst_environments.begin(); i != lst_environments.end(); ++i)
-        arr_environments.push_back(QJsonValue(*i));
-
-    obj["key_name"] = ssh_key_md5 + key_name;
-    obj["sshKey"] = QJsonValue(key);
-    obj["environments"] = arr_environments;
-
-    QJsonDocument doc(obj);
-    QByteArray doc_serialized = doc.toJson();
-    QUrl url(str_url);
-    QNetworkRequest req(url);
-    req.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
+    QByteArray doc_serialized;
+    QNetworkRequest req = sshkey_environments_request("environments/remove-keys",
+            key_name, key, lst_environments, doc_serialized);
 
     int http_status_code, err_code, network_error;
-    send_request(m_network_manager, req, false, http_status_code, err_code,
+    send_request(req, false, http_status_code, err_code,
             network_error, doc_serialized, true);
 }
 
+CRestPipeline::request_id_t CRestWorker::remove_sshkey_from_environments_async(
+        const QString& key_name, const QString& key,
+        const QStringList& lst_environments,
+        QObject* context, done_callback_t callback) {
+    QByteArray doc_serialized;
+    QNetworkRequest req = sshkey_environments_request("environments/remove-keys",
+            key_name, key, lst_environments, doc_serialized);
+    return m_pipeline->enqueue(req, RO_POST, doc_serialized, 0, context,
+            [callback](const rest_response_t& resp) {
+            int http_status_code, err_code, network_error;
+            pre_handle_response(resp, http_status_code, err_code, network_error, true);
+            if (callback) callback();
+    });
+}
+
+rest_response_t CRestWorker::execute_cached_get(const QString& key,
+        QNetworkRequest& req, uint timeout_ms) {
+    CRestResponseCache::snapshot_t snapshot = m_cache.prepare_request(key, req);
+    rest_response_t resp = m_coalescer->execute_get(key, req, timeout_ms);
+    m_cache.resolve_response(key, snapshot, resp);
+    return resp;
+}
+
+CRestPipeline::request_id_t CRestWorker::enqueue_cached_get(const QString& key,
+        QNetworkRequest& req, uint timeout_ms,
+        QObject* context, cached_callback_t callback,
+        rest_body_parser_t parser) {
+    CRestResponseCache::snapshot_t snapshot = m_cache.prepare_request(key, req);
+    return m_coalescer->enqueue_get(key, req, timeout_ms, context,
+            [this, key, snapshot, callback](const rest_response_t& resp) {
+            rest_response_t res = resp;
+            bool unchanged = m_cache.resolve_response(key, snapshot, res);
+            if (callback) callback(res, unchanged);
+    }, parser);
+}
+////////////////////////////////////////////////////////////////////////////
+
+void CRestWorker::cancel_request(CRestPipeline::request_id_t id) {
+    m_pipeline->cancel(id);
+}
+
 QNetworkAccessManager* CRestWorker::create_network_manager() {
     return new QNetworkAccessManager;
 }
@@ -1000,6 +1133,28 @@ void CRestWorker::pre_handle_reply(const QNetworkReply* reply, int& http_code,
 }
 ////////////////////////////////////////////////////////////////////////////
 
+void CRestWorker::pre_handle_response(const rest_response_t& resp, int& http_code,
+        int& err_code, int& network_error, bool show_network_err_msg) {
+    http_code = resp.http_code;
+    err_code = RE_SUCCESS;
+    network_error = 0;
+    if (resp.timed_out) {
+        err_code = RE_TIMEOUT;
+        return;
+    }
+    if (resp.network_error != QNetworkReply::NoError) {
+        network_error = resp.network_error;
+        err_code = RE_NETWORK_ERROR;
+        qCritical("Send request network error : %s",
+                resp.error_string.toStdString().c_str());
+        if (show_network_err_msg && !resp.cancelled)
+            CNotificationObserver::Error(
+                    tr(resp.error_string.toStdString().c_str()),
+                    DlgNotification::N_NO_ACTION);
+    }
+}
+////////////////////////////////////////////////////////////////////////////
+
 QJsonDocument CRestWorker::qjson_doc_from_arr(const QByteArray& arr,
         int& err_code) {
     QJsonParseError error;
@@ -1042,135 +1197,56 @@ QNetworkReply* CRestWorker::post_reply(QNetworkAccessManager* nam,
     return reply;
 }
 
-QNetworkReply* CRestWorker::delete_reply(QNetworkAccessManager* nam,
-        QNetworkRequest& req) {
-    req.setAttribute(QNetworkRequest::CacheLoadControlAttribute,
-            QNetworkRequest::AlwaysNetwork);
-    if (nam->networkAccessible() != QNetworkAccessManager::Accessible) {
-        qCritical("Network isn't accessible : %d", (int)nam->networkAccessible());
-        nam->setNetworkAccessible(QNetworkAccessManager::Accessible);
-    }
-    QNetworkReply* reply = nam->deleteResource(req);
-    reply->ignoreSslErrors();
-    return reply;
-}
 ////////////////////////////////////////////////////////////////////////////
 
-QByteArray CRestWorker::send_request(QNetworkAccessManager* nam,
-        QNetworkRequest& req, int get,
+QByteArray CRestWorker::send_request(QNetworkRequest& req, int get,
         int& http_status_code, int& err_code,
         int& network_error, QByteArray data,
         bool show_network_err_msg,
         uint timeout_time) {
-    req.setAttribute(QNetworkRequest::CacheLoadControlAttribute,
-            QNetworkRequest::AlwaysNetwork);
-    if (nam->networkAccessible() != QNetworkAccessManager::Accessible) {
-        qCritical("Network isn't accessible : %d", (int)nam->networkAccessible());
-        nam->setNetworkAccessible(QNetworkAccessManager::Accessible);
-    }
-
-    err_code = RE_SUCCESS;
-    network_error = 0;
-    http_status_code = -1;
-
-    QEventLoop* loop = new QEventLoop(this);
-    QTimer* timer = new QTimer(this);
-    timer->setSingleShot(true);
-    if (timeout_time == 0 || timeout_time == 30000) {
-        timer->start(30000);
-    } else {
-        timer->start(timeout_time);
-    }
-
-    QNetworkReply* reply;
-    switch (get) {
-        case 1:
-            reply = get_reply(nam, req);
-            break;
-        case 0:
-            reply = post_reply(nam, data, req);
-            break;
-        case 3:
-            reply = delete_reply(nam, req);
-            break;
-    }
-
-    QObject::connect(timer, &QTimer::timeout, loop, &QEventLoop::quit);
-    QObject::connect(reply, &QNetworkReply::finished, loop, &QEventLoop::quit);
-    QObject::connect(QCoreApplication::instance(), &QCoreApplication::aboutToQuit,
-            loop, &QEventLoop::quit);
-    QObject::connect(QCoreApplication::instance(), &QCoreApplication::aboutToQuit,
-            reply, &QNetworkReply::close);
-
-    reply->ignoreSslErrors();
-
-    loop->exec();
-    loop->deleteLater();
-
-    // timer is active if timeout didn't fire
-    if (!timer->isActive()) {
-        reply->abort();
-        err_code = RE_TIMEOUT;
-        reply->deleteLater();
-        timer->deleteLater();
-        return reply->readAll();
-    }
-
-    timer->stop();
-    timer->deleteLater();
-    if (reply->error() != QNetworkReply::NoError) {
-        network_error = reply->error();
-        qCritical("Send request network error : %s",
-                reply->errorString().toStdString().c_str());
-        if (show_network_err_msg)
-            CNotificationObserver::Error(
-                    tr(reply->errorString().toStdString().c_str()),
-                    DlgNotification::N_NO_ACTION);
-        err_code = RE_NETWORK_ERROR;
-        bool parsed = false;
-        http_status_code =
-            reply->attribute(QNetworkRequest::HttpStatusCodeAttribute)
-            .toInt(&parsed);
-        reply->deleteLater();
-        return reply->readAll();
-    }
-
-    bool parsed = false;
-    http_status_code =
-        reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt(&parsed);
-    QByteArray res = reply->readAll();
-    reply->deleteLater();
-    return res;
+    // pipeline completes request in its own thread, so calls from worker
+    // threads don't touch network manager and don't spin event loop.
+    rest_response_t resp = m_pipeline->execute(req, (rest_operation_t)get, data,
+            timeout_time == 0 ? 30000 : timeout_time);
+    pre_handle_response(resp, http_status_code, err_code, network_error,
+            show_network_err_msg);
+    return resp.body;
 }
 ////////////////////////////////////////////////////////////////////////////
 
-void CRestWorker::set_next_cc_version(const QString& version) 
+void CRestWorker::set_next_cc_version(const QString& version)
 {
+    QMutexLocker locker(&m_next_versions_mutex);
     next_cc_version = version;
 }
 
 void CRestWorker::set_next_p2p_version(const QString& version)
 {
+    QMutexLocker locker(&m_next_versions_mutex);
     next_p2p_version = version;
 }
 
 void CRestWorker::set_next_vagrant_version(const QString& version)
 {
+    QMutexLocker locker(&m_next_versions_mutex);
     next_vagrant_version = version;
 }
 
-const QString& CRestWorker::get_next_cc_version() const 
+QString CRestWorker::get_next_cc_version() const
 {
+    QMutexLocker locker(&m_next_versions_mutex);
     return next_cc_version;
 }
 
-const QString& CRestWorker::get_next_p2p_version() const 
+QString CRestWorker::get_next_p2p_version() const
 {
+    QMutexLocker locker(&m_next_versions_mutex);
     return next_p2p_version;
 }
 
-const QString& CRestWorker::get_next_vagrant_version() const 
+QString CRestWorker::get_next_vagrant_version() const
 {
+    QMutexLocker locker(&m_next_versions_mutex);
     return next_vagrant_version;
 }
 
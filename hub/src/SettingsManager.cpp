@@ -40,6 +40,7 @@ const QString CSettingsManager::SM_DEFAULT_CHROME_PROFILE("Default_Chrome_Profil
 const QString CSettingsManager::SM_DEFAULT_FIREFOX_PROFILE("Default_Firefox_Profile");
 
 const QString CSettingsManager::SM_NOTIFICATION_DELAY_SEC("Notification_Delay_Sec");
+const QString CSettingsManager::SM_TRANSFER_PARALLEL_COUNT("Transfer_Parallel_Count");
 const QString CSettingsManager::SM_PLUGIN_PORT("Plugin_Port");
 const QString CSettingsManager::SM_SSH_PATH("Ssh_Path");
 const QString CSettingsManager::SM_SCP_PATH("Scp_Path");
@@ -202,6 +203,7 @@ CSettingsManager::CSettingsManager()
       m_default_chrome_profile(default_default_chrome_profile()),
       m_default_firefox_profile(default_default_firefox_profile()),
       m_notification_delay_sec(7),
+      m_transfer_parallel_count(4),
       m_plugin_port(9998),
       m_ssh_path(ssh_cmd_path()),
       m_scp_path(scp_cmd_path()),
@@ -344,6 +346,11 @@ CSettingsManager::CSettingsManager()
     if (ok) set_notification_delay_sec(nd);
   }
 
+  if (!m_settings.value(SM_TRANSFER_PARALLEL_COUNT).isNull()) {
+    uint32_t count = m_settings.value(SM_TRANSFER_PARALLEL_COUNT).toUInt(&ok);
+    if (ok) set_transfer_parallel_count(count);
+  }
+
   if (!m_settings.value(SM_APP_BRANCH).isNull()) {
     QString branch = m_settings.value(SM_APP_BRANCH).toString();
     set_branch(branch);
@@ -0,0 +1,241 @@
+#include <memory>
+#include <QCryptographicHash>
+#include <QElapsedTimer>
+#include <QMutexLocker>
+#include <QWaitCondition>
+
+#include "SshKeyChecker.h"
+
+const int CSshKeyChecker::DEFAULT_MAX_PARALLEL;
+const uint CSshKeyChecker::DEFAULT_TIMEOUT_MS;
+const int CSshKeyChecker::DEFAULT_TTL_MS;
+
+namespace {
+  /* request for keys which aren't known in environment */
+  struct job_t {
+    QString env_id;
+    QString revision;
+    QStringList keys;
+    QStringList fingerprints;
+    std::vector<uint8_t> result;
+    bool done;
+  };
+
+  /* state of one check() call shared with callbacks */
+  struct batch_t {
+    QMutex mutex;
+    QWaitCondition cond;
+    CSshKeyChecker::check_fn_t check_fn;
+    int max_parallel;
+    std::vector<job_t> jobs;
+    size_t next;
+    int running;
+    size_t done;
+    bool abandoned;
+  };
+
+  void start_jobs(std::shared_ptr<batch_t> batch) {
+    while (true) {
+      size_t idx;
+      {
+        QMutexLocker locker(&batch->mutex);
+        if (batch->abandoned ||
+            batch->running >= batch->max_parallel ||
+            batch->next >= batch->jobs.size()) return;
+        idx = batch->next++;
+        ++batch->running;
+      }
+
+      const job_t& job = batch->jobs[idx];
+      batch->check_fn(job.keys, job.env_id,
+                      [batch, idx](const std::vector<uint8_t>& res) {
+        {
+          QMutexLocker locker(&batch->mutex);
+          batch->jobs[idx].result = res;
+          batch->jobs[idx].done = true;
+          --batch->running;
+          ++batch->done;
+          batch->cond.wakeAll();
+        }
+        start_jobs(batch);
+      });
+    }
+  }
+}
+////////////////////////////////////////////////////////////////////////////
+
+CSshKeyChecker::CSshKeyChecker(check_fn_t check_fn,
+                               int max_parallel) :
+  m_check_fn(check_fn),
+  m_max_parallel(max_parallel > 0 ? max_parallel : 1),
+  m_ttl_ms(DEFAULT_TTL_MS) {
+  m_clock.start();
+}
+////////////////////////////////////////////////////////////////////////////
+
+QString
+CSshKeyChecker::fingerprint(const QString &key_content) {
+  return QString(QCryptographicHash::hash(key_content.toUtf8(),
+                                          QCryptographicHash::Sha256).toHex());
+}
+////////////////////////////////////////////////////////////////////////////
+
+QString
+CSshKeyChecker::revision(const CEnvironment &env) {
+  QCryptographicHash hash(QCryptographicHash::Sha1);
+  hash.addData(env.id().toUtf8());
+  hash.addData(env.hash().toUtf8());
+  hash.addData(env.status().toUtf8());
+  for (auto i = env.containers().begin(); i != env.containers().end(); ++i) {
+    hash.addData("|");
+    hash.addData(i->id().toUtf8());
+  }
+  return QString(hash.result().toHex());
+}
+////////////////////////////////////////////////////////////////////////////
+
+std::map<QString, std::vector<uint8_t> >
+CSshKeyChecker::check(const QStringList &keys,
+                      const std::vector<env_t> &envs,
+                      uint timeout_ms) {
+  QStringList fingerprints;
+  for (auto i = keys.begin(); i != keys.end(); ++i)
+    fingerprints << fingerprint(*i);
+
+  std::shared_ptr<batch_t> batch = std::make_shared<batch_t>();
+  batch->check_fn = m_check_fn;
+  batch->max_parallel = m_max_parallel;
+  batch->next = 0;
+  batch->running = 0;
+  batch->done = 0;
+  batch->abandoned = false;
+
+  {
+    QMutexLocker locker(&m_mutex);
+    for (auto env = envs.begin(); env != envs.end(); ++env) {
+      env_entry_t& entry = m_cache[env->id];
+      if (entry.revision != env->revision) {
+        entry.revision = env->revision;
+        entry.keys.clear();
+      }
+
+      job_t job;
+      job.env_id = env->id;
+      job.revision = env->revision;
+      job.done = false;
+      for (int k = 0; k < keys.size(); ++k) {
+        if (is_fresh(entry, fingerprints[k])) continue;
+        if (job.fingerprints.contains(fingerprints[k])) continue;
+        job.keys << keys[k];
+        job.fingerprints << fingerprints[k];
+      }
+      if (!job.keys.empty()) batch->jobs.push_back(job);
+    }
+  }
+
+  if (!batch->jobs.empty()) {
+    start_jobs(batch);
+
+    QElapsedTimer et;
+    et.start();
+    QMutexLocker locker(&batch->mutex);
+    while (batch->done < batch->jobs.size()) {
+      qint64 left = (qint64)timeout_ms - et.elapsed();
+      if (left <= 0 || !batch->cond.wait(&batch->mutex, (unsigned long)left)) break;
+    }
+    // results which come later are dropped
+    batch->abandoned = true;
+
+    QMutexLocker cache_locker(&m_mutex);
+    for (auto job = batch->jobs.begin(); job != batch->jobs.end(); ++job) {
+      if (!job->done || job->result.size() != (size_t)job->keys.size()) continue;
+      auto entry = m_cache.find(job->env_id);
+      // environment was changed or invalidated while we were waiting
+      if (entry == m_cache.end() || entry->second.revision != job->revision) continue;
+      qint64 now = m_clock.elapsed();
+      for (int k = 0; k < job->fingerprints.size(); ++k) {
+        key_state_t& ks = entry->second.keys[job->fingerprints[k]];
+        ks.present = job->result[k] != 0;
+        ks.checked_ms = now;
+      }
+    }
+  }
+
+  std::map<QString, std::vector<uint8_t> > res;
+  QMutexLocker locker(&m_mutex);
+  for (auto env = envs.begin(); env != envs.end(); ++env) {
+    auto entry = m_cache.find(env->id);
+    if (entry == m_cache.end()) continue;
+    std::vector<uint8_t> flags;
+    for (int k = 0; k < fingerprints.size(); ++k) {
+      // expired result which couldn't be checked again isn't trusted
+      if (!is_fresh(entry->second, fingerprints[k])) break;
+      flags.push_back(entry->second.keys.at(fingerprints[k]).present ? 1 : 0);
+    }
+    if (flags.size() == (size_t)fingerprints.size())
+      res[env->id] = flags;
+  }
+  return res;
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CSshKeyChecker::invalidate_environment(const QString &env_id) {
+  QMutexLocker locker(&m_mutex);
+  m_cache.erase(env_id);
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CSshKeyChecker::invalidate_key(const QString &key_content) {
+  QString fp = fingerprint(key_content);
+  QMutexLocker locker(&m_mutex);
+  for (auto i = m_cache.begin(); i != m_cache.end(); ++i)
+    i->second.keys.erase(fp);
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CSshKeyChecker::retain_environments(const std::vector<env_t> &envs) {
+  std::map<QString, bool> ids;
+  for (auto i = envs.begin(); i != envs.end(); ++i)
+    ids[i->id] = true;
+  QMutexLocker locker(&m_mutex);
+  for (auto i = m_cache.begin(); i != m_cache.end(); ) {
+    if (ids.find(i->first) == ids.end())
+      i = m_cache.erase(i);
+    else
+      ++i;
+  }
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CSshKeyChecker::clear() {
+  QMutexLocker locker(&m_mutex);
+  m_cache.clear();
+}
+////////////////////////////////////////////////////////////////////////////
+
+int
+CSshKeyChecker::ttl() const {
+  QMutexLocker locker(&m_mutex);
+  return m_ttl_ms;
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CSshKeyChecker::set_ttl(int ttl_ms) {
+  QMutexLocker locker(&m_mutex);
+  m_ttl_ms = ttl_ms;
+}
+////////////////////////////////////////////////////////////////////////////
+
+bool
+CSshKeyChecker::is_fresh(const env_entry_t &entry,
+                         const QString &fp) const {
+  auto key = entry.keys.find(fp);
+  return key != entry.keys.end() &&
+      m_clock.elapsed() - key->second.checked_ms < m_ttl_ms;
+}
+////////////////////////////////////////////////////////////////////////////
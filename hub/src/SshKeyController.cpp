@@ -38,14 +38,23 @@ void Worker::remove() {
   emit finished();
 }
 
-SshKeyController::SshKeyController() {
+SshKeyController::SshKeyController() :
+  m_checker([](const QStringList& keys, const QString& env_id,
+               CSshKeyChecker::result_callback_t callback) {
+    CRestWorker::Instance()->is_sshkeys_in_environment_async(keys, env_id, nullptr,
+        [callback](std::vector<uint8_t> res) {
+      callback(res);
+    });
+  }) {
   m_pool = new QThreadPool;
   m_pool->setMaxThreadCount(1);
 
   // clean healthy environments list
   m_lst_healthy_environments.clear();
+  m_healthy_env_revisions.clear();
   for (auto env : CHubController::Instance().lst_healthy_environments()) {
     m_lst_healthy_environments[env.id()] = env.name();
+    m_healthy_env_revisions[env.id()] = CSshKeyChecker::revision(env);
   }
 
   connect(&CHubController::Instance(), &CHubController::environments_updated,
@@ -130,105 +139,103 @@ void SshKeyController::environments_updated_sl(int code) {
 }
 
 void SshKeyController::refresh_healthy_envs() {
-  // clean healthy environments list
-  m_lst_healthy_environments.clear();
-  for (auto env : CHubController::Instance().lst_healthy_environments()) {
-    m_lst_healthy_environments[env.id()] = env.name();
+  {
+    QMutexLocker locker(&m_mutex);
+    // clean healthy environments list
+    m_lst_healthy_environments.clear();
+    m_healthy_env_revisions.clear();
+    for (auto env : CHubController::Instance().lst_healthy_environments()) {
+      m_lst_healthy_environments[env.id()] = env.name();
+      m_healthy_env_revisions[env.id()] = CSshKeyChecker::revision(env);
+    }
   }
 
   QtConcurrent::run(m_pool, this, &SshKeyController::check_environment_keys);
 }
 
 void SshKeyController::check_environment_keys() {
-  QMutexLocker locker(&m_mutex);  // Locks the mutex and unlocks when locker exits the scope
-
-  // clean up old environment list in m_envs
-  if (!m_envs.empty() && (m_envs.size() != m_lst_healthy_environments.size())) {
-    std::map<QString, Envs> tmp = m_envs;
-
-    for (auto env : tmp) {
-      // not found environment(checked with bazaar) in current healthy environment list(updated)
-      if (m_lst_healthy_environments.find(env.first) == m_lst_healthy_environments.end()) {
-        if (m_envs.find(env.first) != m_envs.end())
-          m_envs.erase(env.first); // delete
-        qDebug() << "SSH clean m_env"
-                 << env.second.name
-                 << env.second.id;
+  QStringList contents;
+  std::vector<CSshKeyChecker::env_t> envs;
+  {
+    QMutexLocker locker(&m_mutex);  // Locks the mutex and unlocks when locker exits the scope
+
+    // clean up environments which aren't healthy anymore
+    for (auto it = m_envs.begin(); it != m_envs.end();) {
+      if (m_lst_healthy_environments.find(it->first) != m_lst_healthy_environments.end()) {
+        ++it;
+        continue;
       }
+      qDebug() << "SSH clean m_env"
+               << it->second.name
+               << it->second.id;
+      it = m_envs.erase(it);
+    }
+
+    for (auto ssh : m_keys)
+      contents << ssh.content;
+    for (auto env : m_lst_healthy_environments) {
+      CSshKeyChecker::env_t et;
+      et.id = env.first;
+      et.revision = m_healthy_env_revisions[env.first];
+      envs.push_back(et);
     }
   }
 
-  for (auto env : m_lst_healthy_environments) {
-    uint8_t exist = 1;
-    // found environment in "m_envs"
-    if (m_envs.find(env.first) != m_envs.end()) {
-      uint8_t index = 0;
-      for (auto ssh : m_keys) {
-        // found ssh keys in "m_envs"
-        if (std::find(m_envs[env.first].lst_ssh_contents.begin(),
-                      m_envs[env.first].lst_ssh_contents.end(),
-                      ssh.content) != m_envs[env.first].lst_ssh_contents.end()) {
-          // check ssh key file exist in machine
-          SshKey key = m_keys[index];
-          QFileInfo file(key.path);
-
-          if (!file.exists()) {
-            qDebug() << "Exist ssh key in environment, "
-                     << "file not found"
-                     << "";
-            m_envs[env.first].lst_ssh_contents.erase(
-                  m_envs[env.first].lst_ssh_contents.begin() + index); // delete ssh key if not exist in machine
-          } else {
-            m_keys[index].env_ids << env.first;
-            m_keys[index].env_ids.removeDuplicates();
-          }
-        }
+  if (CPeerController::Instance()->get_stop_thread()) {
+    qDebug() << "STOP CHECK SSH KEY REST";
+    return;
+  }
 
-        index = index + 1;
-      }
-    } else {
-      QStringList tmp_ssh_key_contents;
+  // bazaar is asked only about new keys and changed environments.
+  // mutex isn't locked here, because callbacks come to GUI thread.
+  m_checker.retain_environments(envs);
+  std::map<QString, std::vector<uint8_t> > presence = m_checker.check(contents, envs);
 
-      for (auto ssh : m_keys) {
-        tmp_ssh_key_contents << ssh.content;
-      }
+  {
+    QMutexLocker locker(&m_mutex);
+    for (auto res : presence) {
+      auto env_name = m_lst_healthy_environments.find(res.first);
+      if (env_name == m_lst_healthy_environments.end()) continue; // removed while checking
 
-      uint8_t index = 0;
-      std::vector<uint8_t> response = CRestWorker::Instance()->is_sshkeys_in_environment(tmp_ssh_key_contents,
-                                                                                         env.first);
       Envs tmp_env_with_keys;
-      tmp_env_with_keys.id = env.first;
-      tmp_env_with_keys.name = env.second;
+      tmp_env_with_keys.id = res.first;
+      tmp_env_with_keys.name = env_name->second;
 
-      for (auto i : response) {
-        if (i == exist) {
-          tmp_env_with_keys.keys.push_back(m_keys[index]);
-          tmp_env_with_keys.lst_ssh_contents.push_back(m_keys[index].content);
+      for (size_t index = 0; index < res.second.size(); ++index) {
+        // keys list may be changed while checking
+        auto key = std::find_if(m_keys.begin(), m_keys.end(),
+                                find_content(contents[(int)index]));
+        if (key == m_keys.end()) continue;
+
+        if (res.second[index] && QFileInfo(key->path).exists()) {
           // save env id to m_keys(ssh keys list)
-          m_keys[index].env_ids << tmp_env_with_keys.id;
-          m_keys[index].env_ids.removeDuplicates();
+          key->env_ids << tmp_env_with_keys.id;
+          key->env_ids.removeDuplicates();
+          tmp_env_with_keys.keys.push_back(*key);
+          tmp_env_with_keys.lst_ssh_contents.push_back(key->content);
+        } else {
+          key->env_ids.removeAll(tmp_env_with_keys.id);
         }
-        index = index + 1;
       }
 
       m_envs[tmp_env_with_keys.id] = tmp_env_with_keys;
     }
-  }
 
-  for (auto env : m_envs) {
-    for (auto key : env.second.keys) {
-      qInfo() << "SSH ENV: "
-              << env.second.name
-              << "HAS KEYS: "
-              << key.file_name;
+    for (auto env : m_envs) {
+      for (auto key : env.second.keys) {
+        qInfo() << "SSH ENV: "
+                << env.second.name
+                << "HAS KEYS: "
+                << key.file_name;
+      }
     }
-  }
-  for (auto key : m_keys) {
-    if (!key.env_ids.empty()) {
-      qInfo() << "SSH KEY has env ids"
-               << key.file_name
-               << key.path
-               << key.env_ids;
+    for (auto key : m_keys) {
+      if (!key.env_ids.empty()) {
+        qInfo() << "SSH KEY has env ids"
+                 << key.file_name
+                 << key.path
+                 << key.env_ids;
+      }
     }
   }
 
@@ -397,6 +404,8 @@ void SshKeyController::clean_environment_list(const QStringList& env_ids) {
   QMutexLocker locker(&m_mutex);  // Locks the mutex and unlocks when locker exits the scope
 
   for (auto env_id : env_ids) {
+    // keys of environment were changed, check it again
+    m_checker.invalidate_environment(env_id);
     if (m_envs.find(env_id) != m_envs.end()) {
       m_envs.erase(env_id);
       qDebug() << "SSH clean env id from lists: "
@@ -419,5 +428,6 @@ void SshKeyController::clean_keys_list(QString content) {
   if (it != m_keys.end()) {
     m_keys.erase(it);
   }
+  m_checker.invalidate_key(content);
   emit finished_check_environment_keys();
 }
@@ -0,0 +1,350 @@
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QTextStream>
+
+#include "SwarmReconciler.h"
+
+CSwarmReconciler::CSwarmReconciler(int interface_ids) :
+  m_running(false),
+  m_peers_known(false),
+  m_interface_ids(interface_ids),
+  m_local_changed(false),
+  m_evaluated(0) {
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CSwarmReconciler::set_environments(const std::vector<CEnvironment> &envs) {
+  QSet<QString> hub_hashes;
+  for (auto i = envs.begin(); i != envs.end(); ++i) {
+    const QString& hash = i->hash();
+    if (hash.isEmpty()) continue;
+    hub_hashes.insert(hash);
+
+    auto rec = m_envs.find(hash);
+    if (rec == m_envs.end()) {
+      env_record_t nrec;
+      nrec.env = *i;
+      nrec.joined = false;
+      nrec.reported = false;
+      nrec.join_running = false;
+      m_envs.insert(hash, nrec);
+    } else if (rec->env != *i) {
+      remove_env_peers(rec->env);
+      rec->env = *i;
+    } else {
+      continue;
+    }
+    add_env_peers(*i);
+    m_dirty.insert(hash);
+    m_local_dirty_envs.insert(hash);
+  }
+
+  if (hub_hashes.size() == m_envs.size()) return;
+  for (auto rec = m_envs.begin(); rec != m_envs.end();) {
+    if (hub_hashes.contains(rec.key())) {
+      ++rec;
+      continue;
+    }
+    remove_env_peers(rec->env);
+    m_dirty.insert(rec.key());
+    rec = m_envs.erase(rec);
+  }
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CSwarmReconciler::set_p2p_state(const p2p_state_t &state) {
+  if (!state.installed || !state.running) {
+    if (!m_running) return;
+    // daemon forgot everything, so is the reconciler
+    m_running = false;
+    m_swarms.clear();
+    m_interfaces.clear();
+    m_peers.clear();
+    m_peers_stamp.clear();
+    m_leaving.clear();
+    m_recheck.clear();
+    m_interface_ids.clear();
+    for (auto rec = m_envs.begin(); rec != m_envs.end(); ++rec) {
+      rec->joined = false;
+      rec->join_running = false;
+    }
+    return;
+  }
+
+  if (!m_running) {
+    m_running = true;
+    mark_all_dirty();
+  }
+
+  if (state.swarms != m_swarms) {
+    for (auto i = state.swarms.begin(); i != state.swarms.end(); ++i)
+      if (!m_swarms.contains(*i)) m_dirty.insert(*i);
+    for (auto i = m_swarms.begin(); i != m_swarms.end(); ++i)
+      if (!state.swarms.contains(*i)) m_dirty.insert(*i);
+    m_swarms = state.swarms;
+  }
+
+  if (state.interfaces != m_interfaces) {
+    for (auto i = state.interfaces.begin(); i != state.interfaces.end(); ++i) {
+      auto old = m_interfaces.find(i.key());
+      if (old != m_interfaces.end() && old.value() == i.value()) continue;
+      m_interface_ids.bind(i.key(), CInterfaceIdAllocator::parse_id(i.value()));
+      m_dirty.insert(i.key());
+    }
+    for (auto i = m_interfaces.begin(); i != m_interfaces.end(); ++i) {
+      if (state.interfaces.contains(i.key())) continue;
+      auto rec = m_envs.find(i.key());
+      if (rec == m_envs.end() || !rec->join_running)
+        m_interface_ids.release(i.key());
+      m_dirty.insert(i.key());
+    }
+    m_interfaces = state.interfaces;
+  }
+
+  // sum doesn't depend on order of peers
+  QHash<QString, uint> stamps;
+  for (auto i = state.peers.begin(); i != state.peers.end(); ++i) {
+    QString hash = i.key().left(i.key().indexOf('\n'));
+    stamps[hash] += qHash(i.key()) ^ (qHash(i.value()) * 0x9e3779b9u);
+  }
+  if (stamps != m_peers_stamp) {
+    for (auto i = stamps.begin(); i != stamps.end(); ++i) {
+      auto old = m_peers_stamp.find(i.key());
+      if (old == m_peers_stamp.end() || old.value() != i.value())
+        m_dirty.insert(i.key());
+    }
+    for (auto i = m_peers_stamp.begin(); i != m_peers_stamp.end(); ++i)
+      if (!stamps.contains(i.key())) m_dirty.insert(i.key());
+    m_peers_stamp = stamps;
+  }
+  m_peers = state.peers;
+  m_peers_known = state.peers_known;
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CSwarmReconciler::set_local_containers(const QStringList &hostnames) {
+  QSet<QString> local = hostnames.toSet();
+  if (local == m_local) return;
+  m_local = local;
+  m_local_match.clear();
+  m_local_changed = true;
+}
+////////////////////////////////////////////////////////////////////////////
+
+swarm_actions_t
+CSwarmReconciler::reconcile() {
+  swarm_actions_t res;
+  m_evaluated = 0;
+
+  if (m_running) {
+    QSet<QString> dirty;
+    dirty.swap(m_dirty);
+    dirty.unite(m_recheck);
+    for (auto i = dirty.begin(); i != dirty.end(); ++i)
+      evaluate(*i, res);
+  }
+
+  if (m_local.isEmpty()) {
+    // table isn't touched without local containers, all of them are evaluated when they appear
+    m_local_dirty_envs.clear();
+    m_local_dirty_peers.clear();
+    return res;
+  }
+
+  if (m_local_changed) {
+    for (auto rec = m_envs.begin(); rec != m_envs.end(); ++rec)
+      evaluate_local(*rec);
+  } else {
+    for (auto i = m_local_dirty_envs.begin(); i != m_local_dirty_envs.end(); ++i) {
+      auto rec = m_envs.find(*i);
+      if (rec != m_envs.end()) evaluate_local(*rec);
+    }
+  }
+  m_local_changed = false;
+  m_local_dirty_envs.clear();
+
+  for (auto i = m_local_dirty_peers.begin(); i != m_local_dirty_peers.end(); ++i) {
+    auto hashes = m_envs_of_peer.find(*i);
+    if (hashes == m_envs_of_peer.end()) continue;
+    bool local = false;
+    for (auto h = hashes->begin(); h != hashes->end() && !local; ++h) {
+      auto rec = m_envs.constFind(*h);
+      local = rec != m_envs.constEnd() && rec->local_peers.contains(*i);
+    }
+    auto old = m_rh_local.find(*i);
+    if (old != m_rh_local.end() && old.value() == local) continue;
+    m_rh_local[*i] = local;
+    res.rh_local[*i] = local;
+  }
+  m_local_dirty_peers.clear();
+  return res;
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CSwarmReconciler::join_finished(const QString &hash,
+                               bool success) {
+  auto rec = m_envs.find(hash);
+  if (rec != m_envs.end()) rec->join_running = false;
+  if (!success && !m_interfaces.contains(hash))
+    m_interface_ids.release(hash);
+  // if swarm isn't there on next reconcile, join is repeated
+  m_dirty.insert(hash);
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CSwarmReconciler::leave_finished(const QString &hash) {
+  m_leaving.remove(hash);
+  m_dirty.insert(hash);
+}
+////////////////////////////////////////////////////////////////////////////
+
+QStringList
+CSwarmReconciler::read_local_containers(const QString &lxc_path) {
+  QStringList res;
+  QHash<QString, hostname_t> hostnames;
+  QFileInfoList dirs = QDir(lxc_path).entryInfoList(QDir::Dirs | QDir::NoDotAndDotDot);
+
+  for (auto i = dirs.begin(); i != dirs.end(); ++i) {
+    QString path = i->absoluteFilePath() + "/rootfs/etc/hostname";
+    QFileInfo info(path);
+    if (!info.exists()) continue;
+
+    auto cached = m_hostnames.find(path);
+    if (cached != m_hostnames.end() &&
+        cached->modified == info.lastModified() &&
+        cached->size == info.size()) {
+      res << cached->name;
+      hostnames.insert(path, cached.value());
+      continue;
+    }
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+      qDebug() << "error opening file: " << file.error() << path;
+      continue;
+    }
+    hostname_t hostname;
+    hostname.modified = info.lastModified();
+    hostname.size = info.size();
+    hostname.name = QTextStream(&file).readLine();
+    file.close();
+
+    qDebug() << "local container hostname found: " << hostname.name;
+    res << hostname.name;
+    hostnames.insert(path, hostname);
+  }
+
+  m_hostnames.swap(hostnames);
+  return res;
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CSwarmReconciler::evaluate(const QString &hash,
+                           swarm_actions_t &res) {
+  ++m_evaluated;
+  bool in_swarm = m_swarms.contains(hash);
+  auto rec = m_envs.find(hash);
+
+  if (rec == m_envs.end()) {
+    m_recheck.remove(hash);
+    if (in_swarm && !m_leaving.contains(hash)) {
+      m_leaving.insert(hash);
+      res.leave << hash;
+    }
+    if (!in_swarm && !m_interfaces.contains(hash))
+      m_interface_ids.release(hash);
+    return;
+  }
+
+  if (!rec->reported || rec->joined != in_swarm) {
+    (in_swarm ? res.connected : res.disconnected) << hash;
+    rec->reported = true;
+    rec->joined = in_swarm;
+  }
+
+  if (in_swarm) {
+    // containers unknown by REST of daemon are checked with `p2p show` each time
+    bool known = m_peers_known;
+    const std::vector<CHubContainer>& conts = rec->env.containers();
+    for (auto i = conts.begin(); i != conts.end() && known; ++i)
+      known = m_peers.contains(CP2PStateTracker::peer_key(hash, i->rh_ip()));
+    if (known) m_recheck.remove(hash);
+    else m_recheck.insert(hash);
+    res.check.push_back(rec->env);
+    return;
+  }
+
+  m_recheck.remove(hash);
+  if (!rec->env.healthy() || rec->join_running) return;
+  CEnvironment env = rec->env;
+  env.set_base_interface_id(m_interface_ids.reserve(hash));
+  rec->join_running = true;
+  res.join.push_back(env);
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CSwarmReconciler::evaluate_local(env_record_t &rec) {
+  QSet<QString> local_peers;
+  const std::vector<CHubContainer>& conts = rec.env.containers();
+  for (auto i = conts.begin(); i != conts.end(); ++i) {
+    m_local_dirty_peers.insert(i->peer_id());
+    if (is_local(i->name())) local_peers.insert(i->peer_id());
+  }
+  rec.local_peers.swap(local_peers);
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CSwarmReconciler::add_env_peers(const CEnvironment &env) {
+  const std::vector<CHubContainer>& conts = env.containers();
+  for (auto i = conts.begin(); i != conts.end(); ++i)
+    m_envs_of_peer[i->peer_id()].insert(env.hash());
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CSwarmReconciler::remove_env_peers(const CEnvironment &env) {
+  const std::vector<CHubContainer>& conts = env.containers();
+  for (auto i = conts.begin(); i != conts.end(); ++i) {
+    auto hashes = m_envs_of_peer.find(i->peer_id());
+    if (hashes == m_envs_of_peer.end()) continue;
+    hashes->remove(env.hash());
+    if (hashes->isEmpty()) m_envs_of_peer.erase(hashes);
+    m_local_dirty_peers.insert(i->peer_id());
+  }
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CSwarmReconciler::mark_all_dirty() {
+  for (auto rec = m_envs.begin(); rec != m_envs.end(); ++rec) {
+    rec->reported = false;
+    m_dirty.insert(rec.key());
+  }
+}
+////////////////////////////////////////////////////////////////////////////
+
+bool
+CSwarmReconciler::is_local(const QString &cont_name) {
+  auto cached = m_local_match.find(cont_name);
+  if (cached != m_local_match.end()) return cached.value();
+
+  // host name of container is its name with suffix
+  bool found = m_local.contains(cont_name);
+  for (auto i = m_local.begin(); i != m_local.end() && !found; ++i)
+    found = i->contains(cont_name);
+  if (found) qInfo() << "matched local container" << cont_name;
+  m_local_match.insert(cont_name, found);
+  return found;
+}
+////////////////////////////////////////////////////////////////////////////
+
@@ -19,11 +19,17 @@
 #include "HubController.h"
 #include "NotificationObserver.h"
 #include "OsBranchConsts.h"
+#include "P2PStateTracker.h"
+#include "PathResolver.h"
+#include "ProcessRunner.h"
 #include "RestWorker.h"
 #include "SettingsManager.h"
 #include "LibsshController.h"
+#include "SftpTransfer.h"
 #include "X2GoClient.h"
+#include "VagrantMetadata.h"
 #include "VagrantProvider.h"
+#include "VagrantStatusCache.h"
 #include <QJsonArray>
 #include <QJsonDocument>
 #include <QJsonObject>
@@ -64,10 +70,26 @@ system_call_res_t CSystemCallWrapper::ssystem_th(const QString &cmd,
                                                  QStringList &args,
                                                  bool read_output, bool log,
                                                  unsigned long timeout_msec) {
-  QFuture<system_call_res_t> f1 =
-      QtConcurrent::run(ssystem, cmd, args, read_output, log, timeout_msec);
-  f1.waitForFinished();
-  return f1.result();
+  // process is run by CProcessRunner, so only calling thread waits for it
+  process_options_t opts;
+  QStringList proc_args = args;
+  if (proc_args.size() >= 2 && proc_args.front() == "set_working_directory") {
+    proc_args.removeFirst();
+    opts.working_dir = proc_args.takeFirst();
+  }
+#ifdef RT_OS_DARWIN
+  // the same as in ssystem()
+  QProcessEnvironment env = QProcessEnvironment::systemEnvironment();
+  env.insert("PATH", env.value("PATH") + ":/usr/local/bin");
+  opts.env = env;
+#endif
+  // 97 and ULONG_MAX mean waiting without timeout, such commands
+  // (vagrant up, provisioning and so on) are run in lane of long processes
+  opts.long_running = timeout_msec == 97 || timeout_msec == ULONG_MAX;
+  opts.timeout_msec = opts.long_running ? 0 : timeout_msec;
+  opts.collect_output = read_output;
+  opts.log = log;
+  return CProcessRunner::Instance()->execute(cmd, proc_args, opts);
 }
 ////////////////////////////////////////////////////////////////////////////
 /// \brief CSystemCallWrapper::ssystem_f
@@ -281,6 +303,10 @@ system_call_res_t CSystemCallWrapper::ssystem(const QString &cmd,
 ////////////////////////////////////////////////////////////////////////////
 
 bool CSystemCallWrapper::is_in_swarm(const QString &hash) {
+  // lookup in snapshot of tracker, `p2p show` only while there is no snapshot
+  CP2PStateTracker* tracker = CP2PStateTracker::Instance();
+  if (tracker->has_state()) return tracker->is_in_swarm(hash);
+
   QString cmd = CSettingsManager::Instance().p2p_path();
   QStringList args;
   args << "show"; // need to change
@@ -306,6 +332,14 @@ bool CSystemCallWrapper::is_in_swarm(const QString &hash) {
 std::vector<std::pair<QString, QString>> CSystemCallWrapper::p2p_show_interfaces() {
   std::vector<std::pair<QString, QString>> swarm_lsts;
 
+  CP2PStateTracker* tracker = CP2PStateTracker::Instance();
+  if (tracker->has_state()) {
+    QHash<QString, QString> interfaces = tracker->state().interfaces;
+    for (auto i = interfaces.begin(); i != interfaces.end(); ++i)
+      swarm_lsts.push_back(std::make_pair(i.key(), i.value()));
+    return swarm_lsts;
+  }
+
   if (!p2p_daemon_check()) {
     return swarm_lsts;
   }
@@ -340,6 +374,14 @@ std::vector<std::pair<QString, QString>> CSystemCallWrapper::p2p_show_interfaces
 std::vector<QString> CSystemCallWrapper::p2p_show() {
   std::vector<QString> swarm_lsts;
 
+  CP2PStateTracker* tracker = CP2PStateTracker::Instance();
+  if (tracker->has_state()) {
+    QSet<QString> swarms = tracker->state().swarms;
+    for (auto i = swarms.begin(); i != swarms.end(); ++i)
+      swarm_lsts.push_back(*i);
+    return swarm_lsts;
+  }
+
   if (!p2p_daemon_check()) {
     return swarm_lsts;
   }
@@ -504,9 +546,72 @@ std::pair<system_call_wrapper_error_t, QStringList> CSystemCallWrapper::send_com
 }
 
 
+static ssh_endpoint_t
+transfer_endpoint(const QString &remote_user, const QString &ip,
+                  const std::pair<QString, QString> &ssh_info) {
+  ssh_endpoint_t endpoint;
+  endpoint.host = ip;
+  endpoint.port = ssh_info.first.isEmpty() ? 22 : ssh_info.first.toUShort();
+  endpoint.user = remote_user;
+  endpoint.private_key = ssh_info.second;
+  return endpoint;
+}
+
+/* scp is used if sftp session can't be opened */
+static system_call_wrapper_error_t
+sftp_result_to_scwe(int rc, bool &use_scp) {
+  use_scp = false;
+  switch (rc) {
+    case RLE_SUCCESS:
+      return SCWE_SUCCESS;
+    case RLE_LIBSSH2_INIT:
+    case RLE_LIBSSH2_SESSION_INIT:
+    case RLE_SESSION_HANDSHAKE:
+    case RLE_SSH_AUTHENTICATION:  // libssh2 doesn't read some key formats
+    case RLE_SFTP_INIT:
+      use_scp = true;
+      return SCWE_SSH_LAUNCH_FAILED;
+    case RLE_SFTP_PERMISSION_DENIED:
+      return SCWE_PERMISSION_DENIED;
+    case RLE_CANCELLED:
+      return SCWE_CANCELLED;
+    case RLE_CONNECTION_TIMEOUT:
+      return SCWE_TIMEOUT;
+    default:
+      return SCWE_COMMAND_FAILED;
+  }
+}
+
+/* scp doesn't understand drive letters */
+static QString
+scp_local_path(const QString &path) {
+  QString res = path;
+  if (res.size() > 1 && res[1] == ':') {
+    res.remove(0, 2);
+    res.insert(0, QString("\\."));
+  }
+  return res;
+}
+
 std::pair<system_call_wrapper_error_t, QStringList> CSystemCallWrapper::upload_file
 (const QString &remote_user, const QString &ip, std::pair<QString, QString> ssh_info,
- const QString &destination, const QString &file_path) {
+ const QString &destination, const QString &file_path,
+ std::function<void(quint64, quint64)> progress, const QAtomicInt *cancel) {
+  int rc = CSftpTransfer::upload(transfer_endpoint(remote_user, ip, ssh_info),
+                                 file_path, destination, progress, cancel);
+  bool use_scp = false;
+  system_call_wrapper_error_t sftp_res = sftp_result_to_scwe(rc, use_scp);
+  qDebug() << "sftp upload of" << file_path << "finished:"
+           << CLibsshController::run_libssh2_error_to_str((run_libssh2_error_t)rc);
+  if (use_scp && cancel && cancel->load())
+    return std::make_pair(SCWE_CANCELLED, QStringList());
+  if (!use_scp) {
+    QStringList output;
+    if (sftp_res != SCWE_SUCCESS)
+      output << CLibsshController::run_libssh2_error_to_str((run_libssh2_error_t)rc);
+    return std::make_pair(sftp_res, output);
+  }
+
   QString cmd
       = CSettingsManager::Instance().scp_path();
   QStringList args;
@@ -523,7 +628,7 @@ std::pair<system_call_wrapper_error_t, QStringList> CSystemCallWrapper::upload_f
     args << "-P" << ssh_info.first;
 
   args
-      << file_path
+      << scp_local_path(file_path)
       << QString("%1@%2:%3").arg(remote_user, ip, destination_formatted);
   qDebug() << "ARGS=" << args;
 
@@ -540,7 +645,23 @@ std::pair<system_call_wrapper_error_t, QStringList> CSystemCallWrapper::upload_f
 
 std::pair<system_call_wrapper_error_t, QStringList> CSystemCallWrapper::download_file
 (const QString &remote_user, const QString &ip, std::pair<QString, QString> ssh_info,
- const QString &local_destination, const QString &remote_file_path) {
+ const QString &local_destination, const QString &remote_file_path,
+ std::function<void(quint64, quint64)> progress, const QAtomicInt *cancel) {
+  int rc = CSftpTransfer::download(transfer_endpoint(remote_user, ip, ssh_info),
+                                   remote_file_path, local_destination, progress, cancel);
+  bool use_scp = false;
+  system_call_wrapper_error_t sftp_res = sftp_result_to_scwe(rc, use_scp);
+  qDebug() << "sftp download of" << remote_file_path << "finished:"
+           << CLibsshController::run_libssh2_error_to_str((run_libssh2_error_t)rc);
+  if (use_scp && cancel && cancel->load())
+    return std::make_pair(SCWE_CANCELLED, QStringList());
+  if (!use_scp) {
+    QStringList output;
+    if (sftp_res != SCWE_SUCCESS)
+      output << CLibsshController::run_libssh2_error_to_str((run_libssh2_error_t)rc);
+    return std::make_pair(sftp_res, output);
+  }
+
   QString cmd
       = CSettingsManager::Instance().scp_path();
   QStringList args;
@@ -558,7 +679,7 @@ std::pair<system_call_wrapper_error_t, QStringList> CSystemCallWrapper::download
 
   args
        << QString("%1@%2:%3").arg(remote_user, ip, remote_file_path_formatted)
-       << local_destination;
+       << scp_local_path(local_destination);
   qDebug() << "ARGS=" << args;
 
   system_call_res_t res = ssystem_th(cmd, args, true, true, 97);
@@ -653,7 +774,11 @@ system_call_wrapper_error_t CSystemCallWrapper::vagrant_update_peeros(const QStr
 }
 
 QString CSystemCallWrapper::vagrant_status(const QString &dir) {
-  QMutexLocker locker(&vagrant_is_busy);
+  return CVagrantStatusCache::Instance()->status(dir);
+}
+
+QString CSystemCallWrapper::vagrant_status_uncached(const QString &dir, bool *ok) {
+  if (ok != nullptr) *ok = false;
   qDebug() << "get vagrant status of" << dir;
 
   system_call_res_t res;
@@ -679,21 +804,16 @@ QString CSystemCallWrapper::vagrant_status(const QString &dir) {
     return status;
   }
 
-  for (auto s : res.out) {
-    QStringList seperated = s.split(",");
-    if (seperated.contains("state")) {
-      status = seperated.takeLast();
-      qDebug() << "FOUND vagrant status:"
-               << status.simplified();
-      break;
-    }
-  }
-
-  return status.simplified();
+  if (ok != nullptr) *ok = true;
+  status = CVagrantStatusCache::parse_machine_readable_state(res.out);
+  qDebug() << "FOUND vagrant status:"
+           << status;
+  return status;
 }
 
 system_call_wrapper_error_t CSystemCallWrapper::vagrant_halt(const QString &dir) {
-  QMutexLocker locker(&vagrant_is_busy);
+  std::shared_ptr<QMutex> dir_lock = CVagrantStatusCache::Instance()->dir_lock(dir);
+  QMutexLocker locker(dir_lock.get());
   QString cmd = CSettingsManager::Instance().vagrant_path();
   QStringList args;
   args << "set_working_directory"
@@ -703,6 +823,7 @@ system_call_wrapper_error_t CSystemCallWrapper::vagrant_halt(const QString &dir)
   qDebug() << "Starting to halt peer. Args:"
            << args;
   system_call_res_t res = ssystem_th(cmd, args, true, true, 97);
+  CVagrantStatusCache::Instance()->invalidate(dir);
 
   qDebug() << "Halt finished:"
            << dir
@@ -716,7 +837,8 @@ system_call_wrapper_error_t CSystemCallWrapper::vagrant_halt(const QString &dir)
 }
 
 system_call_wrapper_error_t CSystemCallWrapper::vagrant_reload(const QString &dir) {
-  QMutexLocker locker(&vagrant_is_busy);
+  std::shared_ptr<QMutex> dir_lock = CVagrantStatusCache::Instance()->dir_lock(dir);
+  QMutexLocker locker(dir_lock.get());
   QString cmd = CSettingsManager::Instance().vagrant_path();
   QStringList args;
   args
@@ -729,6 +851,7 @@ system_call_wrapper_error_t CSystemCallWrapper::vagrant_reload(const QString &di
           <<args;
 
   system_call_res_t res = ssystem_th(cmd, args, true, true, 97);
+  CVagrantStatusCache::Instance()->invalidate(dir);
 
   qDebug()
           <<"Reload finished:"
@@ -743,7 +866,8 @@ system_call_wrapper_error_t CSystemCallWrapper::vagrant_reload(const QString &di
 }
 
 system_call_wrapper_error_t CSystemCallWrapper::vagrant_destroy(const QString &dir) {
-  QMutexLocker locker(&vagrant_is_busy);
+  std::shared_ptr<QMutex> dir_lock = CVagrantStatusCache::Instance()->dir_lock(dir);
+  QMutexLocker locker(dir_lock.get());
   QString cmd = CSettingsManager::Instance().vagrant_path();
   QStringList args;
   args << "set_working_directory"
@@ -755,6 +879,7 @@ system_call_wrapper_error_t CSystemCallWrapper::vagrant_destroy(const QString &d
            << args;
 
   system_call_res_t res = ssystem_th(cmd, args, true, true, 97);
+  CVagrantStatusCache::Instance()->invalidate(dir);
 
   qDebug() << "Destroying peer finished"
            << "Exit code:"
@@ -778,7 +903,8 @@ system_call_wrapper_error_t CSystemCallWrapper::vagrant_destroy(const QString &d
 }
 
 std::pair<system_call_wrapper_error_t, QStringList> CSystemCallWrapper::vagrant_up(const QString &dir) {
-  QMutexLocker locker(&vagrant_is_busy);
+  std::shared_ptr<QMutex> dir_lock = CVagrantStatusCache::Instance()->dir_lock(dir);
+  QMutexLocker locker(dir_lock.get());
   QString cmd = CSettingsManager::Instance().vagrant_path();
   QStringList args;
   args
@@ -791,6 +917,7 @@ std::pair<system_call_wrapper_error_t, QStringList> CSystemCallWrapper::vagrant_
           <<args;
 
   system_call_res_t res = ssystem_th(cmd, args, true, true, 97);
+  CVagrantStatusCache::Instance()->invalidate(dir);
 
   qDebug()
           <<"Finished vagrant up:"
@@ -906,73 +1033,22 @@ system_call_wrapper_error_t CSystemCallWrapper::set_virtualbox_vm_storage(const
 }
 
 QString CSystemCallWrapper::vagrant_port(const QString &dir) {
-  QString port_or_ip_address = "_CONSOLE_PORT";
-
-  if (VagrantProvider::Instance()->UseIp()) {
-    port_or_ip_address = "_IP_PEER";
-  }
-
-  QDir peer_dir(dir);
-  QString  port = "undefined";
-
-  if (peer_dir.cd(".vagrant")) {
-    QFile file(QString(peer_dir.absolutePath() + QDir::separator() + "generated.yml"));
-    QString file_name = file.fileName();
-
-    if (file.exists()) {
-      if (file.open(QIODevice::ReadWrite)) {
-        QTextStream stream(&file);
-        QString output = QString(stream.readAll());
-        QStringList vagrant_info = output.split("\n", QString::SkipEmptyParts);
-
-        for (auto s : vagrant_info) {
-          QString flag, value;
-          bool reading_value = false;
-          flag = value = "";
-          reading_value = false;
-
-          for (int i=0; i < s.size(); i++) {
-            if (s[i]=='\r') continue;
-            if (reading_value) {
-                value += s[i];
-                continue;
-            }
-            if (s[i] == ':') {
-                flag = value;
-                value = "";
-                continue;
-            }
-            if (s[i] != ' ') {
-                if(value == "" && !flag.isEmpty())
-                    reading_value = true;
-                value+=s[i];
-            }
-          }
-
-          if (flag == port_or_ip_address)
-              port = value;
-          }
-      }
-      file.close();
-    }
-  }
-  return port;
+  // generated.yml is parsed once and kept until it changes
+  vagrant_peer_meta_t meta = CVagrantMetadataCache::Instance().read(dir);
+  QString key = VagrantProvider::Instance()->UseIp() ? "_IP_PEER" : "_CONSOLE_PORT";
+  auto it = meta.values.find(key);
+  return it == meta.values.end() ? QString("undefined") : it.value();
 }
 
 std::pair<QStringList, system_call_res_t> CSystemCallWrapper::vagrant_update_information(bool force_update) {
-  QMutexLocker locker(&vagrant_is_busy);
   qDebug() << "Starting to update information related to peer management";
 
   QStringList bridges = CSystemCallWrapper::list_interfaces(force_update);
 
-  QString cmd = CSettingsManager::Instance().vagrant_path();
-  QStringList args;
-  args << "global-status";
-
-  system_call_res_t global_status = ssystem_th(cmd, args, true, true, 20000);
+  // `vagrant global-status` is run again only when machine index has changed
+  system_call_res_t global_status = CVagrantStatusCache::Instance()->global_status();
 
   qInfo() << "Vagrant global-status"
-          << args
           << "exit code: "
           << global_status.exit_code
           << " res: "
@@ -1526,6 +1602,8 @@ system_call_wrapper_error_t CSystemCallWrapper::join_to_p2p_swarm(
     res.res = SCWE_CREATE_PROCESS;
   }
 
+  if (res.res == SCWE_SUCCESS)
+    CP2PStateTracker::Instance()->swarm_joined(hash);
   return res.res;
 }
 ////////////////////////////////////////////////////////////////////////////
@@ -1539,6 +1617,8 @@ system_call_wrapper_error_t CSystemCallWrapper::leave_p2p_swarm(
        << "-hash" << hash;
   system_call_res_t res =
       ssystem_th(cmd, args, false, true);  // we don't need output. AHAHA // wtf is this????
+  if (res.res == SCWE_SUCCESS)
+    CP2PStateTracker::Instance()->swarm_left(hash);
   return res.res;
 }
 ////////////////////////////////////////////////////////////////////////////
@@ -1639,12 +1719,21 @@ system_call_wrapper_error_t CSystemCallWrapper::restart_p2p_service(
 ////////////////////////////////////////////////////////////////////////////
 
 system_call_wrapper_error_t CSystemCallWrapper::check_container_state(
-    const QString &hash, const QString &ip) {
+    const QString &hash, const QString &ip, unsigned long timeout_msec) {
+  switch (CP2PStateTracker::Instance()->container_state(hash, ip)) {
+    case CP2PStateTracker::CS_CONNECTED:
+      return SCWE_SUCCESS;
+    case CP2PStateTracker::CS_NOT_CONNECTED:
+      return SCWE_CONTAINER_IS_NOT_READY;
+    default:
+      break;  // peer isn't known by REST of daemon, ask it directly
+  }
+
   QString cmd = CSettingsManager::Instance().p2p_path();
   QStringList args;
   args << "show"
        << "-hash" << hash << "-check" << ip;
-  system_call_res_t res = ssystem_th(cmd, args, true, true);
+  system_call_res_t res = ssystem_th(cmd, args, true, true, timeout_msec);
   qDebug()
           <<"container state of hash:"<<hash<<"ip:"<<ip<<"exit code:"<<res.exit_code<<"out:"<<res.out;
   return res.exit_code == 0 ? SCWE_SUCCESS : SCWE_CONTAINER_IS_NOT_READY;
@@ -7844,34 +7933,11 @@ bool CSystemCallWrapper::x2goclient_check() {
 ///
 system_call_wrapper_error_t CSystemCallWrapper::which(const QString &prog,
                                                       QString &path) {
-  static int success_ec = 0;
-  QString cmd(which_cmd());
-  QStringList args;
-  args << prog;
-  system_call_res_t res = ssystem_th(cmd, args, true, true, 5000);
-  qDebug()<<"requested which for"<<prog<<"exit code:"<<res.exit_code
-         <<"result:"<<res.res<<"output:"<<res.out;
-  if(res.exit_code == 1 && cmd == "/usr/bin/which"){ //search in local bin (mac specific)
-      qDebug()<<"search again in local bin";
-      args.clear();
-      args << "/usr/local/bin/" + prog;
-      res = ssystem_th(cmd, args, true, true, 5000);
-      qDebug() << "finished which for"
-               << args
-               << "result : " << res.res
-               << "exit code :" << res.exit_code
-               << "output : " << res.out;
-  }
-  if (res.res != SCWE_SUCCESS) return res.res;
-
-  if (res.exit_code == success_ec && !res.out.empty()) {
-    path = res.out[0];
-    path.replace("\n", "\0");
-    path.replace("\r", "\0");
-    return SCWE_SUCCESS;
-  }
-
-  return SCWE_WHICH_CALL_FAILED;
+  // in-process lookup with cache instead of `which`/`where` process per call
+  QString res = CPathResolver::Instance().resolve(prog);
+  if (res.isEmpty()) return SCWE_WHICH_CALL_FAILED;
+  path = res;
+  return SCWE_SUCCESS;
 }
 ////////////////////////////////////////////////////////////////////////////
 
@@ -8213,8 +8279,10 @@ const QString &CSystemCallWrapper::scwe_error_to_str(
                                 "direcory does not exist",
                                 "directory already exists",
                                 "command failed",
-                                "wrong temp path"};
-  return (err >= 0 && err < SCWE_LAST) ? error_str[err] : unknown;
+                                "wrong temp path",
+                                "cancelled"};
+  static const int count = sizeof(error_str) / sizeof(error_str[0]);
+  return (err >= 0 && err < count) ? error_str[err] : unknown;
 }
 ////////////////////////////////////////////////////////////////////////////
 
@@ -0,0 +1,316 @@
+#include <QCoreApplication>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QMutexLocker>
+#include <QtConcurrent/QtConcurrentRun>
+
+#include "TransferScheduler.h"
+
+const int CTransferScheduler::DEFAULT_MAX_WORKERS;
+const int CTransferScheduler::DEFAULT_MAX_PER_GROUP;
+const quint64 CTransferScheduler::SMALL_FILE_SIZE;
+const int CTransferScheduler::MAX_BATCH_COUNT;
+const quint64 CTransferScheduler::MAX_BATCH_SIZE;
+const int CTransferScheduler::PROGRESS_INTERVAL_MS;
+
+CTransferScheduler::CTransferScheduler(int max_workers,
+                                       int max_per_group,
+                                       QObject *parent) :
+  QObject(parent),
+  m_max_per_group(max_per_group > 0 ? max_per_group : 1),
+  m_max_workers(max_workers > 0 ? max_workers : 1),
+  m_busy_workers(0),
+  m_last_id(0),
+  m_closed(false) {
+  m_pool.setMaxThreadCount(m_max_workers);
+}
+
+CTransferScheduler::~CTransferScheduler() {
+  cancel_all();
+  m_pool.waitForDone();
+}
+////////////////////////////////////////////////////////////////////////////
+
+CTransferScheduler*
+CTransferScheduler::Instance() {
+  static CTransferScheduler* inst = []() {
+    CTransferScheduler* scheduler = new CTransferScheduler;
+    // job_finished comes in thread of scheduler, dialogs update rows there
+    if (QCoreApplication::instance() != nullptr)
+      scheduler->moveToThread(QCoreApplication::instance()->thread());
+    return scheduler;
+  }();
+  return inst;
+}
+////////////////////////////////////////////////////////////////////////////
+
+CTransferScheduler::job_id_t
+CTransferScheduler::enqueue(const QString &group,
+                            quint64 size,
+                            int priority,
+                            job_t job) {
+  job_ptr_t rec = std::make_shared<job_rec_t>();
+  rec->group = group;
+  rec->size = size;
+  rec->priority = priority;
+  rec->job = job;
+  rec->state.store(JS_QUEUED);
+  rec->cancel.store(0);
+  {
+    QMutexLocker locker(&m_mutex);
+    rec->id = ++m_last_id;
+    group_queue_t& queue = m_queues[group];
+    if (queue.empty()) m_turns.push_back(group);
+    queue[queue_key(*rec)] = rec;
+    m_jobs[rec->id] = rec;
+  }
+  dispatch();
+  return rec->id;
+}
+////////////////////////////////////////////////////////////////////////////
+
+bool
+CTransferScheduler::cancel(job_id_t id) {
+  job_ptr_t rec;
+  {
+    QMutexLocker locker(&m_mutex);
+    auto job = m_jobs.find(id);
+    if (job == m_jobs.end()) return false;
+    rec = job->second;
+    if (!rec->state.testAndSetOrdered(JS_QUEUED, JS_CANCELLED)) {
+      // running job stops at its next check
+      rec->cancel.store(1);
+      return false;
+    }
+
+    auto queue = m_queues.find(rec->group);
+    if (queue == m_queues.end() || queue->second.erase(queue_key(*rec)) == 0)
+      return true; // it's in batch of worker, worker reports it
+    if (queue->second.empty()) {
+      m_queues.erase(queue);
+      for (auto i = m_turns.begin(); i != m_turns.end(); ++i) {
+        if (*i != rec->group) continue;
+        m_turns.erase(i);
+        break;
+      }
+    }
+    m_jobs.erase(id);
+  }
+  emit job_finished(id, (int)SCWE_CANCELLED, QStringList());
+  return true;
+}
+////////////////////////////////////////////////////////////////////////////
+
+int
+CTransferScheduler::cancel_all() {
+  std::vector<job_id_t> ids;
+  {
+    QMutexLocker locker(&m_mutex);
+    for (auto i = m_jobs.begin(); i != m_jobs.end(); ++i)
+      ids.push_back(i->first);
+  }
+  int count = 0;
+  for (auto i = ids.begin(); i != ids.end(); ++i)
+    if (cancel(*i)) ++count;
+  return count;
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CTransferScheduler::close() {
+  setParent(nullptr);
+  disconnect();
+  cancel_all();
+  QMutexLocker locker(&m_mutex);
+  m_closed = true;
+  if (m_busy_workers == 0) deleteLater();
+}
+////////////////////////////////////////////////////////////////////////////
+
+bool
+CTransferScheduler::set_priority(job_id_t id,
+                                 int priority) {
+  QMutexLocker locker(&m_mutex);
+  auto job = m_jobs.find(id);
+  if (job == m_jobs.end()) return false;
+  job_ptr_t rec = job->second;
+  auto queue = m_queues.find(rec->group);
+  if (queue == m_queues.end() || queue->second.erase(queue_key(*rec)) == 0)
+    return false;
+  rec->priority = priority;
+  queue->second[queue_key(*rec)] = rec;
+  return true;
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CTransferScheduler::set_max_workers(int max_workers) {
+  {
+    QMutexLocker locker(&m_mutex);
+    m_max_workers = max_workers > 0 ? max_workers : 1;
+    m_pool.setMaxThreadCount(m_max_workers);
+  }
+  dispatch();
+}
+////////////////////////////////////////////////////////////////////////////
+
+int
+CTransferScheduler::max_workers() const {
+  QMutexLocker locker(&m_mutex);
+  return m_max_workers;
+}
+////////////////////////////////////////////////////////////////////////////
+
+int
+CTransferScheduler::queued_count() const {
+  QMutexLocker locker(&m_mutex);
+  return queued_count_locked();
+}
+////////////////////////////////////////////////////////////////////////////
+
+int
+CTransferScheduler::running_count() const {
+  QMutexLocker locker(&m_mutex);
+  return (int)m_jobs.size() - queued_count_locked();
+}
+////////////////////////////////////////////////////////////////////////////
+
+int
+CTransferScheduler::queued_count_locked() const {
+  int res = 0;
+  for (auto i = m_queues.begin(); i != m_queues.end(); ++i)
+    res += (int)i->second.size();
+  return res;
+}
+////////////////////////////////////////////////////////////////////////////
+
+int
+CTransferScheduler::running_in_group(const QString &group) const {
+  auto running = m_running_groups.find(group);
+  return running == m_running_groups.end() ? 0 : running->second;
+}
+////////////////////////////////////////////////////////////////////////////
+
+std::vector<CTransferScheduler::job_ptr_t>
+CTransferScheduler::take_next() {
+  std::vector<job_ptr_t> batch;
+  bool found = false;
+  int best = 0;
+  for (auto i = m_turns.begin(); i != m_turns.end(); ++i) {
+    if (running_in_group(*i) >= m_max_per_group) continue;
+    int priority = m_queues[*i].begin()->second->priority;
+    if (!found || priority > best) best = priority;
+    found = true;
+  }
+  if (!found) return batch;
+
+  for (auto turn = m_turns.begin(); turn != m_turns.end(); ++turn) {
+    QString group = *turn;
+    group_queue_t& queue = m_queues[group];
+    if (running_in_group(group) >= m_max_per_group ||
+        queue.begin()->second->priority != best)
+      continue;
+
+    job_ptr_t first = queue.begin()->second;
+    queue.erase(queue.begin());
+    batch.push_back(first);
+    if (first->size <= SMALL_FILE_SIZE) {
+      quint64 batch_size = first->size;
+      while (!queue.empty() && (int)batch.size() < MAX_BATCH_COUNT) {
+        job_ptr_t next = queue.begin()->second;
+        if (next->priority != best || next->size > SMALL_FILE_SIZE ||
+            batch_size + next->size > MAX_BATCH_SIZE)
+          break;
+        batch_size += next->size;
+        batch.push_back(next);
+        queue.erase(queue.begin());
+      }
+    }
+
+    // group waits for its next turn behind others
+    m_turns.erase(turn);
+    if (queue.empty()) m_queues.erase(group);
+    else m_turns.push_back(group);
+    break;
+  }
+  return batch;
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CTransferScheduler::dispatch() {
+  std::vector<std::vector<job_ptr_t> > batches;
+  {
+    QMutexLocker locker(&m_mutex);
+    while (!m_closed && m_busy_workers < m_max_workers) {
+      std::vector<job_ptr_t> batch = take_next();
+      if (batch.empty()) break;
+      ++m_busy_workers;
+      ++m_running_groups[batch.front()->group];
+      batches.push_back(batch);
+    }
+  }
+  for (auto i = batches.begin(); i != batches.end(); ++i)
+    run_batch(*i);
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CTransferScheduler::run_batch(const std::vector<job_ptr_t> &batch) {
+  QtConcurrent::run(&m_pool, [this, batch]() {
+    for (size_t i = 0; i < batch.size(); ++i) {
+      job_ptr_t rec = batch[i];
+      result_t res = std::make_pair(SCWE_CANCELLED, QStringList());
+      if (rec->state.testAndSetOrdered(JS_QUEUED, JS_RUNNING)) {
+        emit job_started(rec->id);
+        QElapsedTimer timer;
+        timer.start();
+        qint64 last_report = -PROGRESS_INTERVAL_MS;
+        job_id_t id = rec->id;
+        res = rec->job([this, id, &timer, &last_report](quint64 done, quint64 total) {
+          qint64 elapsed = timer.elapsed();
+          if (done < total && elapsed - last_report < PROGRESS_INTERVAL_MS)
+            return;
+          last_report = elapsed;
+          quint64 bytes_per_sec = elapsed > 0 ? done * 1000 / (quint64)elapsed : 0;
+          emit job_progress(id, done, total, bytes_per_sec);
+        }, &rec->cancel);
+      }
+      QMetaObject::invokeMethod(this, "job_finished_sl", Qt::QueuedConnection,
+                                Q_ARG(quint64, rec->id), Q_ARG(int, (int)res.first),
+                                Q_ARG(QStringList, res.second),
+                                Q_ARG(bool, i + 1 == batch.size()));
+    }
+  });
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CTransferScheduler::job_finished_sl(quint64 id,
+                                    int res,
+                                    QStringList output,
+                                    bool last_in_batch) {
+  {
+    QMutexLocker locker(&m_mutex);
+    auto job = m_jobs.find(id);
+    if (job != m_jobs.end()) {
+      if (last_in_batch) {
+        --m_busy_workers;
+        if (--m_running_groups[job->second->group] <= 0)
+          m_running_groups.erase(job->second->group);
+      }
+      m_jobs.erase(job);
+    }
+  }
+  emit job_finished(id, res, output);
+  if (!last_in_batch) return;
+  {
+    QMutexLocker locker(&m_mutex);
+    if (m_closed) {
+      if (m_busy_workers == 0) deleteLater();
+      return;
+    }
+  }
+  dispatch();
+}
+////////////////////////////////////////////////////////////////////////////
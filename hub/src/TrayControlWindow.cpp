@@ -107,6 +107,12 @@ TrayControlWindow::TrayControlWindow(QWidget *parent)
           &TrayControlWindow::user_name_updated_sl);
   connect(&CHubController::Instance(), &CHubController::balance_updated, this,
           &TrayControlWindow::balance_updated_sl);
+  connect(&CHubController::Instance(), &CHubController::environment_added,
+          this, &TrayControlWindow::environment_added_sl);
+  connect(&CHubController::Instance(), &CHubController::environment_changed,
+          this, &TrayControlWindow::environment_changed_sl);
+  connect(&CHubController::Instance(), &CHubController::environment_removed,
+          this, &TrayControlWindow::environment_removed_sl);
   connect(&CHubController::Instance(), &CHubController::environments_updated,
           this, &TrayControlWindow::environments_updated_sl);
   connect(&CHubController::Instance(), &CHubController::my_peers_updated, this,
@@ -223,11 +229,9 @@ void TrayControlWindow::create_tray_actions() {
   m_act_hub =
       new QAction(QIcon(":/hub/environments-new.png"), tr("Environments"), this);
 
-  QString user_name = "";
-  CRestWorker::Instance()->get_user_info("name", user_name);
-
   m_act_user_name =
-      new QAction(QIcon(":/hub/user-new.png"), user_name.toStdString().c_str(), this);
+      new QAction(QIcon(":/hub/user-new.png"), "", this);
+  user_name_updated_sl();
   connect(m_act_user_name, &QAction::triggered,
             [] { CHubController::Instance().launch_balance_page(); });
   m_act_user_name->setToolTip(tr("Name"));
@@ -516,13 +520,13 @@ void TrayControlWindow::logout() {
   CHubController::Instance().logout();
   this->m_sys_tray_icon->hide();
   CSettingsManager::Instance().set_remember_me(false);
-  DlgLogin dlg;
-  connect(&dlg, &DlgLogin::login_success, this,
+  DlgLogin* dlg = new DlgLogin;
+  dlg->setAttribute(Qt::WA_DeleteOnClose);
+  connect(dlg, &DlgLogin::login_success, this,
           &TrayControlWindow::login_success);
-  dlg.setModal(true);
-  if (dlg.exec() != QDialog::Accepted) {
-    qApp->exit(0);
-  }
+  connect(dlg, &QDialog::rejected, qApp, &QCoreApplication::quit);
+  dlg->setModal(true);
+  dlg->show();
 }
 ////////////////////////////////////////////////////////////////////////////
 
@@ -711,9 +715,10 @@ void TrayControlWindow::launch_p2p_installation() {
 //////////////////////////////////////
 
 void TrayControlWindow::user_name_updated_sl() {
-  QString user_name = "";
-  CRestWorker::Instance()->get_user_info("name", user_name);
-  m_act_user_name->setText(user_name);
+  CRestWorker::Instance()->get_user_info_async("name", this,
+                                               [this](bool, const QString& user_name) {
+    m_act_user_name->setText(user_name);
+  });
 }
 
 ////////////////////////////////////////////////////////////////////////////
@@ -724,92 +729,123 @@ void TrayControlWindow::balance_updated_sl() {
 
 ////////////////////////////////////////////////////////////////////////////
 
-void TrayControlWindow::environments_updated_sl(int rr) {
-  qDebug() << "Updating Environment List"
-           << "Result: " << rr;
+void TrayControlWindow::environment_added_sl(const CEnvironment &env) {
+  update_environment_action(env);
+}
+////////////////////////////////////////////////////////////////////////////
+
+void TrayControlWindow::environment_changed_sl(const CEnvironment &prev,
+                                               const CEnvironment &env) {
+  UNUSED_ARG(prev);
+  update_environment_action(env);
+}
+////////////////////////////////////////////////////////////////////////////
+
+void TrayControlWindow::environment_removed_sl(const CEnvironment &env) {
+  static QString deteted_string("DELETED");
+  QString env_id = env.id();
+  auto table_it = environments_table.find(env_id);
+  if (table_it != environments_table.end())
+    table_it->second.set_status(deteted_string);
+
+  auto button_it = my_envs_button_table.find(env_id);
+  if (button_it == my_envs_button_table.end()) return;
 
   m_hub_menu->setEnabled(false); // MacOS Qt bug.
+  m_hub_menu->removeAction(button_it->second);
+  if (m_hub_menu->isEmpty())
+    m_hub_menu->addAction(m_empty_action);
+  my_envs_button_table.erase(button_it);
+  m_hub_menu->setEnabled(true);
+}
+////////////////////////////////////////////////////////////////////////////
 
+void TrayControlWindow::update_environment_action(const CEnvironment &env) {
   static QIcon unhealthy_icon(":/hub/BAD.png");
   static QIcon healthy_icon(":/hub/GOOD.png");
   static QIcon modification_icon(":/hub/OK.png");
-  static QString deteted_string("DELETED");
-  static std::vector<QString> lst_checked_unhealthy_env;
 
-  std::map<QString, std::vector<QString> > tbl_envs;
-  std::map<QString, std::vector<int> > tbl_env_ids;
-  std::map<QString, int> new_envs;
-
-  for (auto env = CHubController::Instance().lst_environments().cbegin();
-       env != CHubController::Instance().lst_environments().cend(); ++env) {
-    QString env_id = env->id();
-    environments_table[env_id] = *env;
-    QString env_name = env->name();
-    //mark that env still exist
-    new_envs[env_name] = 1;
-    //update action button, create if does not exist
-    QAction *env_start;
-    if(my_envs_button_table.find(env_id) == my_envs_button_table.end()){
-        env_start = new QAction;
-        m_hub_menu->addAction(env_start);
-        m_hub_menu->removeAction(m_empty_action);
-        connect(env_start, &QAction::triggered, [env_id, this]() {
-          if(environments_table.find(env_id) == environments_table.end()){
-            CNotificationObserver::Instance()->Error(tr("This environment credentials does not exist. "
-                                                        "Please restart Control Center to refresh menu."),
-                                                     DlgNotification::N_NO_ACTION);
-            return;
-          }
-          CEnvironment env = environments_table[env_id];
-          this->generate_env_dlg(&env);
-          TrayControlWindow::show_dialog(TrayControlWindow::last_generated_env_dlg,
-                                         QString("Environment \"%1\" (%2)")
-                                             .arg(env.name())
-                                             .arg(env.status()));
-        });
-        my_envs_button_table[env_id] = env_start;
-    }
-    else{
-        env_start = my_envs_button_table[env_id];
+  m_hub_menu->setEnabled(false); // MacOS Qt bug.
+
+  QString env_id = env.id();
+  environments_table[env_id] = env;
+  QString env_name = env.name();
+  //update action button, create if does not exist
+  QAction *env_start;
+  if(my_envs_button_table.find(env_id) == my_envs_button_table.end()){
+      env_start = new QAction;
+      m_hub_menu->addAction(env_start);
+      m_hub_menu->removeAction(m_empty_action);
+      connect(env_start, &QAction::triggered, [env_id, this]() {
+        if(environments_table.find(env_id) == environments_table.end()){
+          CNotificationObserver::Instance()->Error(tr("This environment credentials does not exist. "
+                                                      "Please restart Control Center to refresh menu."),
+                                                   DlgNotification::N_NO_ACTION);
+          return;
+        }
+        CEnvironment env = environments_table[env_id];
+        this->generate_env_dlg(&env);
+        TrayControlWindow::show_dialog(TrayControlWindow::last_generated_env_dlg,
+                                       QString("Environment \"%1\" (%2)")
+                                           .arg(env.name())
+                                           .arg(env.status()));
+      });
+      my_envs_button_table[env_id] = env_start;
+  }
+  else{
+      env_start = my_envs_button_table[env_id];
+  }
+  env_start->setEnabled(false); // MacOS Qt bug.
+  env_start->setEnabled(true);
+  env_start->setText(env_name);
+  env_start->setIcon(env.status() == "HEALTHY"
+                         ? healthy_icon
+                         : env.status() == "UNHEALTHY" ? unhealthy_icon
+                                                       : modification_icon);
+  //mark envs that changed their status
+  std::vector<QString>::iterator iter_found =
+      std::find(m_lst_checked_unhealthy_env.begin(),
+                m_lst_checked_unhealthy_env.end(), env.id());
+
+  if (!env.healthy()) {
+    if (iter_found == m_lst_checked_unhealthy_env.end()) {
+      m_lst_checked_unhealthy_env.push_back(env.id());
+      m_tbl_unhealthy_envs[env.status()].push_back(env_name);
+      m_tbl_unhealthy_env_ids[env.status()].push_back(env.hub_id());
+      qCritical("Environment %s, %s is unhealthy. Reason : %s",
+                env_name.toStdString().c_str(),
+                env.id().toStdString().c_str(),
+                env.status_description().toStdString().c_str());
     }
-    env_start->setEnabled(false); // MacOS Qt bug.
-    env_start->setEnabled(true);
-    env_start->setText(env_name);
-    env_start->setIcon(env->status() == "HEALTHY"
-                           ? healthy_icon
-                           : env->status() == "UNHEALTHY" ? unhealthy_icon
-                                                          : modification_icon);
-    //mark envs that changed their status
-    std::vector<QString>::iterator iter_found =
-        std::find(lst_checked_unhealthy_env.begin(),
-                  lst_checked_unhealthy_env.end(), env->id());
-
-    if (!env->healthy()) {
-      if (iter_found == lst_checked_unhealthy_env.end()) {
-        lst_checked_unhealthy_env.push_back(env->id());
-        tbl_envs[env->status()].push_back(env_name);
-        tbl_env_ids[env->status()].push_back(env->hub_id());
-        qCritical("Environment %s, %s is unhealthy. Reason : %s",
-                  env_name.toStdString().c_str(),
-                  env->id().toStdString().c_str(),
-                  env->status_description().toStdString().c_str());
-      }
-    } else {
-      if (iter_found != lst_checked_unhealthy_env.end()) {
-        QString env_url = hub_billing_url()
-            .arg(CHubController::Instance().current_user_id()) +
-            QString("/environments/%1").arg(env->hub_id());
-        CNotificationObserver::Info(
-            tr("Environment <a href=%1>%2</a> became healthy")
-              .arg(env_url, env->name()),
-            DlgNotification::N_NO_ACTION);
-        qInfo("Environment %s became healthy",
-              env->name().toStdString().c_str());
-        lst_checked_unhealthy_env.erase(iter_found);
-      }
-      qInfo("Environment %s is healthy", env->name().toStdString().c_str());
+  } else {
+    if (iter_found != m_lst_checked_unhealthy_env.end()) {
+      QString env_url = hub_billing_url()
+          .arg(CHubController::Instance().current_user_id()) +
+          QString("/environments/%1").arg(env.hub_id());
+      CNotificationObserver::Info(
+          tr("Environment <a href=%1>%2</a> became healthy")
+            .arg(env_url, env.name()),
+          DlgNotification::N_NO_ACTION);
+      qInfo("Environment %s became healthy",
+            env.name().toStdString().c_str());
+      m_lst_checked_unhealthy_env.erase(iter_found);
     }
+    qInfo("Environment %s is healthy", env.name().toStdString().c_str());
   }
+
+  m_hub_menu->setEnabled(true);
+}
+////////////////////////////////////////////////////////////////////////////
+
+void TrayControlWindow::environments_updated_sl(int rr) {
+  qDebug() << "Updating Environment List"
+           << "Result: " << rr;
+
+  std::map<QString, std::vector<QString> > tbl_envs;
+  std::map<QString, std::vector<int> > tbl_env_ids;
+  tbl_envs.swap(m_tbl_unhealthy_envs);
+  tbl_env_ids.swap(m_tbl_unhealthy_env_ids);
+
 // show notification about environment changed their status
   for (std::map<QString, std::vector<QString> >::iterator it = tbl_envs.begin();
        it != tbl_envs.end(); it++) {
@@ -833,21 +869,6 @@ void TrayControlWindow::environments_updated_sl(int rr) {
                                               DlgNotification::N_NO_ACTION);
     }
   }
-// mark deleted environments
-  for (std::map<QString, CEnvironment>::iterator it =
-           environments_table.begin();
-       it != environments_table.end(); it++) {
-    if (new_envs[it->second.name()] == 0){
-        it->second.set_status(deteted_string);
-        if(my_envs_button_table.find(it->second.id()) == my_envs_button_table.end()) continue;
-        m_hub_menu->removeAction(my_envs_button_table[it->second.id()]);
-        if(m_hub_menu->isEmpty())
-            m_hub_menu->addAction(m_empty_action);
-        my_envs_button_table.erase(my_envs_button_table.find(it->second.id()));
-    }
-  }
-
-  m_hub_menu->setEnabled(true);
 }
 
 ////////////////////////////////////////////////////////////////////////////
@@ -953,11 +974,6 @@ void TrayControlWindow::got_peer_info_sl(CPeerController::peer_info_t type, QStr
     in_peer_slot = false;
     return;
   }
-  if (CPeerController::Instance()->get_number_threads() <= 0) {
-    in_peer_slot = false;
-    return;
-  }
-  CPeerController::Instance()->dec_number_threads();
   CLocalPeer updater_peer;
   if (machine_peers_table.find(name) != machine_peers_table.end())
     updater_peer = machine_peers_table[name];
@@ -1004,9 +1020,6 @@ void TrayControlWindow::got_peer_info_sl(CPeerController::peer_info_t type, QStr
   } else {
     update_peer_button(updater_peer.name(), updater_peer);
   }
-  if (CPeerController::Instance()->get_number_threads() == 0) {
-    machine_peers_upd_finished();
-  }
   in_peer_slot = false;
 }
 
@@ -1062,7 +1075,7 @@ void TrayControlWindow::peer_update_peeros_sl(const QString peer_fingerprint) {
     return;
   }
   my_peer_button *peer_instance = my_peers_button_table[peer_fingerprint];
-  QString peer_name, peer_port, local_peer_name;
+  QString peer_name, peer_port, peer_dir, local_peer_name;
   if (peer_instance->m_local_peer != nullptr){
     if (peer_instance->m_local_peer->update_available() == "updating") {
       qCritical() << "tried to update updating peer: " << peer_fingerprint;
@@ -1070,6 +1083,7 @@ void TrayControlWindow::peer_update_peeros_sl(const QString peer_fingerprint) {
     }
     local_peer_name = peer_name = peer_instance->m_local_peer->name();
     peer_port = peer_instance->m_local_peer->ip();
+    peer_dir = peer_instance->m_local_peer->dir();
   } else {
     qCritical() << "tried to update deleted peer: " << peer_fingerprint;
     return;
@@ -1078,7 +1092,7 @@ void TrayControlWindow::peer_update_peeros_sl(const QString peer_fingerprint) {
     peer_name = peer_instance->m_hub_peer->name();
   }
   UpdatePeerOS *peer_updater = new UpdatePeerOS(this);
-  peer_updater->init(peer_name, peer_port);
+  peer_updater->init(peer_name, peer_port, peer_dir);
   connect(peer_updater, &UpdatePeerOS::outputReceived,
           [this, local_peer_name, finished_str](system_call_wrapper_error_t res){
     if (res == SCWE_SUCCESS) {
@@ -0,0 +1,368 @@
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QProcessEnvironment>
+#include <QStandardPaths>
+#include <QThread>
+
+#include "SettingsManager.h"
+#include "VagrantStatusCache.h"
+
+const int CVagrantStatusCache::MAX_AGE_MS;
+
+CVagrantStatusCache::CVagrantStatusCache(status_probe_t status_probe,
+                                         global_probe_t global_probe,
+                                         const QString &machine_index_dir,
+                                         QObject *parent) :
+  QObject(parent),
+  m_status_probe(status_probe),
+  m_global_probe(global_probe),
+  m_machine_index_dir(machine_index_dir.isEmpty() ? QString() : key_of(machine_index_dir)),
+  m_watcher(this),
+  m_probes_count(0) {
+  connect(&m_watcher, &QFileSystemWatcher::directoryChanged,
+          this, &CVagrantStatusCache::path_changed_sl);
+  connect(&m_watcher, &QFileSystemWatcher::fileChanged,
+          this, &CVagrantStatusCache::path_changed_sl);
+}
+////////////////////////////////////////////////////////////////////////////
+
+CVagrantStatusCache*
+CVagrantStatusCache::Instance() {
+  static CVagrantStatusCache* inst = []() {
+    CVagrantStatusCache* cache = new CVagrantStatusCache(
+          [](const QString& dir, QString& status) {
+      bool ok = false;
+      status = CSystemCallWrapper::vagrant_status_uncached(dir, &ok);
+      return ok;
+    },
+          []() {
+      return CSystemCallWrapper::ssystem_th(CSettingsManager::Instance().vagrant_path(),
+                                            QStringList() << "global-status",
+                                            true, true, 20000);
+    },
+          default_machine_index_dir());
+    // first call comes from pool thread, watcher must live in main thread
+    if (QCoreApplication::instance() != nullptr)
+      cache->moveToThread(QCoreApplication::instance()->thread());
+    return cache;
+  }();
+  return inst;
+}
+////////////////////////////////////////////////////////////////////////////
+
+QString
+CVagrantStatusCache::status(const QString &dir) {
+  QString key = key_of(dir);
+  {
+    QMutexLocker locker(&m_mutex);
+    auto i = m_entries.find(key);
+    if (i != m_entries.end() && fresh_locked(i->second))
+      return i->second.status;
+  }
+
+  std::shared_ptr<QMutex> lock = dir_lock(key);
+  QMutexLocker dir_locker(lock.get());
+  quint64 generation;
+  {
+    QMutexLocker locker(&m_mutex);
+    entry_t& et = m_entries[key];
+    // other thread has got it while we waited for lock
+    if (fresh_locked(et)) return et.status;
+    generation = et.generation;
+    ++m_probes_count;
+  }
+
+  request_watch(key);
+  QString res;
+  bool ok = m_status_probe(dir, res);
+  QString stamp = stamp_of(paths_to_watch(key));
+
+  QMutexLocker locker(&m_mutex);
+  entry_t& et = m_entries[key];
+  if (ok && et.generation == generation) {
+    et.status = res;
+    et.stamp = stamp;
+    et.valid = true;
+    et.age.start();
+  }
+  return res;
+}
+////////////////////////////////////////////////////////////////////////////
+
+system_call_res_t
+CVagrantStatusCache::global_status() {
+  if (m_machine_index_dir.isEmpty()) {
+    QMutexLocker locker(&m_mutex);
+    ++m_probes_count;
+    locker.unlock();
+    return m_global_probe();
+  }
+
+  {
+    QMutexLocker locker(&m_mutex);
+    if (fresh_locked(m_global)) return m_global_res;
+  }
+
+  QMutexLocker probe_locker(&m_global_probe_mutex);
+  quint64 generation;
+  {
+    QMutexLocker locker(&m_mutex);
+    if (fresh_locked(m_global)) return m_global_res;
+    generation = m_global.generation;
+    ++m_probes_count;
+  }
+
+  if (QThread::currentThread() == thread())
+    watch_global_sl();
+  else
+    QMetaObject::invokeMethod(this, "watch_global_sl", Qt::QueuedConnection);
+
+  system_call_res_t res = m_global_probe();
+  QString stamp = stamp_of(QStringList() << m_machine_index_dir + "/index");
+
+  QMutexLocker locker(&m_mutex);
+  // failed call isn't cached, there is nothing on disk which tells it was fixed
+  if (m_global.generation == generation &&
+      res.res == SCWE_SUCCESS && res.exit_code == 0) {
+    m_global_res = res;
+    m_global.stamp = stamp;
+    m_global.valid = true;
+    m_global.age.start();
+  }
+  return res;
+}
+////////////////////////////////////////////////////////////////////////////
+
+bool
+CVagrantStatusCache::is_cached(const QString &dir) const {
+  QMutexLocker locker(&m_mutex);
+  auto i = m_entries.find(key_of(dir));
+  return i != m_entries.end() && fresh_locked(i->second);
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CVagrantStatusCache::invalidate(const QString &dir) {
+  QMutexLocker locker(&m_mutex);
+  invalidate_locked(m_entries[key_of(dir)]);
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CVagrantStatusCache::clear() {
+  QMutexLocker locker(&m_mutex);
+  for (auto i = m_entries.begin(); i != m_entries.end(); ++i)
+    invalidate_locked(i->second);
+  invalidate_locked(m_global);
+}
+////////////////////////////////////////////////////////////////////////////
+
+std::shared_ptr<QMutex>
+CVagrantStatusCache::dir_lock(const QString &dir) {
+  QMutexLocker locker(&m_mutex);
+  std::shared_ptr<QMutex>& res = m_dir_locks[key_of(dir)];
+  if (!res) res = std::make_shared<QMutex>();
+  return res;
+}
+////////////////////////////////////////////////////////////////////////////
+
+quint64
+CVagrantStatusCache::probes_count() const {
+  QMutexLocker locker(&m_mutex);
+  return m_probes_count;
+}
+////////////////////////////////////////////////////////////////////////////
+
+QString
+CVagrantStatusCache::parse_machine_readable_state(const QStringList &out) {
+  QString status("not_created");
+  for (auto s : out) {
+    QStringList seperated = s.split(",");
+    if (seperated.contains("state")) {
+      status = seperated.takeLast();
+      break;
+    }
+  }
+  return status.simplified();
+}
+////////////////////////////////////////////////////////////////////////////
+
+QString
+CVagrantStatusCache::default_machine_index_dir() {
+  QString home = QProcessEnvironment::systemEnvironment().value("VAGRANT_HOME");
+  if (home.isEmpty()) {
+    QStringList lst_home = QStandardPaths::standardLocations(QStandardPaths::HomeLocation);
+    if (lst_home.isEmpty()) return QString();
+    home = lst_home[0] + QDir::separator() + ".vagrant.d";
+  }
+  return home + QDir::separator() + "data" + QDir::separator() + "machine-index";
+}
+////////////////////////////////////////////////////////////////////////////
+
+QString
+CVagrantStatusCache::key_of(const QString &dir) {
+  return QDir::cleanPath(QFileInfo(dir).absoluteFilePath());
+}
+////////////////////////////////////////////////////////////////////////////
+
+QStringList
+CVagrantStatusCache::paths_to_watch(const QString &dir) {
+  // peer dir has `*_finished` markers, .vagrant has provision_step,
+  // machines/<name>/<provider> has state files of vagrant
+  QStringList res;
+  res << dir;
+  QDir vagrant_dir(dir + "/.vagrant");
+  if (!vagrant_dir.exists()) return res;
+  res << vagrant_dir.absolutePath();
+  if (vagrant_dir.exists("provision_step"))
+    res << vagrant_dir.absoluteFilePath("provision_step");
+
+  QDir machines_dir(vagrant_dir.absoluteFilePath("machines"));
+  if (!machines_dir.exists()) return res;
+  res << machines_dir.absolutePath();
+  QFileInfoList machines = machines_dir.entryInfoList(QDir::Dirs | QDir::NoDotAndDotDot);
+  for (auto i = machines.begin(); i != machines.end(); ++i) {
+    res << i->absoluteFilePath();
+    QFileInfoList providers =
+        QDir(i->absoluteFilePath()).entryInfoList(QDir::Dirs | QDir::NoDotAndDotDot);
+    for (auto j = providers.begin(); j != providers.end(); ++j) {
+      res << j->absoluteFilePath();
+      QFileInfoList files = QDir(j->absoluteFilePath()).entryInfoList(QDir::Files);
+      for (auto k = files.begin(); k != files.end(); ++k) {
+        if (k->fileName().endsWith(".lock")) continue;
+        res << k->absoluteFilePath();
+      }
+    }
+  }
+  return res;
+}
+////////////////////////////////////////////////////////////////////////////
+
+QString
+CVagrantStatusCache::stamp_of(const QStringList &paths) {
+  QString res;
+  for (auto i = paths.begin(); i != paths.end(); ++i) {
+    QFileInfo fi(*i);
+    res += *i;
+    if (!fi.exists()) {
+      res += "|-\n";
+    } else if (fi.isDir()) {
+      // names only, mtime of directory is changed by lock files too
+      QStringList names = QDir(*i).entryList(QDir::AllEntries | QDir::NoDotAndDotDot,
+                                             QDir::Name);
+      for (auto j = names.begin(); j != names.end(); ++j) {
+        if (j->endsWith(".lock")) continue;
+        res += "|" + *j;
+      }
+      res += "\n";
+    } else {
+      res += QString("|%1|%2\n").arg(fi.size()).arg(fi.lastModified().toMSecsSinceEpoch());
+    }
+  }
+  return res;
+}
+////////////////////////////////////////////////////////////////////////////
+
+bool
+CVagrantStatusCache::fresh_locked(const entry_t &et) const {
+  return et.valid && et.age.elapsed() < MAX_AGE_MS;
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CVagrantStatusCache::request_watch(const QString &key) {
+  if (QThread::currentThread() == thread())
+    watch_sl(key);
+  else
+    QMetaObject::invokeMethod(this, "watch_sl", Qt::QueuedConnection,
+                              Q_ARG(QString, key));
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CVagrantStatusCache::invalidate_locked(entry_t &et) {
+  et.valid = false;
+  ++et.generation;
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CVagrantStatusCache::watch_sl(const QString &key) {
+  QStringList paths = paths_to_watch(key);
+  {
+    QMutexLocker locker(&m_mutex);
+    for (auto i = paths.begin(); i != paths.end(); ++i)
+      m_path_to_dirs[*i].insert(key);
+  }
+
+  QStringList watched = m_watcher.directories() + m_watcher.files();
+  QStringList to_add;
+  for (auto i = paths.begin(); i != paths.end(); ++i) {
+    if (!watched.contains(*i)) to_add << *i;
+  }
+  if (!to_add.isEmpty()) m_watcher.addPaths(to_add);
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CVagrantStatusCache::watch_global_sl() {
+  QStringList paths;
+  paths << m_machine_index_dir;
+  if (QFileInfo::exists(m_machine_index_dir + "/index"))
+    paths << m_machine_index_dir + "/index";
+  {
+    QMutexLocker locker(&m_mutex);
+    for (auto i = paths.begin(); i != paths.end(); ++i)
+      m_path_to_dirs[*i].insert(QString());  // empty key is global-status
+  }
+
+  QStringList watched = m_watcher.directories() + m_watcher.files();
+  for (auto i = paths.begin(); i != paths.end(); ++i) {
+    if (!watched.contains(*i) && QFileInfo::exists(*i)) m_watcher.addPath(*i);
+  }
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CVagrantStatusCache::path_changed_sl(const QString &path) {
+  QSet<QString> keys;
+  {
+    QMutexLocker locker(&m_mutex);
+    auto i = m_path_to_dirs.find(path);
+    if (i == m_path_to_dirs.end()) return;
+    keys = i->second;
+    if (!QFileInfo::exists(path)) m_path_to_dirs.erase(i);
+  }
+
+  for (auto i = keys.begin(); i != keys.end(); ++i) {
+    if (i->isEmpty()) {
+      QString stamp = stamp_of(QStringList() << m_machine_index_dir + "/index");
+      {
+        QMutexLocker locker(&m_mutex);
+        if (m_global.valid && m_global.stamp != stamp) {
+          qDebug() << "Vagrant machine index changed";
+          invalidate_locked(m_global);
+        }
+      }
+      watch_global_sl();
+      continue;
+    }
+
+    QString stamp = stamp_of(paths_to_watch(*i));
+    {
+      QMutexLocker locker(&m_mutex);
+      entry_t& et = m_entries[*i];
+      if (et.valid && et.stamp != stamp) {
+        qDebug() << "Vagrant state of peer changed:" << *i;
+        invalidate_locked(et);
+      }
+    }
+    // new machine or provider directories appear after `vagrant up`
+    watch_sl(*i);
+  }
+}
+////////////////////////////////////////////////////////////////////////////
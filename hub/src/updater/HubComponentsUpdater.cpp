@@ -162,7 +162,23 @@ CHubComponentsUpdater::update_component_timer_timeout(const QString &component_i
     }
   }
   m_dct_components[component_id].timer_stop();
-  if (m_dct_components[component_id].Component()->update_available()) {
+  // checking of version may block on REST calls, so it's done in worker thread
+  QFutureWatcher<bool>* watcher = new QFutureWatcher<bool>(this);
+  connect(watcher, &QFutureWatcher<bool>::finished,
+          [this, component_id, watcher]() {
+    bool update_available = watcher->result();
+    watcher->deleteLater();
+    update_component_check_finished(component_id, update_available);
+  });
+  watcher->setFuture(QtConcurrent::run(m_dct_components[component_id].Component(),
+                                       &IUpdaterComponent::update_available));
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CHubComponentsUpdater::update_component_check_finished(const QString &component_id,
+                                                       bool update_available) {
+  if (update_available) {
     if (m_dct_components[component_id].autoupdate) {
       CNotificationObserver::Instance()->Info(
             tr("%1 updating started.").arg(IUpdaterComponent::component_id_to_user_view(component_id)),  DlgNotification::N_NO_ACTION);
@@ -56,43 +56,44 @@ chue_t CUpdaterComponentFIREFOX::install_internal() {
   QString file_dir = download_firefox_path();
   QString str_downloaded_path = file_dir + QDir::separator() + file_name;
 
-  std::vector<CGorjunFileInfo> fi =
-      CRestWorker::Instance()->get_gorjun_file_info(file_name);
-  if (fi.empty()) {
-    qCritical("File %s isn't presented on kurjun",
-              m_component_id.toStdString().c_str());
-    install_finished_sl(false, "undefined");
-    return CHUE_NOT_ON_KURJUN;
-  }
-  std::vector<CGorjunFileInfo>::iterator item = fi.begin();
-
-  CDownloadFileManager *dm =
-      new CDownloadFileManager(item->name(), str_downloaded_path, item->size());
-  dm->set_link(ipfs_download_url().arg(item->id(), item->name()));
-
-  SilentInstaller *silent_installer = new SilentInstaller(this);
-  silent_installer->init(file_dir, file_name, CC_FIREFOX);
-  connect(dm, &CDownloadFileManager::download_progress_sig,
-          [this](qint64 rec, qint64 total) {
-            update_progress_sl(rec, total);
-          });
-  connect(dm, &CDownloadFileManager::finished,
-          [this, silent_installer](bool success) {
-            if (!success) {
-              silent_installer->outputReceived(success, "undefined");
-            } else {
-              this->update_progress_sl(0, 0);
-              CNotificationObserver::Instance()->Info(
-                  tr("Running installation scripts."),
-                  DlgNotification::N_NO_ACTION);
-              silent_installer->startWork();
-            }
-          });
-  connect(silent_installer, &SilentInstaller::outputReceived, this,
-          &CUpdaterComponentFIREFOX::install_finished_sl);
-  connect(silent_installer, &SilentInstaller::outputReceived, dm,
-          &CDownloadFileManager::deleteLater);
-  dm->start_download();
+  CRestWorker::Instance()->get_gorjun_file_info_async(file_name, this,
+      [this, file_name, file_dir, str_downloaded_path](std::vector<CGorjunFileInfo> fi) {
+    if (fi.empty()) {
+      qCritical("File %s isn't presented on kurjun",
+                m_component_id.toStdString().c_str());
+      install_finished_sl(false, "undefined");
+      return;
+    }
+    std::vector<CGorjunFileInfo>::iterator item = fi.begin();
+
+    CDownloadFileManager *dm =
+        new CDownloadFileManager(item->name(), str_downloaded_path, item->size());
+    dm->set_link(ipfs_download_url().arg(item->id(), item->name()));
+
+    SilentInstaller *silent_installer = new SilentInstaller(this);
+    silent_installer->init(file_dir, file_name, CC_FIREFOX);
+    connect(dm, &CDownloadFileManager::download_progress_sig,
+            [this](qint64 rec, qint64 total) {
+              update_progress_sl(rec, total);
+            });
+    connect(dm, &CDownloadFileManager::finished,
+            [this, silent_installer](bool success) {
+              if (!success) {
+                silent_installer->outputReceived(success, "undefined");
+              } else {
+                this->update_progress_sl(0, 0);
+                CNotificationObserver::Instance()->Info(
+                    tr("Running installation scripts."),
+                    DlgNotification::N_NO_ACTION);
+                silent_installer->startWork();
+              }
+            });
+    connect(silent_installer, &SilentInstaller::outputReceived, this,
+            &CUpdaterComponentFIREFOX::install_finished_sl);
+    connect(silent_installer, &SilentInstaller::outputReceived, dm,
+            &CDownloadFileManager::deleteLater);
+    dm->start_download();
+  });
   return CHUE_SUCCESS;
 }
 
@@ -93,39 +93,41 @@ chue_t CUpdaterComponentP2P::install_internal() {
       QString file_dir = download_p2p_path();
       QString str_p2p_downloaded_path = file_dir + "/" + file_name;
 
-      std::vector<CGorjunFileInfo> fi = CRestWorker::Instance()->get_gorjun_file_info(p2p_kurjun_package_name());
-      if (fi.empty()) {
-        qCritical("File %s isn't presented on kurjun", m_component_id.toStdString().c_str());
-        return CHUE_NOT_ON_KURJUN;
-      }
-      std::vector<CGorjunFileInfo>::iterator item = fi.begin();
-
-      CDownloadFileManager *dm = new CDownloadFileManager(item->name(),
-                                                          str_p2p_downloaded_path,
-                                                          item->size());
-      dm->set_link(ipfs_download_url().arg(item->id(), item->name()));
-
-      SilentInstaller *silent_installer = new SilentInstaller(this);
-      silent_installer->init(file_dir, file_name, CC_P2P);
-      connect(dm, &CDownloadFileManager::download_progress_sig,
-              [this](qint64 rec, qint64 total){update_progress_sl(rec, total);});
-      connect(dm, &CDownloadFileManager::finished,
-              [this, silent_installer](bool success) {
-                if (!success) {
-                  silent_installer->outputReceived(success, "undefined");
-                } else {
-                  this->update_progress_sl(0,0);
-                  CNotificationObserver::Instance()->Info(
-                      tr("Running installation scripts."),
-                      DlgNotification::N_NO_ACTION);
-                  silent_installer->startWork();
-                }
-              });
-      connect(silent_installer, &SilentInstaller::outputReceived,
-              this, &CUpdaterComponentP2P::install_finished_sl);
-      connect(silent_installer, &SilentInstaller::outputReceived,
-              dm, &CDownloadFileManager::deleteLater);
-      dm->start_download();
+      CRestWorker::Instance()->get_gorjun_file_info_async(p2p_kurjun_package_name(), this,
+          [this, file_name, file_dir, str_p2p_downloaded_path](std::vector<CGorjunFileInfo> fi) {
+        if (fi.empty()) {
+          qCritical("File %s isn't presented on kurjun", m_component_id.toStdString().c_str());
+          return;
+        }
+        std::vector<CGorjunFileInfo>::iterator item = fi.begin();
+
+        CDownloadFileManager *dm = new CDownloadFileManager(item->name(),
+                                                            str_p2p_downloaded_path,
+                                                            item->size());
+        dm->set_link(ipfs_download_url().arg(item->id(), item->name()));
+
+        SilentInstaller *silent_installer = new SilentInstaller(this);
+        silent_installer->init(file_dir, file_name, CC_P2P);
+        connect(dm, &CDownloadFileManager::download_progress_sig,
+                [this](qint64 rec, qint64 total){update_progress_sl(rec, total);});
+        connect(dm, &CDownloadFileManager::finished,
+                [this, silent_installer](bool success) {
+                  if (!success) {
+                    silent_installer->outputReceived(success, "undefined");
+                  } else {
+                    this->update_progress_sl(0,0);
+                    CNotificationObserver::Instance()->Info(
+                        tr("Running installation scripts."),
+                        DlgNotification::N_NO_ACTION);
+                    silent_installer->startWork();
+                  }
+                });
+        connect(silent_installer, &SilentInstaller::outputReceived,
+                this, &CUpdaterComponentP2P::install_finished_sl);
+        connect(silent_installer, &SilentInstaller::outputReceived,
+                dm, &CDownloadFileManager::deleteLater);
+        dm->start_download();
+      });
       return CHUE_SUCCESS;
 }
 
@@ -162,50 +164,50 @@ CUpdaterComponentP2P::update_internal_mac_win() {
   QString file_dir = download_p2p_path();
   QString str_p2p_downloaded_path = file_dir + QDir::separator() + file_name;
 
-  std::vector<CGorjunFileInfo> fi = CRestWorker::Instance()->get_gorjun_file_info(
-                                      p2p_kurjun_file_name());
+  CRestWorker::Instance()->get_gorjun_file_info_async(p2p_kurjun_file_name(), this,
+      [this, str_p2p_downloaded_path, str_p2p_executable_path](std::vector<CGorjunFileInfo> fi) {
+    if (fi.empty()) {
+      qCritical("File %s isn't presented on kurjun", m_component_id.toStdString().c_str());
+      return;
+    }
+
+    std::vector<CGorjunFileInfo>::iterator item = fi.begin();
 
-  if (fi.empty()) {
-    qCritical("File %s isn't presented on kurjun", m_component_id.toStdString().c_str());
-    return CHUE_NOT_ON_KURJUN;
-  }
 
-  std::vector<CGorjunFileInfo>::iterator item = fi.begin();
+    CExecutableUpdater *eu = new CExecutableUpdater(str_p2p_downloaded_path,
+                                                  str_p2p_executable_path);
 
+    if (item->md5_sum() == CCommons::FileMd5(str_p2p_downloaded_path))
+    {
+      qInfo("Already have new version of p2p in %s",
+                  str_p2p_downloaded_path.toStdString().c_str());
 
-  CExecutableUpdater *eu = new CExecutableUpdater(str_p2p_downloaded_path,
-                                                str_p2p_executable_path);
+      this->update_progress_sl(100, 100);
+      connect(eu, &CExecutableUpdater::finished,
+              this, &CUpdaterComponentP2P::update_finished_sl);
+      connect(eu, &CExecutableUpdater::finished,
+              eu, &CExecutableUpdater::deleteLater);
+      eu->replace_executables(true);
+      return;
+    }
 
-  if (item->md5_sum() == CCommons::FileMd5(str_p2p_downloaded_path))
-  {
-    qInfo("Already have new version of p2p in %s",
-                str_p2p_downloaded_path.toStdString().c_str());
+    CDownloadFileManager *dm = new CDownloadFileManager(item->name(),
+                                                        str_p2p_downloaded_path,
+                                                        item->size());
+    dm->set_link(ipfs_download_url().arg(item->id(), item->name()));
 
-    this->update_progress_sl(100, 100);
+    connect(dm, &CDownloadFileManager::download_progress_sig,
+            this, &CUpdaterComponentP2P::update_progress_sl);
+    connect(dm, &CDownloadFileManager::finished,
+            eu, &CExecutableUpdater::replace_executables);
     connect(eu, &CExecutableUpdater::finished,
             this, &CUpdaterComponentP2P::update_finished_sl);
+    connect(eu, &CExecutableUpdater::finished,
+            dm, &CDownloadFileManager::deleteLater);
     connect(eu, &CExecutableUpdater::finished,
             eu, &CExecutableUpdater::deleteLater);
-    eu->replace_executables(true);
-    return CHUE_SUCCESS;
-  }
-
-  CDownloadFileManager *dm = new CDownloadFileManager(item->name(),
-                                                      str_p2p_downloaded_path,
-                                                      item->size());
-  dm->set_link(ipfs_download_url().arg(item->id(), item->name()));
-
-  connect(dm, &CDownloadFileManager::download_progress_sig,
-          this, &CUpdaterComponentP2P::update_progress_sl);
-  connect(dm, &CDownloadFileManager::finished,
-          eu, &CExecutableUpdater::replace_executables);
-  connect(eu, &CExecutableUpdater::finished,
-          this, &CUpdaterComponentP2P::update_finished_sl);
-  connect(eu, &CExecutableUpdater::finished,
-          dm, &CDownloadFileManager::deleteLater);
-  connect(eu, &CExecutableUpdater::finished,
-          eu, &CExecutableUpdater::deleteLater);
-  dm->start_download();
+    dm->start_download();
+  });
   return CHUE_SUCCESS;
 }
 
@@ -229,59 +231,59 @@ chue_t CUpdaterComponentP2P::update_internal_linux() {
   QString file_dir = download_p2p_path();
   QString str_p2p_downloaded_path = file_dir + QDir::separator() + file_name;
 
-  std::vector<CGorjunFileInfo> fi = CRestWorker::Instance()->get_gorjun_file_info(
-                                      p2p_kurjun_package_name());
+  CRestWorker::Instance()->get_gorjun_file_info_async(p2p_kurjun_package_name(), this,
+      [this, file_name, file_dir, str_p2p_downloaded_path](std::vector<CGorjunFileInfo> fi) {
+    if (fi.empty()) {
+      qCritical("File %s isn't presented on kurjun", m_component_id.toStdString().c_str());
+      return;
+    }
 
-  if (fi.empty()) {
-    qCritical("File %s isn't presented on kurjun", m_component_id.toStdString().c_str());
-    return CHUE_NOT_ON_KURJUN;
-  }
+    std::vector<CGorjunFileInfo>::iterator item = fi.begin();
 
-  std::vector<CGorjunFileInfo>::iterator item = fi.begin();
+    if (item->md5_sum() == CCommons::FileMd5(str_p2p_downloaded_path))
+    {
+      qInfo("Already have new version of p2p in %s",
+                  str_p2p_downloaded_path.toStdString().c_str());
 
-  if (item->md5_sum() == CCommons::FileMd5(str_p2p_downloaded_path))
-  {
-    qInfo("Already have new version of p2p in %s",
-                str_p2p_downloaded_path.toStdString().c_str());
+      this->update_progress_sl(100, 100);
 
-    this->update_progress_sl(100, 100);
+      SilentUpdater *silent_updater = new SilentUpdater(this);
+      silent_updater->init(download_p2p_path(), p2p_kurjun_package_name(), CC_P2P);
 
-    SilentUpdater *silent_updater = new SilentUpdater(this);
-    silent_updater->init(download_p2p_path(), p2p_kurjun_package_name(), CC_P2P);
+      connect(silent_updater, &SilentUpdater::outputReceived, this,
+              &CUpdaterComponentP2P::update_finished_sl);
 
-    connect(silent_updater, &SilentUpdater::outputReceived, this,
-            &CUpdaterComponentP2P::update_finished_sl);
+      silent_updater->startWork();
+      return;
+    }
 
-    silent_updater->startWork();
-    return CHUE_SUCCESS;
-  }
+    CDownloadFileManager *dm = new CDownloadFileManager(item->name(),
+                                                        str_p2p_downloaded_path,
+                                                        item->size());
+    dm->set_link(ipfs_download_url().arg(item->id(), item->name()));
 
-  CDownloadFileManager *dm = new CDownloadFileManager(item->name(),
-                                                      str_p2p_downloaded_path,
-                                                      item->size());
-  dm->set_link(ipfs_download_url().arg(item->id(), item->name()));
-
-  SilentUpdater *silent_updater = new SilentUpdater(this);
-  silent_updater->init(file_dir, file_name, CC_P2P);
-  connect(dm, &CDownloadFileManager::download_progress_sig,
-          [this](qint64 rec, qint64 total){update_progress_sl(rec, total);});
-  connect(dm, &CDownloadFileManager::finished,
-          [this, silent_updater](bool success) {
-            if (!success) {
-              silent_updater->outputReceived(success);
-            } else {
-              this->update_progress_sl(0,0);
-              CNotificationObserver::Instance()->Info(
-                  tr("Running update scripts."),
-                  DlgNotification::N_NO_ACTION);
-              silent_updater->startWork();
-            }
-          });
-  connect(silent_updater, &SilentUpdater::outputReceived,
-          this, &CUpdaterComponentP2P::update_finished_sl);
-  connect(silent_updater, &SilentUpdater::outputReceived,
-          dm, &CDownloadFileManager::deleteLater);
-  dm->start_download();
+    SilentUpdater *silent_updater = new SilentUpdater(this);
+    silent_updater->init(file_dir, file_name, CC_P2P);
+    connect(dm, &CDownloadFileManager::download_progress_sig,
+            [this](qint64 rec, qint64 total){update_progress_sl(rec, total);});
+    connect(dm, &CDownloadFileManager::finished,
+            [this, silent_updater](bool success) {
+              if (!success) {
+                silent_updater->outputReceived(success);
+              } else {
+                this->update_progress_sl(0,0);
+                CNotificationObserver::Instance()->Info(
+                    tr("Running update scripts."),
+                    DlgNotification::N_NO_ACTION);
+                silent_updater->startWork();
+              }
+            });
+    connect(silent_updater, &SilentUpdater::outputReceived,
+            this, &CUpdaterComponentP2P::update_finished_sl);
+    connect(silent_updater, &SilentUpdater::outputReceived,
+            dm, &CDownloadFileManager::deleteLater);
+    dm->start_download();
+  });
   return CHUE_SUCCESS;
 }
 
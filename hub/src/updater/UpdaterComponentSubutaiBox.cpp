@@ -82,51 +82,52 @@ chue_t CUpdaterComponentSUBUTAI_BOX::install_internal(bool update){
   QString file_dir = download_subutai_box_path();
   QString str_downloaded_path = file_dir + "/" + file_name;
 
-  std::vector<CGorjunFileInfo> fi =
-      CRestWorker::Instance()->get_gorjun_file_info(file_name);
-  if (fi.empty()) {
-    qCritical("File %s isn't presented on kurjun",
-              m_component_id.toStdString().c_str());
-    install_finished_sl(false, "undefined");
-    return CHUE_NOT_ON_KURJUN;
-  }
-  std::vector<CGorjunFileInfo>::iterator item = fi.begin();
-
-  CDownloadFileManager *dm =
-      new CDownloadFileManager(item->name(), str_downloaded_path, item->size());
-  dm->set_link(ipfs_download_url().arg(item->id(), item->name()));
-
-  SilentInstaller *silent_installer = new SilentInstaller(this);
-  silent_installer->init(file_dir, file_name, CC_SUBUTAI_BOX);
-
-  connect(dm, &CDownloadFileManager::download_progress_sig,
-          [this](qint64 rec, qint64 total) {
-            update_progress_sl(rec, total);
-          });
-
-  connect(dm, &CDownloadFileManager::finished,
-          [this, silent_installer](bool success) {
-            if (!success) {
-              silent_installer->outputReceived(success, "undefined");
-            } else {
-              this->update_progress_sl(0,0);
-              CNotificationObserver::Instance()->Info(
-                  tr("Running installation scripts."),
-                  DlgNotification::N_NO_ACTION);
-              silent_installer->startWork();
-            }
-          });
-  if (update) {
-    connect(silent_installer, &SilentInstaller::outputReceived,
-            this, &CUpdaterComponentSUBUTAI_BOX::update_finished_sl);
-  } else {
-    connect(silent_installer, &SilentInstaller::outputReceived,
-            this, &CUpdaterComponentSUBUTAI_BOX::install_finished_sl);
-  }
-  connect(silent_installer, &SilentInstaller::outputReceived, dm,
-          &CDownloadFileManager::deleteLater);
+  CRestWorker::Instance()->get_gorjun_file_info_async(file_name, this,
+      [this, file_name, file_dir, str_downloaded_path, update](std::vector<CGorjunFileInfo> fi) {
+    if (fi.empty()) {
+      qCritical("File %s isn't presented on kurjun",
+                m_component_id.toStdString().c_str());
+      install_finished_sl(false, "undefined");
+      return;
+    }
+    std::vector<CGorjunFileInfo>::iterator item = fi.begin();
+
+    CDownloadFileManager *dm =
+        new CDownloadFileManager(item->name(), str_downloaded_path, item->size());
+    dm->set_link(ipfs_download_url().arg(item->id(), item->name()));
+
+    SilentInstaller *silent_installer = new SilentInstaller(this);
+    silent_installer->init(file_dir, file_name, CC_SUBUTAI_BOX);
+
+    connect(dm, &CDownloadFileManager::download_progress_sig,
+            [this](qint64 rec, qint64 total) {
+              update_progress_sl(rec, total);
+            });
+
+    connect(dm, &CDownloadFileManager::finished,
+            [this, silent_installer](bool success) {
+              if (!success) {
+                silent_installer->outputReceived(success, "undefined");
+              } else {
+                this->update_progress_sl(0,0);
+                CNotificationObserver::Instance()->Info(
+                    tr("Running installation scripts."),
+                    DlgNotification::N_NO_ACTION);
+                silent_installer->startWork();
+              }
+            });
+    if (update) {
+      connect(silent_installer, &SilentInstaller::outputReceived,
+              this, &CUpdaterComponentSUBUTAI_BOX::update_finished_sl);
+    } else {
+      connect(silent_installer, &SilentInstaller::outputReceived,
+              this, &CUpdaterComponentSUBUTAI_BOX::install_finished_sl);
+    }
+    connect(silent_installer, &SilentInstaller::outputReceived, dm,
+            &CDownloadFileManager::deleteLater);
 
-  dm->start_download();
+    dm->start_download();
+  });
   return CHUE_SUCCESS;
 }
 
@@ -54,44 +54,44 @@ CUpdaterComponentTray::update_internal() {
 
   QString str_tray_download_path = download_tray_path();
 
-  std::vector<CGorjunFileInfo> fi = CRestWorker::Instance()->get_gorjun_file_info(
-                                      tray_kurjun_file_name());
-
-  if (fi.empty()) {
-    qCritical("File %s isn't presented on kurjun", m_component_id.toStdString().c_str());
-    return CHUE_NOT_ON_KURJUN;
-  }
-
-  std::vector<CGorjunFileInfo>::iterator item = fi.begin();
-  CExecutableUpdater *eu = new CExecutableUpdater(str_tray_download_path,
-                                                  str_tray_path);
-
-  if (item->md5_sum() != "" && item->md5_sum() == CCommons::FileMd5(str_tray_download_path)) {
-    qInfo("Already have new version of tray in %s",
-                  str_tray_download_path.toStdString().c_str());
-    this->update_progress_sl(100, 100);
-    connect(eu, &CExecutableUpdater::finished,
-            this, &CUpdaterComponentTray::update_finished_sl);
-    connect(eu, &CExecutableUpdater::finished,
-            eu, &CExecutableUpdater::deleteLater);
-    eu->replace_executables(true);
-    return CHUE_SUCCESS;
-  }
-
-  CDownloadFileManager *dm = new CDownloadFileManager(item->name(),
-                                                      str_tray_download_path,
-                                                      item->size());
-  dm->set_link(ipfs_download_url().arg(item->id(), item->name()));
-
-  connect(dm, &CDownloadFileManager::download_progress_sig,
-          this, &CUpdaterComponentTray::update_progress_sl);
-
-  connect(dm, &CDownloadFileManager::finished, eu, &CExecutableUpdater::replace_executables);
-  connect(eu, &CExecutableUpdater::finished, this, &CUpdaterComponentTray::update_finished_sl);
-  connect(eu, &CExecutableUpdater::finished, dm, &CDownloadFileManager::deleteLater);
-  connect(eu, &CExecutableUpdater::finished, eu, &CExecutableUpdater::deleteLater);
-
-  dm->start_download();
+  CRestWorker::Instance()->get_gorjun_file_info_async(tray_kurjun_file_name(), this,
+      [this, str_tray_download_path, str_tray_path](std::vector<CGorjunFileInfo> fi) {
+    if (fi.empty()) {
+      qCritical("File %s isn't presented on kurjun", m_component_id.toStdString().c_str());
+      return;
+    }
+
+    std::vector<CGorjunFileInfo>::iterator item = fi.begin();
+    CExecutableUpdater *eu = new CExecutableUpdater(str_tray_download_path,
+                                                    str_tray_path);
+
+    if (item->md5_sum() != "" && item->md5_sum() == CCommons::FileMd5(str_tray_download_path)) {
+      qInfo("Already have new version of tray in %s",
+                    str_tray_download_path.toStdString().c_str());
+      this->update_progress_sl(100, 100);
+      connect(eu, &CExecutableUpdater::finished,
+              this, &CUpdaterComponentTray::update_finished_sl);
+      connect(eu, &CExecutableUpdater::finished,
+              eu, &CExecutableUpdater::deleteLater);
+      eu->replace_executables(true);
+      return;
+    }
+
+    CDownloadFileManager *dm = new CDownloadFileManager(item->name(),
+                                                        str_tray_download_path,
+                                                        item->size());
+    dm->set_link(ipfs_download_url().arg(item->id(), item->name()));
+
+    connect(dm, &CDownloadFileManager::download_progress_sig,
+            this, &CUpdaterComponentTray::update_progress_sl);
+
+    connect(dm, &CDownloadFileManager::finished, eu, &CExecutableUpdater::replace_executables);
+    connect(eu, &CExecutableUpdater::finished, this, &CUpdaterComponentTray::update_finished_sl);
+    connect(eu, &CExecutableUpdater::finished, dm, &CDownloadFileManager::deleteLater);
+    connect(eu, &CExecutableUpdater::finished, eu, &CExecutableUpdater::deleteLater);
+
+    dm->start_download();
+  });
   return CHUE_SUCCESS;
 }
 ////////////////////////////////////////////////////////////////////////////
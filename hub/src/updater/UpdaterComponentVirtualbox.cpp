@@ -57,43 +57,44 @@ chue_t CUpdaterComponentVIRTUALBOX::install_internal() {
   QString file_dir = download_virtualbox_path();
   QString str_oracle_virtualbox_downloaded_path = file_dir + "/" + file_name;
 
-  std::vector<CGorjunFileInfo> fi =
-      CRestWorker::Instance()->get_gorjun_file_info(file_name);
-  if (fi.empty()) {
-    qCritical("File %s isn't presented on kurjun",
-              m_component_id.toStdString().c_str());
-    install_finished_sl(false, version);
-    return CHUE_NOT_ON_KURJUN;
-  }
-  std::vector<CGorjunFileInfo>::iterator item = fi.begin();
-
-  CDownloadFileManager *dm = new CDownloadFileManager(
-      item->name(), str_oracle_virtualbox_downloaded_path, item->size());
-  dm->set_link(ipfs_download_url().arg(item->id(), item->name()));
-
-  SilentInstaller *silent_installer = new SilentInstaller(this);
-  silent_installer->init(file_dir, file_name, CC_VB);
-  connect(dm, &CDownloadFileManager::download_progress_sig,
-          [this](qint64 rec, qint64 total) {
-            update_progress_sl(rec, total);
-          });
-  connect(dm, &CDownloadFileManager::finished,
-          [this, silent_installer](bool success) {
-            if (!success) {
-              silent_installer->outputReceived(success, "undefined");
-            } else {
-              this->update_progress_sl(0,0);
-              CNotificationObserver::Instance()->Info(
-                  tr("Running installation scripts."),
-                  DlgNotification::N_NO_ACTION);
-              silent_installer->startWork();
-            }
-          });
-  connect(silent_installer, &SilentInstaller::outputReceived, this,
-          &CUpdaterComponentVIRTUALBOX::install_finished_sl);
-  connect(silent_installer, &SilentInstaller::outputReceived, dm,
-          &CDownloadFileManager::deleteLater);
-  dm->start_download();
+  CRestWorker::Instance()->get_gorjun_file_info_async(file_name, this,
+      [this, version, file_name, file_dir, str_oracle_virtualbox_downloaded_path](std::vector<CGorjunFileInfo> fi) {
+    if (fi.empty()) {
+      qCritical("File %s isn't presented on kurjun",
+                m_component_id.toStdString().c_str());
+      install_finished_sl(false, version);
+      return;
+    }
+    std::vector<CGorjunFileInfo>::iterator item = fi.begin();
+
+    CDownloadFileManager *dm = new CDownloadFileManager(
+        item->name(), str_oracle_virtualbox_downloaded_path, item->size());
+    dm->set_link(ipfs_download_url().arg(item->id(), item->name()));
+
+    SilentInstaller *silent_installer = new SilentInstaller(this);
+    silent_installer->init(file_dir, file_name, CC_VB);
+    connect(dm, &CDownloadFileManager::download_progress_sig,
+            [this](qint64 rec, qint64 total) {
+              update_progress_sl(rec, total);
+            });
+    connect(dm, &CDownloadFileManager::finished,
+            [this, silent_installer](bool success) {
+              if (!success) {
+                silent_installer->outputReceived(success, "undefined");
+              } else {
+                this->update_progress_sl(0,0);
+                CNotificationObserver::Instance()->Info(
+                    tr("Running installation scripts."),
+                    DlgNotification::N_NO_ACTION);
+                silent_installer->startWork();
+              }
+            });
+    connect(silent_installer, &SilentInstaller::outputReceived, this,
+            &CUpdaterComponentVIRTUALBOX::install_finished_sl);
+    connect(silent_installer, &SilentInstaller::outputReceived, dm,
+            &CDownloadFileManager::deleteLater);
+    dm->start_download();
+  });
   return CHUE_SUCCESS;
 }
 
@@ -119,41 +120,41 @@ chue_t CUpdaterComponentVIRTUALBOX::uninstall_internal() {
     QString file_dir = download_virtualbox_path();
     QString str_oracle_virtualbox_downloaded_path = file_dir + QDir::separator() + file_name;
 
-    std::vector<CGorjunFileInfo> fi =
-        CRestWorker::Instance()->get_gorjun_file_info(
-          file_name);
-    if (fi.empty()) {
-      qCritical("File %s isn't presented on kurjun",
-                m_component_id.toStdString().c_str());
-      install_finished_sl(false, "undefined");
-      return CHUE_NOT_ON_KURJUN;
-    }
-    std::vector<CGorjunFileInfo>::iterator item = fi.begin();
-
-    CDownloadFileManager *dm = new CDownloadFileManager(
-        item->name(), str_oracle_virtualbox_downloaded_path, item->size());
-    dm->set_link(ipfs_download_url().arg(item->id(), item->name()));
-
-    SilentUninstaller *silent_uninstaller = new SilentUninstaller(this);
-    silent_uninstaller->init(file_dir, file_name, CC_VB);
-    connect(dm, &CDownloadFileManager::download_progress_sig,
-            [this](qint64 rec, qint64 total) {
-              update_progress_sl(rec, total);
-            });
-    connect(dm, &CDownloadFileManager::finished,
-            [this, silent_uninstaller](bool success) {
-              if (!success) {
-                silent_uninstaller->outputReceived(success, tr("undefined"));
-              } else {
-                this->update_progress_sl(0,0);
-                silent_uninstaller->startWork();
-              }
-            });
-    connect(silent_uninstaller, &SilentUninstaller::outputReceived, this,
-            &CUpdaterComponentVIRTUALBOX::uninstall_finished_sl);
-    connect(silent_uninstaller, &SilentUninstaller::outputReceived, dm,
-            &CDownloadFileManager::deleteLater);
-    dm->start_download();
+    CRestWorker::Instance()->get_gorjun_file_info_async(file_name, this,
+        [this, file_name, file_dir, str_oracle_virtualbox_downloaded_path](std::vector<CGorjunFileInfo> fi) {
+      if (fi.empty()) {
+        qCritical("File %s isn't presented on kurjun",
+                  m_component_id.toStdString().c_str());
+        install_finished_sl(false, "undefined");
+        return;
+      }
+      std::vector<CGorjunFileInfo>::iterator item = fi.begin();
+
+      CDownloadFileManager *dm = new CDownloadFileManager(
+          item->name(), str_oracle_virtualbox_downloaded_path, item->size());
+      dm->set_link(ipfs_download_url().arg(item->id(), item->name()));
+
+      SilentUninstaller *silent_uninstaller = new SilentUninstaller(this);
+      silent_uninstaller->init(file_dir, file_name, CC_VB);
+      connect(dm, &CDownloadFileManager::download_progress_sig,
+              [this](qint64 rec, qint64 total) {
+                update_progress_sl(rec, total);
+              });
+      connect(dm, &CDownloadFileManager::finished,
+              [this, silent_uninstaller](bool success) {
+                if (!success) {
+                  silent_uninstaller->outputReceived(success, tr("undefined"));
+                } else {
+                  this->update_progress_sl(0,0);
+                  silent_uninstaller->startWork();
+                }
+              });
+      connect(silent_uninstaller, &SilentUninstaller::outputReceived, this,
+              &CUpdaterComponentVIRTUALBOX::uninstall_finished_sl);
+      connect(silent_uninstaller, &SilentUninstaller::outputReceived, dm,
+              &CDownloadFileManager::deleteLater);
+      dm->start_download();
+    });
     return CHUE_SUCCESS;
   } else {
     SilentUninstaller *silent_uninstaller = new SilentUninstaller(this);
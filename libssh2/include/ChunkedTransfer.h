@@ -0,0 +1,67 @@
+#ifndef CHUNKEDTRANSFER_H
+#define CHUNKEDTRANSFER_H
+
+#include <QAtomicInt>
+#include <QByteArray>
+#include <QString>
+
+#include "SftpTransfer.h"
+#include "SshSession.h"
+
+/**
+ * @brief The CChunkedTransfer class copies one big file over sftp so that
+ * interrupted transfer can be continued. File is sent by fixed size chunks
+ * into "<destination>.part", after every written chunk journal on local disk
+ * gets its rolling checksum. Next transfer of the same file (same endpoint,
+ * source, destination, size and mtime of source) starts after the last
+ * confirmed chunk, the last chunk is read back and checked first because it
+ * could be written partially. Complete file is compared with source by
+ * sha256 (sha256sum on container side) and only then renamed to destination.
+ * Permissions and times of destination are set by caller.
+ * Functions work on session opened and locked by caller and return
+ * run_libssh2_error_t.
+ */
+class CChunkedTransfer {
+public:
+  static const quint64 DEFAULT_CHUNK_SIZE = 4 * 1024 * 1024;
+  static const char* PART_SUFFIX;
+
+  explicit CChunkedTransfer(const QString& journal_dir = default_journal_dir(),
+                            quint64 chunk_size = DEFAULT_CHUNK_SIZE);
+
+  int upload(CSshSession& session,
+             const QString& local_file,
+             const QString& remote_file,
+             sftp_progress_t progress = nullptr,
+             const QAtomicInt* cancel = nullptr);
+
+  int download(CSshSession& session,
+               const QString& remote_file,
+               const QString& local_file,
+               sftp_progress_t progress = nullptr,
+               const QAtomicInt* cancel = nullptr);
+
+  /* offset where last upload() or download() continued from */
+  quint64 resumed_bytes() const {return m_resumed;}
+  /* bytes of file content sent or received by last upload() or download() */
+  quint64 transferred_bytes() const {return m_transferred;}
+  quint64 chunk_size() const {return m_chunk_size;}
+
+  static QString default_journal_dir();
+  /* hex sha256 of file on container, empty if it can't be computed */
+  static QByteArray remote_sha256(CSshSession& session, const QString& remote_file);
+  static QByteArray local_sha256(const QString& local_file);
+
+private:
+  QString m_journal_dir;
+  quint64 m_chunk_size;
+  quint64 m_resumed;
+  quint64 m_transferred;
+
+  QString journal_path(const char* direction,
+                       const CSshSession& session,
+                       const QString& source,
+                       const QString& destination) const;
+};
+
+#endif // CHUNKEDTRANSFER_H
@@ -0,0 +1,104 @@
+#ifndef DELTAUPLOAD_H
+#define DELTAUPLOAD_H
+
+#include <stdint.h>
+#include <vector>
+#include <QAtomicInt>
+#include <QByteArray>
+#include <QString>
+
+#include "SftpTransfer.h"
+#include "SshSession.h"
+
+/* checksums of one block of remote file */
+struct delta_block_t {
+  quint64 length;     // block size, less for the last block
+  uint32_t cksum;     // what cksum prints for block
+  QByteArray md5;     // hex
+};
+////////////////////////////////////////////////////////////////////////////
+
+/* piece of new file: copy of remote block(s) or literal bytes of local file */
+struct delta_op_t {
+  quint64 target;     // offset in new file
+  quint64 length;
+  qint64 source;      // offset in old remote file, -1 for literal
+
+  bool literal() const {return source < 0;}
+};
+////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief The CDeltaUpload class sends new version of file which exists on
+ * container already as difference, like rsync does. Container splits old
+ * file into blocks and gives their cksum and md5 (split --filter of
+ * coreutils, nothing is installed there), blocks are found in local file at
+ * any offset with CRollingCrc and confirmed by md5. Matched blocks are copied
+ * on container by dd into "<destination>.delta", only other bytes are sent
+ * over sftp. Result is compared with local file by sha256 and then renamed
+ * to destination. Permissions and times of destination are set by caller.
+ * Functions work on session opened and locked by caller and return
+ * run_libssh2_error_t, RLE_DELTA_UNUSABLE means whole file should be sent.
+ */
+class CDeltaUpload {
+public:
+  static const quint64 MIN_FILE_SIZE = 1024 * 1024;
+  static const quint64 MIN_BLOCK_SIZE = 64 * 1024;
+  static const quint64 MAX_BLOCK_SIZE = 4 * 1024 * 1024;
+  /* every block costs two processes on container */
+  static const quint64 MAX_BLOCKS = 1024;
+  /* less matched part of file isn't worth remote copying */
+  static const int MIN_MATCHED_PERCENT = 10;
+  static const char* TEMP_SUFFIX;
+
+  CDeltaUpload();
+
+  int upload(CSshSession& session,
+             const QString& local_file,
+             const QString& remote_file,
+             sftp_progress_t progress = nullptr,
+             const QAtomicInt* cancel = nullptr);
+
+  quint64 block_size() const {return m_block_size;}
+  /* bytes of new file copied from old one on container */
+  quint64 matched_bytes() const {return m_matched;}
+  /* bytes of file content sent over sftp */
+  quint64 literal_bytes() const {return m_literal;}
+  /* bytes of block checksums received from container */
+  quint64 signature_bytes() const {return m_signature;}
+
+  static quint64 block_size_for(quint64 remote_size);
+
+  static int remote_blocks(CSshSession& session,
+                           const QString& remote_file,
+                           quint64 remote_size,
+                           quint64 block_size,
+                           std::vector<delta_block_t>& blocks,
+                           quint64* received = nullptr);
+
+  /* pieces of data in order of target, neighbour copies are joined */
+  static std::vector<delta_op_t> plan(const char* data,
+                                      quint64 size,
+                                      quint64 block_size,
+                                      const std::vector<delta_block_t>& blocks);
+
+private:
+  quint64 m_block_size;
+  quint64 m_matched;
+  quint64 m_literal;
+  quint64 m_signature;
+
+  int copy_blocks(CSshSession& session,
+                  const QString& remote_file,
+                  const QString& temp_file,
+                  const std::vector<delta_op_t>& ops);
+  int send_literals(CSshSession& session,
+                    const QString& temp_file,
+                    const char* data,
+                    quint64 size,
+                    const std::vector<delta_op_t>& ops,
+                    sftp_progress_t progress,
+                    const QAtomicInt* cancel);
+};
+
+#endif // DELTAUPLOAD_H
@@ -5,7 +5,7 @@
 #include <vector>
 #include <string>
 
-#include "Locker.h"
+struct ssh_endpoint_t;
 
 typedef enum run_libssh2_error {
   RLE_SUCCESS = 1000,
@@ -20,11 +20,23 @@ typedef enum run_libssh2_error {
   RLE_SSH_AUTHENTICATION,
   RLE_LIBSSH2_CHANNEL_OPEN,
   RLE_LIBSSH2_CHANNEL_EXEC,
-  RLE_LIBSSH2_EXIT_CODE_NOT_NULL
+  RLE_LIBSSH2_EXIT_CODE_NOT_NULL,
+  RLE_SFTP_INIT,
+  RLE_SFTP_OPEN,
+  RLE_SFTP_READ,
+  RLE_SFTP_WRITE,
+  RLE_SFTP_PERMISSION_DENIED,
+  RLE_LOCAL_FILE,
+  RLE_CANCELLED,
+  RLE_CHECKSUM_MISMATCH,
+  RLE_DELTA_UNUSABLE
 } run_libssh2_error_t;
 
 /**
- * @brief The CLibsshController class is wrapper for libssh2 functionality
+ * @brief The CLibsshController class is wrapper for libssh2 functionality.
+ * Commands run on sessions of CSshSessionPool: repeated commands to the same
+ * host don't connect and authenticate again, commands to different hosts
+ * run in parallel.
  */
 class CLibsshController {
 
@@ -39,6 +51,8 @@ private:
 
 public:
   static const char *run_libssh2_error_to_str(run_libssh2_error_t err);
+  /* libssh2_init succeeded */
+  static bool initialized() {return m_initializer.result == 0;}
 
   /**
    * @brief Run ssh command with password authorization
@@ -60,6 +74,7 @@ public:
                                        std::vector<std::string>& lst_out);
 
 
+  /* 0 if user can log in with password */
   static int check_auth_pass(const char* host,
                              uint16_t port,
                              const char* user,
@@ -69,8 +84,8 @@ public:
    * @brief Run ssh command with key authorization
    * @param host
    * @param port
-   * @param pub_file - public key path
-   * @param pr_file - private key path
+   * @param user
+   * @param pr_file - private key path, public key is pr_file + ".pub"
    * @param passphrase
    * @param cmd
    * @param conn_timeout
@@ -79,13 +94,20 @@ public:
    */
   static int run_ssh_command_key_auth(const char *host,
                                       uint16_t port,
-                                      const char* pub_file,
+                                      const char* user,
                                       const char* pr_file, const char *passphrase,
                                       const char* cmd,
                                       int conn_timeout,
                                       std::vector<std::string>& lst_out);
 
-  static SynchroPrimitives::CriticalSection m_libssh_cs;
+  /**
+   * @brief Run ssh command on pooled session of endpoint
+   * @return exit code of command or run_libssh2_error_t
+   */
+  static int run_ssh_command(const ssh_endpoint_t& endpoint,
+                             const char* cmd,
+                             int conn_timeout,
+                             std::vector<std::string>& lst_out);
 };
 
 #endif // LIBSSHCONTROLLER_H
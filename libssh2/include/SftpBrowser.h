@@ -0,0 +1,90 @@
+#ifndef SFTPBROWSER_H
+#define SFTPBROWSER_H
+
+#include <functional>
+#include <memory>
+#include <vector>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+
+#include "SftpTransfer.h"
+
+/**
+ * @brief The CSftpBrowser class lists remote directories for file dialogs
+ * with sftp readdir and stat on kept session instead of running ls in new
+ * ssh process and parsing its text, so names with spaces, new lines or
+ * characters of other locale and links come as they are.
+ * Own session per endpoint is kept, browsing doesn't wait for transfers
+ * running on sessions of CSftpTransfer.
+ * Listing is sorted by name and given to caller by pages, so table of huge
+ * directory is filled step by step. Listing of directory is cached for
+ * cache_ttl() ms, going back and forth between directories doesn't read
+ * them again.
+ * All functions are blocking, thread safe and return run_libssh2_error_t.
+ */
+class CSftpBrowser {
+public:
+  static const int PAGE_SIZE = 1000;
+  static const int DEFAULT_CACHE_TTL_MS = 5000;
+  /* oldest listings are dropped when cache holds more entries */
+  static const int MAX_CACHED_ENTRIES = 200000;
+  /* how often stop is checked while listing waits for busy session */
+  static const int STOP_CHECK_INTERVAL_MS = 50;
+
+  /* gets next page of listing, returns false to stop */
+  typedef std::function<bool(const std::vector<sftp_entry_t>& page)> page_handler_t;
+  /* checked before connection and while directory is read,
+   * returns true to stop with RLE_CANCELLED */
+  typedef std::function<bool()> stop_check_t;
+
+  /* entries of remote_dir without "." and "..", links are followed */
+  static int list(const ssh_endpoint_t& endpoint,
+                  const QString& remote_dir,
+                  page_handler_t on_page,
+                  int page_size = PAGE_SIZE,
+                  stop_check_t stop = nullptr);
+
+  /* next list() of directory reads it from container */
+  static void invalidate(const ssh_endpoint_t& endpoint,
+                         const QString& remote_dir);
+  /* forgets sessions and cached listings of host */
+  static void close_sessions(const QString& host);
+  static int cached_dirs_count();
+
+  static int cache_ttl();
+  static void set_cache_ttl(int ttl_ms);
+
+  /* sftp can't be used with endpoint at all, caller could fall back to shell */
+  static bool is_connection_error(int rc);
+
+private:
+  struct cached_dir_t {
+    ssh_endpoint_t endpoint;
+    std::vector<sftp_entry_t> entries;
+    qint64 read_at;
+  };
+
+  static QMutex m_mutex;  // guards members below
+  static QHash<QString, std::shared_ptr<CSshSession> > m_sessions;
+  static QHash<QString, cached_dir_t> m_cache;
+  static int m_cached_entries;
+  static int m_cache_ttl_ms;
+
+  static QString cache_key(const ssh_endpoint_t& endpoint,
+                           const QString& remote_dir);
+  static qint64 now_ms();
+  static int read_dir(const ssh_endpoint_t& endpoint,
+                      const QString& remote_dir,
+                      std::vector<sftp_entry_t>& entries,
+                      stop_check_t stop);
+  /* the same on session locked by caller */
+  static int read_dir_locked(CSshSession& session,
+                             const QString& remote_dir,
+                             std::vector<sftp_entry_t>& entries,
+                             stop_check_t stop);
+  /* called with locked mutex */
+  static void drop_cached(QHash<QString, cached_dir_t>::iterator it);
+};
+
+#endif // SFTPBROWSER_H
@@ -0,0 +1,116 @@
+#ifndef SFTPTRANSFER_H
+#define SFTPTRANSFER_H
+
+#include <functional>
+#include <memory>
+#include <vector>
+#include <QAtomicInt>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+
+#include "SshSession.h"
+
+/* bytes of all files of transfer done so far and total */
+typedef std::function<void(quint64 done, quint64 total)> sftp_progress_t;
+
+struct sftp_entry_t {
+  QString name;
+  quint64 size;
+  unsigned long permissions;
+  quint64 mtime;
+  bool dir;
+
+  sftp_entry_t() : size(0), permissions(0), mtime(0), dir(false) {}
+};
+////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief The CSftpTransfer class copies files and directory trees between
+ * local machine and container over sftp (like scp -rp does, permissions and
+ * modification times are kept). Authenticated sessions are kept and reused by
+ * next transfers, so copying many small files doesn't pay for connection and
+ * handshake for every file. Up to MAX_SESSIONS_PER_ENDPOINT transfers to one
+ * endpoint run at once, each on its own session.
+ * Files are read and written by CHUNK_SIZE blocks, libssh2 splits such block
+ * into many sftp packets sent without waiting for acknowledges, so link is
+ * filled even with high latency. Files bigger than
+ * CChunkedTransfer::DEFAULT_CHUNK_SIZE go through CChunkedTransfer, broken
+ * transfer of such file continues where it stopped when it's started again.
+ * New version of file which exists on container is sent by CDeltaUpload,
+ * only changed parts go over link.
+ * All functions are blocking and return run_libssh2_error_t.
+ */
+class CSftpTransfer {
+public:
+  static const int CHUNK_SIZE = 256 * 1024;
+  static const int CONNECTION_TIMEOUT_SEC = 10;
+  static const int MAX_SESSIONS_PER_ENDPOINT = 4;
+
+  /* copies local file or directory into remote_dir */
+  static int upload(const ssh_endpoint_t& endpoint,
+                    const QString& local_path,
+                    const QString& remote_dir,
+                    sftp_progress_t progress = nullptr,
+                    const QAtomicInt* cancel = nullptr);
+
+  /* copies remote file or directory into local_dir */
+  static int download(const ssh_endpoint_t& endpoint,
+                      const QString& remote_path,
+                      const QString& local_dir,
+                      sftp_progress_t progress = nullptr,
+                      const QAtomicInt* cancel = nullptr);
+
+  /* forgets kept sessions of host, transfers running now finish their work */
+  static void close_sessions(const QString& host);
+  static int sessions_count();
+
+  /* functions below work on session opened and locked by caller */
+  static int upload_file(CSshSession& session,
+                         const QString& local_file,
+                         const QString& remote_file,
+                         sftp_progress_t progress = nullptr,
+                         const QAtomicInt* cancel = nullptr);
+
+  static int download_file(CSshSession& session,
+                           const QString& remote_file,
+                           const QString& local_file,
+                           sftp_progress_t progress = nullptr,
+                           const QAtomicInt* cancel = nullptr);
+
+  static int stat(CSshSession& session,
+                  const QString& remote_path,
+                  sftp_entry_t& entry);
+
+  /* entries of remote_dir without "." and ".." */
+  static int list_dir(CSshSession& session,
+                      const QString& remote_dir,
+                      std::vector<sftp_entry_t>& entries);
+
+  /* the same one by one, reading stops with RLE_CANCELLED if on_entry returns false */
+  static int list_dir(CSshSession& session,
+                      const QString& remote_dir,
+                      std::function<bool(const sftp_entry_t&)> on_entry);
+
+  /* ok if directory exists already */
+  static int make_dir(CSshSession& session,
+                      const QString& remote_dir,
+                      unsigned long permissions);
+
+  static QString join(const QString& dir, const QString& name);
+  /* def_error or RLE_SFTP_PERMISSION_DENIED if server refused */
+  static int sftp_error(CSshSession& session, int def_error);
+
+private:
+  typedef std::function<int(CSshSession&)> operation_t;
+
+  static QMutex m_sessions_mutex;
+  static QHash<QString, std::vector<std::shared_ptr<CSshSession> > > m_sessions;
+
+  /* runs operation on free kept session, once more on new one if kept session died */
+  static int with_session(const ssh_endpoint_t& endpoint, operation_t operation);
+  /* the same on session locked by caller */
+  static int run_locked(CSshSession& session, operation_t operation);
+};
+
+#endif // SFTPTRANSFER_H
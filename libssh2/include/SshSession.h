@@ -0,0 +1,89 @@
+#ifndef SSHSESSION_H
+#define SSHSESSION_H
+
+#include <stdint.h>
+#include <libssh2.h>
+#include <libssh2_sftp.h>
+#include <QByteArray>
+#include <QMutex>
+#include <QString>
+
+/**
+ * @brief Where and how to log in: host, port, user and either private key
+ * (public one is taken from private_key + ".pub" if it exists) or password.
+ */
+struct ssh_endpoint_t {
+  QString host;
+  uint16_t port;
+  QString user;
+  QString private_key;
+  QString passphrase;
+  QString password;
+
+  ssh_endpoint_t() : port(22) {}
+  /* sessions with the same key are interchangeable */
+  QString key() const;
+};
+////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief The CSshSession class is one authenticated libssh2 session. Session
+ * is blocking with timeout, sftp subsystem is started on first use and kept
+ * while session is open, so many file operations and commands pay for
+ * handshake and authentication only once.
+ * libssh2 session isn't thread safe: everybody who uses it holds mutex()
+ * for the whole operation.
+ */
+class CSshSession {
+public:
+  static const int DEFAULT_TIMEOUT_MS = 30000;
+
+  explicit CSshSession(const ssh_endpoint_t& endpoint);
+  ~CSshSession();
+
+  /* run_libssh2_error_t */
+  int open(int conn_timeout_sec);
+  void close();
+  bool is_open() const {return m_session != nullptr;}
+  /* round trip to server, false if connection is dead */
+  bool is_alive();
+
+  /* timeout of blocking libssh2 calls, except reading output of exec() */
+  void set_timeout(int timeout_ms);
+
+  LIBSSH2_SESSION* session() const {return m_session;}
+  /* nullptr if sftp subsystem can't be started */
+  LIBSSH2_SFTP* sftp();
+  /**
+   * @brief run command in new channel of session
+   * @param out - stdout of command
+   * @param timeout_ms - limits waiting for output and exit of command,
+   * 0 means command may be silent as long as it needs (updates are)
+   * @return exit code of command or run_libssh2_error_t
+   */
+  int exec(const QString& cmd, QByteArray& out, int timeout_ms = 0);
+  /* argument for remote shell, taken literally */
+  static QString shell_quote(const QString& arg);
+
+  QMutex* mutex() {return &m_mutex;}
+  const ssh_endpoint_t& endpoint() const {return m_endpoint;}
+
+private:
+  CSshSession(const CSshSession&);
+  void operator=(const CSshSession&);
+
+  ssh_endpoint_t m_endpoint;
+  QMutex m_mutex;
+  int m_timeout_ms;
+#ifdef _WIN32
+  uintptr_t m_socket;
+#else
+  int m_socket;
+#endif
+  LIBSSH2_SESSION* m_session;
+  LIBSSH2_SFTP* m_sftp;
+
+  int authenticate();
+};
+
+#endif // SSHSESSION_H
@@ -0,0 +1,83 @@
+#ifndef SSHSESSIONPOOL_H
+#define SSHSESSIONPOOL_H
+
+#include <functional>
+#include <vector>
+#include <memory>
+#include <QList>
+#include <QMutex>
+#include <QString>
+#include <QWaitCondition>
+
+#include "SshSession.h"
+
+/**
+ * @brief The CSshSessionPool class keeps authenticated sessions of
+ * CLibsshController commands between calls. Sessions are keyed by
+ * ssh_endpoint_t::key() (host, port, user and credentials), one session runs
+ * one operation at a time, so commands to different hosts and parallel
+ * commands to the same host don't wait for each other. Session idle for
+ * long is checked by round trip before reuse and closed after idle timeout,
+ * count of open sessions is limited: when limit is reached idle session of
+ * other endpoint is closed or caller waits for free one.
+ */
+class CSshSessionPool {
+public:
+  static const int DEFAULT_MAX_SESSIONS = 16;
+  static const int MAX_SESSIONS_PER_ENDPOINT = 4;
+  static const int DEFAULT_IDLE_TIMEOUT_MS = 120000;
+  /* session idle longer is checked before reuse */
+  static const int HEALTH_CHECK_IDLE_MS = 10000;
+
+  /* returns exit code or run_libssh2_error_t */
+  typedef std::function<int(CSshSession&)> operation_t;
+
+  /**
+   * @brief run operation on free session of endpoint, new one is opened if
+   * there is no free session. Operation which failed to open channel on
+   * reused session (it was dead) is repeated once on new connection.
+   * @param conn_timeout_sec - limits connection and waiting for free session
+   */
+  static int run(const ssh_endpoint_t& endpoint,
+                 int conn_timeout_sec,
+                 operation_t operation);
+
+  /* closes idle sessions of host, busy ones are closed when released */
+  static void close_sessions(const QString& host);
+  /* closes sessions idle longer than idle_timeout(), done by run() too */
+  static void evict_idle();
+  static int sessions_count();
+  static int idle_count();
+
+  static int max_sessions();
+  static void set_max_sessions(int count);
+  static int idle_timeout();
+  static void set_idle_timeout(int timeout_ms);
+
+private:
+  struct pooled_session_t {
+    QString key;
+    std::shared_ptr<CSshSession> session;
+    bool busy;
+    bool closing;       // close_sessions() was called while busy
+    qint64 released_ms;
+  };
+
+  static QMutex m_mutex;  // guards members below
+  static QWaitCondition m_released;
+  static QList<pooled_session_t> m_sessions;
+  static int m_max_sessions;
+  static int m_idle_timeout_ms;
+
+  static qint64 now_ms();
+  /* nullptr if there is no free place till deadline */
+  static std::shared_ptr<CSshSession> acquire(const ssh_endpoint_t& endpoint,
+                                              int wait_ms,
+                                              qint64& idle_ms);
+  static void release(const std::shared_ptr<CSshSession>& session,
+                      bool keep);
+  /* removes expired idle sessions, caller holds m_mutex and closes them */
+  static void take_expired(std::vector<std::shared_ptr<CSshSession> >& expired);
+};
+
+#endif // SSHSESSIONPOOL_H
@@ -0,0 +1,377 @@
+#include "ChunkedTransfer.h"
+#include "LibsshController.h"
+#include "RollingChecksum.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+const quint64 CChunkedTransfer::DEFAULT_CHUNK_SIZE;
+const char* CChunkedTransfer::PART_SUFFIX = ".part";
+
+/* what is known about transfer of one file, kept between attempts */
+struct transfer_journal_t {
+  quint64 chunk_size;
+  quint64 size;
+  quint64 mtime;
+  /* rolling checksums of written chunks */
+  std::vector<uint32_t> chunks;
+
+  transfer_journal_t() : chunk_size(0), size(0), mtime(0) {}
+  transfer_journal_t(quint64 chunk_size_, quint64 size_, quint64 mtime_) :
+    chunk_size(chunk_size_), size(size_), mtime(mtime_) {}
+
+  /* journal is useless if source changed since it was written */
+  bool same_source(const transfer_journal_t& arg) const {
+    return chunk_size == arg.chunk_size && size == arg.size && mtime == arg.mtime;
+  }
+  quint64 chunk_offset(size_t index) const {return chunk_size * index;}
+  size_t chunk_length(size_t index) const {
+    return (size_t)std::min(chunk_size, size - chunk_offset(index));
+  }
+  quint64 confirmed() const {return std::min(size, chunk_offset(chunks.size()));}
+  /* forgets chunks beyond end of partially written file */
+  void trim(quint64 written) {
+    while (!chunks.empty() && confirmed() > written) chunks.pop_back();
+  }
+
+  bool load(const QString& path);
+  bool save(const QString& path) const;
+};
+////////////////////////////////////////////////////////////////////////////
+
+bool
+transfer_journal_t::load(const QString &path) {
+  QFile file(path);
+  if (!file.open(QIODevice::ReadOnly)) return false;
+  QJsonObject obj = QJsonDocument::fromJson(file.readAll()).object();
+  if (obj.isEmpty()) return false;
+  chunk_size = (quint64)obj["chunk_size"].toDouble();
+  size = (quint64)obj["size"].toDouble();
+  mtime = (quint64)obj["mtime"].toDouble();
+  chunks.clear();
+  QJsonArray arr = obj["chunks"].toArray();
+  for (auto i = arr.begin(); i != arr.end(); ++i)
+    chunks.push_back((uint32_t)(*i).toDouble());
+  return chunk_size > 0 && chunk_offset(chunks.size()) < size + chunk_size;
+}
+////////////////////////////////////////////////////////////////////////////
+
+bool
+transfer_journal_t::save(const QString &path) const {
+  QJsonObject obj;
+  obj["chunk_size"] = (double)chunk_size;
+  obj["size"] = (double)size;
+  obj["mtime"] = (double)mtime;
+  QJsonArray arr;
+  for (auto i = chunks.begin(); i != chunks.end(); ++i)
+    arr.append((double)*i);
+  obj["chunks"] = arr;
+
+  // journal is never seen half written
+  QSaveFile file(path);
+  if (!file.open(QIODevice::WriteOnly)) return false;
+  file.write(QJsonDocument(obj).toJson(QJsonDocument::Compact));
+  return file.commit();
+}
+////////////////////////////////////////////////////////////////////////////
+
+/* less than len only at the end of file, -1 on error */
+static ssize_t
+sftp_read_all(LIBSSH2_SFTP_HANDLE* handle,
+              char* buffer,
+              size_t len) {
+  size_t done = 0;
+  while (done < len) {
+    ssize_t n = libssh2_sftp_read(handle, buffer + done, len - done);
+    if (n < 0) return -1;
+    if (n == 0) break;
+    done += (size_t)n;
+  }
+  return (ssize_t)done;
+}
+////////////////////////////////////////////////////////////////////////////
+
+static bool
+sftp_write_all(LIBSSH2_SFTP_HANDLE* handle,
+               const char* data,
+               size_t len) {
+  while (len > 0) {
+    ssize_t n = libssh2_sftp_write(handle, data, len);
+    if (n < 0) return false;
+    data += n;
+    len -= (size_t)n;
+  }
+  return true;
+}
+////////////////////////////////////////////////////////////////////////////
+
+CChunkedTransfer::CChunkedTransfer(const QString &journal_dir,
+                                   quint64 chunk_size) :
+  m_journal_dir(journal_dir),
+  m_chunk_size(chunk_size),
+  m_resumed(0),
+  m_transferred(0) {
+  QDir().mkpath(m_journal_dir);
+}
+////////////////////////////////////////////////////////////////////////////
+
+QString
+CChunkedTransfer::default_journal_dir() {
+  return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/transfers";
+}
+////////////////////////////////////////////////////////////////////////////
+
+QString
+CChunkedTransfer::journal_path(const char *direction,
+                               const CSshSession &session,
+                               const QString &source,
+                               const QString &destination) const {
+  QString id = QString("%1\n%2\n%3\n%4").arg(direction, session.endpoint().key(),
+                                             source, destination);
+  QByteArray hash = QCryptographicHash::hash(id.toUtf8(), QCryptographicHash::Sha1).toHex();
+  return QDir(m_journal_dir).filePath(QString(hash) + ".json");
+}
+////////////////////////////////////////////////////////////////////////////
+
+QByteArray
+CChunkedTransfer::remote_sha256(CSshSession &session,
+                                const QString &remote_file) {
+  QByteArray out;
+  int rc = session.exec("sha256sum -- " + CSshSession::shell_quote(remote_file), out);
+  if (rc != 0) return QByteArray();
+  QByteArray hex = out.left(64).toLower();
+  if (hex.size() != 64 || QByteArray::fromHex(hex).size() != 32) return QByteArray();
+  return hex;
+}
+////////////////////////////////////////////////////////////////////////////
+
+QByteArray
+CChunkedTransfer::local_sha256(const QString &local_file) {
+  QFile file(local_file);
+  if (!file.open(QIODevice::ReadOnly)) return QByteArray();
+  QCryptographicHash hash(QCryptographicHash::Sha256);
+  if (!hash.addData(&file)) return QByteArray();
+  return hash.result().toHex();
+}
+////////////////////////////////////////////////////////////////////////////
+
+int
+CChunkedTransfer::upload(CSshSession &session,
+                         const QString &local_file,
+                         const QString &remote_file,
+                         sftp_progress_t progress,
+                         const QAtomicInt *cancel) {
+  m_resumed = m_transferred = 0;
+  LIBSSH2_SFTP* sftp = session.sftp();
+  if (!sftp) return RLE_SFTP_INIT;
+  QFileInfo fi(local_file);
+  QFile file(local_file);
+  if (!file.open(QIODevice::ReadOnly)) return RLE_LOCAL_FILE;
+
+  transfer_journal_t source(m_chunk_size, (quint64)fi.size(),
+                            (quint64)fi.lastModified().toMSecsSinceEpoch());
+  QString journal_file = journal_path("upload", session, fi.absoluteFilePath(), remote_file);
+  QString part = remote_file + PART_SUFFIX;
+  QByteArray part_path = part.toUtf8();
+  QByteArray buffer((int)m_chunk_size, 0);
+
+  transfer_journal_t journal;
+  bool resume = journal.load(journal_file) && journal.same_source(source);
+  if (resume) {
+    sftp_entry_t entry;
+    resume = CSftpTransfer::stat(session, part, entry) == RLE_SUCCESS;
+    journal.trim(entry.size);
+  }
+  if (resume && !journal.chunks.empty()) {
+    // the last chunk could be written partially before interruption
+    size_t last = journal.chunks.size() - 1;
+    size_t len = journal.chunk_length(last);
+    LIBSSH2_SFTP_HANDLE* handle =
+        libssh2_sftp_open_ex(sftp, part_path.constData(), (unsigned int)part_path.size(),
+                             LIBSSH2_FXF_READ, 0, LIBSSH2_SFTP_OPENFILE);
+    if (!handle) return CSftpTransfer::sftp_error(session, RLE_SFTP_OPEN);
+    libssh2_sftp_seek64(handle, journal.chunk_offset(last));
+    ssize_t n = sftp_read_all(handle, buffer.data(), len);
+    libssh2_sftp_close_handle(handle);
+    if (n != (ssize_t)len ||
+        CRollingChecksum::checksum(buffer.constData(), len) != journal.chunks.back())
+      journal.chunks.pop_back();
+  }
+  if (!resume) journal = source;
+
+  unsigned long flags = LIBSSH2_FXF_WRITE | LIBSSH2_FXF_CREAT;
+  if (!resume) flags |= LIBSSH2_FXF_TRUNC;
+  LIBSSH2_SFTP_HANDLE* handle =
+      libssh2_sftp_open_ex(sftp, part_path.constData(), (unsigned int)part_path.size(),
+                           flags, 0600, LIBSSH2_SFTP_OPENFILE);
+  if (!handle) return CSftpTransfer::sftp_error(session, RLE_SFTP_OPEN);
+
+  quint64 offset = journal.confirmed();
+  m_resumed = offset;
+  if (offset > 0) {
+    qDebug() << "upload of" << local_file << "continues from" << offset;
+    libssh2_sftp_seek64(handle, offset);
+  }
+  int rc = file.seek((qint64)offset) ? RLE_SUCCESS : RLE_LOCAL_FILE;
+  while (rc == RLE_SUCCESS && offset < journal.size) {
+    if (cancel && cancel->load()) {
+      rc = RLE_CANCELLED;
+      break;
+    }
+    size_t len = journal.chunk_length(journal.chunks.size());
+    if (file.read(buffer.data(), (qint64)len) != (qint64)len) {
+      rc = RLE_LOCAL_FILE;
+      break;
+    }
+    if (!sftp_write_all(handle, buffer.constData(), len)) {
+      rc = CSftpTransfer::sftp_error(session, RLE_SFTP_WRITE);
+      break;
+    }
+    journal.chunks.push_back(CRollingChecksum::checksum(buffer.constData(), len));
+    if (!journal.save(journal_file))
+      qWarning() << "can't save transfer journal" << journal_file;
+    offset += len;
+    m_transferred += len;
+    if (progress) progress(offset, journal.size);
+  }
+  libssh2_sftp_close_handle(handle);
+  if (rc != RLE_SUCCESS) return rc;
+
+  // .part of earlier attempt could be longer
+  LIBSSH2_SFTP_ATTRIBUTES attrs;
+  memset(&attrs, 0, sizeof(attrs));
+  attrs.flags = LIBSSH2_SFTP_ATTR_SIZE;
+  attrs.filesize = journal.size;
+  libssh2_sftp_stat_ex(sftp, part_path.constData(), (unsigned int)part_path.size(),
+                       LIBSSH2_SFTP_SETSTAT, &attrs);
+
+  QByteArray remote_hash = remote_sha256(session, part);
+  if (remote_hash.isEmpty()) {
+    qWarning() << "sha256 of" << remote_file << "can't be checked";
+  } else if (remote_hash != local_sha256(local_file)) {
+    qCritical() << "uploaded" << remote_file << "differs from" << local_file;
+    libssh2_sftp_unlink_ex(sftp, part_path.constData(), (unsigned int)part_path.size());
+    QFile::remove(journal_file);
+    return RLE_CHECKSUM_MISMATCH;
+  }
+
+  // sftp v3 rename doesn't replace existing file
+  QByteArray path = remote_file.toUtf8();
+  libssh2_sftp_unlink_ex(sftp, path.constData(), (unsigned int)path.size());
+  if (libssh2_sftp_rename_ex(sftp, part_path.constData(), (unsigned int)part_path.size(),
+                             path.constData(), (unsigned int)path.size(),
+                             LIBSSH2_SFTP_RENAME_OVERWRITE | LIBSSH2_SFTP_RENAME_ATOMIC |
+                             LIBSSH2_SFTP_RENAME_NATIVE) != 0)
+    return CSftpTransfer::sftp_error(session, RLE_SFTP_WRITE);
+  QFile::remove(journal_file);
+  return RLE_SUCCESS;
+}
+////////////////////////////////////////////////////////////////////////////
+
+int
+CChunkedTransfer::download(CSshSession &session,
+                           const QString &remote_file,
+                           const QString &local_file,
+                           sftp_progress_t progress,
+                           const QAtomicInt *cancel) {
+  m_resumed = m_transferred = 0;
+  LIBSSH2_SFTP* sftp = session.sftp();
+  if (!sftp) return RLE_SFTP_INIT;
+  sftp_entry_t entry;
+  int rc = CSftpTransfer::stat(session, remote_file, entry);
+  if (rc != RLE_SUCCESS) return rc;
+
+  transfer_journal_t source(m_chunk_size, entry.size, entry.mtime);
+  QString journal_file = journal_path("download", session, remote_file,
+                                      QFileInfo(local_file).absoluteFilePath());
+  QString part = local_file + PART_SUFFIX;
+  QByteArray buffer((int)m_chunk_size, 0);
+
+  transfer_journal_t journal;
+  bool resume = journal.load(journal_file) && journal.same_source(source) &&
+                QFile::exists(part);
+  if (resume) journal.trim((quint64)QFileInfo(part).size());
+  QFile out(part);
+  QIODevice::OpenMode mode = QIODevice::ReadWrite;
+  if (!resume) mode |= QIODevice::Truncate;
+  if (!out.open(mode)) return RLE_LOCAL_FILE;
+
+  if (resume && !journal.chunks.empty()) {
+    // the last chunk could be written partially before interruption
+    size_t last = journal.chunks.size() - 1;
+    size_t len = journal.chunk_length(last);
+    if (!out.seek((qint64)journal.chunk_offset(last)) ||
+        out.read(buffer.data(), (qint64)len) != (qint64)len ||
+        CRollingChecksum::checksum(buffer.constData(), len) != journal.chunks.back())
+      journal.chunks.pop_back();
+  }
+  if (!resume) journal = source;
+
+  QByteArray path = remote_file.toUtf8();
+  LIBSSH2_SFTP_HANDLE* handle =
+      libssh2_sftp_open_ex(sftp, path.constData(), (unsigned int)path.size(),
+                           LIBSSH2_FXF_READ, 0, LIBSSH2_SFTP_OPENFILE);
+  if (!handle) return CSftpTransfer::sftp_error(session, RLE_SFTP_OPEN);
+
+  quint64 offset = journal.confirmed();
+  m_resumed = offset;
+  if (offset > 0) {
+    qDebug() << "download of" << remote_file << "continues from" << offset;
+    libssh2_sftp_seek64(handle, offset);
+  }
+  rc = out.seek((qint64)offset) ? RLE_SUCCESS : RLE_LOCAL_FILE;
+  while (rc == RLE_SUCCESS && offset < journal.size) {
+    if (cancel && cancel->load()) {
+      rc = RLE_CANCELLED;
+      break;
+    }
+    size_t len = journal.chunk_length(journal.chunks.size());
+    // shorter read means file was truncated while it's read
+    if (sftp_read_all(handle, buffer.data(), len) != (ssize_t)len) {
+      rc = CSftpTransfer::sftp_error(session, RLE_SFTP_READ);
+      break;
+    }
+    if (out.write(buffer.constData(), (qint64)len) != (qint64)len || !out.flush()) {
+      rc = RLE_LOCAL_FILE;
+      break;
+    }
+    journal.chunks.push_back(CRollingChecksum::checksum(buffer.constData(), len));
+    if (!journal.save(journal_file))
+      qWarning() << "can't save transfer journal" << journal_file;
+    offset += len;
+    m_transferred += len;
+    if (progress) progress(offset, journal.size);
+  }
+  libssh2_sftp_close_handle(handle);
+  if (rc == RLE_SUCCESS && !out.resize((qint64)journal.size)) rc = RLE_LOCAL_FILE;
+  out.close();
+  if (rc != RLE_SUCCESS) return rc;
+
+  QByteArray remote_hash = remote_sha256(session, remote_file);
+  if (remote_hash.isEmpty()) {
+    qWarning() << "sha256 of" << remote_file << "can't be checked";
+  } else if (remote_hash != local_sha256(part)) {
+    qCritical() << "downloaded" << local_file << "differs from" << remote_file;
+    QFile::remove(part);
+    QFile::remove(journal_file);
+    return RLE_CHECKSUM_MISMATCH;
+  }
+
+  QFile::remove(local_file);
+  if (!QFile::rename(part, local_file)) return RLE_LOCAL_FILE;
+  QFile::remove(journal_file);
+  return RLE_SUCCESS;
+}
+////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,315 @@
+#include "DeltaUpload.h"
+#include "ChunkedTransfer.h"
+#include "LibsshController.h"
+#include "RollingCrc.h"
+
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+#include <QCryptographicHash>
+#include <QDebug>
+#include <QFile>
+#include <QFileInfo>
+#include <QList>
+
+const quint64 CDeltaUpload::MIN_FILE_SIZE;
+const quint64 CDeltaUpload::MIN_BLOCK_SIZE;
+const quint64 CDeltaUpload::MAX_BLOCK_SIZE;
+const quint64 CDeltaUpload::MAX_BLOCKS;
+const int CDeltaUpload::MIN_MATCHED_PERCENT;
+const char* CDeltaUpload::TEMP_SUFFIX = ".delta";
+
+/* dd calls in one remote command, keeps command line short */
+static const int COPIES_PER_COMMAND = 256;
+/* bits of weak checksum filter, most offsets don't match any block */
+static const int FILTER_BITS = 20;
+
+static bool
+sftp_write_all(LIBSSH2_SFTP_HANDLE* handle,
+               const char* data,
+               size_t len) {
+  while (len > 0) {
+    ssize_t n = libssh2_sftp_write(handle, data, len);
+    if (n < 0) return false;
+    data += n;
+    len -= (size_t)n;
+  }
+  return true;
+}
+////////////////////////////////////////////////////////////////////////////
+
+static QByteArray
+md5_hex(const char* data,
+        quint64 len) {
+  return QCryptographicHash::hash(QByteArray::fromRawData(data, (int)len),
+                                  QCryptographicHash::Md5).toHex();
+}
+////////////////////////////////////////////////////////////////////////////
+
+CDeltaUpload::CDeltaUpload() :
+  m_block_size(0),
+  m_matched(0),
+  m_literal(0),
+  m_signature(0) {
+}
+////////////////////////////////////////////////////////////////////////////
+
+quint64
+CDeltaUpload::block_size_for(quint64 remote_size) {
+  quint64 res = (remote_size + MAX_BLOCKS - 1) / MAX_BLOCKS;
+  res = (res + 4095) & ~(quint64)4095;
+  return std::min(MAX_BLOCK_SIZE, std::max(MIN_BLOCK_SIZE, res));
+}
+////////////////////////////////////////////////////////////////////////////
+
+int
+CDeltaUpload::remote_blocks(CSshSession &session,
+                            const QString &remote_file,
+                            quint64 remote_size,
+                            quint64 block_size,
+                            std::vector<delta_block_t> &blocks,
+                            quint64 *received) {
+  blocks.clear();
+  QString quoted = CSshSession::shell_quote(remote_file);
+  QString cmd = QString("split -b %1 --filter=cksum -- %2 && split -b %1 --filter=md5sum -- %2")
+                .arg(block_size).arg(quoted);
+  QByteArray out;
+  int rc = session.exec(cmd, out);
+  if (received) *received = (quint64)out.size();
+  if (rc >= RLE_SUCCESS) return rc;
+  // old coreutils without split --filter
+  if (rc != 0) return RLE_DELTA_UNUSABLE;
+
+  size_t count = (size_t)((remote_size + block_size - 1) / block_size);
+  QList<QByteArray> lines = out.split('\n');
+  if ((size_t)lines.size() < count * 2) return RLE_DELTA_UNUSABLE;
+  blocks.resize(count);
+  for (size_t i = 0; i < count; ++i) {
+    QList<QByteArray> crc = lines[(int)i].split(' ');
+    quint64 len = std::min(block_size, remote_size - block_size * i);
+    bool ok_crc = false, ok_len = false;
+    if (crc.size() != 2) return RLE_DELTA_UNUSABLE;
+    blocks[i].length = len;
+    blocks[i].cksum = crc[0].toUInt(&ok_crc);
+    // file changed since it was stat'ed
+    if (!ok_crc || crc[1].toULongLong(&ok_len) != len || !ok_len) return RLE_DELTA_UNUSABLE;
+    blocks[i].md5 = lines[(int)(count + i)].left(32).toLower();
+    if (blocks[i].md5.size() != 32) return RLE_DELTA_UNUSABLE;
+  }
+  return RLE_SUCCESS;
+}
+////////////////////////////////////////////////////////////////////////////
+
+std::vector<delta_op_t>
+CDeltaUpload::plan(const char *data,
+                   quint64 size,
+                   quint64 block_size,
+                   const std::vector<delta_block_t> &blocks) {
+  std::vector<delta_op_t> ops;
+  std::vector<bool> filter((size_t)1 << FILTER_BITS, false);
+  std::unordered_map<uint32_t, std::vector<size_t> > index;
+  for (size_t i = 0; i < blocks.size(); ++i) {
+    // short tail of old file could match only at the end, it's sent
+    if (blocks[i].length != block_size) continue;
+    filter[blocks[i].cksum & ((1u << FILTER_BITS) - 1)] = true;
+    index[blocks[i].cksum].push_back(i);
+  }
+
+  auto add_op = [&ops](quint64 target, quint64 length, qint64 source) {
+    if (length == 0) return;
+    if (!ops.empty()) {
+      delta_op_t& last = ops.back();
+      bool joined_copy = !last.literal() && source >= 0 &&
+                         last.source + (qint64)last.length == source;
+      if ((last.literal() && source < 0) || joined_copy) {
+        last.length += length;
+        return;
+      }
+    }
+    delta_op_t op;
+    op.target = target;
+    op.length = length;
+    op.source = source;
+    ops.push_back(op);
+  };
+
+  quint64 pos = 0, literal_start = 0;
+  CRollingCrc crc((size_t)block_size);
+  if (size >= block_size && !index.empty())
+    crc.update(data, (size_t)block_size);
+  while (!index.empty() && pos + block_size <= size) {
+    uint32_t digest = crc.digest();
+    qint64 matched = -1;
+    if (filter[digest & ((1u << FILTER_BITS) - 1)]) {
+      auto candidates = index.find(digest);
+      if (candidates != index.end()) {
+        QByteArray md5 = md5_hex(data + pos, block_size);
+        // next block of previous copy keeps copy in one piece
+        qint64 expected = -1;
+        if (!ops.empty() && !ops.back().literal() && literal_start == pos)
+          expected = (ops.back().source + (qint64)ops.back().length) / (qint64)block_size;
+        for (size_t i : candidates->second) {
+          if (blocks[i].md5 != md5) continue;
+          if (matched < 0 || (qint64)i == expected) matched = (qint64)i;
+        }
+      }
+    }
+
+    if (matched >= 0) {
+      add_op(literal_start, pos - literal_start, -1);
+      add_op(pos, block_size, matched * (qint64)block_size);
+      pos += block_size;
+      literal_start = pos;
+      crc.reset();
+      if (pos + block_size <= size)
+        crc.update(data + pos, (size_t)block_size);
+      continue;
+    }
+    if (pos + block_size >= size) break;
+    crc.roll((unsigned char)data[pos], (unsigned char)data[pos + block_size]);
+    ++pos;
+  }
+  add_op(literal_start, size - literal_start, -1);
+  return ops;
+}
+////////////////////////////////////////////////////////////////////////////
+
+int
+CDeltaUpload::copy_blocks(CSshSession &session,
+                          const QString &remote_file,
+                          const QString &temp_file,
+                          const std::vector<delta_op_t> &ops) {
+  QString head = QString("o=%1; t=%2; c() { dd if=\"$o\" of=\"$t\" bs=1048576 "
+                         "iflag=skip_bytes,count_bytes oflag=seek_bytes conv=notrunc "
+                         "skip=$1 seek=$2 count=$3 2>/dev/null || exit 1; }; ")
+                 .arg(CSshSession::shell_quote(remote_file), CSshSession::shell_quote(temp_file));
+  QString cmd = head + ": > \"$t\" || exit 1; ";
+  int in_cmd = 0;
+  for (size_t i = 0; i <= ops.size(); ++i) {
+    if (i < ops.size()) {
+      if (ops[i].literal()) continue;
+      cmd += QString("c %1 %2 %3; ").arg(ops[i].source).arg(ops[i].target).arg(ops[i].length);
+      if (++in_cmd < COPIES_PER_COMMAND) continue;
+    }
+
+    QByteArray out;
+    int rc = session.exec(cmd, out);
+    if (rc >= RLE_SUCCESS) return rc;
+    // dd without byte offsets
+    if (rc != 0) return RLE_DELTA_UNUSABLE;
+    cmd = head;
+    in_cmd = 0;
+  }
+  return RLE_SUCCESS;
+}
+////////////////////////////////////////////////////////////////////////////
+
+int
+CDeltaUpload::send_literals(CSshSession &session,
+                            const QString &temp_file,
+                            const char *data,
+                            quint64 size,
+                            const std::vector<delta_op_t> &ops,
+                            sftp_progress_t progress,
+                            const QAtomicInt *cancel) {
+  LIBSSH2_SFTP* sftp = session.sftp();
+  QByteArray path = temp_file.toUtf8();
+  LIBSSH2_SFTP_HANDLE* handle =
+      libssh2_sftp_open_ex(sftp, path.constData(), (unsigned int)path.size(),
+                           LIBSSH2_FXF_WRITE, 0, LIBSSH2_SFTP_OPENFILE);
+  if (!handle) return CSftpTransfer::sftp_error(session, RLE_SFTP_OPEN);
+
+  int rc = RLE_SUCCESS;
+  for (auto op = ops.begin(); op != ops.end() && rc == RLE_SUCCESS; ++op) {
+    if (!op->literal()) continue;
+    libssh2_sftp_seek64(handle, op->target);
+    for (quint64 done = 0; done < op->length; ) {
+      if (cancel && cancel->load()) {
+        rc = RLE_CANCELLED;
+        break;
+      }
+      size_t len = (size_t)std::min((quint64)CSftpTransfer::CHUNK_SIZE, op->length - done);
+      if (!sftp_write_all(handle, data + op->target + done, len)) {
+        rc = CSftpTransfer::sftp_error(session, RLE_SFTP_WRITE);
+        break;
+      }
+      done += len;
+      m_literal += len;
+      if (progress) progress(m_matched + m_literal, size);
+    }
+  }
+  libssh2_sftp_close_handle(handle);
+  return rc;
+}
+////////////////////////////////////////////////////////////////////////////
+
+int
+CDeltaUpload::upload(CSshSession &session,
+                     const QString &local_file,
+                     const QString &remote_file,
+                     sftp_progress_t progress,
+                     const QAtomicInt *cancel) {
+  m_block_size = m_matched = m_literal = m_signature = 0;
+  LIBSSH2_SFTP* sftp = session.sftp();
+  if (!sftp) return RLE_SFTP_INIT;
+
+  sftp_entry_t remote;
+  int rc = CSftpTransfer::stat(session, remote_file, remote);
+  if (rc != RLE_SUCCESS || remote.dir || remote.size < MIN_FILE_SIZE)
+    return RLE_DELTA_UNUSABLE;
+  QFile file(local_file);
+  quint64 size = (quint64)QFileInfo(local_file).size();
+  if (size < MIN_FILE_SIZE || !file.open(QIODevice::ReadOnly)) return RLE_DELTA_UNUSABLE;
+  const char* data = (const char*)file.map(0, (qint64)size);
+  if (!data) return RLE_DELTA_UNUSABLE;
+
+  m_block_size = block_size_for(remote.size);
+  std::vector<delta_block_t> blocks;
+  rc = remote_blocks(session, remote_file, remote.size, m_block_size, blocks, &m_signature);
+  if (rc != RLE_SUCCESS) return rc;
+  if (cancel && cancel->load()) return RLE_CANCELLED;
+
+  std::vector<delta_op_t> ops = plan(data, size, m_block_size, blocks);
+  quint64 matched = 0;
+  for (auto op = ops.begin(); op != ops.end(); ++op)
+    if (!op->literal()) matched += op->length;
+  qDebug() << "delta of" << local_file << ":" << matched << "of" << size
+           << "bytes are on container already";
+  if (matched * 100 < size * MIN_MATCHED_PERCENT) return RLE_DELTA_UNUSABLE;
+
+  QString temp = remote_file + TEMP_SUFFIX;
+  QByteArray temp_path = temp.toUtf8();
+  rc = copy_blocks(session, remote_file, temp, ops);
+  if (rc == RLE_SUCCESS) {
+    m_matched = matched;
+    if (progress) progress(m_matched, size);
+    rc = send_literals(session, temp, data, size, ops, progress, cancel);
+  }
+  if (rc != RLE_SUCCESS) {
+    libssh2_sftp_unlink_ex(sftp, temp_path.constData(), (unsigned int)temp_path.size());
+    return rc;
+  }
+
+  QByteArray remote_hash = CChunkedTransfer::remote_sha256(session, temp);
+  if (remote_hash.isEmpty()) {
+    qWarning() << "sha256 of" << remote_file << "can't be checked, delta isn't used";
+    libssh2_sftp_unlink_ex(sftp, temp_path.constData(), (unsigned int)temp_path.size());
+    return RLE_DELTA_UNUSABLE;
+  }
+  if (remote_hash != CChunkedTransfer::local_sha256(local_file)) {
+    qCritical() << "delta of" << remote_file << "differs from" << local_file;
+    libssh2_sftp_unlink_ex(sftp, temp_path.constData(), (unsigned int)temp_path.size());
+    return RLE_CHECKSUM_MISMATCH;
+  }
+
+  // rename of shell replaces destination at once
+  QByteArray out;
+  rc = session.exec(QString("mv -f -- %1 %2").arg(CSshSession::shell_quote(temp),
+                                                   CSshSession::shell_quote(remote_file)), out);
+  if (rc != 0) {
+    libssh2_sftp_unlink_ex(sftp, temp_path.constData(), (unsigned int)temp_path.size());
+    return rc >= RLE_SUCCESS ? rc : (int)RLE_SFTP_WRITE;
+  }
+  return RLE_SUCCESS;
+}
+////////////////////////////////////////////////////////////////////////////
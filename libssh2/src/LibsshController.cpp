@@ -1,53 +1,18 @@
 #include "libssh2/include/LibsshController.h"
+#include "SshSessionPool.h"
 
 #include <stdint.h>
 #include <libssh2.h>
-#include <Commons.h>
+#include <QByteArray>
 #include <QDebug>
+#include <QList>
 
 #ifdef _WIN32
 #include <windows.h>
 #include <winsock2.h>
-#include <ws2tcpip.h>
-#else
-#include <arpa/inet.h>
-#include <sys/socket.h>
-#include <unistd.h>
-#include <sys/select.h>
-#include <fcntl.h>
-#define SOCKET_ERROR (-1)
 #endif
 
-#include <string>
-#include <stdlib.h>
-
-#include "libssh2/include/LibsshController.h"
-
 CLibsshController::CSshInitializer CLibsshController::m_initializer;
-SynchroPrimitives::CriticalSection CLibsshController::m_libssh_cs;
-
-struct rsc_user_pass_arg_t {
-  const char* user;
-  const char* pass;
-};
-
-struct rsc_pub_key_arg_t {
-  const char* pub_file;
-  const char* privae_file;
-  const char* passphrase;
-};
-
-int wait_socket_connected(int socket_fd, int timeout_sec);
-int user_pass_authentication(LIBSSH2_SESSION *session, const void* rsc_user_pass_arg);
-int key_pub_authentication(LIBSSH2_SESSION *session, const void* rsc_pub_key_arg);
-
-int run_ssh_command_internal(const char* str_host,
-                             uint16_t port,
-                             const char* str_cmd,
-                             int conn_timeout,
-                             std::vector<std::string> &lst_out,
-                             int (*pf_auth)(LIBSSH2_SESSION*, const void *),
-                             void *pf_auth_arg);
 
 CLibsshController::CSshInitializer::CSshInitializer()
 {
@@ -79,292 +44,41 @@ CLibsshController::run_libssh2_error_to_str(run_libssh2_error_t err) {
     "LIBSSH2_INIT", "INET_ADDR", "CONNECTION_TIMEOUT",
     "CONNECTION_ERROR", "LIBSSH2_SESSION_INIT", "SESSION_HANDSHAKE",
     "SSH_AUTHENTICATION", "LIBSSH2_CHANNEL_OPEN", "LIBSSH2_CHANNEL_EXEC",
-    "LIBSSH2_EXIT_CODE_NOT_NULL"
+    "LIBSSH2_EXIT_CODE_NOT_NULL", "SFTP_INIT", "SFTP_OPEN",
+    "SFTP_READ", "SFTP_WRITE", "SFTP_PERMISSION_DENIED",
+    "LOCAL_FILE", "CANCELLED", "CHECKSUM_MISMATCH",
+    "DELTA_UNUSABLE"
   };
   return rle_errors[index];
 }
 ////////////////////////////////////////////////////////////////////////////
 
-int
-wait_ssh_socket_event(int socket_fd,
-                      LIBSSH2_SESSION *session) {
-  struct timeval timeout;
-  int rc;
-  fd_set fd;
-  fd_set *writefd = nullptr;
-  fd_set *readfd = nullptr;
-  int dir;
-
-  timeout.tv_sec = 10;
-  timeout.tv_usec = 0;
-
-  FD_ZERO(&fd);
-  FD_SET(socket_fd, &fd);
-
-  /* now make sure we wait in the correct direction */
-  dir = libssh2_session_block_directions(session);
-  if (dir & LIBSSH2_SESSION_BLOCK_INBOUND)
-    readfd = &fd;
-
-  if (dir & LIBSSH2_SESSION_BLOCK_OUTBOUND)
-    writefd = &fd;
-
-  rc = select(socket_fd + 1, readfd, writefd, nullptr, &timeout);
-  return rc;
-}
-////////////////////////////////////////////////////////////////////////////
-
-int
-user_pass_authentication(LIBSSH2_SESSION *session, const void *rsc_user_pass_arg) {
-  rsc_user_pass_arg_t* arg = (rsc_user_pass_arg_t*)rsc_user_pass_arg;
-  return libssh2_userauth_password(session, arg->user, arg->pass);
-}
-
-////////////////////////////////////////////////////////////////////////////
-
-int
-key_pub_authentication(LIBSSH2_SESSION *session, const void *rsc_pub_key_arg) {
-  UNUSED_ARG(session);
-  UNUSED_ARG(rsc_pub_key_arg);
-  return 0;
-}
-////////////////////////////////////////////////////////////////////////////
-
-int
-wait_socket_connected(int socket_fd, int timeout_sec) {
-  struct timeval timeout;
-  fd_set fd;
-  timeout.tv_sec = timeout_sec;
-  timeout.tv_usec = 0;
-  FD_ZERO(&fd);
-  FD_SET(socket_fd, &fd);
-  return select(socket_fd + 1, nullptr, &fd, nullptr, &timeout);
+/* lines of output, last one may be without new line */
+static void
+split_lines(const QByteArray& out,
+            std::vector<std::string>& lst_out) {
+  if (out.isEmpty()) return;
+  QList<QByteArray> lines = out.split('\n');
+  if (out.endsWith('\n')) lines.removeLast();
+  for (const QByteArray& line : lines)
+    lst_out.push_back(std::string(line.constData(), (size_t)line.size()));
 }
 ////////////////////////////////////////////////////////////////////////////
 
-struct libssh2_session_auto_t {
-  LIBSSH2_SESSION* session;
-  libssh2_session_auto_t() : session(nullptr) {session = libssh2_session_init(); }
-  ~libssh2_session_auto_t() {
-    if (session) {
-      libssh2_session_disconnect(session, "Normal Shutdown, Thank you for playing");
-      libssh2_session_free(session);
-    }
-  }
-};
-
-int
-check_auth_pass_internal(const char *str_host,
-                         uint16_t port,
-                         int conn_timeout,
-                         int (*pf_auth)(LIBSSH2_SESSION*, const void *),
-                         void *pf_auth_arg) {
-  int rc = 0;
-  struct sockaddr_in sin;
-  unsigned long ul_host_addr = 0;
-  int exitcode = 0;
-
-
-#ifndef _WIN32
-  int sock;
-  ul_host_addr = inet_addr(str_host);
-#else
-  SOCKET sock;
-  ul_host_addr = inet_addr(str_host);
-#endif
-  sin.sin_family = AF_INET;
-  sin.sin_port = htons(port);
-  sin.sin_addr.s_addr = ul_host_addr;
-  sock = socket(AF_INET, SOCK_STREAM, 0);
-#ifdef _WIN32
-  u_long mode = 1;
-  ioctlsocket(sock, FIONBIO, &mode);
-#else
-  int flags = fcntl(sock, F_GETFL, 0);
-  flags |= O_NONBLOCK;
-#endif
-  connect(sock, (struct sockaddr*)(&sin), sizeof(struct sockaddr_in));
-  rc = wait_socket_connected(sock, conn_timeout);
-  run_libssh2_error_t res = RLE_SUCCESS;
-  do {
-    if (rc == 0) {
-      res = RLE_CONNECTION_TIMEOUT;
-      break;
-    }
-    else if (rc == SOCKET_ERROR) {
-      res = RLE_CONNECTION_ERROR;
-      break;
-    }
-
-    libssh2_session_auto_t sa;
-    if (!sa.session) {
-      res = RLE_LIBSSH2_SESSION_INIT;
-      break;
-    }
-
-    while ((rc = libssh2_session_handshake(sa.session, sock)) == LIBSSH2_ERROR_EAGAIN)
-      ; //wait
-
-    if (rc) {
-      return RLE_SESSION_HANDSHAKE;
-      res = RLE_SESSION_HANDSHAKE;
-      break;
-    }
-
-    while ((rc = pf_auth(sa.session, pf_auth_arg)) == LIBSSH2_ERROR_EAGAIN);
-
-    if (rc) {
-      res = RLE_SSH_AUTHENTICATION;
-      break;
-    }
-  } while (0);
-
-  #ifdef _WIN32
-    closesocket(sock);
-  #else
-    close(sock);
-  #endif
-  return res == RLE_SUCCESS ? exitcode : res;
-}
-
 int
-run_ssh_command_internal(const char *str_host,
-                         uint16_t port,
-                         const char *str_cmd,
-                         int conn_timeout,
-                         std::vector<std::string> &lst_out,
-                         int (*pf_auth)(LIBSSH2_SESSION*, const void *),
-                         void *pf_auth_arg) {
-  int rc = 0;
-  struct sockaddr_in sin;
-  unsigned long ul_host_addr = 0;
-  int exitcode = 0;
-  char *exitsignal = (char*)"none";
-
-
-#ifndef _WIN32
-  int sock;
-  ul_host_addr = inet_addr(str_host);
-#else
-  SOCKET sock;
-  ul_host_addr = inet_addr(str_host);
-#endif
-  sin.sin_family = AF_INET;
-  sin.sin_port = htons(port);
-  sin.sin_addr.s_addr = ul_host_addr;
-  sock = socket(AF_INET, SOCK_STREAM, 0);
-#ifdef _WIN32
-  u_long mode = 1;
-  ioctlsocket(sock, FIONBIO, &mode);
-#else
-  int flags = fcntl(sock, F_GETFL, 0);
-  flags |= O_NONBLOCK;
-#endif
-  connect(sock, (struct sockaddr*)(&sin), sizeof(struct sockaddr_in));
-  rc = wait_socket_connected(sock, conn_timeout);
-  run_libssh2_error_t res = RLE_SUCCESS;
-  do {
-    if (rc == 0) {
-      res = RLE_CONNECTION_TIMEOUT;
-      break;
-    }
-    else if (rc == SOCKET_ERROR) {
-      res = RLE_CONNECTION_ERROR;
-      break;
-    }
-
-    libssh2_session_auto_t sa;
-    if (!sa.session) {
-      return RLE_LIBSSH2_SESSION_INIT;
-    }
-
-    while ((rc = libssh2_session_handshake(sa.session, sock)) == LIBSSH2_ERROR_EAGAIN)
-      ; //wait
-
-    if (rc) {
-      res = RLE_SESSION_HANDSHAKE;
-      break;
-    }
-
-    do {
-      while ((rc = pf_auth(sa.session, pf_auth_arg)) == LIBSSH2_ERROR_EAGAIN)
-        ;
-
-      if (rc) {
-        res = RLE_SSH_AUTHENTICATION;
-        break;
-      }
-
-      LIBSSH2_CHANNEL *channel;
-      while ((channel = libssh2_channel_open_session(sa.session)) == nullptr &&
-             libssh2_session_last_error(sa.session, nullptr, nullptr, 0) == LIBSSH2_ERROR_EAGAIN) {
-        wait_ssh_socket_event(sock, sa.session);
-      }
-
-      if (channel == nullptr) {
-        res = RLE_LIBSSH2_CHANNEL_OPEN;
-        break;
-      }
-
-      while ((rc = libssh2_channel_exec(channel, str_cmd)) ==
-             LIBSSH2_ERROR_EAGAIN) {
-        wait_ssh_socket_event(sock, sa.session);
-      }
-
-      if (rc != 0) {
-        res = RLE_LIBSSH2_CHANNEL_EXEC;
-        break;
-      }
-
-      for (;;) {
-        /* loop until we block */
-        int f, l, r;
-        static char buffer[0x100] = {0};
-        f = l = 0;
-        r = -1;
-
-        while ((r = libssh2_channel_read(channel, &buffer[l], sizeof(buffer) - l - 1)) > 0) {
-          buffer[l+r] = 0;
-
-          for (; buffer[l]; ++l) {
-            if (buffer[l] != '\n') continue;
-            lst_out.push_back(std::string(&buffer[f], l-f));
-            f = l+1;
-          }
-
-          memcpy(buffer, &buffer[f], l-f);
-          l = l-f;
-          f = 0;
-        }
-
-        /* this is due to blocking that would occur otherwise so we loop on
-        this condition */
-        if (r != LIBSSH2_ERROR_EAGAIN)
-          break;
-        wait_ssh_socket_event(sock, sa.session);
-      }
-
-      exitcode = 127;
-      while ((rc = libssh2_channel_close(channel)) == LIBSSH2_ERROR_EAGAIN)
-        wait_ssh_socket_event(sock, sa.session);
-
-      if (rc == 0) {
-        exitcode = libssh2_channel_get_exit_status(channel);
-        libssh2_channel_get_exit_signal(channel, &exitsignal,
-                                        nullptr, nullptr, nullptr, nullptr, nullptr);
-      }
-
-      libssh2_channel_free(channel);
-      channel = nullptr;
-    } while (0);
-  } while(0);
-
-  #ifdef _WIN32
-    closesocket(sock);
-  #else
-    close(sock);
-  #endif
-  return res == RLE_SUCCESS ? exitcode : res;
+CLibsshController::run_ssh_command(const ssh_endpoint_t &endpoint,
+                                   const char *cmd,
+                                   int conn_timeout,
+                                   std::vector<std::string> &lst_out) {
+  if (m_initializer.result != 0) return RLE_LIBSSH2_INIT;
+  QString str_cmd = QString::fromUtf8(cmd);
+  QByteArray out;
+  int rc = CSshSessionPool::run(endpoint, conn_timeout, [&str_cmd, &out](CSshSession& session) {
+    out.clear();
+    return session.exec(str_cmd, out);
+  });
+  split_lines(out, lst_out);
+  return rc;
 }
 ////////////////////////////////////////////////////////////////////////////
 
@@ -376,16 +90,15 @@ CLibsshController::run_ssh_command_pass_auth(const char* host,
                                              const char* cmd,
                                              int conn_timeout,
                                              std::vector<std::string> &lst_out) {
-  if (m_initializer.result != 0) return RLE_LIBSSH2_INIT;
-  rsc_user_pass_arg_t arg;
-  memset(&arg, 0, sizeof(rsc_user_pass_arg_t));
-  arg.user = user;
-  arg.pass = pass;
-  qDebug() << user << " " << pass <<" " << cmd << conn_timeout;
-  SynchroPrimitives::Locker lock(&m_libssh_cs);
-  return run_ssh_command_internal(host, port, cmd, conn_timeout,
-                                  lst_out, user_pass_authentication, &arg);
+  ssh_endpoint_t endpoint;
+  endpoint.host = QString::fromUtf8(host);
+  endpoint.port = port;
+  endpoint.user = QString::fromUtf8(user);
+  endpoint.password = QString::fromUtf8(pass);
+  qDebug() << user << " " << cmd << conn_timeout;
+  return run_ssh_command(endpoint, cmd, conn_timeout, lst_out);
 }
+////////////////////////////////////////////////////////////////////////////
 
 int
 CLibsshController::check_auth_pass(const char* host,
@@ -394,39 +107,34 @@ CLibsshController::check_auth_pass(const char* host,
                                    const char* pass,
                                    int conn_timeout) {
   if (m_initializer.result != 0) return RLE_LIBSSH2_INIT;
-  rsc_user_pass_arg_t arg;
-  memset(&arg, 0, sizeof(rsc_user_pass_arg_t));
-  arg.user = user;
-  arg.pass = pass;
-  qDebug() << user << " " << pass  << conn_timeout;
-  SynchroPrimitives::Locker lock(&m_libssh_cs);
-  return check_auth_pass_internal(host, port, conn_timeout,
-                                  user_pass_authentication, &arg);
+  ssh_endpoint_t endpoint;
+  endpoint.host = QString::fromUtf8(host);
+  endpoint.port = port;
+  endpoint.user = QString::fromUtf8(user);
+  endpoint.password = QString::fromUtf8(pass);
+  qDebug() << user << conn_timeout;
+  // kept session is authenticated already, but host could go down since
+  return CSshSessionPool::run(endpoint, conn_timeout, [](CSshSession& session) {
+    return session.is_alive() ? 0 : (int)RLE_CONNECTION_ERROR;
+  });
 }
-
-
 ////////////////////////////////////////////////////////////////////////////
 
-
 int
 CLibsshController::run_ssh_command_key_auth(const char *host,
                                             uint16_t port,
-                                            const char *pub_file,
+                                            const char *user,
                                             const char *pr_file,
                                             const char *passphrase,
                                             const char *cmd,
                                             int conn_timeout,
                                             std::vector<std::string> &lst_out) {
-  if (m_initializer.result != 0) return RLE_LIBSSH2_INIT;
-  rsc_pub_key_arg_t arg;
-  memset(&arg, 0, sizeof(rsc_pub_key_arg_t));
-  arg.passphrase = passphrase;
-  arg.privae_file = pr_file;
-  arg.pub_file = pub_file;
-  SynchroPrimitives::Locker lock(&m_libssh_cs);
-  return run_ssh_command_internal(host, port, cmd, conn_timeout,
-                                  lst_out, key_pub_authentication, &arg);
+  ssh_endpoint_t endpoint;
+  endpoint.host = QString::fromUtf8(host);
+  endpoint.port = port;
+  endpoint.user = QString::fromUtf8(user);
+  endpoint.private_key = QString::fromLocal8Bit(pr_file);
+  endpoint.passphrase = QString::fromUtf8(passphrase);
+  return run_ssh_command(endpoint, cmd, conn_timeout, lst_out);
 }
-
-
 ////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,239 @@
+#include "SftpBrowser.h"
+#include "LibsshController.h"
+
+#include <algorithm>
+#include <QDebug>
+#include <QElapsedTimer>
+
+const int CSftpBrowser::PAGE_SIZE;
+const int CSftpBrowser::DEFAULT_CACHE_TTL_MS;
+const int CSftpBrowser::MAX_CACHED_ENTRIES;
+const int CSftpBrowser::STOP_CHECK_INTERVAL_MS;
+QMutex CSftpBrowser::m_mutex;
+QHash<QString, std::shared_ptr<CSshSession> > CSftpBrowser::m_sessions;
+QHash<QString, CSftpBrowser::cached_dir_t> CSftpBrowser::m_cache;
+int CSftpBrowser::m_cached_entries = 0;
+int CSftpBrowser::m_cache_ttl_ms = CSftpBrowser::DEFAULT_CACHE_TTL_MS;
+
+/* "/usr/bin/" and "/usr/bin" is the same directory */
+static QString
+normalized_dir(const QString& dir) {
+  QString res = dir.isEmpty() ? QString("/") : dir;
+  while (res.size() > 1 && res.endsWith('/')) res.chop(1);
+  return res;
+}
+////////////////////////////////////////////////////////////////////////////
+
+QString
+CSftpBrowser::cache_key(const ssh_endpoint_t &endpoint,
+                        const QString &remote_dir) {
+  return endpoint.key() + "\n" + normalized_dir(remote_dir);
+}
+////////////////////////////////////////////////////////////////////////////
+
+qint64
+CSftpBrowser::now_ms() {
+  static QElapsedTimer clock;
+  static QMutex clock_mutex;
+  QMutexLocker locker(&clock_mutex);
+  if (!clock.isValid()) clock.start();
+  return clock.elapsed();
+}
+////////////////////////////////////////////////////////////////////////////
+
+bool
+CSftpBrowser::is_connection_error(int rc) {
+  switch (rc) {
+    case RLE_LIBSSH2_INIT:
+    case RLE_LIBSSH2_SESSION_INIT:
+    case RLE_SESSION_HANDSHAKE:
+    case RLE_SSH_AUTHENTICATION:  // libssh2 doesn't read some key formats
+    case RLE_SFTP_INIT:
+      return true;
+    default:
+      return false;
+  }
+}
+////////////////////////////////////////////////////////////////////////////
+
+int
+CSftpBrowser::read_dir(const ssh_endpoint_t &endpoint,
+                       const QString &remote_dir,
+                       std::vector<sftp_entry_t> &entries,
+                       stop_check_t stop) {
+  std::shared_ptr<CSshSession> session;
+  {
+    QMutexLocker locker(&m_mutex);
+    std::shared_ptr<CSshSession>& kept = m_sessions[endpoint.key()];
+    if (!kept) kept = std::make_shared<CSshSession>(endpoint);
+    session = kept;
+  }
+
+  // previous listing may be connecting, waiting for it is stopped too
+  while (!session->mutex()->tryLock(STOP_CHECK_INTERVAL_MS)) {
+    if (stop && stop()) return RLE_CANCELLED;
+  }
+  int rc = read_dir_locked(*session, remote_dir, entries, stop);
+  session->mutex()->unlock();
+  return rc;
+}
+////////////////////////////////////////////////////////////////////////////
+
+int
+CSftpBrowser::read_dir_locked(CSshSession &session,
+                              const QString &remote_dir,
+                              std::vector<sftp_entry_t> &entries,
+                              stop_check_t stop) {
+  bool reused = session.is_open();
+  for (int attempt = 0; ; ++attempt) {
+    // connection takes up to CONNECTION_TIMEOUT_SEC, don't start it for nobody
+    if (stop && stop()) return RLE_CANCELLED;
+    if (!session.is_open()) {
+      int rc = session.open(CSftpTransfer::CONNECTION_TIMEOUT_SEC);
+      if (rc != RLE_SUCCESS) return rc;
+      if (!session.sftp()) {
+        session.close();
+        return RLE_SFTP_INIT;
+      }
+    }
+
+    entries.clear();
+    int rc = CSftpTransfer::list_dir(session, normalized_dir(remote_dir),
+                                     [&entries, &stop](const sftp_entry_t& entry) {
+      if (stop && stop()) return false;
+      entries.push_back(entry);
+      return true;
+    });
+    if (rc == RLE_SUCCESS || rc == RLE_CANCELLED || session.is_alive())
+      return rc;
+    // kept session could die while user looked at previous directory
+    session.close();
+    if (!reused || attempt > 0) return rc;
+    qDebug() << "sftp browsing session to" << session.endpoint().host << "is dead, reconnecting";
+  }
+}
+////////////////////////////////////////////////////////////////////////////
+
+int
+CSftpBrowser::list(const ssh_endpoint_t &endpoint,
+                   const QString &remote_dir,
+                   page_handler_t on_page,
+                   int page_size,
+                   stop_check_t stop) {
+  if (page_size <= 0) page_size = PAGE_SIZE;
+  if (stop && stop()) return RLE_CANCELLED;
+  QString key = cache_key(endpoint, remote_dir);
+  std::vector<sftp_entry_t> entries;
+  bool cached = false;
+  {
+    QMutexLocker locker(&m_mutex);
+    auto it = m_cache.find(key);
+    if (it != m_cache.end()) {
+      if (now_ms() - it->read_at <= m_cache_ttl_ms) {
+        entries = it->entries;
+        cached = true;
+      } else {
+        drop_cached(it);
+      }
+    }
+  }
+
+  if (!cached) {
+    int rc = read_dir(endpoint, remote_dir, entries, stop);
+    if (rc == RLE_CANCELLED) return rc;
+    if (rc != RLE_SUCCESS) {
+      qCritical() << "sftp listing of" << remote_dir << "on" << endpoint.host << "failed:"
+                  << CLibsshController::run_libssh2_error_to_str((run_libssh2_error_t)rc);
+      return rc;
+    }
+    // like ls does
+    std::sort(entries.begin(), entries.end(),
+              [](const sftp_entry_t& l, const sftp_entry_t& r) {
+      return l.name < r.name;
+    });
+
+    QMutexLocker locker(&m_mutex);
+    auto old = m_cache.find(key);
+    if (old != m_cache.end()) drop_cached(old);
+    if ((int)entries.size() <= MAX_CACHED_ENTRIES) {
+      while (m_cached_entries + (int)entries.size() > MAX_CACHED_ENTRIES) {
+        auto oldest = m_cache.begin();
+        for (auto i = m_cache.begin(); i != m_cache.end(); ++i)
+          if (i->read_at < oldest->read_at) oldest = i;
+        drop_cached(oldest);
+      }
+      cached_dir_t& dir = m_cache[key];
+      dir.endpoint = endpoint;
+      dir.entries = entries;
+      dir.read_at = now_ms();
+      m_cached_entries += (int)entries.size();
+    }
+  }
+
+  if (entries.empty()) {
+    on_page(entries);
+    return RLE_SUCCESS;
+  }
+  for (size_t from = 0; from < entries.size(); from += (size_t)page_size) {
+    size_t to = std::min(entries.size(), from + (size_t)page_size);
+    std::vector<sftp_entry_t> page(entries.begin() + from, entries.begin() + to);
+    if (!on_page(page)) return RLE_CANCELLED;
+  }
+  return RLE_SUCCESS;
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CSftpBrowser::invalidate(const ssh_endpoint_t &endpoint,
+                         const QString &remote_dir) {
+  QMutexLocker locker(&m_mutex);
+  auto it = m_cache.find(cache_key(endpoint, remote_dir));
+  if (it != m_cache.end()) drop_cached(it);
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CSftpBrowser::close_sessions(const QString &host) {
+  QMutexLocker locker(&m_mutex);
+  for (auto i = m_sessions.begin(); i != m_sessions.end(); ) {
+    if (i.value()->endpoint().host == host) i = m_sessions.erase(i);
+    else ++i;
+  }
+  for (auto i = m_cache.begin(); i != m_cache.end(); ) {
+    if (i->endpoint.host != host) {
+      ++i;
+      continue;
+    }
+    m_cached_entries -= (int)i->entries.size();
+    i = m_cache.erase(i);
+  }
+}
+////////////////////////////////////////////////////////////////////////////
+
+int
+CSftpBrowser::cached_dirs_count() {
+  QMutexLocker locker(&m_mutex);
+  return m_cache.size();
+}
+////////////////////////////////////////////////////////////////////////////
+
+int
+CSftpBrowser::cache_ttl() {
+  QMutexLocker locker(&m_mutex);
+  return m_cache_ttl_ms;
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CSftpBrowser::set_cache_ttl(int ttl_ms) {
+  QMutexLocker locker(&m_mutex);
+  m_cache_ttl_ms = ttl_ms;
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CSftpBrowser::drop_cached(QHash<QString, cached_dir_t>::iterator it) {
+  m_cached_entries -= (int)it->entries.size();
+  m_cache.erase(it);
+}
+////////////////////////////////////////////////////////////////////////////
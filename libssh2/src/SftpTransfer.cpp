@@ -0,0 +1,576 @@
+#include "SftpTransfer.h"
+#include "ChunkedTransfer.h"
+#include "DeltaUpload.h"
+#include "LibsshController.h"
+
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <iterator>
+#include <utility>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+
+#ifdef _WIN32
+#include <sys/utime.h>
+#else
+#include <utime.h>
+#endif
+
+const int CSftpTransfer::CHUNK_SIZE;
+const int CSftpTransfer::CONNECTION_TIMEOUT_SEC;
+const int CSftpTransfer::MAX_SESSIONS_PER_ENDPOINT;
+QMutex CSftpTransfer::m_sessions_mutex;
+QHash<QString, std::vector<std::shared_ptr<CSshSession> > > CSftpTransfer::m_sessions;
+
+struct transfer_item_t {
+  QString source;
+  QString destination;
+  sftp_entry_t entry;
+};
+////////////////////////////////////////////////////////////////////////////
+
+static unsigned long
+posix_permissions(QFileDevice::Permissions perm) {
+  static const std::pair<QFileDevice::Permission, unsigned long> bits[] = {
+    {QFileDevice::ReadOwner, 0400}, {QFileDevice::WriteOwner, 0200}, {QFileDevice::ExeOwner, 0100},
+    {QFileDevice::ReadGroup, 0040}, {QFileDevice::WriteGroup, 0020}, {QFileDevice::ExeGroup, 0010},
+    {QFileDevice::ReadOther, 0004}, {QFileDevice::WriteOther, 0002}, {QFileDevice::ExeOther, 0001},
+  };
+  unsigned long res = 0;
+  for (auto i = std::begin(bits); i != std::end(bits); ++i)
+    if (perm & i->first) res |= i->second;
+  return res;
+}
+////////////////////////////////////////////////////////////////////////////
+
+static QFileDevice::Permissions
+qt_permissions(unsigned long mode) {
+  QFileDevice::Permissions res = 0;
+  if (mode & 0400) res |= QFileDevice::ReadOwner | QFileDevice::ReadUser;
+  if (mode & 0200) res |= QFileDevice::WriteOwner | QFileDevice::WriteUser;
+  if (mode & 0100) res |= QFileDevice::ExeOwner | QFileDevice::ExeUser;
+  if (mode & 0040) res |= QFileDevice::ReadGroup;
+  if (mode & 0020) res |= QFileDevice::WriteGroup;
+  if (mode & 0010) res |= QFileDevice::ExeGroup;
+  if (mode & 0004) res |= QFileDevice::ReadOther;
+  if (mode & 0002) res |= QFileDevice::WriteOther;
+  if (mode & 0001) res |= QFileDevice::ExeOther;
+  return res;
+}
+////////////////////////////////////////////////////////////////////////////
+
+static void
+set_local_mtime(const QString& path,
+                quint64 mtime) {
+#ifdef _WIN32
+  struct _utimbuf times;
+  times.actime = times.modtime = (time_t)mtime;
+  _wutime((const wchar_t*)path.utf16(), &times);
+#else
+  struct utimbuf times;
+  times.actime = times.modtime = (time_t)mtime;
+  utime(QFile::encodeName(path).constData(), &times);
+#endif
+}
+////////////////////////////////////////////////////////////////////////////
+
+static sftp_entry_t
+local_entry(const QFileInfo& fi) {
+  sftp_entry_t entry;
+  entry.name = fi.fileName();
+  entry.dir = fi.isDir();
+  entry.size = entry.dir ? 0 : (quint64)fi.size();
+  entry.permissions = posix_permissions(fi.permissions());
+  entry.mtime = (quint64)(fi.lastModified().toMSecsSinceEpoch() / 1000);
+  return entry;
+}
+////////////////////////////////////////////////////////////////////////////
+
+/* like scp -p, open() mode is masked by umask of server */
+static void
+set_remote_attributes(LIBSSH2_SFTP* sftp,
+                      const QByteArray& path,
+                      const sftp_entry_t& entry) {
+  LIBSSH2_SFTP_ATTRIBUTES attrs;
+  memset(&attrs, 0, sizeof(attrs));
+  attrs.flags = LIBSSH2_SFTP_ATTR_PERMISSIONS | LIBSSH2_SFTP_ATTR_ACMODTIME;
+  attrs.permissions = entry.permissions;
+  attrs.atime = attrs.mtime = (unsigned long)entry.mtime;
+  libssh2_sftp_stat_ex(sftp, path.constData(), (unsigned int)path.size(),
+                       LIBSSH2_SFTP_SETSTAT, &attrs);
+}
+////////////////////////////////////////////////////////////////////////////
+
+static void
+set_local_attributes(const QString& path,
+                     const sftp_entry_t& entry) {
+  QFile::setPermissions(path, qt_permissions(entry.permissions));
+  set_local_mtime(path, entry.mtime);
+}
+////////////////////////////////////////////////////////////////////////////
+
+static sftp_entry_t
+remote_entry(const QString& name,
+             const LIBSSH2_SFTP_ATTRIBUTES& attrs) {
+  sftp_entry_t entry;
+  entry.name = name;
+  if (attrs.flags & LIBSSH2_SFTP_ATTR_PERMISSIONS) {
+    entry.permissions = attrs.permissions & 07777;
+    entry.dir = LIBSSH2_SFTP_S_ISDIR(attrs.permissions);
+  }
+  if (attrs.flags & LIBSSH2_SFTP_ATTR_SIZE) entry.size = attrs.filesize;
+  if (attrs.flags & LIBSSH2_SFTP_ATTR_ACMODTIME) entry.mtime = attrs.mtime;
+  return entry;
+}
+////////////////////////////////////////////////////////////////////////////
+
+QString
+CSftpTransfer::join(const QString &dir,
+                    const QString &name) {
+  if (dir.isEmpty()) return name;
+  return dir.endsWith('/') ? dir + name : dir + "/" + name;
+}
+////////////////////////////////////////////////////////////////////////////
+
+int
+CSftpTransfer::sftp_error(CSshSession &session,
+                          int def_error) {
+  if (session.session() &&
+      libssh2_session_last_errno(session.session()) == LIBSSH2_ERROR_SFTP_PROTOCOL &&
+      libssh2_sftp_last_error(session.sftp()) == LIBSSH2_FX_PERMISSION_DENIED)
+    return RLE_SFTP_PERMISSION_DENIED;
+  return def_error;
+}
+////////////////////////////////////////////////////////////////////////////
+
+int
+CSftpTransfer::with_session(const ssh_endpoint_t &endpoint,
+                            operation_t operation) {
+  std::shared_ptr<CSshSession> session;
+  bool locked = false;
+  {
+    QMutexLocker locker(&m_sessions_mutex);
+    std::vector<std::shared_ptr<CSshSession> >& kept = m_sessions[endpoint.key()];
+    for (auto i = kept.begin(); i != kept.end() && !locked; ++i) {
+      if (!(*i)->mutex()->tryLock()) continue;
+      session = *i;
+      locked = true;
+    }
+    if (!locked && (int)kept.size() < MAX_SESSIONS_PER_ENDPOINT) {
+      session = std::make_shared<CSshSession>(endpoint);
+      session->mutex()->lock();
+      locked = true;
+      kept.push_back(session);
+    }
+    // all sessions are busy, waiting callers are spread over them
+    static size_t next_busy = 0;
+    if (!locked) session = kept[next_busy++ % kept.size()];
+  }
+
+  if (!locked) session->mutex()->lock();
+  int rc = run_locked(*session, operation);
+  session->mutex()->unlock();
+  return rc;
+}
+////////////////////////////////////////////////////////////////////////////
+
+int
+CSftpTransfer::run_locked(CSshSession &session,
+                          operation_t operation) {
+  bool reused = session.is_open();
+  for (int attempt = 0; ; ++attempt) {
+    if (!session.is_open()) {
+      int rc = session.open(CONNECTION_TIMEOUT_SEC);
+      if (rc != RLE_SUCCESS) return rc;
+      if (!session.sftp()) {
+        session.close();
+        return RLE_SFTP_INIT;
+      }
+    }
+
+    int rc = operation(session);
+    if (rc == RLE_SUCCESS || rc == RLE_CANCELLED || session.is_alive())
+      return rc;
+    // connection is broken, kept session could die while it was idle
+    session.close();
+    if (!reused || attempt > 0) return rc;
+    qDebug() << "sftp session to" << session.endpoint().host << "is dead, reconnecting";
+  }
+}
+////////////////////////////////////////////////////////////////////////////
+
+int
+CSftpTransfer::upload(const ssh_endpoint_t &endpoint,
+                      const QString &local_path,
+                      const QString &remote_dir,
+                      sftp_progress_t progress,
+                      const QAtomicInt *cancel) {
+  QFileInfo root(local_path);
+  if (!root.exists()) return RLE_LOCAL_FILE;
+
+  std::vector<transfer_item_t> items;
+  quint64 total = 0;
+  transfer_item_t root_item;
+  root_item.source = root.absoluteFilePath();
+  root_item.destination = join(remote_dir, root.fileName());
+  root_item.entry = local_entry(root);
+  items.push_back(root_item);
+
+  if (root.isDir()) {
+    QDir base(root.absoluteFilePath());
+    QDirIterator it(root.absoluteFilePath(),
+                    QDir::AllEntries | QDir::NoDotAndDotDot | QDir::Hidden | QDir::System,
+                    QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+      it.next();
+      transfer_item_t item;
+      item.source = it.fileInfo().absoluteFilePath();
+      item.destination = join(root_item.destination, base.relativeFilePath(item.source));
+      item.entry = local_entry(it.fileInfo());
+      items.push_back(item);
+    }
+    // parent directory goes before its content
+    std::sort(items.begin() + 1, items.end(),
+              [](const transfer_item_t& l, const transfer_item_t& r) {
+      return l.destination < r.destination;
+    });
+  }
+  for (auto i = items.begin(); i != items.end(); ++i)
+    total += i->entry.size;
+
+  return with_session(endpoint, [&](CSshSession& session) {
+    quint64 done_before = 0;
+    for (auto i = items.begin(); i != items.end(); ++i) {
+      if (cancel && cancel->load()) return (int)RLE_CANCELLED;
+      int rc;
+      if (i->entry.dir) {
+        rc = make_dir(session, i->destination, i->entry.permissions);
+      } else {
+        rc = upload_file(session, i->source, i->destination,
+                         [&progress, done_before, total](quint64 done, quint64) {
+          if (progress) progress(done_before + done, total);
+        }, cancel);
+        done_before += i->entry.size;
+      }
+      if (rc != RLE_SUCCESS) {
+        qCritical() << "sftp upload of" << i->source << "to" << i->destination << "failed:"
+                    << CLibsshController::run_libssh2_error_to_str((run_libssh2_error_t)rc);
+        return rc;
+      }
+    }
+    return (int)RLE_SUCCESS;
+  });
+}
+////////////////////////////////////////////////////////////////////////////
+
+int
+CSftpTransfer::download(const ssh_endpoint_t &endpoint,
+                        const QString &remote_path,
+                        const QString &local_dir,
+                        sftp_progress_t progress,
+                        const QAtomicInt *cancel) {
+  QString path = remote_path;
+  while (path.size() > 1 && path.endsWith('/')) path.chop(1);
+
+  return with_session(endpoint, [&](CSshSession& session) {
+    transfer_item_t root_item;
+    int rc = stat(session, path, root_item.entry);
+    if (rc != RLE_SUCCESS) return rc;
+    root_item.source = path;
+    root_item.destination = QDir(local_dir).filePath(root_item.entry.name);
+
+    std::vector<transfer_item_t> items(1, root_item);
+    std::deque<size_t> dirs;
+    if (root_item.entry.dir) dirs.push_back(0);
+    while (!dirs.empty()) {
+      transfer_item_t dir = items[dirs.front()];
+      dirs.pop_front();
+      std::vector<sftp_entry_t> entries;
+      if ((rc = list_dir(session, dir.source, entries)) != RLE_SUCCESS) return rc;
+      for (auto i = entries.begin(); i != entries.end(); ++i) {
+        transfer_item_t item;
+        item.source = join(dir.source, i->name);
+        item.destination = QDir(dir.destination).filePath(i->name);
+        item.entry = *i;
+        items.push_back(item);
+        if (i->dir) dirs.push_back(items.size() - 1);
+      }
+    }
+
+    quint64 total = 0, done_before = 0;
+    for (auto i = items.begin(); i != items.end(); ++i)
+      total += i->entry.dir ? 0 : i->entry.size;
+
+    for (auto i = items.begin(); i != items.end(); ++i) {
+      if (cancel && cancel->load()) return (int)RLE_CANCELLED;
+      if (i->entry.dir) {
+        if (!QDir().mkpath(i->destination)) return (int)RLE_LOCAL_FILE;
+        continue;
+      }
+      rc = download_file(session, i->source, i->destination,
+                         [&progress, done_before, total](quint64 done, quint64) {
+        if (progress) progress(done_before + done, total);
+      }, cancel);
+      done_before += i->entry.size;
+      if (rc != RLE_SUCCESS) {
+        qCritical() << "sftp download of" << i->source << "to" << i->destination << "failed:"
+                    << CLibsshController::run_libssh2_error_to_str((run_libssh2_error_t)rc);
+        return rc;
+      }
+    }
+    // directories get their permissions and times when content is written
+    for (auto i = items.rbegin(); i != items.rend(); ++i) {
+      if (i->entry.dir) set_local_attributes(i->destination, i->entry);
+    }
+    return (int)RLE_SUCCESS;
+  });
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CSftpTransfer::close_sessions(const QString &host) {
+  QMutexLocker locker(&m_sessions_mutex);
+  for (auto i = m_sessions.begin(); i != m_sessions.end(); ) {
+    if (!i.value().empty() && i.value().front()->endpoint().host == host)
+      i = m_sessions.erase(i);
+    else
+      ++i;
+  }
+}
+////////////////////////////////////////////////////////////////////////////
+
+int
+CSftpTransfer::sessions_count() {
+  QMutexLocker locker(&m_sessions_mutex);
+  int count = 0;
+  for (auto i = m_sessions.begin(); i != m_sessions.end(); ++i)
+    count += (int)i.value().size();
+  return count;
+}
+////////////////////////////////////////////////////////////////////////////
+
+int
+CSftpTransfer::upload_file(CSshSession &session,
+                           const QString &local_file,
+                           const QString &remote_file,
+                           sftp_progress_t progress,
+                           const QAtomicInt *cancel) {
+  LIBSSH2_SFTP* sftp = session.sftp();
+  if (!sftp) return RLE_SFTP_INIT;
+  sftp_entry_t entry = local_entry(QFileInfo(local_file));
+  QByteArray path = remote_file.toUtf8();
+
+  // new version of file which is on container already
+  if (entry.size >= CDeltaUpload::MIN_FILE_SIZE) {
+    CDeltaUpload delta;
+    int rc = delta.upload(session, local_file, remote_file, progress, cancel);
+    if (rc == RLE_SUCCESS) {
+      qDebug() << "delta upload of" << local_file << "sent" << delta.literal_bytes()
+               << "of" << entry.size << "bytes";
+      set_remote_attributes(sftp, path, entry);
+      return RLE_SUCCESS;
+    }
+    if (rc == RLE_CANCELLED) return rc;
+    if (rc != RLE_DELTA_UNUSABLE)
+      qWarning() << "delta upload of" << local_file << "failed:"
+                 << CLibsshController::run_libssh2_error_to_str((run_libssh2_error_t)rc)
+                 << ", whole file is sent";
+  }
+
+  if (entry.size > CChunkedTransfer::DEFAULT_CHUNK_SIZE) {
+    CChunkedTransfer chunked;
+    int rc = chunked.upload(session, local_file, remote_file, progress, cancel);
+    if (rc != RLE_SUCCESS) return rc;
+    set_remote_attributes(sftp, path, entry);
+    return RLE_SUCCESS;
+  }
+
+  QFile file(local_file);
+  if (!file.open(QIODevice::ReadOnly)) return RLE_LOCAL_FILE;
+  LIBSSH2_SFTP_HANDLE* handle =
+      libssh2_sftp_open_ex(sftp, path.constData(), (unsigned int)path.size(),
+                           LIBSSH2_FXF_WRITE | LIBSSH2_FXF_CREAT | LIBSSH2_FXF_TRUNC,
+                           (long)entry.permissions, LIBSSH2_SFTP_OPENFILE);
+  if (!handle) return sftp_error(session, RLE_SFTP_OPEN);
+
+  QByteArray buffer(CHUNK_SIZE, 0);
+  quint64 done = 0;
+  int rc = RLE_SUCCESS;
+  while (rc == RLE_SUCCESS) {
+    if (cancel && cancel->load()) {
+      rc = RLE_CANCELLED;
+      break;
+    }
+    qint64 n = file.read(buffer.data(), CHUNK_SIZE);
+    if (n < 0) rc = RLE_LOCAL_FILE;
+    if (n <= 0) break;
+
+    const char* data = buffer.constData();
+    while (n > 0) {
+      ssize_t written = libssh2_sftp_write(handle, data, (size_t)n);
+      if (written < 0) {
+        rc = sftp_error(session, RLE_SFTP_WRITE);
+        break;
+      }
+      data += written;
+      n -= written;
+      done += (quint64)written;
+    }
+    if (progress) progress(done, entry.size);
+  }
+  libssh2_sftp_close_handle(handle);
+  if (rc != RLE_SUCCESS) return rc;
+  if (progress && entry.size == 0) progress(0, 0);
+  set_remote_attributes(sftp, path, entry);
+  return RLE_SUCCESS;
+}
+////////////////////////////////////////////////////////////////////////////
+
+int
+CSftpTransfer::download_file(CSshSession &session,
+                             const QString &remote_file,
+                             const QString &local_file,
+                             sftp_progress_t progress,
+                             const QAtomicInt *cancel) {
+  LIBSSH2_SFTP* sftp = session.sftp();
+  if (!sftp) return RLE_SFTP_INIT;
+  sftp_entry_t entry;
+  int rc = stat(session, remote_file, entry);
+  if (rc != RLE_SUCCESS) return rc;
+
+  if (entry.size > CChunkedTransfer::DEFAULT_CHUNK_SIZE) {
+    CChunkedTransfer chunked;
+    rc = chunked.download(session, remote_file, local_file, progress, cancel);
+    if (rc != RLE_SUCCESS) return rc;
+    set_local_attributes(local_file, entry);
+    return RLE_SUCCESS;
+  }
+
+  QByteArray path = remote_file.toUtf8();
+  LIBSSH2_SFTP_HANDLE* handle =
+      libssh2_sftp_open_ex(sftp, path.constData(), (unsigned int)path.size(),
+                           LIBSSH2_FXF_READ, 0, LIBSSH2_SFTP_OPENFILE);
+  if (!handle) return sftp_error(session, RLE_SFTP_OPEN);
+
+  QFile file(local_file);
+  if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+    libssh2_sftp_close_handle(handle);
+    return RLE_LOCAL_FILE;
+  }
+
+  QByteArray buffer(CHUNK_SIZE, 0);
+  quint64 done = 0;
+  while (rc == RLE_SUCCESS) {
+    if (cancel && cancel->load()) {
+      rc = RLE_CANCELLED;
+      break;
+    }
+    ssize_t n = libssh2_sftp_read(handle, buffer.data(), CHUNK_SIZE);
+    if (n < 0) rc = sftp_error(session, RLE_SFTP_READ);
+    if (n <= 0) break;
+    if (file.write(buffer.constData(), n) != n) {
+      rc = RLE_LOCAL_FILE;
+      break;
+    }
+    done += (quint64)n;
+    if (progress) progress(done, entry.size);
+  }
+  libssh2_sftp_close_handle(handle);
+  file.close();
+  if (rc != RLE_SUCCESS) return rc;
+  if (progress && done == 0) progress(0, 0);
+  set_local_attributes(local_file, entry);
+  return RLE_SUCCESS;
+}
+////////////////////////////////////////////////////////////////////////////
+
+int
+CSftpTransfer::stat(CSshSession &session,
+                    const QString &remote_path,
+                    sftp_entry_t &entry) {
+  LIBSSH2_SFTP* sftp = session.sftp();
+  if (!sftp) return RLE_SFTP_INIT;
+  QByteArray path = remote_path.toUtf8();
+  LIBSSH2_SFTP_ATTRIBUTES attrs;
+  memset(&attrs, 0, sizeof(attrs));
+  if (libssh2_sftp_stat_ex(sftp, path.constData(), (unsigned int)path.size(),
+                           LIBSSH2_SFTP_STAT, &attrs) != 0)
+    return sftp_error(session, RLE_SFTP_OPEN);
+  QString name = remote_path;
+  while (name.size() > 1 && name.endsWith('/')) name.chop(1);
+  entry = remote_entry(name.section('/', -1), attrs);
+  return RLE_SUCCESS;
+}
+////////////////////////////////////////////////////////////////////////////
+
+int
+CSftpTransfer::list_dir(CSshSession &session,
+                        const QString &remote_dir,
+                        std::vector<sftp_entry_t> &entries) {
+  return list_dir(session, remote_dir, [&entries](const sftp_entry_t& entry) {
+    entries.push_back(entry);
+    return true;
+  });
+}
+////////////////////////////////////////////////////////////////////////////
+
+int
+CSftpTransfer::list_dir(CSshSession &session,
+                        const QString &remote_dir,
+                        std::function<bool(const sftp_entry_t&)> on_entry) {
+  LIBSSH2_SFTP* sftp = session.sftp();
+  if (!sftp) return RLE_SFTP_INIT;
+  QByteArray path = remote_dir.toUtf8();
+  LIBSSH2_SFTP_HANDLE* handle =
+      libssh2_sftp_open_ex(sftp, path.constData(), (unsigned int)path.size(),
+                           0, 0, LIBSSH2_SFTP_OPENDIR);
+  if (!handle) return sftp_error(session, RLE_SFTP_OPEN);
+
+  char name[4096];
+  LIBSSH2_SFTP_ATTRIBUTES attrs;
+  int rc;
+  while ((rc = libssh2_sftp_readdir_ex(handle, name, sizeof(name), nullptr, 0, &attrs)) > 0) {
+    QString str_name = QString::fromUtf8(name, rc);
+    if (str_name == "." || str_name == "..") continue;
+    sftp_entry_t entry = remote_entry(str_name, attrs);
+    // readdir doesn't follow links, broken link stays as file
+    if ((attrs.flags & LIBSSH2_SFTP_ATTR_PERMISSIONS) &&
+        LIBSSH2_SFTP_S_ISLNK(attrs.permissions)) {
+      sftp_entry_t target;
+      if (stat(session, join(remote_dir, str_name), target) == RLE_SUCCESS) {
+        target.name = str_name;
+        entry = target;
+      }
+    }
+    if (!on_entry(entry)) {
+      libssh2_sftp_close_handle(handle);
+      return RLE_CANCELLED;
+    }
+  }
+  libssh2_sftp_close_handle(handle);
+  return rc < 0 ? sftp_error(session, RLE_SFTP_READ) : (int)RLE_SUCCESS;
+}
+////////////////////////////////////////////////////////////////////////////
+
+int
+CSftpTransfer::make_dir(CSshSession &session,
+                        const QString &remote_dir,
+                        unsigned long permissions) {
+  LIBSSH2_SFTP* sftp = session.sftp();
+  if (!sftp) return RLE_SFTP_INIT;
+  QByteArray path = remote_dir.toUtf8();
+  if (libssh2_sftp_mkdir_ex(sftp, path.constData(), (unsigned int)path.size(),
+                            (long)permissions) == 0)
+    return RLE_SUCCESS;
+  int rc = sftp_error(session, RLE_SFTP_OPEN);
+  sftp_entry_t entry;
+  if (stat(session, remote_dir, entry) == RLE_SUCCESS && entry.dir)
+    return RLE_SUCCESS;
+  return rc;
+}
+////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,272 @@
+#include "SshSession.h"
+#include "LibsshController.h"
+
+#include <cstring>
+#include <QCryptographicHash>
+#include <QDebug>
+#include <QFile>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+const int CSshSession::DEFAULT_TIMEOUT_MS;
+
+#ifdef _WIN32
+static const uintptr_t NO_SOCKET = (uintptr_t)INVALID_SOCKET;
+#else
+static const int NO_SOCKET = -1;
+#endif
+
+QString
+ssh_endpoint_t::key() const {
+  // password isn't kept in key as is
+  QString secret = password.isEmpty() ? private_key :
+    QString(QCryptographicHash::hash(password.toUtf8(), QCryptographicHash::Sha1).toHex());
+  return QString("%1@%2:%3|%4").arg(user, host).arg(port).arg(secret);
+}
+////////////////////////////////////////////////////////////////////////////
+
+CSshSession::CSshSession(const ssh_endpoint_t &endpoint) :
+  m_endpoint(endpoint),
+  m_timeout_ms(DEFAULT_TIMEOUT_MS),
+  m_socket(NO_SOCKET),
+  m_session(nullptr),
+  m_sftp(nullptr) {
+}
+
+CSshSession::~CSshSession() {
+  close();
+}
+////////////////////////////////////////////////////////////////////////////
+
+static void
+close_socket(uintptr_t sock) {
+#ifdef _WIN32
+  closesocket((SOCKET)sock);
+#else
+  ::close((int)sock);
+#endif
+}
+////////////////////////////////////////////////////////////////////////////
+
+/* non blocking connect limited by timeout, socket is blocking after it */
+static int
+connect_socket(const QString& host,
+               uint16_t port,
+               int conn_timeout_sec,
+               uintptr_t& out_sock) {
+  struct addrinfo hints, *addr = nullptr;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_STREAM;
+  if (getaddrinfo(host.toUtf8().constData(),
+                  QByteArray::number(port).constData(), &hints, &addr) != 0 || !addr)
+    return RLE_INET_ADDR;
+
+#ifdef _WIN32
+  SOCKET sock = socket(addr->ai_family, addr->ai_socktype, addr->ai_protocol);
+  if (sock == INVALID_SOCKET) {
+    freeaddrinfo(addr);
+    return RLE_CONNECTION_ERROR;
+  }
+  u_long mode = 1;
+  ioctlsocket(sock, FIONBIO, &mode);
+#else
+  int sock = socket(addr->ai_family, addr->ai_socktype, addr->ai_protocol);
+  if (sock < 0) {
+    freeaddrinfo(addr);
+    return RLE_CONNECTION_ERROR;
+  }
+  int flags = fcntl(sock, F_GETFL, 0);
+  fcntl(sock, F_SETFL, flags | O_NONBLOCK);
+#endif
+  ::connect(sock, addr->ai_addr, (int)addr->ai_addrlen);
+  freeaddrinfo(addr);
+
+  struct timeval timeout;
+  timeout.tv_sec = conn_timeout_sec;
+  timeout.tv_usec = 0;
+  fd_set wfd, efd;
+  FD_ZERO(&wfd);
+  FD_SET(sock, &wfd);
+  FD_ZERO(&efd);
+  FD_SET(sock, &efd);
+  int rc = select((int)sock + 1, nullptr, &wfd, &efd, &timeout);
+
+  int so_error = 0;
+  socklen_t len = sizeof(so_error);
+  if (rc > 0)
+    getsockopt(sock, SOL_SOCKET, SO_ERROR, (char*)&so_error, &len);
+
+  if (rc <= 0 || so_error != 0 || FD_ISSET(sock, &efd)) {
+    close_socket((uintptr_t)sock);
+    return rc == 0 ? RLE_CONNECTION_TIMEOUT : RLE_CONNECTION_ERROR;
+  }
+
+#ifdef _WIN32
+  mode = 0;
+  ioctlsocket(sock, FIONBIO, &mode);
+#else
+  fcntl(sock, F_SETFL, flags & ~O_NONBLOCK);
+#endif
+  out_sock = (uintptr_t)sock;
+  return RLE_SUCCESS;
+}
+////////////////////////////////////////////////////////////////////////////
+
+int
+CSshSession::open(int conn_timeout_sec) {
+  close();
+  if (!CLibsshController::initialized()) return RLE_LIBSSH2_INIT;
+
+  uintptr_t sock = 0;
+  int rc = connect_socket(m_endpoint.host, m_endpoint.port, conn_timeout_sec, sock);
+  if (rc != RLE_SUCCESS) {
+    qDebug() << "ssh connection to" << m_endpoint.host << m_endpoint.port << "failed:"
+             << CLibsshController::run_libssh2_error_to_str((run_libssh2_error_t)rc);
+    return rc;
+  }
+  m_socket = sock;
+
+  m_session = libssh2_session_init();
+  if (!m_session) {
+    close();
+    return RLE_LIBSSH2_SESSION_INIT;
+  }
+  libssh2_session_set_blocking(m_session, 1);
+  libssh2_session_set_timeout(m_session, m_timeout_ms);
+
+  if (libssh2_session_handshake(m_session, m_socket) != 0) {
+    close();
+    return RLE_SESSION_HANDSHAKE;
+  }
+
+  if (authenticate() != 0) {
+    qDebug() << "ssh authentication of" << m_endpoint.user << "on"
+             << m_endpoint.host << "failed";
+    close();
+    return RLE_SSH_AUTHENTICATION;
+  }
+  return RLE_SUCCESS;
+}
+////////////////////////////////////////////////////////////////////////////
+
+int
+CSshSession::authenticate() {
+  QByteArray user = m_endpoint.user.toUtf8();
+  if (!m_endpoint.password.isEmpty()) {
+    QByteArray pass = m_endpoint.password.toUtf8();
+    return libssh2_userauth_password_ex(m_session, user.constData(), (unsigned int)user.size(),
+                                        pass.constData(), (unsigned int)pass.size(), nullptr);
+  }
+
+  QByteArray pr_file = m_endpoint.private_key.toLocal8Bit();
+  QByteArray pub_file = (m_endpoint.private_key + ".pub").toLocal8Bit();
+  QByteArray passphrase = m_endpoint.passphrase.toUtf8();
+  // libssh2 derives public key from private one if there is no .pub file
+  bool has_pub = QFile::exists(m_endpoint.private_key + ".pub");
+  return libssh2_userauth_publickey_fromfile_ex(m_session, user.constData(),
+                                                (unsigned int)user.size(),
+                                                has_pub ? pub_file.constData() : nullptr,
+                                                pr_file.constData(),
+                                                passphrase.constData());
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CSshSession::close() {
+  if (m_sftp) {
+    libssh2_sftp_shutdown(m_sftp);
+    m_sftp = nullptr;
+  }
+  if (m_session) {
+    libssh2_session_disconnect(m_session, "Normal Shutdown, Thank you for playing");
+    libssh2_session_free(m_session);
+    m_session = nullptr;
+  }
+  if (m_socket != NO_SOCKET) {
+    close_socket(m_socket);
+    m_socket = NO_SOCKET;
+  }
+}
+////////////////////////////////////////////////////////////////////////////
+
+bool
+CSshSession::is_alive() {
+  if (!m_session) return false;
+  if (m_sftp) {
+    char path[1024];
+    return libssh2_sftp_realpath(m_sftp, ".", path, sizeof(path)) >= 0;
+  }
+  // sessions of commands don't start sftp, opening channel is round trip too
+  LIBSSH2_CHANNEL* channel = libssh2_channel_open_session(m_session);
+  if (!channel) return false;
+  libssh2_channel_free(channel);
+  return true;
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CSshSession::set_timeout(int timeout_ms) {
+  m_timeout_ms = timeout_ms;
+  if (m_session) libssh2_session_set_timeout(m_session, m_timeout_ms);
+}
+////////////////////////////////////////////////////////////////////////////
+
+LIBSSH2_SFTP*
+CSshSession::sftp() {
+  if (!m_sftp && m_session)
+    m_sftp = libssh2_sftp_init(m_session);
+  return m_sftp;
+}
+////////////////////////////////////////////////////////////////////////////
+
+int
+CSshSession::exec(const QString &cmd,
+                  QByteArray &out,
+                  int timeout_ms) {
+  if (!m_session) return RLE_CONNECTION_ERROR;
+  LIBSSH2_CHANNEL* channel = libssh2_channel_open_session(m_session);
+  if (!channel) return RLE_LIBSSH2_CHANNEL_OPEN;
+
+  // stderr isn't interesting, unread data would block window of channel
+  libssh2_channel_handle_extended_data2(channel, LIBSSH2_CHANNEL_EXTENDED_DATA_IGNORE);
+  QByteArray str_cmd = cmd.toUtf8();
+  if (libssh2_channel_process_startup(channel, "exec", 4, str_cmd.constData(),
+                                      (unsigned int)str_cmd.size()) != 0) {
+    libssh2_channel_free(channel);
+    return RLE_LIBSSH2_CHANNEL_EXEC;
+  }
+
+  // session timeout is for round trips, command may work long without output
+  libssh2_session_set_timeout(m_session, timeout_ms);
+  char buffer[0x4000];
+  ssize_t r;
+  while ((r = libssh2_channel_read(channel, buffer, sizeof(buffer))) > 0)
+    out.append(buffer, (int)r);
+
+  int exit_code = RLE_LIBSSH2_EXIT_CODE_NOT_NULL;
+  if (r == 0 && libssh2_channel_close(channel) == 0)
+    exit_code = libssh2_channel_get_exit_status(channel);
+  libssh2_session_set_timeout(m_session, m_timeout_ms);
+  libssh2_channel_free(channel);
+  return exit_code;
+}
+////////////////////////////////////////////////////////////////////////////
+
+QString
+CSshSession::shell_quote(const QString &arg) {
+  QString res = arg;
+  res.replace("'", "'\\''");
+  return "'" + res + "'";
+}
+////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,248 @@
+#include "SshSessionPool.h"
+#include "LibsshController.h"
+
+#include <QDebug>
+#include <QElapsedTimer>
+
+const int CSshSessionPool::DEFAULT_MAX_SESSIONS;
+const int CSshSessionPool::MAX_SESSIONS_PER_ENDPOINT;
+const int CSshSessionPool::DEFAULT_IDLE_TIMEOUT_MS;
+const int CSshSessionPool::HEALTH_CHECK_IDLE_MS;
+QMutex CSshSessionPool::m_mutex;
+QWaitCondition CSshSessionPool::m_released;
+QList<CSshSessionPool::pooled_session_t> CSshSessionPool::m_sessions;
+int CSshSessionPool::m_max_sessions = CSshSessionPool::DEFAULT_MAX_SESSIONS;
+int CSshSessionPool::m_idle_timeout_ms = CSshSessionPool::DEFAULT_IDLE_TIMEOUT_MS;
+
+/* after these errors state of connection is unknown, session isn't kept */
+static bool
+is_transport_error(int rc) {
+  switch (rc) {
+    case RLE_CONNECTION_ERROR:
+    case RLE_LIBSSH2_CHANNEL_OPEN:
+    case RLE_LIBSSH2_CHANNEL_EXEC:
+    case RLE_LIBSSH2_EXIT_CODE_NOT_NULL:
+    case RLE_SFTP_INIT:
+      return true;
+    default:
+      return false;
+  }
+}
+////////////////////////////////////////////////////////////////////////////
+
+qint64
+CSshSessionPool::now_ms() {
+  static QElapsedTimer clock;
+  static QMutex clock_mutex;
+  QMutexLocker locker(&clock_mutex);
+  if (!clock.isValid()) clock.start();
+  return clock.elapsed();
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CSshSessionPool::take_expired(std::vector<std::shared_ptr<CSshSession> > &expired) {
+  qint64 now = now_ms();
+  for (int i = 0; i < m_sessions.size(); ) {
+    const pooled_session_t& ps = m_sessions[i];
+    if (!ps.busy && now - ps.released_ms >= m_idle_timeout_ms) {
+      expired.push_back(ps.session);
+      m_sessions.removeAt(i);
+    } else {
+      ++i;
+    }
+  }
+}
+////////////////////////////////////////////////////////////////////////////
+
+std::shared_ptr<CSshSession>
+CSshSessionPool::acquire(const ssh_endpoint_t &endpoint,
+                         int wait_ms,
+                         qint64 &idle_ms) {
+  const QString key = endpoint.key();
+  QElapsedTimer waited;
+  waited.start();
+  // declared before locker: sessions are disconnected after pool is unlocked
+  std::vector<std::shared_ptr<CSshSession> > closed;
+  QMutexLocker locker(&m_mutex);
+
+  for (;;) {
+    take_expired(closed);
+    int same_key = 0;
+    for (pooled_session_t& ps : m_sessions) {
+      if (ps.key != key) continue;
+      ++same_key;
+      if (ps.busy) continue;
+      ps.busy = true;
+      idle_ms = now_ms() - ps.released_ms;
+      return ps.session;
+    }
+
+    if (same_key < MAX_SESSIONS_PER_ENDPOINT) {
+      // idle sessions of other endpoints give their place
+      while (m_sessions.size() >= m_max_sessions) {
+        int oldest_idle = -1;
+        for (int i = 0; i < m_sessions.size(); ++i) {
+          const pooled_session_t& ps = m_sessions[i];
+          if (!ps.busy && (oldest_idle < 0 || ps.released_ms < m_sessions[oldest_idle].released_ms))
+            oldest_idle = i;
+        }
+        if (oldest_idle < 0) break;
+        closed.push_back(m_sessions[oldest_idle].session);
+        m_sessions.removeAt(oldest_idle);
+      }
+      if (m_sessions.size() < m_max_sessions) {
+        pooled_session_t ps;
+        ps.key = key;
+        ps.session = std::make_shared<CSshSession>(endpoint);
+        ps.busy = true;
+        ps.closing = false;
+        ps.released_ms = 0;
+        m_sessions.push_back(ps);
+        idle_ms = 0;
+        return ps.session;
+      }
+    }
+
+    qint64 left = wait_ms - waited.elapsed();
+    if (left <= 0 || !m_released.wait(&m_mutex, (unsigned long)left))
+      return nullptr;
+  }
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CSshSessionPool::release(const std::shared_ptr<CSshSession> &session,
+                         bool keep) {
+  QMutexLocker locker(&m_mutex);
+  for (int i = 0; i < m_sessions.size(); ++i) {
+    pooled_session_t& ps = m_sessions[i];
+    if (ps.session != session) continue;
+    if (keep && !ps.closing) {
+      ps.busy = false;
+      ps.released_ms = now_ms();
+    } else {
+      // caller keeps reference, session is disconnected outside of pool lock
+      m_sessions.removeAt(i);
+    }
+    break;
+  }
+  m_released.wakeAll();
+}
+////////////////////////////////////////////////////////////////////////////
+
+int
+CSshSessionPool::run(const ssh_endpoint_t &endpoint,
+                     int conn_timeout_sec,
+                     operation_t operation) {
+  if (!CLibsshController::initialized()) return RLE_LIBSSH2_INIT;
+  qint64 idle_ms = 0;
+  std::shared_ptr<CSshSession> session = acquire(endpoint, conn_timeout_sec * 1000, idle_ms);
+  if (!session) {
+    qDebug() << "no free ssh session for" << endpoint.host << "in" << conn_timeout_sec << "sec";
+    return RLE_CONNECTION_TIMEOUT;
+  }
+
+  int rc = RLE_SUCCESS;
+  bool keep = false;
+  {
+    QMutexLocker locker(session->mutex());
+    bool reused = session->is_open();
+    if (reused && idle_ms >= HEALTH_CHECK_IDLE_MS && !session->is_alive()) {
+      qDebug() << "idle ssh session to" << endpoint.host << "is dead, reconnecting";
+      session->close();
+      reused = false;
+    }
+
+    for (int attempt = 0; ; ++attempt) {
+      if (!session->is_open() && (rc = session->open(conn_timeout_sec)) != RLE_SUCCESS)
+        break;
+      rc = operation(*session);
+      bool not_started = rc == RLE_LIBSSH2_CHANNEL_OPEN || rc == RLE_SFTP_INIT ||
+                         rc == RLE_CONNECTION_ERROR;
+      if (!reused || attempt > 0 || !not_started) break;
+      // kept session died after health check, nothing was done on server
+      qDebug() << "ssh session to" << endpoint.host << "is dead, reconnecting";
+      session->close();
+    }
+    keep = session->is_open() && !is_transport_error(rc);
+  }
+  release(session, keep);
+  return rc;
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CSshSessionPool::close_sessions(const QString &host) {
+  std::vector<std::shared_ptr<CSshSession> > closed;
+  QMutexLocker locker(&m_mutex);
+  for (int i = 0; i < m_sessions.size(); ) {
+    pooled_session_t& ps = m_sessions[i];
+    if (ps.session->endpoint().host != host) {
+      ++i;
+    } else if (ps.busy) {
+      ps.closing = true;
+      ++i;
+    } else {
+      closed.push_back(ps.session);
+      m_sessions.removeAt(i);
+    }
+  }
+  m_released.wakeAll();
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CSshSessionPool::evict_idle() {
+  std::vector<std::shared_ptr<CSshSession> > expired;
+  QMutexLocker locker(&m_mutex);
+  take_expired(expired);
+  m_released.wakeAll();
+}
+////////////////////////////////////////////////////////////////////////////
+
+int
+CSshSessionPool::sessions_count() {
+  QMutexLocker locker(&m_mutex);
+  return m_sessions.size();
+}
+////////////////////////////////////////////////////////////////////////////
+
+int
+CSshSessionPool::idle_count() {
+  QMutexLocker locker(&m_mutex);
+  int count = 0;
+  for (const pooled_session_t& ps : m_sessions)
+    if (!ps.busy) ++count;
+  return count;
+}
+////////////////////////////////////////////////////////////////////////////
+
+int
+CSshSessionPool::max_sessions() {
+  QMutexLocker locker(&m_mutex);
+  return m_max_sessions;
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CSshSessionPool::set_max_sessions(int count) {
+  QMutexLocker locker(&m_mutex);
+  m_max_sessions = qMax(1, count);
+  m_released.wakeAll();
+}
+////////////////////////////////////////////////////////////////////////////
+
+int
+CSshSessionPool::idle_timeout() {
+  QMutexLocker locker(&m_mutex);
+  return m_idle_timeout_ms;
+}
+////////////////////////////////////////////////////////////////////////////
+
+void
+CSshSessionPool::set_idle_timeout(int timeout_ms) {
+  QMutexLocker locker(&m_mutex);
+  m_idle_timeout_ms = timeout_ms;
+}
+////////////////////////////////////////////////////////////////////////////
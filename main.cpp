@@ -223,15 +223,17 @@ int main(int argc, char* argv[]) {
       sc.show();
       sc.finish(&dlg);
 
-      dlg.run_dialog(&sc);
-      if (dlg.result() == QDialog::Rejected) break;
-
-      CTrayServer::Instance()->Init();
-      TrayControlWindow::Instance()->Init();
+      // login is asynchronous, tray is initialized when it succeeds.
+      QObject::connect(&dlg, &DlgLogin::login_success, [](){
+        CTrayServer::Instance()->Init();
+        TrayControlWindow::Instance()->Init();
 
-      P2PController::Instance().init();
-      P2PStatus_checker::Instance().update_status();
+        P2PController::Instance().init();
+        P2PStatus_checker::Instance().update_status();
+      });
+      QObject::connect(&dlg, &QDialog::rejected, &app, &QApplication::quit);
 
+      dlg.run_dialog(&sc);
       result = app.exec();
     } while (0);
   } catch (std::exception& ge) {
@@ -0,0 +1,169 @@
+#include "BoundedTaskRunnerTest.h"
+#include "BoundedTaskRunner.h"
+#include <stdexcept>
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QTest>
+#include <QThread>
+#include <QtConcurrent/QtConcurrent>
+
+static const int PROBE_DELAY_MS = 200;
+
+/* mocked component probe: sleeps like external process and counts parallel calls */
+struct probe_stats_t {
+    QAtomicInt running;
+    QAtomicInt max_running;
+    QAtomicInt done;
+    probe_stats_t() : running(0), max_running(0), done(0) {}
+};
+
+static void sleeping_probe(probe_stats_t* stats, int delay_ms) {
+    int running = stats->running.fetchAndAddOrdered(1) + 1;
+    int max_running = stats->max_running.load();
+    while (running > max_running &&
+           !stats->max_running.testAndSetOrdered(max_running, running))
+        max_running = stats->max_running.load();
+    QThread::msleep(delay_ms);
+    stats->running.fetchAndAddOrdered(-1);
+    stats->done.fetchAndAddOrdered(1);
+}
+
+////////////////////////////////////////////////////////
+
+void BoundedTaskRunnerTest::test_parallel_probes() {
+    static const int count = 8;
+    probe_stats_t stats;
+    CBoundedTaskRunner runner(count);
+    for (int i = 0; i < count; ++i)
+        runner.add([&stats]() { sleeping_probe(&stats, PROBE_DELAY_MS); });
+    QCOMPARE(runner.count(), count);
+
+    QElapsedTimer et;
+    et.start();
+    runner.run();
+    qint64 elapsed = et.elapsed();
+
+    QCOMPARE(stats.done.load(), count);
+    QCOMPARE(runner.count(), 0);
+    // total time is the slowest probe, not the sum of them
+    QVERIFY(elapsed >= PROBE_DELAY_MS);
+    QVERIFY(elapsed < count * PROBE_DELAY_MS / 2);
+    qDebug() << count << "probes of" << PROBE_DELAY_MS << "ms are done in" << elapsed << "ms";
+}
+
+////////////////////////////////////////////////////////
+
+void BoundedTaskRunnerTest::test_bounded_workers() {
+    static const int count = 9;
+    static const int workers = 3;
+    probe_stats_t stats;
+    CBoundedTaskRunner runner(workers);
+    QCOMPARE(runner.max_workers(), workers);
+    for (int i = 0; i < count; ++i)
+        runner.add([&stats]() { sleeping_probe(&stats, PROBE_DELAY_MS); });
+
+    QElapsedTimer et;
+    et.start();
+    runner.run();
+    qint64 elapsed = et.elapsed();
+
+    QCOMPARE(stats.done.load(), count);
+    QCOMPARE(stats.max_running.load(), workers);
+    // count / workers waves of probes
+    QVERIFY(elapsed >= (count / workers) * PROBE_DELAY_MS);
+    QVERIFY(elapsed < count * PROBE_DELAY_MS);
+}
+
+////////////////////////////////////////////////////////
+
+void BoundedTaskRunnerTest::test_results_streamed() {
+    ProbeResultReceiver receiver;
+    connect(this, &BoundedTaskRunnerTest::got_version,
+            &receiver, &ProbeResultReceiver::got_version);
+
+    CBoundedTaskRunner runner(4);
+    runner.add([this]() {
+        QThread::msleep(PROBE_DELAY_MS * 5);
+        emit got_version("slow");
+    });
+    for (int i = 0; i < 3; ++i) {
+        runner.add([this, i]() {
+            QThread::msleep(PROBE_DELAY_MS / 4);
+            emit got_version(QString("fast%1").arg(i));
+        });
+    }
+
+    // run() blocks, so it's called from worker thread while main loop receives results
+    QFuture<void> res = QtConcurrent::run([&runner]() { runner.run(); });
+    QElapsedTimer et;
+    et.start();
+    while (receiver.received.size() < 3 && et.elapsed() < 5000)
+        QTest::qWait(10);
+
+    // fast results are delivered while slow probe is still running
+    QCOMPARE(receiver.received.size(), 3);
+    QVERIFY(!receiver.received.contains("slow"));
+    QVERIFY(!res.isFinished());
+
+    while (!res.isFinished() && et.elapsed() < 5000)
+        QTest::qWait(10);
+    QTest::qWait(10);
+    QCOMPARE(receiver.received.size(), 4);
+    QCOMPARE(receiver.received.last(), QString("slow"));
+}
+
+////////////////////////////////////////////////////////
+
+void BoundedTaskRunnerTest::test_failed_probe() {
+    probe_stats_t stats;
+    CBoundedTaskRunner runner(2);
+    runner.add([]() { throw std::runtime_error("probe failed"); });
+    for (int i = 0; i < 3; ++i)
+        runner.add([&stats]() { sleeping_probe(&stats, 10); });
+    runner.run();
+    QCOMPARE(stats.done.load(), 3);
+}
+
+////////////////////////////////////////////////////////
+
+void BoundedTaskRunnerTest::test_abort() {
+    probe_stats_t stats;
+    CBoundedTaskRunner runner(1);
+    runner.add([&stats, &runner]() {
+        sleeping_probe(&stats, 10);
+        runner.abort();
+    });
+    for (int i = 0; i < 3; ++i)
+        runner.add([&stats]() { sleeping_probe(&stats, 10); });
+    QVERIFY(!runner.run());
+    // single worker, so the rest weren't started
+    QCOMPARE(stats.done.load(), 1);
+
+    // abort isn't sticky, next run goes
+    QVERIFY(!runner.aborted());
+    runner.add([&stats]() { sleeping_probe(&stats, 10); });
+    QVERIFY(runner.run());
+    QCOMPARE(stats.done.load(), 2);
+
+    // abort before run skips its tasks
+    runner.add([&stats]() { sleeping_probe(&stats, 10); });
+    runner.abort();
+    QVERIFY(!runner.run());
+    QCOMPARE(stats.done.load(), 2);
+}
+
+////////////////////////////////////////////////////////
+
+void BoundedTaskRunnerTest::test_reuse() {
+    probe_stats_t stats;
+    CBoundedTaskRunner runner;
+    QCOMPARE(runner.max_workers(), CBoundedTaskRunner::DEFAULT_MAX_WORKERS);
+    runner.add([&stats]() { sleeping_probe(&stats, 10); });
+    runner.run();
+    runner.add([&stats]() { sleeping_probe(&stats, 10); });
+    runner.add([&stats]() { sleeping_probe(&stats, 10); });
+    runner.run();
+    QCOMPARE(stats.done.load(), 3);
+}
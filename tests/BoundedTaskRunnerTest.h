@@ -0,0 +1,32 @@
+#ifndef BOUNDEDTASKRUNNERTEST_H
+#define BOUNDEDTASKRUNNERTEST_H
+
+#include <QObject>
+#include <QStringList>
+
+/* receives results of probes in main thread, like DlgAbout does */
+class ProbeResultReceiver : public QObject
+{
+    Q_OBJECT
+public:
+    QStringList received;
+public slots:
+    void got_version(const QString& component_id) { received << component_id; }
+};
+
+class BoundedTaskRunnerTest : public QObject
+{
+    Q_OBJECT
+signals:
+    void got_version(const QString& component_id);
+
+private slots:
+    void test_parallel_probes();
+    void test_bounded_workers();
+    void test_results_streamed();
+    void test_failed_probe();
+    void test_abort();
+    void test_reuse();
+};
+
+#endif // BOUNDEDTASKRUNNERTEST_H
@@ -0,0 +1,219 @@
+#include "ChunkedTransferTest.h"
+#include "ChunkedTransfer.h"
+#include "LibsshController.h"
+#include "LocalSshServer.h"
+#include "SshSession.h"
+#include <QDir>
+#include <QFile>
+#include <QTest>
+
+static const int CHUNK = 64 * 1024;
+
+static QByteArray read_all(const QString& path) {
+    QFile file(path);
+    file.open(QIODevice::ReadOnly);
+    return file.readAll();
+}
+
+/* flips byte of file in place, like broken write would do */
+static void corrupt(const QString& path, qint64 offset) {
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::ReadWrite));
+    file.seek(offset);
+    char c = 0;
+    file.getChar(&c);
+    file.seek(offset);
+    file.putChar((char)~c);
+}
+
+QString ChunkedTransferTest::journal_dir() const {
+    return m_dir->path() + "/journal";
+}
+
+QString ChunkedTransferTest::make_file(const QString &name, int size) {
+    QByteArray data(size, 0);
+    for (int i = 0; i < size; ++i)
+        data[i] = (char)(qrand() & 0xff);
+    QString path = m_dir->path() + "/" + name;
+    QFile file(path);
+    file.open(QIODevice::WriteOnly);
+    file.write(data);
+    file.close();
+    return path;
+}
+
+int ChunkedTransferTest::interrupted_upload(const QString &local, const QString &remote,
+                                            int chunks) {
+    CChunkedTransfer transfer(journal_dir(), CHUNK);
+    QAtomicInt cancel(0);
+    return transfer.upload(*m_session, local, remote, [&](quint64 done, quint64) {
+        if (done >= (quint64)chunks * CHUNK) cancel.store(1);
+    }, &cancel);
+}
+
+int ChunkedTransferTest::interrupted_download(const QString &remote, const QString &local,
+                                              int chunks) {
+    CChunkedTransfer transfer(journal_dir(), CHUNK);
+    QAtomicInt cancel(0);
+    return transfer.download(*m_session, remote, local, [&](quint64 done, quint64) {
+        if (done >= (quint64)chunks * CHUNK) cancel.store(1);
+    }, &cancel);
+}
+
+////////////////////////////////////////////////////////
+
+void ChunkedTransferTest::initTestCase() {
+#ifdef RT_OS_WINDOWS
+    QSKIP("sshd of system is needed");
+#endif
+    m_server = new LocalSshServer;
+    if (!m_server->start())
+        QSKIP(qPrintable(m_server->error()));
+    m_dir = new QTemporaryDir;
+    QVERIFY(m_dir->isValid());
+    m_session = new CSshSession(m_server->endpoint());
+    QCOMPARE(m_session->open(10), (int)RLE_SUCCESS);
+    if (CChunkedTransfer::remote_sha256(*m_session, m_server->private_key()).isEmpty())
+        QSKIP("sha256sum isn't installed");
+}
+
+////////////////////////////////////////////////////////
+
+void ChunkedTransferTest::test_upload_resume() {
+    const int size = CHUNK * 10 + 1000;
+    QString local = make_file("upload.bin", size);
+    QString remote = m_server->root() + "/upload.bin";
+
+    QCOMPARE(interrupted_upload(local, remote, 4), (int)RLE_CANCELLED);
+    QVERIFY(!QFile::exists(remote));
+    QCOMPARE(read_all(remote + CChunkedTransfer::PART_SUFFIX), read_all(local).left(CHUNK * 4));
+
+    CChunkedTransfer transfer(journal_dir(), CHUNK);
+    quint64 first_progress = 0, last_progress = 0;
+    int rc = transfer.upload(*m_session, local, remote, [&](quint64 done, quint64) {
+        if (first_progress == 0) first_progress = done;
+        last_progress = done;
+    });
+    QCOMPARE(rc, (int)RLE_SUCCESS);
+    QCOMPARE(transfer.resumed_bytes(), (quint64)CHUNK * 4);
+    // only missing bytes are sent
+    QCOMPARE(transfer.transferred_bytes(), (quint64)(size - CHUNK * 4));
+    QCOMPARE(first_progress, (quint64)CHUNK * 5);
+    QCOMPARE(last_progress, (quint64)size);
+    QCOMPARE(read_all(remote), read_all(local));
+    QVERIFY(!QFile::exists(remote + CChunkedTransfer::PART_SUFFIX));
+}
+
+////////////////////////////////////////////////////////
+
+void ChunkedTransferTest::test_download_resume() {
+    const int size = CHUNK * 7 + 17;
+    QString remote = m_server->root() + "/download.bin";
+    QFile::copy(make_file("download.src", size), remote);
+    QString local = m_dir->path() + "/download.bin";
+
+    QCOMPARE(interrupted_download(remote, local, 3), (int)RLE_CANCELLED);
+    QVERIFY(!QFile::exists(local));
+    QCOMPARE(QFileInfo(local + CChunkedTransfer::PART_SUFFIX).size(), (qint64)CHUNK * 3);
+
+    CChunkedTransfer transfer(journal_dir(), CHUNK);
+    QCOMPARE(transfer.download(*m_session, remote, local), (int)RLE_SUCCESS);
+    QCOMPARE(transfer.resumed_bytes(), (quint64)CHUNK * 3);
+    QCOMPARE(transfer.transferred_bytes(), (quint64)(size - CHUNK * 3));
+    QCOMPARE(read_all(local), read_all(remote));
+    QVERIFY(!QFile::exists(local + CChunkedTransfer::PART_SUFFIX));
+}
+
+////////////////////////////////////////////////////////
+
+void ChunkedTransferTest::test_partial_last_chunk() {
+    const int size = CHUNK * 6;
+    QString local = make_file("partial.bin", size);
+    QString remote = m_server->root() + "/partial.bin";
+    QCOMPARE(interrupted_upload(local, remote, 3), (int)RLE_CANCELLED);
+    // the last confirmed chunk didn't reach disk completely
+    corrupt(remote + CChunkedTransfer::PART_SUFFIX, CHUNK * 3 - 10);
+
+    CChunkedTransfer transfer(journal_dir(), CHUNK);
+    QCOMPARE(transfer.upload(*m_session, local, remote), (int)RLE_SUCCESS);
+    QCOMPARE(transfer.resumed_bytes(), (quint64)CHUNK * 2);
+    QCOMPARE(transfer.transferred_bytes(), (quint64)CHUNK * 4);
+    QCOMPARE(read_all(remote), read_all(local));
+
+    // the same for download, local part is checked
+    QString back = m_dir->path() + "/partial.back";
+    QCOMPARE(interrupted_download(remote, back, 2), (int)RLE_CANCELLED);
+    QFile part(back + CChunkedTransfer::PART_SUFFIX);
+    QVERIFY(part.resize(CHUNK * 2 - 100));
+    QCOMPARE(transfer.download(*m_session, remote, back), (int)RLE_SUCCESS);
+    QCOMPARE(transfer.resumed_bytes(), (quint64)CHUNK);
+    QCOMPARE(read_all(back), read_all(local));
+}
+
+////////////////////////////////////////////////////////
+
+void ChunkedTransferTest::test_changed_source_restarts() {
+    QString local = make_file("changed.bin", CHUNK * 5);
+    QString remote = m_server->root() + "/changed.bin";
+    QCOMPARE(interrupted_upload(local, remote, 2), (int)RLE_CANCELLED);
+
+    QFile file(local);
+    QVERIFY(file.open(QIODevice::Append));
+    file.write("new tail");
+    file.close();
+
+    CChunkedTransfer transfer(journal_dir(), CHUNK);
+    QCOMPARE(transfer.upload(*m_session, local, remote), (int)RLE_SUCCESS);
+    QCOMPARE(transfer.resumed_bytes(), (quint64)0);
+    QCOMPARE(transfer.transferred_bytes(), (quint64)file.size());
+    QCOMPARE(read_all(remote), read_all(local));
+
+    // other chunk size doesn't match journal either
+    QCOMPARE(interrupted_upload(local, remote, 2), (int)RLE_CANCELLED);
+    CChunkedTransfer other_chunks(journal_dir(), CHUNK * 2);
+    QCOMPARE(other_chunks.upload(*m_session, local, remote), (int)RLE_SUCCESS);
+    QCOMPARE(other_chunks.resumed_bytes(), (quint64)0);
+    QCOMPARE(read_all(remote), read_all(local));
+}
+
+////////////////////////////////////////////////////////
+
+void ChunkedTransferTest::test_digest_mismatch() {
+    QString local = make_file("mismatch.bin", CHUNK * 6);
+    QString remote = m_server->root() + "/mismatch.bin";
+    QCOMPARE(interrupted_upload(local, remote, 4), (int)RLE_CANCELLED);
+    // only the last chunk is read back, damage before it is found by final digest
+    corrupt(remote + CChunkedTransfer::PART_SUFFIX, CHUNK + 5);
+
+    CChunkedTransfer transfer(journal_dir(), CHUNK);
+    QCOMPARE(transfer.upload(*m_session, local, remote), (int)RLE_CHECKSUM_MISMATCH);
+    QVERIFY(!QFile::exists(remote));
+    QVERIFY(!QFile::exists(remote + CChunkedTransfer::PART_SUFFIX));
+
+    // journal is dropped, next attempt sends everything
+    QCOMPARE(transfer.upload(*m_session, local, remote), (int)RLE_SUCCESS);
+    QCOMPARE(transfer.resumed_bytes(), (quint64)0);
+    QCOMPARE(read_all(remote), read_all(local));
+}
+
+////////////////////////////////////////////////////////
+
+void ChunkedTransferTest::test_complete_transfer_forgets_journal() {
+    QString local = make_file("complete.bin", CHUNK * 3 + 1);
+    QString remote = m_server->root() + "/complete.bin";
+    QFile::remove(remote);
+    CChunkedTransfer transfer(journal_dir(), CHUNK);
+    QCOMPARE(transfer.upload(*m_session, local, remote), (int)RLE_SUCCESS);
+    QCOMPARE(transfer.upload(*m_session, local, remote), (int)RLE_SUCCESS);
+    QCOMPARE(transfer.resumed_bytes(), (quint64)0);
+    QCOMPARE(transfer.transferred_bytes(), (quint64)(CHUNK * 3 + 1));
+    QCOMPARE(QDir(journal_dir()).entryList(QDir::Files), QStringList());
+}
+
+////////////////////////////////////////////////////////
+
+void ChunkedTransferTest::cleanupTestCase() {
+    delete m_session;
+    delete m_server;
+    delete m_dir;
+}
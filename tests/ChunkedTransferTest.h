@@ -0,0 +1,37 @@
+#ifndef CHUNKEDTRANSFERTEST_H
+#define CHUNKEDTRANSFERTEST_H
+
+#include <QAtomicInt>
+#include <QObject>
+#include <QTemporaryDir>
+
+class CChunkedTransfer;
+class CSshSession;
+class LocalSshServer;
+
+class ChunkedTransferTest : public QObject
+{
+    Q_OBJECT
+private:
+    LocalSshServer* m_server = nullptr;
+    CSshSession* m_session = nullptr;
+    QTemporaryDir* m_dir = nullptr;
+
+    QString journal_dir() const;
+    QString make_file(const QString& name, int size);
+    /* upload which stops after chunks are sent */
+    int interrupted_upload(const QString& local, const QString& remote, int chunks);
+    int interrupted_download(const QString& remote, const QString& local, int chunks);
+
+private slots:
+    void initTestCase();
+    void test_upload_resume();
+    void test_download_resume();
+    void test_partial_last_chunk();
+    void test_changed_source_restarts();
+    void test_digest_mismatch();
+    void test_complete_transfer_forgets_journal();
+    void cleanupTestCase();
+};
+
+#endif // CHUNKEDTRANSFERTEST_H
@@ -0,0 +1,262 @@
+#include "DeltaUploadTest.h"
+#include "DeltaUpload.h"
+#include "LibsshController.h"
+#include "LocalSshServer.h"
+#include "RollingCrc.h"
+#include "SshSession.h"
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QTest>
+
+static const int FILE_SIZE = 8 * 1024 * 1024;
+
+static QByteArray random_data(int size) {
+    QByteArray data(size, 0);
+    for (int i = 0; i < size; ++i)
+        data[i] = (char)(qrand() & 0xff);
+    return data;
+}
+
+static QByteArray read_all(const QString& path) {
+    QFile file(path);
+    file.open(QIODevice::ReadOnly);
+    return file.readAll();
+}
+
+/* what container would say about old file */
+static std::vector<delta_block_t> blocks_of(const QByteArray& data, quint64 block_size) {
+    std::vector<delta_block_t> blocks;
+    for (quint64 offset = 0; offset < (quint64)data.size(); offset += block_size) {
+        delta_block_t block;
+        block.length = qMin(block_size, (quint64)data.size() - offset);
+        block.cksum = CRollingCrc::cksum(data.constData() + offset, block.length);
+        block.md5 = QCryptographicHash::hash(data.mid((int)offset, (int)block.length),
+                                             QCryptographicHash::Md5).toHex();
+        blocks.push_back(block);
+    }
+    return blocks;
+}
+
+/* builds new file from old one and plan, like container and sftp do */
+static QByteArray apply(const QByteArray& old_data, const QByteArray& new_data,
+                        const std::vector<delta_op_t>& ops, quint64* literal) {
+    QByteArray res;
+    *literal = 0;
+    for (const delta_op_t& op : ops) {
+        if ((quint64)res.size() != op.target) return QByteArray("gap");
+        if (op.literal()) {
+            res += new_data.mid((int)op.target, (int)op.length);
+            *literal += op.length;
+        } else {
+            res += old_data.mid((int)op.source, (int)op.length);
+        }
+    }
+    return res;
+}
+
+/* typical rebuild: few bytes patched, some inserted, some removed, tail appended */
+static QByteArray mutated(const QByteArray& data) {
+    QByteArray res = data;
+    res[100000] = (char)~res[100000];
+    res.insert(1000000, QByteArray("new function body"));
+    res.remove(3000000, 777);
+    res.replace(5000000, 100, random_data(100));
+    res.append(random_data(5000));
+    return res;
+}
+
+QString DeltaUploadTest::write_file(const QString &name, const QByteArray &data) {
+    QString path = m_dir->path() + "/" + name;
+    QFile file(path);
+    file.open(QIODevice::WriteOnly);
+    file.write(data);
+    return path;
+}
+
+void DeltaUploadTest::require_remote() {
+    if (!m_remote_ready)
+        QSKIP("sshd of system with coreutils is needed");
+}
+
+////////////////////////////////////////////////////////
+
+void DeltaUploadTest::initTestCase() {
+    m_dir = new QTemporaryDir;
+    QVERIFY(m_dir->isValid());
+#ifndef RT_OS_WINDOWS
+    m_server = new LocalSshServer;
+    if (!m_server->start()) {
+        qDebug() << m_server->error();
+        return;
+    }
+    m_session = new CSshSession(m_server->endpoint());
+    QCOMPARE(m_session->open(10), (int)RLE_SUCCESS);
+    // split --filter and dd of coreutils are used on container side
+    QString probe = m_server->root() + "/probe";
+    QFile::copy(write_file("probe", random_data(1000)), probe);
+    std::vector<delta_block_t> blocks;
+    m_remote_ready = CDeltaUpload::remote_blocks(*m_session, probe, 1000, 300, blocks) == RLE_SUCCESS;
+#endif
+}
+
+////////////////////////////////////////////////////////
+
+void DeltaUploadTest::test_block_size() {
+    QCOMPARE(CDeltaUpload::block_size_for(CDeltaUpload::MIN_FILE_SIZE), CDeltaUpload::MIN_BLOCK_SIZE);
+    quint64 size = 500ull * 1024 * 1024;
+    quint64 block = CDeltaUpload::block_size_for(size);
+    QVERIFY(block % 4096 == 0);
+    QVERIFY((size + block - 1) / block <= CDeltaUpload::MAX_BLOCKS);
+    QCOMPARE(CDeltaUpload::block_size_for(100ull << 30), CDeltaUpload::MAX_BLOCK_SIZE);
+}
+
+////////////////////////////////////////////////////////
+
+void DeltaUploadTest::test_plan_mutations() {
+    const quint64 block_size = 64 * 1024;
+    QByteArray old_data = random_data(FILE_SIZE + 123);
+    QByteArray new_data = mutated(old_data);
+
+    std::vector<delta_op_t> ops = CDeltaUpload::plan(new_data.constData(), new_data.size(),
+                                                     block_size, blocks_of(old_data, block_size));
+    quint64 literal = 0;
+    QCOMPARE(apply(old_data, new_data, ops, &literal), new_data);
+    // every change costs about a block, shifted data is found anyway
+    QVERIFY(literal <= 6 * block_size);
+    // neighbour blocks are one copy
+    QVERIFY(ops.size() < 15);
+}
+
+////////////////////////////////////////////////////////
+
+void DeltaUploadTest::test_plan_identical_and_unrelated() {
+    const quint64 block_size = 4096;
+    QByteArray data = random_data(100 * 4096 + 10);
+    std::vector<delta_block_t> blocks = blocks_of(data, block_size);
+
+    std::vector<delta_op_t> ops = CDeltaUpload::plan(data.constData(), data.size(), block_size, blocks);
+    quint64 literal = 0;
+    QCOMPARE(apply(data, data, ops, &literal), data);
+    // short tail of old file is sent again
+    QCOMPARE(literal, (quint64)10);
+    QCOMPARE((int)ops.size(), 2);
+
+    QByteArray other = random_data(data.size());
+    ops = CDeltaUpload::plan(other.constData(), other.size(), block_size, blocks);
+    QCOMPARE(apply(data, other, ops, &literal), other);
+    QCOMPARE(literal, (quint64)other.size());
+
+    // file shorter than block
+    ops = CDeltaUpload::plan("abc", 3, block_size, blocks);
+    QCOMPARE((int)ops.size(), 1);
+    QVERIFY(ops[0].literal());
+}
+
+////////////////////////////////////////////////////////
+
+void DeltaUploadTest::test_upload_mutated_file() {
+    require_remote();
+    QByteArray old_data = random_data(FILE_SIZE);
+    QString remote = m_server->root() + "/build.bin";
+    QFile::remove(remote);
+    QVERIFY(QFile::copy(write_file("build.old", old_data), remote));
+
+    QByteArray new_data = mutated(old_data);
+    QString local = write_file("build.bin", new_data);
+    CDeltaUpload delta;
+    quint64 last_done = 0;
+    int rc = delta.upload(*m_session, local, remote, [&last_done](quint64 done, quint64) {
+        last_done = done;
+    });
+    QCOMPARE(rc, (int)RLE_SUCCESS);
+    QCOMPARE(read_all(remote), new_data);
+    QVERIFY(!QFile::exists(remote + CDeltaUpload::TEMP_SUFFIX));
+    QCOMPARE(last_done, (quint64)new_data.size());
+
+    quint64 sent = delta.literal_bytes() + delta.signature_bytes();
+    qDebug() << "sent" << delta.literal_bytes() << "literal and" << delta.signature_bytes()
+             << "signature bytes of" << new_data.size();
+    QCOMPARE(delta.matched_bytes() + delta.literal_bytes(), (quint64)new_data.size());
+    QVERIFY(sent * 10 < (quint64)new_data.size());
+}
+
+////////////////////////////////////////////////////////
+
+void DeltaUploadTest::test_unrelated_file_is_refused() {
+    require_remote();
+    QByteArray old_data = random_data(2 * 1024 * 1024);
+    QString remote = m_server->root() + "/unrelated.bin";
+    QFile::remove(remote);
+    QVERIFY(QFile::copy(write_file("unrelated.old", old_data), remote));
+
+    CDeltaUpload delta;
+    QString local = write_file("unrelated.bin", random_data(old_data.size()));
+    QCOMPARE(delta.upload(*m_session, local, remote), (int)RLE_DELTA_UNUSABLE);
+    QCOMPARE(read_all(remote), old_data);
+    QCOMPARE(delta.literal_bytes(), (quint64)0);
+
+    // nothing to compare with
+    QCOMPARE(delta.upload(*m_session, local, remote + ".missing"), (int)RLE_DELTA_UNUSABLE);
+}
+
+////////////////////////////////////////////////////////
+
+void DeltaUploadTest::test_sftp_upload_uses_delta() {
+    require_remote();
+    QByteArray data = random_data(FILE_SIZE);
+    QString local = write_file("pushed.bin", data);
+    QString remote = m_server->root() + "/pushed.bin";
+    QFile::remove(remote);
+    QCOMPARE(CSftpTransfer::upload_file(*m_session, local, remote), (int)RLE_SUCCESS);
+
+    // the same path is pushed again after rebuild
+    QByteArray changed = mutated(data);
+    write_file("pushed.bin", changed);
+    QFile::setPermissions(local, QFileDevice::ReadOwner | QFileDevice::WriteOwner |
+                          QFileDevice::ExeOwner);
+    QCOMPARE(CSftpTransfer::upload_file(*m_session, local, remote), (int)RLE_SUCCESS);
+    QCOMPARE(read_all(remote), changed);
+    QVERIFY(QFileInfo(remote).permissions() & QFileDevice::ExeOwner);
+    QCOMPARE(QFileInfo(remote).lastModified().toTime_t(), QFileInfo(local).lastModified().toTime_t());
+}
+
+////////////////////////////////////////////////////////
+
+void DeltaUploadTest::benchmark_reupload_data() {
+    QTest::addColumn<bool>("delta");
+    QTest::newRow("delta") << true;
+    QTest::newRow("whole file") << false;
+}
+
+void DeltaUploadTest::benchmark_reupload() {
+    require_remote();
+    QFETCH(bool, delta);
+    QByteArray old_data = random_data(8 * FILE_SIZE);
+    QByteArray new_data = mutated(old_data);
+    QString old_local = write_file("bench.old", old_data);
+    QString local = write_file("bench.bin", new_data);
+    QString remote = m_server->root() + "/bench.bin";
+
+    QBENCHMARK {
+        QFile::remove(remote);
+        QFile::copy(old_local, remote);
+        if (delta) {
+            CDeltaUpload upload;
+            QCOMPARE(upload.upload(*m_session, local, remote), (int)RLE_SUCCESS);
+        } else {
+            QFile::remove(remote);
+            QCOMPARE(CSftpTransfer::upload_file(*m_session, local, remote), (int)RLE_SUCCESS);
+        }
+    }
+    QCOMPARE(QFileInfo(remote).size(), (qint64)new_data.size());
+}
+
+////////////////////////////////////////////////////////
+
+void DeltaUploadTest::cleanupTestCase() {
+    delete m_session;
+    delete m_server;
+    delete m_dir;
+}
@@ -0,0 +1,35 @@
+#ifndef DELTAUPLOADTEST_H
+#define DELTAUPLOADTEST_H
+
+#include <QObject>
+#include <QTemporaryDir>
+
+class CSshSession;
+class LocalSshServer;
+
+class DeltaUploadTest : public QObject
+{
+    Q_OBJECT
+private:
+    LocalSshServer* m_server = nullptr;
+    QTemporaryDir* m_dir = nullptr;
+    CSshSession* m_session = nullptr;
+    bool m_remote_ready = false;
+
+    void require_remote();
+    QString write_file(const QString& name, const QByteArray& data);
+
+private slots:
+    void initTestCase();
+    void test_block_size();
+    void test_plan_mutations();
+    void test_plan_identical_and_unrelated();
+    void test_upload_mutated_file();
+    void test_unrelated_file_is_refused();
+    void test_sftp_upload_uses_delta();
+    void benchmark_reupload_data();
+    void benchmark_reupload();
+    void cleanupTestCase();
+};
+
+#endif // DELTAUPLOADTEST_H
@@ -0,0 +1,109 @@
+#include "FakeHubServer.h"
+#include <QHostAddress>
+#include <QTimer>
+
+FakeHubServer::FakeHubServer(QObject *parent) :
+    QTcpServer(parent),
+    m_bytes_served(0),
+    m_concurrent(0),
+    m_max_concurrent(0) {
+    m_handler = [](const request_t&) { return response_t(); };
+    connect(this, &QTcpServer::newConnection,
+            this, &FakeHubServer::new_connection_sl);
+}
+
+bool FakeHubServer::start() {
+    return listen(QHostAddress::LocalHost, 0);
+}
+
+QString FakeHubServer::url(const QString &path) const {
+    return QString("http://127.0.0.1:%1%2").arg(serverPort()).arg(path);
+}
+
+void FakeHubServer::reset_counters() {
+    m_requests.clear();
+    m_bytes_served = 0;
+    m_concurrent = 0;
+    m_max_concurrent = 0;
+}
+
+void FakeHubServer::new_connection_sl() {
+    while (hasPendingConnections()) {
+        QTcpSocket* socket = nextPendingConnection();
+        m_buffers[socket] = QByteArray();
+        connect(socket, &QTcpSocket::readyRead,
+                this, &FakeHubServer::ready_read_sl);
+        connect(socket, &QTcpSocket::disconnected, [this, socket]() {
+            m_buffers.erase(socket);
+            socket->deleteLater();
+        });
+    }
+}
+
+void FakeHubServer::ready_read_sl() {
+    QTcpSocket* socket = qobject_cast<QTcpSocket*>(sender());
+    if (socket == nullptr) return;
+    m_buffers[socket].append(socket->readAll());
+    try_parse(socket);
+}
+
+bool FakeHubServer::try_parse(QTcpSocket *socket) {
+    QByteArray& buff = m_buffers[socket];
+    int hdr_end = buff.indexOf("\r\n\r\n");
+    if (hdr_end == -1) return false;
+
+    request_t req;
+    QList<QByteArray> lines = buff.left(hdr_end).split('\n');
+    QList<QByteArray> start_line = lines.first().trimmed().split(' ');
+    if (start_line.size() < 2) return false;
+    req.method = start_line[0];
+    req.path = start_line[1];
+    for (int i = 1; i < lines.size(); ++i) {
+        int colon = lines[i].indexOf(':');
+        if (colon == -1) continue;
+        req.headers[lines[i].left(colon).trimmed().toLower()] = lines[i].mid(colon + 1).trimmed();
+    }
+
+    int content_length = 0;
+    if (req.headers.find("content-length") != req.headers.end())
+        content_length = req.headers["content-length"].toInt();
+    if (buff.size() < hdr_end + 4 + content_length) return false;
+    req.body = buff.mid(hdr_end + 4, content_length);
+    buff.clear();
+
+    m_requests.push_back(req);
+    if (++m_concurrent > m_max_concurrent)
+        m_max_concurrent = m_concurrent;
+
+    response_t resp = m_handler(req);
+    if (resp.drop) {
+        --m_concurrent;
+        return true;
+    }
+    if (resp.reset) {
+        --m_concurrent;
+        socket->abort();
+        return true;
+    }
+    if (resp.delay_ms <= 0) {
+        respond(socket, resp);
+    } else {
+        QTimer::singleShot(resp.delay_ms, socket, [this, socket, resp]() {
+            respond(socket, resp);
+        });
+    }
+    return true;
+}
+
+void FakeHubServer::respond(QTcpSocket *socket, const response_t &resp) {
+    --m_concurrent;
+    QByteArray out = QString("HTTP/1.1 %1 Status\r\n").arg(resp.status).toUtf8();
+    for (auto i = resp.headers.begin(); i != resp.headers.end(); ++i)
+        out += i->first + ": " + i->second + "\r\n";
+    out += QString("Content-Length: %1\r\n").arg(resp.body.size()).toUtf8();
+    out += "Connection: close\r\n\r\n";
+    out += resp.body;
+    m_bytes_served += resp.body.size();
+    socket->write(out);
+    socket->disconnectFromHost();
+}
@@ -0,0 +1,67 @@
+#ifndef FAKEHUBSERVER_H
+#define FAKEHUBSERVER_H
+
+#include <functional>
+#include <map>
+#include <QList>
+#include <QPair>
+#include <QTcpServer>
+#include <QTcpSocket>
+
+/**
+ * @brief Minimal HTTP/1.1 server on 127.0.0.1 used instead of hub in tests.
+ * Every connection gets one response and is closed afterwards.
+ */
+class FakeHubServer : public QTcpServer
+{
+    Q_OBJECT
+public:
+    struct request_t {
+        QByteArray method;
+        QByteArray path;
+        std::map<QByteArray, QByteArray> headers; // lower case names
+        QByteArray body;
+    };
+
+    struct response_t {
+        int status;
+        QByteArray body;
+        QList<QPair<QByteArray, QByteArray> > headers;
+        int delay_ms;
+        bool drop; // never answer, emulates blackholed host
+        bool reset; // close connection without answer
+
+        response_t() : status(200), delay_ms(0), drop(false), reset(false) {}
+    };
+
+    typedef std::function<response_t(const request_t&)> handler_t;
+
+    explicit FakeHubServer(QObject *parent = nullptr);
+
+    bool start();
+    QString url(const QString& path) const;
+    void set_handler(handler_t handler) { m_handler = handler; }
+
+    int requests_count() const { return m_requests.size(); }
+    const QList<request_t>& requests() const { return m_requests; }
+    qint64 bytes_served() const { return m_bytes_served; }
+    int max_concurrent() const { return m_max_concurrent; }
+    void reset_counters();
+
+private:
+    handler_t m_handler;
+    QList<request_t> m_requests;
+    std::map<QTcpSocket*, QByteArray> m_buffers;
+    qint64 m_bytes_served;
+    int m_concurrent;
+    int m_max_concurrent;
+
+    bool try_parse(QTcpSocket* socket);
+    void respond(QTcpSocket* socket, const response_t& resp);
+
+private slots:
+    void new_connection_sl();
+    void ready_read_sl();
+};
+
+#endif // FAKEHUBSERVER_H
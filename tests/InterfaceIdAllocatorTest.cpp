@@ -0,0 +1,199 @@
+#include "InterfaceIdAllocatorTest.h"
+#include "InterfaceIdAllocator.h"
+#include "P2PStateTracker.h"
+#include "SwarmReconciler.h"
+#include "SystemCallWrapper.h"
+#include <QFile>
+#include <QMutex>
+#include <QSet>
+#include <QTemporaryDir>
+#include <QTest>
+#include <QtConcurrent/QtConcurrent>
+
+void InterfaceIdAllocatorTest::test_parse_id() {
+    QCOMPARE(CInterfaceIdAllocator::parse_id("vptp12"), 12);
+    QCOMPARE(CInterfaceIdAllocator::parse_id("tap0"), 0);
+    QCOMPARE(CInterfaceIdAllocator::parse_id("p2p-1"), 1);
+    QCOMPARE(CInterfaceIdAllocator::parse_id("windowsinterface305"), 305);
+    QCOMPARE(CInterfaceIdAllocator::parse_id("vptp"), -1);
+    QCOMPARE(CInterfaceIdAllocator::parse_id(""), -1);
+}
+
+////////////////////////////////////////////////////////
+
+void InterfaceIdAllocatorTest::test_lowest_free() {
+    CInterfaceIdAllocator allocator;
+    QCOMPARE(allocator.reserve("a"), 0);
+    QCOMPARE(allocator.reserve("b"), 1);
+    QCOMPARE(allocator.reserve("c"), 2);
+    // swarm keeps its id
+    QCOMPARE(allocator.reserve("a"), 0);
+
+    allocator.release("b");
+    QVERIFY(!allocator.is_used(1));
+    QCOMPARE(allocator.id_of("b"), -1);
+    QCOMPARE(allocator.reserve("d"), 1);
+    QCOMPARE(allocator.reserve("e"), 3);
+    QCOMPARE(allocator.used_count(), 4);
+}
+
+////////////////////////////////////////////////////////
+
+void InterfaceIdAllocatorTest::test_beyond_30() {
+    CInterfaceIdAllocator allocator(1000);
+    QSet<int> ids;
+    for (int i = 0; i < 500; ++i) {
+        int id = allocator.reserve(QString("swarm-%1").arg(i));
+        QCOMPARE(id, i);
+        ids.insert(id);
+    }
+    QCOMPARE(ids.size(), 500);
+}
+
+////////////////////////////////////////////////////////
+
+void InterfaceIdAllocatorTest::test_full() {
+    CInterfaceIdAllocator allocator(70);
+    for (int i = 0; i < 70; ++i)
+        QCOMPARE(allocator.reserve(QString("swarm-%1").arg(i)), i);
+    QCOMPARE(allocator.reserve("late"), -1);
+    QCOMPARE(allocator.reserve("late"), -1);
+
+    allocator.release("swarm-65");
+    QCOMPARE(allocator.reserve("late"), 65);
+    allocator.release("swarm-3");
+    QCOMPARE(allocator.reserve("later"), 3);
+
+    allocator.clear();
+    QCOMPARE(allocator.used_count(), 0);
+    QCOMPARE(allocator.reserve("late"), 0);
+}
+
+////////////////////////////////////////////////////////
+
+void InterfaceIdAllocatorTest::test_bind_from_daemon() {
+    CInterfaceIdAllocator allocator(100);
+    QCOMPARE(allocator.reserve("a"), 0);
+
+    // daemon reports id 0 for other swarm, it wins
+    allocator.bind("b", 0);
+    QCOMPARE(allocator.id_of("b"), 0);
+    QCOMPARE(allocator.id_of("a"), -1);
+    QCOMPARE(allocator.reserve("a"), 1);
+
+    // id out of capacity is remembered, but doesn't take place in bitmap
+    allocator.bind("c", 5000);
+    QCOMPARE(allocator.id_of("c"), 5000);
+    QVERIFY(allocator.is_used(5000));
+    QCOMPARE(allocator.reserve("d"), 2);
+
+    // interface of swarm changed
+    allocator.bind("b", 7);
+    QVERIFY(!allocator.is_used(0));
+    QCOMPARE(allocator.reserve("e"), 0);
+
+    allocator.bind("b", -1);
+    QCOMPARE(allocator.id_of("b"), -1);
+    QVERIFY(!allocator.is_used(7));
+}
+
+////////////////////////////////////////////////////////
+
+void InterfaceIdAllocatorTest::test_concurrent_reserve() {
+    const int threads = 8;
+    const int per_thread = 100;
+    CInterfaceIdAllocator allocator(threads * per_thread);
+    QMutex mutex;
+    QSet<int> ids;
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(threads);
+    for (int t = 0; t < threads; ++t) {
+        QtConcurrent::run(&pool, [&allocator, &mutex, &ids, t, per_thread]() {
+            for (int i = 0; i < per_thread; ++i) {
+                int id = allocator.reserve(QString("swarm-%1-%2").arg(t).arg(i));
+                QMutexLocker locker(&mutex);
+                ids.insert(id);
+            }
+        });
+    }
+    pool.waitForDone();
+
+    QCOMPARE(ids.size(), threads * per_thread);
+    QVERIFY(!ids.contains(-1));
+    QCOMPARE(allocator.used_count(), threads * per_thread);
+    QCOMPARE(allocator.reserve("one more"), -1);
+}
+
+////////////////////////////////////////////////////////
+
+void InterfaceIdAllocatorTest::test_fake_p2p_interfaces() {
+#ifdef RT_OS_WINDOWS
+    QSKIP("fake p2p is shell script");
+#endif
+    const int joined = 300;
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QString p2p = dir.path() + "/p2p";
+    QFile file(p2p);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    // ids of interfaces are shuffled, one of them is free
+    file.write(QString(
+        "#!/bin/sh\n"
+        "i=0\n"
+        "while [ $i -lt %1 ]; do\n"
+        "  id=$(( (i * 7) % %1 ))\n"
+        "  [ $id -ne 42 ] && echo \"swarm-$i|vptp$id\"\n"
+        "  i=$((i + 1))\n"
+        "done\n").arg(joined).toUtf8());
+    file.close();
+    file.setPermissions(QFileDevice::ReadOwner | QFileDevice::WriteOwner | QFileDevice::ExeOwner);
+
+    QStringList args = QStringList() << "show" << "--interfaces" << "--bind";
+    system_call_res_t res = CSystemCallWrapper::ssystem_th(p2p, args, true, true, 10000);
+    QCOMPARE(res.exit_code, 0);
+    p2p_state_t st;
+    st.installed = st.running = true;
+    st.interfaces = CP2PStateTracker::parse_interfaces(res.out);
+    QCOMPARE(st.interfaces.size(), joined - 1);
+    for (auto i = st.interfaces.begin(); i != st.interfaces.end(); ++i)
+        st.swarms.insert(i.key());
+
+    // new environment gets free id without spawning p2p again
+    QJsonObject obj;
+    obj["environment_hash"] = "swarm-new";
+    obj["environment_status"] = "HEALTHY";
+    std::vector<CEnvironment> envs(1, CEnvironment(obj));
+    CSwarmReconciler reconciler;
+    reconciler.set_environments(envs);
+    reconciler.set_p2p_state(st);
+    swarm_actions_t actions = reconciler.reconcile();
+    QCOMPARE(actions.join.size(), (size_t)1);
+    QCOMPARE(actions.join[0].base_interface_id(), 42);
+    QCOMPARE(actions.leave.size(), joined - 1);
+
+    reconciler.join_finished("swarm-new", true);
+    envs.push_back(CEnvironment(QJsonObject{{"environment_hash", "swarm-next"},
+                                            {"environment_status", "HEALTHY"}}));
+    reconciler.set_environments(envs);
+    actions = reconciler.reconcile();
+    QCOMPARE(actions.join.size(), (size_t)2);
+    for (auto i = actions.join.begin(); i != actions.join.end(); ++i) {
+        if (i->hash() == "swarm-next") QCOMPARE(i->base_interface_id(), joined);
+        else QCOMPARE(i->base_interface_id(), 42);
+    }
+}
+
+////////////////////////////////////////////////////////
+
+void InterfaceIdAllocatorTest::benchmark_reserve_release() {
+    CInterfaceIdAllocator allocator(4096);
+    for (int i = 0; i < 4000; ++i)
+        allocator.reserve(QString("swarm-%1").arg(i));
+    QBENCHMARK {
+        allocator.release("swarm-3999");
+        QCOMPARE(allocator.reserve("swarm-new"), 3999);
+        allocator.release("swarm-new");
+        QCOMPARE(allocator.reserve("swarm-3999"), 3999);
+    }
+}
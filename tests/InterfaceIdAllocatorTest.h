@@ -0,0 +1,20 @@
+#ifndef INTERFACEIDALLOCATORTEST_H
+#define INTERFACEIDALLOCATORTEST_H
+
+#include <QObject>
+
+class InterfaceIdAllocatorTest : public QObject
+{
+    Q_OBJECT
+private slots:
+    void test_parse_id();
+    void test_lowest_free();
+    void test_beyond_30();
+    void test_full();
+    void test_bind_from_daemon();
+    void test_concurrent_reserve();
+    void test_fake_p2p_interfaces();
+    void benchmark_reserve_release();
+};
+
+#endif // INTERFACEIDALLOCATORTEST_H
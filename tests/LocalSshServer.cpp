@@ -0,0 +1,136 @@
+#include "LocalSshServer.h"
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QStandardPaths>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QThread>
+
+LocalSshServer::LocalSshServer(QObject *parent) :
+    QObject(parent),
+    m_process(nullptr),
+    m_port(0) {
+}
+
+LocalSshServer::~LocalSshServer() {
+    stop();
+}
+
+bool LocalSshServer::run(const QString &program, const QStringList &args) {
+    QProcess proc;
+    proc.start(program, args);
+    if (!proc.waitForFinished(30000) || proc.exitCode() != 0) {
+        m_error = QString("%1 failed: %2").arg(program, QString(proc.readAllStandardError()));
+        return false;
+    }
+    return true;
+}
+
+bool LocalSshServer::start() {
+    QStringList sbin = QStringList() << "/usr/sbin" << "/usr/local/sbin" << "/sbin";
+    QString sshd = QStandardPaths::findExecutable("sshd", sbin);
+    if (sshd.isEmpty()) sshd = QStandardPaths::findExecutable("sshd");
+    QString keygen = QStandardPaths::findExecutable("ssh-keygen");
+    if (sshd.isEmpty() || keygen.isEmpty()) {
+        m_error = "sshd or ssh-keygen isn't installed";
+        return false;
+    }
+    if (!m_dir.isValid()) {
+        m_error = "can't create temporary directory";
+        return false;
+    }
+
+    QProcess whoami;
+    whoami.start("id", QStringList() << "-un");
+    whoami.waitForFinished(5000);
+    m_user = QString(whoami.readAllStandardOutput()).trimmed();
+
+    QString dir = m_dir.path();
+    QDir().mkpath(dir + "/root");
+    // libssh2 reads only PEM private keys
+    if (!run(keygen, QStringList() << "-q" << "-t" << "rsa" << "-b" << "2048"
+             << "-N" << "" << "-f" << dir + "/host_rsa") ||
+        !run(keygen, QStringList() << "-q" << "-t" << "rsa" << "-b" << "2048" << "-m" << "PEM"
+             << "-N" << "" << "-f" << private_key()))
+        return false;
+    QFile::copy(private_key() + ".pub", dir + "/authorized_keys");
+
+    QTcpServer free_port;
+    free_port.listen(QHostAddress::LocalHost);
+    m_port = free_port.serverPort();
+    free_port.close();
+
+    QFile config(dir + "/sshd_config");
+    config.open(QIODevice::WriteOnly);
+    config.write(QString(
+        "Port %1\n"
+        "ListenAddress 127.0.0.1\n"
+        "HostKey %2/host_rsa\n"
+        "AuthorizedKeysFile %2/authorized_keys\n"
+        "PidFile %2/sshd.pid\n"
+        "PasswordAuthentication no\n"
+        "PubkeyAuthentication yes\n"
+        "StrictModes no\n"
+        "UsePAM no\n"
+        "LogLevel VERBOSE\n"
+        "MaxStartups 100\n"
+        "MaxSessions 100\n"
+        "Subsystem sftp internal-sftp\n").arg(m_port).arg(dir).toUtf8());
+    config.close();
+
+    m_process = new QProcess(this);
+    // sshd -e logs to stderr, file never blocks it like full pipe does
+    m_process->setProcessChannelMode(QProcess::MergedChannels);
+    m_process->setStandardOutputFile(dir + "/sshd.log");
+    m_process->start(sshd, QStringList() << "-D" << "-e" << "-f" << dir + "/sshd_config");
+    if (!m_process->waitForStarted(5000)) {
+        m_error = "sshd didn't start";
+        return false;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    while (timer.elapsed() < 10000) {
+        QTcpSocket socket;
+        socket.connectToHost(QHostAddress::LocalHost, m_port);
+        if (socket.waitForConnected(500)) return true;
+        if (m_process->state() != QProcess::Running) break;
+        QThread::msleep(100);
+    }
+    QFile log(m_dir.path() + "/sshd.log");
+    log.open(QIODevice::ReadOnly);
+    m_error = "sshd doesn't accept connections: " + QString(log.readAll());
+    return false;
+}
+
+void LocalSshServer::stop() {
+    if (m_process == nullptr) return;
+    m_process->terminate();
+    if (!m_process->waitForFinished(5000)) m_process->kill();
+    delete m_process;
+    m_process = nullptr;
+}
+
+QString LocalSshServer::private_key() const {
+    return m_dir.path() + "/id_rsa";
+}
+
+ssh_endpoint_t LocalSshServer::endpoint() const {
+    ssh_endpoint_t endpoint;
+    endpoint.host = "127.0.0.1";
+    endpoint.port = m_port;
+    endpoint.user = m_user;
+    endpoint.private_key = private_key();
+    return endpoint;
+}
+
+QString LocalSshServer::root() const {
+    return m_dir.path() + "/root";
+}
+
+int LocalSshServer::logins_count() const {
+    QFile log(m_dir.path() + "/sshd.log");
+    if (!log.open(QIODevice::ReadOnly)) return 0;
+    return log.readAll().count("Accepted publickey");
+}
@@ -0,0 +1,47 @@
+#ifndef LOCALSSHSERVER_H
+#define LOCALSSHSERVER_H
+
+#include <QObject>
+#include <QProcess>
+#include <QTemporaryDir>
+#include "SshSession.h"
+
+/**
+ * @brief sshd of system started on 127.0.0.1 with own config, host key and
+ * key of client in temporary directory. Only current user can log in.
+ * Used instead of container in transfer tests, they are skipped if
+ * sshd or ssh-keygen isn't installed.
+ */
+class LocalSshServer : public QObject
+{
+    Q_OBJECT
+public:
+    explicit LocalSshServer(QObject *parent = nullptr);
+    ~LocalSshServer();
+
+    bool start();
+    void stop();
+    /* why start() failed */
+    const QString& error() const { return m_error; }
+
+    quint16 port() const { return m_port; }
+    QString user() const { return m_user; }
+    QString private_key() const;
+    ssh_endpoint_t endpoint() const;
+    /* directory for remote files of test */
+    QString root() const;
+
+    /* successful logins since start, each one is new session */
+    int logins_count() const;
+
+private:
+    QTemporaryDir m_dir;
+    QProcess* m_process;
+    quint16 m_port;
+    QString m_user;
+    QString m_error;
+
+    bool run(const QString& program, const QStringList& args);
+};
+
+#endif // LOCALSSHSERVER_H
@@ -0,0 +1,263 @@
+#include "P2PStateTrackerTest.h"
+#include "P2PStateTracker.h"
+#include "ProcessRunner.h"
+#include "RestPipeline.h"
+#include "FakeHubServer.h"
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QNetworkProxy>
+#include <QTemporaryDir>
+#include <QTest>
+
+static const char* STATUS_BODY =
+    "{\"code\":0,\"instances\":["
+    "{\"id\":\"swarm-aaa\",\"ip\":\"10.10.1.1\",\"peers\":["
+    "{\"id\":\"p1\",\"ip\":\"10.10.1.2\",\"state\":\"Connected\",\"lastError\":\"\"},"
+    "{\"id\":\"p2\",\"ip\":\"10.10.1.3\",\"state\":\"Waiting for IP\",\"lastError\":\"\"}]},"
+    "{\"id\":\"swarm-ccc\",\"ip\":\"10.10.3.1\",\"peers\":[]}]}";
+
+static p2p_state_t state_of(CP2PStateTracker* tracker) {
+    p2p_state_t st;
+    tracker->state(st);
+    return st;
+}
+
+CP2PStateTracker* P2PStateTrackerTest::make_tracker(bool with_rest, const QString& p2p) {
+    QString path = p2p.isEmpty() ? m_p2p : p2p;
+    return new CP2PStateTracker(m_runner,
+                                with_rest ? m_pipeline : nullptr,
+                                [path]() { return path; },
+                                with_rest ? m_server->url("/rest/v1/status") : QString(),
+                                this);
+}
+
+bool P2PStateTrackerTest::refresh_and_wait(CP2PStateTracker* tracker) {
+    quint64 before = tracker->refresh_count();
+    bool updated = false;
+    QMetaObject::Connection conn = connect(tracker, &CP2PStateTracker::state_updated,
+                                           [&updated]() { updated = true; });
+    tracker->refresh();
+    QElapsedTimer et;
+    et.start();
+    while (!updated && et.elapsed() < 10000)
+        QTest::qWait(10);
+    disconnect(conn);
+    return updated && tracker->refresh_count() > before;
+}
+
+QStringList P2PStateTrackerTest::calls() const {
+    QFile file(m_dir->path() + "/calls");
+    if (!file.open(QIODevice::ReadOnly)) return QStringList();
+    return QString(file.readAll()).split("\n", QString::SkipEmptyParts);
+}
+
+void P2PStateTrackerTest::set_daemon_down(bool down) {
+    QString path = m_dir->path() + "/down";
+    if (!down) {
+        QFile::remove(path);
+        return;
+    }
+    QFile file(path);
+    file.open(QIODevice::WriteOnly);
+}
+
+void P2PStateTrackerTest::initTestCase() {
+#ifdef RT_OS_WINDOWS
+    QSKIP("fake p2p is shell script");
+#endif
+    m_dir = new QTemporaryDir;
+    QVERIFY(m_dir->isValid());
+
+    m_p2p = m_dir->path() + "/p2p";
+    QFile file(m_p2p);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    QString dir = m_dir->path();
+    file.write(QString(
+        "#!/bin/sh\n"
+        "echo \"$*\" >> '%1/calls'\n"
+        "[ -f '%1/down' ] && exit 1\n"
+        "case \"$*\" in\n"
+        "  'show --interfaces --bind') echo 'swarm-aaa|p2p-1'; echo 'swarm-bbb|p2p-2';;\n"
+        "  'show') echo '10.10.1.1 swarm-aaa'; echo '10.10.2.1 swarm-bbb';;\n"
+        "  *) exit 2;;\n"
+        "esac\n").arg(dir).toUtf8());
+    file.close();
+    file.setPermissions(QFileDevice::ReadOwner | QFileDevice::WriteOwner | QFileDevice::ExeOwner);
+
+    m_server = new FakeHubServer;
+    QVERIFY(m_server->start());
+    m_nam = new QNetworkAccessManager;
+    m_nam->setProxy(QNetworkProxy::NoProxy);
+    m_pipeline = new CRestPipeline(m_nam);
+    m_runner = new CProcessRunner;
+}
+
+void P2PStateTrackerTest::init() {
+    QFile::remove(m_dir->path() + "/calls");
+    set_daemon_down(false);
+    m_server->reset_counters();
+    m_server->set_handler([](const FakeHubServer::request_t&) -> FakeHubServer::response_t {
+        FakeHubServer::response_t resp;
+        resp.body = STATUS_BODY;
+        return resp;
+    });
+}
+
+////////////////////////////////////////////////////////
+
+void P2PStateTrackerTest::test_parse_swarms() {
+    QStringList out;
+    out << "IP  Hash" << "10.10.1.1 swarm-aaa" << "" << "10.10.2.1\tswarm-bbb ";
+    QSet<QString> swarms = CP2PStateTracker::parse_swarms(out);
+    QCOMPARE(swarms.size(), 2);
+    QVERIFY(swarms.contains("swarm-aaa"));
+    QVERIFY(swarms.contains("swarm-bbb"));
+}
+
+void P2PStateTrackerTest::test_parse_interfaces() {
+    QStringList out;
+    out << "swarm-aaa|p2p-1" << "swarm-bbb" << "swarm-ccc|p2p-3|x" << "header|line";
+    QHash<QString, QString> interfaces = CP2PStateTracker::parse_interfaces(out);
+    QCOMPARE(interfaces.size(), 1);
+    QCOMPARE(interfaces.value("swarm-aaa"), QString("p2p-1"));
+}
+
+////////////////////////////////////////////////////////
+
+void P2PStateTrackerTest::test_not_installed() {
+    CP2PStateTracker* tracker = make_tracker(true, m_dir->path() + "/no_such_p2p");
+    QVERIFY(!tracker->has_state());
+    // nothing is known yet, snapshot isn't given
+    p2p_state_t st;
+    st.installed = true;
+    QVERIFY(!tracker->state(st));
+    QVERIFY(st.installed);
+    QVERIFY(refresh_and_wait(tracker));
+    QVERIFY(tracker->has_state());
+    QVERIFY(!state_of(tracker).installed);
+    QVERIFY(!tracker->daemon_running());
+    QVERIFY(calls().isEmpty());
+    QCOMPARE(m_server->requests_count(), 0);
+    delete tracker;
+}
+
+void P2PStateTrackerTest::test_cli_state() {
+    CP2PStateTracker* tracker = make_tracker(false);
+    QVERIFY(refresh_and_wait(tracker));
+    p2p_state_t st = state_of(tracker);
+    QVERIFY(st.installed);
+    QVERIFY(st.running);
+    QVERIFY(!st.peers_known);
+    QCOMPARE(st.swarms.size(), 2);
+    QVERIFY(tracker->is_in_swarm("swarm-aaa"));
+    QVERIFY(tracker->is_in_swarm("swarm-bbb"));
+    QVERIFY(!tracker->is_in_swarm("swarm-ccc"));
+    QCOMPARE(tracker->swarm_interface("swarm-bbb"), QString("p2p-2"));
+    // container state isn't known without REST, `p2p show -check` is needed
+    QCOMPARE(tracker->container_state("swarm-aaa", "10.10.1.2"), CP2PStateTracker::CS_UNKNOWN);
+    QCOMPARE(calls(), QStringList() << "show" << "show --interfaces --bind");
+    delete tracker;
+}
+
+void P2PStateTrackerTest::test_daemon_down() {
+    set_daemon_down(true);
+    CP2PStateTracker* tracker = make_tracker(false);
+    QVERIFY(refresh_and_wait(tracker));
+    QVERIFY(state_of(tracker).installed);
+    QVERIFY(!tracker->daemon_running());
+    QVERIFY(!tracker->is_in_swarm("swarm-aaa"));
+    // interfaces aren't asked from stopped daemon
+    QCOMPARE(calls(), QStringList() << "show");
+    delete tracker;
+}
+
+void P2PStateTrackerTest::test_rest_state() {
+    CP2PStateTracker* tracker = make_tracker(true);
+    QVERIFY(refresh_and_wait(tracker));
+    p2p_state_t st = state_of(tracker);
+    QVERIFY(st.running);
+    QVERIFY(st.peers_known);
+    QVERIFY(tracker->is_in_swarm("swarm-aaa"));
+    QVERIFY(tracker->is_in_swarm("swarm-ccc"));
+    QVERIFY(!tracker->is_in_swarm("swarm-bbb"));
+    QCOMPARE(tracker->swarm_interface("swarm-aaa"), QString("p2p-1"));
+    QCOMPARE(tracker->container_state("swarm-aaa", "10.10.1.2"), CP2PStateTracker::CS_CONNECTED);
+    QCOMPARE(tracker->container_state("swarm-aaa", "10.10.1.3"), CP2PStateTracker::CS_NOT_CONNECTED);
+    QCOMPARE(tracker->container_state("swarm-aaa", "10.10.1.9"), CP2PStateTracker::CS_UNKNOWN);
+    QCOMPARE(tracker->container_state("swarm-zzz", "10.10.1.2"), CP2PStateTracker::CS_NOT_CONNECTED);
+    // `p2p show` isn't needed when daemon answers on REST
+    QCOMPARE(calls(), QStringList() << "show --interfaces --bind");
+    QCOMPARE(m_server->requests_count(), 1);
+    QCOMPARE(m_server->requests().first().path, QByteArray("/rest/v1/status"));
+    delete tracker;
+}
+
+void P2PStateTrackerTest::test_rest_unavailable() {
+    m_server->set_handler([](const FakeHubServer::request_t&) -> FakeHubServer::response_t {
+        FakeHubServer::response_t resp;
+        resp.status = 404;
+        return resp;
+    });
+    CP2PStateTracker* tracker = make_tracker(true);
+    QVERIFY(refresh_and_wait(tracker));
+    QVERIFY(tracker->daemon_running());
+    QVERIFY(!state_of(tracker).peers_known);
+    QVERIFY(tracker->is_in_swarm("swarm-bbb"));
+    QCOMPARE(calls(), QStringList() << "show" << "show --interfaces --bind");
+    delete tracker;
+}
+
+////////////////////////////////////////////////////////
+
+void P2PStateTrackerTest::test_lookups_dont_spawn() {
+    CP2PStateTracker* tracker = make_tracker(true);
+    QVERIFY(refresh_and_wait(tracker));
+    int spawned = calls().size();
+    int found = 0;
+    for (int i = 0; i < 100000; ++i) {
+        if (tracker->is_in_swarm(i % 2 ? "swarm-aaa" : "swarm-bbb")) ++found;
+        tracker->container_state("swarm-aaa", "10.10.1.2");
+    }
+    QCOMPARE(found, 50000);
+    QCOMPARE(calls().size(), spawned);
+    QCOMPARE(m_server->requests_count(), 1);
+    delete tracker;
+}
+
+void P2PStateTrackerTest::test_swarm_joined_left() {
+    CP2PStateTracker* tracker = make_tracker(false);
+    QVERIFY(refresh_and_wait(tracker));
+    // visible right away, before refresh which is requested by them
+    tracker->swarm_joined("swarm-new");
+    QVERIFY(tracker->is_in_swarm("swarm-new"));
+    tracker->swarm_left("swarm-aaa");
+    QVERIFY(!tracker->is_in_swarm("swarm-aaa"));
+    QVERIFY(tracker->swarm_interface("swarm-aaa").isEmpty());
+    // fake daemon still has swarm-aaa and doesn't know swarm-new
+    QTRY_VERIFY_WITH_TIMEOUT(tracker->is_in_swarm("swarm-aaa"), 10000);
+    QVERIFY(!tracker->is_in_swarm("swarm-new"));
+    delete tracker;
+}
+
+void P2PStateTrackerTest::test_refresh_coalesced() {
+    CP2PStateTracker* tracker = make_tracker(false);
+    for (int i = 0; i < 5; ++i)
+        tracker->refresh();
+    QTRY_VERIFY_WITH_TIMEOUT(tracker->refresh_count() >= 1, 10000);
+    QTest::qWait(500);
+    // requests during refresh are merged into one more refresh
+    QVERIFY(tracker->refresh_count() <= 2);
+    QVERIFY(calls().size() <= 4);
+    delete tracker;
+}
+
+////////////////////////////////////////////////////////
+
+void P2PStateTrackerTest::cleanupTestCase() {
+    delete m_runner;
+    delete m_pipeline;
+    delete m_nam;
+    delete m_server;
+    delete m_dir;
+}
@@ -0,0 +1,46 @@
+#ifndef P2PSTATETRACKERTEST_H
+#define P2PSTATETRACKERTEST_H
+
+#include <QObject>
+#include <QString>
+
+class CP2PStateTracker;
+class CProcessRunner;
+class CRestPipeline;
+class FakeHubServer;
+class QNetworkAccessManager;
+class QTemporaryDir;
+
+class P2PStateTrackerTest : public QObject
+{
+    Q_OBJECT
+private:
+    QTemporaryDir* m_dir = nullptr;
+    QString m_p2p;
+    FakeHubServer* m_server = nullptr;
+    QNetworkAccessManager* m_nam = nullptr;
+    CRestPipeline* m_pipeline = nullptr;
+    CProcessRunner* m_runner = nullptr;
+
+    CP2PStateTracker* make_tracker(bool with_rest, const QString& p2p = QString());
+    bool refresh_and_wait(CP2PStateTracker* tracker);
+    QStringList calls() const;
+    void set_daemon_down(bool down);
+
+private slots:
+    void initTestCase();
+    void init();
+    void test_parse_swarms();
+    void test_parse_interfaces();
+    void test_not_installed();
+    void test_cli_state();
+    void test_daemon_down();
+    void test_rest_state();
+    void test_rest_unavailable();
+    void test_lookups_dont_spawn();
+    void test_swarm_joined_left();
+    void test_refresh_coalesced();
+    void cleanupTestCase();
+};
+
+#endif // P2PSTATETRACKERTEST_H
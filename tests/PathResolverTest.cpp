@@ -0,0 +1,174 @@
+#include "PathResolverTest.h"
+#include "PathResolver.h"
+#include "OsBranchConsts.h"
+#include "SystemCallWrapper.h"
+#include <QDir>
+#include <QFile>
+#include <QTemporaryDir>
+#include <QTest>
+
+QString PathResolverTest::make_dir(const QString& name) {
+    QString path = m_dir->path() + "/" + name;
+    QDir().mkpath(path);
+    return path;
+}
+
+QString PathResolverTest::make_binary(const QString& dir, const QString& name, bool executable) {
+    QString path = dir + "/" + name;
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) return QString();
+    file.write("#!/bin/sh\necho fake\n");
+    file.close();
+    QFileDevice::Permissions perm = QFileDevice::ReadOwner | QFileDevice::WriteOwner;
+    if (executable) perm |= QFileDevice::ExeOwner;
+    file.setPermissions(perm);
+    return path;
+}
+
+void PathResolverTest::initTestCase() {
+#ifdef RT_OS_WINDOWS
+    QSKIP("executable bit and ':' separated PATH are used");
+#endif
+    m_dir = new QTemporaryDir;
+    QVERIFY(m_dir->isValid());
+    m_first = make_dir("first");
+    m_second = make_dir("second");
+    m_path_env = m_first + ":" + m_dir->path() + "/missing:" + m_second;
+}
+
+////////////////////////////////////////////////////////
+
+void PathResolverTest::test_search_dirs() {
+    QStringList dirs = CPathResolver::search_dirs("/a::/b: /c :/a");
+    QVERIFY(dirs.startsWith("/a"));
+    QVERIFY(dirs.contains("/b"));
+    QVERIFY(dirs.contains("/c"));
+    QCOMPARE(dirs.count("/a"), 1);
+}
+
+////////////////////////////////////////////////////////
+
+void PathResolverTest::test_first_in_path() {
+    CPathResolver resolver;
+    make_binary(m_second, "tool");
+    QString expected = make_binary(m_first, "tool");
+    QCOMPARE(resolver.resolve("tool", m_path_env), expected);
+
+    make_binary(m_second, "only_second");
+    QCOMPARE(resolver.resolve("only_second", m_path_env), m_second + "/only_second");
+    QVERIFY(resolver.resolve("nothing", m_path_env).isEmpty());
+}
+
+////////////////////////////////////////////////////////
+
+void PathResolverTest::test_not_executable() {
+    CPathResolver resolver;
+    make_binary(m_first, "plain", false);
+    QString expected = make_binary(m_second, "plain");
+    QCOMPARE(resolver.resolve("plain", m_path_env), expected);
+}
+
+////////////////////////////////////////////////////////
+
+void PathResolverTest::test_cached() {
+    CPathResolver resolver;
+    make_binary(m_second, "cached");
+    for (int i = 0; i < 10; ++i) {
+        QCOMPARE(resolver.resolve("cached", m_path_env), m_second + "/cached");
+        QVERIFY(resolver.resolve("not_there", m_path_env).isEmpty());
+    }
+    QCOMPARE(resolver.scans_count(), (quint64)2);
+
+    // PATH is a part of key
+    QVERIFY(resolver.resolve("cached", m_first).isEmpty());
+    QCOMPARE(resolver.scans_count(), (quint64)3);
+
+    resolver.clear();
+    resolver.resolve("cached", m_path_env);
+    QCOMPARE(resolver.scans_count(), (quint64)4);
+}
+
+////////////////////////////////////////////////////////
+
+void PathResolverTest::test_eviction() {
+    CPathResolver resolver;
+    for (int i = 0; i <= CPathResolver::MAX_ENTRIES; ++i)
+        resolver.resolve(QString("evicted%1").arg(i), m_path_env);
+    quint64 scans = resolver.scans_count();
+
+    // only the oldest entry is dropped when cache is full
+    resolver.resolve("evicted1", m_path_env);
+    resolver.resolve(QString("evicted%1").arg(CPathResolver::MAX_ENTRIES), m_path_env);
+    QCOMPARE(resolver.scans_count(), scans);
+    resolver.resolve("evicted0", m_path_env);
+    QCOMPARE(resolver.scans_count(), scans + 1);
+}
+
+////////////////////////////////////////////////////////
+
+void PathResolverTest::test_new_binary_noticed() {
+    CPathResolver resolver;
+    QVERIFY(resolver.resolve("late", m_path_env).isEmpty());
+
+    // modification time of some file systems has resolution of 1 second
+    QTest::qWait(1100);
+    QString second = make_binary(m_second, "late");
+    QCOMPARE(resolver.resolve("late", m_path_env), second);
+
+    QTest::qWait(1100);
+    QString first = make_binary(m_first, "late");
+    QCOMPARE(resolver.resolve("late", m_path_env), first);
+    QCOMPARE(resolver.scans_count(), (quint64)3);
+}
+
+////////////////////////////////////////////////////////
+
+void PathResolverTest::test_removed_binary_noticed() {
+    CPathResolver resolver;
+    QString first = make_binary(m_first, "removed");
+    QString second = make_binary(m_second, "removed");
+    QCOMPARE(resolver.resolve("removed", m_path_env), first);
+    QVERIFY(QFile::remove(first));
+    QCOMPARE(resolver.resolve("removed", m_path_env), second);
+}
+
+////////////////////////////////////////////////////////
+
+void PathResolverTest::test_path_with_directory() {
+    CPathResolver resolver;
+    QString bin = make_binary(m_first, "absolute");
+    // saved paths from settings are checked as they are
+    QCOMPARE(resolver.resolve(bin, QString()), bin);
+    QVERIFY(resolver.resolve(m_first + "/absent", m_path_env).isEmpty());
+    QString plain = make_binary(m_first, "not_exec", false);
+    QVERIFY(resolver.resolve(plain, m_path_env).isEmpty());
+    QCOMPARE(resolver.scans_count(), (quint64)0);
+}
+
+////////////////////////////////////////////////////////
+
+void PathResolverTest::benchmark_resolver() {
+    make_binary(m_second, "bench");
+    CPathResolver resolver;
+    QBENCHMARK {
+        QCOMPARE(resolver.resolve("bench", m_path_env), m_second + "/bench");
+    }
+}
+
+////////////////////////////////////////////////////////
+
+void PathResolverTest::benchmark_which_process() {
+    make_binary(m_second, "bench");
+    // the way CSystemCallWrapper::which worked before: process per lookup
+    QBENCHMARK {
+        QStringList args = {m_second + "/bench"};
+        system_call_res_t res = CSystemCallWrapper::ssystem_th(which_cmd(), args, true, false, 5000);
+        QCOMPARE(res.out.size(), 1);
+    }
+}
+
+////////////////////////////////////////////////////////
+
+void PathResolverTest::cleanupTestCase() {
+    delete m_dir;
+}
@@ -0,0 +1,36 @@
+#ifndef PATHRESOLVERTEST_H
+#define PATHRESOLVERTEST_H
+
+#include <QObject>
+#include <QString>
+
+class QTemporaryDir;
+
+class PathResolverTest : public QObject
+{
+    Q_OBJECT
+private:
+    QTemporaryDir* m_dir = nullptr;
+    QString m_first;
+    QString m_second;
+    QString m_path_env;
+
+    QString make_dir(const QString& name);
+    QString make_binary(const QString& dir, const QString& name, bool executable = true);
+
+private slots:
+    void initTestCase();
+    void test_search_dirs();
+    void test_first_in_path();
+    void test_not_executable();
+    void test_cached();
+    void test_eviction();
+    void test_new_binary_noticed();
+    void test_removed_binary_noticed();
+    void test_path_with_directory();
+    void benchmark_resolver();
+    void benchmark_which_process();
+    void cleanupTestCase();
+};
+
+#endif // PATHRESOLVERTEST_H
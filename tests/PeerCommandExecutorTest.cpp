@@ -0,0 +1,202 @@
+#include "PeerCommandExecutorTest.h"
+#include <QFile>
+#include <QSignalSpy>
+#include <QTemporaryDir>
+#include <QTest>
+#include <map>
+#include <vector>
+
+CPeerCommandExecutor::job_t PeerCommandExecutorTest::fake_command(const QString& peer,
+                                                                  const QString& command) {
+    QString vagrant = m_vagrant;
+    return [this, vagrant, peer, command]() {
+        int now = m_running_now.fetchAndAddOrdered(1) + 1;
+        int max = m_running_max.load();
+        while (max < now && !m_running_max.testAndSetOrdered(max, now))
+            max = m_running_max.load();
+        system_call_res_t res = CSystemCallWrapper::ssystem_th(
+            vagrant, QStringList() << peer << command, true, true, 10000);
+        m_running_now.fetchAndAddOrdered(-1);
+        if (res.res != SCWE_SUCCESS) return res.res;
+        return res.exit_code == 0 ? SCWE_SUCCESS : SCWE_COMMAND_FAILED;
+    };
+}
+
+QStringList PeerCommandExecutorTest::vagrant_log() const {
+    QFile file(m_dir->path() + "/log");
+    if (!file.open(QIODevice::ReadOnly)) return QStringList();
+    return QString(file.readAll()).split("\n", QString::SkipEmptyParts);
+}
+
+////////////////////////////////////////////////////////
+
+void PeerCommandExecutorTest::initTestCase() {
+#ifdef RT_OS_WINDOWS
+    QSKIP("fake vagrant is shell script");
+#endif
+    m_dir = new QTemporaryDir;
+    QVERIFY(m_dir->isValid());
+
+    // every command takes a while, `fail` command fails
+    m_vagrant = m_dir->path() + "/vagrant";
+    QFile file(m_vagrant);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write(QString(
+        "#!/bin/sh\n"
+        "echo \"start $1 $2\" >> '%1/log'\n"
+        "sleep 0.2\n"
+        "echo \"end $1 $2\" >> '%1/log'\n"
+        "[ \"$2\" = 'fail' ] && exit 1\n"
+        "exit 0\n").arg(m_dir->path()).toUtf8());
+    file.close();
+    file.setPermissions(QFileDevice::ReadOwner | QFileDevice::WriteOwner |
+                        QFileDevice::ExeOwner);
+}
+
+void PeerCommandExecutorTest::init() {
+    QFile::remove(m_dir->path() + "/log");
+    m_running_now.store(0);
+    m_running_max.store(0);
+}
+
+////////////////////////////////////////////////////////
+
+void PeerCommandExecutorTest::test_bounded_workers() {
+    const int peers = 12;
+    CPeerCommandExecutor executor(3);
+    QSignalSpy progress(&executor, &CPeerCommandExecutor::progress);
+    std::vector<system_call_wrapper_error_t> results;
+
+    // bulk halt of many peers
+    for (int i = 0; i < peers; ++i) {
+        QString peer = QString("peer%1").arg(i);
+        executor.enqueue(peer, "halt", fake_command(peer, "halt"), nullptr,
+                         [&results](system_call_wrapper_error_t res) { results.push_back(res); });
+    }
+    QCOMPARE(executor.pending_count(), peers);
+    QTRY_COMPARE_WITH_TIMEOUT((int)results.size(), peers, 20000);
+
+    for (auto i = results.begin(); i != results.end(); ++i)
+        QCOMPARE(*i, SCWE_SUCCESS);
+    QVERIFY(m_running_max.load() <= 3);
+    QVERIFY(m_running_max.load() >= 2);
+    QCOMPARE(progress.count(), peers);
+    QCOMPARE(progress.last()[0].toInt(), peers);
+    QCOMPARE(progress.last()[1].toInt(), peers);
+    QCOMPARE(executor.pending_count(), 0);
+    QCOMPARE(vagrant_log().size(), peers * 2);
+}
+
+////////////////////////////////////////////////////////
+
+void PeerCommandExecutorTest::test_same_peer_serialized() {
+    CPeerCommandExecutor executor(4);
+    QStringList commands = QStringList() << "up" << "reload" << "halt" << "destroy";
+    QStringList done;
+    for (auto i = commands.begin(); i != commands.end(); ++i) {
+        QString command = *i;
+        executor.enqueue("peer", command, fake_command("peer", command), nullptr,
+                         [&done, command](system_call_wrapper_error_t) { done << command; });
+        executor.enqueue("other_" + command, command, fake_command("other_" + command, command),
+                         nullptr, nullptr);
+    }
+    QVERIFY(executor.is_busy("peer"));
+    QTRY_COMPARE_WITH_TIMEOUT(done.size(), commands.size(), 20000);
+    QCOMPARE(done, commands);
+    QTRY_VERIFY_WITH_TIMEOUT(!executor.is_busy("other_destroy"), 5000);
+
+    // commands of one peer never overlap and keep their order, other peers ran meanwhile
+    QStringList peer_log;
+    QStringList log = vagrant_log();
+    for (auto i = log.begin(); i != log.end(); ++i) {
+        if (i->split(" ").value(1) == "peer") peer_log << *i;
+    }
+    QStringList expected;
+    for (auto i = commands.begin(); i != commands.end(); ++i)
+        expected << "start peer " + *i << "end peer " + *i;
+    QCOMPARE(peer_log, expected);
+    QVERIFY(m_running_max.load() > 1);
+}
+
+////////////////////////////////////////////////////////
+
+void PeerCommandExecutorTest::test_failed_command() {
+    CPeerCommandExecutor executor(2);
+    QSignalSpy finished(&executor, &CPeerCommandExecutor::command_finished);
+    CPeerCommandExecutor::command_id_t id =
+        executor.enqueue("peer", "fail", fake_command("peer", "fail"), nullptr, nullptr);
+    QVERIFY(finished.wait(10000));
+    QCOMPARE(finished[0][0].toULongLong(), (qulonglong)id);
+    QCOMPARE(finished[0][2].toString(), QString("fail"));
+    QCOMPARE(finished[0][3].toInt(), (int)SCWE_COMMAND_FAILED);
+}
+
+////////////////////////////////////////////////////////
+
+void PeerCommandExecutorTest::test_cancel_queued() {
+    CPeerCommandExecutor executor(1);
+    QSignalSpy started(&executor, &CPeerCommandExecutor::command_started);
+    std::map<QString, system_call_wrapper_error_t> results;
+    auto remember = [&results](const QString& command) {
+        return [&results, command](system_call_wrapper_error_t res) { results[command] = res; };
+    };
+
+    CPeerCommandExecutor::command_id_t first =
+        executor.enqueue("peer", "up", fake_command("peer", "up"), nullptr, remember("up"));
+    CPeerCommandExecutor::command_id_t second =
+        executor.enqueue("peer", "reload", fake_command("peer", "reload"), nullptr, remember("reload"));
+    executor.enqueue("peer", "halt", fake_command("peer", "halt"), nullptr, remember("halt"));
+    // waits for free worker
+    CPeerCommandExecutor::command_id_t other =
+        executor.enqueue("other", "up", fake_command("other", "up"), nullptr, remember("other"));
+
+    QVERIFY(started.wait(5000));
+    QVERIFY(!executor.cancel(first));
+    QVERIFY(executor.cancel(second));
+    QVERIFY(executor.cancel(other));
+    QVERIFY(!executor.cancel(other));
+
+    QTRY_COMPARE_WITH_TIMEOUT((int)results.size(), 4, 20000);
+    QCOMPARE(results["up"], SCWE_SUCCESS);
+    QCOMPARE(results["reload"], SCWE_CANCELLED);
+    QCOMPARE(results["halt"], SCWE_SUCCESS);
+    QCOMPARE(results["other"], SCWE_CANCELLED);
+    QCOMPARE(vagrant_log(), QStringList() << "start peer up" << "end peer up"
+                                          << "start peer halt" << "end peer halt");
+}
+
+////////////////////////////////////////////////////////
+
+void PeerCommandExecutorTest::test_cancel_peer() {
+    CPeerCommandExecutor executor(1);
+    QSignalSpy finished(&executor, &CPeerCommandExecutor::command_finished);
+    executor.enqueue("blocker", "up", fake_command("blocker", "up"), nullptr, nullptr);
+    for (int i = 0; i < 5; ++i)
+        executor.enqueue("peer", "halt", fake_command("peer", "halt"), nullptr, nullptr);
+    executor.enqueue("other", "halt", fake_command("other", "halt"), nullptr, nullptr);
+
+    QCOMPARE(executor.cancel_peer("peer"), 5);
+    QTRY_COMPARE_WITH_TIMEOUT(finished.count(), 7, 20000);
+    QCOMPARE(vagrant_log().size(), 4);
+    QVERIFY(!executor.is_busy("peer"));
+}
+
+////////////////////////////////////////////////////////
+
+void PeerCommandExecutorTest::test_context_destroyed() {
+    CPeerCommandExecutor executor(2);
+    QSignalSpy finished(&executor, &CPeerCommandExecutor::command_finished);
+    QObject* context = new QObject;
+    bool called = false;
+    executor.enqueue("peer", "halt", fake_command("peer", "halt"), context,
+                     [&called](system_call_wrapper_error_t) { called = true; });
+    delete context;
+    QVERIFY(finished.wait(10000));
+    QVERIFY(!called);
+}
+
+////////////////////////////////////////////////////////
+
+void PeerCommandExecutorTest::cleanupTestCase() {
+    delete m_dir;
+}
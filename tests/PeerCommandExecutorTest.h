@@ -0,0 +1,36 @@
+#ifndef PEERCOMMANDEXECUTORTEST_H
+#define PEERCOMMANDEXECUTORTEST_H
+
+#include <QAtomicInt>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include "PeerCommandExecutor.h"
+
+class QTemporaryDir;
+
+class PeerCommandExecutorTest : public QObject
+{
+    Q_OBJECT
+private:
+    QTemporaryDir* m_dir = nullptr;
+    QString m_vagrant;
+    QAtomicInt m_running_now;
+    QAtomicInt m_running_max;
+
+    CPeerCommandExecutor::job_t fake_command(const QString& peer, const QString& command);
+    QStringList vagrant_log() const;
+
+private slots:
+    void initTestCase();
+    void init();
+    void test_bounded_workers();
+    void test_same_peer_serialized();
+    void test_failed_command();
+    void test_cancel_queued();
+    void test_cancel_peer();
+    void test_context_destroyed();
+    void cleanupTestCase();
+};
+
+#endif // PEERCOMMANDEXECUTORTEST_H
@@ -0,0 +1,144 @@
+#include "PeerCommandWatcherTest.h"
+#include "PeerCommandWatcher.h"
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QSignalSpy>
+#include <QTemporaryDir>
+#include <QTest>
+
+QString PeerCommandWatcherTest::make_peer(const QString& name) {
+    QString dir = QDir::cleanPath(m_dir->path() + "/subutai-peer_" + name);
+    QDir().mkpath(dir);
+    write_file(dir + "/Vagrantfile", "Vagrant.configure('2')\n");
+    return dir;
+}
+
+void PeerCommandWatcherTest::write_file(const QString& path, const QByteArray& data, bool append) {
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::WriteOnly | (append ? QIODevice::Append : QIODevice::Truncate)));
+    file.write(data);
+    file.close();
+}
+
+////////////////////////////////////////////////////////
+
+void PeerCommandWatcherTest::init() {
+    m_dir = new QTemporaryDir;
+    QVERIFY(m_dir->isValid());
+    m_watcher = new CPeerCommandWatcher([](const QString& dir_name) {
+        return dir_name.startsWith("subutai-peer_") ? dir_name.mid(13) : QString();
+    });
+}
+
+////////////////////////////////////////////////////////
+
+void PeerCommandWatcherTest::test_finished_marker() {
+    QString dir = make_peer("alpha");
+    m_watcher->set_base_dir(m_dir->path());
+    QCOMPARE(m_watcher->peer_dirs(), QStringList() << dir);
+    QSignalSpy spy(m_watcher, &CPeerCommandWatcher::command_finished);
+
+    QElapsedTimer timer;
+    timer.start();
+    write_file(dir + "/alpha_halt", "");
+    write_file(dir + "/halt_finished", "finished\n");
+    QVERIFY(spy.wait(5000));
+    // notification comes from watcher, not from 7 seconds polling
+    QVERIFY(timer.elapsed() < 2000);
+
+    QCOMPARE(spy.count(), 1);
+    QCOMPARE(spy[0][0].toString(), QString("alpha"));
+    QCOMPARE(spy[0][1].toString(), dir);
+    QCOMPARE(spy[0][2].toString(), QString("halt"));
+    QVERIFY(spy[0][3].toString().isEmpty());
+    QVERIFY(!QFile::exists(dir + "/halt_finished"));
+    QVERIFY(!QFile::exists(dir + "/alpha_halt"));
+    QVERIFY(QFile::exists(dir + "/Vagrantfile"));
+}
+
+////////////////////////////////////////////////////////
+
+void PeerCommandWatcherTest::test_log_followed() {
+    QString dir = make_peer("beta");
+    m_watcher->set_base_dir(m_dir->path());
+    QSignalSpy spy(m_watcher, &CPeerCommandWatcher::command_finished);
+
+    write_file(dir + "/beta_reload", "first line\n");
+    QTRY_COMPARE_WITH_TIMEOUT(m_watcher->log_so_far(dir, "reload"), QString("first line\n"), 5000);
+    write_file(dir + "/beta_reload", "\x1b[31msecond line\x1b[0m\n", true);
+    QTRY_COMPARE_WITH_TIMEOUT(m_watcher->log_so_far(dir, "reload"),
+                              QString("first line\n\x1b[31msecond line\x1b[0m\n"), 5000);
+
+    write_file(dir + "/reload_finished", "finished\n");
+    QVERIFY(spy.wait(5000));
+    QCOMPARE(spy[0][2].toString(), QString("reload"));
+    QCOMPARE(spy[0][3].toString(), QString("first line\nsecond line\n"));
+    QVERIFY(m_watcher->log_so_far(dir, "reload").isEmpty());
+}
+
+////////////////////////////////////////////////////////
+
+void PeerCommandWatcherTest::test_marker_before_start() {
+    QString dir = make_peer("gamma");
+    write_file(dir + "/gamma_destroy", "error\n");
+    write_file(dir + "/destroy_finished", "finished\n");
+
+    QSignalSpy spy(m_watcher, &CPeerCommandWatcher::command_finished);
+    m_watcher->set_base_dir(m_dir->path());
+    QCOMPARE(spy.count(), 1);
+    QCOMPARE(spy[0][2].toString(), QString("destroy"));
+    QCOMPARE(spy[0][3].toString(), QString("error\n"));
+
+    // same directory isn't scanned again
+    m_watcher->set_base_dir(m_dir->path() + "/");
+    QCOMPARE(spy.count(), 1);
+}
+
+////////////////////////////////////////////////////////
+
+void PeerCommandWatcherTest::test_new_peer() {
+    m_watcher->set_base_dir(m_dir->path());
+    QVERIFY(m_watcher->peer_dirs().isEmpty());
+    QSignalSpy spy(m_watcher, &CPeerCommandWatcher::command_finished);
+
+    QString dir = make_peer("delta");
+    QTRY_COMPARE_WITH_TIMEOUT(m_watcher->peer_dirs(), QStringList() << dir, 5000);
+    write_file(dir + "/up_finished", "finished\n");
+    QVERIFY(spy.wait(5000));
+    QCOMPARE(spy[0][0].toString(), QString("delta"));
+    QCOMPARE(spy[0][2].toString(), QString("up"));
+
+    QVERIFY(QDir(dir).removeRecursively());
+    QTRY_VERIFY_WITH_TIMEOUT(m_watcher->peer_dirs().isEmpty(), 5000);
+}
+
+////////////////////////////////////////////////////////
+
+void PeerCommandWatcherTest::test_not_peer_ignored() {
+    QString other = m_dir->path() + "/other";
+    QDir().mkpath(other);
+    write_file(other + "/halt_finished", "finished\n");
+    QSignalSpy spy(m_watcher, &CPeerCommandWatcher::command_finished);
+    m_watcher->set_base_dir(m_dir->path());
+    QVERIFY(m_watcher->peer_dirs().isEmpty());
+    QTest::qWait(200);
+    QCOMPARE(spy.count(), 0);
+    QVERIFY(QFile::exists(other + "/halt_finished"));
+}
+
+////////////////////////////////////////////////////////
+
+void PeerCommandWatcherTest::test_clean_messages() {
+    QCOMPARE(CPeerCommandWatcher::clean_messages("\x1b[1;33mwarning\x1b[0m: text"),
+             QString("warning: text"));
+}
+
+////////////////////////////////////////////////////////
+
+void PeerCommandWatcherTest::cleanup() {
+    delete m_watcher;
+    m_watcher = nullptr;
+    delete m_dir;
+    m_dir = nullptr;
+}
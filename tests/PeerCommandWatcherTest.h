@@ -0,0 +1,31 @@
+#ifndef PEERCOMMANDWATCHERTEST_H
+#define PEERCOMMANDWATCHERTEST_H
+
+#include <QObject>
+#include <QString>
+
+class CPeerCommandWatcher;
+class QTemporaryDir;
+
+class PeerCommandWatcherTest : public QObject
+{
+    Q_OBJECT
+private:
+    QTemporaryDir* m_dir = nullptr;
+    CPeerCommandWatcher* m_watcher = nullptr;
+
+    QString make_peer(const QString& name);
+    void write_file(const QString& path, const QByteArray& data, bool append = false);
+
+private slots:
+    void init();
+    void test_finished_marker();
+    void test_log_followed();
+    void test_marker_before_start();
+    void test_new_peer();
+    void test_not_peer_ignored();
+    void test_clean_messages();
+    void cleanup();
+};
+
+#endif // PEERCOMMANDWATCHERTEST_H
@@ -0,0 +1,200 @@
+#include "PeerStatusPipelineTest.h"
+#include "PeerStatusPipeline.h"
+#include <QElapsedTimer>
+#include <QSignalSpy>
+#include <QTest>
+#include <QThread>
+#include <QTimer>
+
+const int PeerStatusPipelineTest::PEERS_COUNT;
+const int PeerStatusPipelineTest::PROBE_MS;
+
+std::vector<std::pair<QString, QString> > PeerStatusPipelineTest::make_peers(int count) const {
+    std::vector<std::pair<QString, QString> > res;
+    for (int i = 0; i < count; ++i) {
+        QString name = QString("peer%1").arg(i);
+        res.push_back(std::make_pair(name, "/peers/subutai-peer_" + name));
+    }
+    return res;
+}
+
+CPeerStatusPipeline* PeerStatusPipelineTest::make_pipeline(int max_parallel) {
+    // status probe blocks like `vagrant status` does, REST probes reply later
+    return new CPeerStatusPipeline(
+        [this](const QString& dir) {
+            ++m_status_calls;
+            int now = m_running_now.fetchAndAddOrdered(1) + 1;
+            int max = m_running_max.load();
+            while (max < now && !m_running_max.testAndSetOrdered(max, now))
+                max = m_running_max.load();
+            QThread::msleep(PROBE_MS);
+            m_running_now.fetchAndAddOrdered(-1);
+            return dir.contains("stopped") ? QString("poweroff") : QString("running");
+        },
+        [](const QString& dir) {
+            return dir.contains("noport") ? QString("undefined") : QString("9999");
+        },
+        [](const QString& name, const QString&, const QString& port,
+           CPeerStatusPipeline::reply_t reply) {
+            QTimer::singleShot(10, [name, port, reply]() { reply("finger-" + name + "-" + port); });
+        },
+        [](const QString&, const QString&, const QString&,
+           CPeerStatusPipeline::reply_t reply) {
+            QTimer::singleShot(10, [reply]() { reply("false"); });
+        },
+        max_parallel);
+}
+
+bool PeerStatusPipelineTest::wait_idle(CPeerStatusPipeline* pipeline, int timeout_ms) {
+    QSignalSpy spy(pipeline, &CPeerStatusPipeline::idle);
+    return pipeline->in_flight_count() == 0 || spy.wait(timeout_ms);
+}
+
+////////////////////////////////////////////////////////
+
+void PeerStatusPipelineTest::init() {
+    m_status_calls.store(0);
+    m_running_now.store(0);
+    m_running_max.store(0);
+}
+
+////////////////////////////////////////////////////////
+
+void PeerStatusPipelineTest::test_stages() {
+    CPeerStatusPipeline* pipeline = make_pipeline(4);
+    QSignalSpy stages(pipeline, &CPeerStatusPipeline::stage_finished);
+    QSignalSpy finished(pipeline, &CPeerStatusPipeline::peer_finished);
+
+    QCOMPARE(pipeline->submit(make_peers(1)), 1);
+    QVERIFY(pipeline->is_in_flight("/peers/subutai-peer_peer0"));
+    QVERIFY(pipeline->is_checking_status("/peers/subutai-peer_peer0"));
+    QVERIFY(wait_idle(pipeline, 5000));
+
+    // status, port, finger and update
+    QCOMPARE(stages.count(), 4);
+    QCOMPARE(stages[0][0].toInt(), (int)CPeerStatusPipeline::ST_STATUS);
+    QCOMPARE(stages[0][3].toString(), QString("running"));
+    QCOMPARE(stages[1][0].toInt(), (int)CPeerStatusPipeline::ST_PORT);
+    QCOMPARE(finished.count(), 1);
+
+    peer_state_t st = pipeline->peer("/peers/subutai-peer_peer0/");
+    QCOMPARE(st.name, QString("peer0"));
+    QCOMPARE(st.status, QString("running"));
+    QCOMPARE(st.port, QString("9999"));
+    QCOMPARE(st.finger, QString("finger-peer0-9999"));
+    QCOMPARE(st.update, QString("false"));
+    QVERIFY(!st.in_flight);
+    QVERIFY(!pipeline->is_checking_status("/peers/subutai-peer_peer0"));
+    delete pipeline;
+}
+
+////////////////////////////////////////////////////////
+
+void PeerStatusPipelineTest::test_not_running_peer() {
+    CPeerStatusPipeline* pipeline = make_pipeline(4);
+    QSignalSpy stages(pipeline, &CPeerStatusPipeline::stage_finished);
+    std::vector<std::pair<QString, QString> > peers;
+    peers.push_back(std::make_pair(QString("stopped"), QString("/peers/stopped")));
+    peers.push_back(std::make_pair(QString("noport"), QString("/peers/noport")));
+
+    QCOMPARE(pipeline->submit(peers), 2);
+    QVERIFY(wait_idle(pipeline, 5000));
+    // stopped peer has status only, peer without port has no REST stages
+    QCOMPARE(stages.count(), 3);
+    QCOMPARE(pipeline->peer("/peers/stopped").status, QString("poweroff"));
+    QVERIFY(pipeline->peer("/peers/stopped").port.isEmpty());
+    QCOMPARE(pipeline->peer("/peers/noport").port, QString("undefined"));
+    QVERIFY(pipeline->peer("/peers/noport").finger.isEmpty());
+    delete pipeline;
+}
+
+////////////////////////////////////////////////////////
+
+void PeerStatusPipelineTest::test_in_flight_dedup() {
+    CPeerStatusPipeline* pipeline = make_pipeline(4);
+    QCOMPARE(pipeline->submit(make_peers(3)), 3);
+    QCOMPARE(pipeline->submit(make_peers(4)), 1);
+    QCOMPARE(pipeline->in_flight_count(), 4);
+    QVERIFY(wait_idle(pipeline, 5000));
+    QCOMPARE(m_status_calls.load(), 4);
+
+    QCOMPARE(pipeline->submit(make_peers(4)), 4);
+    QVERIFY(wait_idle(pipeline, 5000));
+    QCOMPARE(m_status_calls.load(), 8);
+    delete pipeline;
+}
+
+////////////////////////////////////////////////////////
+
+void PeerStatusPipelineTest::test_command_running() {
+    CPeerStatusPipeline* pipeline = make_pipeline(4);
+    // directories are compared normalized
+    pipeline->set_command_running("/peers/subutai-peer_peer1/./", true);
+    QVERIFY(pipeline->is_command_running("/peers/subutai-peer_peer1"));
+    QCOMPARE(pipeline->submit(make_peers(2)), 1);
+    QVERIFY(wait_idle(pipeline, 5000));
+    QCOMPARE(m_status_calls.load(), 1);
+
+    pipeline->set_command_running("/peers/subutai-peer_peer1", false);
+    QCOMPARE(pipeline->submit(make_peers(2)), 2);
+    QVERIFY(wait_idle(pipeline, 5000));
+    QCOMPARE(m_status_calls.load(), 3);
+    delete pipeline;
+}
+
+////////////////////////////////////////////////////////
+
+void PeerStatusPipelineTest::test_abandon() {
+    CPeerStatusPipeline* pipeline = make_pipeline(4);
+    QSignalSpy stages(pipeline, &CPeerStatusPipeline::stage_finished);
+    QCOMPARE(pipeline->submit(make_peers(2)), 2);
+    pipeline->abandon();
+    QCOMPARE(pipeline->in_flight_count(), 0);
+    QVERIFY(!pipeline->is_in_flight("/peers/subutai-peer_peer0"));
+
+    // results of abandoned refresh are dropped
+    QTest::qWait(PROBE_MS * 2);
+    QCOMPARE(stages.count(), 0);
+
+    QCOMPARE(pipeline->submit(make_peers(2)), 2);
+    QVERIFY(wait_idle(pipeline, 5000));
+    QCOMPARE(stages.count(), 8);
+    delete pipeline;
+}
+
+////////////////////////////////////////////////////////
+
+void PeerStatusPipelineTest::test_bounded() {
+    CPeerStatusPipeline* pipeline = make_pipeline(3);
+    QCOMPARE(pipeline->submit(make_peers(PEERS_COUNT)), PEERS_COUNT);
+    QVERIFY(wait_idle(pipeline, PROBE_MS * PEERS_COUNT * 3));
+    QCOMPARE(m_status_calls.load(), PEERS_COUNT);
+    QVERIFY(m_running_max.load() <= 3);
+    QVERIFY(m_running_max.load() >= 2);
+    delete pipeline;
+}
+
+////////////////////////////////////////////////////////
+
+void PeerStatusPipelineTest::test_parallel_latency() {
+    QElapsedTimer timer;
+    CPeerStatusPipeline* serial = make_pipeline(1);
+    timer.start();
+    serial->submit(make_peers(PEERS_COUNT));
+    QVERIFY(wait_idle(serial, PROBE_MS * PEERS_COUNT * 3));
+    qint64 serial_ms = timer.elapsed();
+    delete serial;
+
+    CPeerStatusPipeline* parallel = make_pipeline(PEERS_COUNT);
+    timer.restart();
+    parallel->submit(make_peers(PEERS_COUNT));
+    QVERIFY(wait_idle(parallel, PROBE_MS * PEERS_COUNT * 3));
+    qint64 parallel_ms = timer.elapsed();
+    delete parallel;
+
+    qDebug() << PEERS_COUNT << "peers, serial:" << serial_ms
+             << "ms, parallel:" << parallel_ms << "ms";
+    // sum of all peers vs the slowest one
+    QVERIFY(serial_ms >= PROBE_MS * PEERS_COUNT);
+    QVERIFY(parallel_ms < PROBE_MS * 3);
+}
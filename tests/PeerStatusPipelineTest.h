@@ -0,0 +1,38 @@
+#ifndef PEERSTATUSPIPELINETEST_H
+#define PEERSTATUSPIPELINETEST_H
+
+#include <utility>
+#include <vector>
+#include <QAtomicInt>
+#include <QObject>
+#include <QString>
+
+class CPeerStatusPipeline;
+
+class PeerStatusPipelineTest : public QObject
+{
+    Q_OBJECT
+private:
+    static const int PEERS_COUNT = 8;
+    static const int PROBE_MS = 300;
+
+    QAtomicInt m_status_calls;
+    QAtomicInt m_running_now;
+    QAtomicInt m_running_max;
+
+    std::vector<std::pair<QString, QString> > make_peers(int count) const;
+    CPeerStatusPipeline* make_pipeline(int max_parallel);
+    bool wait_idle(CPeerStatusPipeline* pipeline, int timeout_ms);
+
+private slots:
+    void init();
+    void test_stages();
+    void test_not_running_peer();
+    void test_in_flight_dedup();
+    void test_command_running();
+    void test_abandon();
+    void test_bounded();
+    void test_parallel_latency();
+};
+
+#endif // PEERSTATUSPIPELINETEST_H
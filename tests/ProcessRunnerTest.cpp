@@ -0,0 +1,330 @@
+#include "ProcessRunnerTest.h"
+#include "ProcessRunner.h"
+#include <algorithm>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTemporaryDir>
+#include <QTest>
+#include <QtConcurrent/QtConcurrent>
+
+/* results of one process collected by callbacks */
+struct run_state_t {
+    bool started;
+    bool finished;
+    system_call_res_t res;
+    QStringList out_lines;
+    QStringList err_lines;
+    int lines_before_finish;
+    run_state_t() : started(false), finished(false), lines_before_finish(0) {}
+};
+
+static process_callbacks_t collecting_callbacks(run_state_t* st) {
+    process_callbacks_t cb;
+    cb.started = [st]() { st->started = true; };
+    cb.line = [st](const QString& line, bool is_stderr) {
+        (is_stderr ? st->err_lines : st->out_lines) << line;
+        if (!st->finished) ++st->lines_before_finish;
+    };
+    cb.finished = [st](const system_call_res_t& res) {
+        st->res = res;
+        st->finished = true;
+    };
+    return cb;
+}
+
+static bool wait_finished(const run_state_t& st, int timeout_ms = 10000) {
+    QElapsedTimer et;
+    et.start();
+    while (!st.finished && et.elapsed() < timeout_ms)
+        QTest::qWait(10);
+    return st.finished;
+}
+
+QString ProcessRunnerTest::fake_binary(const QString& name, const QByteArray& script) {
+    QString path = m_dir->path() + QDir::separator() + name;
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) return QString();
+    file.write("#!/bin/sh\n");
+    file.write(script);
+    file.close();
+    file.setPermissions(QFileDevice::ReadOwner | QFileDevice::WriteOwner | QFileDevice::ExeOwner);
+    return path;
+}
+
+void ProcessRunnerTest::initTestCase() {
+#ifdef RT_OS_WINDOWS
+    QSKIP("fake binaries are shell scripts");
+#endif
+    m_dir = new QTemporaryDir;
+    QVERIFY(m_dir->isValid());
+    m_runner = new CProcessRunner;
+}
+
+void ProcessRunnerTest::init() {
+    m_runner->set_max_running(CProcessRunner::DEFAULT_MAX_RUNNING);
+}
+
+////////////////////////////////////////////////////////
+
+void ProcessRunnerTest::test_output_and_exit_code() {
+    QString bin = fake_binary("version", "echo 'p2p version 8.0.1'\necho\necho 'warning' >&2\nexit 3\n");
+    run_state_t st;
+    process_options_t opts;
+    m_runner->start(bin, QStringList(), opts, nullptr, collecting_callbacks(&st));
+    QVERIFY(wait_finished(st));
+
+    QVERIFY(st.started);
+    QCOMPARE(st.res.res, SCWE_SUCCESS);
+    QCOMPARE(st.res.exit_code, 3);
+    // empty lines are skipped, stderr isn't collected into out
+    QCOMPARE(st.res.out, QStringList({"p2p version 8.0.1"}));
+    QCOMPARE(st.out_lines, QStringList({"p2p version 8.0.1"}));
+    QCOMPARE(st.err_lines, QStringList({"warning"}));
+}
+
+////////////////////////////////////////////////////////
+
+void ProcessRunnerTest::test_streamed_lines() {
+    QString bin = fake_binary("stream", "echo first\nsleep 1\nprintf second\n");
+    run_state_t st;
+    process_options_t opts;
+    opts.collect_output = false;
+    m_runner->start(bin, QStringList(), opts, nullptr, collecting_callbacks(&st));
+
+    QElapsedTimer et;
+    et.start();
+    while (st.out_lines.isEmpty() && et.elapsed() < 5000)
+        QTest::qWait(10);
+    // first line comes while process is still running
+    QCOMPARE(st.out_lines, QStringList({"first"}));
+    QVERIFY(!st.finished);
+
+    QVERIFY(wait_finished(st));
+    // last line without '\n' is flushed on finish
+    QCOMPARE(st.out_lines, QStringList({"first", "second"}));
+    QCOMPARE(st.lines_before_finish, 2);
+    QVERIFY(st.res.out.isEmpty());
+}
+
+////////////////////////////////////////////////////////
+
+void ProcessRunnerTest::test_deadline() {
+    QString bin = fake_binary("hanging", "echo begin\nsleep 30\n");
+    run_state_t st;
+    process_options_t opts;
+    opts.timeout_msec = 300;
+    QElapsedTimer et;
+    et.start();
+    m_runner->start(bin, QStringList(), opts, nullptr, collecting_callbacks(&st));
+    QVERIFY(wait_finished(st));
+
+    QCOMPARE(st.res.res, SCWE_TIMEOUT);
+    QCOMPARE(st.res.out, QStringList({"begin"}));
+    QVERIFY(et.elapsed() < 300 + CProcessRunner::KILL_GRACE_MS + 1000);
+}
+
+////////////////////////////////////////////////////////
+
+void ProcessRunnerTest::test_cancel() {
+    QString bin = fake_binary("long", "sleep 30\n");
+    m_runner->set_max_running(1);
+    run_state_t running, pending;
+    process_options_t opts;
+    CProcessRunner::process_id_t running_id =
+        m_runner->start(bin, QStringList(), opts, nullptr, collecting_callbacks(&running));
+    CProcessRunner::process_id_t pending_id =
+        m_runner->start(bin, QStringList(), opts, nullptr, collecting_callbacks(&pending));
+    QTRY_VERIFY(running.started);
+
+    m_runner->cancel(pending_id);
+    QVERIFY(wait_finished(pending, 1000));
+    QCOMPARE(pending.res.res, SCWE_CANCELLED);
+    QVERIFY(!pending.started);
+
+    QElapsedTimer et;
+    et.start();
+    m_runner->cancel(running_id);
+    QVERIFY(wait_finished(running));
+    QCOMPARE(running.res.res, SCWE_CANCELLED);
+    QVERIFY(et.elapsed() < 5000);
+    QCOMPARE(m_runner->running_count(), 0);
+}
+
+////////////////////////////////////////////////////////
+
+void ProcessRunnerTest::test_failed_to_start() {
+    run_state_t st;
+    process_options_t opts;
+    opts.log = false;
+    m_runner->start(m_dir->path() + "/no_such_binary", QStringList(), opts,
+                    nullptr, collecting_callbacks(&st));
+    QVERIFY(wait_finished(st));
+    QCOMPARE(st.res.res, SCWE_CREATE_PROCESS);
+    QVERIFY(!st.started);
+    QCOMPARE(m_runner->running_count(), 0);
+}
+
+////////////////////////////////////////////////////////
+
+void ProcessRunnerTest::test_bounded_processes() {
+    static const int count = 6;
+    static const int max_running = 2;
+    QString bin = fake_binary("probe", "sleep 0.3\necho done\n");
+    m_runner->set_max_running(max_running);
+
+    std::vector<run_state_t> states(count);
+    int running = 0, max_observed = 0;
+    QElapsedTimer et;
+    et.start();
+    for (int i = 0; i < count; ++i) {
+        process_callbacks_t cb = collecting_callbacks(&states[i]);
+        cb.started = [&states, i, &running, &max_observed]() {
+            states[i].started = true;
+            max_observed = std::max(max_observed, ++running);
+        };
+        auto finished = cb.finished;
+        cb.finished = [finished, &running](const system_call_res_t& res) {
+            --running;
+            finished(res);
+        };
+        m_runner->start(bin, QStringList(), process_options_t(), nullptr, cb);
+    }
+    for (int i = 0; i < count; ++i) {
+        QVERIFY(wait_finished(states[i]));
+        QCOMPARE(states[i].res.out, QStringList({"done"}));
+    }
+
+    QCOMPARE(max_observed, max_running);
+    // count / max_running waves of processes
+    QVERIFY(et.elapsed() >= 300 * count / max_running);
+}
+
+////////////////////////////////////////////////////////
+
+void ProcessRunnerTest::test_working_directory() {
+    QString bin = fake_binary("pwd", "pwd\n");
+    run_state_t st;
+    process_options_t opts;
+    opts.working_dir = m_dir->path();
+    m_runner->start(bin, QStringList(), opts, nullptr, collecting_callbacks(&st));
+    QVERIFY(wait_finished(st));
+    QCOMPARE(st.res.out.size(), 1);
+    QCOMPARE(QDir(st.res.out.front()).canonicalPath(), QDir(m_dir->path()).canonicalPath());
+}
+
+////////////////////////////////////////////////////////
+
+void ProcessRunnerTest::test_context_destroyed() {
+    QString bin = fake_binary("slow", "sleep 0.3\necho late\n");
+    run_state_t st, marker;
+    QObject* context = new QObject;
+    m_runner->start(bin, QStringList(), process_options_t(), context, collecting_callbacks(&st));
+    // the same process without context tells when the first one is done
+    m_runner->start(bin, QStringList(), process_options_t(), nullptr, collecting_callbacks(&marker));
+    delete context;
+
+    QVERIFY(wait_finished(marker));
+    QTest::qWait(50);
+    QVERIFY(!st.finished);
+    QVERIFY(st.out_lines.isEmpty());
+}
+
+////////////////////////////////////////////////////////
+
+void ProcessRunnerTest::test_execute_from_other_thread() {
+    QString bin = fake_binary("args", "for a in \"$@\"; do echo \"$a\"; done\n");
+    CProcessRunner* runner = m_runner;
+    QFuture<system_call_res_t> res = QtConcurrent::run([runner, bin]() {
+        return runner->execute(bin, QStringList({"a b", "c"}), process_options_t());
+    });
+    QElapsedTimer et;
+    et.start();
+    while (!res.isFinished() && et.elapsed() < 10000)
+        QTest::qWait(10);
+    QVERIFY(res.isFinished());
+    QCOMPARE(res.result().res, SCWE_SUCCESS);
+    QCOMPARE(res.result().out, QStringList({"a b", "c"}));
+
+    // own thread isn't blocked, process isn't started there
+    et.restart();
+    system_call_res_t own = m_runner->execute(bin, QStringList({"d"}), process_options_t());
+    QCOMPARE(own.res, SCWE_CANCELLED);
+    QVERIFY(own.out.isEmpty());
+    QVERIFY(et.elapsed() < 1000);
+}
+
+////////////////////////////////////////////////////////
+
+void ProcessRunnerTest::test_long_running_lane() {
+    QString long_bin = fake_binary("vagrant_like", "sleep 30\n");
+    QString short_bin = fake_binary("short", "echo short\n");
+    m_runner->set_max_running(1);
+    m_runner->set_max_long_running(1);
+
+    run_state_t long_st, short_st;
+    process_options_t long_opts;
+    long_opts.long_running = true;
+    CProcessRunner::process_id_t long_id =
+        m_runner->start(long_bin, QStringList(), long_opts, nullptr, collecting_callbacks(&long_st));
+    QTRY_VERIFY(long_st.started);
+
+    // long process doesn't hold the only slot of short ones
+    m_runner->start(short_bin, QStringList(), process_options_t(), nullptr, collecting_callbacks(&short_st));
+    QVERIFY(wait_finished(short_st, 5000));
+    QCOMPARE(short_st.res.out, QStringList({"short"}));
+    QVERIFY(!long_st.finished);
+
+    m_runner->cancel(long_id);
+    QVERIFY(wait_finished(long_st));
+    QCOMPARE(long_st.res.res, SCWE_CANCELLED);
+    m_runner->set_max_long_running(CProcessRunner::DEFAULT_MAX_LONG_RUNNING);
+}
+
+////////////////////////////////////////////////////////
+
+void ProcessRunnerTest::test_quit_wakes_waiters() {
+    QString bin = fake_binary("forever", "sleep 30\n");
+    CProcessRunner* runner = new CProcessRunner;
+    QFuture<system_call_res_t> res = QtConcurrent::run([runner, bin]() {
+        return runner->execute(bin, QStringList(), process_options_t());
+    });
+    QTRY_COMPARE(runner->running_count(), 1);
+
+    // quitting finishes running process at once, waiter isn't left parked
+    QElapsedTimer et;
+    et.start();
+    delete runner;
+    while (!res.isFinished() && et.elapsed() < 10000)
+        QTest::qWait(10);
+    QVERIFY(res.isFinished());
+    QCOMPARE(res.result().res, SCWE_CANCELLED);
+    QVERIFY(et.elapsed() < CProcessRunner::KILL_GRACE_MS + 1000);
+}
+
+////////////////////////////////////////////////////////
+
+void ProcessRunnerTest::test_ssystem_th() {
+    QString bin = fake_binary("ls_like", "pwd\necho \"$1\"\n");
+    QStringList args = {"set_working_directory", m_dir->path(), "arg"};
+    QStringList args_copy = args;
+    system_call_res_t res = CSystemCallWrapper::ssystem_th(bin, args, true, true, 5000);
+    QCOMPARE(res.res, SCWE_SUCCESS);
+    QCOMPARE(res.out.size(), 2);
+    QCOMPARE(QDir(res.out[0]).canonicalPath(), QDir(m_dir->path()).canonicalPath());
+    QCOMPARE(res.out[1], QString("arg"));
+    // caller's arguments aren't changed
+    QCOMPARE(args, args_copy);
+
+    QString hanging = fake_binary("ssystem_hanging", "sleep 30\n");
+    QStringList no_args;
+    res = CSystemCallWrapper::ssystem_th(hanging, no_args, true, false, 200);
+    QCOMPARE(res.res, SCWE_TIMEOUT);
+}
+
+////////////////////////////////////////////////////////
+
+void ProcessRunnerTest::cleanupTestCase() {
+    delete m_runner;
+    delete m_dir;
+}
@@ -0,0 +1,37 @@
+#ifndef PROCESSRUNNERTEST_H
+#define PROCESSRUNNERTEST_H
+
+#include <QObject>
+#include <QString>
+
+class CProcessRunner;
+class QTemporaryDir;
+
+class ProcessRunnerTest : public QObject
+{
+    Q_OBJECT
+private:
+    QTemporaryDir* m_dir = nullptr;
+    CProcessRunner* m_runner = nullptr;
+
+    QString fake_binary(const QString& name, const QByteArray& script);
+
+private slots:
+    void initTestCase();
+    void init();
+    void test_output_and_exit_code();
+    void test_streamed_lines();
+    void test_deadline();
+    void test_cancel();
+    void test_failed_to_start();
+    void test_bounded_processes();
+    void test_working_directory();
+    void test_context_destroyed();
+    void test_execute_from_other_thread();
+    void test_long_running_lane();
+    void test_quit_wakes_waiters();
+    void test_ssystem_th();
+    void cleanupTestCase();
+};
+
+#endif // PROCESSRUNNERTEST_H
@@ -0,0 +1,307 @@
+#include "ReachabilityCheckerTest.h"
+#include "ReachabilityChecker.h"
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSignalSpy>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTest>
+#include <QThread>
+#include <map>
+#include <vector>
+
+/* connects to host:port and waits for first bytes from server (ssh sends
+ * its version), so host which accepts connections and hangs is unreachable */
+static bool tcp_connect(const QString& host, quint16 port, int timeout_ms) {
+    QElapsedTimer timer;
+    timer.start();
+    QTcpSocket socket;
+    socket.connectToHost(host, port);
+    if (!socket.waitForConnected(timeout_ms)) return false;
+    int left = timeout_ms - (int)timer.elapsed();
+    return socket.bytesAvailable() > 0 ||
+        (left > 0 && socket.waitForReadyRead(left));
+}
+
+/* target is host:port, anything after '#' only makes targets different */
+static CReachabilityChecker::probe_t tcp_probe() {
+    return [](const QString& target, int timeout_ms) {
+        QString address = target.section('#', 0, 0);
+        return tcp_connect(address.section(':', 0, 0),
+                           address.section(':', 1).toUShort(),
+                           timeout_ms);
+    };
+}
+
+QString ReachabilityCheckerTest::banner_target() const {
+    return QString("127.0.0.1:%1").arg(m_banner_server->serverPort());
+}
+
+QString ReachabilityCheckerTest::silent_target(int i) const {
+    return QString("127.0.0.1:%1#%2").arg(m_silent_server->serverPort()).arg(i);
+}
+
+QString ReachabilityCheckerTest::closed_target() const {
+    return QString("127.0.0.1:%1").arg(m_closed_port);
+}
+
+////////////////////////////////////////////////////////
+
+void ReachabilityCheckerTest::initTestCase() {
+    m_banner_server = new QTcpServer;
+    QVERIFY(m_banner_server->listen(QHostAddress::LocalHost));
+    connect(m_banner_server, &QTcpServer::newConnection, [this]() {
+        while (m_banner_server->hasPendingConnections()) {
+            QTcpSocket* socket = m_banner_server->nextPendingConnection();
+            socket->write("SSH-2.0-test\r\n");
+            connect(socket, &QTcpSocket::disconnected, socket, &QTcpSocket::deleteLater);
+        }
+    });
+
+    // connections are completed by system and never answered
+    m_silent_server = new QTcpServer;
+    QVERIFY(m_silent_server->listen(QHostAddress::LocalHost));
+
+    QTcpServer closed;
+    QVERIFY(closed.listen(QHostAddress::LocalHost));
+    m_closed_port = closed.serverPort();
+    closed.close();
+}
+
+////////////////////////////////////////////////////////
+
+void ReachabilityCheckerTest::test_listening_port() {
+    CReachabilityChecker checker(tcp_probe(), 4);
+    int result = -1;
+    checker.check("127.0.0.1", banner_target(), nullptr,
+                  [&result](bool reachable) { result = reachable; });
+    QCOMPARE(checker.in_flight_count(), 1);
+    QTRY_COMPARE_WITH_TIMEOUT(result, 1, 5000);
+    QVERIFY(checker.is_cached(banner_target()));
+
+    // confirmed recently, no probe
+    result = -1;
+    checker.check("127.0.0.1", banner_target(), nullptr,
+                  [&result](bool reachable) { result = reachable; });
+    QCOMPARE(result, 1);
+    QCOMPARE(checker.probes_count(), (quint64)1);
+}
+
+////////////////////////////////////////////////////////
+
+void ReachabilityCheckerTest::test_closed_port() {
+    CReachabilityChecker checker(tcp_probe(), 4);
+    QElapsedTimer timer;
+    timer.start();
+    int result = -1;
+    checker.check("127.0.0.1", closed_target(), nullptr,
+                  [&result](bool reachable) { result = reachable; });
+    QTRY_COMPARE_WITH_TIMEOUT(result, 0, 5000);
+    // refused, not timed out
+    QVERIFY(timer.elapsed() < CReachabilityChecker::DEFAULT_INITIAL_TIMEOUT_MS);
+}
+
+////////////////////////////////////////////////////////
+
+void ReachabilityCheckerTest::test_blackholed_in_parallel() {
+    const int timeout = 500;
+    const int hosts = 8;
+    CReachabilityChecker checker(tcp_probe(), hosts + 2);
+    checker.set_timeout_bounds(100, timeout, 5000);
+
+    QElapsedTimer timer;
+    timer.start();
+    int failed = 0;
+    qint64 reachable_after = -1;
+    for (int i = 0; i < hosts; ++i) {
+        checker.check(QString("silent%1").arg(i), silent_target(i), nullptr,
+                      [&failed](bool reachable) { if (!reachable) ++failed; });
+    }
+    checker.check("127.0.0.1", banner_target(), nullptr,
+                  [&reachable_after, &timer](bool reachable) {
+        if (reachable) reachable_after = timer.elapsed();
+    });
+
+    QTRY_COMPARE_WITH_TIMEOUT(failed, hosts, hosts * timeout * 2);
+    // about one timeout, not hosts * timeout
+    QVERIFY(timer.elapsed() < 4 * timeout);
+    QVERIFY(timer.elapsed() >= timeout);
+    // reachable host isn't stalled by hanging ones
+    QVERIFY(reachable_after >= 0);
+    QVERIFY(reachable_after < timeout);
+}
+
+////////////////////////////////////////////////////////
+
+void ReachabilityCheckerTest::test_max_parallel() {
+    QAtomicInt running_now, running_max;
+    CReachabilityChecker checker([&running_now, &running_max](const QString&, int) {
+        int now = running_now.fetchAndAddOrdered(1) + 1;
+        int max = running_max.load();
+        while (max < now && !running_max.testAndSetOrdered(max, now))
+            max = running_max.load();
+        QThread::msleep(50);
+        running_now.fetchAndAddOrdered(-1);
+        return true;
+    }, 3);
+
+    int done = 0;
+    for (int i = 0; i < 20; ++i)
+        checker.check(QString("host%1").arg(i), QString("target%1").arg(i), nullptr,
+                      [&done](bool) { ++done; });
+    QTRY_COMPARE_WITH_TIMEOUT(done, 20, 10000);
+    QVERIFY(running_max.load() <= 3);
+    QVERIFY(running_max.load() >= 2);
+    QCOMPARE(checker.probes_count(), (quint64)20);
+    QCOMPARE(checker.in_flight_count(), 0);
+}
+
+////////////////////////////////////////////////////////
+
+void ReachabilityCheckerTest::test_same_target_shared() {
+    QAtomicInt probes;
+    CReachabilityChecker checker([&probes](const QString&, int) {
+        probes.fetchAndAddOrdered(1);
+        QThread::msleep(100);
+        return true;
+    }, 4);
+
+    int done = 0;
+    for (int i = 0; i < 3; ++i)
+        checker.check("host", "target", nullptr, [&done](bool) { ++done; });
+    QCOMPARE(checker.in_flight_count(), 1);
+    QTRY_COMPARE_WITH_TIMEOUT(done, 3, 5000);
+    QCOMPARE(probes.load(), 1);
+}
+
+////////////////////////////////////////////////////////
+
+void ReachabilityCheckerTest::test_adaptive_timeout() {
+    std::map<QString, int> timeouts;
+    QMutex mutex;
+    CReachabilityChecker checker([&timeouts, &mutex](const QString& target, int timeout_ms) {
+        QThread::msleep(20);
+        QMutexLocker locker(&mutex);
+        timeouts[target] = timeout_ms;
+        return true;
+    }, 1);
+    checker.set_timeout_bounds(50, 3000, 10000);
+    checker.set_ttl(0, 0);
+    QCOMPARE(checker.timeout_for("fast"), 3000);
+
+    for (int i = 0; i < 10; ++i) {
+        bool done = false;
+        checker.check("fast", QString("target%1").arg(i), nullptr,
+                      [&done](bool) { done = true; });
+        QTRY_VERIFY_WITH_TIMEOUT(done, 5000);
+    }
+    QCOMPARE(timeouts["target0"], 3000);
+    QVERIFY(timeouts["target9"] < 500);
+    QVERIFY(checker.timeout_for("fast") >= 50);
+    QVERIFY(checker.timeout_for("fast") < 500);
+    // statistics are per host
+    QCOMPARE(checker.timeout_for("other"), 3000);
+
+    checker.clear();
+    QCOMPARE(checker.timeout_for("fast"), 3000);
+}
+
+////////////////////////////////////////////////////////
+
+void ReachabilityCheckerTest::test_timeout_backoff() {
+    QAtomicInt hang(1);
+    std::vector<int> timeouts;
+    QMutex mutex;
+    CReachabilityChecker checker([&hang, &timeouts, &mutex](const QString&, int timeout_ms) {
+        {
+            QMutexLocker locker(&mutex);
+            timeouts.push_back(timeout_ms);
+        }
+        QThread::msleep(hang.load() ? timeout_ms : 10);
+        return !hang.load();
+    }, 1);
+    checker.set_timeout_bounds(50, 100, 500);
+    checker.set_ttl(0, 0);
+
+    for (int i = 0; i < 4; ++i) {
+        bool done = false;
+        checker.check("slow", QString("target%1").arg(i), nullptr,
+                      [&done](bool) { done = true; });
+        QTRY_VERIFY_WITH_TIMEOUT(done, 5000);
+    }
+    // doubled on each expiry up to max
+    QCOMPARE(timeouts, std::vector<int>({100, 200, 400, 500}));
+    QCOMPARE(checker.timeout_for("slow"), 500);
+
+    // success resets backoff
+    hang.store(0);
+    bool done = false;
+    checker.check("slow", "target_ok", nullptr, [&done](bool) { done = true; });
+    QTRY_VERIFY_WITH_TIMEOUT(done, 5000);
+    QVERIFY(checker.timeout_for("slow") < 500);
+}
+
+////////////////////////////////////////////////////////
+
+void ReachabilityCheckerTest::test_min_timeout() {
+    CReachabilityChecker checker([](const QString&, int) {
+        return true;
+    }, 1);
+    checker.set_ttl(0, 0);
+    bool done = false;
+    checker.check("fast", "target", nullptr, [&done](bool) { done = true; });
+    QTRY_VERIFY_WITH_TIMEOUT(done, 5000);
+    // probe is a process, its timeout isn't less than time to spawn one
+    QCOMPARE(checker.timeout_for("fast"), CReachabilityChecker::DEFAULT_MIN_TIMEOUT_MS);
+    QVERIFY(CReachabilityChecker::DEFAULT_MIN_TIMEOUT_MS >= 1000);
+}
+
+////////////////////////////////////////////////////////
+
+void ReachabilityCheckerTest::test_failed_ttl() {
+    CReachabilityChecker checker(tcp_probe(), 2);
+    checker.set_ttl(10000, 100);
+    int result = -1;
+    checker.check("127.0.0.1", closed_target(), nullptr,
+                  [&result](bool reachable) { result = reachable; });
+    QTRY_COMPARE_WITH_TIMEOUT(result, 0, 5000);
+    QVERIFY(checker.is_cached(closed_target()));
+
+    result = -1;
+    checker.check("127.0.0.1", closed_target(), nullptr,
+                  [&result](bool reachable) { result = reachable; });
+    QCOMPARE(result, 0);
+    QCOMPARE(checker.probes_count(), (quint64)1);
+
+    // failure is probed again sooner than success
+    QTest::qWait(150);
+    QVERIFY(!checker.is_cached(closed_target()));
+    result = -1;
+    checker.check("127.0.0.1", closed_target(), nullptr,
+                  [&result](bool reachable) { result = reachable; });
+    QTRY_COMPARE_WITH_TIMEOUT(result, 0, 5000);
+    QCOMPARE(checker.probes_count(), (quint64)2);
+}
+
+////////////////////////////////////////////////////////
+
+void ReachabilityCheckerTest::test_context_destroyed() {
+    CReachabilityChecker checker(tcp_probe(), 2);
+    QSignalSpy spy(&checker, &CReachabilityChecker::checked);
+    QObject* context = new QObject;
+    bool called = false;
+    checker.check("127.0.0.1", banner_target(), context,
+                  [&called](bool) { called = true; });
+    delete context;
+    QVERIFY(spy.wait(5000));
+    QVERIFY(!called);
+}
+
+////////////////////////////////////////////////////////
+
+void ReachabilityCheckerTest::cleanupTestCase() {
+    delete m_banner_server;
+    delete m_silent_server;
+}
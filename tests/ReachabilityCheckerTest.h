@@ -0,0 +1,36 @@
+#ifndef REACHABILITYCHECKERTEST_H
+#define REACHABILITYCHECKERTEST_H
+
+#include <QObject>
+#include <QString>
+
+class QTcpServer;
+
+class ReachabilityCheckerTest : public QObject
+{
+    Q_OBJECT
+private:
+    QTcpServer* m_banner_server = nullptr;   // answers like ssh server
+    QTcpServer* m_silent_server = nullptr;   // accepts connections and hangs
+    quint16 m_closed_port = 0;
+
+    QString banner_target() const;
+    QString silent_target(int i) const;
+    QString closed_target() const;
+
+private slots:
+    void initTestCase();
+    void test_listening_port();
+    void test_closed_port();
+    void test_blackholed_in_parallel();
+    void test_max_parallel();
+    void test_same_target_shared();
+    void test_adaptive_timeout();
+    void test_timeout_backoff();
+    void test_min_timeout();
+    void test_failed_ttl();
+    void test_context_destroyed();
+    void cleanupTestCase();
+};
+
+#endif // REACHABILITYCHECKERTEST_H
@@ -0,0 +1,198 @@
+#include "RestCoalescerTest.h"
+#include "RestCoalescer.h"
+#include "RestRetrier.h"
+#include "FakeHubServer.h"
+#include <QElapsedTimer>
+#include <QNetworkProxy>
+#include <QTest>
+#include <QtConcurrent/QtConcurrent>
+
+void RestCoalescerTest::initTestCase() {
+    m_server = new FakeHubServer;
+    QVERIFY(m_server->start());
+    m_nam = new QNetworkAccessManager;
+    m_nam->setProxy(QNetworkProxy::NoProxy);
+    m_pipeline = new CRestPipeline(m_nam);
+    m_coalescer = new CRestCoalescer(m_pipeline);
+}
+
+void RestCoalescerTest::init() {
+    m_server->reset_counters();
+    m_server->set_handler([](const FakeHubServer::request_t& req) -> FakeHubServer::response_t {
+        FakeHubServer::response_t resp;
+        resp.body = req.path;
+        resp.delay_ms = 300;
+        return resp;
+    });
+    m_coalescer->set_freshness_ms(0);
+}
+
+rest_response_t RestCoalescerTest::wait_get(const QString &key,
+                                            const QNetworkRequest &req) {
+    // blocking execute_get is for worker threads, this one runs pipeline
+    rest_response_t res;
+    bool finished = false;
+    m_coalescer->enqueue_get(key, req, 5000, this,
+                             [&res, &finished](const rest_response_t& resp) {
+        res = resp;
+        finished = true;
+    });
+    QElapsedTimer timer;
+    timer.start();
+    while (!finished && timer.elapsed() < 10000)
+        QTest::qWait(10);
+    return res;
+}
+
+////////////////////////////////////////////////////////
+
+void RestCoalescerTest::test_identical_requests() {
+    static const int count = 10;
+    int finished = 0, succeeded = 0;
+    for (int i = 0; i < count; ++i) {
+        QNetworkRequest req(QUrl(m_server->url("/environments")));
+        m_coalescer->enqueue_get("environments", req, 5000, this,
+                                 [&finished, &succeeded](const rest_response_t& resp) {
+            ++finished;
+            if (resp.http_code == 200 && resp.body == "/environments") ++succeeded;
+        });
+    }
+    QTRY_COMPARE_WITH_TIMEOUT(finished, count, 5000);
+    QCOMPARE(succeeded, count);
+    QCOMPARE(m_server->requests_count(), 1);
+}
+
+////////////////////////////////////////////////////////
+
+void RestCoalescerTest::test_different_keys() {
+    int finished = 0;
+    QStringList paths = QStringList() << "/environments" << "/my-peers" << "/environments"
+                                      << "/balance" << "/my-peers";
+    for (auto i = paths.begin(); i != paths.end(); ++i) {
+        QNetworkRequest req(QUrl(m_server->url(*i)));
+        QString path = *i;
+        m_coalescer->enqueue_get(path, req, 5000, this,
+                                 [&finished, path](const rest_response_t& resp) {
+            if (resp.body == path.toUtf8()) ++finished;
+        });
+    }
+    QTRY_COMPARE_WITH_TIMEOUT(finished, paths.size(), 5000);
+    QCOMPARE(m_server->requests_count(), 3);
+}
+
+////////////////////////////////////////////////////////
+
+void RestCoalescerTest::test_freshness_window() {
+    m_coalescer->set_freshness_ms(60000);
+    QNetworkRequest req(QUrl(m_server->url("/balance")));
+    for (int i = 0; i < 3; ++i) {
+        rest_response_t resp = wait_get("balance", req);
+        QCOMPARE(resp.body, QByteArray("/balance"));
+    }
+    QCOMPARE(m_server->requests_count(), 1);
+
+    m_coalescer->invalidate("balance");
+    QCOMPARE(wait_get("balance", req).body, QByteArray("/balance"));
+    QCOMPARE(m_server->requests_count(), 2);
+
+    m_coalescer->set_freshness_ms(100);
+    QTest::qWait(300);
+    QCOMPARE(wait_get("balance", req).body, QByteArray("/balance"));
+    QCOMPARE(m_server->requests_count(), 3);
+}
+
+////////////////////////////////////////////////////////
+
+void RestCoalescerTest::test_failed_response_not_reused() {
+    m_coalescer->set_freshness_ms(60000);
+    m_server->set_handler([](const FakeHubServer::request_t&) -> FakeHubServer::response_t {
+        FakeHubServer::response_t resp;
+        resp.status = 500;
+        return resp;
+    });
+    QNetworkRequest req(QUrl(m_server->url("/environments")));
+    wait_get("environments", req);
+    wait_get("environments", req);
+    QCOMPARE(m_server->requests_count(), 2);
+}
+
+////////////////////////////////////////////////////////
+
+void RestCoalescerTest::test_joined_failure_counted_once() {
+    m_server->set_handler([](const FakeHubServer::request_t&) -> FakeHubServer::response_t {
+        FakeHubServer::response_t resp;
+        resp.status = 503;
+        resp.delay_ms = 300;
+        return resp;
+    });
+    CRestRetrier retrier(m_pipeline, CRestRetryPolicy(1, 50, 200));
+    retrier.set_breaker_params(3, 60000, 60000);
+    QNetworkRequest req(QUrl(m_server->url("/environments")));
+    QString endpoint = CRestRetrier::endpoint_of(req.url());
+    CRestPipeline* pipeline = m_pipeline;
+
+    static const int count = 5;
+    int finished = 0;
+    for (int i = 0; i < count; ++i) {
+        m_coalescer->enqueue("environments", this,
+                             [&retrier, pipeline, req, endpoint](rest_callback_t callback) {
+            retrier.enqueue(endpoint, nullptr, [pipeline, req](rest_callback_t attempt_callback) {
+                return pipeline->enqueue(req, RO_GET, QByteArray(), 5000, nullptr, attempt_callback);
+            }, callback);
+            return CRestPipeline::request_id_t(0);
+        }, [&finished](const rest_response_t& resp) {
+            if (resp.http_code == 503) ++finished;
+        });
+    }
+    QTRY_COMPARE_WITH_TIMEOUT(finished, count, 5000);
+    // one upstream request is one failure, breaker with threshold 3 stays closed
+    QCOMPARE(m_server->requests_count(), 1);
+    QCOMPARE(retrier.breaker_state(endpoint), CRestCircuitBreaker::CB_CLOSED);
+}
+
+////////////////////////////////////////////////////////
+
+void RestCoalescerTest::test_destroyed_context() {
+    int finished = 0;
+    QObject* context = new QObject;
+    QNetworkRequest req(QUrl(m_server->url("/my-peers")));
+    m_coalescer->enqueue_get("my-peers", req, 5000, context,
+                             [&finished](const rest_response_t&) { finished += 100; });
+    m_coalescer->enqueue_get("my-peers", req, 5000, this,
+                             [&finished](const rest_response_t&) { ++finished; });
+    delete context;
+    QTRY_COMPARE_WITH_TIMEOUT(finished, 1, 5000);
+    QTest::qWait(100);
+    QCOMPARE(finished, 1);
+    QCOMPARE(m_server->requests_count(), 1);
+}
+
+////////////////////////////////////////////////////////
+
+void RestCoalescerTest::test_execute_from_worker_threads() {
+    static const int count = 8;
+    // pool may have less threads than count, late ones take fresh response
+    m_coalescer->set_freshness_ms(60000);
+    QNetworkRequest req(QUrl(m_server->url("/gorjun")));
+    CRestCoalescer* coalescer = m_coalescer;
+    QList<QFuture<rest_response_t> > results;
+    for (int i = 0; i < count; ++i) {
+        results.push_back(QtConcurrent::run([coalescer, req]() {
+            return coalescer->execute_get("gorjun", req, 5000);
+        }));
+    }
+    for (auto i = results.begin(); i != results.end(); ++i) {
+        QTRY_VERIFY_WITH_TIMEOUT(i->isFinished(), 10000);
+        QCOMPARE(i->result().body, QByteArray("/gorjun"));
+    }
+    QCOMPARE(m_server->requests_count(), 1);
+}
+
+////////////////////////////////////////////////////////
+
+void RestCoalescerTest::cleanupTestCase() {
+    delete m_pipeline;
+    delete m_coalescer;
+    delete m_nam;
+    delete m_server;
+}
@@ -0,0 +1,37 @@
+#ifndef RESTCOALESCERTEST_H
+#define RESTCOALESCERTEST_H
+
+#include <QObject>
+#include "RestPipeline.h"
+
+class FakeHubServer;
+class QNetworkAccessManager;
+class CRestPipeline;
+class CRestCoalescer;
+
+class RestCoalescerTest : public QObject
+{
+    Q_OBJECT
+private:
+    FakeHubServer* m_server;
+    QNetworkAccessManager* m_nam;
+    CRestPipeline* m_pipeline;
+    CRestCoalescer* m_coalescer;
+
+    rest_response_t wait_get(const QString& key,
+                             const QNetworkRequest& req);
+
+private slots:
+    void initTestCase();
+    void init();
+    void test_identical_requests();
+    void test_different_keys();
+    void test_freshness_window();
+    void test_failed_response_not_reused();
+    void test_joined_failure_counted_once();
+    void test_destroyed_context();
+    void test_execute_from_worker_threads();
+    void cleanupTestCase();
+};
+
+#endif // RESTCOALESCERTEST_H
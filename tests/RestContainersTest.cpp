@@ -0,0 +1,182 @@
+#include "RestContainersTest.h"
+#include "RestContainers.h"
+#include <QTest>
+
+static QJsonObject container_json(int env, int cont, const QString& ip_suffix = "") {
+    QJsonObject obj;
+    obj["container_name"] = QString("cont_%1_%2").arg(env).arg(cont);
+    obj["container_ip"] = QString("172.16.%1.%2%3").arg(env % 250).arg(cont % 250).arg(ip_suffix);
+    obj["container_id"] = QString("cont_id_%1_%2").arg(env).arg(cont);
+    obj["rh_ip"] = QString("10.0.0.%1").arg(cont % 250);
+    return obj;
+}
+
+static CEnvironment environment(int env, int containers,
+                                const QString& status = "HEALTHY",
+                                bool reversed = false) {
+    QJsonObject obj;
+    obj["environment_name"] = QString("env_%1").arg(env);
+    obj["environment_id"] = QString("env_id_%1").arg(env);
+    obj["environment_status"] = status;
+    QJsonArray arr;
+    for (int i = 0; i < containers; ++i)
+        arr.push_back(container_json(env, reversed ? containers - i - 1 : i));
+    obj["environment_containers"] = arr;
+    return CEnvironment(obj);
+}
+
+static std::vector<CEnvironment> environments(int count, int containers) {
+    std::vector<CEnvironment> res;
+    for (int i = 0; i < count; ++i)
+        res.push_back(environment(i, containers));
+    return res;
+}
+
+// comparison used before KeyedDiff, kept as reference for benchmark
+template<class T>
+static bool quadratic_eq(const std::vector<T>& arg1, const std::vector<T>& arg2) {
+    if (arg1.size() != arg2.size()) return false;
+    for (size_t i = 0; i < arg1.size(); ++i) {
+        bool found = false;
+        for (size_t j = 0; j < arg2.size(); ++j) {
+            if (arg1[i] != arg2[j]) continue;
+            found = true;
+            break;
+        }
+        if (!found) return false;
+    }
+    return true;
+}
+
+////////////////////////////////////////////////////////
+
+void RestContainersTest::test_keyed_diff() {
+    std::vector<CEnvironment> old_lst = environments(5, 3);
+    std::vector<CEnvironment> new_lst = old_lst;
+
+    QVERIFY(KeyedDiff<CEnvironment>(old_lst, new_lst).empty());
+
+    new_lst.erase(new_lst.begin() + 1);            // env_1 removed
+    new_lst[2] = environment(3, 3, "UNHEALTHY");   // env_3 changed
+    new_lst.push_back(environment(7, 2));          // env_7 added
+
+    keyed_diff_t diff = KeyedDiff<CEnvironment>(old_lst, new_lst);
+    QCOMPARE(diff.removed.size(), (size_t)1);
+    QCOMPARE(old_lst[diff.removed[0]].id(), QString("env_id_1"));
+    QCOMPARE(diff.added.size(), (size_t)1);
+    QCOMPARE(new_lst[diff.added[0]].id(), QString("env_id_7"));
+    QCOMPARE(diff.changed.size(), (size_t)1);
+    QCOMPARE(old_lst[diff.changed[0].first].id(), QString("env_id_3"));
+    QCOMPARE(new_lst[diff.changed[0].second].status(), QString("UNHEALTHY"));
+}
+
+////////////////////////////////////////////////////////
+
+void RestContainersTest::test_keyed_diff_order() {
+    std::vector<CEnvironment> old_lst = environments(10, 2);
+    std::vector<CEnvironment> new_lst(old_lst.rbegin(), old_lst.rend());
+    QVERIFY(KeyedDiff<CEnvironment>(old_lst, new_lst).empty());
+    QVERIFY(KeyedEq<CEnvironment>(old_lst, new_lst));
+}
+
+////////////////////////////////////////////////////////
+
+void RestContainersTest::test_keyed_diff_duplicates() {
+    QJsonObject obj = container_json(1, 1);
+    obj["container_id"] = "";
+    std::vector<CHubContainer> old_lst(3, CHubContainer(obj));
+    std::vector<CHubContainer> new_lst(2, CHubContainer(obj));
+
+    QVERIFY(KeyedDiff<CHubContainer>(old_lst, old_lst).empty());
+    keyed_diff_t diff = KeyedDiff<CHubContainer>(old_lst, new_lst);
+    QCOMPARE(diff.removed.size(), (size_t)1);
+    QVERIFY(diff.added.empty());
+    QVERIFY(diff.changed.empty());
+
+    diff = KeyedDiff<CHubContainer>(new_lst, old_lst);
+    QCOMPARE(diff.added.size(), (size_t)1);
+    QVERIFY(diff.removed.empty());
+}
+
+////////////////////////////////////////////////////////
+
+void RestContainersTest::test_environment_eq() {
+    QVERIFY(environment(1, 20) == environment(1, 20, "HEALTHY", true));
+    QVERIFY(environment(1, 20) != environment(1, 19));
+    QVERIFY(environment(1, 20) != environment(1, 20, "UNDER_MODIFICATION"));
+}
+
+////////////////////////////////////////////////////////
+
+void RestContainersTest::test_containers_diff() {
+    CEnvironment prev = environment(1, 4);
+    QJsonObject obj;
+    obj["environment_id"] = prev.id();
+    obj["environment_name"] = prev.name();
+    QJsonArray arr;
+    arr.push_back(container_json(1, 0));
+    arr.push_back(container_json(1, 1, "/24"));  // changed ip
+    arr.push_back(container_json(1, 3));
+    arr.push_back(container_json(1, 9));         // added, cont_1_2 removed
+    obj["environment_containers"] = arr;
+    CEnvironment env(obj);
+
+    keyed_diff_t diff = env.containers_diff(prev);
+    QCOMPARE(diff.added.size(), (size_t)1);
+    QCOMPARE(env.containers()[diff.added[0]].id(), QString("cont_id_1_9"));
+    QCOMPARE(diff.removed.size(), (size_t)1);
+    QCOMPARE(prev.containers()[diff.removed[0]].id(), QString("cont_id_1_2"));
+    QCOMPARE(diff.changed.size(), (size_t)1);
+    QCOMPARE(env.containers()[diff.changed[0].second].id(), QString("cont_id_1_1"));
+}
+
+////////////////////////////////////////////////////////
+
+void RestContainersTest::benchmark_keyed_diff_data() {
+    QTest::addColumn<int>("envs");
+    QTest::addColumn<int>("containers");
+    QTest::newRow("100 envs x 10 containers") << 100 << 10;
+    QTest::newRow("500 envs x 10 containers") << 500 << 10;
+    QTest::newRow("50 envs x 200 containers") << 50 << 200;
+}
+
+void RestContainersTest::benchmark_keyed_diff() {
+    QFETCH(int, envs);
+    QFETCH(int, containers);
+    std::vector<CEnvironment> old_lst = environments(envs, containers);
+    std::vector<CEnvironment> new_lst(old_lst.rbegin(), old_lst.rend());
+    new_lst[0] = environment(envs - 1, containers, "UNHEALTHY");
+    QBENCHMARK {
+        keyed_diff_t diff = KeyedDiff<CEnvironment>(old_lst, new_lst);
+        QCOMPARE(diff.changed.size(), (size_t)1);
+    }
+}
+
+////////////////////////////////////////////////////////
+
+void RestContainersTest::benchmark_quadratic_eq_data() {
+    benchmark_keyed_diff_data();
+}
+
+void RestContainersTest::benchmark_quadratic_eq() {
+    QFETCH(int, envs);
+    QFETCH(int, containers);
+    std::vector<CEnvironment> old_lst = environments(envs, containers);
+    std::vector<CEnvironment> new_lst(old_lst.rbegin(), old_lst.rend());
+    new_lst[0] = environment(envs - 1, containers, "UNHEALTHY");
+    // every pair of environments is compared with quadratic containers comparison
+    auto env_eq = [](const CEnvironment& a, const CEnvironment& b) {
+        return a.id() == b.id() && a.status() == b.status() &&
+               quadratic_eq<CHubContainer>(a.containers(), b.containers());
+    };
+    QBENCHMARK {
+        bool eq = old_lst.size() == new_lst.size();
+        for (size_t i = 0; eq && i < old_lst.size(); ++i) {
+            bool found = false;
+            for (size_t j = 0; !found && j < new_lst.size(); ++j)
+                found = env_eq(old_lst[i], new_lst[j]);
+            eq = found;
+        }
+        QVERIFY(!eq);
+    }
+}
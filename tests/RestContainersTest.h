@@ -0,0 +1,21 @@
+#ifndef RESTCONTAINERSTEST_H
+#define RESTCONTAINERSTEST_H
+
+#include <QObject>
+
+class RestContainersTest : public QObject
+{
+    Q_OBJECT
+private slots:
+    void test_keyed_diff();
+    void test_keyed_diff_order();
+    void test_keyed_diff_duplicates();
+    void test_environment_eq();
+    void test_containers_diff();
+    void benchmark_keyed_diff_data();
+    void benchmark_keyed_diff();
+    void benchmark_quadratic_eq_data();
+    void benchmark_quadratic_eq();
+};
+
+#endif // RESTCONTAINERSTEST_H
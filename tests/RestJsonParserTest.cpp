@@ -0,0 +1,271 @@
+#include "RestJsonParserTest.h"
+#include "RestJsonParser.h"
+#include "RestContainers.h"
+#include "FakeHubServer.h"
+#include <QNetworkProxy>
+#include <QTest>
+
+static const int CHUNK_SIZE = 16 * 1024;
+
+static QByteArray environments_json(int envs, int containers) {
+    QJsonArray arr;
+    for (int e = 0; e < envs; ++e) {
+        QJsonObject env;
+        env["environment_name"] = QString("env_%1").arg(e);
+        env["environment_id"] = QString("env_id_%1").arg(e);
+        env["environment_status"] = QString("HEALTHY");
+        env["environment_key"] = QString("key_%1").arg(e);
+        QJsonArray conts;
+        for (int c = 0; c < containers; ++c) {
+            QJsonObject obj;
+            obj["container_name"] = QString("cont_%1_%2").arg(e).arg(c);
+            obj["container_ip"] = QString("172.16.%1.%2").arg(e % 250).arg(c % 250);
+            obj["container_id"] = QString("cont_id_%1_%2").arg(e).arg(c);
+            obj["rh_ip"] = QString("10.0.0.%1").arg(c % 250);
+            conts.push_back(obj);
+        }
+        env["environment_containers"] = conts;
+        arr.push_back(env);
+    }
+    return QJsonDocument(arr).toJson(QJsonDocument::Compact);
+}
+
+static void feed_by_chunks(IRestBodyParser& parser, const QByteArray& body,
+                           int chunk_size) {
+    for (int i = 0; i < body.size(); i += chunk_size)
+        parser.feed(body.mid(i, chunk_size));
+    parser.finish();
+}
+
+static std::vector<CJsonStreamReader::token_t> all_tokens(CJsonStreamReader& reader) {
+    std::vector<CJsonStreamReader::token_t> res;
+    for (auto t = reader.next(); t != CJsonStreamReader::JT_NEED_MORE; t = reader.next()) {
+        res.push_back(t);
+        if (t == CJsonStreamReader::JT_END || t == CJsonStreamReader::JT_ERROR) break;
+    }
+    return res;
+}
+
+////////////////////////////////////////////////////////
+
+void RestJsonParserTest::test_tokens() {
+    CJsonStreamReader reader;
+    reader.add_data("{\"a\": [1, -2.5e1, true, false, null], \"b\": {}}");
+    reader.finish();
+
+    std::vector<CJsonStreamReader::token_t> expected = {
+        CJsonStreamReader::JT_BEGIN_OBJECT,
+        CJsonStreamReader::JT_KEY,
+        CJsonStreamReader::JT_BEGIN_ARRAY,
+        CJsonStreamReader::JT_NUMBER,
+        CJsonStreamReader::JT_NUMBER,
+        CJsonStreamReader::JT_BOOL,
+        CJsonStreamReader::JT_BOOL,
+        CJsonStreamReader::JT_NULL,
+        CJsonStreamReader::JT_END_ARRAY,
+        CJsonStreamReader::JT_KEY,
+        CJsonStreamReader::JT_BEGIN_OBJECT,
+        CJsonStreamReader::JT_END_OBJECT,
+        CJsonStreamReader::JT_END_OBJECT,
+        CJsonStreamReader::JT_END
+    };
+    QVERIFY(all_tokens(reader) == expected);
+
+    CJsonStreamReader num_reader;
+    num_reader.add_data("[-2.5e");
+    QCOMPARE(num_reader.next(), CJsonStreamReader::JT_BEGIN_ARRAY);
+    // number may continue in next chunk
+    QCOMPARE(num_reader.next(), CJsonStreamReader::JT_NEED_MORE);
+    num_reader.add_data("2]");
+    num_reader.finish();
+    QCOMPARE(num_reader.next(), CJsonStreamReader::JT_NUMBER);
+    QCOMPARE(num_reader.number_value(), -250.0);
+    QCOMPARE(num_reader.next(), CJsonStreamReader::JT_END_ARRAY);
+    QCOMPARE(num_reader.next(), CJsonStreamReader::JT_END);
+}
+
+////////////////////////////////////////////////////////
+
+void RestJsonParserTest::test_escapes() {
+    CJsonStreamReader reader;
+    reader.add_data(QByteArray("[\"q\\\"b\\\\s\\/n\\nt\\tu\\u00e9\\ud83d\\ude00 ") +
+                    QString::fromUtf8("\xd0\xbf\xd1\x80\xd0\xb8").toUtf8() + "\"]");
+    reader.finish();
+    QCOMPARE(reader.next(), CJsonStreamReader::JT_BEGIN_ARRAY);
+    QCOMPARE(reader.next(), CJsonStreamReader::JT_STRING);
+    QString expected = QString("q\"b\\s/n\nt\tu") + QChar(0xe9) +
+                       QChar(0xd83d) + QChar(0xde00) + " " +
+                       QString::fromUtf8("\xd0\xbf\xd1\x80\xd0\xb8");
+    QCOMPARE(reader.string_value(), expected);
+}
+
+////////////////////////////////////////////////////////
+
+void RestJsonParserTest::test_chunk_boundaries() {
+    QByteArray body = "[{\"id\": \"a\\u0041\\n\", \"n\": 12.5e-1, \"ok\": true,"
+                      " \"nested\": {\"l\": [1, [2, {\"x\": null}]], \"s\": \"\xd0\xbf\"}},"
+                      " 5, null, {\"id\": \"b\", \"e\": {}, \"a\": []}]";
+    QJsonArray dom = QJsonDocument::fromJson(body).array();
+    QVERIFY(!dom.isEmpty());
+
+    // every split position, including splits inside utf-8 sequences and escapes
+    for (int split = 0; split <= body.size(); ++split) {
+        CJsonItemsParser<QJsonObject> parser;
+        parser.feed(body.left(split));
+        parser.feed(body.mid(split));
+        parser.finish();
+        QVERIFY2(!parser.failed(), parser.error_string().toUtf8().constData());
+        QCOMPARE(parser.items().size(), (size_t)2);
+        QCOMPARE(parser.items()[0], dom[0].toObject());
+        QCOMPARE(parser.items()[1], dom[3].toObject());
+    }
+
+    // byte by byte
+    CJsonItemsParser<QJsonObject> parser;
+    feed_by_chunks(parser, body, 1);
+    QVERIFY(!parser.failed());
+    QCOMPARE(parser.items().size(), (size_t)2);
+}
+
+////////////////////////////////////////////////////////
+
+void RestJsonParserTest::test_errors_data() {
+    QTest::addColumn<QByteArray>("body");
+    QTest::newRow("empty") << QByteArray();
+    QTest::newRow("truncated") << QByteArray("[{\"id\": \"a\"}, {\"id\":");
+    QTest::newRow("unterminated string") << QByteArray("[\"abc");
+    QTest::newRow("html") << QByteArray("<html><body>login</body></html>");
+    QTest::newRow("bad literal") << QByteArray("[tru]");
+    QTest::newRow("bad number") << QByteArray("[1.2.3]");
+    QTest::newRow("missing colon") << QByteArray("{\"a\" 1}");
+    QTest::newRow("missing comma") << QByteArray("[1 2]");
+    QTest::newRow("trailing comma") << QByteArray("[1,]");
+    QTest::newRow("wrong bracket") << QByteArray("[{\"a\": 1]]");
+    QTest::newRow("garbage after document") << QByteArray("[] []");
+    QTest::newRow("bad escape") << QByteArray("[\"\\x\"]");
+    QTest::newRow("control character") << QByteArray("[\"a\nb\"]");
+}
+
+void RestJsonParserTest::test_errors() {
+    QFETCH(QByteArray, body);
+    QJsonParseError error;
+    QJsonDocument::fromJson(body, &error);
+    QVERIFY(error.error != QJsonParseError::NoError);
+
+    CJsonItemsParser<QJsonObject> parser;
+    feed_by_chunks(parser, body, 3);
+    QVERIFY(parser.failed());
+    QVERIFY(!parser.error_string().isEmpty());
+}
+
+////////////////////////////////////////////////////////
+
+void RestJsonParserTest::test_array_key() {
+    QByteArray body = "{\"code\": 0, \"other\": [{\"id\": \"x\"}],"
+                      " \"instances\": [{\"id\": \"p1\"}, {\"id\": \"p2\"}], \"msg\": \"ok\"}";
+    CJsonItemsParser<QJsonObject> parser("instances");
+    feed_by_chunks(parser, body, 7);
+    QVERIFY(!parser.failed());
+    QCOMPARE(parser.items().size(), (size_t)2);
+    QCOMPARE(parser.items()[1]["id"].toString(), QString("p2"));
+    QCOMPARE(parser.root()["code"].toInt(-1), 0);
+    QCOMPARE(parser.root()["msg"].toString(), QString("ok"));
+
+    // document which isn't array has no items, like QJsonDocument::array()
+    CJsonItemsParser<QJsonObject> arr_parser;
+    feed_by_chunks(arr_parser, body, 7);
+    QVERIFY(!arr_parser.failed());
+    QVERIFY(arr_parser.items().empty());
+}
+
+////////////////////////////////////////////////////////
+
+void RestJsonParserTest::test_skipped_elements() {
+    QByteArray body = "[1, \"s\", null, [{\"id\": \"inner\"}], {\"id\": \"e\"}, true]";
+    CJsonItemsParser<QJsonObject> parser;
+    feed_by_chunks(parser, body, 4);
+    QVERIFY(!parser.failed());
+    QCOMPARE(parser.items().size(), (size_t)1);
+    QCOMPARE(parser.items()[0]["id"].toString(), QString("e"));
+}
+
+////////////////////////////////////////////////////////
+
+void RestJsonParserTest::test_pipeline_parser() {
+    FakeHubServer server;
+    QVERIFY(server.start());
+    QByteArray body = environments_json(300, 20);
+    server.set_handler([&body](const FakeHubServer::request_t&) -> FakeHubServer::response_t {
+        FakeHubServer::response_t resp;
+        resp.body = body;
+        return resp;
+    });
+    QNetworkAccessManager nam;
+    nam.setProxy(QNetworkProxy::NoProxy);
+    CRestPipeline pipeline(&nam);
+
+    auto parser = std::make_shared<CJsonItemsParser<CEnvironment> >();
+    bool finished = false;
+    rest_response_t res;
+    pipeline.enqueue(QNetworkRequest(QUrl(server.url("/environments"))), RO_GET,
+                     QByteArray(), 10000, this,
+                     [&finished, &res](const rest_response_t& resp) {
+        finished = true;
+        res = resp;
+    }, parser);
+    QTRY_VERIFY_WITH_TIMEOUT(finished, 10000);
+
+    QCOMPARE(res.http_code, 200);
+    QVERIFY(res.parser == parser);
+    QCOMPARE(res.body, body); // body is kept for response cache
+    QVERIFY(!parser->failed());
+    QCOMPARE(parser->items().size(), (size_t)300);
+    QCOMPARE(parser->items()[299].id(), QString("env_id_299"));
+    QCOMPARE(parser->items()[0].containers().size(), (size_t)20);
+}
+
+////////////////////////////////////////////////////////
+
+void RestJsonParserTest::benchmark_stream_parse_data() {
+    QTest::addColumn<int>("envs");
+    QTest::addColumn<int>("containers");
+    QTest::newRow("1000 envs x 20 containers") << 1000 << 20;
+    QTest::newRow("100 envs x 300 containers") << 100 << 300;
+}
+
+void RestJsonParserTest::benchmark_stream_parse() {
+    QFETCH(int, envs);
+    QFETCH(int, containers);
+    QByteArray body = environments_json(envs, containers);
+    qDebug() << "Document size:" << body.size();
+    QBENCHMARK {
+        CJsonItemsParser<CEnvironment> parser;
+        feed_by_chunks(parser, body, CHUNK_SIZE);
+        QCOMPARE(parser.items().size(), (size_t)envs);
+    }
+}
+
+////////////////////////////////////////////////////////
+
+void RestJsonParserTest::benchmark_dom_parse_data() {
+    benchmark_stream_parse_data();
+}
+
+void RestJsonParserTest::benchmark_dom_parse() {
+    QFETCH(int, envs);
+    QFETCH(int, containers);
+    QByteArray body = environments_json(envs, containers);
+    // the way responses were parsed before: whole body, then whole document
+    QBENCHMARK {
+        QByteArray received;
+        for (int i = 0; i < body.size(); i += CHUNK_SIZE)
+            received.append(body.mid(i, CHUNK_SIZE));
+        QJsonArray arr = QJsonDocument::fromJson(received).array();
+        std::vector<CEnvironment> lst;
+        for (auto i = arr.begin(); i != arr.end(); ++i) {
+            if (i->isNull() || !i->isObject()) continue;
+            lst.push_back(CEnvironment(i->toObject()));
+        }
+        QCOMPARE(lst.size(), (size_t)envs);
+    }
+}
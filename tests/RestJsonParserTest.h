@@ -0,0 +1,24 @@
+#ifndef RESTJSONPARSERTEST_H
+#define RESTJSONPARSERTEST_H
+
+#include <QObject>
+
+class RestJsonParserTest : public QObject
+{
+    Q_OBJECT
+private slots:
+    void test_tokens();
+    void test_escapes();
+    void test_chunk_boundaries();
+    void test_errors_data();
+    void test_errors();
+    void test_array_key();
+    void test_skipped_elements();
+    void test_pipeline_parser();
+    void benchmark_stream_parse_data();
+    void benchmark_stream_parse();
+    void benchmark_dom_parse_data();
+    void benchmark_dom_parse();
+};
+
+#endif // RESTJSONPARSERTEST_H
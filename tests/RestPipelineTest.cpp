@@ -0,0 +1,143 @@
+#include "RestPipelineTest.h"
+#include "RestPipeline.h"
+#include "FakeHubServer.h"
+#include <QElapsedTimer>
+#include <QNetworkProxy>
+#include <QTest>
+#include <QtConcurrent/QtConcurrent>
+
+void RestPipelineTest::initTestCase() {
+    m_server = new FakeHubServer;
+    QVERIFY(m_server->start());
+    m_nam = new QNetworkAccessManager;
+    m_nam->setProxy(QNetworkProxy::NoProxy);
+    m_pipeline = new CRestPipeline(m_nam);
+}
+
+void RestPipelineTest::init() {
+    m_server->reset_counters();
+    m_server->set_handler([](const FakeHubServer::request_t&) -> FakeHubServer::response_t {
+        FakeHubServer::response_t resp;
+        resp.body = "\"OK\"";
+        resp.delay_ms = 300;
+        return resp;
+    });
+    m_pipeline->set_max_in_flight(CRestPipeline::DEFAULT_MAX_IN_FLIGHT);
+}
+
+////////////////////////////////////////////////////////
+
+void RestPipelineTest::test_parallel_requests() {
+    static const int count = 12;
+    int finished = 0, succeeded = 0;
+    QElapsedTimer et;
+    et.start();
+    for (int i = 0; i < count; ++i) {
+        QNetworkRequest req(QUrl(m_server->url(QString("/environments/%1").arg(i))));
+        m_pipeline->enqueue(req, RO_GET, QByteArray(), 5000, this,
+                            [&finished, &succeeded](const rest_response_t& resp) {
+            ++finished;
+            if (resp.http_code == 200 && resp.body == "\"OK\"") ++succeeded;
+        });
+    }
+    QTRY_COMPARE_WITH_TIMEOUT(finished, count, 10000);
+    QCOMPARE(succeeded, count);
+    QVERIFY(m_server->max_concurrent() > 1);
+    // serial execution would take count * 300 ms
+    QVERIFY(et.elapsed() < count * 300);
+}
+
+////////////////////////////////////////////////////////
+
+void RestPipelineTest::test_max_in_flight() {
+    static const int count = 6;
+    int finished = 0;
+    m_pipeline->set_max_in_flight(2);
+    for (int i = 0; i < count; ++i) {
+        QNetworkRequest req(QUrl(m_server->url(QString("/peers/%1").arg(i))));
+        m_pipeline->enqueue(req, RO_GET, QByteArray(), 10000, this,
+                            [&finished](const rest_response_t&) { ++finished; });
+        QVERIFY(m_pipeline->in_flight_count() <= 2);
+    }
+    QTRY_COMPARE_WITH_TIMEOUT(finished, count, 10000);
+    QVERIFY(m_server->max_concurrent() <= 2);
+    QCOMPARE(m_server->requests_count(), count);
+}
+
+////////////////////////////////////////////////////////
+
+void RestPipelineTest::test_deadline() {
+    m_server->set_handler([](const FakeHubServer::request_t&) -> FakeHubServer::response_t {
+        FakeHubServer::response_t resp;
+        resp.drop = true;
+        return resp;
+    });
+    bool finished = false;
+    rest_response_t res;
+    QElapsedTimer et;
+    et.start();
+    QNetworkRequest req(QUrl(m_server->url("/balance")));
+    m_pipeline->enqueue(req, RO_GET, QByteArray(), 300, this,
+                        [&finished, &res](const rest_response_t& resp) {
+        res = resp;
+        finished = true;
+    });
+    QTRY_VERIFY_WITH_TIMEOUT(finished, 5000);
+    QVERIFY(res.timed_out);
+    QVERIFY(et.elapsed() < 3000);
+}
+
+////////////////////////////////////////////////////////
+
+void RestPipelineTest::test_cancel() {
+    bool finished = false;
+    rest_response_t res;
+    QNetworkRequest req(QUrl(m_server->url("/balance")));
+    CRestPipeline::request_id_t id =
+        m_pipeline->enqueue(req, RO_GET, QByteArray(), 5000, this,
+                            [&finished, &res](const rest_response_t& resp) {
+        res = resp;
+        finished = true;
+    });
+    m_pipeline->cancel(id);
+    QTRY_VERIFY_WITH_TIMEOUT(finished, 5000);
+    QVERIFY(res.cancelled);
+    QVERIFY(!res.timed_out);
+}
+
+////////////////////////////////////////////////////////
+
+void RestPipelineTest::test_execute_from_worker_thread() {
+    QNetworkRequest req(QUrl(m_server->url("/user-info")));
+    CRestPipeline* pipeline = m_pipeline;
+    QFuture<rest_response_t> res = QtConcurrent::run([pipeline, req]() {
+        return pipeline->execute(req, RO_GET, QByteArray(), 5000);
+    });
+    // worker thread is parked, main loop keeps working
+    QTRY_VERIFY_WITH_TIMEOUT(res.isFinished(), 10000);
+    QCOMPARE(res.result().http_code, 200);
+    QCOMPARE(res.result().body, QByteArray("\"OK\""));
+}
+
+////////////////////////////////////////////////////////
+
+void RestPipelineTest::test_execute_in_own_thread() {
+    // no nested event loop: request isn't sent and call returns at once
+    QNetworkRequest req(QUrl(m_server->url("/user-info")));
+    QElapsedTimer timer;
+    timer.start();
+    rest_response_t res = m_pipeline->execute(req, RO_GET, QByteArray(), 5000);
+    QVERIFY(timer.elapsed() < 1000);
+    QVERIFY(res.cancelled);
+    QCOMPARE(res.http_code, -1);
+    QTest::qWait(100);
+    QCOMPARE(m_server->requests_count(), 0);
+}
+
+////////////////////////////////////////////////////////
+
+void RestPipelineTest::cleanupTestCase() {
+    delete m_pipeline;
+    delete m_nam;
+    delete m_server;
+}
@@ -0,0 +1,30 @@
+#ifndef RESTPIPELINETEST_H
+#define RESTPIPELINETEST_H
+
+#include <QObject>
+
+class FakeHubServer;
+class QNetworkAccessManager;
+class CRestPipeline;
+
+class RestPipelineTest : public QObject
+{
+    Q_OBJECT
+private:
+    FakeHubServer* m_server;
+    QNetworkAccessManager* m_nam;
+    CRestPipeline* m_pipeline;
+
+private slots:
+    void initTestCase();
+    void init();
+    void test_parallel_requests();
+    void test_max_in_flight();
+    void test_deadline();
+    void test_cancel();
+    void test_execute_from_worker_thread();
+    void test_execute_in_own_thread();
+    void cleanupTestCase();
+};
+
+#endif // RESTPIPELINETEST_H
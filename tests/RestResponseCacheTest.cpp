@@ -0,0 +1,293 @@
+#include "RestResponseCacheTest.h"
+#include "RestResponseCache.h"
+#include "FakeHubServer.h"
+#include <QDir>
+#include <QElapsedTimer>
+#include <QNetworkProxy>
+#include <QTest>
+
+void RestResponseCacheTest::initTestCase() {
+    m_server = new FakeHubServer;
+    QVERIFY(m_server->start());
+    m_nam = new QNetworkAccessManager;
+    m_nam->setProxy(QNetworkProxy::NoProxy);
+    m_pipeline = new CRestPipeline(m_nam);
+    m_dir = new QTemporaryDir;
+    QVERIFY(m_dir->isValid());
+}
+
+void RestResponseCacheTest::init() {
+    m_server->reset_counters();
+    m_body = QByteArray("[") + QByteArray(64 * 1024, 'e') + "]";
+    m_etag = "\"v1\"";
+    // server honours If-None-Match the same way as hub does
+    m_server->set_handler([this](const FakeHubServer::request_t& req) -> FakeHubServer::response_t {
+        FakeHubServer::response_t resp;
+        resp.headers.push_back(qMakePair(QByteArray("ETag"), m_etag));
+        auto inm = req.headers.find("if-none-match");
+        if (inm != req.headers.end() && inm->second == m_etag) {
+            resp.status = 304;
+            return resp;
+        }
+        resp.body = m_body;
+        return resp;
+    });
+}
+
+rest_response_t RestResponseCacheTest::cached_get(CRestResponseCache &cache,
+                                                  const QString &path,
+                                                  const QString &scope,
+                                                  bool *unchanged,
+                                                  rest_body_parser_t parser) {
+    QUrl url(m_server->url(path));
+    QNetworkRequest req(url);
+    QString key = CRestResponseCache::make_key(url, scope);
+    CRestResponseCache::snapshot_t snapshot = cache.prepare_request(key, req);
+    // blocking execute() is for worker threads, this one runs pipeline
+    rest_response_t resp;
+    bool finished = false;
+    m_pipeline->enqueue(req, RO_GET, QByteArray(), 5000, this,
+                        [&resp, &finished](const rest_response_t& r) {
+        resp = r;
+        finished = true;
+    }, parser);
+    QElapsedTimer timer;
+    timer.start();
+    while (!finished && timer.elapsed() < 10000)
+        QTest::qWait(10);
+    bool res = cache.resolve_response(key, snapshot, resp);
+    if (resp.http_code == 200) cache.mark_delivered(key);
+    if (unchanged) *unchanged = res;
+    return resp;
+}
+
+////////////////////////////////////////////////////////
+
+void RestResponseCacheTest::test_etag_revalidation() {
+    CRestResponseCache cache((QString()));
+    bool unchanged = true;
+    rest_response_t resp = cached_get(cache, "/environments", "user", &unchanged);
+    QCOMPARE(resp.http_code, 200);
+    QCOMPARE(resp.body, m_body);
+    QVERIFY(!resp.not_modified);
+    QVERIFY(!unchanged);
+
+    for (int i = 0; i < 5; ++i) {
+        resp = cached_get(cache, "/environments", "user", &unchanged);
+        QCOMPARE(resp.http_code, 200);
+        QCOMPARE(resp.body, m_body);
+        QVERIFY(resp.not_modified);
+        QVERIFY(unchanged);
+    }
+
+    QCOMPARE(m_server->requests_count(), 6);
+    // body is transferred only once, the rest are 304 without body
+    QCOMPARE(m_server->bytes_served(), (qint64)m_body.size());
+
+    cache.reset_delivered();
+    resp = cached_get(cache, "/environments", "user", &unchanged);
+    QCOMPARE(resp.body, m_body);
+    QVERIFY(resp.not_modified);
+    QVERIFY(!unchanged);
+}
+
+////////////////////////////////////////////////////////
+
+void RestResponseCacheTest::test_last_modified_revalidation() {
+    static const QByteArray last_modified("Wed, 21 Oct 2015 07:28:00 GMT");
+    m_server->set_handler([this](const FakeHubServer::request_t& req) -> FakeHubServer::response_t {
+        FakeHubServer::response_t resp;
+        resp.headers.push_back(qMakePair(QByteArray("Last-Modified"), last_modified));
+        auto ims = req.headers.find("if-modified-since");
+        if (ims != req.headers.end() && ims->second == last_modified) {
+            resp.status = 304;
+            return resp;
+        }
+        resp.body = m_body;
+        return resp;
+    });
+
+    CRestResponseCache cache((QString()));
+    QCOMPARE(cached_get(cache, "/balance", "user").body, m_body);
+    QCOMPARE(cached_get(cache, "/balance", "user").body, m_body);
+    QCOMPARE(m_server->requests_count(), 2);
+    QCOMPARE(m_server->bytes_served(), (qint64)m_body.size());
+}
+
+////////////////////////////////////////////////////////
+
+void RestResponseCacheTest::test_changed_body() {
+    CRestResponseCache cache((QString()));
+    bool unchanged = true;
+    cached_get(cache, "/my-peers", "user", &unchanged);
+    QVERIFY(!unchanged);
+
+    m_body = "[{\"peer\":\"changed\"}]";
+    m_etag = "\"v2\"";
+    rest_response_t resp = cached_get(cache, "/my-peers", "user", &unchanged);
+    QCOMPARE(resp.body, m_body);
+    QVERIFY(!resp.not_modified);
+    QVERIFY(!unchanged);
+
+    resp = cached_get(cache, "/my-peers", "user", &unchanged);
+    QCOMPARE(resp.body, m_body);
+    QVERIFY(unchanged);
+}
+
+////////////////////////////////////////////////////////
+
+void RestResponseCacheTest::test_scope() {
+    CRestResponseCache cache((QString()));
+    cached_get(cache, "/environments", "first");
+    cached_get(cache, "/environments", "second");
+    QCOMPARE(m_server->requests_count(), 2);
+    // second user hasn't any validators, so has to get full body
+    QVERIFY(m_server->requests()[1].headers.find("if-none-match") ==
+            m_server->requests()[1].headers.end());
+    QCOMPARE(m_server->bytes_served(), (qint64)m_body.size() * 2);
+}
+
+////////////////////////////////////////////////////////
+
+void RestResponseCacheTest::test_persistence() {
+    {
+        CRestResponseCache cache(m_dir->path());
+        cache.clear();
+        cached_get(cache, "/environments", "user");
+    }
+    m_server->reset_counters();
+
+    // next application run
+    CRestResponseCache cache(m_dir->path());
+    bool unchanged = true;
+    rest_response_t resp = cached_get(cache, "/environments", "user", &unchanged);
+    QCOMPARE(resp.body, m_body);
+    QVERIFY(resp.not_modified);
+    QVERIFY(!unchanged); // not delivered in this run yet
+    QCOMPARE(m_server->bytes_served(), (qint64)0);
+
+    QFile::Permissions perm = QFile::permissions(
+        m_dir->path() + "/" + QDir(m_dir->path()).entryList(QDir::Files).first());
+    QVERIFY(!(perm & (QFileDevice::ReadOther | QFileDevice::ReadGroup)));
+}
+
+////////////////////////////////////////////////////////
+
+void RestResponseCacheTest::test_no_validators() {
+    m_server->set_handler([this](const FakeHubServer::request_t& req) -> FakeHubServer::response_t {
+        FakeHubServer::response_t resp;
+        if (req.headers.find("if-none-match") != req.headers.end() ||
+            req.headers.find("if-modified-since") != req.headers.end())
+            resp.status = 400;
+        resp.body = m_body;
+        return resp;
+    });
+
+    CRestResponseCache cache((QString()));
+    bool unchanged = true;
+    cached_get(cache, "/balance", "user", &unchanged);
+    QVERIFY(!unchanged);
+    // the same body is detected even without validators
+    rest_response_t resp = cached_get(cache, "/balance", "user", &unchanged);
+    QCOMPARE(resp.http_code, 200);
+    QVERIFY(resp.not_modified);
+    QVERIFY(unchanged);
+}
+
+////////////////////////////////////////////////////////
+
+/* counts bytes it was fed */
+class SizeParser : public IRestBodyParser {
+public:
+    int size = 0;
+    void feed(const QByteArray& chunk) override { size += chunk.size(); }
+    void finish() override {}
+};
+
+void RestResponseCacheTest::test_streamed_body() {
+    CRestResponseCache cache((QString()));
+    // validated response is cached, so its body is kept next to parser
+    auto parser = std::make_shared<SizeParser>();
+    rest_response_t resp = cached_get(cache, "/environments", "user", nullptr, parser);
+    QCOMPARE(parser->size, m_body.size());
+    QVERIFY(!resp.body_dropped);
+    QCOMPARE(resp.body, m_body);
+
+    // without validators parser is the only consumer of body
+    m_server->set_handler([this](const FakeHubServer::request_t&) -> FakeHubServer::response_t {
+        FakeHubServer::response_t resp;
+        resp.body = m_body;
+        return resp;
+    });
+    parser = std::make_shared<SizeParser>();
+    bool unchanged = true;
+    resp = cached_get(cache, "/balance", "user", &unchanged, parser);
+    QCOMPARE(parser->size, m_body.size());
+    QVERIFY(resp.body_dropped);
+    QVERIFY(resp.body.isEmpty());
+    QVERIFY(!resp.not_modified);
+    QVERIFY(!unchanged);
+}
+
+////////////////////////////////////////////////////////
+
+void RestResponseCacheTest::test_lru_eviction() {
+    CRestResponseCache cache((QString()));
+    auto resolve = [&cache](int i) {
+        rest_response_t resp;
+        resp.http_code = 200;
+        resp.body = QByteArray::number(i);
+        return cache.resolve_response(QString("key%1").arg(i),
+                                      CRestResponseCache::snapshot_t(), resp);
+    };
+    for (int i = 0; i < CRestResponseCache::MAX_MEMORY_ENTRIES; ++i) {
+        resolve(i);
+        cache.mark_delivered(QString("key%1").arg(i));
+    }
+    QVERIFY(resolve(0));
+
+    // one new key drops only the least recently used entry
+    resolve(CRestResponseCache::MAX_MEMORY_ENTRIES);
+    QVERIFY(resolve(0));
+    QVERIFY(resolve(2));
+    QVERIFY(!resolve(1));
+}
+
+////////////////////////////////////////////////////////
+
+void RestResponseCacheTest::test_not_modified_after_eviction() {
+    CRestResponseCache cache((QString()));
+    cached_get(cache, "/environments", "user");
+
+    QUrl url(m_server->url("/environments"));
+    QNetworkRequest req(url);
+    QString key = CRestResponseCache::make_key(url, "user");
+    CRestResponseCache::snapshot_t snapshot = cache.prepare_request(key, req);
+    QCOMPARE(req.rawHeader("If-None-Match"), m_etag);
+
+    // entry is dropped while conditional request is in flight
+    cache.clear();
+    rest_response_t resp;
+    resp.http_code = 304;
+    QVERIFY(!cache.resolve_response(key, snapshot, resp));
+    QCOMPARE(resp.http_code, 200);
+    QCOMPARE(resp.body, m_body);
+    QVERIFY(resp.not_modified);
+
+    // body of 304 is cached again
+    bool unchanged = true;
+    resp = cached_get(cache, "/environments", "user", &unchanged);
+    QCOMPARE(resp.body, m_body);
+    QVERIFY(resp.not_modified);
+    QVERIFY(!unchanged);
+    QCOMPARE(m_server->requests_count(), 2);
+}
+
+////////////////////////////////////////////////////////
+
+void RestResponseCacheTest::cleanupTestCase() {
+    delete m_pipeline;
+    delete m_nam;
+    delete m_server;
+    delete m_dir;
+}
@@ -0,0 +1,44 @@
+#ifndef RESTRESPONSECACHETEST_H
+#define RESTRESPONSECACHETEST_H
+
+#include <QObject>
+#include <QTemporaryDir>
+#include "RestPipeline.h"
+
+class FakeHubServer;
+class QNetworkAccessManager;
+class CRestResponseCache;
+
+class RestResponseCacheTest : public QObject
+{
+    Q_OBJECT
+private:
+    FakeHubServer* m_server;
+    QNetworkAccessManager* m_nam;
+    CRestPipeline* m_pipeline;
+    QTemporaryDir* m_dir;
+    QByteArray m_body;
+    QByteArray m_etag;
+
+    rest_response_t cached_get(CRestResponseCache& cache,
+                               const QString& path,
+                               const QString& scope,
+                               bool* unchanged = nullptr,
+                               rest_body_parser_t parser = rest_body_parser_t());
+
+private slots:
+    void initTestCase();
+    void init();
+    void test_etag_revalidation();
+    void test_last_modified_revalidation();
+    void test_changed_body();
+    void test_scope();
+    void test_persistence();
+    void test_no_validators();
+    void test_streamed_body();
+    void test_lru_eviction();
+    void test_not_modified_after_eviction();
+    void cleanupTestCase();
+};
+
+#endif // RESTRESPONSECACHETEST_H
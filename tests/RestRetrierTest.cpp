@@ -0,0 +1,287 @@
+#include "RestRetrierTest.h"
+#include "RestRetrier.h"
+#include "FakeHubServer.h"
+#include <QElapsedTimer>
+#include <QNetworkProxy>
+#include <QTest>
+
+static FakeHubServer::response_t status_response(int status) {
+    FakeHubServer::response_t resp;
+    resp.status = status;
+    resp.body = "\"OK\"";
+    return resp;
+}
+
+void RestRetrierTest::initTestCase() {
+    m_server = new FakeHubServer;
+    QVERIFY(m_server->start());
+    m_nam = new QNetworkAccessManager;
+    m_nam->setProxy(QNetworkProxy::NoProxy);
+    m_pipeline = new CRestPipeline(m_nam);
+    m_retrier = new CRestRetrier(m_pipeline);
+}
+
+void RestRetrierTest::init() {
+    m_server->reset_counters();
+    m_server->set_handler([](const FakeHubServer::request_t&) -> FakeHubServer::response_t {
+        return status_response(200);
+    });
+    m_retrier->set_policy(CRestRetryPolicy(3, 50, 200));
+    m_retrier->set_breaker_params(3, 300, 1000);
+}
+
+rest_response_t RestRetrierTest::get(const QString& path, uint timeout_ms) {
+    QNetworkRequest req(QUrl(m_server->url(path)));
+    CRestPipeline* pipeline = m_pipeline;
+    bool finished = false;
+    rest_response_t res;
+    m_retrier->enqueue(CRestRetrier::endpoint_of(req.url()), this,
+                       [pipeline, req, timeout_ms](rest_callback_t callback) {
+        return pipeline->enqueue(req, RO_GET, QByteArray(), timeout_ms, nullptr, callback);
+    }, [&finished, &res](const rest_response_t& resp) {
+        res = resp;
+        finished = true;
+    });
+    QElapsedTimer et;
+    et.start();
+    while (!finished && et.elapsed() < 10000)
+        QTest::qWait(10);
+    if (!finished) res.error_string = "Test request wasn't finished";
+    return res;
+}
+
+////////////////////////////////////////////////////////
+
+void RestRetrierTest::test_transient_data() {
+    QTest::addColumn<int>("http_code");
+    QTest::addColumn<int>("network_error");
+    QTest::addColumn<bool>("timed_out");
+    QTest::addColumn<bool>("cancelled");
+    QTest::addColumn<bool>("transient");
+    QTest::newRow("200") << 200 << 0 << false << false << false;
+    QTest::newRow("404") << 404 << (int)QNetworkReply::ContentNotFoundError << false << false << false;
+    QTest::newRow("401") << 401 << (int)QNetworkReply::AuthenticationRequiredError << false << false << false;
+    QTest::newRow("429") << 429 << (int)QNetworkReply::UnknownContentError << false << false << true;
+    QTest::newRow("503") << 503 << (int)QNetworkReply::ServiceUnavailableError << false << false << true;
+    QTest::newRow("refused") << -1 << (int)QNetworkReply::ConnectionRefusedError << false << false << true;
+    QTest::newRow("reset") << -1 << (int)QNetworkReply::RemoteHostClosedError << false << false << true;
+    QTest::newRow("ssl") << -1 << (int)QNetworkReply::SslHandshakeFailedError << false << false << false;
+    QTest::newRow("timeout") << -1 << (int)QNetworkReply::OperationCanceledError << true << false << true;
+    QTest::newRow("cancelled") << -1 << (int)QNetworkReply::OperationCanceledError << false << true << false;
+}
+
+void RestRetrierTest::test_transient() {
+    QFETCH(int, http_code);
+    QFETCH(int, network_error);
+    QFETCH(bool, timed_out);
+    QFETCH(bool, cancelled);
+    QFETCH(bool, transient);
+    rest_response_t resp;
+    resp.http_code = http_code;
+    resp.network_error = network_error;
+    resp.timed_out = timed_out;
+    resp.cancelled = cancelled;
+    QCOMPARE(CRestRetryPolicy::is_transient(resp), transient);
+}
+
+////////////////////////////////////////////////////////
+
+void RestRetrierTest::test_backoff_delay() {
+    CRestRetryPolicy policy(10, 100, 1000);
+    bool jittered = false;
+    for (uint attempt = 1; attempt <= 8; ++attempt) {
+        uint expected = 100u << (attempt - 1);
+        if (expected > 1000) expected = 1000;
+        uint first = policy.delay_ms(attempt);
+        for (int i = 0; i < 50; ++i) {
+            uint delay = policy.delay_ms(attempt);
+            QVERIFY(delay >= expected / 2);
+            QVERIFY(delay <= expected);
+            jittered |= delay != first;
+        }
+    }
+    QVERIFY(jittered);
+
+    // Retry-After is respected, but capped
+    QCOMPARE(policy.delay_ms(1, 700), 700u);
+    QCOMPARE(policy.delay_ms(1, 5000), 1000u);
+
+    rest_response_t resp;
+    resp.headers.push_back(qMakePair(QByteArray("retry-after"), QByteArray(" 3")));
+    QCOMPARE(CRestRetryPolicy::retry_after_ms(resp), 3000u);
+}
+
+////////////////////////////////////////////////////////
+
+void RestRetrierTest::test_breaker_states() {
+    CRestCircuitBreaker br(2, 100, 300);
+    QVERIFY(br.allow_request(0));
+    br.on_failure(0);
+    QCOMPARE(br.state(), CRestCircuitBreaker::CB_CLOSED);
+    br.on_success();
+    br.on_failure(10);
+    QCOMPARE(br.state(), CRestCircuitBreaker::CB_CLOSED); // success resets counter
+    br.on_failure(20);
+    QCOMPARE(br.state(), CRestCircuitBreaker::CB_OPEN);
+    QVERIFY(!br.allow_request(50));
+    QCOMPARE(br.retry_after_ms(50), (qint64)70);
+
+    // one probe after open period
+    QVERIFY(br.allow_request(120));
+    QCOMPARE(br.state(), CRestCircuitBreaker::CB_HALF_OPEN);
+    QVERIFY(!br.allow_request(121));
+
+    // failed probe opens breaker for twice longer period
+    br.on_failure(130);
+    QCOMPARE(br.state(), CRestCircuitBreaker::CB_OPEN);
+    QVERIFY(!br.allow_request(300));
+    QVERIFY(br.allow_request(330));
+
+    // cancelled probe lets another one go
+    br.on_abandoned();
+    QVERIFY(br.allow_request(331));
+    br.on_success();
+    QCOMPARE(br.state(), CRestCircuitBreaker::CB_CLOSED);
+    QVERIFY(br.allow_request(332));
+}
+
+////////////////////////////////////////////////////////
+
+void RestRetrierTest::test_retry_recovers() {
+    int count = 0;
+    m_server->set_handler([&count](const FakeHubServer::request_t&) -> FakeHubServer::response_t {
+        return status_response(++count <= 2 ? 503 : 200);
+    });
+    rest_response_t resp = get("/environments");
+    QCOMPARE(resp.http_code, 200);
+    QCOMPARE(m_server->requests_count(), 3);
+    QCOMPARE(m_retrier->breaker_state(CRestRetrier::endpoint_of(QUrl(m_server->url("/environments")))),
+             CRestCircuitBreaker::CB_CLOSED);
+}
+
+////////////////////////////////////////////////////////
+
+void RestRetrierTest::test_retry_after_reset() {
+    int count = 0;
+    m_server->set_handler([&count](const FakeHubServer::request_t&) -> FakeHubServer::response_t {
+        FakeHubServer::response_t resp = status_response(200);
+        resp.reset = ++count == 1;
+        return resp;
+    });
+    rest_response_t resp = get("/my-peers");
+    QCOMPARE(resp.http_code, 200);
+    QCOMPARE(m_server->requests_count(), 2);
+}
+
+////////////////////////////////////////////////////////
+
+void RestRetrierTest::test_no_retry_on_client_error() {
+    m_server->set_handler([](const FakeHubServer::request_t&) -> FakeHubServer::response_t {
+        return status_response(404);
+    });
+    rest_response_t resp = get("/balance");
+    QCOMPARE(resp.http_code, 404);
+    QCOMPARE(m_server->requests_count(), 1);
+}
+
+////////////////////////////////////////////////////////
+
+void RestRetrierTest::test_retry_limit() {
+    m_server->set_handler([](const FakeHubServer::request_t&) -> FakeHubServer::response_t {
+        FakeHubServer::response_t resp;
+        resp.drop = true;
+        return resp;
+    });
+    m_retrier->set_breaker_params(10, 300, 1000);
+    rest_response_t resp = get("/p2p/status", 200);
+    QVERIFY(resp.timed_out);
+    QCOMPARE(m_server->requests_count(), 3);
+}
+
+////////////////////////////////////////////////////////
+
+void RestRetrierTest::test_circuit_opens() {
+    m_retrier->set_policy(CRestRetryPolicy(1, 50, 200));
+    bool healthy = false;
+    m_server->set_handler([&healthy](const FakeHubServer::request_t&) -> FakeHubServer::response_t {
+        return status_response(healthy ? 200 : 500);
+    });
+
+    for (int i = 0; i < 3; ++i)
+        QCOMPARE(get("/environments").http_code, 500);
+    QCOMPARE(m_server->requests_count(), 3);
+
+    // upstream isn't touched while breaker is open
+    for (int i = 0; i < 5; ++i) {
+        rest_response_t resp = get("/environments");
+        QVERIFY(resp.circuit_open);
+        QCOMPARE(resp.network_error, (int)QNetworkReply::TemporaryNetworkFailure);
+    }
+    QCOMPARE(m_server->requests_count(), 3);
+
+    // probe after open period closes breaker
+    healthy = true;
+    QTest::qWait(350);
+    QCOMPARE(get("/environments").http_code, 200);
+    QCOMPARE(m_server->requests_count(), 4);
+    QCOMPARE(get("/environments").http_code, 200);
+    QCOMPARE(m_server->requests_count(), 5);
+}
+
+////////////////////////////////////////////////////////
+
+void RestRetrierTest::test_half_open_single_probe() {
+    m_retrier->set_policy(CRestRetryPolicy(1, 50, 200));
+    m_server->set_handler([](const FakeHubServer::request_t&) -> FakeHubServer::response_t {
+        return status_response(502);
+    });
+    for (int i = 0; i < 3; ++i)
+        get("/balance");
+    QTest::qWait(350);
+
+    m_server->set_handler([](const FakeHubServer::request_t&) -> FakeHubServer::response_t {
+        FakeHubServer::response_t resp = status_response(200);
+        resp.delay_ms = 200;
+        return resp;
+    });
+    m_server->reset_counters();
+
+    static const int count = 4;
+    int finished = 0, rejected = 0;
+    QNetworkRequest req(QUrl(m_server->url("/balance")));
+    CRestPipeline* pipeline = m_pipeline;
+    for (int i = 0; i < count; ++i) {
+        m_retrier->enqueue(CRestRetrier::endpoint_of(req.url()), this,
+                           [pipeline, req](rest_callback_t callback) {
+            return pipeline->enqueue(req, RO_GET, QByteArray(), 5000, nullptr, callback);
+        }, [&finished, &rejected](const rest_response_t& resp) {
+            ++finished;
+            if (resp.circuit_open) ++rejected;
+        });
+    }
+    QTRY_COMPARE_WITH_TIMEOUT(finished, count, 5000);
+    QCOMPARE(m_server->requests_count(), 1);
+    QCOMPARE(rejected, count - 1);
+}
+
+////////////////////////////////////////////////////////
+
+void RestRetrierTest::test_endpoints_are_independent() {
+    m_retrier->set_policy(CRestRetryPolicy(1, 50, 200));
+    m_server->set_handler([](const FakeHubServer::request_t& req) -> FakeHubServer::response_t {
+        return status_response(req.path.startsWith("/broken") ? 503 : 200);
+    });
+    for (int i = 0; i < 4; ++i)
+        get("/broken");
+    QVERIFY(get("/broken").circuit_open);
+    QCOMPARE(get("/healthy").http_code, 200);
+}
+
+////////////////////////////////////////////////////////
+
+void RestRetrierTest::cleanupTestCase() {
+    delete m_pipeline;
+    delete m_retrier;
+    delete m_nam;
+    delete m_server;
+}
@@ -0,0 +1,39 @@
+#ifndef RESTRETRIERTEST_H
+#define RESTRETRIERTEST_H
+
+#include <QObject>
+#include "RestPipeline.h"
+
+class FakeHubServer;
+class QNetworkAccessManager;
+class CRestRetrier;
+
+class RestRetrierTest : public QObject
+{
+    Q_OBJECT
+private:
+    FakeHubServer* m_server;
+    QNetworkAccessManager* m_nam;
+    CRestPipeline* m_pipeline;
+    CRestRetrier* m_retrier;
+
+    rest_response_t get(const QString& path, uint timeout_ms = 5000);
+
+private slots:
+    void initTestCase();
+    void init();
+    void test_transient_data();
+    void test_transient();
+    void test_backoff_delay();
+    void test_breaker_states();
+    void test_retry_recovers();
+    void test_retry_after_reset();
+    void test_no_retry_on_client_error();
+    void test_retry_limit();
+    void test_circuit_opens();
+    void test_half_open_single_probe();
+    void test_endpoints_are_independent();
+    void cleanupTestCase();
+};
+
+#endif // RESTRETRIERTEST_H
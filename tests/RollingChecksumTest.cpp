@@ -0,0 +1,91 @@
+#include "RollingChecksumTest.h"
+#include "RollingChecksum.h"
+#include "RollingCrc.h"
+#include <QByteArray>
+#include <QTest>
+
+static QByteArray random_data(int size) {
+    QByteArray data(size, 0);
+    for (int i = 0; i < size; ++i)
+        data[i] = (char)(qrand() & 0xff);
+    return data;
+}
+
+void RollingChecksumTest::test_known_values() {
+    QCOMPARE(CRollingChecksum::checksum("", 0), 0u);
+    QCOMPARE(CRollingChecksum::checksum("a", 1), 0x00610061u);
+    QCOMPARE(CRollingChecksum::checksum("abc", 3), 0x024a0126u);
+    // high bytes are unsigned
+    QCOMPARE(CRollingChecksum::checksum("\xff\xff", 2), 0x02fd01feu);
+}
+
+////////////////////////////////////////////////////////
+
+void RollingChecksumTest::test_roll_equals_recompute() {
+    QByteArray data = random_data(20000);
+    const int windows[] = {1, 7, 700, 4096};
+    for (int window : windows) {
+        CRollingChecksum sum;
+        sum.update(data.constData(), window);
+        for (int i = 0; i + window < data.size(); ++i) {
+            QCOMPARE(sum.digest(), CRollingChecksum::checksum(data.constData() + i, window));
+            sum.roll((unsigned char)data[i], (unsigned char)data[i + window]);
+        }
+        QCOMPARE(sum.length(), (size_t)window);
+    }
+}
+
+////////////////////////////////////////////////////////
+
+void RollingChecksumTest::test_incremental_update() {
+    QByteArray data = random_data(100000);
+    CRollingChecksum sum;
+    for (int i = 0; i < data.size(); i += 333)
+        sum.update(data.constData() + i, qMin(333, data.size() - i));
+    QCOMPARE(sum.digest(), CRollingChecksum::checksum(data.constData(), data.size()));
+    QCOMPARE(sum.length(), (size_t)data.size());
+    sum.reset();
+    QCOMPARE(sum.digest(), 0u);
+    QCOMPARE(sum.length(), (size_t)0);
+}
+
+////////////////////////////////////////////////////////
+
+void RollingChecksumTest::benchmark_roll() {
+    QByteArray data = random_data(1024 * 1024);
+    const int window = 4096;
+    uint32_t res = 0;
+    QBENCHMARK {
+        CRollingChecksum sum;
+        sum.update(data.constData(), window);
+        for (int i = 0; i + window < data.size(); ++i)
+            sum.roll((unsigned char)data[i], (unsigned char)data[i + window]);
+        res = sum.digest();
+    }
+    QCOMPARE(res, CRollingChecksum::checksum(data.constData() + data.size() - window, window));
+}
+
+////////////////////////////////////////////////////////
+
+void RollingChecksumTest::test_crc_known_values() {
+    // what `printf ... | cksum` prints
+    QCOMPARE(CRollingCrc::cksum("", 0), 4294967295u);
+    QCOMPARE(CRollingCrc::cksum("123456789", 9), 930766865u);
+    QCOMPARE(CRollingCrc::cksum("a", 1), 1220704766u);
+}
+
+////////////////////////////////////////////////////////
+
+void RollingChecksumTest::test_crc_roll_equals_recompute() {
+    QByteArray data = random_data(20000);
+    const int windows[] = {1, 7, 700, 4096};
+    for (int window : windows) {
+        CRollingCrc crc(window);
+        crc.update(data.constData(), window);
+        for (int i = 0; i + window < data.size(); ++i) {
+            QCOMPARE(crc.digest(), CRollingCrc::cksum(data.constData() + i, window));
+            crc.roll((unsigned char)data[i], (unsigned char)data[i + window]);
+        }
+        QCOMPARE(crc.length(), (size_t)window);
+    }
+}
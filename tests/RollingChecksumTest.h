@@ -0,0 +1,18 @@
+#ifndef ROLLINGCHECKSUMTEST_H
+#define ROLLINGCHECKSUMTEST_H
+
+#include <QObject>
+
+class RollingChecksumTest : public QObject
+{
+    Q_OBJECT
+private slots:
+    void test_known_values();
+    void test_roll_equals_recompute();
+    void test_incremental_update();
+    void benchmark_roll();
+    void test_crc_known_values();
+    void test_crc_roll_equals_recompute();
+};
+
+#endif // ROLLINGCHECKSUMTEST_H
@@ -0,0 +1,293 @@
+#include "SftpBrowserTest.h"
+#include "LibsshController.h"
+#include "LocalSshServer.h"
+#include "SftpBrowser.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QProcess>
+#include <QStandardPaths>
+#include <QTest>
+
+static const int HUGE_COUNT = 30000;
+
+static void touch(const QString& path, int size = 0) {
+    QFile file(path);
+    file.open(QIODevice::WriteOnly);
+    if (size) file.write(QByteArray(size, 'x'));
+}
+
+/* all pages of listing together */
+static int list_all(const ssh_endpoint_t& endpoint, const QString& dir,
+                    std::vector<sftp_entry_t>& entries, std::vector<int>* pages = nullptr) {
+    entries.clear();
+    return CSftpBrowser::list(endpoint, dir, [&](const std::vector<sftp_entry_t>& page) {
+        entries.insert(entries.end(), page.begin(), page.end());
+        if (pages) pages->push_back((int)page.size());
+        return true;
+    });
+}
+
+static QStringList names(const std::vector<sftp_entry_t>& entries) {
+    QStringList res;
+    for (const sftp_entry_t& entry : entries)
+        res << entry.name;
+    return res;
+}
+
+QString SftpBrowserTest::make_dir(const QString &name) {
+    QString path = m_server->root() + "/" + name;
+    QDir(path).removeRecursively();
+    QDir().mkpath(path);
+    return path;
+}
+
+////////////////////////////////////////////////////////
+
+void SftpBrowserTest::initTestCase() {
+#ifdef RT_OS_WINDOWS
+    QSKIP("sshd of system is needed");
+#endif
+    m_server = new LocalSshServer;
+    if (!m_server->start())
+        QSKIP(qPrintable(m_server->error()));
+    CSftpBrowser::set_cache_ttl(CSftpBrowser::DEFAULT_CACHE_TTL_MS);
+}
+
+////////////////////////////////////////////////////////
+
+void SftpBrowserTest::test_unusual_names() {
+    QString dir = make_dir("unusual");
+    // names which broke parsing of ls -lF output
+    QStringList files = QStringList()
+        << "with space" << "  leading spaces" << "trailing space " << "-dash"
+        << "star*" << "arrow -> target" << "quote'and\"double" << "back\\slash"
+        << "new\nline" << "tab\there" << QString::fromUtf8("юникод файл")
+        << QString::fromUtf8("日本語") << "Jan 10 12:00 date like" << ".hidden";
+    for (int i = 0; i < files.size(); ++i)
+        touch(dir + "/" + files[i], i);
+    QDir().mkdir(dir + "/dir with space");
+    files << "dir with space";
+    files.sort();
+
+    std::vector<sftp_entry_t> entries;
+    QCOMPARE(list_all(m_server->endpoint(), dir, entries), (int)RLE_SUCCESS);
+    QCOMPARE(names(entries), files);
+    for (const sftp_entry_t& entry : entries) {
+        QCOMPARE(entry.dir, entry.name == "dir with space");
+        QCOMPARE(entry.size, (quint64)QFileInfo(dir + "/" + entry.name).size());
+        QVERIFY(entry.mtime > 0);
+    }
+}
+
+////////////////////////////////////////////////////////
+
+void SftpBrowserTest::test_links() {
+    QString dir = make_dir("links");
+    QDir().mkdir(dir + "/target dir");
+    touch(dir + "/target file", 10);
+    QVERIFY(QFile::link(dir + "/target dir", dir + "/link to dir"));
+    QVERIFY(QFile::link(dir + "/target file", dir + "/link to file"));
+    QVERIFY(QFile::link(dir + "/nothing", dir + "/broken link"));
+
+    std::vector<sftp_entry_t> entries;
+    QCOMPARE(list_all(m_server->endpoint(), dir, entries), (int)RLE_SUCCESS);
+    QCOMPARE(names(entries), QStringList() << "broken link" << "link to dir" << "link to file"
+                                           << "target dir" << "target file");
+    // links show what they point to, broken one stays a file
+    QVERIFY(!entries[0].dir);
+    QVERIFY(entries[1].dir);
+    QVERIFY(!entries[2].dir);
+    QCOMPARE(entries[2].size, (quint64)10);
+}
+
+////////////////////////////////////////////////////////
+
+void SftpBrowserTest::test_huge_directory() {
+    QString dir = make_dir("huge");
+    QStringList expected;
+    for (int i = 0; i < HUGE_COUNT; ++i) {
+        QString name = QString("file %1.txt").arg(i, 6, 10, QChar('0'));
+        touch(dir + "/" + name);
+        expected << name;
+    }
+
+    std::vector<sftp_entry_t> entries;
+    std::vector<int> pages;
+    QCOMPARE(list_all(m_server->endpoint(), dir, entries, &pages), (int)RLE_SUCCESS);
+    QCOMPARE(names(entries), expected);
+    int page_count = (HUGE_COUNT + CSftpBrowser::PAGE_SIZE - 1) / CSftpBrowser::PAGE_SIZE;
+    QCOMPARE((int)pages.size(), page_count);
+    QCOMPARE(pages.front(), CSftpBrowser::PAGE_SIZE);
+    QCOMPARE(pages.back(), HUGE_COUNT - (page_count - 1) * CSftpBrowser::PAGE_SIZE);
+
+    // empty directory gives one empty page
+    pages.clear();
+    QCOMPARE(list_all(m_server->endpoint(), make_dir("empty"), entries, &pages), (int)RLE_SUCCESS);
+    QCOMPARE((int)pages.size(), 1);
+    QVERIFY(entries.empty());
+}
+
+////////////////////////////////////////////////////////
+
+void SftpBrowserTest::test_stop_listing() {
+    QString dir = make_dir("stop");
+    for (int i = 0; i < 2500; ++i)
+        touch(dir + QString("/%1").arg(i));
+
+    int pages = 0;
+    int rc = CSftpBrowser::list(m_server->endpoint(), dir,
+                                [&pages](const std::vector<sftp_entry_t>&) {
+        return ++pages < 2;
+    }, 1000);
+    // user went to other directory
+    QCOMPARE(rc, (int)RLE_CANCELLED);
+    QCOMPARE(pages, 2);
+
+    // directory isn't read up to the end when caller stops it while reading
+    CSftpBrowser::invalidate(m_server->endpoint(), dir);
+    int checks = 0;
+    pages = 0;
+    rc = CSftpBrowser::list(m_server->endpoint(), dir,
+                            [&pages](const std::vector<sftp_entry_t>&) {
+        ++pages;
+        return true;
+    }, 1000, [&checks]() {
+        return ++checks > 100;
+    });
+    QCOMPARE(rc, (int)RLE_CANCELLED);
+    QCOMPARE(pages, 0);
+    QVERIFY(checks < 2500);
+    // stopped listing isn't cached
+    int entries_count = 0;
+    QCOMPARE(CSftpBrowser::list(m_server->endpoint(), dir,
+                                [&entries_count](const std::vector<sftp_entry_t>& page) {
+        entries_count += (int)page.size();
+        return true;
+    }), (int)RLE_SUCCESS);
+    QCOMPARE(entries_count, 2500);
+
+    // stopped listing doesn't connect at all
+    CSftpBrowser::close_sessions(m_server->endpoint().host);
+    int logins = m_server->logins_count();
+    rc = CSftpBrowser::list(m_server->endpoint(), dir,
+                            [](const std::vector<sftp_entry_t>&) { return true; },
+                            1000, []() { return true; });
+    QCOMPARE(rc, (int)RLE_CANCELLED);
+    QTest::qWait(200);
+    QCOMPARE(m_server->logins_count(), logins);
+}
+
+////////////////////////////////////////////////////////
+
+void SftpBrowserTest::test_cache() {
+    ssh_endpoint_t endpoint = m_server->endpoint();
+    QString dir = make_dir("cached");
+    touch(dir + "/first");
+    std::vector<sftp_entry_t> entries;
+    QCOMPARE(list_all(endpoint, dir + "/", entries), (int)RLE_SUCCESS);
+    QCOMPARE(names(entries), QStringList() << "first");
+
+    // change isn't seen while listing is fresh, trailing slash doesn't matter
+    touch(dir + "/second");
+    QCOMPARE(list_all(endpoint, dir, entries), (int)RLE_SUCCESS);
+    QCOMPARE(names(entries), QStringList() << "first");
+
+    CSftpBrowser::invalidate(endpoint, dir + "///");
+    QCOMPARE(list_all(endpoint, dir, entries), (int)RLE_SUCCESS);
+    QCOMPARE(names(entries), QStringList() << "first" << "second");
+
+    CSftpBrowser::set_cache_ttl(100);
+    touch(dir + "/third");
+    QTest::qWait(200);
+    QCOMPARE(list_all(endpoint, dir, entries), (int)RLE_SUCCESS);
+    QCOMPARE(names(entries), QStringList() << "first" << "second" << "third");
+    CSftpBrowser::set_cache_ttl(CSftpBrowser::DEFAULT_CACHE_TTL_MS);
+
+    QVERIFY(CSftpBrowser::cached_dirs_count() > 0);
+    CSftpBrowser::close_sessions(endpoint.host);
+    QCOMPARE(CSftpBrowser::cached_dirs_count(), 0);
+}
+
+////////////////////////////////////////////////////////
+
+void SftpBrowserTest::test_session_reused() {
+    ssh_endpoint_t endpoint = m_server->endpoint();
+    CSftpBrowser::close_sessions(endpoint.host);
+    CSftpBrowser::set_cache_ttl(0);
+    QString dir = make_dir("reused");
+    QDir().mkpath(dir + "/a/b/c");
+
+    int logins = m_server->logins_count();
+    std::vector<sftp_entry_t> entries;
+    QStringList path = QStringList() << "" << "/a" << "/a/b" << "/a/b/c" << "/a/b" << "/a" << "";
+    for (const QString& sub : path)
+        QCOMPARE(list_all(endpoint, dir + sub, entries), (int)RLE_SUCCESS);
+    // every click used to be new ssh process with handshake
+    QTRY_COMPARE(m_server->logins_count(), logins + 1);
+    CSftpBrowser::set_cache_ttl(CSftpBrowser::DEFAULT_CACHE_TTL_MS);
+}
+
+////////////////////////////////////////////////////////
+
+void SftpBrowserTest::test_missing_directory() {
+    std::vector<sftp_entry_t> entries;
+    int rc = list_all(m_server->endpoint(), m_server->root() + "/no such dir", entries);
+    QCOMPARE(rc, (int)RLE_SFTP_OPEN);
+    QVERIFY(!CSftpBrowser::is_connection_error(rc));
+
+    ssh_endpoint_t wrong_user = m_server->endpoint();
+    wrong_user.user = "no_such_user_here";
+    rc = list_all(wrong_user, m_server->root(), entries);
+    QVERIFY(CSftpBrowser::is_connection_error(rc));
+}
+
+////////////////////////////////////////////////////////
+
+void SftpBrowserTest::benchmark_listing_data() {
+    QTest::addColumn<int>("way");
+    QTest::newRow("sftp readdir") << 0;
+    QTest::newRow("sftp cached") << 1;
+    QTest::newRow("ls -lF over ssh process") << 2;
+}
+
+void SftpBrowserTest::benchmark_listing() {
+    QFETCH(int, way);
+    QString ssh_path = QStandardPaths::findExecutable("ssh");
+    if (way == 2 && ssh_path.isEmpty())
+        QSKIP("ssh isn't installed");
+
+    QString dir = m_server->root() + "/huge";
+    if (!QFileInfo(dir).isDir())
+        QSKIP("test_huge_directory creates directory");
+    ssh_endpoint_t endpoint = m_server->endpoint();
+    std::vector<sftp_entry_t> entries;
+    QCOMPARE(list_all(endpoint, dir, entries), (int)RLE_SUCCESS);
+
+    QBENCHMARK {
+        if (way == 2) {
+            // old way, new connection and text to parse on every click
+            QProcess proc;
+            proc.start(ssh_path, QStringList()
+                       << "-o" << "StrictHostKeyChecking=no" << "-o" << "UserKnownHostsFile=/dev/null"
+                       << "-o" << "BatchMode=yes" << "-i" << endpoint.private_key
+                       << "-p" << QString::number(endpoint.port)
+                       << QString("%1@%2").arg(endpoint.user, endpoint.host)
+                       << QString("cd \"%1\"; ls -lF;").arg(dir));
+            QVERIFY(proc.waitForFinished(60000));
+            QCOMPARE(proc.readAllStandardOutput().count('\n'), HUGE_COUNT + 1);
+        } else {
+            if (way == 0) CSftpBrowser::invalidate(endpoint, dir);
+            QCOMPARE(list_all(endpoint, dir, entries), (int)RLE_SUCCESS);
+            QCOMPARE((int)entries.size(), HUGE_COUNT);
+        }
+    }
+}
+
+////////////////////////////////////////////////////////
+
+void SftpBrowserTest::cleanupTestCase() {
+    if (m_server)
+        CSftpBrowser::close_sessions(m_server->endpoint().host);
+    delete m_server;
+}
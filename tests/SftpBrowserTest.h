@@ -0,0 +1,30 @@
+#ifndef SFTPBROWSERTEST_H
+#define SFTPBROWSERTEST_H
+
+#include <QObject>
+
+class LocalSshServer;
+
+class SftpBrowserTest : public QObject
+{
+    Q_OBJECT
+private:
+    LocalSshServer* m_server = nullptr;
+
+    QString make_dir(const QString& name);
+
+private slots:
+    void initTestCase();
+    void test_unusual_names();
+    void test_links();
+    void test_huge_directory();
+    void test_stop_listing();
+    void test_cache();
+    void test_session_reused();
+    void test_missing_directory();
+    void benchmark_listing_data();
+    void benchmark_listing();
+    void cleanupTestCase();
+};
+
+#endif // SFTPBROWSERTEST_H
@@ -0,0 +1,245 @@
+#include "SftpTransferTest.h"
+#include "LibsshController.h"
+#include "LocalSshServer.h"
+#include "SftpTransfer.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QProcess>
+#include <QStandardPaths>
+#include <QTest>
+#include <QtConcurrent/QtConcurrent>
+
+QString SftpTransferTest::make_file(const QString &path, int size) {
+    QByteArray data(size, 0);
+    for (int i = 0; i < size; ++i)
+        data[i] = (char)(qrand() & 0xff);
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QFile file(path);
+    file.open(QIODevice::WriteOnly);
+    file.write(data);
+    file.close();
+    return path;
+}
+
+static QByteArray read_all(const QString& path) {
+    QFile file(path);
+    file.open(QIODevice::ReadOnly);
+    return file.readAll();
+}
+
+////////////////////////////////////////////////////////
+
+void SftpTransferTest::initTestCase() {
+#ifdef RT_OS_WINDOWS
+    QSKIP("sshd of system is needed");
+#endif
+    m_server = new LocalSshServer;
+    if (!m_server->start())
+        QSKIP(qPrintable(m_server->error()));
+    m_local = new QTemporaryDir;
+    QVERIFY(m_local->isValid());
+}
+
+////////////////////////////////////////////////////////
+
+void SftpTransferTest::test_upload_download_file() {
+    // few chunks and a tail
+    const int size = CSftpTransfer::CHUNK_SIZE * 3 + 12345;
+    QString local = make_file(m_local->path() + "/big.bin", size);
+    QFile::setPermissions(local, QFileDevice::ReadOwner | QFileDevice::WriteOwner |
+                          QFileDevice::ExeOwner | QFileDevice::ReadGroup);
+
+    quint64 last_done = 0, last_total = 0;
+    bool monotonic = true;
+    int rc = CSftpTransfer::upload(m_server->endpoint(), local, m_server->root(),
+                                   [&](quint64 done, quint64 total) {
+        monotonic = monotonic && done >= last_done;
+        last_done = done;
+        last_total = total;
+    });
+    QCOMPARE(rc, (int)RLE_SUCCESS);
+    QVERIFY(monotonic);
+    QCOMPARE(last_done, (quint64)size);
+    QCOMPARE(last_total, (quint64)size);
+
+    QString remote = m_server->root() + "/big.bin";
+    QCOMPARE(read_all(remote), read_all(local));
+    QCOMPARE(QFileInfo(remote).permissions() & 0x7777, QFileInfo(local).permissions() & 0x7777);
+    QCOMPARE(QFileInfo(remote).lastModified().toTime_t(), QFileInfo(local).lastModified().toTime_t());
+
+    QDir().mkpath(m_local->path() + "/back");
+    rc = CSftpTransfer::download(m_server->endpoint(), remote, m_local->path() + "/back");
+    QCOMPARE(rc, (int)RLE_SUCCESS);
+    QCOMPARE(read_all(m_local->path() + "/back/big.bin"), read_all(local));
+}
+
+////////////////////////////////////////////////////////
+
+void SftpTransferTest::test_directory_tree() {
+    QString tree = m_local->path() + "/tree";
+    make_file(tree + "/a.txt", 100);
+    make_file(tree + "/empty", 0);
+    make_file(tree + "/sub dir/with space.txt", 5000);
+    make_file(tree + "/sub dir/deeper/unicode-\xd1\x84\xd0\xb0\xd0\xb9\xd0\xbb.txt", 70000);
+    QDir().mkpath(tree + "/empty dir");
+
+    int rc = CSftpTransfer::upload(m_server->endpoint(), tree, m_server->root() + "/");
+    QCOMPARE(rc, (int)RLE_SUCCESS);
+    QStringList files = QStringList() << "a.txt" << "empty" << "sub dir/with space.txt"
+                                      << "sub dir/deeper/unicode-\xd1\x84\xd0\xb0\xd0\xb9\xd0\xbb.txt";
+    for (const QString& file : files)
+        QCOMPARE(read_all(m_server->root() + "/tree/" + file), read_all(tree + "/" + file));
+    QVERIFY(QFileInfo(m_server->root() + "/tree/empty dir").isDir());
+
+    // directory again, existing directories are ok
+    QString back = m_local->path() + "/tree back";
+    QDir().mkpath(back);
+    rc = CSftpTransfer::download(m_server->endpoint(), m_server->root() + "/tree/", back);
+    QCOMPARE(rc, (int)RLE_SUCCESS);
+    for (const QString& file : files)
+        QCOMPARE(read_all(back + "/tree/" + file), read_all(tree + "/" + file));
+    QVERIFY(QFileInfo(back + "/tree/empty dir").isDir());
+}
+
+////////////////////////////////////////////////////////
+
+void SftpTransferTest::test_session_reused() {
+    ssh_endpoint_t endpoint = m_server->endpoint();
+    CSftpTransfer::close_sessions(endpoint.host);
+    int logins = m_server->logins_count();
+
+    for (int i = 0; i < 30; ++i) {
+        QString file = make_file(m_local->path() + QString("/small/%1.txt").arg(i), 512);
+        QCOMPARE(CSftpTransfer::upload(endpoint, file, m_server->root()), (int)RLE_SUCCESS);
+    }
+    QCOMPARE(CSftpTransfer::sessions_count(), 1);
+    QTRY_COMPARE_WITH_TIMEOUT(m_server->logins_count(), logins + 1, 5000);
+
+    // forgotten session isn't used anymore
+    CSftpTransfer::close_sessions(endpoint.host);
+    QCOMPARE(CSftpTransfer::sessions_count(), 0);
+    QString file = make_file(m_local->path() + "/small/last.txt", 10);
+    QCOMPARE(CSftpTransfer::upload(endpoint, file, m_server->root()), (int)RLE_SUCCESS);
+    QTRY_COMPARE_WITH_TIMEOUT(m_server->logins_count(), logins + 2, 5000);
+}
+
+////////////////////////////////////////////////////////
+
+void SftpTransferTest::test_parallel_sessions() {
+    static const int count = CSftpTransfer::MAX_SESSIONS_PER_ENDPOINT * 2;
+    ssh_endpoint_t endpoint = m_server->endpoint();
+    CSftpTransfer::close_sessions(endpoint.host);
+    QString root = m_server->root();
+
+    QList<QFuture<int> > uploads;
+    for (int i = 0; i < count; ++i) {
+        QString file = make_file(m_local->path() + QString("/parallel/%1.bin").arg(i),
+                                 CSftpTransfer::CHUNK_SIZE * 2);
+        uploads << QtConcurrent::run([endpoint, file, root]() {
+            return CSftpTransfer::upload(endpoint, file, root);
+        });
+    }
+    for (QFuture<int>& upload : uploads)
+        QCOMPARE(upload.result(), (int)RLE_SUCCESS);
+    // transfers didn't wait for one session, but count of sessions is limited
+    QVERIFY(CSftpTransfer::sessions_count() >= 1);
+    QVERIFY(CSftpTransfer::sessions_count() <= CSftpTransfer::MAX_SESSIONS_PER_ENDPOINT);
+    for (int i = 0; i < count; ++i)
+        QCOMPARE(read_all(root + QString("/%1.bin").arg(i)),
+                 read_all(m_local->path() + QString("/parallel/%1.bin").arg(i)));
+}
+
+////////////////////////////////////////////////////////
+
+void SftpTransferTest::test_missing_remote_file() {
+    int rc = CSftpTransfer::download(m_server->endpoint(), m_server->root() + "/no such file",
+                                     m_local->path());
+    QCOMPARE(rc, (int)RLE_SFTP_OPEN);
+    QVERIFY(!QFile::exists(m_local->path() + "/no such file"));
+
+    // session survives error
+    QString file = make_file(m_local->path() + "/after_error.txt", 10);
+    QCOMPARE(CSftpTransfer::upload(m_server->endpoint(), file, m_server->root()), (int)RLE_SUCCESS);
+}
+
+////////////////////////////////////////////////////////
+
+void SftpTransferTest::test_permission_denied() {
+    if (m_server->user() == "root")
+        QSKIP("root can write everywhere");
+    QString read_only = m_server->root() + "/read_only";
+    QDir().mkpath(read_only);
+    QFile::setPermissions(read_only, QFileDevice::ReadOwner | QFileDevice::ExeOwner);
+    QString file = make_file(m_local->path() + "/denied.txt", 10);
+    int rc = CSftpTransfer::upload(m_server->endpoint(), file, read_only);
+    QFile::setPermissions(read_only, QFileDevice::ReadOwner | QFileDevice::WriteOwner |
+                          QFileDevice::ExeOwner);
+    QCOMPARE(rc, (int)RLE_SFTP_PERMISSION_DENIED);
+}
+
+////////////////////////////////////////////////////////
+
+void SftpTransferTest::test_cancel() {
+    QString file = make_file(m_local->path() + "/cancel.bin", CSftpTransfer::CHUNK_SIZE * 4);
+    QAtomicInt cancel(0);
+    quint64 transferred = 0;
+    int rc = CSftpTransfer::upload(m_server->endpoint(), file, m_server->root(),
+                                   [&](quint64 done, quint64) {
+        transferred = done;
+        cancel.store(1);
+    }, &cancel);
+    QCOMPARE(rc, (int)RLE_CANCELLED);
+    QCOMPARE(transferred, (quint64)CSftpTransfer::CHUNK_SIZE);
+}
+
+////////////////////////////////////////////////////////
+
+void SftpTransferTest::benchmark_small_files_data() {
+    QTest::addColumn<bool>("scp");
+    QTest::newRow("sftp session") << false;
+    QTest::newRow("scp process per file") << true;
+}
+
+void SftpTransferTest::benchmark_small_files() {
+    QFETCH(bool, scp);
+    QString scp_path = QStandardPaths::findExecutable("scp");
+    if (scp && scp_path.isEmpty())
+        QSKIP("scp isn't installed");
+
+    const int count = 50;
+    QStringList files;
+    for (int i = 0; i < count; ++i)
+        files << make_file(m_local->path() + QString("/bench/%1.bin").arg(i), 4096);
+    QString remote = m_server->root() + "/bench";
+    QDir().mkpath(remote);
+    ssh_endpoint_t endpoint = m_server->endpoint();
+
+    QBENCHMARK {
+        for (const QString& file : files) {
+            if (scp) {
+                // old way, every file is new ssh connection
+                QProcess proc;
+                proc.start(scp_path, QStringList()
+                           << "-q" << "-p" << "-o" << "StrictHostKeyChecking=no"
+                           << "-o" << "UserKnownHostsFile=/dev/null" << "-o" << "BatchMode=yes"
+                           << "-i" << endpoint.private_key << "-P" << QString::number(endpoint.port)
+                           << file << QString("%1@%2:%3").arg(endpoint.user, endpoint.host, remote));
+                QVERIFY(proc.waitForFinished(30000));
+                QCOMPARE(proc.exitCode(), 0);
+            } else {
+                QCOMPARE(CSftpTransfer::upload(endpoint, file, remote), (int)RLE_SUCCESS);
+            }
+        }
+    }
+    QCOMPARE(read_all(remote + "/7.bin"), read_all(files[7]));
+}
+
+////////////////////////////////////////////////////////
+
+void SftpTransferTest::cleanupTestCase() {
+    if (m_server)
+        CSftpTransfer::close_sessions(m_server->endpoint().host);
+    delete m_server;
+    delete m_local;
+}
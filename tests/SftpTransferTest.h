@@ -0,0 +1,32 @@
+#ifndef SFTPTRANSFERTEST_H
+#define SFTPTRANSFERTEST_H
+
+#include <QObject>
+#include <QTemporaryDir>
+
+class LocalSshServer;
+
+class SftpTransferTest : public QObject
+{
+    Q_OBJECT
+private:
+    LocalSshServer* m_server = nullptr;
+    QTemporaryDir* m_local = nullptr;
+
+    QString make_file(const QString& path, int size);
+
+private slots:
+    void initTestCase();
+    void test_upload_download_file();
+    void test_directory_tree();
+    void test_session_reused();
+    void test_parallel_sessions();
+    void test_missing_remote_file();
+    void test_permission_denied();
+    void test_cancel();
+    void benchmark_small_files_data();
+    void benchmark_small_files();
+    void cleanupTestCase();
+};
+
+#endif // SFTPTRANSFERTEST_H
@@ -0,0 +1,226 @@
+#include "SshKeyCheckerTest.h"
+#include "SshKeyChecker.h"
+#include "RestPipeline.h"
+#include "FakeHubServer.h"
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QNetworkProxy>
+#include <QTest>
+#include <QtConcurrent/QtConcurrent>
+
+static const int REQUEST_DELAY_MS = 200;
+
+static std::vector<CSshKeyChecker::env_t> environments(int count,
+                                                       const QString& revision = "r1") {
+    std::vector<CSshKeyChecker::env_t> res;
+    for (int i = 0; i < count; ++i) {
+        CSshKeyChecker::env_t env;
+        env.id = QString("env%1").arg(i);
+        env.revision = revision;
+        res.push_back(env);
+    }
+    return res;
+}
+
+// check() blocks, so it's called from worker thread while main loop serves requests
+static std::map<QString, std::vector<uint8_t> > run_check(CSshKeyChecker* checker,
+        const QStringList& keys, const std::vector<CSshKeyChecker::env_t>& envs) {
+    QFuture<std::map<QString, std::vector<uint8_t> > > res = QtConcurrent::run([checker, keys, envs]() {
+        return checker->check(keys, envs, 10000);
+    });
+    QElapsedTimer et;
+    et.start();
+    while (!res.isFinished() && et.elapsed() < 15000)
+        QTest::qWait(10);
+    return res.result();
+}
+
+void SshKeyCheckerTest::initTestCase() {
+    m_server = new FakeHubServer;
+    QVERIFY(m_server->start());
+    m_nam = new QNetworkAccessManager;
+    m_nam->setProxy(QNetworkProxy::NoProxy);
+    m_pipeline = new CRestPipeline(m_nam);
+
+    // the same request as CRestWorker::is_sshkeys_in_environment_async sends
+    CRestPipeline* pipeline = m_pipeline;
+    QString url = m_server->url("/environments/check-key");
+    m_checker = new CSshKeyChecker([pipeline, url](const QStringList& keys, const QString& env_id,
+                                                   CSshKeyChecker::result_callback_t callback) {
+        QJsonObject obj;
+        obj["sshKeys"] = QJsonArray::fromStringList(keys);
+        obj["envId"] = env_id;
+        QNetworkRequest req((QUrl(url)));
+        req.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
+        pipeline->enqueue(req, RO_POST, QJsonDocument(obj).toJson(), 5000, nullptr,
+                          [callback](const rest_response_t& resp) {
+            std::vector<uint8_t> res;
+            QJsonArray arr = QJsonDocument::fromJson(resp.body).array();
+            for (auto i = arr.begin(); i != arr.end(); ++i)
+                res.push_back(i->toBool() ? 1 : 0);
+            callback(res);
+        });
+    });
+}
+
+void SshKeyCheckerTest::init() {
+    m_server->reset_counters();
+    m_failing_envs.clear();
+    m_requested_keys.clear();
+    m_checker->clear();
+    m_checker->set_ttl(CSshKeyChecker::DEFAULT_TTL_MS);
+    // "shared" key is in every environment, "key_envN" only in envN
+    m_server->set_handler([this](const FakeHubServer::request_t& req) -> FakeHubServer::response_t {
+        QJsonObject obj = QJsonDocument::fromJson(req.body).object();
+        QString env_id = obj["envId"].toString();
+        QJsonArray res;
+        QJsonArray keys = obj["sshKeys"].toArray();
+        for (auto i = keys.begin(); i != keys.end(); ++i) {
+            m_requested_keys << i->toString();
+            res.push_back(i->toString() == "shared" || i->toString() == "key_" + env_id);
+        }
+        FakeHubServer::response_t resp;
+        resp.delay_ms = REQUEST_DELAY_MS;
+        if (m_failing_envs.contains(env_id))
+            resp.status = 500;
+        else
+            resp.body = QJsonDocument(res).toJson();
+        return resp;
+    });
+}
+
+////////////////////////////////////////////////////////
+
+void SshKeyCheckerTest::test_bounded_parallelism() {
+    static const int count = 12;
+    QStringList keys = {"shared", "key_env3", "other"};
+    QElapsedTimer et;
+    et.start();
+    auto res = run_check(m_checker, keys, environments(count));
+    qint64 elapsed = et.elapsed();
+
+    QCOMPARE(res.size(), (size_t)count);
+    QCOMPARE(m_server->requests_count(), count); // one request per environment
+    QVERIFY(m_server->max_concurrent() > 1);
+    QVERIFY(m_server->max_concurrent() <= CSshKeyChecker::DEFAULT_MAX_PARALLEL);
+    // serial checks would take count * delay
+    QVERIFY(elapsed < count * REQUEST_DELAY_MS);
+    qDebug() << "Checked" << count << "environments in" << elapsed << "ms";
+
+    std::vector<uint8_t> env3 = {1, 1, 0};
+    std::vector<uint8_t> env5 = {1, 0, 0};
+    QVERIFY(res["env3"] == env3);
+    QVERIFY(res["env5"] == env5);
+}
+
+////////////////////////////////////////////////////////
+
+void SshKeyCheckerTest::test_cached_results() {
+    QStringList keys = {"shared", "key_env1"};
+    auto first = run_check(m_checker, keys, environments(5));
+    QCOMPARE(m_server->requests_count(), 5);
+
+    auto second = run_check(m_checker, keys, environments(5));
+    QCOMPARE(m_server->requests_count(), 5);
+    QVERIFY(first == second);
+}
+
+////////////////////////////////////////////////////////
+
+void SshKeyCheckerTest::test_new_key() {
+    run_check(m_checker, QStringList({"shared"}), environments(4));
+    QCOMPARE(m_server->requests_count(), 4);
+    m_requested_keys.clear();
+
+    auto res = run_check(m_checker, QStringList({"shared", "key_env2"}), environments(4));
+    QCOMPARE(m_server->requests_count(), 8);
+    // only new key is sent
+    QCOMPARE(m_requested_keys.size(), 4);
+    QCOMPARE(m_requested_keys.toSet(), QSet<QString>({"key_env2"}));
+    std::vector<uint8_t> env2 = {1, 1};
+    QVERIFY(res["env2"] == env2);
+}
+
+////////////////////////////////////////////////////////
+
+void SshKeyCheckerTest::test_changed_environment() {
+    QStringList keys = {"shared", "key_env0"};
+    std::vector<CSshKeyChecker::env_t> envs = environments(6);
+    run_check(m_checker, keys, envs);
+    QCOMPARE(m_server->requests_count(), 6);
+
+    envs[0].revision = "r2";
+    run_check(m_checker, keys, envs);
+    QCOMPARE(m_server->requests_count(), 7);
+}
+
+////////////////////////////////////////////////////////
+
+void SshKeyCheckerTest::test_invalidate() {
+    QStringList keys = {"shared", "key_env0"};
+    run_check(m_checker, keys, environments(3));
+    QCOMPARE(m_server->requests_count(), 3);
+
+    m_checker->invalidate_environment("env1");
+    run_check(m_checker, keys, environments(3));
+    QCOMPARE(m_server->requests_count(), 4);
+
+    m_requested_keys.clear();
+    m_checker->invalidate_key("key_env0");
+    run_check(m_checker, keys, environments(3));
+    QCOMPARE(m_server->requests_count(), 7);
+    QCOMPARE(m_requested_keys.toSet(), QSet<QString>({"key_env0"}));
+}
+
+////////////////////////////////////////////////////////
+
+void SshKeyCheckerTest::test_failed_check_not_cached() {
+    QStringList keys = {"shared"};
+    m_failing_envs << "env1";
+    auto res = run_check(m_checker, keys, environments(3));
+    QCOMPARE(res.size(), (size_t)2);
+    QVERIFY(res.find("env1") == res.end());
+
+    m_failing_envs.clear();
+    res = run_check(m_checker, keys, environments(3));
+    QCOMPARE(res.size(), (size_t)3);
+    QCOMPARE(m_server->requests_count(), 4);
+}
+
+////////////////////////////////////////////////////////
+
+void SshKeyCheckerTest::test_expired_results() {
+    QStringList keys = {"shared", "key_env0"};
+    m_checker->set_ttl(300);
+    run_check(m_checker, keys, environments(2));
+    QCOMPARE(m_server->requests_count(), 2);
+    run_check(m_checker, keys, environments(2));
+    QCOMPARE(m_server->requests_count(), 2);
+
+    // keys were removed in web UI, environment is the same
+    QTest::qWait(400);
+    m_server->set_handler([](const FakeHubServer::request_t& req) -> FakeHubServer::response_t {
+        QJsonArray res;
+        QJsonArray keys = QJsonDocument::fromJson(req.body).object()["sshKeys"].toArray();
+        for (int i = 0; i < keys.size(); ++i)
+            res.push_back(false);
+        FakeHubServer::response_t resp;
+        resp.body = QJsonDocument(res).toJson();
+        return resp;
+    });
+    auto res = run_check(m_checker, keys, environments(2));
+    QCOMPARE(m_server->requests_count(), 4);
+    std::vector<uint8_t> none = {0, 0};
+    QVERIFY(res["env0"] == none);
+}
+
+////////////////////////////////////////////////////////
+
+void SshKeyCheckerTest::cleanupTestCase() {
+    delete m_pipeline;
+    delete m_checker;
+    delete m_nam;
+    delete m_server;
+}
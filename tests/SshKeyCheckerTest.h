@@ -0,0 +1,37 @@
+#ifndef SSHKEYCHECKERTEST_H
+#define SSHKEYCHECKERTEST_H
+
+#include <QObject>
+#include <QSet>
+#include <QStringList>
+
+class FakeHubServer;
+class QNetworkAccessManager;
+class CRestPipeline;
+class CSshKeyChecker;
+
+class SshKeyCheckerTest : public QObject
+{
+    Q_OBJECT
+private:
+    FakeHubServer* m_server;
+    QNetworkAccessManager* m_nam;
+    CRestPipeline* m_pipeline;
+    CSshKeyChecker* m_checker;
+    QSet<QString> m_failing_envs;
+    QStringList m_requested_keys;
+
+private slots:
+    void initTestCase();
+    void init();
+    void test_bounded_parallelism();
+    void test_cached_results();
+    void test_new_key();
+    void test_changed_environment();
+    void test_invalidate();
+    void test_failed_check_not_cached();
+    void test_expired_results();
+    void cleanupTestCase();
+};
+
+#endif // SSHKEYCHECKERTEST_H
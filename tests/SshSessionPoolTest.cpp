@@ -0,0 +1,223 @@
+#include "SshSessionPoolTest.h"
+#include "LibsshController.h"
+#include "LocalSshServer.h"
+#include "SshSessionPool.h"
+#include <QElapsedTimer>
+#include <QFuture>
+#include <QTest>
+#include <QThreadPool>
+#include <QtConcurrent/QtConcurrent>
+
+static const int COMMANDS_COUNT = 20;
+
+int SshSessionPoolTest::run(const QString &cmd, const QString &host, std::vector<std::string> *out) {
+    ssh_endpoint_t endpoint = m_server->endpoint();
+    std::vector<std::string> lst_out;
+    int rc = CLibsshController::run_ssh_command_key_auth(
+                 (host.isEmpty() ? endpoint.host : host).toUtf8().constData(),
+                 endpoint.port,
+                 endpoint.user.toUtf8().constData(),
+                 endpoint.private_key.toLocal8Bit().constData(),
+                 "",
+                 cmd.toUtf8().constData(),
+                 10, lst_out);
+    if (out) *out = lst_out;
+    return rc;
+}
+
+qint64 SshSessionPoolTest::run_concurrently(const QStringList &cmds, const QStringList &hosts) {
+    QThreadPool threads;
+    threads.setMaxThreadCount(cmds.size());
+    QList<QFuture<int> > results;
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < cmds.size(); ++i) {
+        QString cmd = cmds[i];
+        QString host = hosts.value(i);
+        results.push_back(QtConcurrent::run(&threads, [this, cmd, host]() {
+            return run(cmd, host);
+        }));
+    }
+    for (QFuture<int>& res : results)
+        if (res.result() != 0) return -1;
+    return timer.elapsed();
+}
+
+////////////////////////////////////////////////////////
+
+void SshSessionPoolTest::initTestCase() {
+#ifdef RT_OS_WINDOWS
+    QSKIP("sshd of system is needed");
+#endif
+    m_server = new LocalSshServer;
+    if (!m_server->start())
+        QSKIP(qPrintable(m_server->error()));
+}
+
+////////////////////////////////////////////////////////
+
+void SshSessionPoolTest::init() {
+    CSshSessionPool::set_max_sessions(CSshSessionPool::DEFAULT_MAX_SESSIONS);
+    CSshSessionPool::set_idle_timeout(CSshSessionPool::DEFAULT_IDLE_TIMEOUT_MS);
+    CSshSessionPool::close_sessions(m_server->endpoint().host);
+    CSshSessionPool::close_sessions("localhost");
+}
+
+////////////////////////////////////////////////////////
+
+void SshSessionPoolTest::test_output_and_exit_code() {
+    std::vector<std::string> out;
+    QCOMPARE(run("printf 'a\\nbb\\n\\nc'", QString(), &out), 0);
+    QCOMPARE(out, std::vector<std::string>({"a", "bb", "", "c"}));
+    QCOMPARE(run("echo done; exit 3", QString(), &out), 3);
+    QCOMPARE(out, std::vector<std::string>({"done"}));
+    QCOMPARE(run("true", QString(), &out), 0);
+    QVERIFY(out.empty());
+}
+
+////////////////////////////////////////////////////////
+
+void SshSessionPoolTest::test_quiet_command() {
+    CSshSession session(m_server->endpoint());
+    session.set_timeout(300);
+    QCOMPARE(session.open(10), (int)RLE_SUCCESS);
+    // updates print nothing for minutes, session timeout isn't for them
+    QByteArray out;
+    QCOMPARE(session.exec("sleep 1; echo done", out), 0);
+    QCOMPARE(out, QByteArray("done\n"));
+    // but caller may limit command
+    out.clear();
+    QVERIFY(session.exec("sleep 2; echo late", out, 300) != 0);
+}
+
+////////////////////////////////////////////////////////
+
+void SshSessionPoolTest::test_session_reused() {
+    int logins = m_server->logins_count();
+    for (int i = 0; i < COMMANDS_COUNT; ++i)
+        QCOMPARE(run(QString("exit %1").arg(i)), i);
+    QCOMPARE(m_server->logins_count(), logins + 1);
+    QCOMPARE(CSshSessionPool::sessions_count(), 1);
+    QCOMPARE(CSshSessionPool::idle_count(), 1);
+}
+
+////////////////////////////////////////////////////////
+
+void SshSessionPoolTest::test_parallel_commands() {
+    // they were serialized and took 4 seconds
+    qint64 elapsed = run_concurrently(QStringList() << "sleep 1" << "sleep 1" << "sleep 1" << "sleep 1");
+    QVERIFY(elapsed >= 0);
+    QVERIFY2(elapsed < 2500, qPrintable(QString::number(elapsed)));
+    QVERIFY(CSshSessionPool::sessions_count() <= CSshSessionPool::MAX_SESSIONS_PER_ENDPOINT);
+
+    // same sessions are used again
+    int logins = m_server->logins_count();
+    QVERIFY(run_concurrently(QStringList() << "true" << "true") >= 0);
+    QCOMPARE(m_server->logins_count(), logins);
+}
+
+////////////////////////////////////////////////////////
+
+void SshSessionPoolTest::test_hosts_dont_wait() {
+    QFuture<int> slow = QtConcurrent::run([this]() {
+        return run("sleep 2");
+    });
+    QTest::qWait(300);
+    QElapsedTimer timer;
+    timer.start();
+    QCOMPARE(run("true", "localhost"), 0);
+    QVERIFY(timer.elapsed() < 1500);
+    QCOMPARE(slow.result(), 0);
+}
+
+////////////////////////////////////////////////////////
+
+void SshSessionPoolTest::test_sessions_cap() {
+    CSshSessionPool::set_max_sessions(2);
+    QStringList cmds, hosts;
+    for (int i = 0; i < 6; ++i) {
+        cmds << "sleep 0.3";
+        hosts << (i % 2 ? "localhost" : QString());
+    }
+    // callers wait for free session instead of failing
+    QVERIFY(run_concurrently(cmds, hosts) >= 0);
+    QVERIFY(CSshSessionPool::sessions_count() <= 2);
+
+    // idle session of other host gives place to new one
+    CSshSessionPool::set_max_sessions(1);
+    CSshSessionPool::evict_idle();
+    QCOMPARE(run("true"), 0);
+    QCOMPARE(run("true", "localhost"), 0);
+    QCOMPARE(CSshSessionPool::sessions_count(), 1);
+}
+
+////////////////////////////////////////////////////////
+
+void SshSessionPoolTest::test_idle_eviction() {
+    QCOMPARE(run("true"), 0);
+    QCOMPARE(CSshSessionPool::sessions_count(), 1);
+    CSshSessionPool::set_idle_timeout(100);
+    QTest::qWait(200);
+    CSshSessionPool::evict_idle();
+    QCOMPARE(CSshSessionPool::sessions_count(), 0);
+
+    int logins = m_server->logins_count();
+    QCOMPARE(run("true"), 0);
+    QCOMPARE(m_server->logins_count(), logins + 1);
+}
+
+////////////////////////////////////////////////////////
+
+void SshSessionPoolTest::test_failed_login_not_kept() {
+    ssh_endpoint_t endpoint = m_server->endpoint();
+    endpoint.private_key += ".missing";
+    std::vector<std::string> out;
+    QCOMPARE(CLibsshController::run_ssh_command(endpoint, "true", 10, out), (int)RLE_SSH_AUTHENTICATION);
+    QCOMPARE(CSshSessionPool::sessions_count(), 0);
+
+    endpoint.port = 1;
+    QVERIFY(CLibsshController::run_ssh_command(endpoint, "true", 10, out) != 0);
+    QCOMPARE(CSshSessionPool::sessions_count(), 0);
+}
+
+////////////////////////////////////////////////////////
+
+void SshSessionPoolTest::benchmark_commands_data() {
+    QTest::addColumn<bool>("concurrent");
+    QTest::addColumn<bool>("pooled");
+    QTest::newRow("sequential, new session per command") << false << false;
+    QTest::newRow("sequential, pooled") << false << true;
+    QTest::newRow("concurrent, new session per command") << true << false;
+    QTest::newRow("concurrent, pooled") << true << true;
+}
+
+void SshSessionPoolTest::benchmark_commands() {
+    QFETCH(bool, concurrent);
+    QFETCH(bool, pooled);
+    // session idle for 0 ms is closed, like before pool
+    if (!pooled) CSshSessionPool::set_idle_timeout(0);
+
+    QStringList cmds;
+    for (int i = 0; i < COMMANDS_COUNT; ++i)
+        cmds << "echo ok";
+    QBENCHMARK {
+        if (concurrent) {
+            QVERIFY(run_concurrently(cmds) >= 0);
+        } else {
+            for (const QString& cmd : cmds)
+                QCOMPARE(run(cmd), 0);
+        }
+    }
+}
+
+////////////////////////////////////////////////////////
+
+void SshSessionPoolTest::cleanupTestCase() {
+    if (m_server) {
+        CSshSessionPool::close_sessions(m_server->endpoint().host);
+        CSshSessionPool::close_sessions("localhost");
+    }
+    CSshSessionPool::set_max_sessions(CSshSessionPool::DEFAULT_MAX_SESSIONS);
+    CSshSessionPool::set_idle_timeout(CSshSessionPool::DEFAULT_IDLE_TIMEOUT_MS);
+    delete m_server;
+}
@@ -0,0 +1,39 @@
+#ifndef SSHSESSIONPOOLTEST_H
+#define SSHSESSIONPOOLTEST_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <string>
+#include <vector>
+
+class LocalSshServer;
+
+class SshSessionPoolTest : public QObject
+{
+    Q_OBJECT
+private:
+    LocalSshServer* m_server = nullptr;
+
+    int run(const QString& cmd, const QString& host = QString(),
+            std::vector<std::string>* out = nullptr);
+    /* runs commands in count threads, returns elapsed ms */
+    qint64 run_concurrently(const QStringList& cmds, const QStringList& hosts = QStringList());
+
+private slots:
+    void initTestCase();
+    void init();
+    void test_output_and_exit_code();
+    void test_quiet_command();
+    void test_session_reused();
+    void test_parallel_commands();
+    void test_hosts_dont_wait();
+    void test_sessions_cap();
+    void test_idle_eviction();
+    void test_failed_login_not_kept();
+    void benchmark_commands_data();
+    void benchmark_commands();
+    void cleanupTestCase();
+};
+
+#endif // SSHSESSIONPOOLTEST_H
@@ -0,0 +1,454 @@
+#include "SwarmReconcilerTest.h"
+#include "SwarmReconciler.h"
+#include <QDir>
+#include <QFile>
+#include <QTemporaryDir>
+#include <QTest>
+
+static QJsonObject container_json(int env, int cont) {
+    QJsonObject obj;
+    obj["container_name"] = QString("cont_%1_%2").arg(env).arg(cont);
+    obj["container_ip"] = QString("172.16.%1.%2").arg(env % 250).arg(cont % 250);
+    obj["container_id"] = QString("cont_id_%1_%2").arg(env).arg(cont);
+    obj["rh_ip"] = QString("10.%1.%2.1").arg(env % 250).arg(cont % 250);
+    obj["peer_id"] = QString("peer_%1").arg(env);
+    return obj;
+}
+
+static CEnvironment environment(int env, int containers,
+                                const QString& status = "HEALTHY") {
+    QJsonObject obj;
+    obj["environment_name"] = QString("env_%1").arg(env);
+    obj["environment_id"] = QString("env_id_%1").arg(env);
+    obj["environment_hash"] = QString("hash_%1").arg(env);
+    obj["environment_status"] = status;
+    QJsonArray arr;
+    for (int i = 0; i < containers; ++i)
+        arr.push_back(container_json(env, i));
+    obj["environment_containers"] = arr;
+    return CEnvironment(obj);
+}
+
+static std::vector<CEnvironment> environments(int count, int containers) {
+    std::vector<CEnvironment> res;
+    for (int i = 0; i < count; ++i)
+        res.push_back(environment(i, containers));
+    return res;
+}
+
+static QString hash(int env) {
+    return QString("hash_%1").arg(env);
+}
+
+static p2p_state_t running_state() {
+    p2p_state_t st;
+    st.installed = st.running = st.peers_known = true;
+    return st;
+}
+
+/* joined swarm of env with all its peers in `state` */
+static void add_swarm(p2p_state_t& st, const CEnvironment& env,
+                      const QString& peer_state = "connected") {
+    st.swarms.insert(env.hash());
+    for (auto i = env.containers().begin(); i != env.containers().end(); ++i)
+        st.peers[CP2PStateTracker::peer_key(env.hash(), i->rh_ip())] = peer_state;
+}
+
+static QStringList hashes(const std::vector<CEnvironment>& envs) {
+    QStringList res;
+    for (auto i = envs.begin(); i != envs.end(); ++i)
+        res << i->hash();
+    res.sort();
+    return res;
+}
+
+static QStringList sorted(QStringList lst) {
+    lst.sort();
+    return lst;
+}
+
+////////////////////////////////////////////////////////
+
+void SwarmReconcilerTest::test_first_reconcile() {
+    std::vector<CEnvironment> envs;
+    envs.push_back(environment(0, 2));
+    envs.push_back(environment(1, 2));
+    envs.push_back(environment(2, 2, "UNHEALTHY"));
+    p2p_state_t st = running_state();
+    add_swarm(st, envs[0]);
+    st.interfaces[hash(0)] = "vptp0";
+
+    CSwarmReconciler reconciler;
+    reconciler.set_environments(envs);
+    reconciler.set_p2p_state(st);
+    swarm_actions_t actions = reconciler.reconcile();
+
+    QCOMPARE(reconciler.evaluated_count(), 3);
+    QCOMPARE(hashes(actions.join), QStringList() << hash(1));
+    QCOMPARE(actions.join[0].base_interface_id(), 1);
+    QCOMPARE(hashes(actions.check), QStringList() << hash(0));
+    QCOMPARE(sorted(actions.connected), QStringList() << hash(0));
+    QCOMPARE(sorted(actions.disconnected), QStringList() << hash(1) << hash(2));
+    QVERIFY(actions.leave.isEmpty());
+    QVERIFY(actions.rh_local.empty());
+}
+
+////////////////////////////////////////////////////////
+
+void SwarmReconcilerTest::test_nothing_changed() {
+    CSwarmReconciler reconciler;
+    p2p_state_t st = running_state();
+    std::vector<CEnvironment> envs = environments(10, 3);
+    for (int i = 0; i < 5; ++i)
+        add_swarm(st, envs[i]);
+    reconciler.set_environments(envs);
+    reconciler.set_p2p_state(st);
+    QCOMPARE(reconciler.reconcile().join.size(), (size_t)5);
+
+    // hub gives new copies of the same environments every time
+    reconciler.set_environments(environments(10, 3));
+    reconciler.set_p2p_state(st);
+    QCOMPARE(reconciler.dirty_count(), 0);
+    QVERIFY(reconciler.reconcile().empty());
+    QCOMPARE(reconciler.evaluated_count(), 0);
+}
+
+////////////////////////////////////////////////////////
+
+void SwarmReconcilerTest::test_changed_environment_only() {
+    CSwarmReconciler reconciler;
+    p2p_state_t st = running_state();
+    std::vector<CEnvironment> envs = environments(50, 3);
+    for (auto i = envs.begin(); i != envs.end(); ++i)
+        add_swarm(st, *i);
+    reconciler.set_environments(envs);
+    reconciler.set_p2p_state(st);
+    QCOMPARE(reconciler.reconcile().check.size(), (size_t)50);
+
+    // container added to env_7
+    envs[7] = environment(7, 4);
+    add_swarm(st, envs[7]);
+    reconciler.set_environments(envs);
+    reconciler.set_p2p_state(st);
+    swarm_actions_t actions = reconciler.reconcile();
+    QCOMPARE(reconciler.evaluated_count(), 1);
+    QCOMPARE(hashes(actions.check), QStringList() << hash(7));
+    QVERIFY(actions.connected.isEmpty());
+    QVERIFY(actions.join.empty());
+
+    // env_8 removed from hub
+    envs.erase(envs.begin() + 8);
+    reconciler.set_environments(envs);
+    actions = reconciler.reconcile();
+    QCOMPARE(reconciler.evaluated_count(), 1);
+    QCOMPARE(actions.leave, QStringList() << hash(8));
+    QVERIFY(actions.check.empty());
+}
+
+////////////////////////////////////////////////////////
+
+void SwarmReconcilerTest::test_join_not_repeated() {
+    CSwarmReconciler reconciler;
+    std::vector<CEnvironment> envs = environments(1, 2);
+    p2p_state_t st = running_state();
+    reconciler.set_environments(envs);
+    reconciler.set_p2p_state(st);
+    QCOMPARE(hashes(reconciler.reconcile().join), QStringList() << hash(0));
+
+    // join is running
+    QVERIFY(reconciler.reconcile().empty());
+
+    reconciler.join_finished(hash(0), false);
+    QCOMPARE(reconciler.interface_id(hash(0)), -1);
+    swarm_actions_t actions = reconciler.reconcile();
+    QCOMPARE(hashes(actions.join), QStringList() << hash(0));
+    QCOMPARE(actions.join[0].base_interface_id(), 0);
+
+    reconciler.join_finished(hash(0), true);
+    add_swarm(st, envs[0]);
+    st.interfaces[hash(0)] = "vptp0";
+    reconciler.set_p2p_state(st);
+    actions = reconciler.reconcile();
+    QVERIFY(actions.join.empty());
+    QCOMPARE(actions.connected, QStringList() << hash(0));
+    QCOMPARE(hashes(actions.check), QStringList() << hash(0));
+    QCOMPARE(reconciler.interface_id(hash(0)), 0);
+}
+
+////////////////////////////////////////////////////////
+
+void SwarmReconcilerTest::test_leave_removed_swarm() {
+    CSwarmReconciler reconciler;
+    p2p_state_t st = running_state();
+    st.swarms.insert(hash(9));
+    reconciler.set_environments(std::vector<CEnvironment>());
+    reconciler.set_p2p_state(st);
+    QCOMPARE(reconciler.reconcile().leave, QStringList() << hash(9));
+    // leave is running
+    QVERIFY(reconciler.reconcile().empty());
+
+    // swarm is still there
+    reconciler.leave_finished(hash(9));
+    QCOMPARE(reconciler.reconcile().leave, QStringList() << hash(9));
+
+    reconciler.leave_finished(hash(9));
+    reconciler.set_p2p_state(running_state());
+    QVERIFY(reconciler.reconcile().empty());
+}
+
+////////////////////////////////////////////////////////
+
+void SwarmReconcilerTest::test_peers_changed() {
+    CSwarmReconciler reconciler;
+    std::vector<CEnvironment> envs = environments(3, 2);
+    p2p_state_t st = running_state();
+    for (auto i = envs.begin(); i != envs.end(); ++i)
+        add_swarm(st, *i);
+    reconciler.set_environments(envs);
+    reconciler.set_p2p_state(st);
+    QCOMPARE(reconciler.reconcile().check.size(), (size_t)3);
+    reconciler.set_p2p_state(st);
+    QVERIFY(reconciler.reconcile().empty());
+
+    st.peers[CP2PStateTracker::peer_key(hash(1), envs[1].containers()[0].rh_ip())] = "disconnected";
+    reconciler.set_p2p_state(st);
+    swarm_actions_t actions = reconciler.reconcile();
+    QCOMPARE(reconciler.evaluated_count(), 1);
+    QCOMPARE(hashes(actions.check), QStringList() << hash(1));
+}
+
+////////////////////////////////////////////////////////
+
+void SwarmReconcilerTest::test_unknown_peers_rechecked() {
+    CSwarmReconciler reconciler;
+    std::vector<CEnvironment> envs = environments(2, 2);
+    p2p_state_t st = running_state();
+    add_swarm(st, envs[0]);
+    st.swarms.insert(hash(1));  // peers of env_1 aren't reported
+    reconciler.set_environments(envs);
+    reconciler.set_p2p_state(st);
+    QCOMPARE(reconciler.reconcile().check.size(), (size_t)2);
+    for (int i = 0; i < 3; ++i) {
+        reconciler.set_p2p_state(st);
+        QCOMPARE(hashes(reconciler.reconcile().check), QStringList() << hash(1));
+    }
+
+    // REST of daemon isn't available, everything is checked by cli
+    st.peers_known = false;
+    st.peers.clear();
+    reconciler.set_p2p_state(st);
+    QCOMPARE(reconciler.reconcile().check.size(), (size_t)2);
+    reconciler.set_p2p_state(st);
+    QCOMPARE(reconciler.reconcile().check.size(), (size_t)2);
+
+    st = running_state();
+    add_swarm(st, envs[0]);
+    add_swarm(st, envs[1]);
+    reconciler.set_p2p_state(st);
+    QCOMPARE(reconciler.reconcile().check.size(), (size_t)2);
+    reconciler.set_p2p_state(st);
+    QVERIFY(reconciler.reconcile().empty());
+}
+
+////////////////////////////////////////////////////////
+
+void SwarmReconcilerTest::test_interface_ids() {
+    const int ids_count = 30;
+    CSwarmReconciler reconciler(ids_count);
+    std::vector<CEnvironment> envs = environments(ids_count + 2, 1);
+    p2p_state_t st = running_state();
+    add_swarm(st, envs[0]);
+    st.interfaces[hash(0)] = "vptp3";
+    reconciler.set_environments(envs);
+    reconciler.set_p2p_state(st);
+    swarm_actions_t actions = reconciler.reconcile();
+    QCOMPARE(reconciler.interface_id(hash(0)), 3);
+
+    // ids are unique, daemon's id isn't given to others, there are only 30 ids
+    QCOMPARE((int)actions.join.size(), ids_count + 1);
+    QSet<int> ids;
+    int without_id = 0;
+    for (auto i = actions.join.begin(); i != actions.join.end(); ++i) {
+        if (i->base_interface_id() == -1) {
+            ++without_id;
+            continue;
+        }
+        QVERIFY(i->base_interface_id() != 3);
+        ids.insert(i->base_interface_id());
+    }
+    QCOMPARE(without_id, 2);
+    QCOMPARE(ids.size(), ids_count - 1);
+
+    // failed join gives id back
+    QString failed = actions.join[0].base_interface_id() == -1 ?
+                actions.join[1].hash() : actions.join[0].hash();
+    int id = reconciler.interface_id(failed);
+    reconciler.join_finished(failed, false);
+    QCOMPARE(reconciler.interface_id(failed), -1);
+    QString waiting;
+    for (auto i = actions.join.begin(); i != actions.join.end(); ++i)
+        if (i->base_interface_id() == -1) waiting = i->hash();
+    reconciler.join_finished(waiting, false);
+    actions = reconciler.reconcile();
+    QCOMPARE(actions.join.size(), (size_t)2);
+    QVERIFY(actions.join[0].base_interface_id() == id || actions.join[1].base_interface_id() == id);
+}
+
+////////////////////////////////////////////////////////
+
+void SwarmReconcilerTest::test_p2p_down() {
+    CSwarmReconciler reconciler;
+    std::vector<CEnvironment> envs = environments(2, 1);
+    p2p_state_t st = running_state();
+    add_swarm(st, envs[0]);
+    reconciler.set_environments(envs);
+    reconciler.set_p2p_state(st);
+    QCOMPARE(reconciler.reconcile().join.size(), (size_t)1);
+
+    reconciler.set_p2p_state(p2p_state_t());
+    QVERIFY(reconciler.reconcile().empty());
+    QCOMPARE(reconciler.evaluated_count(), 0);
+
+    // everything is evaluated again, join which was running is forgotten
+    reconciler.set_p2p_state(st);
+    swarm_actions_t actions = reconciler.reconcile();
+    QCOMPARE(reconciler.evaluated_count(), 2);
+    QCOMPARE(actions.connected, QStringList() << hash(0));
+    QCOMPARE(actions.disconnected, QStringList() << hash(1));
+    QCOMPARE(hashes(actions.check), QStringList() << hash(0));
+    QCOMPARE(hashes(actions.join), QStringList() << hash(1));
+}
+
+////////////////////////////////////////////////////////
+
+void SwarmReconcilerTest::test_local_containers() {
+    CSwarmReconciler reconciler;
+    reconciler.set_environments(environments(2, 2));
+    reconciler.set_local_containers(QStringList() << "cont_0_1.local");
+    swarm_actions_t actions = reconciler.reconcile();
+    QCOMPARE(actions.rh_local.size(), (size_t)2);
+    QCOMPARE(actions.rh_local["peer_0"], true);
+    QCOMPARE(actions.rh_local["peer_1"], false);
+    QVERIFY(actions.join.empty());
+
+    reconciler.set_local_containers(QStringList() << "cont_0_1.local");
+    QVERIFY(reconciler.reconcile().empty());
+
+    // table isn't touched without local containers
+    reconciler.set_local_containers(QStringList());
+    QVERIFY(reconciler.reconcile().empty());
+
+    reconciler.set_local_containers(QStringList() << "cont_1_0.local");
+    actions = reconciler.reconcile();
+    QCOMPARE(actions.rh_local.size(), (size_t)2);
+    QCOMPARE(actions.rh_local["peer_0"], false);
+    QCOMPARE(actions.rh_local["peer_1"], true);
+
+    // new environment on local peer
+    std::vector<CEnvironment> envs = environments(3, 2);
+    reconciler.set_environments(envs);
+    actions = reconciler.reconcile();
+    QCOMPARE(actions.rh_local.size(), (size_t)1);
+    QCOMPARE(actions.rh_local["peer_2"], false);
+}
+
+////////////////////////////////////////////////////////
+
+void SwarmReconcilerTest::test_read_local_containers() {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    auto write_hostname = [&dir](const QString& cont, const QByteArray& name) {
+        QString etc = dir.path() + "/" + cont + "/rootfs/etc";
+        QDir().mkpath(etc);
+        QFile file(etc + "/hostname");
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) return false;
+        file.write(name);
+        return true;
+    };
+    QVERIFY(write_hostname("a", "alpha\n"));
+    QVERIFY(write_hostname("b", "beta\n"));
+    QDir().mkpath(dir.path() + "/c/rootfs");
+
+    CSwarmReconciler reconciler;
+    QCOMPARE(sorted(reconciler.read_local_containers(dir.path())),
+             QStringList() << "alpha" << "beta");
+
+    QVERIFY(write_hostname("a", "gamma.local\n"));
+    QVERIFY(QDir(dir.path() + "/b").removeRecursively());
+    QCOMPARE(reconciler.read_local_containers(dir.path()), QStringList() << "gamma.local");
+    QVERIFY(reconciler.read_local_containers(dir.path() + "/none").isEmpty());
+}
+
+////////////////////////////////////////////////////////
+
+void SwarmReconcilerTest::benchmark_reconcile_data() {
+    QTest::addColumn<int>("envs");
+    QTest::addColumn<int>("containers");
+    QTest::addColumn<int>("local");
+    QTest::newRow("100 envs x 5 containers, 50 local") << 100 << 5 << 50;
+    QTest::newRow("500 envs x 5 containers, 200 local") << 500 << 5 << 200;
+    QTest::newRow("1000 envs x 3 containers, 500 local") << 1000 << 3 << 500;
+}
+
+void SwarmReconcilerTest::benchmark_reconcile() {
+    QFETCH(int, envs);
+    QFETCH(int, containers);
+    QFETCH(int, local);
+    std::vector<CEnvironment> lst = environments(envs, containers);
+    p2p_state_t st = running_state();
+    for (auto i = lst.begin(); i != lst.end(); ++i)
+        add_swarm(st, *i);
+    QStringList local_containers;
+    for (int i = 0; i < local; ++i)
+        local_containers << QString("lxc_%1").arg(i);
+
+    CSwarmReconciler reconciler;
+    reconciler.set_environments(lst);
+    reconciler.set_p2p_state(st);
+    reconciler.set_local_containers(local_containers);
+    QCOMPARE((int)reconciler.reconcile().check.size(), envs);
+
+    // steady tick, hub and daemon report the same
+    QBENCHMARK {
+        reconciler.set_environments(lst);
+        reconciler.set_p2p_state(st);
+        reconciler.set_local_containers(local_containers);
+        QVERIFY(reconciler.reconcile().empty());
+    }
+}
+
+////////////////////////////////////////////////////////
+
+void SwarmReconcilerTest::benchmark_full_rebuild_data() {
+    benchmark_reconcile_data();
+}
+
+void SwarmReconcilerTest::benchmark_full_rebuild() {
+    QFETCH(int, envs);
+    QFETCH(int, containers);
+    QFETCH(int, local);
+    std::vector<CEnvironment> lst = environments(envs, containers);
+    p2p_state_t st = running_state();
+    for (auto i = lst.begin(); i != lst.end(); ++i)
+        add_swarm(st, *i);
+    QStringList local_containers;
+    for (int i = 0; i < local; ++i)
+        local_containers << QString("lxc_%1").arg(i);
+
+    // tick of P2PConnector before reconciler, kept as reference
+    QBENCHMARK {
+        std::map<QString, bool> rh_local_tbl;
+        for (auto env = lst.begin(); env != lst.end(); ++env) {
+            for (auto cont = env->containers().begin(); cont != env->containers().end(); ++cont) {
+                bool found = false;
+                for (auto l = local_containers.begin(); l != local_containers.end() && !found; ++l)
+                    found = l->contains(cont->name());
+                rh_local_tbl[cont->peer_id()] = found;
+            }
+        }
+        std::vector<CEnvironment> check;
+        for (auto env = lst.begin(); env != lst.end(); ++env)
+            if (st.swarms.contains(env->hash())) check.push_back(*env);
+        QCOMPARE((int)check.size(), envs);
+    }
+}
@@ -0,0 +1,27 @@
+#ifndef SWARMRECONCILERTEST_H
+#define SWARMRECONCILERTEST_H
+
+#include <QObject>
+
+class SwarmReconcilerTest : public QObject
+{
+    Q_OBJECT
+private slots:
+    void test_first_reconcile();
+    void test_nothing_changed();
+    void test_changed_environment_only();
+    void test_join_not_repeated();
+    void test_leave_removed_swarm();
+    void test_peers_changed();
+    void test_unknown_peers_rechecked();
+    void test_interface_ids();
+    void test_p2p_down();
+    void test_local_containers();
+    void test_read_local_containers();
+    void benchmark_reconcile_data();
+    void benchmark_reconcile();
+    void benchmark_full_rebuild_data();
+    void benchmark_full_rebuild();
+};
+
+#endif // SWARMRECONCILERTEST_H
@@ -11,6 +11,32 @@
 #include "RhControllerTest.h"
 #include "DownloadFileManagerTest.h"
 #include "RestWorkerTest.h"
+#include "RestPipelineTest.h"
+#include "RestResponseCacheTest.h"
+#include "RestCoalescerTest.h"
+#include "RestContainersTest.h"
+#include "RestJsonParserTest.h"
+#include "RestRetrierTest.h"
+#include "SshKeyCheckerTest.h"
+#include "BoundedTaskRunnerTest.h"
+#include "ProcessRunnerTest.h"
+#include "PathResolverTest.h"
+#include "P2PStateTrackerTest.h"
+#include "VagrantStatusCacheTest.h"
+#include "VagrantMetadataTest.h"
+#include "PeerStatusPipelineTest.h"
+#include "PeerCommandWatcherTest.h"
+#include "PeerCommandExecutorTest.h"
+#include "SwarmReconcilerTest.h"
+#include "ReachabilityCheckerTest.h"
+#include "InterfaceIdAllocatorTest.h"
+#include "SftpTransferTest.h"
+#include "ChunkedTransferTest.h"
+#include "RollingChecksumTest.h"
+#include "TransferSchedulerTest.h"
+#include "SftpBrowserTest.h"
+#include "DeltaUploadTest.h"
+#include "SshSessionPoolTest.h"
 
 Tester::Tester () {
   /* add all tests here */
@@ -24,6 +50,32 @@ Tester::Tester () {
   addTest(new RhControllerTest);
   addTest(new DownloadFileManagerTest);
   addTest(new RestWorkerTest);
+  addTest(new RestPipelineTest);
+  addTest(new RestResponseCacheTest);
+  addTest(new RestCoalescerTest);
+  addTest(new RestContainersTest);
+  addTest(new RestJsonParserTest);
+  addTest(new RestRetrierTest);
+  addTest(new SshKeyCheckerTest);
+  addTest(new BoundedTaskRunnerTest);
+  addTest(new ProcessRunnerTest);
+  addTest(new PathResolverTest);
+  addTest(new P2PStateTrackerTest);
+  addTest(new VagrantStatusCacheTest);
+  addTest(new VagrantMetadataTest);
+  addTest(new PeerStatusPipelineTest);
+  addTest(new PeerCommandWatcherTest);
+  addTest(new PeerCommandExecutorTest);
+  addTest(new SwarmReconcilerTest);
+  addTest(new ReachabilityCheckerTest);
+  addTest(new InterfaceIdAllocatorTest);
+  addTest(new SftpTransferTest);
+  addTest(new ChunkedTransferTest);
+  addTest(new RollingChecksumTest);
+  addTest(new TransferSchedulerTest);
+  addTest(new SftpBrowserTest);
+  addTest(new DeltaUploadTest);
+  addTest(new SshSessionPoolTest);
 }
 
 Tester* Tester::Instance() {
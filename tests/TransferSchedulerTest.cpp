@@ -0,0 +1,381 @@
+#include "TransferSchedulerTest.h"
+#include "TransferScheduler.h"
+#include "LocalSshServer.h"
+#include "SftpTransfer.h"
+#include <QAtomicInt>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QPointer>
+#include <QSemaphore>
+#include <QSet>
+#include <QSignalSpy>
+#include <QTest>
+#include <QThread>
+#include <QtConcurrent/QtConcurrent>
+
+static const int JOB_DELAY_MS = 50;
+static const quint64 BIG_FILE = CTransferScheduler::SMALL_FILE_SIZE * 10;
+
+/* jobs write their names here in order they are started */
+struct start_log_t {
+    QMutex mutex;
+    QStringList names;
+    QAtomicInt running;
+    QAtomicInt max_running;
+    start_log_t() : running(0), max_running(0) {}
+
+    void started(const QString& name) {
+        QMutexLocker locker(&mutex);
+        names << name;
+        int now = running.fetchAndAddOrdered(1) + 1;
+        if (now > max_running.load()) max_running.store(now);
+    }
+    void finished() { running.fetchAndAddOrdered(-1); }
+    QStringList list() {
+        QMutexLocker locker(&mutex);
+        return names;
+    }
+};
+
+static CTransferScheduler::job_t sleeping_job(start_log_t* log, const QString& name,
+                                              int delay_ms = JOB_DELAY_MS) {
+    return [log, name, delay_ms](CTransferScheduler::progress_t, const QAtomicInt*) {
+        log->started(name);
+        QThread::msleep(delay_ms);
+        log->finished();
+        return std::make_pair(SCWE_SUCCESS, QStringList() << name);
+    };
+}
+
+/* occupies worker until released, so next jobs are queued together */
+static CTransferScheduler::job_t gate_job(QSemaphore* gate) {
+    return [gate](CTransferScheduler::progress_t, const QAtomicInt*) {
+        gate->acquire();
+        return std::make_pair(SCWE_SUCCESS, QStringList());
+    };
+}
+
+////////////////////////////////////////////////////////
+
+void TransferSchedulerTest::test_concurrency_cap() {
+    static const int count = 12;
+    static const int workers = 3;
+    start_log_t log;
+    CTransferScheduler scheduler(workers, count);
+    QSignalSpy finished(&scheduler, &CTransferScheduler::job_finished);
+    for (int i = 0; i < count; ++i)
+        scheduler.enqueue(QString("container %1").arg(i % 4), BIG_FILE,
+                          CTransferScheduler::TP_NORMAL, sleeping_job(&log, QString::number(i)));
+    QCOMPARE(scheduler.running_count(), workers);
+    QCOMPARE(scheduler.queued_count(), count - workers);
+
+    QTRY_COMPARE_WITH_TIMEOUT(finished.count(), count, 10000);
+    QCOMPARE(log.max_running.load(), workers);
+    QCOMPARE(scheduler.running_count(), 0);
+    QCOMPARE(scheduler.queued_count(), 0);
+    for (const QList<QVariant>& args : finished)
+        QCOMPARE(args.at(1).toInt(), (int)SCWE_SUCCESS);
+}
+
+////////////////////////////////////////////////////////
+
+void TransferSchedulerTest::test_groups_take_turns() {
+    start_log_t log;
+    QSemaphore gate;
+    CTransferScheduler scheduler(1);
+    QSignalSpy finished(&scheduler, &CTransferScheduler::job_finished);
+    scheduler.enqueue("gate", BIG_FILE, CTransferScheduler::TP_NORMAL, gate_job(&gate));
+    // container "a" has many files, "b" and "c" are added later
+    for (int i = 1; i <= 4; ++i)
+        scheduler.enqueue("a", BIG_FILE, CTransferScheduler::TP_NORMAL,
+                          sleeping_job(&log, QString("a%1").arg(i), 0));
+    for (int i = 1; i <= 2; ++i)
+        scheduler.enqueue("b", BIG_FILE, CTransferScheduler::TP_NORMAL,
+                          sleeping_job(&log, QString("b%1").arg(i), 0));
+    scheduler.enqueue("c", BIG_FILE, CTransferScheduler::TP_NORMAL,
+                      sleeping_job(&log, "c1", 0));
+    gate.release();
+
+    QTRY_COMPARE_WITH_TIMEOUT(finished.count(), 8, 10000);
+    QCOMPARE(log.list(), QStringList() << "a1" << "b1" << "c1" << "a2" << "b2" << "a3" << "a4");
+}
+
+////////////////////////////////////////////////////////
+
+void TransferSchedulerTest::test_priority() {
+    start_log_t log;
+    QSemaphore gate;
+    CTransferScheduler scheduler(1);
+    QSignalSpy finished(&scheduler, &CTransferScheduler::job_finished);
+    scheduler.enqueue("gate", BIG_FILE, CTransferScheduler::TP_NORMAL, gate_job(&gate));
+    scheduler.enqueue("a", BIG_FILE, CTransferScheduler::TP_LOW, sleeping_job(&log, "a low", 0));
+    scheduler.enqueue("a", BIG_FILE, CTransferScheduler::TP_NORMAL, sleeping_job(&log, "a normal", 0));
+    scheduler.enqueue("b", BIG_FILE, CTransferScheduler::TP_NORMAL, sleeping_job(&log, "b normal", 0));
+    scheduler.enqueue("b", BIG_FILE, CTransferScheduler::TP_HIGH, sleeping_job(&log, "b high", 0));
+    scheduler.enqueue("a", BIG_FILE, CTransferScheduler::TP_HIGH, sleeping_job(&log, "a high", 0));
+    gate.release();
+
+    QTRY_COMPARE_WITH_TIMEOUT(finished.count(), 6, 10000);
+    // the same priority keeps turns of containers
+    QCOMPARE(log.list(), QStringList() << "a high" << "b high"
+                                       << "a normal" << "b normal" << "a low");
+}
+
+////////////////////////////////////////////////////////
+
+void TransferSchedulerTest::test_set_priority() {
+    start_log_t log;
+    QSemaphore gate;
+    CTransferScheduler scheduler(1);
+    QSignalSpy finished(&scheduler, &CTransferScheduler::job_finished);
+    CTransferScheduler::job_id_t gate_id =
+        scheduler.enqueue("gate", BIG_FILE, CTransferScheduler::TP_NORMAL, gate_job(&gate));
+    CTransferScheduler::job_id_t ids[3];
+    for (int i = 0; i < 3; ++i)
+        ids[i] = scheduler.enqueue("a", BIG_FILE, CTransferScheduler::TP_NORMAL,
+                                   sleeping_job(&log, QString::number(i), 0));
+    // user selected the last file and started it again
+    QVERIFY(scheduler.set_priority(ids[2], CTransferScheduler::TP_HIGH));
+    QVERIFY(scheduler.set_priority(ids[0], CTransferScheduler::TP_LOW));
+    QVERIFY(!scheduler.set_priority(gate_id, CTransferScheduler::TP_HIGH));
+    gate.release();
+
+    QTRY_COMPARE_WITH_TIMEOUT(finished.count(), 4, 10000);
+    QCOMPARE(log.list(), QStringList() << "2" << "1" << "0");
+    QVERIFY(!scheduler.set_priority(ids[1], CTransferScheduler::TP_HIGH));
+}
+
+////////////////////////////////////////////////////////
+
+void TransferSchedulerTest::test_small_files_batched() {
+    static const int count = 10;
+    start_log_t log;
+    QSemaphore gate;
+    CTransferScheduler scheduler(2, 2);
+    QSignalSpy finished(&scheduler, &CTransferScheduler::job_finished);
+    scheduler.enqueue("gate", BIG_FILE, CTransferScheduler::TP_NORMAL, gate_job(&gate));
+    scheduler.enqueue("gate", BIG_FILE, CTransferScheduler::TP_NORMAL, gate_job(&gate));
+
+    // big file of the same container isn't put into batch
+    scheduler.enqueue("a", BIG_FILE, CTransferScheduler::TP_NORMAL,
+                      sleeping_job(&log, "big", 10));
+    QMutex mutex;
+    QSet<QThread*> threads;
+    for (int i = 0; i < count; ++i) {
+        scheduler.enqueue("a", 1024, CTransferScheduler::TP_NORMAL,
+                          [&, i](CTransferScheduler::progress_t, const QAtomicInt*) {
+            {
+                QMutexLocker locker(&mutex);
+                threads << QThread::currentThread();
+            }
+            return sleeping_job(&log, QString::number(i), 10)(nullptr, nullptr);
+        });
+    }
+    gate.release(2);
+
+    QTRY_COMPARE_WITH_TIMEOUT(finished.count(), count + 3, 10000);
+    // other worker was free too, but small files went one after another in one of them
+    QCOMPARE(threads.size(), 1);
+    QCOMPARE(log.list().size(), count + 1);
+}
+
+////////////////////////////////////////////////////////
+
+void TransferSchedulerTest::test_cancel() {
+    start_log_t log;
+    QSemaphore gate;
+    CTransferScheduler scheduler(1);
+    QSignalSpy finished(&scheduler, &CTransferScheduler::job_finished);
+    CTransferScheduler::job_id_t gate_id =
+        scheduler.enqueue("gate", BIG_FILE, CTransferScheduler::TP_NORMAL, gate_job(&gate));
+    CTransferScheduler::job_id_t ids[4];
+    for (int i = 0; i < 4; ++i)
+        ids[i] = scheduler.enqueue("a", BIG_FILE, CTransferScheduler::TP_NORMAL,
+                                   sleeping_job(&log, QString::number(i), 0));
+
+    QVERIFY(!scheduler.cancel(gate_id));
+    QVERIFY(scheduler.cancel(ids[1]));
+    QVERIFY(!scheduler.cancel(ids[1]));
+    QCOMPARE(finished.count(), 1);
+    QCOMPARE(finished.last().at(0).toULongLong(), ids[1]);
+    QCOMPARE(finished.last().at(1).toInt(), (int)SCWE_CANCELLED);
+    QCOMPARE(scheduler.queued_count(), 3);
+    gate.release();
+
+    QTRY_COMPARE_WITH_TIMEOUT(finished.count(), 5, 10000);
+    QCOMPARE(log.list(), QStringList() << "0" << "2" << "3");
+
+    // everything waiting is dropped, running one completes
+    gate_id = scheduler.enqueue("gate", BIG_FILE, CTransferScheduler::TP_NORMAL, gate_job(&gate));
+    for (int i = 0; i < 4; ++i)
+        scheduler.enqueue("a", 10, CTransferScheduler::TP_NORMAL,
+                          sleeping_job(&log, "cancelled", 0));
+    QCOMPARE(scheduler.cancel_all(), 4);
+    gate.release();
+    QTRY_COMPARE_WITH_TIMEOUT(finished.count(), 10, 10000);
+    QVERIFY(!log.list().contains("cancelled"));
+    QCOMPARE(finished.last().at(0).toULongLong(), gate_id);
+    QCOMPARE(finished.last().at(1).toInt(), (int)SCWE_SUCCESS);
+}
+
+////////////////////////////////////////////////////////
+
+/* runs until cancel flag is set */
+static CTransferScheduler::job_t cancellable_job(QAtomicInt* started) {
+    return [started](CTransferScheduler::progress_t, const QAtomicInt* cancel) {
+        started->store(1);
+        while (!cancel->load())
+            QThread::msleep(5);
+        return std::make_pair(SCWE_CANCELLED, QStringList());
+    };
+}
+
+void TransferSchedulerTest::test_cancel_running() {
+    QAtomicInt started(0);
+    CTransferScheduler scheduler(1);
+    QSignalSpy finished(&scheduler, &CTransferScheduler::job_finished);
+    CTransferScheduler::job_id_t id =
+        scheduler.enqueue("a", BIG_FILE, CTransferScheduler::TP_NORMAL, cancellable_job(&started));
+    QTRY_VERIFY_WITH_TIMEOUT(started.load(), 5000);
+    QVERIFY(!scheduler.cancel(id));
+    QTRY_COMPARE_WITH_TIMEOUT(finished.count(), 1, 5000);
+    QCOMPARE(finished.last().at(1).toInt(), (int)SCWE_CANCELLED);
+
+    started.store(0);
+    scheduler.enqueue("a", BIG_FILE, CTransferScheduler::TP_NORMAL, cancellable_job(&started));
+    QTRY_VERIFY_WITH_TIMEOUT(started.load(), 5000);
+    QCOMPARE(scheduler.cancel_all(), 0);
+    QTRY_COMPARE_WITH_TIMEOUT(finished.count(), 2, 5000);
+    QCOMPARE(finished.last().at(1).toInt(), (int)SCWE_CANCELLED);
+}
+
+////////////////////////////////////////////////////////
+
+void TransferSchedulerTest::test_close() {
+    QAtomicInt started(0);
+    QObject owner;
+    QPointer<CTransferScheduler> scheduler = new CTransferScheduler(1, 1, &owner);
+    QSignalSpy finished(scheduler.data(), &CTransferScheduler::job_finished);
+    scheduler->enqueue("a", BIG_FILE, CTransferScheduler::TP_NORMAL, cancellable_job(&started));
+    scheduler->enqueue("a", BIG_FILE, CTransferScheduler::TP_NORMAL, cancellable_job(&started));
+    QTRY_VERIFY_WITH_TIMEOUT(started.load(), 5000);
+
+    // owner doesn't wait for running job
+    QElapsedTimer timer;
+    timer.start();
+    scheduler->close();
+    QVERIFY(timer.elapsed() < 1000);
+    QVERIFY(scheduler->parent() == nullptr);
+    QTRY_VERIFY_WITH_TIMEOUT(scheduler.isNull(), 5000);
+    QCOMPARE(finished.count(), 0);
+}
+
+////////////////////////////////////////////////////////
+
+void TransferSchedulerTest::test_progress_throttled() {
+    static const quint64 total = 1000;
+    CTransferScheduler scheduler(1);
+    QSignalSpy started(&scheduler, &CTransferScheduler::job_started);
+    QSignalSpy progress(&scheduler, &CTransferScheduler::job_progress);
+    QSignalSpy finished(&scheduler, &CTransferScheduler::job_finished);
+    CTransferScheduler::job_id_t id =
+        scheduler.enqueue("a", total, CTransferScheduler::TP_NORMAL,
+                          [](CTransferScheduler::progress_t progress, const QAtomicInt*) {
+        for (quint64 done = 1; done <= total; ++done) {
+            progress(done, total);
+            QThread::usleep(500);
+        }
+        return std::make_pair(SCWE_SUCCESS, QStringList());
+    });
+
+    QTRY_COMPARE_WITH_TIMEOUT(finished.count(), 1, 10000);
+    QCOMPARE(started.count(), 1);
+    QCOMPARE(started.first().at(0).toULongLong(), id);
+    // about 500 ms of work gives few reports, the last one is always sent
+    QVERIFY(progress.count() >= 2);
+    QVERIFY(progress.count() < 20);
+    QCOMPARE(progress.last().at(0).toULongLong(), id);
+    QCOMPARE(progress.last().at(1).toULongLong(), total);
+    QCOMPARE(progress.last().at(2).toULongLong(), total);
+    QVERIFY(progress.last().at(3).toULongLong() > 0);
+}
+
+////////////////////////////////////////////////////////
+
+void TransferSchedulerTest::benchmark_many_files_data() {
+    QTest::addColumn<bool>("thread_per_file");
+    QTest::newRow("scheduler") << false;
+    QTest::newRow("thread per file") << true;
+}
+
+void TransferSchedulerTest::benchmark_many_files() {
+#ifdef RT_OS_WINDOWS
+    QSKIP("sshd of system is needed");
+#endif
+    QFETCH(bool, thread_per_file);
+    if (m_server == nullptr) {
+        m_server = new LocalSshServer;
+        m_local = new QTemporaryDir;
+        m_server_started = m_server->start();
+    }
+    if (!m_server_started)
+        QSKIP(qPrintable(m_server->error()));
+
+    const int count = 200;
+    QStringList files;
+    QDir().mkpath(m_local->path() + "/many");
+    for (int i = 0; i < count; ++i) {
+        QString path = m_local->path() + QString("/many/%1.bin").arg(i);
+        QFile file(path);
+        file.open(QIODevice::WriteOnly);
+        file.write(QByteArray(i % 3 ? 2048 : 512 * 1024, (char)i));
+        files << path;
+    }
+    QString remote = m_server->root() + "/many";
+    QDir().mkpath(remote);
+    ssh_endpoint_t endpoint = m_server->endpoint();
+
+    QBENCHMARK {
+        if (thread_per_file) {
+            // old way, every selected row started at once
+            QThreadPool pool;
+            pool.setMaxThreadCount(count);
+            QList<QFuture<int> > results;
+            for (const QString& file : files)
+                results << QtConcurrent::run(&pool, [endpoint, file, remote]() {
+                    return CSftpTransfer::upload(endpoint, file, remote);
+                });
+            for (QFuture<int>& res : results)
+                QCOMPARE(res.result(), (int)RLE_SUCCESS);
+        } else {
+            CTransferScheduler scheduler;
+            QSignalSpy finished(&scheduler, &CTransferScheduler::job_finished);
+            for (const QString& file : files) {
+                scheduler.enqueue(endpoint.key(), QFileInfo(file).size(),
+                                  CTransferScheduler::TP_NORMAL,
+                                  [endpoint, file, remote](CTransferScheduler::progress_t progress,
+                                                           const QAtomicInt* cancel) {
+                    int rc = CSftpTransfer::upload(endpoint, file, remote, progress, cancel);
+                    return std::make_pair(rc == RLE_SUCCESS ? SCWE_SUCCESS : SCWE_SSH_LAUNCH_FAILED,
+                                          QStringList());
+                });
+            }
+            QTRY_COMPARE_WITH_TIMEOUT(finished.count(), count, 120000);
+            for (const QList<QVariant>& args : finished)
+                QCOMPARE(args.at(1).toInt(), (int)SCWE_SUCCESS);
+        }
+    }
+    QCOMPARE(QFileInfo(remote + "/9.bin").size(), QFileInfo(files[9]).size());
+}
+
+////////////////////////////////////////////////////////
+
+void TransferSchedulerTest::cleanupTestCase() {
+    if (m_server)
+        CSftpTransfer::close_sessions(m_server->endpoint().host);
+    delete m_server;
+    delete m_local;
+}
@@ -0,0 +1,32 @@
+#ifndef TRANSFERSCHEDULERTEST_H
+#define TRANSFERSCHEDULERTEST_H
+
+#include <QObject>
+#include <QTemporaryDir>
+
+class LocalSshServer;
+
+class TransferSchedulerTest : public QObject
+{
+    Q_OBJECT
+private:
+    LocalSshServer* m_server = nullptr;
+    QTemporaryDir* m_local = nullptr;
+    bool m_server_started = false;
+
+private slots:
+    void test_concurrency_cap();
+    void test_groups_take_turns();
+    void test_priority();
+    void test_set_priority();
+    void test_small_files_batched();
+    void test_cancel();
+    void test_cancel_running();
+    void test_close();
+    void test_progress_throttled();
+    void benchmark_many_files_data();
+    void benchmark_many_files();
+    void cleanupTestCase();
+};
+
+#endif // TRANSFERSCHEDULERTEST_H
@@ -0,0 +1,287 @@
+#include "VagrantMetadataTest.h"
+#include "VagrantMetadata.h"
+#include <QDir>
+#include <QFile>
+#include <QTemporaryDir>
+#include <QTest>
+
+QString VagrantMetadataTest::make_peer(const QString& name, int port) {
+    QString dir = m_dir->path() + "/peers/" + name;
+    QDir().mkpath(dir + "/.vagrant/machines/default/virtualbox");
+    write_file(dir + "/.vagrant/generated.yml", generated_yml(port));
+    write_file(dir + "/.vagrant/machines/default/virtualbox/id",
+               QString("vm-%1\n").arg(port).toUtf8());
+    return dir;
+}
+
+void VagrantMetadataTest::write_file(const QString& path, const QByteArray& data) {
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Truncate));
+    file.write(data);
+    file.close();
+}
+
+QByteArray VagrantMetadataTest::generated_yml(int port) {
+    // the way vagrant-subutai writes it
+    return QString(
+        "---\n"
+        "_CONSOLE_PORT: %1\n"
+        "_IP_PEER: 192.168.1.%2\n"
+        "_BRIDGE: \"enp3s0\"\n"
+        "_BASE_BOX: subutai/stretch\n"
+        "_SUBUTAI_NAME: 'peer %1'\n").arg(port).arg(port % 250).toUtf8();
+}
+
+////////////////////////////////////////////////////////
+
+void VagrantMetadataTest::initTestCase() {
+    m_dir = new QTemporaryDir;
+    QVERIFY(m_dir->isValid());
+    for (int i = 0; i < PEERS_COUNT; ++i)
+        m_peers << make_peer(QString("subutai-peer_%1").arg(i), 10000 + i);
+}
+
+////////////////////////////////////////////////////////
+
+void VagrantMetadataTest::test_parse_plain() {
+    QHash<QString, QString> res = CYamlSubsetReader::parse(
+        "_CONSOLE_PORT: 9999\r\n"
+        "SUBUTAI_RAM : 4096\n"
+        "DISK_SIZE:100   # in gigabytes\n"
+        "_IP_PEER:   10.0.0.1\n"
+        "URL: http://host:8080/path#anchor\n"
+        "EMPTY:\n"
+        "LAST: no newline");
+    QCOMPARE(res.value("_CONSOLE_PORT"), QString("9999"));
+    QCOMPARE(res.value("SUBUTAI_RAM"), QString("4096"));
+    // ':' not followed by blank isn't separator
+    QVERIFY(!res.contains("DISK_SIZE"));
+    QCOMPARE(res.value("_IP_PEER"), QString("10.0.0.1"));
+    QCOMPARE(res.value("URL"), QString("http://host:8080/path#anchor"));
+    QVERIFY(res.contains("EMPTY"));
+    QCOMPARE(res.value("EMPTY"), QString());
+    QCOMPARE(res.value("LAST"), QString("no newline"));
+}
+
+////////////////////////////////////////////////////////
+
+void VagrantMetadataTest::test_parse_quoted() {
+    QHash<QString, QString> res = CYamlSubsetReader::parse(
+        "DQ: \"a # b: c\"\n"
+        "ESC: \"say \\\"hi\\\"\\tnow\"\n"
+        "SQ: 'it''s'\n"
+        "\"QUOTED: KEY\": value\n"
+        "OPEN: \"unterminated\n"
+        "UTF: \"\xd0\xbf\xd0\xb8\xd1\x80\"\n");
+    QCOMPARE(res.value("DQ"), QString("a # b: c"));
+    QCOMPARE(res.value("ESC"), QString("say \"hi\"\tnow"));
+    QCOMPARE(res.value("SQ"), QString("it's"));
+    QCOMPARE(res.value("QUOTED: KEY"), QString("value"));
+    QCOMPARE(res.value("OPEN"), QString("unterminated"));
+    QCOMPARE(res.value("UTF"), QString::fromUtf8("\xd0\xbf\xd0\xb8\xd1\x80"));
+}
+
+////////////////////////////////////////////////////////
+
+void VagrantMetadataTest::test_parse_skipped_lines() {
+    QHash<QString, QString> res;
+    QByteArray data(
+        "---\n"
+        "# comment: here\n"
+        "\n"
+        "PARENT:\n"
+        "  CHILD: 1\n"
+        "\tTABBED: 2\n"
+        "- ITEM: 3\n"
+        "no separator here\n"
+        "...\n"
+        "KEY: value\n");
+    QCOMPARE(CYamlSubsetReader::parse(data.constData(), data.size(), res), 2);
+    QCOMPARE(res.size(), 2);
+    QVERIFY(res.contains("PARENT"));
+    QCOMPARE(res.value("KEY"), QString("value"));
+}
+
+////////////////////////////////////////////////////////
+
+void VagrantMetadataTest::test_parse_last_wins() {
+    QHash<QString, QString> res = CYamlSubsetReader::parse("PORT: 1\nPORT: 2\n");
+    QCOMPARE(res.size(), 1);
+    QCOMPARE(res.value("PORT"), QString("2"));
+}
+
+////////////////////////////////////////////////////////
+
+void VagrantMetadataTest::test_parse_mutated() {
+    // lines before mutated part must survive whatever follows them
+    const QByteArray stable = generated_yml(10042);
+    const QByteArray noise(
+        "NOISE_A: \"quoted value\"\n"
+        "NOISE_BB: 'single ''quoted'''\n"
+        "NOISE_CCC: plain # comment\n"
+        "  NESTED: 1\n"
+        "\"KEY WITH: COLON\": x\n");
+    QHash<QString, QString> expected = CYamlSubsetReader::parse(stable);
+    qsrand(42);
+
+    for (int round = 0; round < 5000; ++round) {
+        QByteArray data = stable + noise;
+        int mutations = 1 + qrand() % 8;
+        for (int i = 0; i < mutations; ++i) {
+            int pos = stable.size() + qrand() % noise.size();
+            data[pos] = (char)(qrand() % 256);
+        }
+        QHash<QString, QString> res = CYamlSubsetReader::parse(data);
+        for (auto j = expected.begin(); j != expected.end(); ++j)
+            QCOMPARE(res.value(j.key()), j.value());
+    }
+}
+
+////////////////////////////////////////////////////////
+
+void VagrantMetadataTest::test_parse_truncated() {
+    const QByteArray data = generated_yml(10042);
+    QHash<QString, QString> full = CYamlSubsetReader::parse(data);
+    for (int len = 0; len <= data.size(); ++len) {
+        // reading past size would be caught by sanitizers, copy keeps data unterminated
+        QByteArray part(data.constData(), len);
+        QHash<QString, QString> res;
+        CYamlSubsetReader::parse(part.constData(), part.size(), res);
+        int line_end = part.lastIndexOf('\n');
+        QHash<QString, QString> complete =
+            CYamlSubsetReader::parse(part.left(line_end + 1));
+        // complete lines are read as in full document
+        for (auto j = complete.begin(); j != complete.end(); ++j) {
+            QCOMPARE(res.value(j.key()), j.value());
+            QCOMPARE(j.value(), full.value(j.key()));
+        }
+    }
+    QHash<QString, QString> res;
+    QCOMPARE(CYamlSubsetReader::parse(nullptr, 10, res), 0);
+    QCOMPARE(CYamlSubsetReader::parse(data.constData(), -1, res), 0);
+}
+
+////////////////////////////////////////////////////////
+
+void VagrantMetadataTest::test_read_peer() {
+    vagrant_peer_meta_t meta = CVagrantMetadataCache::read_uncached(m_peers[5]);
+    QVERIFY(meta.generated_found);
+    QCOMPARE(meta.console_port, 10005);
+    QCOMPARE(meta.ip_peer, QString("192.168.1.5"));
+    QCOMPARE(meta.bridge, QString("enp3s0"));
+    QCOMPARE(meta.machine_name, QString("default"));
+    QCOMPARE(meta.provider, QString("virtualbox"));
+    QCOMPARE(meta.machine_id, QString("vm-10005"));
+    QCOMPARE(meta.values.value("_SUBUTAI_NAME"), QString("peer 10005"));
+}
+
+////////////////////////////////////////////////////////
+
+void VagrantMetadataTest::test_read_missing() {
+    vagrant_peer_meta_t meta =
+        CVagrantMetadataCache::read_uncached(m_dir->path() + "/no_such_peer");
+    QVERIFY(!meta.generated_found);
+    QCOMPARE(meta.console_port, -1);
+    QVERIFY(meta.machine_name.isEmpty());
+    QVERIFY(meta.machine_id.isEmpty());
+
+    QString dir = m_dir->path() + "/bad_port";
+    QDir().mkpath(dir + "/.vagrant");
+    write_file(dir + "/.vagrant/generated.yml", "_CONSOLE_PORT: undefined\n");
+    meta = CVagrantMetadataCache::read_uncached(dir);
+    QVERIFY(meta.generated_found);
+    QCOMPARE(meta.console_port, -1);
+}
+
+////////////////////////////////////////////////////////
+
+void VagrantMetadataTest::test_cache_hit() {
+    CVagrantMetadataCache cache;
+    for (int i = 0; i < 3; ++i) {
+        for (int j = 0; j < 10; ++j)
+            QCOMPARE(cache.read(m_peers[j]).console_port, 10000 + j);
+    }
+    QCOMPARE(cache.reads_count(), (quint64)10);
+}
+
+////////////////////////////////////////////////////////
+
+void VagrantMetadataTest::test_cache_changed_file() {
+    QString dir = make_peer("changed", 9999);
+    CVagrantMetadataCache cache;
+    QCOMPARE(cache.read(dir).console_port, 9999);
+    QCOMPARE(cache.read(dir).console_port, 9999);
+    QCOMPARE(cache.reads_count(), (quint64)1);
+
+    // size differs, so change is seen even inside one mtime tick
+    write_file(dir + "/.vagrant/generated.yml", generated_yml(10123));
+    QCOMPARE(cache.read(dir).console_port, 10123);
+    QCOMPARE(cache.reads_count(), (quint64)2);
+
+    QFile::remove(dir + "/.vagrant/generated.yml");
+    QVERIFY(!cache.read(dir).generated_found);
+    QCOMPARE(cache.reads_count(), (quint64)3);
+}
+
+////////////////////////////////////////////////////////
+
+void VagrantMetadataTest::test_cache_new_machine() {
+    // peer is being created: generated.yml is written before vagrant creates VM
+    QString dir = m_dir->path() + "/peers/creating";
+    QDir().mkpath(dir + "/.vagrant");
+    write_file(dir + "/.vagrant/generated.yml", generated_yml(10200));
+    CVagrantMetadataCache cache;
+    QVERIFY(cache.read(dir).machine_id.isEmpty());
+
+    QDir().mkpath(dir + "/.vagrant/machines/default/libvirt");
+    write_file(dir + "/.vagrant/machines/default/libvirt/id", "vm-new");
+    vagrant_peer_meta_t meta = cache.read(dir);
+    QCOMPARE(meta.provider, QString("libvirt"));
+    QCOMPARE(meta.machine_id, QString("vm-new"));
+    QCOMPARE(cache.reads_count(), (quint64)2);
+}
+
+////////////////////////////////////////////////////////
+
+void VagrantMetadataTest::test_cache_eviction() {
+    CVagrantMetadataCache cache;
+    QString base = m_dir->path() + "/evicted_";
+    for (int i = 0; i <= CVagrantMetadataCache::MAX_ENTRIES; ++i)
+        cache.read(base + QString::number(i));
+    quint64 reads = cache.reads_count();
+
+    // only the oldest entry is dropped when cache is full
+    cache.read(base + "1");
+    cache.read(base + QString::number(CVagrantMetadataCache::MAX_ENTRIES));
+    QCOMPARE(cache.reads_count(), reads);
+    cache.read(base + "0");
+    QCOMPARE(cache.reads_count(), reads + 1);
+}
+
+////////////////////////////////////////////////////////
+
+void VagrantMetadataTest::benchmark_read_cached() {
+    CVagrantMetadataCache cache;
+    for (auto i = m_peers.begin(); i != m_peers.end(); ++i)
+        cache.read(*i);
+    QBENCHMARK {
+        for (int i = 0; i < m_peers.size(); ++i)
+            QCOMPARE(cache.read(m_peers[i]).console_port, 10000 + i);
+    }
+    QCOMPARE(cache.reads_count(), (quint64)m_peers.size());
+}
+
+////////////////////////////////////////////////////////
+
+void VagrantMetadataTest::benchmark_read_uncached() {
+    QBENCHMARK {
+        for (int i = 0; i < m_peers.size(); ++i)
+            QCOMPARE(CVagrantMetadataCache::read_uncached(m_peers[i]).console_port, 10000 + i);
+    }
+}
+
+////////////////////////////////////////////////////////
+
+void VagrantMetadataTest::cleanupTestCase() {
+    delete m_dir;
+}
@@ -0,0 +1,42 @@
+#ifndef VAGRANTMETADATATEST_H
+#define VAGRANTMETADATATEST_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+
+class QTemporaryDir;
+
+class VagrantMetadataTest : public QObject
+{
+    Q_OBJECT
+private:
+    static const int PEERS_COUNT = 300;
+
+    QTemporaryDir* m_dir = nullptr;
+    QStringList m_peers;
+
+    QString make_peer(const QString& name, int port);
+    void write_file(const QString& path, const QByteArray& data);
+    static QByteArray generated_yml(int port);
+
+private slots:
+    void initTestCase();
+    void test_parse_plain();
+    void test_parse_quoted();
+    void test_parse_skipped_lines();
+    void test_parse_last_wins();
+    void test_parse_mutated();
+    void test_parse_truncated();
+    void test_read_peer();
+    void test_read_missing();
+    void test_cache_hit();
+    void test_cache_changed_file();
+    void test_cache_new_machine();
+    void test_cache_eviction();
+    void benchmark_read_cached();
+    void benchmark_read_uncached();
+    void cleanupTestCase();
+};
+
+#endif // VAGRANTMETADATATEST_H
@@ -0,0 +1,238 @@
+#include "VagrantStatusCacheTest.h"
+#include "VagrantStatusCache.h"
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTemporaryDir>
+#include <QTest>
+#include <QtConcurrent/QtConcurrent>
+
+const int VagrantStatusCacheTest::PEERS_COUNT;
+
+QString VagrantStatusCacheTest::make_peer(const QString& name) {
+    QString dir = m_dir->path() + "/peers/" + name;
+    QDir().mkpath(dir + "/.vagrant/machines/default/virtualbox");
+    write_file(dir + "/.vagrant/machines/default/virtualbox/id", "0a1b2c3d");
+    write_file(dir + "/Vagrantfile", "Vagrant.configure('2')\n");
+    return dir;
+}
+
+void VagrantStatusCacheTest::write_file(const QString& path, const QByteArray& data) {
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Truncate));
+    file.write(data);
+    file.close();
+}
+
+void VagrantStatusCacheTest::set_slow(bool slow) {
+    QString path = m_dir->path() + "/slow";
+    if (slow)
+        write_file(path, "");
+    else
+        QFile::remove(path);
+}
+
+int VagrantStatusCacheTest::vagrant_calls() const {
+    QFile file(m_dir->path() + "/calls");
+    if (!file.open(QIODevice::ReadOnly)) return 0;
+    return QString(file.readAll()).split("\n", QString::SkipEmptyParts).size();
+}
+
+void VagrantStatusCacheTest::initTestCase() {
+#ifdef RT_OS_WINDOWS
+    QSKIP("fake vagrant is shell script");
+#endif
+    m_dir = new QTemporaryDir;
+    QVERIFY(m_dir->isValid());
+
+    // `vagrant status` prints state as machine readable line, fails in broken peers
+    m_vagrant = m_dir->path() + "/vagrant";
+    write_file(m_vagrant, QString(
+        "#!/bin/sh\n"
+        "echo \"$*\" >> '%1/calls'\n"
+        "[ -f '%1/slow' ] && sleep 0.5\n"
+        "case \"$PWD\" in *broken*) exit 1;; esac\n"
+        "if [ \"$1\" = 'global-status' ]; then\n"
+        "  echo 'id       name    provider   state   directory'\n"
+        "  exit 0\n"
+        "fi\n"
+        "echo '1545000000,default,metadata,provider,virtualbox'\n"
+        "echo '1545000000,default,state,running'\n").arg(m_dir->path()).toUtf8());
+    QFile(m_vagrant).setPermissions(QFileDevice::ReadOwner | QFileDevice::WriteOwner |
+                                    QFileDevice::ExeOwner);
+
+    m_index_dir = m_dir->path() + "/vagrant.d/data/machine-index";
+    QDir().mkpath(m_index_dir);
+    write_file(m_index_dir + "/index", "{\"version\":1,\"machines\":{}}");
+
+    for (int i = 0; i < PEERS_COUNT; ++i)
+        m_peers << make_peer(QString("subutai-peer_%1").arg(i));
+
+    QString vagrant = m_vagrant;
+    m_cache = new CVagrantStatusCache(
+        [vagrant](const QString& dir, QString& status) {
+            system_call_res_t res = CSystemCallWrapper::ssystem_th(
+                vagrant,
+                QStringList() << "set_working_directory" << dir
+                              << "status" << "--machine-readable",
+                true, true, 10000);
+            if (res.res != SCWE_SUCCESS || res.exit_code != 0) {
+                status = "not_created";
+                return false;
+            }
+            status = CVagrantStatusCache::parse_machine_readable_state(res.out);
+            return true;
+        },
+        [vagrant]() {
+            return CSystemCallWrapper::ssystem_th(vagrant, QStringList() << "global-status",
+                                                  true, true, 10000);
+        },
+        m_index_dir);
+}
+
+void VagrantStatusCacheTest::init() {
+    set_slow(false);
+    m_cache->clear();
+    QFile::remove(m_dir->path() + "/calls");
+}
+
+////////////////////////////////////////////////////////
+
+void VagrantStatusCacheTest::test_parse_state() {
+    QStringList out;
+    out << "1545000000,default,metadata,provider,virtualbox"
+        << "1545000000,default,state,poweroff\r";
+    QCOMPARE(CVagrantStatusCache::parse_machine_readable_state(out), QString("poweroff"));
+    QCOMPARE(CVagrantStatusCache::parse_machine_readable_state(QStringList()),
+             QString("not_created"));
+}
+
+void VagrantStatusCacheTest::test_cache_hits() {
+    for (const QString& peer : m_peers)
+        QCOMPARE(m_cache->status(peer), QString("running"));
+    QCOMPARE(vagrant_calls(), PEERS_COUNT);
+
+    // nothing has changed on disk, so second refresh doesn't run vagrant at all
+    QElapsedTimer et;
+    et.start();
+    for (int round = 0; round < 10; ++round) {
+        for (const QString& peer : m_peers)
+            QCOMPARE(m_cache->status(peer), QString("running"));
+    }
+    QCOMPARE(vagrant_calls(), PEERS_COUNT);
+    QVERIFY(et.elapsed() < 1000);
+    for (const QString& peer : m_peers)
+        QVERIFY(m_cache->is_cached(peer + "/"));
+}
+
+void VagrantStatusCacheTest::test_state_file_changed() {
+    for (const QString& peer : m_peers)
+        m_cache->status(peer);
+    QTest::qWait(100);  // watches are set
+
+    write_file(m_peers[3] + "/.vagrant/machines/default/virtualbox/id", "4e5f6a7b8c9d");
+    QTRY_VERIFY_WITH_TIMEOUT(!m_cache->is_cached(m_peers[3]), 5000);
+    for (int i = 0; i < PEERS_COUNT; ++i) {
+        if (i != 3) QVERIFY(m_cache->is_cached(m_peers[i]));
+    }
+
+    for (const QString& peer : m_peers)
+        m_cache->status(peer);
+    QCOMPARE(vagrant_calls(), PEERS_COUNT + 1);
+}
+
+void VagrantStatusCacheTest::test_finished_marker() {
+    m_cache->status(m_peers[5]);
+    QTest::qWait(100);
+    write_file(m_peers[5] + "/halt_finished", "");
+    QTRY_VERIFY_WITH_TIMEOUT(!m_cache->is_cached(m_peers[5]), 5000);
+    QFile::remove(m_peers[5] + "/halt_finished");
+}
+
+void VagrantStatusCacheTest::test_provision_step() {
+    write_file(m_peers[6] + "/.vagrant/provision_step", "1");
+    m_cache->status(m_peers[6]);
+    QTest::qWait(100);
+    write_file(m_peers[6] + "/.vagrant/provision_step", "2");
+    QTRY_VERIFY_WITH_TIMEOUT(!m_cache->is_cached(m_peers[6]), 5000);
+    QFile::remove(m_peers[6] + "/.vagrant/provision_step");
+}
+
+void VagrantStatusCacheTest::test_lock_files_ignored() {
+    m_cache->status(m_peers[7]);
+    QTest::qWait(100);
+    QString lock = m_peers[7] + "/.vagrant/machines/default/virtualbox/action.lock";
+    write_file(lock, "");
+    QFile::remove(lock);
+    QTest::qWait(500);
+    QVERIFY(m_cache->is_cached(m_peers[7]));
+    QCOMPARE(vagrant_calls(), 1);
+}
+
+void VagrantStatusCacheTest::test_failed_not_cached() {
+    QString broken = make_peer("subutai-peer_broken");
+    QCOMPARE(m_cache->status(broken), QString("not_created"));
+    QVERIFY(!m_cache->is_cached(broken));
+    m_cache->status(broken);
+    QCOMPARE(vagrant_calls(), 2);
+    QDir(broken).removeRecursively();
+}
+
+void VagrantStatusCacheTest::test_peers_concurrent() {
+    set_slow(true);
+    QThreadPool pool;
+    pool.setMaxThreadCount(4);
+    QList<QFuture<QString> > futures;
+    QElapsedTimer et;
+    et.start();
+    for (int i = 0; i < 4; ++i) {
+        QString peer = m_peers[i];
+        futures << QtConcurrent::run(&pool, [this, peer]() { return m_cache->status(peer); });
+    }
+    pool.waitForDone();
+    for (auto& f : futures)
+        QCOMPARE(f.result(), QString("running"));
+    // with global lock it took 4 * 500 ms
+    QVERIFY(et.elapsed() < 1500);
+    QCOMPARE(vagrant_calls(), 4);
+}
+
+void VagrantStatusCacheTest::test_same_peer_serialized() {
+    set_slow(true);
+    QThreadPool pool;
+    pool.setMaxThreadCount(4);
+    QString peer = m_peers[0];
+    for (int i = 0; i < 4; ++i)
+        QtConcurrent::run(&pool, [this, peer]() { m_cache->status(peer); });
+    pool.waitForDone();
+    // vagrant runs one command per machine, others wait and take cached result
+    QCOMPARE(vagrant_calls(), 1);
+}
+
+void VagrantStatusCacheTest::test_global_status() {
+    system_call_res_t res = m_cache->global_status();
+    QCOMPARE(res.res, SCWE_SUCCESS);
+    QCOMPARE(res.out.size(), 1);
+    m_cache->global_status();
+    QCOMPARE(vagrant_calls(), 1);
+    QTest::qWait(100);
+
+    // lock file of index doesn't change it
+    write_file(m_index_dir + "/index.lock", "");
+    QFile::remove(m_index_dir + "/index.lock");
+    QTest::qWait(300);
+    m_cache->global_status();
+    QCOMPARE(vagrant_calls(), 1);
+
+    write_file(m_index_dir + "/index", "{\"version\":1,\"machines\":{\"a\":{}}}");
+    QTest::qWait(300);
+    m_cache->global_status();
+    QCOMPARE(vagrant_calls(), 2);
+}
+
+////////////////////////////////////////////////////////
+
+void VagrantStatusCacheTest::cleanupTestCase() {
+    delete m_cache;
+    delete m_dir;
+}
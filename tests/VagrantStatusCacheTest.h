@@ -0,0 +1,44 @@
+#ifndef VAGRANTSTATUSCACHETEST_H
+#define VAGRANTSTATUSCACHETEST_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+
+class CVagrantStatusCache;
+class QTemporaryDir;
+
+class VagrantStatusCacheTest : public QObject
+{
+    Q_OBJECT
+private:
+    static const int PEERS_COUNT = 10;
+
+    QTemporaryDir* m_dir = nullptr;
+    QString m_vagrant;
+    QString m_index_dir;
+    QStringList m_peers;
+    CVagrantStatusCache* m_cache = nullptr;
+
+    QString make_peer(const QString& name);
+    void write_file(const QString& path, const QByteArray& data);
+    void set_slow(bool slow);
+    int vagrant_calls() const;
+
+private slots:
+    void initTestCase();
+    void init();
+    void test_parse_state();
+    void test_cache_hits();
+    void test_state_file_changed();
+    void test_finished_marker();
+    void test_provision_step();
+    void test_lock_files_ignored();
+    void test_failed_not_cached();
+    void test_peers_concurrent();
+    void test_same_peer_serialized();
+    void test_global_status();
+    void cleanupTestCase();
+};
+
+#endif // VAGRANTSTATUSCACHETEST_H